@@ -33,6 +33,17 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct LRUCacheOptions, high_pri_pool_ratio),
           OptionType::kDouble, OptionVerificationType::kNormal,
           OptionTypeFlags::kMutable}},
+        {"tiny_lfu_sketch_entries",
+         {offsetof(struct LRUCacheOptions, tiny_lfu_sketch_entries),
+          OptionType::kSizeT, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
+        {"numa_aware",
+         {offsetof(struct LRUCacheOptions, numa_aware), OptionType::kBoolean,
+          OptionVerificationType::kNormal, OptionTypeFlags::kNone}},
+        {"compressed_tier_compression",
+         {offsetof(struct LRUCacheOptions, compressed_tier_compression),
+          OptionType::kCompressionType, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
 };
 #endif  // ROCKSDB_LITE
 
@@ -4,15 +4,23 @@
 //  (found in the LICENSE.Apache file in the root directory).
 
 #ifdef GFLAGS
+#ifdef NUMA
+#include <numa.h>
+#endif  // NUMA
+
 #include <cinttypes>
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 
 #include "db/db_impl/db_impl.h"
+#include "db/kv_cache_policy_table.h"
 #include "monitoring/histogram.h"
 #include "port/port.h"
 #include "rocksdb/cache.h"
@@ -22,8 +30,10 @@
 #include "rocksdb/secondary_cache.h"
 #include "rocksdb/system_clock.h"
 #include "rocksdb/table_properties.h"
+#include "rocksdb/trace_reader_writer.h"
 #include "table/block_based/block_based_table_reader.h"
 #include "table/block_based/cachable_entry.h"
+#include "trace_replay/block_cache_tracer.h"
 #include "util/coding.h"
 #include "util/gflags_compat.h"
 #include "util/hash.h"
@@ -47,6 +57,9 @@ DEFINE_double(resident_ratio, 0.25,
               "Ratio of keys fitting in cache to keyspace.");
 DEFINE_uint64(ops_per_thread, 2000000U, "Number of operations per thread.");
 DEFINE_uint32(value_bytes, 8 * KiB, "Size of each value added.");
+DEFINE_uint32(value_bytes_max, 0,
+              "If larger than value_bytes, the size of each value added is "
+              "drawn uniformly from value_bytes to value_bytes_max.");
 
 DEFINE_uint32(skew, 5, "Degree of skew in key selection");
 DEFINE_bool(populate_cache, true, "Populate cache before operations");
@@ -70,6 +83,25 @@ DEFINE_uint32(
 DEFINE_uint32(gather_stats_entries_per_lock, 256,
               "For Cache::ApplyToAllEntries");
 DEFINE_bool(skewed, false, "If true, skew the key access distribution");
+DEFINE_string(key_distribution, "",
+              "Key access distribution. Empty for the one selected by -skew "
+              "and -skewed, \"zipfian\" for a Zipfian distribution of "
+              "parameter -zipf_theta with the hot keys scattered over the key "
+              "space, or \"hotspot_shift\" for accesses concentrated on a "
+              "range of keys that moves over time.");
+DEFINE_double(zipf_theta, 0.99,
+              "(-key_distribution=zipfian) Skew of the distribution, in "
+              "(0, 1).");
+DEFINE_double(hotspot_key_fraction, 0.01,
+              "(-key_distribution=hotspot_shift) Fraction of the key space in "
+              "the hot range.");
+DEFINE_uint32(hotspot_access_percent, 90,
+              "(-key_distribution=hotspot_shift) Percentage of the accesses "
+              "going to the hot range.");
+DEFINE_uint64(hotspot_shift_ops, 100000,
+              "(-key_distribution=hotspot_shift) Operations of each thread "
+              "after which the hot range moves to another random position, "
+              "0 for never.");
 #ifndef ROCKSDB_LITE
 DEFINE_string(secondary_cache_uri, "",
               "Full URI for creating a custom secondary cache object");
@@ -78,6 +110,54 @@ static class std::shared_ptr<ROCKSDB_NAMESPACE::SecondaryCache> secondary_cache;
 
 DEFINE_bool(use_clock_cache, false, "");
 
+DEFINE_uint64(tiny_lfu_sketch_entries, 0,
+              "If > 0, enable TinyLFU admission in the LRU cache with a "
+              "frequency sketch sized for this many keys.");
+
+DEFINE_string(memory_allocator, "",
+              "If not empty, the MemoryAllocator of the cache, as for "
+              "MemoryAllocator::CreateFromString(), which also allocates the "
+              "values. For example HugePageMemoryAllocator, to compare TLB "
+              "misses under perf stat -e dTLB-load-misses.");
+
+DEFINE_bool(numa_aware, false,
+            "Sets LRUCacheOptions::numa_aware, to place the shards and the "
+            "cached values on the NUMA node of the inserting thread.");
+DEFINE_bool(pin_threads_to_numa_nodes, false,
+            "If true, pin the benchmark threads to the NUMA nodes "
+            "round-robin.");
+
+// ## BEGIN row_cache_mode options ##
+DEFINE_bool(row_cache_mode, false,
+            "If true, use the cache as the row cache of a DB holding the key "
+            "space in table files, and run lookups as DB reads, inserts as "
+            "DB writes and erases as DB deletes, so that row cache entries "
+            "go through the real insert, admission and invalidation paths. "
+            "Both kinds of lookup leave the insert decision to the DB. The "
+            "key space is written first, cache_size / resident_ratio bytes "
+            "of values.");
+DEFINE_string(row_cache_db, "",
+              "(-row_cache_mode) Path of the DB, destroyed before and after "
+              "the run. A directory under the test directory if empty.");
+DEFINE_bool(row_cache_hybrid_admission, false,
+            "(-row_cache_mode) ColumnFamilyOptions::"
+            "row_cache_hybrid_admission");
+DEFINE_uint32(row_cache_invalidation_threshold, 1,
+              "(-row_cache_mode) ColumnFamilyOptions::"
+              "row_cache_invalidation_threshold");
+// ## END row_cache_mode options ##
+
+// ## BEGIN block cache trace replay options ##
+DEFINE_string(block_cache_trace_file, "",
+              "If not empty, replay the accesses of this block cache trace, "
+              "as written by DB::StartBlockCacheTrace(), instead of "
+              "generating operations. The accesses are dealt to the threads "
+              "round-robin. A lookup that misses inserts the block, unless "
+              "the trace says it was not inserted. Row cache lookups and "
+              "erases are replayed too, under keys apart from the blocks. "
+              "The trace is loaded in memory first.");
+// ## END block cache trace replay options ##
+
 // ## BEGIN stress_cache_key sub-tool options ##
 // See class StressCacheKey below.
 DEFINE_bool(stress_cache_key, false,
@@ -129,6 +209,20 @@ DEFINE_bool(sck_footer_unique_id, false,
             "(-stress_cache_key) Simulate using proposed footer unique id");
 // ## END stress_cache_key sub-tool options ##
 
+// ## BEGIN kvcp_table_bench sub-tool options ##
+// See class KVCPTableBench below.
+DEFINE_bool(kvcp_table_bench, false,
+            "If true, benchmark the row cache KVCP invalidation table against "
+            "a mutex-sharded unordered_map baseline instead");
+DEFINE_uint64(kvcp_keys, 1000000,
+              "(-kvcp_table_bench) Number of distinct user keys");
+DEFINE_uint32(kvcp_threshold, 3,
+              "(-kvcp_table_bench) Invalidation threshold for skipping insert");
+DEFINE_uint32(kvcp_invalidate_percent, 20,
+              "(-kvcp_table_bench) Percentage of lookups of a cached key that "
+              "find it invalidated");
+// ## END kvcp_table_bench sub-tool options ##
+
 namespace ROCKSDB_NAMESPACE {
 
 class CacheBench;
@@ -174,13 +268,30 @@ class SharedState {
   CacheBench* cache_bench_;
 };
 
+// Operations of the benchmark, with a latency histogram each
+enum OpType : int {
+  kOpLookupInsert,
+  kOpInsert,
+  kOpLookup,
+  kOpErase,
+  kNumOpTypes,
+};
+
+const char* const kOpTypeNames[kNumOpTypes] = {"lookup+insert", "insert",
+                                               "lookup", "erase"};
+
 // Per-thread state for concurrent executions of the same benchmark.
 struct ThreadState {
   uint32_t tid;
   Random64 rnd;
   SharedState* shared;
   HistogramImpl latency_ns_hist;
+  HistogramImpl op_latency_ns_hist[kNumOpTypes];
   uint64_t duration_us = 0;
+  uint64_t num_ops = 0;
+  // Of the lookups in the cache, not counted with -row_cache_mode
+  uint64_t num_lookups = 0;
+  uint64_t num_hits = 0;
 
   ThreadState(uint32_t index, SharedState* _shared)
       : tid(index), rnd(1000 + index), shared(_shared) {}
@@ -204,6 +315,10 @@ struct KeyGen {
         key -= max_key;
       }
     }
+    return Encode(key);
+  }
+
+  Slice Encode(uint64_t key) {
     // Variable size and alignment
     size_t off = key % 8;
     key_data[0] = char{42};
@@ -216,34 +331,79 @@ struct KeyGen {
   }
 };
 
-char* createValue(Random64& rnd) {
-  char* rv = new char[FLAGS_value_bytes];
-  // Fill with some filler data, and take some CPU time
-  for (uint32_t i = 0; i < FLAGS_value_bytes; i += 8) {
-    EncodeFixed64(rv + i, rnd.Next());
+// Of the cache, if -memory_allocator is set
+MemoryAllocator* value_allocator = nullptr;
+
+char* AllocateValue(size_t size) {
+  if (value_allocator != nullptr) {
+    return static_cast<char*>(value_allocator->Allocate(size));
+  }
+  return new char[size];
+}
+
+void FreeValue(void* value) {
+  if (value_allocator != nullptr) {
+    value_allocator->Deallocate(value);
+  } else {
+    delete[] static_cast<char*>(value);
+  }
+}
+
+// Size of the next value to add, a multiple of 8
+uint32_t NextValueSize(Random64& rnd) {
+  if (FLAGS_value_bytes_max <= FLAGS_value_bytes) {
+    return FLAGS_value_bytes & ~uint32_t{7};
+  }
+  uint64_t size = FLAGS_value_bytes +
+                  rnd.Uniform(FLAGS_value_bytes_max - FLAGS_value_bytes + 1);
+  return static_cast<uint32_t>(size) & ~uint32_t{7};
+}
+
+uint32_t AverageValueSize() {
+  return (FLAGS_value_bytes +
+          std::max(FLAGS_value_bytes, FLAGS_value_bytes_max)) /
+         2;
+}
+
+// Fill with some filler data, and take some CPU time
+void FillValue(Random64& rnd, char* value, size_t size) {
+  for (size_t i = 0; i + 8 <= size; i += 8) {
+    EncodeFixed64(value + i, rnd.Next());
   }
+}
+
+// The first 8 bytes of a value hold its size
+char* createValue(Random64& rnd, size_t size) {
+  char* rv = AllocateValue(size);
+  FillValue(rnd, rv + 8, size - 8);
+  EncodeFixed64(rv, size);
   return rv;
 }
 
+size_t ValueSize(const void* value) {
+  return static_cast<size_t>(DecodeFixed64(static_cast<const char*>(value)));
+}
+
 // Callbacks for secondary cache
-size_t SizeFn(void* /*obj*/) { return FLAGS_value_bytes; }
+size_t SizeFn(void* obj) { return ValueSize(obj); }
 
 Status SaveToFn(void* obj, size_t /*offset*/, size_t size, void* out) {
   memcpy(out, obj, size);
   return Status::OK();
 }
 
+Status CreateFn(const void* buf, size_t size, void** out_obj, size_t* charge) {
+  *out_obj = reinterpret_cast<void*>(AllocateValue(size));
+  memcpy(*out_obj, buf, size);
+  *charge = size;
+  return Status::OK();
+}
+
 // Different deleters to simulate using deleter to gather
 // stats on the code origin and kind of cache entries.
-void deleter1(const Slice& /*key*/, void* value) {
-  delete[] static_cast<char*>(value);
-}
-void deleter2(const Slice& /*key*/, void* value) {
-  delete[] static_cast<char*>(value);
-}
-void deleter3(const Slice& /*key*/, void* value) {
-  delete[] static_cast<char*>(value);
-}
+void deleter1(const Slice& /*key*/, void* value) { FreeValue(value); }
+void deleter2(const Slice& /*key*/, void* value) { FreeValue(value); }
+void deleter3(const Slice& /*key*/, void* value) { FreeValue(value); }
 
 Cache::CacheItemHelper helper1(SizeFn, SaveToFn, deleter1);
 Cache::CacheItemHelper helper2(SizeFn, SaveToFn, deleter2);
@@ -257,7 +417,7 @@ class CacheBench {
  public:
   CacheBench()
       : max_key_(static_cast<uint64_t>(FLAGS_cache_size / FLAGS_resident_ratio /
-                                       FLAGS_value_bytes)),
+                                       AverageValueSize())),
         lookup_insert_threshold_(kHundredthUint64 *
                                  FLAGS_lookup_insert_percent),
         insert_threshold_(lookup_insert_threshold_ +
@@ -271,6 +431,10 @@ class CacheBench {
       fprintf(stderr, "Percentages must add to 100.\n");
       exit(1);
     }
+    if (FLAGS_value_bytes < 8) {
+      fprintf(stderr, "value_bytes must be at least 8.\n");
+      exit(1);
+    }
 
     max_log_ = 0;
     if (skewed_) {
@@ -279,14 +443,51 @@ class CacheBench {
       if (max_key > (static_cast<uint64_t>(1) << max_log_)) max_log_++;
     }
 
+    if (FLAGS_key_distribution.empty()) {
+      key_distribution_ = kDefaultDistribution;
+    } else if (FLAGS_key_distribution == "zipfian") {
+      key_distribution_ = kZipfian;
+      InitZipfian();
+    } else if (FLAGS_key_distribution == "hotspot_shift") {
+      key_distribution_ = kHotspotShift;
+      hotspot_keys_ = std::max(
+          uint64_t{1},
+          static_cast<uint64_t>(FLAGS_hotspot_key_fraction * max_key_));
+    } else {
+      fprintf(stderr, "Unknown key_distribution %s\n",
+              FLAGS_key_distribution.c_str());
+      exit(1);
+    }
+
+    std::shared_ptr<MemoryAllocator> memory_allocator;
+    if (!FLAGS_memory_allocator.empty()) {
+      Status s = MemoryAllocator::CreateFromString(
+          ConfigOptions(), FLAGS_memory_allocator, &memory_allocator);
+      if (!s.ok()) {
+        fprintf(stderr, "Cannot create memory allocator %s: %s\n",
+                FLAGS_memory_allocator.c_str(), s.ToString().c_str());
+        exit(1);
+      }
+    }
+
     if (FLAGS_use_clock_cache) {
-      cache_ = NewClockCache(FLAGS_cache_size, FLAGS_num_shard_bits);
+      if (memory_allocator) {
+        fprintf(stderr, "Clock cache does not take a memory allocator.\n");
+        exit(1);
+      }
+      ClockCacheOptions opts(FLAGS_cache_size, FLAGS_num_shard_bits);
+      opts.estimated_entry_charge = AverageValueSize();
+      cache_ = NewClockCache(opts);
       if (!cache_) {
         fprintf(stderr, "Clock cache not supported.\n");
         exit(1);
       }
     } else {
-      LRUCacheOptions opts(FLAGS_cache_size, FLAGS_num_shard_bits, false, 0.5);
+      LRUCacheOptions opts(FLAGS_cache_size, FLAGS_num_shard_bits, false, 0.5,
+                           memory_allocator);
+      opts.tiny_lfu_sketch_entries =
+          static_cast<size_t>(FLAGS_tiny_lfu_sketch_entries);
+      opts.numa_aware = FLAGS_numa_aware;
 #ifndef ROCKSDB_LITE
       if (!FLAGS_secondary_cache_uri.empty()) {
         Status s = SecondaryCache::CreateFromString(
@@ -304,16 +505,48 @@ class CacheBench {
 
       cache_ = NewLRUCache(opts);
     }
+    value_allocator = cache_->memory_allocator();
+
+    if (!FLAGS_block_cache_trace_file.empty()) {
+      LoadTrace();
+    } else if (FLAGS_row_cache_mode) {
+      OpenRowCacheDB();
+    }
   }
 
-  ~CacheBench() {}
+  ~CacheBench() {
+    if (db_) {
+      Status s = db_->Close();
+      db_.reset();
+      if (s.ok()) {
+        s = DestroyDB(db_path_, Options());
+      }
+      if (!s.ok()) {
+        fprintf(stderr, "Cannot clean up DB %s: %s\n", db_path_.c_str(),
+                s.ToString().c_str());
+      }
+    }
+  }
 
   void PopulateCache() {
     Random64 rnd(1);
     KeyGen keygen;
-    for (uint64_t i = 0; i < 2 * FLAGS_cache_size; i += FLAGS_value_bytes) {
-      cache_->Insert(keygen.GetRand(rnd, max_key_, max_log_), createValue(rnd),
-                     &helper1, FLAGS_value_bytes);
+    if (db_) {
+      // Reads of the key space fill the row cache
+      PinnableSlice value;
+      for (uint64_t i = 0; i < 2 * FLAGS_cache_size; i += AverageValueSize()) {
+        value.Reset();
+        Status s = db_->Get(ReadOptions(), db_->DefaultColumnFamily(),
+                            GenKey(&keygen, rnd, 0), &value);
+        CheckDBStatus(s, "Get");
+      }
+      return;
+    }
+    for (uint64_t i = 0; i < 2 * FLAGS_cache_size;) {
+      uint32_t size = NextValueSize(rnd);
+      cache_->Insert(GenKey(&keygen, rnd, 0), createValue(rnd, size),
+                     &helper1, size);
+      i += size;
     }
   }
 
@@ -356,11 +589,20 @@ class CacheBench {
     uint64_t end_time = clock->NowMicros();
     stats_thread.join();
 
+    uint64_t total_ops = 0;
+    uint64_t total_lookups = 0;
+    uint64_t total_hits = 0;
+    for (uint32_t i = 0; i < FLAGS_threads; i++) {
+      total_ops += threads[i]->num_ops;
+      total_lookups += threads[i]->num_lookups;
+      total_hits += threads[i]->num_hits;
+    }
+
     // Wall clock time - includes idle time if threads
     // finish at different times (not ideal).
     double elapsed_secs = static_cast<double>(end_time - start_time) * 1e-6;
-    uint32_t ops_per_sec = static_cast<uint32_t>(
-        1.0 * FLAGS_threads * FLAGS_ops_per_thread / elapsed_secs);
+    uint32_t ops_per_sec =
+        static_cast<uint32_t>(1.0 * total_ops / elapsed_secs);
     printf("Complete in %.3f s; Rough parallel ops/sec = %u\n", elapsed_secs,
            ops_per_sec);
 
@@ -369,9 +611,19 @@ class CacheBench {
     for (uint32_t i = 0; i < FLAGS_threads; i++) {
       elapsed_secs += threads[i]->duration_us * 1e-6;
     }
-    ops_per_sec = static_cast<uint32_t>(1.0 * FLAGS_threads *
-                                        FLAGS_ops_per_thread / elapsed_secs);
+    ops_per_sec = static_cast<uint32_t>(1.0 * total_ops / elapsed_secs);
     printf("Thread ops/sec = %u\n", ops_per_sec);
+    if (total_lookups > 0) {
+      printf("Lookup hit ratio = %.4f\n", 1.0 * total_hits / total_lookups);
+    }
+    if (db_) {
+      Statistics* stats = db_->GetOptions().statistics.get();
+      uint64_t hits = stats->getTickerCount(ROW_CACHE_HIT);
+      uint64_t misses = stats->getTickerCount(ROW_CACHE_MISS);
+      printf("Row cache hits = %" PRIu64 ", misses = %" PRIu64
+             ", admission rejects = %" PRIu64 "\n",
+             hits, misses, stats->getTickerCount(ROW_CACHE_ADMISSION_REJECT));
+    }
 
     printf("\nOperation latency (ns):\n");
     HistogramImpl combined;
@@ -380,6 +632,21 @@ class CacheBench {
     }
     printf("%s", combined.ToString().c_str());
 
+    printf("\nOperation latency percentiles (ns):\n");
+    printf("%-6s %-13s %12s %10s %10s %10s\n", "Thread", "Operation", "Count",
+           "P50", "P99", "P99.9");
+    for (int op = 0; op < kNumOpTypes; ++op) {
+      HistogramImpl op_combined;
+      for (uint32_t i = 0; i < FLAGS_threads; i++) {
+        op_combined.Merge(threads[i]->op_latency_ns_hist[op]);
+      }
+      PrintPercentiles("all", kOpTypeNames[op], op_combined);
+      for (uint32_t i = 0; i < FLAGS_threads; i++) {
+        PrintPercentiles(std::to_string(i), kOpTypeNames[op],
+                         threads[i]->op_latency_ns_hist[op]);
+      }
+    }
+
     if (FLAGS_gather_stats) {
       printf("\nGather stats latency (us):\n");
       printf("%s", stats_hist.ToString().c_str());
@@ -391,6 +658,20 @@ class CacheBench {
   }
 
  private:
+  enum KeyDistribution {
+    kDefaultDistribution,
+    kZipfian,
+    kHotspotShift,
+  };
+
+  // An access of a block cache trace, see LoadTrace()
+  struct TraceAccess {
+    std::string key;
+    uint32_t size;
+    bool erase;
+    bool no_insert;
+  };
+
   std::shared_ptr<Cache> cache_;
   const uint64_t max_key_;
   // Cumulative thresholds in the space of a random uint64_t
@@ -400,6 +681,190 @@ class CacheBench {
   const uint64_t erase_threshold_;
   const bool skewed_;
   int max_log_;
+  KeyDistribution key_distribution_ = kDefaultDistribution;
+  // Constants of the Zipfian distribution, see InitZipfian()
+  double zipf_zetan_ = 0;
+  double zipf_alpha_ = 0;
+  double zipf_eta_ = 0;
+  double zipf_rank1_bound_ = 0;
+  uint64_t hotspot_keys_ = 0;
+  // With -row_cache_mode
+  std::unique_ptr<DB> db_;
+  std::string db_path_;
+  // With -block_cache_trace_file
+  std::vector<TraceAccess> trace_;
+
+  static void CheckDBStatus(const Status& s, const char* op) {
+    if (!s.ok() && !s.IsNotFound()) {
+      fprintf(stderr, "%s failed: %s\n", op, s.ToString().c_str());
+      exit(1);
+    }
+  }
+
+  static void PrintPercentiles(const std::string& thread, const char* op,
+                               const HistogramImpl& hist) {
+    if (hist.num() == 0) {
+      return;
+    }
+    printf("%-6s %-13s %12" PRIu64 " %10.0f %10.0f %10.0f\n", thread.c_str(),
+           op, hist.num(), hist.Percentile(50), hist.Percentile(99),
+           hist.Percentile(99.9));
+  }
+
+  // Generator of Gray et al., "Quickly Generating Billion-Record Synthetic
+  // Databases", as used by YCSB
+  void InitZipfian() {
+    double theta = FLAGS_zipf_theta;
+    if (!(theta > 0 && theta < 1)) {
+      fprintf(stderr, "zipf_theta must be in (0, 1).\n");
+      exit(1);
+    }
+    double n = static_cast<double>(max_key_);
+    double zeta2 = 1.0 + std::pow(0.5, theta);
+    zipf_zetan_ = 0;
+    for (uint64_t i = 1; i <= max_key_; ++i) {
+      zipf_zetan_ += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    zipf_alpha_ = 1.0 / (1.0 - theta);
+    zipf_eta_ = (1.0 - std::pow(2.0 / n, 1.0 - theta)) /
+                (1.0 - zeta2 / zipf_zetan_);
+    zipf_rank1_bound_ = zeta2;
+  }
+
+  uint64_t NextZipfian(Random64& rnd) const {
+    double u = static_cast<double>(rnd.Next() >> 11) /
+               static_cast<double>(uint64_t{1} << 53);
+    double uz = u * zipf_zetan_;
+    uint64_t rank;
+    if (uz < 1.0) {
+      rank = 0;
+    } else if (uz < zipf_rank1_bound_) {
+      rank = 1;
+    } else {
+      rank = static_cast<uint64_t>(
+          static_cast<double>(max_key_) *
+          std::pow(zipf_eta_ * u - zipf_eta_ + 1.0, zipf_alpha_));
+    }
+    // Scatter the hot keys over the key space, and so over the shards
+    return FastRange64(
+        NPHash64(reinterpret_cast<const char*>(&rank), sizeof(rank)),
+        max_key_);
+  }
+
+  // op is the index of the operation in the thread, which gives the
+  // position of the hot range, the same for all threads
+  uint64_t NextHotspotShift(Random64& rnd, uint64_t op) const {
+    if (rnd.Uniform(100) < FLAGS_hotspot_access_percent) {
+      uint64_t epoch =
+          FLAGS_hotspot_shift_ops > 0 ? op / FLAGS_hotspot_shift_ops : 0;
+      uint64_t start = FastRange64(
+          NPHash64(reinterpret_cast<const char*>(&epoch), sizeof(epoch)),
+          max_key_);
+      return (start + FastRange64(rnd.Next(), hotspot_keys_)) % max_key_;
+    }
+    return FastRange64(rnd.Next(), max_key_);
+  }
+
+  Slice GenKey(KeyGen* gen, Random64& rnd, uint64_t op) const {
+    switch (key_distribution_) {
+      case kZipfian:
+        return gen->Encode(NextZipfian(rnd));
+      case kHotspotShift:
+        return gen->Encode(NextHotspotShift(rnd, op));
+      default:
+        return gen->GetRand(rnd, max_key_, max_log_);
+    }
+  }
+
+  // Opens a DB with the cache as row cache, and writes the whole key space
+  // to a table file
+  void OpenRowCacheDB() {
+    db_path_ = FLAGS_row_cache_db;
+    if (db_path_.empty()) {
+      Status s = Env::Default()->GetTestDirectory(&db_path_);
+      CheckDBStatus(s, "GetTestDirectory");
+      db_path_ += "/cache_bench_row_cache";
+    }
+    Options options;
+    options.create_if_missing = true;
+    options.row_cache = cache_;
+    options.row_cache_hybrid_admission = FLAGS_row_cache_hybrid_admission;
+    options.row_cache_invalidation_threshold =
+        FLAGS_row_cache_invalidation_threshold;
+    options.statistics = CreateDBStatistics();
+    Status s = DestroyDB(db_path_, options);
+    CheckDBStatus(s, "DestroyDB");
+    DB* db = nullptr;
+    s = DB::Open(options, db_path_, &db);
+    CheckDBStatus(s, "Open");
+    db_.reset(db);
+
+    Random64 rnd(2);
+    KeyGen keygen;
+    WriteOptions write_options;
+    write_options.disableWAL = true;
+    std::string value;
+    for (uint64_t key = 0; key < max_key_; ++key) {
+      value.resize(NextValueSize(rnd));
+      FillValue(rnd, &value[0], value.size());
+      s = db_->Put(write_options, keygen.Encode(key), value);
+      CheckDBStatus(s, "Put");
+    }
+    s = db_->Flush(FlushOptions());
+    CheckDBStatus(s, "Flush");
+    options.statistics->Reset().PermitUncheckedError();
+  }
+
+  // Loads the accesses of -block_cache_trace_file. Row cache keys get a
+  // prefix that block cache keys do not start with, as they do not share
+  // the cache in a DB.
+  void LoadTrace() {
+    std::unique_ptr<TraceReader> trace_reader;
+    Status s = NewFileTraceReader(Env::Default(), EnvOptions(),
+                                  FLAGS_block_cache_trace_file, &trace_reader);
+    BlockCacheTraceHeader header;
+    std::unique_ptr<BlockCacheTraceReader> reader;
+    if (s.ok()) {
+      reader.reset(new BlockCacheTraceReader(std::move(trace_reader)));
+      s = reader->ReadHeader(&header);
+    }
+    if (!s.ok()) {
+      fprintf(stderr, "Cannot read trace %s: %s\n",
+              FLAGS_block_cache_trace_file.c_str(), s.ToString().c_str());
+      exit(1);
+    }
+    for (;;) {
+      BlockCacheTraceRecord record;
+      if (!reader->ReadAccess(&record).ok()) {
+        // End of the trace
+        break;
+      }
+      TraceAccess access;
+      if (BlockCacheTraceHelper::IsRowCacheAccess(record.block_type)) {
+        if (record.block_type == TraceType::kBlockTraceRowCacheWrite) {
+          // Only the erases that follow change the cache
+          continue;
+        }
+        access.key.push_back('\0');
+        PutFixed32(&access.key, static_cast<uint32_t>(record.cf_id));
+        access.key.append(record.block_key);
+      } else {
+        access.key = std::move(record.block_key);
+      }
+      // Room for the size of the value
+      access.size = static_cast<uint32_t>(
+          std::min(std::max(record.block_size, uint64_t{8}),
+                   uint64_t{std::numeric_limits<uint32_t>::max()}));
+      access.erase = record.block_type == TraceType::kBlockTraceRowCacheErase;
+      access.no_insert = record.no_insert == Boolean::kTrue;
+      trace_.push_back(std::move(access));
+    }
+    if (trace_.empty()) {
+      fprintf(stderr, "No accesses in trace %s\n",
+              FLAGS_block_cache_trace_file.c_str());
+      exit(1);
+    }
+  }
 
   // A benchmark version of gathering stats on an active block cache by
   // iterating over it. The primary purpose is to measure the impact of
@@ -474,6 +939,11 @@ class CacheBench {
 
   static void ThreadBody(ThreadState* thread) {
     SharedState* shared = thread->shared;
+#ifdef NUMA
+    if (FLAGS_pin_threads_to_numa_nodes) {
+      numa_run_on_node(static_cast<int>(thread->tid) % port::NumaNodeCount());
+    }
+#endif  // NUMA
 
     {
       MutexLock l(shared->GetMutex());
@@ -485,7 +955,7 @@ class CacheBench {
         shared->GetCondVar()->Wait();
       }
     }
-    thread->shared->GetCacheBench()->OperateCache(thread);
+    thread->shared->GetCacheBench()->Operate(thread);
 
     {
       MutexLock l(shared->GetMutex());
@@ -496,75 +966,97 @@ class CacheBench {
     }
   }
 
+  void Operate(ThreadState* thread) {
+    const auto clock = SystemClock::Default().get();
+    uint64_t start_time = clock->NowMicros();
+    if (!trace_.empty()) {
+      ReplayTrace(thread);
+    } else if (db_) {
+      OperateRowCache(thread);
+    } else {
+      OperateCache(thread);
+    }
+    thread->duration_us = clock->NowMicros() - start_time;
+  }
+
+  void RecordLatency(ThreadState* thread, int op_type, uint64_t nanos) {
+    thread->latency_ns_hist.Add(nanos);
+    if (op_type < kNumOpTypes) {
+      thread->op_latency_ns_hist[op_type].Add(nanos);
+    }
+    thread->num_ops++;
+  }
+
   void OperateCache(ThreadState* thread) {
     // To use looked-up values
     uint64_t result = 0;
     // To hold handles for a non-trivial amount of time
     Cache::Handle* handle = nullptr;
     KeyGen gen;
-    const auto clock = SystemClock::Default().get();
-    uint64_t start_time = clock->NowMicros();
-    StopWatchNano timer(clock);
+    StopWatchNano timer(SystemClock::Default().get());
 
     for (uint64_t i = 0; i < FLAGS_ops_per_thread; i++) {
       timer.Start();
-      Slice key = gen.GetRand(thread->rnd, max_key_, max_log_);
+      Slice key = GenKey(&gen, thread->rnd, i);
       uint64_t random_op = thread->rnd.Next();
-      Cache::CreateCallback create_cb = [](const void* buf, size_t size,
-                                           void** out_obj,
-                                           size_t* charge) -> Status {
-        *out_obj = reinterpret_cast<void*>(new char[size]);
-        memcpy(*out_obj, buf, size);
-        *charge = size;
-        return Status::OK();
-      };
+      int op_type = kNumOpTypes;
 
       if (random_op < lookup_insert_threshold_) {
+        op_type = kOpLookupInsert;
         if (handle) {
           cache_->Release(handle);
           handle = nullptr;
         }
         // do lookup
-        handle = cache_->Lookup(key, &helper2, create_cb, Cache::Priority::LOW,
+        handle = cache_->Lookup(key, &helper2, CreateFn, Cache::Priority::LOW,
                                 true);
+        thread->num_lookups++;
         if (handle) {
+          thread->num_hits++;
           // do something with the data
-          result += NPHash64(static_cast<char*>(cache_->Value(handle)),
-                             FLAGS_value_bytes);
+          void* value = cache_->Value(handle);
+          result += NPHash64(static_cast<char*>(value), ValueSize(value));
         } else {
           // do insert
-          cache_->Insert(key, createValue(thread->rnd), &helper2,
-                         FLAGS_value_bytes, &handle);
+          uint32_t size = NextValueSize(thread->rnd);
+          cache_->Insert(key, createValue(thread->rnd, size), &helper2, size,
+                         &handle);
         }
       } else if (random_op < insert_threshold_) {
+        op_type = kOpInsert;
         if (handle) {
           cache_->Release(handle);
           handle = nullptr;
         }
         // do insert
-        cache_->Insert(key, createValue(thread->rnd), &helper3,
-                       FLAGS_value_bytes, &handle);
+        uint32_t size = NextValueSize(thread->rnd);
+        cache_->Insert(key, createValue(thread->rnd, size), &helper3, size,
+                       &handle);
       } else if (random_op < lookup_threshold_) {
+        op_type = kOpLookup;
         if (handle) {
           cache_->Release(handle);
           handle = nullptr;
         }
         // do lookup
-        handle = cache_->Lookup(key, &helper2, create_cb, Cache::Priority::LOW,
+        handle = cache_->Lookup(key, &helper2, CreateFn, Cache::Priority::LOW,
                                 true);
+        thread->num_lookups++;
         if (handle) {
+          thread->num_hits++;
           // do something with the data
-          result += NPHash64(static_cast<char*>(cache_->Value(handle)),
-                             FLAGS_value_bytes);
+          void* value = cache_->Value(handle);
+          result += NPHash64(static_cast<char*>(value), ValueSize(value));
         }
       } else if (random_op < erase_threshold_) {
+        op_type = kOpErase;
         // do erase
         cache_->Erase(key);
       } else {
         // Should be extremely unlikely (noop)
         assert(random_op >= kHundredthUint64 * 100U);
       }
-      thread->latency_ns_hist.Add(timer.ElapsedNanos());
+      RecordLatency(thread, op_type, timer.ElapsedNanos());
     }
     if (handle) {
       cache_->Release(handle);
@@ -575,24 +1067,133 @@ class CacheBench {
       printf("You are extremely unlucky(2). Try again.\n");
       exit(1);
     }
-    thread->duration_us = clock->NowMicros() - start_time;
+  }
+
+  void OperateRowCache(ThreadState* thread) {
+    // To use looked-up values
+    uint64_t result = 0;
+    KeyGen gen;
+    PinnableSlice pinned;
+    std::string value;
+    WriteOptions write_options;
+    write_options.disableWAL = true;
+    StopWatchNano timer(SystemClock::Default().get());
+
+    for (uint64_t i = 0; i < FLAGS_ops_per_thread; i++) {
+      timer.Start();
+      Slice key = GenKey(&gen, thread->rnd, i);
+      uint64_t random_op = thread->rnd.Next();
+      int op_type = kNumOpTypes;
+      Status s;
+
+      if (random_op < lookup_threshold_ &&
+          (random_op < lookup_insert_threshold_ ||
+           random_op >= insert_threshold_)) {
+        op_type =
+            random_op < lookup_insert_threshold_ ? kOpLookupInsert : kOpLookup;
+        pinned.Reset();
+        s = db_->Get(ReadOptions(), db_->DefaultColumnFamily(), key, &pinned);
+        CheckDBStatus(s, "Get");
+        result += pinned.size();
+      } else if (random_op < insert_threshold_) {
+        op_type = kOpInsert;
+        // Invalidates the cached row
+        value.resize(NextValueSize(thread->rnd));
+        FillValue(thread->rnd, &value[0], value.size());
+        s = db_->Put(write_options, key, value);
+        CheckDBStatus(s, "Put");
+      } else if (random_op < erase_threshold_) {
+        op_type = kOpErase;
+        s = db_->Delete(write_options, key);
+        CheckDBStatus(s, "Delete");
+      } else {
+        // Should be extremely unlikely (noop)
+        assert(random_op >= kHundredthUint64 * 100U);
+      }
+      RecordLatency(thread, op_type, timer.ElapsedNanos());
+    }
+    // Ensure computations on `result` are not optimized away.
+    if (result == 1) {
+      printf("You are extremely unlucky(2). Try again.\n");
+      exit(1);
+    }
+  }
+
+  void ReplayTrace(ThreadState* thread) {
+    // To use looked-up values
+    uint64_t result = 0;
+    StopWatchNano timer(SystemClock::Default().get());
+
+    for (size_t i = thread->tid; i < trace_.size(); i += FLAGS_threads) {
+      const TraceAccess& access = trace_[i];
+      timer.Start();
+      int op_type;
+      if (access.erase) {
+        op_type = kOpErase;
+        cache_->Erase(access.key);
+      } else {
+        op_type = kOpLookupInsert;
+        Cache::Handle* handle = cache_->Lookup(
+            access.key, &helper2, CreateFn, Cache::Priority::LOW, true);
+        thread->num_lookups++;
+        if (handle) {
+          thread->num_hits++;
+          result += ValueSize(cache_->Value(handle));
+          cache_->Release(handle);
+        } else if (!access.no_insert) {
+          cache_->Insert(access.key, createValue(thread->rnd, access.size),
+                         &helper1, access.size);
+        }
+      }
+      RecordLatency(thread, op_type, timer.ElapsedNanos());
+    }
+    // Ensure computations on `result` are not optimized away.
+    if (result == 1) {
+      printf("You are extremely unlucky(2). Try again.\n");
+      exit(1);
+    }
   }
 
   void PrintEnv() const {
     printf("RocksDB version     : %d.%d\n", kMajorVersion, kMinorVersion);
     printf("Number of threads   : %u\n", FLAGS_threads);
-    printf("Ops per thread      : %" PRIu64 "\n", FLAGS_ops_per_thread);
+    if (!trace_.empty()) {
+      printf("Trace file          : %s\n",
+             FLAGS_block_cache_trace_file.c_str());
+      printf("Trace accesses      : %" ROCKSDB_PRIszt "\n", trace_.size());
+    } else {
+      printf("Ops per thread      : %" PRIu64 "\n", FLAGS_ops_per_thread);
+    }
     printf("Cache size          : %s\n",
            BytesToHumanString(FLAGS_cache_size).c_str());
     printf("Num shard bits      : %u\n", FLAGS_num_shard_bits);
-    printf("Max key             : %" PRIu64 "\n", max_key_);
-    printf("Resident ratio      : %g\n", FLAGS_resident_ratio);
-    printf("Skew degree         : %u\n", FLAGS_skew);
-    printf("Populate cache      : %d\n", int{FLAGS_populate_cache});
-    printf("Lookup+Insert pct   : %u%%\n", FLAGS_lookup_insert_percent);
-    printf("Insert percentage   : %u%%\n", FLAGS_insert_percent);
-    printf("Lookup percentage   : %u%%\n", FLAGS_lookup_percent);
-    printf("Erase percentage    : %u%%\n", FLAGS_erase_percent);
+    printf("Memory allocator    : %s\n",
+           value_allocator != nullptr ? value_allocator->Name() : "default");
+    printf("NUMA nodes          : %d%s%s\n", port::NumaNodeCount(),
+           FLAGS_numa_aware ? ", aware" : "",
+           FLAGS_pin_threads_to_numa_nodes ? ", threads pinned" : "");
+    if (db_) {
+      printf("Row cache DB        : %s%s\n", db_path_.c_str(),
+             FLAGS_row_cache_hybrid_admission ? ", hybrid admission" : "");
+    }
+    if (trace_.empty()) {
+      printf("Max key             : %" PRIu64 "\n", max_key_);
+      printf("Value bytes         : %u", FLAGS_value_bytes);
+      if (FLAGS_value_bytes_max > FLAGS_value_bytes) {
+        printf(" to %u", FLAGS_value_bytes_max);
+      }
+      printf("\n");
+      printf("Resident ratio      : %g\n", FLAGS_resident_ratio);
+      printf("Key distribution    : %s\n",
+             FLAGS_key_distribution.empty() ? "default"
+                                            : FLAGS_key_distribution.c_str());
+      printf("Skew degree         : %u\n", FLAGS_skew);
+      printf("Populate cache      : %d\n", int{FLAGS_populate_cache});
+      printf("Lookup+Insert pct   : %u%%\n", FLAGS_lookup_insert_percent);
+      printf("Insert percentage   : %u%%\n", FLAGS_insert_percent);
+      printf("Lookup percentage   : %u%%\n", FLAGS_lookup_percent);
+      printf("Erase percentage    : %u%%\n", FLAGS_erase_percent);
+    }
     std::ostringstream stats;
     if (FLAGS_gather_stats) {
       stats << "enabled (" << FLAGS_gather_stats_sleep_ms << "ms, "
@@ -893,6 +1494,193 @@ class StressCacheKey {
   double multiplier_ = 0.0;
 };
 
+// Measures the per-lookup bookkeeping that TableCache::Get does against the
+// KVCP invalidation table, comparing KVCPInvalidationTable with the mutex-
+// sharded std::unordered_map it replaced (reproduced below as the baseline).
+// Each operation follows the hybrid row cache path: read both counters,
+// sometimes record an invalidation, then either skip the insert or insert
+// and evict an older key to keep the tracked set at steady state.
+class KVCPTableBench {
+ public:
+  void Run() {
+    printf("KVCP table bench: %u threads, %" PRIu64 " ops/thread, %" PRIu64
+           " keys, row cache %s\n",
+           FLAGS_threads, FLAGS_ops_per_thread, FLAGS_kvcp_keys,
+           BytesToHumanString(FLAGS_cache_size).c_str());
+
+    KVCPInvalidationTable table(
+        KVCPInvalidationTable::SlotsForCapacity(FLAGS_cache_size));
+    printf("Lock-free table: %zu slots, %s\n", table.NumSlots(),
+           BytesToHumanString(table.ApproximateMemoryUsage()).c_str());
+    double lock_free = RunOne(&table);
+    printf("Lock-free table: %.0f ops/sec\n", lock_free);
+
+    MutexMapTable baseline;
+    double mutex_map = RunOne(&baseline);
+    printf("Mutex-sharded map: %.0f ops/sec\n", mutex_map);
+    printf("Speedup: %.2fx\n", lock_free / mutex_map);
+  }
+
+ private:
+  // The sharded map previously used by db/kv_cache_policy.cc
+  class MutexMapTable {
+   public:
+    MutexMapTable() : shards_(kShards) {}
+
+    KVCPLookupState GetLookupState(const KVCPKeyCtx& k) {
+      // The old table needed one locked lookup per counter
+      KVCPLookupState state;
+      state.invalidation_count = Get(k, &Entry::invalidation_count);
+      state.cached_key_count = Get(k, &Entry::cached_key_count);
+      return state;
+    }
+
+    bool OnInvalidation(const KVCPKeyCtx& k) {
+      Shard& sh = ShardRef(k);
+      std::lock_guard<std::mutex> lk(sh.mu);
+      auto it = sh.map.find(k.user_key.ToString());
+      if (it == sh.map.end()) {
+        return false;
+      }
+      ++it->second.invalidation_count;
+      return true;
+    }
+
+    bool ShouldSkipInsert(const KVCPKeyCtx& k, uint32_t threshold) {
+      Shard& sh = ShardRef(k);
+      std::lock_guard<std::mutex> lk(sh.mu);
+      auto it = sh.map.find(k.user_key.ToString());
+      return it != sh.map.end() && it->second.invalidation_count >= threshold;
+    }
+
+    void OnInsert(const KVCPKeyCtx& k) {
+      Shard& sh = ShardRef(k);
+      std::lock_guard<std::mutex> lk(sh.mu);
+      ++sh.map[k.user_key.ToString()].cached_key_count;
+    }
+
+    void OnEvict(const KVCPKeyCtx& k) {
+      Shard& sh = ShardRef(k);
+      std::lock_guard<std::mutex> lk(sh.mu);
+      auto it = sh.map.find(k.user_key.ToString());
+      if (it == sh.map.end()) {
+        return;
+      }
+      if (it->second.cached_key_count > 1) {
+        --it->second.cached_key_count;
+      } else {
+        sh.map.erase(it);
+      }
+    }
+
+   private:
+    static constexpr size_t kShards = 64;
+    struct Entry {
+      uint32_t cached_key_count = 0;
+      uint32_t invalidation_count = 0;
+    };
+    struct Shard {
+      std::mutex mu;
+      std::unordered_map<std::string, Entry> map;
+    };
+
+    Shard& ShardRef(const KVCPKeyCtx& k) {
+      return shards_[GetSliceNPHash64(k.user_key) & (kShards - 1)];
+    }
+
+    uint32_t Get(const KVCPKeyCtx& k, uint32_t Entry::*field) {
+      Shard& sh = ShardRef(k);
+      std::lock_guard<std::mutex> lk(sh.mu);
+      auto it = sh.map.find(k.user_key.ToString());
+      return it == sh.map.end() ? 0 : it->second.*field;
+    }
+
+    std::vector<Shard> shards_;
+  };
+
+  // Adapts KVCPInvalidationTable to the key-based interface above
+  static KVCPLookupState GetLookupState(KVCPInvalidationTable* t,
+                                        const KVCPKeyCtx& k) {
+    return t->GetLookupState(KVCPInvalidationTable::Fingerprint(k));
+  }
+  static bool OnInvalidation(KVCPInvalidationTable* t, const KVCPKeyCtx& k) {
+    return t->OnInvalidation(KVCPInvalidationTable::Fingerprint(k));
+  }
+  static bool ShouldSkipInsert(KVCPInvalidationTable* t, const KVCPKeyCtx& k,
+                               uint32_t threshold) {
+    return t->ShouldSkipInsert(KVCPInvalidationTable::Fingerprint(k),
+                               threshold);
+  }
+  static void OnInsert(KVCPInvalidationTable* t, const KVCPKeyCtx& k) {
+    t->OnInsert(KVCPInvalidationTable::Fingerprint(k));
+  }
+  static void OnEvict(KVCPInvalidationTable* t, const KVCPKeyCtx& k) {
+    t->OnEvict(KVCPInvalidationTable::Fingerprint(k));
+  }
+  static KVCPLookupState GetLookupState(MutexMapTable* t,
+                                        const KVCPKeyCtx& k) {
+    return t->GetLookupState(k);
+  }
+  static bool OnInvalidation(MutexMapTable* t, const KVCPKeyCtx& k) {
+    return t->OnInvalidation(k);
+  }
+  static bool ShouldSkipInsert(MutexMapTable* t, const KVCPKeyCtx& k,
+                               uint32_t threshold) {
+    return t->ShouldSkipInsert(k, threshold);
+  }
+  static void OnInsert(MutexMapTable* t, const KVCPKeyCtx& k) {
+    t->OnInsert(k);
+  }
+  static void OnEvict(MutexMapTable* t, const KVCPKeyCtx& k) {
+    t->OnEvict(k);
+  }
+
+  template <class Table>
+  static void Operate(Table* table, uint32_t tid, std::atomic<uint64_t>* sink) {
+    Random64 rnd(1000 + tid);
+    int max_log = 0;
+    for (uint64_t max_key = FLAGS_kvcp_keys; max_key >>= 1;) {
+      max_log++;
+    }
+    KeyGen gen;
+    KeyGen victim_gen;
+    uint64_t result = 0;
+    for (uint64_t i = 0; i < FLAGS_ops_per_thread; i++) {
+      KVCPKeyCtx k{nullptr, 0, gen.GetRand(rnd, FLAGS_kvcp_keys, max_log)};
+      KVCPLookupState state = GetLookupState(table, k);
+      result += state.invalidation_count;
+      if (state.cached_key_count > 0 &&
+          rnd.Uniform(100) < FLAGS_kvcp_invalidate_percent) {
+        OnInvalidation(table, k);
+      }
+      if (!ShouldSkipInsert(table, k, FLAGS_kvcp_threshold)) {
+        OnInsert(table, k);
+        KVCPKeyCtx victim{nullptr, 0,
+                          victim_gen.GetRand(rnd, FLAGS_kvcp_keys, max_log)};
+        OnEvict(table, victim);
+      }
+    }
+    sink->fetch_add(result, std::memory_order_relaxed);
+  }
+
+  template <class Table>
+  static double RunOne(Table* table) {
+    const auto clock = SystemClock::Default().get();
+    std::atomic<uint64_t> sink{0};
+    std::vector<port::Thread> threads;
+    uint64_t start_time = clock->NowMicros();
+    for (uint32_t i = 0; i < FLAGS_threads; i++) {
+      threads.emplace_back(&Operate<Table>, table, i, &sink);
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    double elapsed_secs =
+        static_cast<double>(clock->NowMicros() - start_time) * 1e-6;
+    return 1.0 * FLAGS_threads * FLAGS_ops_per_thread / elapsed_secs;
+  }
+};
+
 int cache_bench_tool(int argc, char** argv) {
   ParseCommandLineFlags(&argc, &argv, true);
 
@@ -902,13 +1690,19 @@ int cache_bench_tool(int argc, char** argv) {
     return 0;
   }
 
+  if (FLAGS_kvcp_table_bench) {
+    // Alternate tool
+    KVCPTableBench().Run();
+    return 0;
+  }
+
   if (FLAGS_threads <= 0) {
     fprintf(stderr, "threads number <= 0\n");
     exit(1);
   }
 
   ROCKSDB_NAMESPACE::CacheBench bench;
-  if (FLAGS_populate_cache) {
+  if (FLAGS_populate_cache && FLAGS_block_cache_trace_file.empty()) {
     bench.PopulateCache();
     printf("Population complete\n");
     printf("----------------------------\n");
@@ -39,6 +39,9 @@ enum class CacheEntryRole {
   // Filter reservations to account for
   // (new) bloom and ribbon filter construction's memory usage
   kFilterConstruction,
+  // Row cache reservations to account for the memory of row cache admission
+  // state (e.g. the per-column-family KVCP invalidation table)
+  kRowCacheAdmission,
   // Default bucket, for miscellaneous cache entries. Do not use for
   // entries that could potentially add up to large usage.
   kMisc,
@@ -100,8 +100,11 @@ class CacheTest : public testing::TestWithParam<std::string> {
       return NewLRUCache(co);
     }
     if (type == kClock) {
-      return NewClockCache(capacity, num_shard_bits, strict_capacity_limit,
+      ClockCacheOptions co(capacity, num_shard_bits, strict_capacity_limit,
                            charge_policy);
+      // Most entries in these tests have a charge of 1
+      co.estimated_entry_charge = 1;
+      return NewClockCache(co);
     }
     return nullptr;
   }
@@ -313,6 +316,64 @@ TEST_P(CacheTest, InsertSameKey) {
   ASSERT_EQ(2, Lookup(1));
 }
 
+TEST_P(CacheTest, MultiLookupAndInsert) {
+  // More keys than kept on the stack, spread over all shards, with a
+  // duplicate that must win over its earlier copy as if inserted in order
+  const int kNumKeys = 40;
+  std::vector<std::string> keys;
+  std::vector<Slice> key_slices;
+  std::vector<void*> values;
+  std::vector<size_t> charges(kNumKeys + 1, 1);
+  for (int i = 0; i < kNumKeys; i++) {
+    keys.push_back(EncodeKey(i));
+    values.push_back(EncodeValue(i + 1000));
+  }
+  keys.push_back(EncodeKey(0));
+  values.push_back(EncodeValue(2000));
+  for (const std::string& key : keys) {
+    key_slices.push_back(key);
+  }
+  std::vector<Status> statuses(keys.size());
+  cache_->MultiInsert(keys.size(), key_slices.data(), values.data(),
+                      charges.data(), &CacheTest::Deleter,
+                      /*handles=*/nullptr, Cache::Priority::LOW,
+                      statuses.data());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_OK(statuses[i]);
+  }
+  ASSERT_EQ(1U, deleted_keys_.size());
+  ASSERT_EQ(0, deleted_keys_[0]);
+  ASSERT_EQ(1000, deleted_values_[0]);
+
+  // Hits and misses interleaved
+  std::vector<std::string> lookup_keys;
+  for (int i = 0; i < kNumKeys; i++) {
+    lookup_keys.push_back(EncodeKey(i));
+    lookup_keys.push_back(EncodeKey(i + kNumKeys));
+  }
+  std::vector<Slice> lookup_slices(lookup_keys.begin(), lookup_keys.end());
+  std::vector<Cache::Handle*> handles(lookup_keys.size());
+  cache_->MultiLookup(lookup_keys.size(), lookup_slices.data(),
+                      handles.data());
+  for (int i = 0; i < kNumKeys; i++) {
+    Cache::Handle* hit = handles[2 * i];
+    ASSERT_NE(nullptr, hit);
+    ASSERT_EQ(i == 0 ? 2000 : i + 1000, DecodeValue(cache_->Value(hit)));
+    ASSERT_EQ(nullptr, handles[2 * i + 1]);
+    cache_->Release(hit);
+  }
+
+  // Handles returned by MultiInsert
+  std::vector<Cache::Handle*> insert_handles(keys.size());
+  cache_->MultiInsert(1, &key_slices[1], &values[1], &charges[1],
+                      &CacheTest::Deleter, insert_handles.data(),
+                      Cache::Priority::LOW, statuses.data());
+  ASSERT_TRUE(statuses[0].IsOkOverwritten());
+  ASSERT_NE(nullptr, insert_handles[0]);
+  ASSERT_EQ(1001, DecodeValue(cache_->Value(insert_handles[0])));
+  cache_->Release(insert_handles[0]);
+}
+
 TEST_P(CacheTest, Erase) {
   Erase(200);
   ASSERT_EQ(0U, deleted_keys_.size());
@@ -699,6 +760,22 @@ TEST_P(CacheTest, OverCapacity) {
   // cache is under capacity now since elements were released
   ASSERT_EQ(n, cache->GetUsage());
 
+  if (GetParam() == kClock) {
+    // One element is evicted, in table order rather than release order
+    size_t evicted = 0;
+    for (size_t i = 0; i < n + 1; i++) {
+      std::string key = ToString(i + 1);
+      auto h = cache->Lookup(key);
+      if (h) {
+        cache->Release(h);
+      } else {
+        evicted++;
+      }
+    }
+    ASSERT_EQ(1U, evicted);
+    return;
+  }
+
   // element 0 is evicted and the rest is there
   // This is consistent with the LRU policy since the element 0
   // was released first
@@ -834,14 +911,8 @@ TEST_P(CacheTest, GetChargeAndDeleter) {
   cache_->Release(h1);
 }
 
-#ifdef SUPPORT_CLOCK_CACHE
-std::shared_ptr<Cache> (*new_clock_cache_func)(
-    size_t, int, bool, CacheMetadataChargePolicy) = NewClockCache;
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest,
                         testing::Values(kLRU, kClock));
-#else
-INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest, testing::Values(kLRU));
-#endif  // SUPPORT_CLOCK_CACHE
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, LRUCacheTest, testing::Values(kLRU));
 
 }  // namespace ROCKSDB_NAMESPACE
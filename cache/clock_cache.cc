@@ -9,831 +9,816 @@
 
 #include "cache/clock_cache.h"
 
-#ifndef SUPPORT_CLOCK_CACHE
-
-namespace ROCKSDB_NAMESPACE {
-
-std::shared_ptr<Cache> NewClockCache(
-    size_t /*capacity*/, int /*num_shard_bits*/, bool /*strict_capacity_limit*/,
-    CacheMetadataChargePolicy /*metadata_charge_policy*/) {
-  // Clock cache not supported.
-  return nullptr;
-}
-
-}  // namespace ROCKSDB_NAMESPACE
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
 
-#else
+#include <algorithm>
+#include <cinttypes>
+#include <vector>
 
-#include <assert.h>
-#include <atomic>
-#include <deque>
-
-// "tbb/concurrent_hash_map.h" requires RTTI if exception is enabled.
-// Disable it so users can chooose to disable RTTI.
-#ifndef ROCKSDB_USE_RTTI
-#define TBB_USE_EXCEPTIONS 0
-#endif
-#include "cache/sharded_cache.h"
-#include "port/lang.h"
+#include "monitoring/perf_context_imp.h"
+#include "monitoring/statistics.h"
 #include "port/malloc.h"
-#include "port/port.h"
-#include "tbb/concurrent_hash_map.h"
-#include "util/autovector.h"
-#include "util/mutexlock.h"
+#include "test_util/sync_point.h"
 
 namespace ROCKSDB_NAMESPACE {
 
 namespace {
 
-// An implementation of the Cache interface based on CLOCK algorithm, with
-// better concurrent performance than LRUCache. The idea of CLOCK algorithm
-// is to maintain all cache entries in a circular list, and an iterator
-// (the "head") pointing to the last examined entry. Eviction starts from the
-// current head. Each entry is given a second chance before eviction, if it
-// has been access since last examine. In contrast to LRU, no modification
-// to the internal data-structure (except for flipping the usage bit) needs
-// to be done upon lookup. This gives us oppertunity to implement a cache
-// with better concurrency.
-//
-// Each cache entry is represented by a cache handle, and all the handles
-// are arranged in a circular list, as describe above. Upon erase of an entry,
-// we never remove the handle. Instead, the handle is put into a recycle bin
-// to be re-use. This is to avoid memory dealocation, which is hard to deal
-// with in concurrent environment.
-//
-// The cache also maintains a concurrent hash map for lookup. Any concurrent
-// hash map implementation should do the work. We currently use
-// tbb::concurrent_hash_map because it supports concurrent erase.
-//
-// Each cache handle has the following flags and counters, which are squeeze
-// in an atomic interger, to make sure the handle always be in a consistent
-// state:
-//
-//   * In-cache bit: whether the entry is reference by the cache itself. If
-//     an entry is in cache, its key would also be available in the hash map.
-//   * Usage bit: whether the entry has been access by user since last
-//     examine for eviction. Can be reset by eviction.
-//   * Reference count: reference count by user.
-//
-// An entry can be reference only when it's in cache. An entry can be evicted
-// only when it is in cache, has no usage since last examine, and reference
-// count is zero.
-//
-// The follow figure shows a possible layout of the cache. Boxes represents
-// cache handles and numbers in each box being in-cache bit, usage bit and
-// reference count respectively.
-//
-//    hash map:
-//      +-------+--------+
-//      |  key  | handle |
-//      +-------+--------+
-//      | "foo" |    5   |-------------------------------------+
-//      +-------+--------+                                     |
-//      | "bar" |    2   |--+                                  |
-//      +-------+--------+  |                                  |
-//                          |                                  |
-//                     head |                                  |
-//                       |  |                                  |
-//    circular list:     |  |                                  |
-//         +-------+   +-------+   +-------+   +-------+   +-------+   +-------
-//         |(0,0,0)|---|(1,1,0)|---|(0,0,0)|---|(0,1,3)|---|(1,0,0)|---|  ...
-//         +-------+   +-------+   +-------+   +-------+   +-------+   +-------
-//             |                       |
-//             +-------+   +-----------+
-//                     |   |
-//                   +---+---+
-//    recycle bin:   | 1 | 3 |
-//                   +---+---+
-//
-// Suppose we try to insert "baz" into the cache at this point and the cache is
-// full. The cache will first look for entries to evict, starting from where
-// head points to (the second entry). It resets usage bit of the second entry,
-// skips the third and fourth entry since they are not in cache, and finally
-// evict the fifth entry ("foo"). It looks at recycle bin for available handle,
-// grabs handle 3, and insert the key into the handle. The following figure
-// shows the resulting layout.
-//
-//    hash map:
-//      +-------+--------+
-//      |  key  | handle |
-//      +-------+--------+
-//      | "baz" |    3   |-------------+
-//      +-------+--------+             |
-//      | "bar" |    2   |--+          |
-//      +-------+--------+  |          |
-//                          |          |
-//                          |          |                                 head
-//                          |          |                                   |
-//    circular list:        |          |                                   |
-//         +-------+   +-------+   +-------+   +-------+   +-------+   +-------
-//         |(0,0,0)|---|(1,0,0)|---|(1,0,0)|---|(0,1,3)|---|(0,0,0)|---|  ...
-//         +-------+   +-------+   +-------+   +-------+   +-------+   +-------
-//             |                                               |
-//             +-------+   +-----------------------------------+
-//                     |   |
-//                   +---+---+
-//    recycle bin:   | 1 | 5 |
-//                   +---+---+
-//
-// A global mutex guards the circular list, the head, and the recycle bin.
-// We additionally require that modifying the hash map needs to hold the mutex.
-// As such, Modifying the cache (such as Insert() and Erase()) require to
-// hold the mutex. Lookup() only access the hash map and the flags associated
-// with each handle, and don't require explicit locking. Release() has to
-// acquire the mutex only when it releases the last reference to the entry and
-// the entry has been erased from cache explicitly. A future improvement could
-// be to remove the mutex completely.
-//
-// Benchmark:
-// We run readrandom db_bench on a test DB of size 13GB, with size of each
-// level:
-//
-//    Level    Files   Size(MB)
-//    -------------------------
-//      L0        1       0.01
-//      L1       18      17.32
-//      L2      230     182.94
-//      L3     1186    1833.63
-//      L4     4602    8140.30
-//
-// We test with both 32 and 16 read threads, with 2GB cache size (the whole DB
-// doesn't fits in) and 64GB cache size (the whole DB can fit in cache), and
-// whether to put index and filter blocks in block cache. The benchmark runs
-// with
-// with RocksDB 4.10. We got the following result:
-//
-// Threads Cache     Cache               ClockCache               LRUCache
-//         Size  Index/Filter Throughput(MB/s)   Hit Throughput(MB/s)    Hit
-//     32   2GB       yes               466.7  85.9%           433.7   86.5%
-//     32   2GB       no                529.9  72.7%           532.7   73.9%
-//     32  64GB       yes               649.9  99.9%           507.9   99.9%
-//     32  64GB       no                740.4  99.9%           662.8   99.9%
-//     16   2GB       yes               278.4  85.9%           283.4   86.5%
-//     16   2GB       no                318.6  72.7%           335.8   73.9%
-//     16  64GB       yes               391.9  99.9%           353.3   99.9%
-//     16  64GB       no                433.8  99.8%           419.4   99.8%
-
-// Cache entry meta data.
-struct CacheHandle {
-  Slice key;
-  void* value;
-  size_t charge;
-  Cache::DeleterFn deleter;
-  uint32_t hash;
-
-  // Addition to "charge" to get "total charge" under metadata policy.
-  uint32_t meta_charge;
-
-  // Flags and counters associated with the cache handle:
-  //   lowest bit: in-cache bit
-  //   second lowest bit: usage bit
-  //   the rest bits: reference count
-  // The handle is unused when flags equals to 0. The thread decreases the count
-  // to 0 is responsible to put the handle back to recycle_ and cleanup memory.
-  std::atomic<uint32_t> flags;
-
-  CacheHandle() = default;
-
-  CacheHandle(const CacheHandle& a) { *this = a; }
-
-  CacheHandle(const Slice& k, void* v,
-              void (*del)(const Slice& key, void* value))
-      : key(k), value(v), deleter(del) {}
-
-  CacheHandle& operator=(const CacheHandle& a) {
-    // Only copy members needed for deletion.
-    key = a.key;
-    value = a.value;
-    deleter = a.deleter;
-    return *this;
-  }
-
-  inline static uint32_t CalcMetadataCharge(
-      Slice key, CacheMetadataChargePolicy metadata_charge_policy) {
-    size_t meta_charge = 0;
-    if (metadata_charge_policy == kFullChargeCacheMetadata) {
-      meta_charge += sizeof(CacheHandle);
-#ifdef ROCKSDB_MALLOC_USABLE_SIZE
-      meta_charge +=
-          malloc_usable_size(static_cast<void*>(const_cast<char*>(key.data())));
-#else
-      meta_charge += key.size();
-#endif
-    }
-    assert(meta_charge <= UINT32_MAX);
-    return static_cast<uint32_t>(meta_charge);
-  }
-
-  inline size_t GetTotalCharge() { return charge + meta_charge; }
-};
-
-// Key of hash map. We store hash value with the key for convenience.
-struct ClockCacheKey {
-  Slice key;
-  uint32_t hash_value;
-
-  ClockCacheKey() = default;
-
-  ClockCacheKey(const Slice& k, uint32_t h) {
-    key = k;
-    hash_value = h;
-  }
-
-  static bool equal(const ClockCacheKey& a, const ClockCacheKey& b) {
-    return a.hash_value == b.hash_value && a.key == b.key;
-  }
-
-  static size_t hash(const ClockCacheKey& a) {
-    return static_cast<size_t>(a.hash_value);
-  }
-};
-
-struct CleanupContext {
-  // List of values to be deleted, along with the key and deleter.
-  autovector<CacheHandle> to_delete_value;
-
-  // List of keys to be deleted.
-  autovector<const char*> to_delete_key;
-};
-
-// A cache shard which maintains its own CLOCK cache.
-class ClockCacheShard final : public CacheShard {
- public:
-  // Hash map type.
-  using HashTable =
-      tbb::concurrent_hash_map<ClockCacheKey, CacheHandle*, ClockCacheKey>;
-
-  ClockCacheShard();
-  ~ClockCacheShard() override;
-
-  // Interfaces
-  void SetCapacity(size_t capacity) override;
-  void SetStrictCapacityLimit(bool strict_capacity_limit) override;
-  Status Insert(const Slice& key, uint32_t hash, void* value, size_t charge,
-                void (*deleter)(const Slice& key, void* value),
-                Cache::Handle** handle, Cache::Priority priority) override;
-  Status Insert(const Slice& key, uint32_t hash, void* value,
-                const Cache::CacheItemHelper* helper, size_t charge,
-                Cache::Handle** handle, Cache::Priority priority) override {
-    return Insert(key, hash, value, charge, helper->del_cb, handle, priority);
-  }
-  Cache::Handle* Lookup(const Slice& key, uint32_t hash) override;
-  Cache::Handle* Lookup(const Slice& key, uint32_t hash,
-                        const Cache::CacheItemHelper* /*helper*/,
-                        const Cache::CreateCallback& /*create_cb*/,
-                        Cache::Priority /*priority*/, bool /*wait*/,
-                        Statistics* /*stats*/) override {
-    return Lookup(key, hash);
-  }
-  bool Release(Cache::Handle* handle, bool /*useful*/,
-               bool force_erase) override {
-    return Release(handle, force_erase);
-  }
-  bool IsReady(Cache::Handle* /*handle*/) override { return true; }
-  void Wait(Cache::Handle* /*handle*/) override {}
-
-  // If the entry in in cache, increase reference count and return true.
-  // Return false otherwise.
-  //
-  // Not necessary to hold mutex_ before being called.
-  bool Ref(Cache::Handle* handle) override;
-  bool Release(Cache::Handle* handle, bool force_erase = false) override;
-  void Erase(const Slice& key, uint32_t hash) override;
-  bool EraseAndConfirm(const Slice& key, uint32_t hash,
-                       CleanupContext* context);
-  size_t GetUsage() const override;
-  size_t GetPinnedUsage() const override;
-  void EraseUnRefEntries() override;
-  void ApplyToSomeEntries(
-      const std::function<void(const Slice& key, void* value, size_t charge,
-                               DeleterFn deleter)>& callback,
-      uint32_t average_entries_per_lock, uint32_t* state) override;
-
- private:
-  static const uint32_t kInCacheBit = 1;
-  static const uint32_t kUsageBit = 2;
-  static const uint32_t kRefsOffset = 2;
-  static const uint32_t kOneRef = 1 << kRefsOffset;
-
-  // Helper functions to extract cache handle flags and counters.
-  static bool InCache(uint32_t flags) { return flags & kInCacheBit; }
-  static bool HasUsage(uint32_t flags) { return flags & kUsageBit; }
-  static uint32_t CountRefs(uint32_t flags) { return flags >> kRefsOffset; }
-
-  // Decrease reference count of the entry. If this decreases the count to 0,
-  // recycle the entry. If set_usage is true, also set the usage bit.
-  //
-  // returns true if a value is erased.
-  //
-  // Not necessary to hold mutex_ before being called.
-  bool Unref(CacheHandle* handle, bool set_usage, CleanupContext* context);
-
-  // Unset in-cache bit of the entry. Recycle the handle if necessary.
-  //
-  // returns true if a value is erased.
-  //
-  // Has to hold mutex_ before being called.
-  bool UnsetInCache(CacheHandle* handle, CleanupContext* context);
-
-  // Put the handle back to recycle_ list, and put the value associated with
-  // it into to-be-deleted list. It doesn't cleanup the key as it might be
-  // reused by another handle.
-  //
-  // Has to hold mutex_ before being called.
-  void RecycleHandle(CacheHandle* handle, CleanupContext* context);
-
-  // Delete keys and values in to-be-deleted list. Call the method without
-  // holding mutex, as destructors can be expensive.
-  void Cleanup(const CleanupContext& context);
-
-  // Examine the handle for eviction. If the handle is in cache, usage bit is
-  // not set, and referece count is 0, evict it from cache. Otherwise unset
-  // the usage bit.
-  //
-  // Has to hold mutex_ before being called.
-  bool TryEvict(CacheHandle* value, CleanupContext* context);
-
-  // Scan through the circular list, evict entries until we get enough capacity
-  // for new cache entry of specific size. Return true if success, false
-  // otherwise.
-  //
-  // Has to hold mutex_ before being called.
-  bool EvictFromCache(size_t charge, CleanupContext* context);
-
-  CacheHandle* Insert(const Slice& key, uint32_t hash, void* value,
-                      size_t change,
-                      void (*deleter)(const Slice& key, void* value),
-                      bool hold_reference, CleanupContext* context,
-                      bool* overwritten);
-
-  // Guards list_, head_, and recycle_. In addition, updating table_ also has
-  // to hold the mutex, to avoid the cache being in inconsistent state.
-  mutable port::Mutex mutex_;
-
-  // The circular list of cache handles. Initially the list is empty. Once a
-  // handle is needed by insertion, and no more handles are available in
-  // recycle bin, one more handle is appended to the end.
-  //
-  // We use std::deque for the circular list because we want to make sure
-  // pointers to handles are valid through out the life-cycle of the cache
-  // (in contrast to std::vector), and be able to grow the list (in contrast
-  // to statically allocated arrays).
-  std::deque<CacheHandle> list_;
-
-  // Pointer to the next handle in the circular list to be examine for
-  // eviction.
-  size_t head_;
-
-  // Recycle bin of cache handles.
-  autovector<CacheHandle*> recycle_;
-
-  // Maximum cache size.
-  std::atomic<size_t> capacity_;
-
-  // Current total size of the cache.
-  std::atomic<size_t> usage_;
-
-  // Total un-released cache size.
-  std::atomic<size_t> pinned_usage_;
-
-  // Whether allow insert into cache if cache is full.
-  std::atomic<bool> strict_capacity_limit_;
-
-  // Hash table (tbb::concurrent_hash_map) for lookup.
-  HashTable table_;
-};
-
-ClockCacheShard::ClockCacheShard()
-    : head_(0), usage_(0), pinned_usage_(0), strict_capacity_limit_(false) {}
+// The table is sized for about capacity / estimated_entry_charge entries at
+// kLoadFactor, and takes at most kStrictLoadFactor of its slots, so that
+// probe sequences stay short and an empty slot is always found.
+constexpr double kLoadFactor = 0.7;
+constexpr double kStrictLoadFactor = 0.84;
+constexpr int kMinLengthBits = 4;
+constexpr int kMaxLengthBits = 30;
+
+// Countdowns set on insertion and on hits, by priority. An entry with
+// countdown c is evicted on the (c+1)-th pass of the clock hand without a
+// hit in between.
+constexpr uint8_t kLowPriInsertCountdown = 1;
+constexpr uint8_t kHighPriInsertCountdown = 2;
+constexpr uint8_t kLowPriHitCountdown = 2;
+constexpr uint8_t kHighPriHitCountdown = 3;
+constexpr uint8_t kMaxCountdown = kHighPriHitCountdown;
+
+// Slots the clock hand takes at once, to limit contention on it.
+constexpr uint32_t kClockStep = 4;
+
+int CalcLengthBits(size_t capacity, size_t estimated_entry_charge) {
+  double num_slots =
+      static_cast<double>(capacity / estimated_entry_charge) / kLoadFactor;
+  int length_bits = kMinLengthBits;
+  while (length_bits < kMaxLengthBits &&
+         static_cast<double>(uint64_t{1} << length_bits) < num_slots) {
+    length_bits++;
+  }
+  return length_bits;
+}
+
+}  // namespace
+
+ClockCacheShard::ClockCacheShard(
+    size_t capacity, size_t estimated_entry_charge, bool strict_capacity_limit,
+    CacheMetadataChargePolicy metadata_charge_policy,
+    const std::shared_ptr<SecondaryCache>& secondary_cache,
+    const std::shared_ptr<CacheEvictionListener>& eviction_listener)
+    : length_bits_(CalcLengthBits(capacity, estimated_entry_charge)),
+      length_bits_mask_((uint32_t{1} << length_bits_) - 1),
+      occupancy_limit_(static_cast<uint32_t>((uint64_t{1} << length_bits_) *
+                                             kStrictLoadFactor)),
+      array_(new ClockHandle[size_t{1} << length_bits_]),
+      occupancy_(0),
+      clock_pointer_(0),
+      capacity_(capacity),
+      usage_(0),
+      pinned_usage_(0),
+      strict_capacity_limit_(strict_capacity_limit),
+      insert_tick_(0),
+      secondary_cache_(secondary_cache),
+      eviction_listener_(eviction_listener) {
+  set_metadata_charge_policy(metadata_charge_policy);
+}
 
 ClockCacheShard::~ClockCacheShard() {
-  for (auto& handle : list_) {
-    uint32_t flags = handle.flags.load(std::memory_order_relaxed);
-    if (InCache(flags) || CountRefs(flags) > 0) {
-      if (handle.deleter != nullptr) {
-        (*handle.deleter)(handle.key, handle.value);
-      }
-      delete[] handle.key.data();
+  for (uint32_t i = 0; i <= length_bits_mask_; i++) {
+    ClockHandle* h = &array_[i];
+    uint32_t meta = h->meta.load(std::memory_order_relaxed);
+    if (ClockHandle::GetState(meta) == ClockHandle::kStateVisible ||
+        ClockHandle::GetState(meta) == ClockHandle::kStateInvisible) {
+      assert(ClockHandle::GetRefs(meta) == 0);
+      h->FreeData();
     }
   }
 }
 
-size_t ClockCacheShard::GetUsage() const {
-  return usage_.load(std::memory_order_relaxed);
+size_t ClockCacheShard::CalcTotalCharge(size_t key_length,
+                                        size_t charge) const {
+  if (metadata_charge_policy_ == kFullChargeCacheMetadata) {
+    charge += sizeof(ClockHandle) + key_length;
+  }
+  return charge;
 }
 
-size_t ClockCacheShard::GetPinnedUsage() const {
-  return pinned_usage_.load(std::memory_order_relaxed);
+void ClockCacheShard::ProbeStart(uint32_t hash, uint32_t* index,
+                                 uint32_t* increment) const {
+  // The upper bits of hash are the same for the whole shard, so mix them all
+  // into both the start and the step. An odd step visits every slot of the
+  // power-of-two table.
+  uint64_t h = uint64_t{hash} * 0x9E3779B97F4A7C15U;
+  *index = static_cast<uint32_t>(h >> 32) & length_bits_mask_;
+  *increment = (static_cast<uint32_t>(h) | 1) & length_bits_mask_;
 }
 
-void ClockCacheShard::ApplyToSomeEntries(
-    const std::function<void(const Slice& key, void* value, size_t charge,
-                             DeleterFn deleter)>& callback,
-    uint32_t average_entries_per_lock, uint32_t* state) {
-  assert(average_entries_per_lock > 0);
-  MutexLock lock(&mutex_);
+bool ClockCacheShard::TryRef(ClockHandle* h) {
+  uint32_t meta = h->meta.load(std::memory_order_relaxed);
+  while (ClockHandle::GetState(meta) == ClockHandle::kStateVisible) {
+    // Acquire semantics on success, to read the entry after the reference
+    // is taken.
+    if (h->meta.compare_exchange_weak(meta, meta + ClockHandle::kOneRef,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+      if (ClockHandle::GetRefs(meta) == 0) {
+        pinned_usage_.fetch_add(h->total_charge, std::memory_order_relaxed);
+      }
+      return true;
+    }
+  }
+  return false;
+}
 
-  // Figure out the range to iterate, update `state`
-  size_t list_size = list_.size();
-  size_t start_idx = *state;
-  size_t end_idx = start_idx + average_entries_per_lock;
-  if (start_idx > list_size) {
-    // Shouldn't reach here, but recoverable
-    assert(false);
-    // Mark finished with all
-    *state = UINT32_MAX;
-    return;
+bool ClockCacheShard::Unref(ClockHandle* h, bool erase_if_last_ref) {
+  // Once the reference is dropped, the entry may be freed by another thread.
+  size_t total_charge = h->total_charge;
+  bool detached = h->IsDetached();
+  // Acquire-release semantics, since previous reads of the entry have to be
+  // ordered before the release, and freeing it after.
+  uint32_t meta =
+      h->meta.fetch_sub(ClockHandle::kOneRef, std::memory_order_acq_rel);
+  assert(ClockHandle::GetRefs(meta) > 0);
+  if (ClockHandle::GetRefs(meta) != 1) {
+    return false;
+  }
+  if (!detached) {
+    pinned_usage_.fetch_sub(total_charge, std::memory_order_relaxed);
   }
-  if (end_idx >= list_size || end_idx >= UINT32_MAX) {
-    // This also includes the hypothetical case of >4 billion
-    // cache handles.
-    end_idx = list_size;
-    // Mark finished with all
-    *state = UINT32_MAX;
+  uint32_t state = ClockHandle::GetState(meta);
+  if (state == ClockHandle::kStateVisible && !erase_if_last_ref) {
+    return false;
+  }
+  // Could fail if the entry was referenced again, or if it was erased by
+  // another thread, which is then the one freeing it.
+  if (!h->meta.compare_exchange_strong(state,
+                                       ClockHandle::kStateConstruction,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+    return false;
+  }
+  if (detached) {
+    h->FreeData();
+    delete h;
   } else {
-    *state = static_cast<uint32_t>(end_idx);
-  }
-
-  // Do the iteration
-  auto cur = list_.begin() + start_idx;
-  auto end = list_.begin() + end_idx;
-  for (; cur != end; ++cur) {
-    const CacheHandle& handle = *cur;
-    // Use relaxed semantics instead of acquire semantics since we are
-    // holding mutex
-    uint32_t flags = handle.flags.load(std::memory_order_relaxed);
-    if (InCache(flags)) {
-      callback(handle.key, handle.value, handle.charge, handle.deleter);
-    }
+    FreeSlot(h, /*evicted=*/nullptr);
   }
+  return true;
 }
 
-void ClockCacheShard::RecycleHandle(CacheHandle* handle,
-                                    CleanupContext* context) {
-  mutex_.AssertHeld();
-  assert(!InCache(handle->flags) && CountRefs(handle->flags) == 0);
-  context->to_delete_key.push_back(handle->key.data());
-  context->to_delete_value.emplace_back(*handle);
-  size_t total_charge = handle->GetTotalCharge();
-  // clearing `handle` fields would go here but not strictly required
-  recycle_.push_back(handle);
-  usage_.fetch_sub(total_charge, std::memory_order_relaxed);
+ClockHandle* ClockCacheShard::FindVisible(const Slice& key, uint32_t hash) {
+  uint32_t index;
+  uint32_t increment;
+  ProbeStart(hash, &index, &increment);
+  for (uint32_t probes = 0; probes <= length_bits_mask_; probes++) {
+    ClockHandle* h = &array_[index];
+    if (h->hash.load(std::memory_order_relaxed) == hash && TryRef(h)) {
+      // The slot may have been reused since the hash was read
+      if (h->hash.load(std::memory_order_relaxed) == hash && h->key() == key) {
+        uint8_t countdown =
+            h->IsHighPri() ? kHighPriHitCountdown : kLowPriHitCountdown;
+        if (h->countdown.load(std::memory_order_relaxed) < countdown) {
+          h->countdown.store(countdown, std::memory_order_relaxed);
+        }
+        if (eviction_listener_ != nullptr) {
+          uint32_t hits = h->hit_count.load(std::memory_order_relaxed);
+          if (hits < UINT32_MAX) {
+            h->hit_count.store(hits + 1, std::memory_order_relaxed);
+          }
+        }
+        return h;
+      }
+      Unref(h, /*erase_if_last_ref=*/false);
+    }
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+    index = (index + increment) & length_bits_mask_;
+  }
+  return nullptr;
 }
 
-void ClockCacheShard::Cleanup(const CleanupContext& context) {
-  for (const CacheHandle& handle : context.to_delete_value) {
-    if (handle.deleter) {
-      (*handle.deleter)(handle.key, handle.value);
+uint64_t ClockCacheShard::NewestVisibleTick(const Slice& key, uint32_t hash) {
+  uint64_t newest = 0;
+  uint32_t index;
+  uint32_t increment;
+  ProbeStart(hash, &index, &increment);
+  for (uint32_t probes = 0; probes <= length_bits_mask_; probes++) {
+    ClockHandle* h = &array_[index];
+    if (h->hash.load(std::memory_order_relaxed) == hash && TryRef(h)) {
+      if (h->hash.load(std::memory_order_relaxed) == hash && h->key() == key) {
+        newest = std::max(newest, h->insert_tick);
+      }
+      Unref(h, /*erase_if_last_ref=*/false);
     }
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+    index = (index + increment) & length_bits_mask_;
   }
-  for (const char* key : context.to_delete_key) {
-    delete[] key;
-  }
-}
-
-bool ClockCacheShard::Ref(Cache::Handle* h) {
-  auto handle = reinterpret_cast<CacheHandle*>(h);
-  // CAS loop to increase reference count.
-  uint32_t flags = handle->flags.load(std::memory_order_relaxed);
-  while (InCache(flags)) {
-    // Use acquire semantics on success, as further operations on the cache
-    // entry has to be order after reference count is increased.
-    if (handle->flags.compare_exchange_weak(flags, flags + kOneRef,
-                                            std::memory_order_acquire,
-                                            std::memory_order_relaxed)) {
-      if (CountRefs(flags) == 0) {
-        // No reference count before the operation.
-        size_t total_charge = handle->GetTotalCharge();
-        pinned_usage_.fetch_add(total_charge, std::memory_order_relaxed);
+  return newest;
+}
+
+bool ClockCacheShard::EraseVisible(const Slice& key, uint32_t hash,
+                                   uint64_t before_tick) {
+  bool found = false;
+  uint32_t index;
+  uint32_t increment;
+  ProbeStart(hash, &index, &increment);
+  for (uint32_t probes = 0; probes <= length_bits_mask_; probes++) {
+    ClockHandle* h = &array_[index];
+    if (h->hash.load(std::memory_order_relaxed) == hash && TryRef(h)) {
+      if (h->hash.load(std::memory_order_relaxed) == hash && h->key() == key &&
+          h->insert_tick < before_tick) {
+        uint32_t meta = h->meta.load(std::memory_order_relaxed);
+        while (ClockHandle::GetState(meta) == ClockHandle::kStateVisible &&
+               !h->meta.compare_exchange_weak(
+                   meta,
+                   (meta & ~ClockHandle::kStateMask) |
+                       ClockHandle::kStateInvisible,
+                   std::memory_order_relaxed)) {
+        }
+        found = true;
       }
-      return true;
+      // Frees the entry if ours was the last reference
+      Unref(h, /*erase_if_last_ref=*/false);
+    }
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
     }
+    index = (index + increment) & length_bits_mask_;
   }
-  return false;
+  return found;
 }
 
-bool ClockCacheShard::Unref(CacheHandle* handle, bool set_usage,
-                            CleanupContext* context) {
-  if (set_usage) {
-    handle->flags.fetch_or(kUsageBit, std::memory_order_relaxed);
+void ClockCacheShard::RollBackDisplacements(uint32_t hash, uint32_t end_index,
+                                            uint32_t num_probes) {
+  uint32_t index;
+  uint32_t increment;
+  ProbeStart(hash, &index, &increment);
+  for (uint32_t probes = 0; probes < num_probes && index != end_index;
+       probes++) {
+    array_[index].displacements.fetch_sub(1, std::memory_order_relaxed);
+    index = (index + increment) & length_bits_mask_;
   }
-  // If the handle reaches state refs=0 and InCache=true after this
-  // atomic operation then we cannot access `handle` afterward, because
-  // it could be evicted before we access the `handle`.
-  size_t total_charge = handle->GetTotalCharge();
+}
 
-  // Use acquire-release semantics as previous operations on the cache entry
-  // has to be order before reference count is decreased, and potential cleanup
-  // of the entry has to be order after.
-  uint32_t flags = handle->flags.fetch_sub(kOneRef, std::memory_order_acq_rel);
-  assert(CountRefs(flags) > 0);
-  if (CountRefs(flags) == 1) {
-    // this is the last reference.
-    pinned_usage_.fetch_sub(total_charge, std::memory_order_relaxed);
-    // Cleanup if it is the last reference.
-    if (!InCache(flags)) {
-      MutexLock l(&mutex_);
-      RecycleHandle(handle, context);
+void ClockCacheShard::FreeSlot(ClockHandle* h, EvictedEntries* evicted) {
+  assert(ClockHandle::GetState(h->meta.load(std::memory_order_relaxed)) ==
+         ClockHandle::kStateConstruction);
+  uint32_t index = static_cast<uint32_t>(h - array_.get());
+  RollBackDisplacements(h->hash.load(std::memory_order_relaxed), index,
+                        length_bits_mask_ + 1);
+  if (evicted != nullptr) {
+    evicted->push_back(
+        {h->key_data, h->key_length, h->value, h->GetDeleter(),
+         h->IsSecondaryCacheCompatible() ? h->info_.helper : nullptr,
+         h->charge, h->hit_count.load(std::memory_order_relaxed),
+         h->insert_tick, h->flags});
+    h->key_data = nullptr;
+    h->value = nullptr;
+  } else {
+    h->FreeData();
+  }
+  usage_.fetch_sub(h->total_charge, std::memory_order_relaxed);
+  h->meta.store(ClockHandle::kStateEmpty, std::memory_order_release);
+  occupancy_.fetch_sub(1, std::memory_order_release);
+}
+
+void ClockCacheShard::FinishEviction(EvictedEntries* evicted) {
+  if (evicted->empty()) {
+    return;
+  }
+  if (eviction_listener_ != nullptr) {
+    uint64_t insert_tick = insert_tick_.load(std::memory_order_relaxed);
+    std::vector<CacheEvictionInfo> infos(evicted->size());
+    for (size_t i = 0; i < evicted->size(); i++) {
+      const EvictedEntry& e = (*evicted)[i];
+      CacheEvictionInfo& info = infos[i];
+      info.key = Slice(e.key_data, e.key_length);
+      info.value = e.value;
+      info.charge = e.charge;
+      info.deleter = e.deleter;
+      info.hit_count = e.hit_count;
+      info.residency = static_cast<uint32_t>(insert_tick - e.insert_tick);
+      info.high_priority = (e.flags & ClockHandle::IS_HIGH_PRI) != 0;
     }
+    eviction_listener_->OnEvict(infos.data(), infos.size());
+  }
+  for (const EvictedEntry& e : *evicted) {
+    Slice key(e.key_data, e.key_length);
+    if (secondary_cache_ && e.helper != nullptr &&
+        !(e.flags & ClockHandle::IS_PROMOTED)) {
+      secondary_cache_->Insert(key, e.value, e.helper).PermitUncheckedError();
+    }
+    if (e.deleter != nullptr) {
+      (*e.deleter)(key, e.value);
+    }
+    delete[] e.key_data;
+  }
+  evicted->clear();
+}
+
+bool ClockCacheShard::TryEvict(ClockHandle* h, EvictedEntries* evicted) {
+  // Visible with no reference
+  uint32_t meta = ClockHandle::kStateVisible;
+  if (h->meta.load(std::memory_order_relaxed) != meta) {
+    return false;
   }
-  return context->to_delete_value.size();
-}
-
-bool ClockCacheShard::UnsetInCache(CacheHandle* handle,
-                                   CleanupContext* context) {
-  mutex_.AssertHeld();
-  // Use acquire-release semantics as previous operations on the cache entry
-  // has to be order before reference count is decreased, and potential cleanup
-  // of the entry has to be order after.
-  uint32_t flags =
-      handle->flags.fetch_and(~kInCacheBit, std::memory_order_acq_rel);
-  // Cleanup if it is the last reference.
-  if (InCache(flags) && CountRefs(flags) == 0) {
-    RecycleHandle(handle, context);
-  }
-  return context->to_delete_value.size();
-}
-
-bool ClockCacheShard::TryEvict(CacheHandle* handle, CleanupContext* context) {
-  mutex_.AssertHeld();
-  uint32_t flags = kInCacheBit;
-  if (handle->flags.compare_exchange_strong(flags, 0, std::memory_order_acquire,
-                                            std::memory_order_relaxed)) {
-    bool erased __attribute__((__unused__)) =
-        table_.erase(ClockCacheKey(handle->key, handle->hash));
-    assert(erased);
-    RecycleHandle(handle, context);
+  uint8_t countdown = h->countdown.load(std::memory_order_relaxed);
+  if (countdown > 0) {
+    // Racing hits may be lost, which only makes the entry age faster.
+    h->countdown.store(countdown - 1, std::memory_order_relaxed);
     return true;
   }
-  handle->flags.fetch_and(~kUsageBit, std::memory_order_relaxed);
-  return false;
+  if (h->meta.compare_exchange_strong(meta, ClockHandle::kStateConstruction,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+    FreeSlot(h, evicted);
+  }
+  return true;
 }
 
-bool ClockCacheShard::EvictFromCache(size_t charge, CleanupContext* context) {
-  size_t usage = usage_.load(std::memory_order_relaxed);
-  size_t capacity = capacity_.load(std::memory_order_relaxed);
-  if (usage == 0) {
-    return charge <= capacity;
-  }
-  size_t new_head = head_;
-  bool second_iteration = false;
-  while (usage + charge > capacity) {
-    assert(new_head < list_.size());
-    if (TryEvict(&list_[new_head], context)) {
-      usage = usage_.load(std::memory_order_relaxed);
+template <typename Done>
+bool ClockCacheShard::EvictUntil(Done done, EvictedEntries* evicted) {
+  const size_t length = size_t{length_bits_mask_} + 1;
+  // Enough passes to run out every countdown and evict the entry
+  const size_t max_visits = (size_t{kMaxCountdown} + 2) * length;
+  // Visits since the last unreferenced entry was seen. A whole pass over
+  // referenced entries means there is nothing to evict.
+  size_t fruitless_visits = 0;
+  for (size_t visits = 0; !done(); visits += kClockStep) {
+    if (visits >= max_visits || fruitless_visits >= length) {
+      return false;
     }
-    new_head = (new_head + 1 >= list_.size()) ? 0 : new_head + 1;
-    if (new_head == head_) {
-      if (second_iteration) {
-        return false;
+    size_t start =
+        clock_pointer_.fetch_add(kClockStep, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < kClockStep; i++) {
+      if (i > 0 && done()) {
+        // Hands the rest of the step back to the next eviction, unless the
+        // hand moved on meanwhile, so that no more is evicted than needed
+        // and every slot gets its turn
+        size_t end = start + kClockStep;
+        clock_pointer_.compare_exchange_strong(end, start + i,
+                                               std::memory_order_relaxed);
+        break;
+      }
+      if (TryEvict(&array_[(start + i) & length_bits_mask_], evicted)) {
+        fruitless_visits = 0;
       } else {
-        second_iteration = true;
+        fruitless_visits++;
       }
     }
   }
-  head_ = new_head;
   return true;
 }
 
-void ClockCacheShard::SetCapacity(size_t capacity) {
-  CleanupContext context;
-  {
-    MutexLock l(&mutex_);
-    capacity_.store(capacity, std::memory_order_relaxed);
-    EvictFromCache(0, &context);
+bool ClockCacheShard::ChargeUsage(size_t total_charge,
+                                  bool allow_over_capacity,
+                                  EvictedEntries* evicted) {
+  size_t usage = usage_.load(std::memory_order_relaxed);
+  for (;;) {
+    size_t capacity = capacity_.load(std::memory_order_relaxed);
+    if (usage + total_charge <= capacity) {
+      if (usage_.compare_exchange_weak(usage, usage + total_charge,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+      continue;
+    }
+    // Quick way out when every entry is referenced
+    bool fits = pinned_usage_.load(std::memory_order_relaxed) <
+                    usage_.load(std::memory_order_relaxed) &&
+                EvictUntil(
+                    [&]() {
+                      return usage_.load(std::memory_order_relaxed) +
+                                 total_charge <=
+                             capacity_.load(std::memory_order_relaxed);
+                    },
+                    evicted);
+    if (!fits) {
+      if (!allow_over_capacity) {
+        return false;
+      }
+      usage_.fetch_add(total_charge, std::memory_order_relaxed);
+      return true;
+    }
+    usage = usage_.load(std::memory_order_relaxed);
   }
-  Cleanup(context);
 }
 
-void ClockCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
-  strict_capacity_limit_.store(strict_capacity_limit,
-                               std::memory_order_relaxed);
+ClockHandle* ClockCacheShard::ReserveSlot(uint32_t hash,
+                                          EvictedEntries* evicted) {
+  if (occupancy_.fetch_add(1, std::memory_order_acquire) >= occupancy_limit_) {
+    bool reserved = EvictUntil(
+        [&]() {
+          return occupancy_.load(std::memory_order_acquire) <=
+                 occupancy_limit_;
+        },
+        evicted);
+    if (!reserved) {
+      occupancy_.fetch_sub(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  uint32_t index;
+  uint32_t increment;
+  ProbeStart(hash, &index, &increment);
+  for (uint32_t probes = 0; probes <= length_bits_mask_; probes++) {
+    ClockHandle* h = &array_[index];
+    uint32_t meta = ClockHandle::kStateEmpty;
+    if (h->meta.load(std::memory_order_relaxed) == meta &&
+        h->meta.compare_exchange_strong(meta, ClockHandle::kStateConstruction,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      return h;
+    }
+    h->displacements.fetch_add(1, std::memory_order_relaxed);
+    index = (index + increment) & length_bits_mask_;
+  }
+  // Only possible when slots are freed and taken again while we probe
+  RollBackDisplacements(hash, /*end_index=*/length_bits_mask_ + 1,
+                        length_bits_mask_ + 1);
+  occupancy_.fetch_sub(1, std::memory_order_relaxed);
+  return nullptr;
 }
 
-CacheHandle* ClockCacheShard::Insert(
+ClockHandle* ClockCacheShard::NewDetachedHandle(
     const Slice& key, uint32_t hash, void* value, size_t charge,
-    void (*deleter)(const Slice& key, void* value), bool hold_reference,
-    CleanupContext* context, bool* overwritten) {
-  assert(overwritten != nullptr && *overwritten == false);
-  uint32_t meta_charge =
-      CacheHandle::CalcMetadataCharge(key, metadata_charge_policy_);
-  size_t total_charge = charge + meta_charge;
-  MutexLock l(&mutex_);
-  bool success = EvictFromCache(total_charge, context);
+    DeleterFn deleter, const Cache::CacheItemHelper* helper,
+    Cache::Priority priority, bool promoted) {
+  ClockHandle* h = new ClockHandle;
+  h->value = value;
+  h->flags = ClockHandle::IS_DETACHED;
+  if (helper) {
+    h->flags |= ClockHandle::IS_SECONDARY_CACHE_COMPATIBLE;
+    h->info_.helper = helper;
+  } else {
+    h->info_.deleter = deleter;
+  }
+  if (priority == Cache::Priority::HIGH) {
+    h->flags |= ClockHandle::IS_HIGH_PRI;
+  }
+  if (promoted) {
+    h->flags |= ClockHandle::IS_PROMOTED;
+  }
+  h->key_data = new char[key.size()];
+  memcpy(h->key_data, key.data(), key.size());
+  h->key_length = key.size();
+  h->charge = charge;
+  h->total_charge = CalcTotalCharge(key.size(), charge);
+  h->hash.store(hash, std::memory_order_relaxed);
+  h->meta.store(ClockHandle::kStateInvisible | ClockHandle::kOneRef,
+                std::memory_order_relaxed);
+  return h;
+}
+
+Status ClockCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
+                               size_t charge, DeleterFn deleter,
+                               const Cache::CacheItemHelper* helper,
+                               Cache::Handle** handle,
+                               Cache::Priority priority, bool promoted) {
+  size_t total_charge = CalcTotalCharge(key.size(), charge);
   bool strict = strict_capacity_limit_.load(std::memory_order_relaxed);
-  if (!success && (strict || !hold_reference)) {
-    context->to_delete_key.push_back(key.data());
-    if (!hold_reference) {
-      context->to_delete_value.emplace_back(key, value, deleter);
+  // Without a handle, an entry that does not fit is as if inserted and
+  // evicted right away.
+  EvictedEntries evicted;
+  bool charged = ChargeUsage(total_charge,
+                             /*allow_over_capacity=*/!strict &&
+                                 handle != nullptr,
+                             &evicted);
+  ClockHandle* h = charged ? ReserveSlot(hash, &evicted) : nullptr;
+  // Out of the clock hand's loop, and while h (if any) is still invisible
+  FinishEviction(&evicted);
+  if (h == nullptr) {
+    if (charged) {
+      usage_.fetch_sub(total_charge, std::memory_order_relaxed);
+      if (handle != nullptr && !strict) {
+        // The table is full of referenced entries
+        *handle = reinterpret_cast<Cache::Handle*>(
+            NewDetachedHandle(key, hash, value, charge, deleter, helper,
+                              priority, promoted));
+        return Status::OK();
+      }
     }
-    return nullptr;
+    if (handle == nullptr) {
+      DeleterFn del = helper ? helper->del_cb : deleter;
+      if (del != nullptr) {
+        (*del)(key, value);
+      }
+      return Status::OK();
+    }
+    *handle = nullptr;
+    return Status::Incomplete("Insert failed due to CLOCK cache being full.");
   }
-  // Grab available handle from recycle bin. If recycle bin is empty, create
-  // and append new handle to end of circular list.
-  CacheHandle* handle = nullptr;
-  if (!recycle_.empty()) {
-    handle = recycle_.back();
-    recycle_.pop_back();
+
+  // The slot is ours until it is made visible
+  h->value = value;
+  h->flags = 0;
+  if (helper) {
+    h->flags |= ClockHandle::IS_SECONDARY_CACHE_COMPATIBLE;
+    h->info_.helper = helper;
   } else {
-    list_.emplace_back();
-    handle = &list_.back();
-  }
-  // Fill handle.
-  handle->key = key;
-  handle->hash = hash;
-  handle->value = value;
-  handle->charge = charge;
-  handle->meta_charge = meta_charge;
-  handle->deleter = deleter;
-  uint32_t flags = hold_reference ? kInCacheBit + kOneRef : kInCacheBit;
-
-  // TODO investigate+fix suspected race condition:
-  // [thread 1] Lookup starts, up to Ref()
-  // [thread 2] Erase/evict the entry just looked up
-  // [thread 1] Ref() the handle, even though it's in the recycle bin
-  // [thread 2] Insert with recycling that handle
-  // Here we obliterate the other thread's Ref
-  // Possible fix: never blindly overwrite the flags, but only make
-  // relative updates (fetch_add, etc).
-  handle->flags.store(flags, std::memory_order_relaxed);
-  HashTable::accessor accessor;
-  if (table_.find(accessor, ClockCacheKey(key, hash))) {
-    *overwritten = true;
-    CacheHandle* existing_handle = accessor->second;
-    table_.erase(accessor);
-    UnsetInCache(existing_handle, context);
-  }
-  table_.insert(HashTable::value_type(ClockCacheKey(key, hash), handle));
-  if (hold_reference) {
+    h->info_.deleter = deleter;
+  }
+  if (priority == Cache::Priority::HIGH) {
+    h->flags |= ClockHandle::IS_HIGH_PRI;
+  }
+  if (promoted) {
+    h->flags |= ClockHandle::IS_PROMOTED;
+  }
+  h->key_data = new char[key.size()];
+  memcpy(h->key_data, key.data(), key.size());
+  h->key_length = key.size();
+  h->charge = charge;
+  h->total_charge = total_charge;
+  h->hash.store(hash, std::memory_order_relaxed);
+  h->countdown.store(priority == Cache::Priority::HIGH
+                         ? kHighPriInsertCountdown
+                         : kLowPriInsertCountdown,
+                     std::memory_order_relaxed);
+  h->insert_tick = insert_tick_.fetch_add(1, std::memory_order_relaxed);
+  if (eviction_listener_ != nullptr) {
+    h->hit_count.store(0, std::memory_order_relaxed);
+  }
+  if (handle != nullptr) {
     pinned_usage_.fetch_add(total_charge, std::memory_order_relaxed);
+    *handle = reinterpret_cast<Cache::Handle*>(h);
   }
-  usage_.fetch_add(total_charge, std::memory_order_relaxed);
-  return handle;
+  h->meta.store(ClockHandle::kStateVisible |
+                    (handle != nullptr ? ClockHandle::kOneRef : 0),
+                std::memory_order_release);
+
+  TEST_SYNC_POINT("ClockCacheShard::Insert:Visible");
+  // Replace the previous entry of the key, if any. Of entries of the key
+  // inserted concurrently, which all end up here once visible, only the
+  // newest is kept: the last of them to become visible sees all that are
+  // still visible. Our entry may be freed from here on, unless referenced.
+  if (EraseVisible(key, hash, NewestVisibleTick(key, hash))) {
+    return Status::OkOverwritten();
+  }
+  return Status::OK();
 }
 
-Status ClockCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
-                               size_t charge,
-                               void (*deleter)(const Slice& key, void* value),
-                               Cache::Handle** out_handle,
-                               Cache::Priority /*priority*/) {
-  CleanupContext context;
-  HashTable::accessor accessor;
-  char* key_data = new char[key.size()];
-  memcpy(key_data, key.data(), key.size());
-  Slice key_copy(key_data, key.size());
-  bool overwritten = false;
-  CacheHandle* handle = Insert(key_copy, hash, value, charge, deleter,
-                               out_handle != nullptr, &context, &overwritten);
-  Status s;
-  if (out_handle != nullptr) {
-    if (handle == nullptr) {
-      s = Status::Incomplete("Insert failed due to CLOCK cache being full.");
-    } else {
-      *out_handle = reinterpret_cast<Cache::Handle*>(handle);
+void ClockCacheShard::MultiLookup(const Slice* keys, const uint32_t* hashes,
+                                  const size_t* indices, size_t count,
+                                  const Cache::CacheItemHelper* helper,
+                                  const Cache::CreateCallback& create_cb,
+                                  Cache::Priority priority, bool /*wait*/,
+                                  Statistics* stats, Cache::Handle** handles) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t index;
+    uint32_t increment;
+    ProbeStart(hashes[indices[i]], &index, &increment);
+    PREFETCH(&array_[index], 0 /* rw */, 3 /* locality */);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    size_t idx = indices[i];
+    handles[idx] =
+        reinterpret_cast<Cache::Handle*>(FindVisible(keys[idx], hashes[idx]));
+    if (handles[idx] == nullptr) {
+      handles[idx] = LookupSecondary(keys[idx], hashes[idx], helper, create_cb,
+                                     priority, stats);
     }
   }
-  if (overwritten) {
-    assert(s.ok());
-    s = Status::OkOverwritten();
+}
+
+Cache::Handle* ClockCacheShard::Lookup(
+    const Slice& key, uint32_t hash,
+    const ShardedCache::CacheItemHelper* helper,
+    const ShardedCache::CreateCallback& create_cb, Cache::Priority priority,
+    bool /*wait*/, Statistics* stats) {
+  ClockHandle* h = FindVisible(key, hash);
+  if (h != nullptr) {
+    return reinterpret_cast<Cache::Handle*>(h);
   }
-  Cleanup(context);
-  return s;
+  return LookupSecondary(key, hash, helper, create_cb, priority, stats);
 }
 
-Cache::Handle* ClockCacheShard::Lookup(const Slice& key, uint32_t hash) {
-  HashTable::const_accessor accessor;
-  if (!table_.find(accessor, ClockCacheKey(key, hash))) {
+Cache::Handle* ClockCacheShard::LookupSecondary(
+    const Slice& key, uint32_t hash,
+    const ShardedCache::CacheItemHelper* helper,
+    const ShardedCache::CreateCallback& create_cb, Cache::Priority priority,
+    Statistics* stats) {
+  if (!secondary_cache_ || !helper || !helper->saveto_cb) {
     return nullptr;
   }
-  CacheHandle* handle = accessor->second;
-  accessor.release();
-  // Ref() could fail if another thread sneak in and evict/erase the cache
-  // entry before we are able to hold reference.
-  if (!Ref(reinterpret_cast<Cache::Handle*>(handle))) {
+  // For objects from the secondary cache, we expect the caller to provide
+  // a way to create/delete the primary cache object.
+  assert(create_cb && helper->del_cb);
+  std::unique_ptr<SecondaryCacheResultHandle> secondary_handle =
+      secondary_cache_->Lookup(key, create_cb, /*wait=*/true);
+  if (secondary_handle == nullptr) {
     return nullptr;
   }
-  // Double check the key since the handle may now representing another key
-  // if other threads sneak in, evict/erase the entry and re-used the handle
-  // for another cache entry.
-  if (hash != handle->hash || key != handle->key) {
-    CleanupContext context;
-    Unref(handle, false, &context);
-    // It is possible Unref() delete the entry, so we need to cleanup.
-    Cleanup(context);
+  secondary_handle->Wait();
+  void* value = secondary_handle->Value();
+  if (value == nullptr) {
     return nullptr;
   }
-  return reinterpret_cast<Cache::Handle*>(handle);
+  size_t charge = secondary_handle->Size();
+  Cache::Handle* handle = nullptr;
+  Status s = Insert(key, hash, value, charge, nullptr, helper, &handle,
+                    priority, /*promoted=*/true);
+  if (!s.ok()) {
+    // The value is in memory, but the cache is full. Hand it out without
+    // charging the cache, to be freed on release.
+    assert(s.IsIncomplete());
+    handle = reinterpret_cast<Cache::Handle*>(NewDetachedHandle(
+        key, hash, value, charge, nullptr, helper, priority,
+        /*promoted=*/true));
+  }
+  PERF_COUNTER_ADD(secondary_cache_hit_count, 1);
+  RecordTick(stats, SECONDARY_CACHE_HITS);
+  return handle;
 }
 
-bool ClockCacheShard::Release(Cache::Handle* h, bool force_erase) {
-  CleanupContext context;
-  CacheHandle* handle = reinterpret_cast<CacheHandle*>(h);
-  bool erased = Unref(handle, true, &context);
-  if (force_erase && !erased) {
-    erased = EraseAndConfirm(handle->key, handle->hash, &context);
+bool ClockCacheShard::Ref(Cache::Handle* handle) {
+  ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+  // To create another reference - entry must be already externally referenced
+  assert(ClockHandle::GetRefs(h->meta.load(std::memory_order_relaxed)) > 0);
+  h->meta.fetch_add(ClockHandle::kOneRef, std::memory_order_relaxed);
+  return true;
+}
+
+bool ClockCacheShard::Release(Cache::Handle* handle, bool force_erase) {
+  if (handle == nullptr) {
+    return false;
   }
-  Cleanup(context);
-  return erased;
+  ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+  // Like LRUCache, drop the entry when the cache is over capacity
+  bool erase_if_last_ref =
+      force_erase || usage_.load(std::memory_order_relaxed) >
+                         capacity_.load(std::memory_order_relaxed);
+  return Unref(h, erase_if_last_ref);
 }
 
 void ClockCacheShard::Erase(const Slice& key, uint32_t hash) {
-  CleanupContext context;
-  EraseAndConfirm(key, hash, &context);
-  Cleanup(context);
+  EraseVisible(key, hash, /*before_tick=*/port::kMaxUint64);
 }
 
-bool ClockCacheShard::EraseAndConfirm(const Slice& key, uint32_t hash,
-                                      CleanupContext* context) {
-  MutexLock l(&mutex_);
-  HashTable::accessor accessor;
-  bool erased = false;
-  if (table_.find(accessor, ClockCacheKey(key, hash))) {
-    CacheHandle* handle = accessor->second;
-    table_.erase(accessor);
-    erased = UnsetInCache(handle, context);
-  }
-  return erased;
+void ClockCacheShard::SetCapacity(size_t capacity) {
+  capacity_.store(capacity, std::memory_order_relaxed);
+  EvictedEntries evicted;
+  EvictUntil(
+      [&]() {
+        return usage_.load(std::memory_order_relaxed) <=
+               capacity_.load(std::memory_order_relaxed);
+      },
+      &evicted);
+  FinishEviction(&evicted);
 }
 
-void ClockCacheShard::EraseUnRefEntries() {
-  CleanupContext context;
-  {
-    MutexLock l(&mutex_);
-    table_.clear();
-    for (auto& handle : list_) {
-      UnsetInCache(&handle, &context);
-    }
-  }
-  Cleanup(context);
+void ClockCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
+  strict_capacity_limit_.store(strict_capacity_limit,
+                               std::memory_order_relaxed);
 }
 
-class ClockCache final : public ShardedCache {
- public:
-  ClockCache(size_t capacity, int num_shard_bits, bool strict_capacity_limit,
-             CacheMetadataChargePolicy metadata_charge_policy)
-      : ShardedCache(capacity, num_shard_bits, strict_capacity_limit) {
-    int num_shards = 1 << num_shard_bits;
-    shards_ = new ClockCacheShard[num_shards];
-    for (int i = 0; i < num_shards; i++) {
-      shards_[i].set_metadata_charge_policy(metadata_charge_policy);
-    }
-    SetCapacity(capacity);
-    SetStrictCapacityLimit(strict_capacity_limit);
-  }
-
-  ~ClockCache() override { delete[] shards_; }
+size_t ClockCacheShard::GetUsage() const {
+  return usage_.load(std::memory_order_relaxed);
+}
 
-  const char* Name() const override { return "ClockCache"; }
+size_t ClockCacheShard::GetPinnedUsage() const {
+  return pinned_usage_.load(std::memory_order_relaxed);
+}
 
-  CacheShard* GetShard(uint32_t shard) override {
-    return reinterpret_cast<CacheShard*>(&shards_[shard]);
+void ClockCacheShard::ApplyToSomeEntries(
+    const std::function<void(const Slice& key, void* value, size_t charge,
+                             DeleterFn deleter)>& callback,
+    uint32_t average_entries_per_lock, uint32_t* state) {
+  assert(average_entries_per_lock > 0);
+  // The table never moves, so `state` is a slot index
+  uint32_t length = length_bits_mask_ + 1;
+  uint32_t index_begin = *state;
+  uint32_t index_end = index_begin + average_entries_per_lock;
+  if (index_begin > length) {
+    // Shouldn't reach here, but recoverable
+    assert(false);
+    // Mark finished with all
+    *state = UINT32_MAX;
+    return;
   }
-
-  const CacheShard* GetShard(uint32_t shard) const override {
-    return reinterpret_cast<CacheShard*>(&shards_[shard]);
+  if (index_end >= length || index_end < index_begin) {
+    index_end = length;
+    // Mark finished with all
+    *state = UINT32_MAX;
+  } else {
+    *state = index_end;
   }
-
-  void* Value(Handle* handle) override {
-    return reinterpret_cast<const CacheHandle*>(handle)->value;
+  for (uint32_t i = index_begin; i < index_end; i++) {
+    ClockHandle* h = &array_[i];
+    if (TryRef(h)) {
+      callback(h->key(), h->value, h->charge, h->GetDeleter());
+      Unref(h, /*erase_if_last_ref=*/false);
+    }
   }
+}
 
-  size_t GetCharge(Handle* handle) const override {
-    return reinterpret_cast<const CacheHandle*>(handle)->charge;
+void ClockCacheShard::EraseUnRefEntries() {
+  for (uint32_t i = 0; i <= length_bits_mask_; i++) {
+    ClockHandle* h = &array_[i];
+    uint32_t meta = ClockHandle::kStateVisible;
+    if (h->meta.compare_exchange_strong(meta, ClockHandle::kStateConstruction,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      FreeSlot(h, /*evicted=*/nullptr);
+    }
   }
+}
 
-  uint32_t GetHash(Handle* handle) const override {
-    return reinterpret_cast<const CacheHandle*>(handle)->hash;
-  }
+std::string ClockCacheShard::GetPrintableOptions() const {
+  const int kBufferSize = 200;
+  char buffer[kBufferSize];
+  snprintf(buffer, kBufferSize,
+           "    table_size: %" PRIu32 "\n    occupancy_limit: %" PRIu32 "\n",
+           length_bits_mask_ + 1, occupancy_limit_);
+  return std::string(buffer);
+}
 
-  DeleterFn GetDeleter(Handle* handle) const override {
-    return reinterpret_cast<const CacheHandle*>(handle)->deleter;
+ClockCache::ClockCache(size_t capacity, int num_shard_bits,
+                       bool strict_capacity_limit,
+                       CacheMetadataChargePolicy metadata_charge_policy,
+                       size_t estimated_entry_charge,
+                       const std::shared_ptr<SecondaryCache>& secondary_cache,
+                       const std::shared_ptr<CacheEvictionListener>&
+                           eviction_listener)
+    : ShardedCache(capacity, num_shard_bits, strict_capacity_limit) {
+  num_shards_ = 1 << num_shard_bits;
+  shards_ = reinterpret_cast<ClockCacheShard*>(
+      port::cacheline_aligned_alloc(sizeof(ClockCacheShard) * num_shards_));
+  size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
+  for (int i = 0; i < num_shards_; i++) {
+    new (&shards_[i])
+        ClockCacheShard(per_shard, estimated_entry_charge,
+                        strict_capacity_limit, metadata_charge_policy,
+                        secondary_cache, eviction_listener);
   }
+}
 
-  void DisownData() override {
-    // Leak data only if that won't generate an ASAN/valgrind warning
-    if (!kMustFreeHeapAllocations) {
-      shards_ = nullptr;
+ClockCache::~ClockCache() {
+  if (shards_ != nullptr) {
+    assert(num_shards_ > 0);
+    for (int i = 0; i < num_shards_; i++) {
+      shards_[i].~ClockCacheShard();
     }
+    port::cacheline_aligned_free(shards_);
   }
+}
+
+CacheShard* ClockCache::GetShard(uint32_t shard) {
+  return reinterpret_cast<CacheShard*>(&shards_[shard]);
+}
+
+const CacheShard* ClockCache::GetShard(uint32_t shard) const {
+  return reinterpret_cast<CacheShard*>(&shards_[shard]);
+}
+
+void* ClockCache::Value(Handle* handle) {
+  return reinterpret_cast<const ClockHandle*>(handle)->value;
+}
+
+size_t ClockCache::GetCharge(Handle* handle) const {
+  return reinterpret_cast<const ClockHandle*>(handle)->charge;
+}
 
-  void WaitAll(std::vector<Handle*>& /*handles*/) override {}
+uint32_t ClockCache::GetHash(Handle* handle) const {
+  return reinterpret_cast<const ClockHandle*>(handle)->hash.load(
+      std::memory_order_relaxed);
+}
 
- private:
-  ClockCacheShard* shards_;
-};
+Cache::DeleterFn ClockCache::GetDeleter(Handle* handle) const {
+  return reinterpret_cast<const ClockHandle*>(handle)->GetDeleter();
+}
 
-}  // end anonymous namespace
+void ClockCache::DisownData() {
+  // Leak data only if that won't generate an ASAN/valgrind warning
+  if (!kMustFreeHeapAllocations) {
+    shards_ = nullptr;
+    num_shards_ = 0;
+  }
+}
 
 std::shared_ptr<Cache> NewClockCache(
     size_t capacity, int num_shard_bits, bool strict_capacity_limit,
     CacheMetadataChargePolicy metadata_charge_policy) {
+  return NewClockCache(ClockCacheOptions(capacity, num_shard_bits,
+                                         strict_capacity_limit,
+                                         metadata_charge_policy));
+}
+
+std::shared_ptr<Cache> NewClockCache(const ClockCacheOptions& cache_opts) {
+  if (cache_opts.num_shard_bits >= 20) {
+    return nullptr;  // the cache cannot be sharded into too many fine pieces
+  }
+  if (cache_opts.estimated_entry_charge == 0) {
+    return nullptr;
+  }
+  int num_shard_bits = cache_opts.num_shard_bits;
   if (num_shard_bits < 0) {
-    num_shard_bits = GetDefaultCacheShardBits(capacity);
+    num_shard_bits = GetDefaultCacheShardBits(cache_opts.capacity);
   }
   return std::make_shared<ClockCache>(
-      capacity, num_shard_bits, strict_capacity_limit, metadata_charge_policy);
+      cache_opts.capacity, num_shard_bits, cache_opts.strict_capacity_limit,
+      cache_opts.metadata_charge_policy, cache_opts.estimated_entry_charge,
+      cache_opts.secondary_cache, cache_opts.eviction_listener);
 }
 
 }  // namespace ROCKSDB_NAMESPACE
-
-#endif  // SUPPORT_CLOCK_CACHE
@@ -9,8 +9,350 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "cache/sharded_cache.h"
+#include "port/lang.h"
+#include "port/port.h"
 #include "rocksdb/cache.h"
+#include "rocksdb/secondary_cache.h"
+#include "util/autovector.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// CLOCK cache implementation, lock-free on every operation.
+//
+// Each shard keeps its entries in a fixed-size, open-addressed table of
+// ClockHandles, probed by double hashing. A handle is one slot of the table
+// and is in one of these states, stored with its reference count in a single
+// atomic word (`meta`):
+// 1. Empty: the slot holds no entry.
+// 2. Construction: one thread owns the slot exclusively, to fill it with a
+//    new entry or to free the entry it holds.
+// 3. Visible: the entry can be looked up. It is evicted by the clock hand
+//    when it is not referenced and its countdown has run out.
+// 4. Invisible: the entry was erased or replaced while referenced. It is
+//    freed by the release of its last reference.
+//
+// A reference can only be taken on a visible entry, with a compare-and-swap
+// that fails in any other state; so a referenced entry is never freed, and
+// its fields can be read without further synchronization.
+//
+// Probing for a key stops at the first slot that no other entry passed over
+// while probing for an empty slot on insertion; each slot counts those
+// entries in `displacements`. Freeing an entry undoes the counts along its
+// probe sequence.
+//
+// Instead of a usage bit, every entry has a small countdown: the number of
+// times the clock hand can pass over it before evicting it. Insertions and
+// hits set the countdown according to the priority, so high priority
+// entries survive more sweeps than low priority ones.
+//
+// Entries that cannot be placed in the table (it is full of referenced
+// entries, or a promoted secondary cache entry does not fit) are handed out
+// "detached": allocated on their own, invisible, not charged to the cache,
+// and freed on release, like an entry inserted and erased right away.
+struct ClockHandle {
+  void* value = nullptr;
+  union Info {
+    Info() {}
+    ~Info() {}
+    Cache::DeleterFn deleter;
+    const ShardedCache::CacheItemHelper* helper;
+  } info_;
+  char* key_data = nullptr;
+  size_t key_length = 0;
+  size_t charge = 0;
+  // charge plus the metadata charged under the metadata charge policy
+  size_t total_charge = 0;
+  // Order of the insertion in the shard, so that of two entries of the same
+  // key inserted concurrently, the later one is kept
+  uint64_t insert_tick = 0;
+  // Read by probes that do not hold a reference, and verified once they do.
+  std::atomic<uint32_t> hash{0};
+  // State in the lowest kStateBits, reference count above.
+  std::atomic<uint32_t> meta{0};
+  // Number of entries whose probe sequence passed over this slot. Belongs
+  // to the slot, not to the entry in it.
+  std::atomic<uint32_t> displacements{0};
+  // Remaining passes of the clock hand before eviction.
+  std::atomic<uint8_t> countdown{0};
+  // Only maintained with an eviction listener. Racing hits may be lost.
+  std::atomic<uint32_t> hit_count{0};
+
+  enum Flags : uint8_t {
+    // Whether this entry is high priority entry.
+    IS_HIGH_PRI = (1 << 0),
+    // Can this be inserted into the secondary cache
+    IS_SECONDARY_CACHE_COMPATIBLE = (1 << 1),
+    // Has the item been promoted from a lower tier
+    IS_PROMOTED = (1 << 2),
+    // Allocated outside the table (see above)
+    IS_DETACHED = (1 << 3),
+  };
+
+  // Written only in the construction state
+  uint8_t flags = 0;
+
+  static constexpr uint32_t kStateBits = 2;
+  static constexpr uint32_t kStateMask = (uint32_t{1} << kStateBits) - 1;
+  static constexpr uint32_t kStateEmpty = 0;
+  static constexpr uint32_t kStateConstruction = 1;
+  static constexpr uint32_t kStateVisible = 2;
+  static constexpr uint32_t kStateInvisible = 3;
+  static constexpr uint32_t kOneRef = uint32_t{1} << kStateBits;
+
+  static uint32_t GetState(uint32_t meta) { return meta & kStateMask; }
+  static uint32_t GetRefs(uint32_t meta) { return meta >> kStateBits; }
+
+  Slice key() const { return Slice(key_data, key_length); }
+
+  bool IsHighPri() const { return flags & IS_HIGH_PRI; }
+  bool IsSecondaryCacheCompatible() const {
+    return flags & IS_SECONDARY_CACHE_COMPATIBLE;
+  }
+  bool IsPromoted() const { return flags & IS_PROMOTED; }
+  bool IsDetached() const { return flags & IS_DETACHED; }
+
+  Cache::DeleterFn GetDeleter() const {
+    return IsSecondaryCacheCompatible() ? info_.helper->del_cb
+                                        : info_.deleter;
+  }
+
+  // Deletes the value and the key, leaving the handle to be reused.
+  void FreeData() {
+    Cache::DeleterFn deleter = GetDeleter();
+    if (deleter != nullptr) {
+      (*deleter)(key(), value);
+    }
+    delete[] key_data;
+    key_data = nullptr;
+    value = nullptr;
+  }
+};
+
+// A single shard of sharded cache.
+class ALIGN_AS(CACHE_LINE_SIZE) ClockCacheShard final : public CacheShard {
+ public:
+  ClockCacheShard(size_t capacity, size_t estimated_entry_charge,
+                  bool strict_capacity_limit,
+                  CacheMetadataChargePolicy metadata_charge_policy,
+                  const std::shared_ptr<SecondaryCache>& secondary_cache,
+                  const std::shared_ptr<CacheEvictionListener>&
+                      eviction_listener = nullptr);
+  ~ClockCacheShard() override;
+
+  // No copy and move.
+  ClockCacheShard(const ClockCacheShard&) = delete;
+  ClockCacheShard& operator=(const ClockCacheShard&) = delete;
+
+  // The table keeps the size it got from the initial capacity.
+  void SetCapacity(size_t capacity) override;
+  void SetStrictCapacityLimit(bool strict_capacity_limit) override;
+
+  Status Insert(const Slice& key, uint32_t hash, void* value, size_t charge,
+                DeleterFn deleter, Cache::Handle** handle,
+                Cache::Priority priority) override {
+    return Insert(key, hash, value, charge, deleter, nullptr, handle,
+                  priority, /*promoted=*/false);
+  }
+  Status Insert(const Slice& key, uint32_t hash, void* value,
+                const Cache::CacheItemHelper* helper, size_t charge,
+                Cache::Handle** handle, Cache::Priority priority) override {
+    return Insert(key, hash, value, charge, nullptr, helper, handle, priority,
+                  /*promoted=*/false);
+  }
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash) override {
+    return reinterpret_cast<Cache::Handle*>(FindVisible(key, hash));
+  }
+  // A miss waits for the secondary cache, whatever `wait` says, so handles
+  // are always ready.
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash,
+                        const Cache::CacheItemHelper* helper,
+                        const Cache::CreateCallback& create_cb,
+                        Cache::Priority priority, bool wait,
+                        Statistics* stats) override;
+  // Prefetches the first slot probed for each key before looking them up
+  void MultiLookup(const Slice* keys, const uint32_t* hashes,
+                   const size_t* indices, size_t count,
+                   const Cache::CacheItemHelper* helper,
+                   const Cache::CreateCallback& create_cb,
+                   Cache::Priority priority, bool wait, Statistics* stats,
+                   Cache::Handle** handles) override;
+  bool Release(Cache::Handle* handle, bool /*useful*/,
+               bool force_erase) override {
+    return Release(handle, force_erase);
+  }
+  bool IsReady(Cache::Handle* /*handle*/) override { return true; }
+  void Wait(Cache::Handle* /*handle*/) override {}
+  bool Ref(Cache::Handle* handle) override;
+  bool Release(Cache::Handle* handle, bool force_erase = false) override;
+  void Erase(const Slice& key, uint32_t hash) override;
+
+  size_t GetUsage() const override;
+  size_t GetPinnedUsage() const override;
+
+  void ApplyToSomeEntries(
+      const std::function<void(const Slice& key, void* value, size_t charge,
+                               DeleterFn deleter)>& callback,
+      uint32_t average_entries_per_lock, uint32_t* state) override;
+
+  void EraseUnRefEntries() override;
+
+  std::string GetPrintableOptions() const override;
 
-#if defined(TBB) && !defined(ROCKSDB_LITE)
-#define SUPPORT_CLOCK_CACHE
+  uint32_t TEST_GetTableSize() const { return uint32_t{1} << length_bits_; }
+  uint32_t TEST_GetOccupancyLimit() const { return occupancy_limit_; }
+
+ private:
+  // An entry taken out of the table by the clock hand, to be passed to the
+  // eviction listener and the secondary cache, then freed, once eviction
+  // is over.
+  struct EvictedEntry {
+    char* key_data;
+    size_t key_length;
+    void* value;
+    DeleterFn deleter;
+    // Set when secondary cache compatible
+    const Cache::CacheItemHelper* helper;
+    size_t charge;
+    uint32_t hit_count;
+    uint64_t insert_tick;
+    uint8_t flags;
+  };
+  using EvictedEntries = autovector<EvictedEntry>;
+
+  Status Insert(const Slice& key, uint32_t hash, void* value, size_t charge,
+                DeleterFn deleter, const Cache::CacheItemHelper* helper,
+                Cache::Handle** handle, Cache::Priority priority,
+                bool promoted);
+
+  // Returns a detached handle with one reference, holding a copy of `key`.
+  ClockHandle* NewDetachedHandle(const Slice& key, uint32_t hash, void* value,
+                                 size_t charge, DeleterFn deleter,
+                                 const Cache::CacheItemHelper* helper,
+                                 Cache::Priority priority, bool promoted);
+
+  size_t CalcTotalCharge(size_t key_length, size_t charge) const;
+
+  // First slot and step of the probe sequence of `hash`.
+  void ProbeStart(uint32_t hash, uint32_t* index, uint32_t* increment) const;
+
+  // Returns the visible entry of `key` with a reference taken and its
+  // countdown refreshed, or nullptr.
+  ClockHandle* FindVisible(const Slice& key, uint32_t hash);
+
+  // The part of Lookup() after a miss: looks `key` up in the secondary cache,
+  // if any, and inserts what it finds.
+  Cache::Handle* LookupSecondary(const Slice& key, uint32_t hash,
+                                 const Cache::CacheItemHelper* helper,
+                                 const Cache::CreateCallback& create_cb,
+                                 Cache::Priority priority, Statistics* stats);
+
+  // Returns the largest insert_tick among the visible entries of `key`, or 0
+  uint64_t NewestVisibleTick(const Slice& key, uint32_t hash);
+  // Makes the visible entries of `key` inserted before before_tick
+  // invisible, and frees those that are not referenced. Returns whether any
+  // was found.
+  bool EraseVisible(const Slice& key, uint32_t hash, uint64_t before_tick);
+
+  // Takes a reference on `h` if it is visible.
+  bool TryRef(ClockHandle* h);
+
+  // Drops a reference on `h`. The entry is freed if this was the last
+  // reference and the entry is invisible, or is visible and
+  // `erase_if_last_ref` is set. Returns whether the entry was freed.
+  bool Unref(ClockHandle* h, bool erase_if_last_ref);
+
+  // Charges `total_charge` to the usage, evicting as needed. With
+  // `allow_over_capacity`, charges it anyway when eviction cannot make room.
+  bool ChargeUsage(size_t total_charge, bool allow_over_capacity,
+                   EvictedEntries* evicted);
+
+  // Reserves a slot for `hash`, evicting as needed, and returns it in the
+  // construction state; or nullptr if the table is full of referenced
+  // entries.
+  ClockHandle* ReserveSlot(uint32_t hash, EvictedEntries* evicted);
+
+  // Moves the clock hand until `done()`, evicting unreferenced entries whose
+  // countdown ran out, into `evicted`. Returns false if the hand went over
+  // every entry enough times to evict all unreferenced ones, or over a whole
+  // table of referenced entries, without `done()`.
+  template <typename Done>
+  bool EvictUntil(Done done, EvictedEntries* evicted);
+
+  // Evicts `h` if it is visible, unreferenced, and its countdown ran out;
+  // decrements its countdown otherwise. Returns whether `h` was visible and
+  // unreferenced.
+  bool TryEvict(ClockHandle* h, EvictedEntries* evicted);
+
+  // Empties the slot of `h`, owned in the construction state. Its entry is
+  // freed, or moved to `evicted` if not null.
+  void FreeSlot(ClockHandle* h, EvictedEntries* evicted);
+
+  // Notifies the eviction listener of the evicted entries, demotes them to
+  // the secondary cache when they allow it, and frees them.
+  void FinishEviction(EvictedEntries* evicted);
+
+  // Decrements the displacements counts along the probe sequence of `hash`,
+  // up to `end_index` or for `num_probes` slots, whichever comes first.
+  void RollBackDisplacements(uint32_t hash, uint32_t end_index,
+                             uint32_t num_probes);
+
+  // The table has 2^length_bits_ slots.
+  const int length_bits_;
+  const uint32_t length_bits_mask_;
+  // Maximum number of entries in the table, to keep probe sequences short.
+  const uint32_t occupancy_limit_;
+  const std::unique_ptr<ClockHandle[]> array_;
+
+  // Number of slots not empty, or reserved for an insertion.
+  std::atomic<uint32_t> occupancy_;
+  // Position of the clock hand, to be masked by length_bits_mask_.
+  std::atomic<size_t> clock_pointer_;
+
+  std::atomic<size_t> capacity_;
+  // Total charge of the entries in the table.
+  std::atomic<size_t> usage_;
+  // Total charge of the referenced entries in the table.
+  std::atomic<size_t> pinned_usage_;
+  std::atomic<bool> strict_capacity_limit_;
+  // Number of entries inserted so far
+  std::atomic<uint64_t> insert_tick_;
+
+  std::shared_ptr<SecondaryCache> secondary_cache_;
+  std::shared_ptr<CacheEvictionListener> eviction_listener_;
+};
+
+class ClockCache
+#ifdef NDEBUG
+    final
 #endif
+    : public ShardedCache {
+ public:
+  ClockCache(size_t capacity, int num_shard_bits, bool strict_capacity_limit,
+             CacheMetadataChargePolicy metadata_charge_policy,
+             size_t estimated_entry_charge,
+             const std::shared_ptr<SecondaryCache>& secondary_cache = nullptr,
+             const std::shared_ptr<CacheEvictionListener>& eviction_listener =
+                 nullptr);
+  ~ClockCache() override;
+  const char* Name() const override { return "ClockCache"; }
+  CacheShard* GetShard(uint32_t shard) override;
+  const CacheShard* GetShard(uint32_t shard) const override;
+  void* Value(Handle* handle) override;
+  size_t GetCharge(Handle* handle) const override;
+  uint32_t GetHash(Handle* handle) const override;
+  DeleterFn GetDeleter(Handle* handle) const override;
+  void DisownData() override;
+  // Handles are always ready
+  void WaitAll(std::vector<Handle*>& /*handles*/) override {}
+
+ private:
+  ClockCacheShard* shards_ = nullptr;
+  int num_shards_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,426 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "cache/clock_cache.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rocksdb/statistics.h"
+#include "test_util/sync_point.h"
+#include "test_util/testharness.h"
+#include "util/coding.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+std::string EncodeKey(int k) {
+  std::string result;
+  PutFixed32(&result, k);
+  return result;
+}
+
+void* EncodeValue(uintptr_t v) { return reinterpret_cast<void*>(v); }
+}  // namespace
+
+class ClockCacheTest : public testing::Test {
+ public:
+  static ClockCacheTest* current_;
+
+  static void Deleter(const Slice& /*key*/, void* v) {
+    current_->deleted_values_.push_back(reinterpret_cast<uintptr_t>(v));
+  }
+
+  ClockCacheTest() { current_ = this; }
+
+  // A single shard with a table of 16 slots, taking up to 13 entries
+  void NewCache(size_t capacity, bool strict_capacity_limit = false) {
+    ClockCacheOptions opts(capacity, /*num_shard_bits=*/0,
+                           strict_capacity_limit, kDontChargeCacheMetadata);
+    opts.estimated_entry_charge = 100;
+    cache_ = NewClockCache(opts);
+    ASSERT_NE(nullptr, cache_);
+    shard_ = static_cast<ClockCacheShard*>(
+        static_cast<ClockCache*>(cache_.get())->GetShard(0));
+  }
+
+  Status Insert(int key, Cache::Handle** handle = nullptr,
+                Cache::Priority priority = Cache::Priority::LOW) {
+    return cache_->Insert(EncodeKey(key), EncodeValue(key), /*charge=*/1,
+                          &ClockCacheTest::Deleter, handle, priority);
+  }
+
+  bool Contains(int key) {
+    Cache::Handle* handle = cache_->Lookup(EncodeKey(key));
+    if (handle == nullptr) {
+      return false;
+    }
+    cache_->Release(handle);
+    return true;
+  }
+
+  std::vector<uintptr_t> deleted_values_;
+  std::shared_ptr<Cache> cache_;
+  ClockCacheShard* shard_ = nullptr;
+};
+ClockCacheTest* ClockCacheTest::current_;
+
+TEST_F(ClockCacheTest, TableSize) {
+  NewCache(/*capacity=*/1000);
+  ASSERT_EQ(16U, shard_->TEST_GetTableSize());
+  ASSERT_EQ(13U, shard_->TEST_GetOccupancyLimit());
+
+  ClockCacheOptions opts(/*capacity=*/100 << 10, /*num_shard_bits=*/2);
+  opts.estimated_entry_charge = 100;
+  std::shared_ptr<Cache> cache = NewClockCache(opts);
+  // About 256 entries per shard
+  ASSERT_EQ(512U, static_cast<ClockCacheShard*>(
+                      static_cast<ClockCache*>(cache.get())->GetShard(0))
+                      ->TEST_GetTableSize());
+
+  opts.estimated_entry_charge = 0;
+  ASSERT_EQ(nullptr, NewClockCache(opts));
+}
+
+TEST_F(ClockCacheTest, HighPriorityEntriesSurviveLonger) {
+  NewCache(/*capacity=*/10);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(Insert(i, nullptr, Cache::Priority::HIGH));
+    ASSERT_OK(Insert(100 + i));
+  }
+  // Evicts the low priority entries first
+  for (int i = 0; i < 5; i++) {
+    ASSERT_OK(Insert(200 + i));
+  }
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(Contains(i));
+    ASSERT_FALSE(Contains(100 + i));
+    ASSERT_TRUE(Contains(200 + i));
+  }
+  ASSERT_EQ(10U, cache_->GetUsage());
+}
+
+TEST_F(ClockCacheTest, TableFullOfReferencedEntries) {
+  // Room for many more entries than the table takes
+  NewCache(/*capacity=*/1000);
+  const int kEntries = static_cast<int>(shard_->TEST_GetOccupancyLimit());
+  std::vector<Cache::Handle*> handles(kEntries);
+  for (int i = 0; i < kEntries; i++) {
+    ASSERT_OK(Insert(i, &handles[i]));
+  }
+  ASSERT_EQ(static_cast<size_t>(kEntries), cache_->GetUsage());
+  ASSERT_EQ(static_cast<size_t>(kEntries), cache_->GetPinnedUsage());
+
+  // Handed out without entering the cache
+  Cache::Handle* handle = nullptr;
+  ASSERT_OK(Insert(100, &handle));
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(EncodeValue(100), cache_->Value(handle));
+  ASSERT_FALSE(Contains(100));
+  ASSERT_EQ(static_cast<size_t>(kEntries), cache_->GetUsage());
+  ASSERT_TRUE(cache_->Release(handle));
+  ASSERT_EQ(std::vector<uintptr_t>({100}), deleted_values_);
+
+  // As if evicted right away
+  ASSERT_OK(Insert(101));
+  ASSERT_FALSE(Contains(101));
+  ASSERT_EQ(std::vector<uintptr_t>({100, 101}), deleted_values_);
+
+  // Fails, leaving the value to the caller
+  cache_->SetStrictCapacityLimit(true);
+  ASSERT_TRUE(Insert(102, &handle).IsIncomplete());
+  ASSERT_EQ(nullptr, handle);
+  ASSERT_EQ(2U, deleted_values_.size());
+  cache_->SetStrictCapacityLimit(false);
+
+  for (int i = 0; i < kEntries; i++) {
+    cache_->Release(handles[i]);
+  }
+  ASSERT_EQ(0U, cache_->GetPinnedUsage());
+  ASSERT_OK(Insert(103));
+  ASSERT_TRUE(Contains(103));
+  ASSERT_EQ(static_cast<size_t>(kEntries), cache_->GetUsage());
+}
+
+TEST_F(ClockCacheTest, ReplaceReferencedEntry) {
+  NewCache(/*capacity=*/10);
+  Cache::Handle* handle = nullptr;
+  ASSERT_OK(Insert(1, &handle));
+  ASSERT_EQ(Status::OkOverwritten(),
+            cache_->Insert(EncodeKey(1), EncodeValue(2), 1,
+                           &ClockCacheTest::Deleter));
+  ASSERT_EQ(2U, cache_->GetUsage());
+  Cache::Handle* lookup = cache_->Lookup(EncodeKey(1));
+  ASSERT_EQ(EncodeValue(2), cache_->Value(lookup));
+  cache_->Release(lookup);
+  ASSERT_TRUE(deleted_values_.empty());
+  // The replaced entry is freed with its last reference
+  ASSERT_TRUE(cache_->Release(handle));
+  ASSERT_EQ(std::vector<uintptr_t>({1}), deleted_values_);
+  ASSERT_EQ(1U, cache_->GetUsage());
+}
+
+TEST_F(ClockCacheTest, RacingInsertsKeepNewest) {
+  NewCache(/*capacity=*/10);
+  // A second insertion of the key made visible before the first one looks
+  // for the entries it replaces
+  bool nested = false;
+  SyncPoint::GetInstance()->SetCallBack(
+      "ClockCacheShard::Insert:Visible", [&](void* /*arg*/) {
+        if (!nested) {
+          nested = true;
+          ASSERT_EQ(Status::OkOverwritten(),
+                    cache_->Insert(EncodeKey(1), EncodeValue(2), 1,
+                                   &ClockCacheTest::Deleter));
+        }
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+  ASSERT_OK(Insert(1));
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_TRUE(nested);
+
+  Cache::Handle* lookup = cache_->Lookup(EncodeKey(1));
+  ASSERT_NE(nullptr, lookup);
+  ASSERT_EQ(EncodeValue(2), cache_->Value(lookup));
+  cache_->Release(lookup);
+  ASSERT_EQ(std::vector<uintptr_t>({1}), deleted_values_);
+  ASSERT_EQ(1U, cache_->GetUsage());
+}
+
+namespace {
+class RecordingEvictionListener : public CacheEvictionListener {
+ public:
+  void OnEvict(const CacheEvictionInfo* entries, size_t count) override {
+    batches.emplace_back();
+    for (size_t i = 0; i < count; i++) {
+      // Not freed yet
+      EXPECT_EQ(entries[i].key.ToString(),
+                EncodeKey(static_cast<int>(
+                    reinterpret_cast<uintptr_t>(entries[i].value))));
+      batches.back().push_back(entries[i]);
+      batches.back().back().key = Slice();
+    }
+  }
+
+  std::vector<std::vector<CacheEvictionInfo>> batches;
+};
+}  // namespace
+
+TEST_F(ClockCacheTest, EvictionListener) {
+  auto listener = std::make_shared<RecordingEvictionListener>();
+  ClockCacheOptions opts(/*capacity=*/4, /*num_shard_bits=*/0,
+                         /*strict_capacity_limit=*/false,
+                         kDontChargeCacheMetadata);
+  opts.estimated_entry_charge = 1;
+  opts.eviction_listener = listener;
+  cache_ = NewClockCache(opts);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_OK(Insert(i));
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(Contains(i));
+    ASSERT_TRUE(Contains(i));
+  }
+  ASSERT_TRUE(listener->batches.empty());
+
+  // The clock hand may take a few entries at once, all in the same batch
+  ASSERT_OK(Insert(4));
+  ASSERT_EQ(1U, listener->batches.size());
+  const std::vector<CacheEvictionInfo>& batch = listener->batches[0];
+  ASSERT_GE(batch.size(), 1U);
+  ASSERT_EQ(batch.size(), deleted_values_.size());
+  for (size_t i = 0; i < batch.size(); i++) {
+    const CacheEvictionInfo& info = batch[i];
+    uintptr_t evicted = reinterpret_cast<uintptr_t>(info.value);
+    ASSERT_LT(evicted, 4U);
+    ASSERT_EQ(evicted, deleted_values_[i]);
+    ASSERT_EQ(&ClockCacheTest::Deleter, info.deleter);
+    ASSERT_EQ(1U, info.charge);
+    ASSERT_EQ(2U, info.hit_count);
+    ASSERT_EQ(4U - evicted, info.residency);
+    ASSERT_FALSE(info.high_priority);
+  }
+  const size_t num_evicted = batch.size();
+
+  // Erased entries are not evictions
+  cache_->Erase(EncodeKey(4));
+  ASSERT_EQ(1U, listener->batches.size());
+
+  cache_->SetCapacity(0);
+  ASSERT_EQ(2U, listener->batches.size());
+  ASSERT_EQ(4U - num_evicted, listener->batches[1].size());
+  ASSERT_EQ(0U, cache_->GetUsage());
+}
+
+namespace {
+class TestItem {
+ public:
+  explicit TestItem(const std::string& data) : data_(data) {}
+  const std::string& data() const { return data_; }
+
+ private:
+  std::string data_;
+};
+
+size_t SizeCallback(void* obj) {
+  return reinterpret_cast<TestItem*>(obj)->data().size();
+}
+
+Status SaveToCallback(void* from_obj, size_t from_offset, size_t length,
+                      void* out) {
+  const std::string& data = reinterpret_cast<TestItem*>(from_obj)->data();
+  memcpy(out, data.data() + from_offset, length);
+  return Status::OK();
+}
+
+void DeletionCallback(const Slice& /*key*/, void* obj) {
+  delete reinterpret_cast<TestItem*>(obj);
+}
+
+Cache::CacheItemHelper test_item_helper(SizeCallback, SaveToCallback,
+                                        DeletionCallback);
+
+Status CreateTestItem(const void* buf, size_t size, void** out_obj,
+                      size_t* charge) {
+  *out_obj = new TestItem(std::string(static_cast<const char*>(buf), size));
+  *charge = size;
+  return Status::OK();
+}
+}  // namespace
+
+TEST_F(ClockCacheTest, SecondaryCache) {
+  LRUSecondaryCacheOptions secondary_opts;
+  secondary_opts.capacity = 4096;
+  secondary_opts.num_shard_bits = 0;
+  secondary_opts.compression_type = kNoCompression;
+  std::shared_ptr<SecondaryCache> secondary_cache =
+      NewLRUSecondaryCache(secondary_opts);
+  ClockCacheOptions opts(/*capacity=*/1024, /*num_shard_bits=*/0,
+                         /*strict_capacity_limit=*/false,
+                         kDontChargeCacheMetadata);
+  opts.estimated_entry_charge = 512;
+  opts.secondary_cache = secondary_cache;
+  std::shared_ptr<Cache> cache = NewClockCache(opts);
+  std::shared_ptr<Statistics> stats = CreateDBStatistics();
+
+  Random rnd(301);
+  std::string str1 = rnd.RandomString(1000);
+  std::string str2 = rnd.RandomString(1000);
+  ASSERT_OK(cache->Insert("k1", new TestItem(str1), &test_item_helper,
+                          str1.size()));
+  // k1 should be demoted to the secondary cache
+  ASSERT_OK(cache->Insert("k2", new TestItem(str2), &test_item_helper,
+                          str2.size()));
+  ASSERT_EQ(nullptr, cache->Lookup("k1"));
+
+  // Without a helper, the secondary cache is not looked up
+  ASSERT_EQ(nullptr, cache->Lookup("k1", nullptr, CreateTestItem,
+                                   Cache::Priority::LOW, true, stats.get()));
+  Cache::Handle* handle =
+      cache->Lookup("k1", &test_item_helper, CreateTestItem,
+                    Cache::Priority::LOW, /*wait=*/false, stats.get());
+  ASSERT_NE(nullptr, handle);
+  ASSERT_TRUE(cache->IsReady(handle));
+  ASSERT_EQ(str1, reinterpret_cast<TestItem*>(cache->Value(handle))->data());
+  cache->Release(handle);
+  ASSERT_EQ(1U, stats->getTickerCount(SECONDARY_CACHE_HITS));
+
+  // k1 was promoted, and k2 demoted
+  handle = cache->Lookup("k1");
+  ASSERT_NE(nullptr, handle);
+  cache->Release(handle);
+  handle = cache->Lookup("k2", &test_item_helper, CreateTestItem,
+                         Cache::Priority::LOW, true, stats.get());
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(str2, reinterpret_cast<TestItem*>(cache->Value(handle))->data());
+  cache->Release(handle);
+  ASSERT_EQ(2U, stats->getTickerCount(SECONDARY_CACHE_HITS));
+
+  ASSERT_EQ(nullptr, cache->Lookup("k3", &test_item_helper, CreateTestItem,
+                                   Cache::Priority::LOW, true, stats.get()));
+}
+
+TEST_F(ClockCacheTest, ConcurrentOperations) {
+  // Many shards of a few entries, to have evictions
+  ClockCacheOptions opts(/*capacity=*/1024, /*num_shard_bits=*/2,
+                         /*strict_capacity_limit=*/false,
+                         kDontChargeCacheMetadata);
+  opts.estimated_entry_charge = 8;
+  std::shared_ptr<Cache> cache = NewClockCache(opts);
+  std::atomic<int> live_values{0};
+  auto deleter = [](const Slice& /*key*/, void* value) {
+    reinterpret_cast<std::atomic<int>*>(value)->fetch_sub(1);
+  };
+
+  const int kThreads = 4;
+  const int kOpsPerThread = 20000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      Random rnd(301 + t);
+      std::vector<Cache::Handle*> held;
+      for (int i = 0; i < kOpsPerThread; i++) {
+        std::string key = EncodeKey(static_cast<int>(rnd.Uniform(512)));
+        switch (rnd.Uniform(4)) {
+          case 0: {
+            Cache::Handle* handle = nullptr;
+            live_values.fetch_add(1);
+            Status s = cache->Insert(key, &live_values, 8, deleter,
+                                     rnd.OneIn(2) ? &handle : nullptr,
+                                     rnd.OneIn(4) ? Cache::Priority::HIGH
+                                                  : Cache::Priority::LOW);
+            ASSERT_TRUE(s.ok());
+            if (handle != nullptr) {
+              held.push_back(handle);
+            }
+            break;
+          }
+          case 1: {
+            Cache::Handle* handle = cache->Lookup(key);
+            if (handle != nullptr) {
+              ASSERT_EQ(&live_values, cache->Value(handle));
+              held.push_back(handle);
+            }
+            break;
+          }
+          case 2:
+            cache->Erase(key);
+            break;
+          default:
+            if (!held.empty()) {
+              cache->Release(held.back(), rnd.OneIn(8));
+              held.pop_back();
+            }
+            break;
+        }
+        if (held.size() > 4) {
+          cache->Release(held.front());
+          held.erase(held.begin());
+        }
+      }
+      for (Cache::Handle* handle : held) {
+        cache->Release(handle);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0U, cache->GetPinnedUsage());
+  cache->EraseUnRefEntries();
+  ASSERT_EQ(0U, cache->GetUsage());
+  ASSERT_EQ(0, live_values.load());
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,489 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "cache/file_secondary_cache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <memory>
+
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+#include "util/string_util.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+// A record is laid out as
+//   masked crc32c of the rest: fixed32
+//   key size: fixed32
+//   value size, or kTombstone: fixed32
+//   key
+//   value
+const size_t kRecordHeaderSize = 12;
+const uint32_t kTombstone = 0xffffffff;
+const char* kRegionFileSuffix = ".sec";
+
+std::string EncodeRecord(const Slice& key, size_t value_size) {
+  std::string record;
+  record.reserve(kRecordHeaderSize + key.size() +
+                 (value_size == kTombstone ? 0 : value_size));
+  PutFixed32(&record, 0);
+  PutFixed32(&record, static_cast<uint32_t>(key.size()));
+  PutFixed32(&record, static_cast<uint32_t>(value_size));
+  record.append(key.data(), key.size());
+  return record;
+}
+
+void SealRecord(std::string* record) {
+  uint32_t crc = crc32c::Value(record->data() + 4, record->size() - 4);
+  EncodeFixed32(&(*record)[0], crc32c::Mask(crc));
+}
+
+// Parses the record at the start of data. Returns the record size, or 0 if
+// data does not start with a complete, intact record.
+size_t DecodeRecord(const Slice& data, Slice* key, Slice* value,
+                    bool* tombstone) {
+  if (data.size() < kRecordHeaderSize) {
+    return 0;
+  }
+  uint32_t crc = crc32c::Unmask(DecodeFixed32(data.data()));
+  uint32_t key_size = DecodeFixed32(data.data() + 4);
+  uint32_t value_size = DecodeFixed32(data.data() + 8);
+  *tombstone = value_size == kTombstone;
+  uint64_t size = uint64_t{kRecordHeaderSize} + key_size +
+                  (*tombstone ? 0 : value_size);
+  if (size > data.size() ||
+      crc32c::Value(data.data() + 4, static_cast<size_t>(size) - 4) != crc) {
+    return 0;
+  }
+  *key = Slice(data.data() + kRecordHeaderSize, key_size);
+  *value = Slice(key->data() + key_size, *tombstone ? 0 : value_size);
+  return static_cast<size_t>(size);
+}
+
+// Creates the value from a record read for the entry, and wakes up waiters.
+void CompleteRead(FileSecondaryCacheRead* read, const IOStatus& io_s,
+                  const Slice& data) {
+  Slice key;
+  Slice value;
+  bool tombstone = false;
+  if (io_s.ok() && data.size() == read->len &&
+      DecodeRecord(data, &key, &value, &tombstone) == read->len &&
+      !tombstone && key == read->key) {
+    Status s = read->create_cb(value.data(), value.size(), &read->value,
+                               &read->charge);
+    if (!s.ok()) {
+      read->value = nullptr;
+    }
+  }
+  MutexLock l(&read->mu);
+  read->state.store(FileSecondaryCacheRead::kDone, std::memory_order_release);
+  read->cv.SignalAll();
+}
+
+// Reads a claimed entry
+void DoRead(FileSecondaryCacheRead* read) {
+  std::unique_ptr<char[]> scratch(new char[read->len]);
+  Slice data;
+  IOStatus s = read->file->Read(read->offset, read->len, IOOptions(), &data,
+                                scratch.get(), nullptr);
+  CompleteRead(read, s, data);
+}
+
+}  // namespace
+
+void FileSecondaryCacheResultHandle::Wait() {
+  if (read_->TryClaim()) {
+    DoRead(read_.get());
+    return;
+  }
+  MutexLock l(&read_->mu);
+  while (read_->state.load(std::memory_order_acquire) !=
+         FileSecondaryCacheRead::kDone) {
+    read_->cv.Wait();
+  }
+}
+
+FileSecondaryCache::FileSecondaryCache(const FileSecondaryCacheOptions& opts)
+    : opts_(opts),
+      fs_(opts.file_system ? opts.file_system : FileSystem::Default()),
+      // Sized for blocks of about 4KB
+      admission_sketch_(std::max<size_t>(opts.capacity >> 12, 1)) {
+  io_threads_.SetHostEnv(Env::Default());
+  io_threads_.SetBackgroundThreads(opts_.num_io_threads);
+}
+
+FileSecondaryCache::~FileSecondaryCache() {
+  io_threads_.WaitForJobsAndJoinAllThreads();
+  if (writer_) {
+    writer_->Close(IOOptions(), nullptr).PermitUncheckedError();
+  }
+}
+
+std::string FileSecondaryCache::RegionFileName(uint64_t id) const {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "/%06" PRIu64 "%s", id, kRegionFileSuffix);
+  return opts_.path + buf;
+}
+
+Status FileSecondaryCache::Open() {
+  IOStatus s = fs_->CreateDirIfMissing(opts_.path, IOOptions(), nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<std::string> children;
+  s = fs_->GetChildren(opts_.path, IOOptions(), &children, nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<uint64_t> ids;
+  for (const std::string& child : children) {
+    uint64_t id = 0;
+    Slice name(child);
+    if (name.ends_with(kRegionFileSuffix) && ConsumeDecimalNumber(&name, &id) &&
+        name == kRegionFileSuffix) {
+      ids.push_back(id);
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+
+  MutexLock wl(&write_mutex_);
+  {
+    MutexLock l(&mutex_);
+    for (uint64_t id : ids) {
+      s = LoadRegion(id);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  next_region_id_ = ids.empty() ? 0 : ids.back() + 1;
+  return StartRegion(next_region_id_++);
+}
+
+IOStatus FileSecondaryCache::LoadRegion(uint64_t id) {
+  const std::string fname = RegionFileName(id);
+  std::unique_ptr<FSRandomAccessFile> file;
+  IOStatus s = fs_->NewRandomAccessFile(fname, FileOptions(), &file, nullptr);
+  uint64_t file_size = 0;
+  if (s.ok()) {
+    s = fs_->GetFileSize(fname, IOOptions(), &file_size, nullptr);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  std::unique_ptr<char[]> scratch(new char[file_size]);
+  Slice data;
+  s = file->Read(0, file_size, IOOptions(), &data, scratch.get(), nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+
+  regions_.emplace_back();
+  Region& region = regions_.back();
+  region.id = id;
+  region.size = file_size;
+  region.reader = std::move(file);
+  usage_ += file_size;
+  // Stops at the first torn or corrupted record, such as one cut short by
+  // a crash while appending
+  for (uint64_t offset = 0; offset < data.size();) {
+    Slice key;
+    Slice value;
+    bool tombstone = false;
+    size_t size = DecodeRecord(Slice(data.data() + offset, data.size() - offset),
+                               &key, &value, &tombstone);
+    if (size == 0) {
+      break;
+    }
+    if (tombstone) {
+      index_.erase(key.ToString());
+    } else {
+      index_[key.ToString()] = {id, offset, static_cast<uint32_t>(size)};
+      region.keys.push_back(key.ToString());
+    }
+    offset += size;
+  }
+  return s;
+}
+
+IOStatus FileSecondaryCache::StartRegion(uint64_t id) {
+  const std::string fname = RegionFileName(id);
+  std::unique_ptr<FSWritableFile> writer;
+  IOStatus s = fs_->NewWritableFile(fname, FileOptions(), &writer, nullptr);
+  std::unique_ptr<FSRandomAccessFile> reader;
+  if (s.ok()) {
+    s = fs_->NewRandomAccessFile(fname, FileOptions(), &reader, nullptr);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  if (writer_) {
+    writer_->Close(IOOptions(), nullptr).PermitUncheckedError();
+  }
+  writer_ = std::move(writer);
+
+  MutexLock l(&mutex_);
+  regions_.emplace_back();
+  regions_.back().id = id;
+  regions_.back().reader = std::move(reader);
+  EvictRegions(0);
+  return s;
+}
+
+IOStatus FileSecondaryCache::AppendRecord(const Slice& record,
+                                          uint64_t* region_id,
+                                          uint64_t* offset) {
+  write_mutex_.AssertHeld();
+  uint64_t region_size;
+  {
+    MutexLock l(&mutex_);
+    region_size = regions_.back().size;
+  }
+  if (region_size > 0 && region_size + record.size() > opts_.region_size) {
+    IOStatus s = StartRegion(next_region_id_++);
+    if (!s.ok()) {
+      return s;
+    }
+    region_size = 0;
+  }
+  // Appends are visible to reads once flushed to the OS
+  IOStatus s = writer_->Append(record, IOOptions(), nullptr);
+  if (s.ok()) {
+    s = writer_->Flush(IOOptions(), nullptr);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+
+  MutexLock l(&mutex_);
+  EvictRegions(record.size());
+  Region& region = regions_.back();
+  *region_id = region.id;
+  *offset = region.size;
+  region.size += record.size();
+  usage_ += record.size();
+  return s;
+}
+
+void FileSecondaryCache::EvictRegions(uint64_t incoming) {
+  mutex_.AssertHeld();
+  // Never drops the region being appended to
+  while (regions_.size() > 1 && usage_ + incoming > opts_.capacity) {
+    Region& region = regions_.front();
+    for (const std::string& key : region.keys) {
+      auto it = index_.find(key);
+      if (it != index_.end() && it->second.region_id == region.id) {
+        index_.erase(it);
+      }
+    }
+    usage_ -= region.size;
+    // Reads in progress keep the file open
+    fs_->DeleteFile(RegionFileName(region.id), IOOptions(), nullptr)
+        .PermitUncheckedError();
+    regions_.pop_front();
+  }
+}
+
+FileSecondaryCache::Region* FileSecondaryCache::FindRegion(uint64_t id) {
+  mutex_.AssertHeld();
+  auto it = std::lower_bound(
+      regions_.begin(), regions_.end(), id,
+      [](const Region& region, uint64_t i) { return region.id < i; });
+  return it != regions_.end() && it->id == id ? &*it : nullptr;
+}
+
+Status FileSecondaryCache::Insert(const Slice& key, void* value,
+                                  const Cache::CacheItemHelper* helper) {
+  uint64_t hash = GetSliceNPHash64(key);
+  admission_sketch_.Increment(hash);
+  if (admission_sketch_.Estimate(hash) < opts_.admission_threshold) {
+    return Status::OK();
+  }
+  {
+    MutexLock l(&mutex_);
+    // Blocks never change, so the entry written before is still good
+    if (index_.find(key.ToString()) != index_.end()) {
+      return Status::OK();
+    }
+  }
+
+  size_t value_size = (*helper->size_cb)(value);
+  if (kRecordHeaderSize + key.size() + value_size > opts_.region_size) {
+    return Status::OK();
+  }
+  std::string record = EncodeRecord(key, value_size);
+  size_t value_offset = record.size();
+  record.resize(value_offset + value_size);
+  Status s = (*helper->saveto_cb)(value, 0, value_size, &record[value_offset]);
+  if (!s.ok()) {
+    return s;
+  }
+  SealRecord(&record);
+
+  MutexLock wl(&write_mutex_);
+  uint64_t region_id = 0;
+  uint64_t offset = 0;
+  s = AppendRecord(record, &region_id, &offset);
+  if (!s.ok()) {
+    return s;
+  }
+  MutexLock l(&mutex_);
+  index_[key.ToString()] = {region_id, offset,
+                            static_cast<uint32_t>(record.size())};
+  regions_.back().keys.push_back(key.ToString());
+  return s;
+}
+
+std::unique_ptr<SecondaryCacheResultHandle> FileSecondaryCache::Lookup(
+    const Slice& key, const Cache::CreateCallback& create_cb, bool wait) {
+  admission_sketch_.Increment(GetSliceNPHash64(key));
+  std::shared_ptr<FileSecondaryCacheRead> read =
+      std::make_shared<FileSecondaryCacheRead>();
+  {
+    MutexLock l(&mutex_);
+    auto it = index_.find(key.ToString());
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    Region* region = FindRegion(it->second.region_id);
+    assert(region != nullptr);
+    read->file = region->reader;
+    read->offset = it->second.offset;
+    read->len = it->second.size;
+  }
+  read->key = key.ToString();
+  read->create_cb = create_cb;
+
+  if (wait) {
+    read->TryClaim();
+    DoRead(read.get());
+    if (read->value == nullptr) {
+      return nullptr;
+    }
+  } else {
+    io_threads_.SubmitJob([read]() {
+      if (read->TryClaim()) {
+        DoRead(read.get());
+      }
+    });
+  }
+  return std::unique_ptr<SecondaryCacheResultHandle>(
+      new FileSecondaryCacheResultHandle(std::move(read)));
+}
+
+void FileSecondaryCache::Erase(const Slice& key) {
+  {
+    MutexLock l(&mutex_);
+    if (index_.erase(key.ToString()) == 0) {
+      return;
+    }
+  }
+  // So that the entry does not come back on reopen
+  std::string record = EncodeRecord(key, kTombstone);
+  SealRecord(&record);
+  MutexLock wl(&write_mutex_);
+  uint64_t region_id = 0;
+  uint64_t offset = 0;
+  AppendRecord(record, &region_id, &offset).PermitUncheckedError();
+}
+
+void FileSecondaryCache::WaitAll(
+    std::vector<SecondaryCacheResultHandle*> handles) {
+  // Claims the reads no I/O thread has started, and issues them together,
+  // one MultiRead() per file
+  std::vector<FileSecondaryCacheRead*> reads;
+  for (SecondaryCacheResultHandle* handle : handles) {
+    FileSecondaryCacheRead* read =
+        static_cast<FileSecondaryCacheResultHandle*>(handle)->read();
+    if (read->TryClaim()) {
+      reads.push_back(read);
+    }
+  }
+  std::sort(reads.begin(), reads.end(),
+            [](FileSecondaryCacheRead* a, FileSecondaryCacheRead* b) {
+              return a->file != b->file ? a->file < b->file
+                                        : a->offset < b->offset;
+            });
+  for (size_t begin = 0; begin < reads.size();) {
+    size_t end = begin + 1;
+    while (end < reads.size() && reads[end]->file == reads[begin]->file) {
+      end++;
+    }
+    std::vector<FSReadRequest> reqs(end - begin);
+    std::vector<std::unique_ptr<char[]>> scratches(end - begin);
+    for (size_t i = 0; i < reqs.size(); i++) {
+      FileSecondaryCacheRead* read = reads[begin + i];
+      scratches[i].reset(new char[read->len]);
+      reqs[i].offset = read->offset;
+      reqs[i].len = read->len;
+      reqs[i].scratch = scratches[i].get();
+    }
+    IOStatus s = reads[begin]->file->MultiRead(reqs.data(), reqs.size(),
+                                                IOOptions(), nullptr);
+    for (size_t i = 0; i < reqs.size(); i++) {
+      CompleteRead(reads[begin + i], s.ok() ? reqs[i].status : s,
+                   reqs[i].result);
+    }
+    begin = end;
+  }
+  for (SecondaryCacheResultHandle* handle : handles) {
+    handle->Wait();
+  }
+}
+
+std::string FileSecondaryCache::GetPrintableOptions() const {
+  std::string ret;
+  ret.reserve(20000);
+  const int kBufferSize = 200;
+  char buffer[kBufferSize];
+  snprintf(buffer, kBufferSize, "    path : %s\n", opts_.path.c_str());
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    capacity : %" ROCKSDB_PRIszt "\n",
+           opts_.capacity);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    region_size : %" ROCKSDB_PRIszt "\n",
+           opts_.region_size);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    admission_threshold : %" PRIu32 "\n",
+           opts_.admission_threshold);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    num_io_threads : %d\n",
+           opts_.num_io_threads);
+  ret.append(buffer);
+  return ret;
+}
+
+size_t FileSecondaryCache::TEST_GetUsage() {
+  MutexLock l(&mutex_);
+  return static_cast<size_t>(usage_);
+}
+
+size_t FileSecondaryCache::TEST_GetNumRegions() {
+  MutexLock l(&mutex_);
+  return regions_.size();
+}
+
+Status NewFileSecondaryCache(const FileSecondaryCacheOptions& opts,
+                             std::shared_ptr<SecondaryCache>* cache) {
+  if (opts.path.empty() || opts.region_size == 0 ||
+      opts.capacity < opts.region_size || opts.num_io_threads <= 0) {
+    return Status::InvalidArgument(
+        "FileSecondaryCache needs a path, a capacity of at least a region and "
+        "I/O threads");
+  }
+  std::unique_ptr<FileSecondaryCache> file_cache(new FileSecondaryCache(opts));
+  Status s = file_cache->Open();
+  if (s.ok()) {
+    cache->reset(file_cache.release());
+  }
+  return s;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
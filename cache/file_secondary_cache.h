@@ -0,0 +1,168 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/file_system.h"
+#include "rocksdb/secondary_cache.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "util/frequency_sketch.h"
+#include "util/threadpool_imp.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// A read of one entry of a FileSecondaryCache, done by whoever claims it
+// first: an I/O thread, a Wait() or a WaitAll().
+struct FileSecondaryCacheRead {
+  enum State : int { kPending, kReading, kDone };
+
+  FileSecondaryCacheRead() : cv(&mu) {}
+
+  // Moves from kPending to kReading; false if someone else did.
+  bool TryClaim() {
+    int expected = kPending;
+    return state.compare_exchange_strong(expected, kReading);
+  }
+
+  std::shared_ptr<FSRandomAccessFile> file;
+  uint64_t offset = 0;
+  size_t len = 0;
+  std::string key;
+  Cache::CreateCallback create_cb;
+
+  std::atomic<int> state{kPending};
+  port::Mutex mu;
+  port::CondVar cv;
+  void* value = nullptr;
+  size_t charge = 0;
+};
+
+class FileSecondaryCacheResultHandle : public SecondaryCacheResultHandle {
+ public:
+  explicit FileSecondaryCacheResultHandle(
+      std::shared_ptr<FileSecondaryCacheRead> read)
+      : read_(std::move(read)) {}
+  ~FileSecondaryCacheResultHandle() override = default;
+
+  FileSecondaryCacheResultHandle(const FileSecondaryCacheResultHandle&) =
+      delete;
+  FileSecondaryCacheResultHandle& operator=(
+      const FileSecondaryCacheResultHandle&) = delete;
+
+  bool IsReady() override {
+    return read_->state.load(std::memory_order_acquire) ==
+           FileSecondaryCacheRead::kDone;
+  }
+
+  void Wait() override;
+
+  void* Value() override { return read_->value; }
+
+  size_t Size() override { return read_->charge; }
+
+  FileSecondaryCacheRead* read() const { return read_.get(); }
+
+ private:
+  std::shared_ptr<FileSecondaryCacheRead> read_;
+};
+
+// A SecondaryCache keeping its entries in files, for a local device much
+// larger than the primary cache.
+//
+// Entries are appended as checksummed records to the newest of a series of
+// region files, and located through an in-memory index. Space is reclaimed
+// a region at a time, dropping the oldest region file along with the index
+// entries pointing into it, so that the device only sees sequential writes.
+// Erase() drops the index entry and appends a tombstone record. On open,
+// the index is rebuilt by scanning the region files in order.
+//
+// Lookup(wait=false) queues the read to a pool of I/O threads and returns
+// right away. WaitAll() reads the entries of all the handles no thread has
+// picked up yet with one MultiRead() per region file, which the posix file
+// system submits as a single io_uring batch where available.
+class FileSecondaryCache : public SecondaryCache {
+ public:
+  explicit FileSecondaryCache(const FileSecondaryCacheOptions& opts);
+  ~FileSecondaryCache() override;
+
+  // Creates the directory if missing and reloads the index from the region
+  // files found in it.
+  Status Open();
+
+  const char* Name() const override { return "FileSecondaryCache"; }
+
+  Status Insert(const Slice& key, void* value,
+                const Cache::CacheItemHelper* helper) override;
+
+  std::unique_ptr<SecondaryCacheResultHandle> Lookup(
+      const Slice& key, const Cache::CreateCallback& create_cb,
+      bool wait) override;
+
+  void Erase(const Slice& key) override;
+
+  void WaitAll(std::vector<SecondaryCacheResultHandle*> handles) override;
+
+  std::string GetPrintableOptions() const override;
+
+  size_t TEST_GetUsage();
+  size_t TEST_GetNumRegions();
+
+ private:
+  struct Location {
+    uint64_t region_id;
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  struct Region {
+    uint64_t id;
+    uint64_t size = 0;
+    std::shared_ptr<FSRandomAccessFile> reader;
+    // Keys written to the region, to drop their index entries with it
+    std::vector<std::string> keys;
+  };
+
+  std::string RegionFileName(uint64_t id) const;
+  // Appends a record to the active region, starting a new region if needed,
+  // and returns where it was written. REQUIRES: write_mutex_ held.
+  IOStatus AppendRecord(const Slice& record, uint64_t* region_id,
+                        uint64_t* offset);
+  // Switches appends to a new region file. REQUIRES: write_mutex_ held.
+  IOStatus StartRegion(uint64_t id);
+  // Scans a region file, applying its records to the index.
+  // REQUIRES: mutex_ held.
+  IOStatus LoadRegion(uint64_t id);
+  // Drops the oldest regions until usage fits. REQUIRES: mutex_ held.
+  void EvictRegions(uint64_t incoming);
+  // REQUIRES: mutex_ held.
+  Region* FindRegion(uint64_t id);
+
+  const FileSecondaryCacheOptions opts_;
+  std::shared_ptr<FileSystem> fs_;
+  FrequencySketch admission_sketch_;
+  ThreadPoolImpl io_threads_;
+
+  // Serializes appends. Acquired before mutex_ when both are needed.
+  port::Mutex write_mutex_;
+  std::unique_ptr<FSWritableFile> writer_;
+  uint64_t next_region_id_ = 0;
+
+  port::Mutex mutex_;
+  // Oldest first; the last one is being appended to
+  std::deque<Region> regions_;
+  std::unordered_map<std::string, Location> index_;
+  uint64_t usage_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,265 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "cache/file_secondary_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "file/file_util.h"
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class FileSecondaryCacheTest : public testing::Test {
+ public:
+  FileSecondaryCacheTest() : env_(Env::Default()) {
+    path_ = test::PerThreadDBPath(env_, "file_secondary_cache_test");
+    EXPECT_OK(DestroyDir(env_, path_));
+    opts_.path = path_;
+    opts_.capacity = 64 << 10;
+    opts_.region_size = 16 << 10;
+    opts_.admission_threshold = 1;
+  }
+
+  ~FileSecondaryCacheTest() override {
+    cache_.reset();
+    EXPECT_OK(DestroyDir(env_, path_));
+  }
+
+ protected:
+  static size_t SizeCallback(void* obj) {
+    return reinterpret_cast<std::string*>(obj)->size();
+  }
+
+  static Status SaveToCallback(void* from_obj, size_t from_offset,
+                               size_t length, void* out) {
+    std::string* item = reinterpret_cast<std::string*>(from_obj);
+    memcpy(out, item->data() + from_offset, length);
+    return Status::OK();
+  }
+
+  static void DeletionCallback(const Slice& /*key*/, void* obj) {
+    delete reinterpret_cast<std::string*>(obj);
+  }
+
+  static Cache::CacheItemHelper helper_;
+
+  Cache::CreateCallback creator_ = [](const void* buf, size_t size,
+                                      void** out_obj,
+                                      size_t* charge) -> Status {
+    *out_obj = new std::string(static_cast<const char*>(buf), size);
+    *charge = size;
+    return Status::OK();
+  };
+
+  void Open() {
+    cache_.reset();
+    ASSERT_OK(NewFileSecondaryCache(opts_, &cache_));
+  }
+
+  FileSecondaryCache* file_cache() {
+    return static_cast<FileSecondaryCache*>(cache_.get());
+  }
+
+  Status Insert(const std::string& key, const std::string& value) {
+    std::string item = value;
+    return cache_->Insert(key, &item, &helper_);
+  }
+
+  // The value, or "NOT_FOUND"
+  std::string Get(const std::string& key) {
+    std::unique_ptr<SecondaryCacheResultHandle> handle =
+        cache_->Lookup(key, creator_, /*wait=*/true);
+    if (handle == nullptr) {
+      return "NOT_FOUND";
+    }
+    EXPECT_TRUE(handle->IsReady());
+    std::unique_ptr<std::string> value(
+        reinterpret_cast<std::string*>(handle->Value()));
+    EXPECT_EQ(value->size(), handle->Size());
+    return *value;
+  }
+
+  Env* env_;
+  std::string path_;
+  FileSecondaryCacheOptions opts_;
+  std::shared_ptr<SecondaryCache> cache_;
+};
+
+Cache::CacheItemHelper FileSecondaryCacheTest::helper_(
+    FileSecondaryCacheTest::SizeCallback,
+    FileSecondaryCacheTest::SaveToCallback,
+    FileSecondaryCacheTest::DeletionCallback);
+
+TEST_F(FileSecondaryCacheTest, Basic) {
+  Open();
+  ASSERT_EQ("NOT_FOUND", Get("k1"));
+  ASSERT_OK(Insert("k1", "v1"));
+  ASSERT_OK(Insert("k2", std::string(1000, 'x')));
+  ASSERT_EQ("v1", Get("k1"));
+  ASSERT_EQ(std::string(1000, 'x'), Get("k2"));
+
+  cache_->Erase("k1");
+  ASSERT_EQ("NOT_FOUND", Get("k1"));
+  ASSERT_EQ(std::string(1000, 'x'), Get("k2"));
+
+  // Larger than a region
+  ASSERT_OK(Insert("k3", std::string(opts_.region_size, 'x')));
+  ASSERT_EQ("NOT_FOUND", Get("k3"));
+}
+
+TEST_F(FileSecondaryCacheTest, AdmissionThreshold) {
+  opts_.admission_threshold = 2;
+  Open();
+  ASSERT_OK(Insert("k1", "v1"));
+  ASSERT_EQ(0U, file_cache()->TEST_GetUsage());
+  ASSERT_OK(Insert("k1", "v1"));
+  ASSERT_EQ("v1", Get("k1"));
+
+  // A lookup counts as an access too
+  ASSERT_EQ("NOT_FOUND", Get("k2"));
+  ASSERT_OK(Insert("k2", "v2"));
+  ASSERT_EQ("v2", Get("k2"));
+}
+
+TEST_F(FileSecondaryCacheTest, AsyncLookup) {
+  Open();
+  const int kNumKeys = 50;
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_OK(Insert("k" + std::to_string(i), "v" + std::to_string(i)));
+  }
+  for (int round = 0; round < 3; round++) {
+    std::vector<std::unique_ptr<SecondaryCacheResultHandle>> handles;
+    std::vector<SecondaryCacheResultHandle*> raw_handles;
+    for (int i = 0; i < kNumKeys; i++) {
+      handles.push_back(cache_->Lookup("k" + std::to_string(i), creator_,
+                                       /*wait=*/false));
+      ASSERT_NE(nullptr, handles.back());
+      raw_handles.push_back(handles.back().get());
+    }
+    if (round == 0) {
+      cache_->WaitAll(raw_handles);
+    }
+    for (int i = 0; i < kNumKeys; i++) {
+      if (round == 1) {
+        handles[i]->Wait();
+      }
+      // Whichever way the reads went, all must complete
+      if (round == 2) {
+        cache_->WaitAll({raw_handles[i]});
+      }
+      ASSERT_TRUE(handles[i]->IsReady());
+      std::unique_ptr<std::string> value(
+          reinterpret_cast<std::string*>(handles[i]->Value()));
+      ASSERT_NE(nullptr, value);
+      ASSERT_EQ("v" + std::to_string(i), *value);
+    }
+  }
+}
+
+TEST_F(FileSecondaryCacheTest, RegionEviction) {
+  Open();
+  Random rnd(301);
+  const size_t kValueSize = 1000;
+  const int kNumKeys = 200;
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_OK(Insert("k" + std::to_string(i), rnd.RandomString(kValueSize)));
+    ASSERT_LE(file_cache()->TEST_GetUsage(), opts_.capacity);
+  }
+  ASSERT_LE(file_cache()->TEST_GetNumRegions(),
+            opts_.capacity / opts_.region_size);
+  std::vector<std::string> files;
+  ASSERT_OK(env_->GetChildren(path_, &files));
+  ASSERT_EQ(file_cache()->TEST_GetNumRegions(), files.size());
+
+  // The oldest entries are gone with their regions, the newest are kept
+  ASSERT_EQ("NOT_FOUND", Get("k0"));
+  ASSERT_EQ(kValueSize, Get("k" + std::to_string(kNumKeys - 1)).size());
+}
+
+TEST_F(FileSecondaryCacheTest, Reopen) {
+  Open();
+  ASSERT_OK(Insert("k1", "v1"));
+  ASSERT_OK(Insert("k2", "v2"));
+  cache_->Erase("k2");
+  ASSERT_OK(Insert("k3", "v3"));
+  size_t usage = file_cache()->TEST_GetUsage();
+
+  Open();
+  ASSERT_EQ(usage, file_cache()->TEST_GetUsage());
+  ASSERT_EQ("v1", Get("k1"));
+  ASSERT_EQ("NOT_FOUND", Get("k2"));
+  ASSERT_EQ("v3", Get("k3"));
+  // Appends go to a new region
+  ASSERT_OK(Insert("k4", "v4"));
+  ASSERT_EQ(2U, file_cache()->TEST_GetNumRegions());
+
+  // A torn record at the end of a region is ignored
+  cache_.reset();
+  std::vector<std::string> files;
+  ASSERT_OK(env_->GetChildren(path_, &files));
+  std::sort(files.begin(), files.end());
+  std::unique_ptr<WritableFile> file;
+  ASSERT_OK(env_->ReopenWritableFile(path_ + "/" + files.back(), &file,
+                                     EnvOptions()));
+  ASSERT_OK(file->Append("garbage"));
+  ASSERT_OK(file->Close());
+  Open();
+  ASSERT_EQ("v1", Get("k1"));
+  ASSERT_EQ("v4", Get("k4"));
+}
+
+TEST_F(FileSecondaryCacheTest, WithLRUCache) {
+  Open();
+  LRUCacheOptions opts(1024, 0, false, 0.5, nullptr, kDefaultToAdaptiveMutex,
+                       kDontChargeCacheMetadata);
+  opts.secondary_cache = cache_;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+
+  Random rnd(301);
+  std::string str1 = rnd.RandomString(1000);
+  std::string str2 = rnd.RandomString(1000);
+  ASSERT_OK(cache->Insert("k1", new std::string(str1), &helper_, str1.size()));
+  // k1 is demoted to the file
+  ASSERT_OK(cache->Insert("k2", new std::string(str2), &helper_, str2.size()));
+  ASSERT_EQ(nullptr, cache->Lookup("k1"));
+
+  Cache::Handle* handle = cache->Lookup("k1", &helper_, creator_,
+                                        Cache::Priority::LOW, /*wait=*/false);
+  ASSERT_NE(nullptr, handle);
+  std::vector<Cache::Handle*> handles = {handle};
+  cache->WaitAll(handles);
+  ASSERT_TRUE(cache->IsReady(handle));
+  ASSERT_EQ(str1, *reinterpret_cast<std::string*>(cache->Value(handle)));
+  cache->Release(handle);
+
+  // k2 was demoted in turn
+  handle = cache->Lookup("k2", &helper_, creator_, Cache::Priority::LOW,
+                         /*wait=*/true);
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(str2, *reinterpret_cast<std::string*>(cache->Value(handle)));
+  cache->Release(handle);
+}
+
+TEST_F(FileSecondaryCacheTest, InvalidOptions) {
+  std::shared_ptr<SecondaryCache> cache;
+  FileSecondaryCacheOptions opts = opts_;
+  opts.path.clear();
+  ASSERT_TRUE(NewFileSecondaryCache(opts, &cache).IsInvalidArgument());
+  opts = opts_;
+  opts.capacity = opts.region_size - 1;
+  ASSERT_TRUE(NewFileSecondaryCache(opts, &cache).IsInvalidArgument());
+  ASSERT_EQ(nullptr, cache);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
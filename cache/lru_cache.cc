@@ -9,17 +9,43 @@
 
 #include "cache/lru_cache.h"
 
+#ifdef NUMA
+#include <numa.h>
+#endif  // NUMA
+
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
+#include <vector>
 
+#include "memory/memory_allocator.h"
 #include "monitoring/perf_context_imp.h"
 #include "monitoring/statistics.h"
 #include "port/lang.h"
+#include "util/aligned_buffer.h"
+#include "util/compression.h"
 #include "util/mutexlock.h"
 
 namespace ROCKSDB_NAMESPACE {
 
+namespace {
+// The value of an entry of the compressed tier
+struct CompressedValue {
+  CacheAllocationPtr data;
+  size_t size;
+};
+
+void DeleteCompressedValue(const Slice& /*key*/, void* value) {
+  delete static_cast<CompressedValue*>(value);
+}
+
+constexpr uint32_t kCompressFormatVersion = 2;
+// Compression credits, see LRUCacheShard::ShouldCompress()
+constexpr int32_t kMaxCompressionCredits = 1024;
+constexpr int32_t kCompressionCreditsPerHit = 16;
+constexpr uint32_t kCompressionProbeInterval = 16;
+}  // namespace
+
 LRUHandleTable::LRUHandleTable(int max_upper_hash_bits)
     : length_bits_(/* historical starting size*/ 4),
       list_(new LRUHandle* [size_t{1} << length_bits_] {}),
@@ -113,7 +139,11 @@ LRUCacheShard::LRUCacheShard(
     size_t capacity, bool strict_capacity_limit, double high_pri_pool_ratio,
     bool use_adaptive_mutex, CacheMetadataChargePolicy metadata_charge_policy,
     int max_upper_hash_bits,
-    const std::shared_ptr<SecondaryCache>& secondary_cache)
+    const std::shared_ptr<SecondaryCache>& secondary_cache,
+    size_t tiny_lfu_sketch_entries,
+    const std::shared_ptr<CacheEvictionListener>& eviction_listener,
+    CompressionType compressed_tier_compression,
+    MemoryAllocator* memory_allocator)
     : capacity_(0),
       high_pri_pool_usage_(0),
       strict_capacity_limit_(strict_capacity_limit),
@@ -122,8 +152,21 @@ LRUCacheShard::LRUCacheShard(
       table_(max_upper_hash_bits),
       usage_(0),
       lru_usage_(0),
+      insert_tick_(0),
       mutex_(use_adaptive_mutex),
-      secondary_cache_(secondary_cache) {
+      secondary_cache_(secondary_cache),
+      admission_sketch_(tiny_lfu_sketch_entries > 0
+                            ? new FrequencySketch(tiny_lfu_sketch_entries)
+                            : nullptr),
+      eviction_listener_(eviction_listener),
+      compressed_tier_compression_(
+          secondary_cache == nullptr &&
+                  CompressionTypeSupported(compressed_tier_compression)
+              ? compressed_tier_compression
+              : kNoCompression),
+      memory_allocator_(memory_allocator),
+      compression_credits_(kMaxCompressionCredits),
+      compression_skips_(0) {
   set_metadata_charge_policy(metadata_charge_policy);
   // Make empty circular linked list
   lru_.next = &lru_;
@@ -244,6 +287,18 @@ void LRUCacheShard::LRU_Insert(LRUHandle* e) {
     e->SetInHighPriPool(true);
     high_pri_pool_usage_ += total_charge;
     MaintainPoolSize();
+  } else if (e->IsBottomPri() && !e->HasHit()) {
+    // Insert "e" to the tail of LRU list, to be evicted first unless a hit
+    // moves it up when it is next released.
+    e->next = lru_.next;
+    e->prev = &lru_;
+    e->prev->next = e;
+    e->next->prev = e;
+    e->SetInHighPriPool(false);
+    if (lru_low_pri_ == &lru_) {
+      // The only entry of the low-pri pool
+      lru_low_pri_ = e;
+    }
   } else {
     // Insert "e" to the head of low-pri pool. Note that when
     // high_pri_pool_ratio is 0, head of low-pri pool is also head of LRU list.
@@ -286,27 +341,184 @@ void LRUCacheShard::EvictFromLRU(size_t charge,
   }
 }
 
+void LRUCacheShard::NotifyEvicted(const autovector<LRUHandle*>& deleted,
+                                  size_t num_evicted, uint32_t insert_tick) {
+  if (eviction_listener_ == nullptr || num_evicted == 0) {
+    return;
+  }
+  std::vector<CacheEvictionInfo> evicted(num_evicted);
+  for (size_t i = 0; i < num_evicted; i++) {
+    const LRUHandle* e = deleted[i];
+    CacheEvictionInfo& info = evicted[i];
+    info.key = e->key();
+    info.value = e->value;
+    info.charge = e->charge;
+    info.deleter = e->IsSecondaryCacheCompatible() ? e->info_.helper->del_cb
+                                                   : e->info_.deleter;
+    info.hit_count = e->hit_count;
+    info.residency = insert_tick - e->insert_tick;
+    info.high_priority = e->IsHighPri();
+  }
+  eviction_listener_->OnEvict(evicted.data(), evicted.size());
+}
+
 void LRUCacheShard::SetCapacity(size_t capacity) {
   autovector<LRUHandle*> last_reference_list;
+  uint32_t insert_tick;
   {
     MutexLock l(&mutex_);
     capacity_ = capacity;
     high_pri_pool_capacity_ = capacity_ * high_pri_pool_ratio_;
     EvictFromLRU(0, &last_reference_list);
+    insert_tick = insert_tick_;
+  }
+  NotifyEvicted(last_reference_list, last_reference_list.size(), insert_tick);
+  FreeEvictedEntries(last_reference_list);
+}
+
+void LRUCacheShard::FreeEvictedEntries(
+    const autovector<LRUHandle*>& evicted_entries) {
+  autovector<LRUHandle*> compressed;
+  FreeEntries(evicted_entries, &compressed);
+  // Inserting the compressed entries can evict entries to compress in turn,
+  // each round evicting less than the one before
+  while (!compressed.empty()) {
+    autovector<LRUHandle*> evicted;
+    autovector<LRUHandle*> last_reference_list;
+    uint32_t insert_tick;
+    {
+      MutexLock l(&mutex_);
+      insert_tick = insert_tick_;
+      for (LRUHandle* e : compressed) {
+        if (table_.Lookup(e->key(), e->hash) != nullptr) {
+          // Inserted again since evicted
+          e->SetInCache(false);
+          last_reference_list.push_back(e);
+          continue;
+        }
+        InsertItemLocked(e, nullptr, /*free_handle_on_fail=*/true, &evicted,
+                         &last_reference_list)
+            .PermitUncheckedError();
+      }
+    }
+    NotifyEvicted(evicted, evicted.size(), insert_tick);
+    compressed.clear();
+    FreeEntries(evicted, &compressed);
+    FreeEntries(last_reference_list);
   }
+}
 
+void LRUCacheShard::FreeEntries(const autovector<LRUHandle*>& entries,
+                                autovector<LRUHandle*>* compressed) {
   // Try to insert the evicted entries into tiered cache
   // Free the entries outside of mutex for performance reasons
-  for (auto entry : last_reference_list) {
+  for (auto entry : entries) {
     if (secondary_cache_ && entry->IsSecondaryCacheCompatible() &&
         !entry->IsPromoted()) {
       secondary_cache_->Insert(entry->key(), entry->value, entry->info_.helper)
           .PermitUncheckedError();
+    } else if (compressed != nullptr && ShouldCompress(entry)) {
+      LRUHandle* c = NewCompressedEntry(entry);
+      if (c != nullptr) {
+        compressed->push_back(c);
+      }
     }
     entry->Free();
   }
 }
 
+bool LRUCacheShard::ShouldCompress(const LRUHandle* e) {
+  if (compressed_tier_compression_ == kNoCompression ||
+      !e->IsSecondaryCacheCompatible() || e->value == nullptr ||
+      e->info_.helper->size_cb == nullptr ||
+      e->info_.helper->saveto_cb == nullptr) {
+    return false;
+  }
+  // Every compressed entry costs a credit, and every hit on one earns
+  // kCompressionCreditsPerHit. Without credits left, only every
+  // kCompressionProbeInterval-th entry is compressed, to notice when hits
+  // come back.
+  if (compression_credits_.load(std::memory_order_relaxed) > 0) {
+    compression_credits_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+  return compression_skips_.fetch_add(1, std::memory_order_relaxed) %
+             kCompressionProbeInterval ==
+         0;
+}
+
+LRUHandle* LRUCacheShard::NewCompressedEntry(const LRUHandle* e) {
+  const Cache::CacheItemHelper* helper = e->info_.helper;
+  size_t size = (*helper->size_cb)(e->value);
+  CacheAllocationPtr buf = AllocateBlock(size, memory_allocator_);
+  if (!(*helper->saveto_cb)(e->value, 0, size, buf.get()).ok()) {
+    return nullptr;
+  }
+
+  CompressionOptions compression_opts;
+  CompressionContext compression_context(compressed_tier_compression_);
+  CompressionInfo compression_info(
+      compression_opts, compression_context, CompressionDict::GetEmptyDict(),
+      compressed_tier_compression_, 0 /* sample_for_compression */);
+  std::string compressed_data;
+  if (!CompressData(Slice(buf.get(), size), compression_info,
+                    kCompressFormatVersion, &compressed_data) ||
+      compressed_data.size() > size / 8 * 7) {
+    return nullptr;
+  }
+
+  CompressedValue* value = new CompressedValue;
+  value->size = compressed_data.size();
+  value->data = AllocateBlock(value->size, memory_allocator_);
+  memcpy(value->data.get(), compressed_data.data(), value->size);
+  LRUHandle* c = NewEntry(e->key(), e->hash, value, value->size,
+                          &DeleteCompressedValue, nullptr /* helper */,
+                          Cache::Priority::LOW);
+  c->SetCompressed();
+  return c;
+}
+
+LRUHandle* LRUCacheShard::Decompress(
+    LRUHandle* e, const ShardedCache::CacheItemHelper* helper,
+    const ShardedCache::CreateCallback& create_cb, Cache::Priority priority) {
+  const CompressedValue* compressed =
+      static_cast<const CompressedValue*>(e->value);
+  UncompressionContext uncompression_context(compressed_tier_compression_);
+  UncompressionInfo uncompression_info(uncompression_context,
+                                       UncompressionDict::GetEmptyDict(),
+                                       compressed_tier_compression_);
+  size_t uncompressed_size = 0;
+  CacheAllocationPtr uncompressed = UncompressData(
+      uncompression_info, compressed->data.get(), compressed->size,
+      &uncompressed_size, kCompressFormatVersion, memory_allocator_);
+  void* value = nullptr;
+  size_t charge = 0;
+  if (!uncompressed ||
+      !create_cb(uncompressed.get(), uncompressed_size, &value, &charge)
+           .ok()) {
+    Release(reinterpret_cast<Cache::Handle*>(e), /*force_erase=*/true);
+    return nullptr;
+  }
+
+  // Overwrites e, which stays allocated until released
+  LRUHandle* result =
+      NewEntry(e->key(), e->hash, value, charge, nullptr, helper, priority);
+  result->SetHit();
+  Cache::Handle* handle = nullptr;
+  Status s = InsertItem(result, &handle, /*free_handle_on_fail=*/true);
+  if (!s.ok()) {
+    (*helper->del_cb)(e->key(), value);
+  }
+  Release(reinterpret_cast<Cache::Handle*>(e));
+  int32_t credits = compression_credits_.load(std::memory_order_relaxed);
+  if (credits < kMaxCompressionCredits) {
+    compression_credits_.store(
+        std::min(credits + kCompressionCreditsPerHit, kMaxCompressionCredits),
+        std::memory_order_relaxed);
+  }
+  return reinterpret_cast<LRUHandle*>(handle);
+}
+
 void LRUCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
   MutexLock l(&mutex_);
   strict_capacity_limit_ = strict_capacity_limit;
@@ -314,76 +526,102 @@ void LRUCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
 
 Status LRUCacheShard::InsertItem(LRUHandle* e, Cache::Handle** handle,
                                  bool free_handle_on_fail) {
-  Status s = Status::OK();
+  Status s;
+  autovector<LRUHandle*> evicted;
   autovector<LRUHandle*> last_reference_list;
-  size_t total_charge = e->CalcTotalCharge(metadata_charge_policy_);
-
+  uint32_t insert_tick;
   {
     MutexLock l(&mutex_);
+    // The tick InsertItemLocked() gives e
+    insert_tick = insert_tick_;
+    s = InsertItemLocked(e, handle, free_handle_on_fail, &evicted,
+                         &last_reference_list);
+  }
+  NotifyEvicted(evicted, evicted.size(), insert_tick);
+  FreeEvictedEntries(evicted);
+  FreeEntries(last_reference_list);
+  return s;
+}
+
+Status LRUCacheShard::InsertItemLocked(
+    LRUHandle* e, Cache::Handle** handle, bool free_handle_on_fail,
+    autovector<LRUHandle*>* evicted,
+    autovector<LRUHandle*>* last_reference_list) {
+  Status s = Status::OK();
+  size_t total_charge = e->CalcTotalCharge(metadata_charge_policy_);
+  e->insert_tick = insert_tick_++;
+
+  // With TinyLFU admission, a low-pri entry only evicts if it was accessed
+  // more often recently than the first victim. Otherwise it is treated like
+  // an entry that does not fit into the cache.
+  bool admitted = admission_sketch_ == nullptr || e->IsHighPri() ||
+                  e->HasRefs() || (usage_ + total_charge) <= capacity_ ||
+                  lru_.next == &lru_ || AdmitOverVictim(e, lru_.next);
 
+  if (admitted) {
     // Free the space following strict LRU policy until enough space
     // is freed or the lru list is empty
-    EvictFromLRU(total_charge, &last_reference_list);
+    EvictFromLRU(total_charge, evicted);
+  }
 
-    if ((usage_ + total_charge) > capacity_ &&
-        (strict_capacity_limit_ || handle == nullptr)) {
-      e->SetInCache(false);
-      if (handle == nullptr) {
-        // Don't insert the entry but still return ok, as if the entry inserted
-        // into cache and get evicted immediately.
-        last_reference_list.push_back(e);
-      } else {
-        if (free_handle_on_fail) {
-          delete[] reinterpret_cast<char*>(e);
-          *handle = nullptr;
-        }
-        s = Status::Incomplete("Insert failed due to LRU cache being full.");
-      }
+  if ((!admitted || (usage_ + total_charge) > capacity_) &&
+      (strict_capacity_limit_ || handle == nullptr)) {
+    e->SetInCache(false);
+    if (handle == nullptr) {
+      // Don't insert the entry but still return ok, as if the entry inserted
+      // into cache and get evicted immediately.
+      last_reference_list->push_back(e);
     } else {
-      // Insert into the cache. Note that the cache might get larger than its
-      // capacity if not enough space was freed up.
-      LRUHandle* old = table_.Insert(e);
-      usage_ += total_charge;
-      if (old != nullptr) {
-        s = Status::OkOverwritten();
-        assert(old->InCache());
-        old->SetInCache(false);
-        if (!old->HasRefs()) {
-          // old is on LRU because it's in cache and its reference count is 0
-          LRU_Remove(old);
-          size_t old_total_charge =
-              old->CalcTotalCharge(metadata_charge_policy_);
-          assert(usage_ >= old_total_charge);
-          usage_ -= old_total_charge;
-          last_reference_list.push_back(old);
-        }
+      if (free_handle_on_fail) {
+        delete[] reinterpret_cast<char*>(e);
+        *handle = nullptr;
       }
-      if (handle == nullptr) {
-        LRU_Insert(e);
-      } else {
-        // If caller already holds a ref, no need to take one here
-        if (!e->HasRefs()) {
-          e->Ref();
-        }
-        *handle = reinterpret_cast<Cache::Handle*>(e);
+      s = Status::Incomplete("Insert failed due to LRU cache being full.");
+    }
+  } else if (!admitted) {
+    // Hand out the entry without inserting it; it is charged until the
+    // caller releases it, like any other referenced entry.
+    e->SetInCache(false);
+    e->Ref();
+    usage_ += total_charge;
+    *handle = reinterpret_cast<Cache::Handle*>(e);
+  } else {
+    // Insert into the cache. Note that the cache might get larger than its
+    // capacity if not enough space was freed up.
+    LRUHandle* old = table_.Insert(e);
+    usage_ += total_charge;
+    if (old != nullptr) {
+      s = Status::OkOverwritten();
+      assert(old->InCache());
+      old->SetInCache(false);
+      if (!old->HasRefs()) {
+        // old is on LRU because it's in cache and its reference count is 0
+        LRU_Remove(old);
+        size_t old_total_charge = old->CalcTotalCharge(metadata_charge_policy_);
+        assert(usage_ >= old_total_charge);
+        usage_ -= old_total_charge;
+        last_reference_list->push_back(old);
       }
     }
-  }
-
-  // Try to insert the evicted entries into the secondary cache
-  // Free the entries here outside of mutex for performance reasons
-  for (auto entry : last_reference_list) {
-    if (secondary_cache_ && entry->IsSecondaryCacheCompatible() &&
-        !entry->IsPromoted()) {
-      secondary_cache_->Insert(entry->key(), entry->value, entry->info_.helper)
-          .PermitUncheckedError();
+    if (handle == nullptr) {
+      LRU_Insert(e);
+    } else {
+      // If caller already holds a ref, no need to take one here
+      if (!e->HasRefs()) {
+        e->Ref();
+      }
+      *handle = reinterpret_cast<Cache::Handle*>(e);
     }
-    entry->Free();
   }
-
   return s;
 }
 
+bool LRUCacheShard::AdmitOverVictim(const LRUHandle* e,
+                                    const LRUHandle* victim) const {
+  return admission_sketch_->Estimate(FrequencySketch::Spread(e->hash)) >
+         admission_sketch_->Estimate(FrequencySketch::Spread(victim->hash));
+}
+
 void LRUCacheShard::Promote(LRUHandle* e) {
   SecondaryCacheResultHandle* secondary_handle = e->sec_handle;
 
@@ -416,31 +654,81 @@ void LRUCacheShard::Promote(LRUHandle* e) {
   }
 }
 
+void LRUCacheShard::RefFound(LRUHandle* e) {
+  assert(e->InCache());
+  if (!e->HasRefs()) {
+    // The entry is in LRU since it's in hash and has no external references
+    LRU_Remove(e);
+  }
+  e->Ref();
+  e->SetHit();
+  if (e->hit_count < UINT32_MAX) {
+    e->hit_count++;
+  }
+}
+
 Cache::Handle* LRUCacheShard::Lookup(
     const Slice& key, uint32_t hash,
     const ShardedCache::CacheItemHelper* helper,
     const ShardedCache::CreateCallback& create_cb, Cache::Priority priority,
     bool wait, Statistics* stats) {
+  return LookupWithFallback(key, hash, helper, create_cb, priority, wait,
+                            stats, nullptr);
+}
+
+Cache::Handle* LRUCacheShard::LookupWithFallback(
+    const Slice& key, uint32_t hash,
+    const ShardedCache::CacheItemHelper* helper,
+    const ShardedCache::CreateCallback& create_cb, Cache::Priority priority,
+    bool wait, Statistics* stats,
+    const std::function<Cache::Handle*()>& fallback) {
+  if (admission_sketch_ != nullptr) {
+    admission_sketch_->Increment(FrequencySketch::Spread(hash));
+  }
   LRUHandle* e = nullptr;
   {
     MutexLock l(&mutex_);
     e = table_.Lookup(key, hash);
     if (e != nullptr) {
-      assert(e->InCache());
-      if (!e->HasRefs()) {
-        // The entry is in LRU since it's in hash and has no external references
-        LRU_Remove(e);
+      if (e->IsCompressed() && !(helper && create_cb)) {
+        // Only callers that can recreate the object use the compressed tier
+        e = nullptr;
+      } else {
+        RefFound(e);
       }
-      e->Ref();
-      e->SetHit();
     }
   }
+  if (e != nullptr && e->IsCompressed()) {
+    e = Decompress(e, helper, create_cb, priority);
+    if (e != nullptr) {
+      RecordTick(stats, COMPRESSED_TIER_HITS);
+    }
+    return reinterpret_cast<Cache::Handle*>(e);
+  }
 
+  if (!e && fallback) {
+    Cache::Handle* handle = fallback();
+    if (handle != nullptr) {
+      return handle;
+    }
+  }
   // If handle table lookup failed, then allocate a handle outside the
   // mutex if we're going to lookup in the secondary cache
+  if (!e) {
+    e = LookupSecondary(key, hash, helper, create_cb, priority, wait, stats);
+  }
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+LRUHandle* LRUCacheShard::LookupSecondary(
+    const Slice& key, uint32_t hash,
+    const ShardedCache::CacheItemHelper* helper,
+    const ShardedCache::CreateCallback& create_cb, Cache::Priority priority,
+    bool wait, Statistics* stats) {
+  LRUHandle* e = nullptr;
   // Only support synchronous for now
   // TODO: Support asynchronous lookup in secondary cache
-  if (!e && secondary_cache_ && helper && helper->saveto_cb) {
+  if (secondary_cache_ && helper && helper->saveto_cb) {
     // For objects from the secondary cache, we expect the caller to provide
     // a way to create/delete the primary cache object. The only case where
     // a deleter would not be required is for dummy entries inserted for
@@ -459,6 +747,8 @@ Cache::Handle* LRUCacheShard::Lookup(
       e->key_length = key.size();
       e->hash = hash;
       e->refs = 0;
+      e->hit_count = 0;
+      e->insert_tick = 0;
       e->next = e->prev = nullptr;
       e->SetPriority(priority);
       memcpy(e->key_data, key.data(), key.size());
@@ -488,7 +778,7 @@ Cache::Handle* LRUCacheShard::Lookup(
       }
     }
   }
-  return reinterpret_cast<Cache::Handle*>(e);
+  return e;
 }
 
 bool LRUCacheShard::Ref(Cache::Handle* h) {
@@ -549,14 +839,99 @@ bool LRUCacheShard::Release(Cache::Handle* handle, bool force_erase) {
   return last_reference;
 }
 
-Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
-                             size_t charge,
-                             void (*deleter)(const Slice& key, void* value),
-                             const Cache::CacheItemHelper* helper,
-                             Cache::Handle** handle, Cache::Priority priority) {
-  // Allocate the memory here outside of the mutex
-  // If the cache is full, we'll have to release it
-  // It shouldn't happen very often though.
+void LRUCacheShard::MultiLookup(const Slice* keys, const uint32_t* hashes,
+                                const size_t* indices, size_t count,
+                                const ShardedCache::CacheItemHelper* helper,
+                                const ShardedCache::CreateCallback& create_cb,
+                                Cache::Priority priority, bool wait,
+                                Statistics* stats, Cache::Handle** handles) {
+  if (admission_sketch_ != nullptr) {
+    for (size_t i = 0; i < count; ++i) {
+      admission_sketch_->Increment(FrequencySketch::Spread(hashes[indices[i]]));
+    }
+  }
+  bool any_beyond_table = false;
+  {
+    MutexLock l(&mutex_);
+    // Load the buckets of all keys in parallel before walking them
+    for (size_t i = 0; i < count; ++i) {
+      table_.Prefetch(hashes[indices[i]]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      size_t idx = indices[i];
+      LRUHandle* e = table_.Lookup(keys[idx], hashes[idx]);
+      if (e != nullptr && e->IsCompressed() && !(helper && create_cb)) {
+        // Only callers that can recreate the object use the compressed tier
+        e = nullptr;
+      }
+      if (e != nullptr) {
+        RefFound(e);
+      }
+      any_beyond_table |= e == nullptr || e->IsCompressed();
+      handles[idx] = reinterpret_cast<Cache::Handle*>(e);
+    }
+  }
+  if (!any_beyond_table || helper == nullptr) {
+    return;
+  }
+  // As in Lookup(), outside the mutex
+  for (size_t i = 0; i < count; ++i) {
+    size_t idx = indices[i];
+    LRUHandle* e = reinterpret_cast<LRUHandle*>(handles[idx]);
+    if (e == nullptr) {
+      e = LookupSecondary(keys[idx], hashes[idx], helper, create_cb, priority,
+                          wait, stats);
+    } else if (e->IsCompressed()) {
+      e = Decompress(e, helper, create_cb, priority);
+      if (e != nullptr) {
+        RecordTick(stats, COMPRESSED_TIER_HITS);
+      }
+    }
+    handles[idx] = reinterpret_cast<Cache::Handle*>(e);
+  }
+}
+
+void LRUCacheShard::MultiInsert(const Slice* keys, const uint32_t* hashes,
+                                const size_t* indices, size_t count,
+                                void* const* values, const size_t* charges,
+                                Cache::DeleterFn deleter,
+                                Cache::Handle** handles,
+                                Cache::Priority priority, Status* statuses) {
+  // Allocate the entries outside of the mutex, as Insert() does
+  autovector<LRUHandle*> entries;
+  for (size_t i = 0; i < count; ++i) {
+    size_t idx = indices[i];
+    entries.push_back(NewEntry(keys[idx], hashes[idx], values[idx],
+                               charges[idx], deleter, nullptr, priority));
+  }
+  autovector<LRUHandle*> evicted;
+  autovector<LRUHandle*> last_reference_list;
+  uint32_t insert_tick = 0;
+  {
+    MutexLock l(&mutex_);
+    for (size_t i = 0; i < count; ++i) {
+      table_.Prefetch(hashes[indices[i]]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      size_t idx = indices[i];
+      insert_tick = insert_tick_;
+      statuses[idx] = InsertItemLocked(
+          entries[i], handles ? &handles[idx] : nullptr,
+          /*free_handle_on_fail=*/true, &evicted, &last_reference_list);
+    }
+  }
+  // The residency of the entries evicted by the batch is counted up to its
+  // last insertion
+  NotifyEvicted(evicted, evicted.size(), insert_tick);
+  FreeEvictedEntries(evicted);
+  FreeEntries(last_reference_list);
+}
+
+LRUHandle* LRUCacheShard::NewEntry(const Slice& key, uint32_t hash,
+                                   void* value, size_t charge,
+                                   DeleterFn deleter,
+                                   const Cache::CacheItemHelper* helper,
+                                   Cache::Priority priority) {
   LRUHandle* e = reinterpret_cast<LRUHandle*>(
       new char[sizeof(LRUHandle) - 1 + key.size()]);
 
@@ -575,11 +950,24 @@ Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
   e->key_length = key.size();
   e->hash = hash;
   e->refs = 0;
+  e->hit_count = 0;
   e->next = e->prev = nullptr;
   e->SetInCache(true);
   e->SetPriority(priority);
   memcpy(e->key_data, key.data(), key.size());
+  return e;
+}
 
+Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
+                             size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             const Cache::CacheItemHelper* helper,
+                             Cache::Handle** handle, Cache::Priority priority) {
+  // Allocate the memory here outside of the mutex
+  // If the cache is full, we'll have to release it
+  // It shouldn't happen very often though.
+  LRUHandle* e =
+      NewEntry(key, hash, value, charge, deleter, helper, priority);
   return InsertItem(e, handle, /* free_handle_on_fail */ true);
 }
 
@@ -641,7 +1029,15 @@ std::string LRUCacheShard::GetPrintableOptions() const {
     snprintf(buffer, kBufferSize, "    high_pri_pool_ratio: %.3lf\n",
              high_pri_pool_ratio_);
   }
-  return std::string(buffer);
+  std::string ret(buffer);
+  snprintf(buffer, kBufferSize, "    tiny_lfu_sketch_words: %" ROCKSDB_PRIszt
+           "\n",
+           admission_sketch_ ? admission_sketch_->NumWords() : size_t{0});
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "    compressed_tier_compression: %s\n",
+           CompressionTypeToString(compressed_tier_compression_).c_str());
+  ret.append(buffer);
+  return ret;
 }
 
 LRUCache::LRUCache(size_t capacity, int num_shard_bits,
@@ -649,18 +1045,55 @@ LRUCache::LRUCache(size_t capacity, int num_shard_bits,
                    std::shared_ptr<MemoryAllocator> allocator,
                    bool use_adaptive_mutex,
                    CacheMetadataChargePolicy metadata_charge_policy,
-                   const std::shared_ptr<SecondaryCache>& secondary_cache)
+                   const std::shared_ptr<SecondaryCache>& secondary_cache,
+                   size_t tiny_lfu_sketch_entries,
+                   const std::shared_ptr<CacheEvictionListener>&
+                       eviction_listener,
+                   bool numa_aware,
+                   CompressionType compressed_tier_compression)
     : ShardedCache(capacity, num_shard_bits, strict_capacity_limit,
                    std::move(allocator)) {
   num_shards_ = 1 << num_shard_bits;
-  shards_ = reinterpret_cast<LRUCacheShard*>(
-      port::cacheline_aligned_alloc(sizeof(LRUCacheShard) * num_shards_));
+  uint32_t numa_groups = numa_aware ? EnableNumaGroups() : 1;
+#ifdef NUMA
+  if (numa_groups > 1) {
+    // Bind the pages of the shards of each group to its node, a page
+    // straddling two groups going to the first
+    size_t bytes = sizeof(LRUCacheShard) * num_shards_;
+    void* mem = numa_alloc(bytes);
+    if (mem != nullptr) {
+      size_t page_size = static_cast<size_t>(numa_pagesize());
+      size_t group_bytes = bytes / numa_groups;
+      for (uint32_t group = 0; group < numa_groups; group++) {
+        size_t begin = Roundup(group * group_bytes, page_size);
+        size_t end = Roundup((group + 1) * group_bytes, page_size);
+        if (end > begin) {
+          numa_tonode_memory(
+              static_cast<char*>(mem) + begin, end - begin,
+              static_cast<int>(group) % port::NumaNodeCount());
+        }
+      }
+      shards_ = reinterpret_cast<LRUCacheShard*>(mem);
+      shards_numa_bytes_ = bytes;
+    }
+  }
+#else
+  (void)numa_groups;
+#endif  // NUMA
+  if (shards_ == nullptr) {
+    shards_ = reinterpret_cast<LRUCacheShard*>(
+        port::cacheline_aligned_alloc(sizeof(LRUCacheShard) * num_shards_));
+  }
   size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
+  size_t sketch_entries_per_shard =
+      (tiny_lfu_sketch_entries + (num_shards_ - 1)) / num_shards_;
   for (int i = 0; i < num_shards_; i++) {
     new (&shards_[i]) LRUCacheShard(
         per_shard, strict_capacity_limit, high_pri_pool_ratio,
         use_adaptive_mutex, metadata_charge_policy,
-        /* max_upper_hash_bits */ 32 - num_shard_bits, secondary_cache);
+        /* max_upper_hash_bits */ 32 - num_shard_bits, secondary_cache,
+        sketch_entries_per_shard, eviction_listener,
+        compressed_tier_compression, memory_allocator());
   }
   secondary_cache_ = secondary_cache;
 }
@@ -671,6 +1104,12 @@ LRUCache::~LRUCache() {
     for (int i = 0; i < num_shards_; i++) {
       shards_[i].~LRUCacheShard();
     }
+#ifdef NUMA
+    if (shards_numa_bytes_ > 0) {
+      numa_free(shards_, shards_numa_bytes_);
+      return;
+    }
+#endif  // NUMA
     port::cacheline_aligned_free(shards_);
   }
 }
@@ -764,28 +1203,39 @@ std::shared_ptr<Cache> NewLRUCache(
     std::shared_ptr<MemoryAllocator> memory_allocator, bool use_adaptive_mutex,
     CacheMetadataChargePolicy metadata_charge_policy,
     const std::shared_ptr<SecondaryCache>& secondary_cache) {
-  if (num_shard_bits >= 20) {
+  LRUCacheOptions cache_opts(capacity, num_shard_bits, strict_capacity_limit,
+                             high_pri_pool_ratio, std::move(memory_allocator),
+                             use_adaptive_mutex, metadata_charge_policy);
+  cache_opts.secondary_cache = secondary_cache;
+  return NewLRUCache(cache_opts);
+}
+
+std::shared_ptr<Cache> NewLRUCache(const LRUCacheOptions& cache_opts) {
+  if (cache_opts.num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
-  if (high_pri_pool_ratio < 0.0 || high_pri_pool_ratio > 1.0) {
+  if (cache_opts.high_pri_pool_ratio < 0.0 ||
+      cache_opts.high_pri_pool_ratio > 1.0) {
     // invalid high_pri_pool_ratio
     return nullptr;
   }
+  int num_shard_bits = cache_opts.num_shard_bits;
   if (num_shard_bits < 0) {
-    num_shard_bits = GetDefaultCacheShardBits(capacity);
+    num_shard_bits = GetDefaultCacheShardBits(cache_opts.capacity);
+  }
+  std::shared_ptr<MemoryAllocator> memory_allocator =
+      cache_opts.memory_allocator;
+  if (cache_opts.numa_aware && !memory_allocator) {
+    // Keeps the default allocator where NUMA is not supported
+    NewNumaMemoryAllocator(&memory_allocator).PermitUncheckedError();
   }
   return std::make_shared<LRUCache>(
-      capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio,
-      std::move(memory_allocator), use_adaptive_mutex, metadata_charge_policy,
-      secondary_cache);
-}
-
-std::shared_ptr<Cache> NewLRUCache(const LRUCacheOptions& cache_opts) {
-  return NewLRUCache(
-      cache_opts.capacity, cache_opts.num_shard_bits,
-      cache_opts.strict_capacity_limit, cache_opts.high_pri_pool_ratio,
-      cache_opts.memory_allocator, cache_opts.use_adaptive_mutex,
-      cache_opts.metadata_charge_policy, cache_opts.secondary_cache);
+      cache_opts.capacity, num_shard_bits, cache_opts.strict_capacity_limit,
+      cache_opts.high_pri_pool_ratio, memory_allocator,
+      cache_opts.use_adaptive_mutex, cache_opts.metadata_charge_policy,
+      cache_opts.secondary_cache, cache_opts.tiny_lfu_sketch_entries,
+      cache_opts.eviction_listener, cache_opts.numa_aware,
+      cache_opts.compressed_tier_compression);
 }
 
 std::shared_ptr<Cache> NewLRUCache(
@@ -8,6 +8,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -17,6 +18,7 @@
 #include "port/port.h"
 #include "rocksdb/secondary_cache.h"
 #include "util/autovector.h"
+#include "util/frequency_sketch.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -71,8 +73,12 @@ struct LRUHandle {
   uint32_t hash;
   // The number of external refs to this entry. The cache itself is not counted.
   uint32_t refs;
+  // Lookups that found the entry, saturating, for CacheEvictionListener
+  uint32_t hit_count;
+  // Value of the shard's insert_tick_ when the entry was inserted
+  uint32_t insert_tick;
 
-  enum Flags : uint8_t {
+  enum Flags : uint16_t {
     // Whether this entry is referenced by the hash table.
     IN_CACHE = (1 << 0),
     // Whether this entry is high priority entry.
@@ -87,9 +93,14 @@ struct LRUHandle {
     IS_PENDING = (1 << 5),
     // Has the item been promoted from a lower tier
     IS_PROMOTED = (1 << 6),
+    // Is the value a compressed copy of an evicted entry, see
+    // LRUCacheOptions::compressed_tier_compression
+    IS_COMPRESSED = (1 << 7),
+    // Whether this entry is bottom priority entry.
+    IS_BOTTOM_PRI = (1 << 8),
   };
 
-  uint8_t flags;
+  uint16_t flags;
 
 #ifdef __SANITIZE_THREAD__
   // TSAN can report a false data race on flags, where one thread is writing
@@ -119,6 +130,7 @@ struct LRUHandle {
 
   bool InCache() const { return flags & IN_CACHE; }
   bool IsHighPri() const { return flags & IS_HIGH_PRI; }
+  bool IsBottomPri() const { return flags & IS_BOTTOM_PRI; }
   bool InHighPriPool() const { return flags & IN_HIGH_PRI_POOL; }
   bool HasHit() const { return flags & HAS_HIT; }
   bool IsSecondaryCacheCompatible() const {
@@ -130,6 +142,7 @@ struct LRUHandle {
   }
   bool IsPending() const { return flags & IS_PENDING; }
   bool IsPromoted() const { return flags & IS_PROMOTED; }
+  bool IsCompressed() const { return flags & IS_COMPRESSED; }
 
   void SetInCache(bool in_cache) {
     if (in_cache) {
@@ -140,10 +153,11 @@ struct LRUHandle {
   }
 
   void SetPriority(Cache::Priority priority) {
+    flags &= ~(IS_HIGH_PRI | IS_BOTTOM_PRI);
     if (priority == Cache::Priority::HIGH) {
       flags |= IS_HIGH_PRI;
-    } else {
-      flags &= ~IS_HIGH_PRI;
+    } else if (priority == Cache::Priority::BOTTOM) {
+      flags |= IS_BOTTOM_PRI;
     }
   }
 
@@ -184,6 +198,8 @@ struct LRUHandle {
     }
   }
 
+  void SetCompressed() { flags |= IS_COMPRESSED; }
+
   void Free() {
     assert(refs == 0);
 #ifdef __SANITIZE_THREAD__
@@ -239,6 +255,10 @@ class LRUHandleTable {
 
   LRUHandle* Lookup(const Slice& key, uint32_t hash);
   LRUHandle* Insert(LRUHandle* h);
+  // Prefetches the bucket of hash, ahead of a Lookup() or Insert()
+  void Prefetch(uint32_t hash) const {
+    PREFETCH(&list_[hash >> (32 - length_bits_)], 0 /* rw */, 3 /* locality */);
+  }
   LRUHandle* Remove(const Slice& key, uint32_t hash);
 
   template <typename T>
@@ -286,7 +306,12 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
                 double high_pri_pool_ratio, bool use_adaptive_mutex,
                 CacheMetadataChargePolicy metadata_charge_policy,
                 int max_upper_hash_bits,
-                const std::shared_ptr<SecondaryCache>& secondary_cache);
+                const std::shared_ptr<SecondaryCache>& secondary_cache,
+                size_t tiny_lfu_sketch_entries = 0,
+                const std::shared_ptr<CacheEvictionListener>&
+                    eviction_listener = nullptr,
+                CompressionType compressed_tier_compression = kNoCompression,
+                MemoryAllocator* memory_allocator = nullptr);
   virtual ~LRUCacheShard() override = default;
 
   // Separate from constructor so caller can easily make an array of LRUCache
@@ -325,6 +350,29 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
     return Lookup(key, hash, nullptr, nullptr, Cache::Priority::LOW, true,
                   nullptr);
   }
+  virtual Cache::Handle* LookupWithFallback(
+      const Slice& key, uint32_t hash,
+      const ShardedCache::CacheItemHelper* helper,
+      const ShardedCache::CreateCallback& create_cb,
+      ShardedCache::Priority priority, bool wait, Statistics* stats,
+      const std::function<Cache::Handle*()>& fallback) override;
+  // Look up or insert all keys under one lock hold, prefetching their
+  // buckets first. Misses and entries of the compressed tier then go to the
+  // secondary cache and Decompress() as in Lookup(), once the lock is
+  // released.
+  virtual void MultiLookup(const Slice* keys, const uint32_t* hashes,
+                           const size_t* indices, size_t count,
+                           const ShardedCache::CacheItemHelper* helper,
+                           const ShardedCache::CreateCallback& create_cb,
+                           Cache::Priority priority, bool wait,
+                           Statistics* stats,
+                           Cache::Handle** handles) override;
+  virtual void MultiInsert(const Slice* keys, const uint32_t* hashes,
+                           const size_t* indices, size_t count,
+                           void* const* values, const size_t* charges,
+                           Cache::DeleterFn deleter, Cache::Handle** handles,
+                           Cache::Priority priority,
+                           Status* statuses) override;
   virtual bool Release(Cache::Handle* handle, bool /*useful*/,
                        bool force_erase) override {
     return Release(handle, force_erase);
@@ -368,9 +416,51 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
   // and free_handle_on_fail is true, the item is deleted and handle is set to.
   Status InsertItem(LRUHandle* item, Cache::Handle** handle,
                     bool free_handle_on_fail);
+  // The part of InsertItem() done holding mutex_. Entries evicted to make
+  // room are appended to evicted, and other entries to free to
+  // last_reference_list.
+  Status InsertItemLocked(LRUHandle* item, Cache::Handle** handle,
+                          bool free_handle_on_fail,
+                          autovector<LRUHandle*>* evicted,
+                          autovector<LRUHandle*>* last_reference_list);
+  // Inserts the entries the caller removed from the cache into the secondary
+  // cache where applicable, and frees them. With compressed, compressed
+  // copies of those that go to the compressed tier are appended to it.
+  // Called without holding mutex_.
+  void FreeEntries(const autovector<LRUHandle*>& entries,
+                   autovector<LRUHandle*>* compressed = nullptr);
+  // FreeEntries() for the entries EvictFromLRU() returned, which also
+  // inserts the compressed copies
+  void FreeEvictedEntries(const autovector<LRUHandle*>& evicted);
+  // Whether the evicted entry e goes to the compressed tier
+  bool ShouldCompress(const LRUHandle* e);
+  // A compressed copy of e for the compressed tier, or nullptr if e does not
+  // compress well
+  LRUHandle* NewCompressedEntry(const LRUHandle* e);
+  // Replaces e, an entry of the compressed tier the caller holds a reference
+  // to, with the object create_cb makes of its decompressed value, and
+  // returns a reference to that. Releases e. Returns nullptr on failure.
+  LRUHandle* Decompress(LRUHandle* e,
+                        const ShardedCache::CacheItemHelper* helper,
+                        const ShardedCache::CreateCallback& create_cb,
+                        Cache::Priority priority);
+  // Allocates an entry for Insert(), outside of mutex_
+  LRUHandle* NewEntry(const Slice& key, uint32_t hash, void* value,
+                      size_t charge, DeleterFn deleter,
+                      const Cache::CacheItemHelper* helper,
+                      Cache::Priority priority);
   Status Insert(const Slice& key, uint32_t hash, void* value, size_t charge,
                 DeleterFn deleter, const Cache::CacheItemHelper* helper,
                 Cache::Handle** handle, Cache::Priority priority);
+  // Takes a reference to e, found in the hash table. REQUIRES: mutex_ held
+  void RefFound(LRUHandle* e);
+  // The part of Lookup() after a miss in the hash table: looks key up in the
+  // secondary cache, if any. REQUIRES: mutex_ not held
+  LRUHandle* LookupSecondary(const Slice& key, uint32_t hash,
+                             const ShardedCache::CacheItemHelper* helper,
+                             const ShardedCache::CreateCallback& create_cb,
+                             Cache::Priority priority, bool wait,
+                             Statistics* stats);
   // Promote an item looked up from the secondary cache to the LRU cache. The
   // item is only inserted into the hash table and not the LRU list, and only
   // if the cache is not at full capacity, as is the case during Insert.  The
@@ -392,6 +482,16 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
   // holding the mutex_
   void EvictFromLRU(size_t charge, autovector<LRUHandle*>* deleted);
 
+  // Passes the first num_evicted entries of `deleted`, evicted by
+  // EvictFromLRU() when insert_tick_ was insert_tick, to the eviction
+  // listener. Called without holding mutex_, before freeing the entries.
+  void NotifyEvicted(const autovector<LRUHandle*>& deleted, size_t num_evicted,
+                     uint32_t insert_tick);
+
+  // TinyLFU admission: whether e may evict victim, i.e. whether e was
+  // accessed more often recently. Only called with admission_sketch_ set.
+  bool AdmitOverVictim(const LRUHandle* e, const LRUHandle* victim) const;
+
   // Initialized before use.
   size_t capacity_;
 
@@ -435,12 +535,30 @@ class ALIGN_AS(CACHE_LINE_SIZE) LRUCacheShard final : public CacheShard {
   // Memory size for entries residing only in the LRU list
   size_t lru_usage_;
 
+  // Number of entries inserted so far, wrapping around
+  uint32_t insert_tick_;
+
   // mutex_ protects the following state.
   // We don't count mutex_ as the cache's internal state so semantically we
   // don't mind mutex_ invoking the non-const actions.
   mutable port::Mutex mutex_;
 
   std::shared_ptr<SecondaryCache> secondary_cache_;
+
+  // Access frequencies for TinyLFU admission, or nullptr if disabled.
+  // Thread-safe, so it is updated outside of mutex_.
+  std::unique_ptr<FrequencySketch> admission_sketch_;
+
+  std::shared_ptr<CacheEvictionListener> eviction_listener_;
+
+  // See LRUCacheOptions::compressed_tier_compression
+  const CompressionType compressed_tier_compression_;
+  // Allocates the compressed values, can be nullptr
+  MemoryAllocator* const memory_allocator_;
+  // Compressed entries left to make while few of them are hit, and a count
+  // of the evicted entries not compressed for lack of them
+  std::atomic<int32_t> compression_credits_;
+  std::atomic<uint32_t> compression_skips_;
 };
 
 class LRUCache
@@ -455,7 +573,12 @@ class LRUCache
            bool use_adaptive_mutex = kDefaultToAdaptiveMutex,
            CacheMetadataChargePolicy metadata_charge_policy =
                kDontChargeCacheMetadata,
-           const std::shared_ptr<SecondaryCache>& secondary_cache = nullptr);
+           const std::shared_ptr<SecondaryCache>& secondary_cache = nullptr,
+           size_t tiny_lfu_sketch_entries = 0,
+           const std::shared_ptr<CacheEvictionListener>& eviction_listener =
+               nullptr,
+           bool numa_aware = false,
+           CompressionType compressed_tier_compression = kNoCompression);
   virtual ~LRUCache();
   virtual const char* Name() const override { return "LRUCache"; }
   virtual CacheShard* GetShard(uint32_t shard) override;
@@ -475,6 +598,9 @@ class LRUCache
  private:
   LRUCacheShard* shards_ = nullptr;
   int num_shards_ = 0;
+  // Size of shards_ if it is mapped on the NUMA nodes, 0 if it is from
+  // port::cacheline_aligned_alloc()
+  size_t shards_numa_bytes_ = 0;
   std::shared_ptr<SecondaryCache> secondary_cache_;
 };
 
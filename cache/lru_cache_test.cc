@@ -205,6 +205,276 @@ TEST_F(LRUCacheTest, EntriesWithPriority) {
   ValidateLRUList({"e", "f", "g", "Z", "d"}, 2);
 }
 
+TEST_F(LRUCacheTest, BottomPriority) {
+  // Allocate 2 cache entries to high-pri pool.
+  NewCache(5, 0.45);
+
+  Insert("a", Cache::Priority::LOW);
+  Insert("b", Cache::Priority::HIGH);
+  Insert("c", Cache::Priority::LOW);
+  ValidateLRUList({"a", "c", "b"}, 1);
+
+  // Inserted at the tail
+  Insert("x", Cache::Priority::BOTTOM);
+  ValidateLRUList({"x", "a", "c", "b"}, 1);
+  Insert("y", Cache::Priority::BOTTOM);
+  ValidateLRUList({"y", "x", "a", "c", "b"}, 1);
+
+  // Evicted first
+  Insert("d", Cache::Priority::LOW);
+  ValidateLRUList({"x", "a", "c", "d", "b"}, 1);
+  ASSERT_FALSE(Lookup("y"));
+
+  // Promoted by a hit
+  ASSERT_TRUE(Lookup("x"));
+  ValidateLRUList({"a", "c", "d", "b", "x"}, 2);
+
+  // With an empty low-pri pool
+  Erase("a");
+  Erase("c");
+  Erase("d");
+  ValidateLRUList({"b", "x"}, 2);
+  Insert("z", Cache::Priority::BOTTOM);
+  ValidateLRUList({"z", "b", "x"}, 2);
+  Insert("e", Cache::Priority::LOW);
+  ValidateLRUList({"z", "e", "b", "x"}, 2);
+}
+
+TEST_F(LRUCacheTest, TinyLFUAdmission) {
+  LRUCacheOptions opts(4, 0 /*num_shard_bits*/, false /*strict_capacity_limit*/,
+                       0.0 /*high_pri_pool_ratio*/, nullptr,
+                       kDefaultToAdaptiveMutex, kDontChargeCacheMetadata);
+  opts.tiny_lfu_sketch_entries = 1024;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  ASSERT_NE(std::string::npos,
+            cache->GetPrintableOptions().find("tiny_lfu_sketch_words: 512"));
+
+  auto lookup = [&](const std::string& key) {
+    Cache::Handle* handle = cache->Lookup(key);
+    if (handle != nullptr) {
+      cache->Release(handle);
+      return true;
+    }
+    return false;
+  };
+
+  // Fill the cache with a hot working set
+  for (const std::string key : {"a", "b", "c", "d"}) {
+    ASSERT_FALSE(lookup(key));
+    ASSERT_OK(cache->Insert(key, nullptr, 1, nullptr));
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (const std::string key : {"a", "b", "c", "d"}) {
+      ASSERT_TRUE(lookup(key));
+    }
+  }
+
+  // A scan of keys seen once does not evict it
+  for (int i = 0; i < 100; ++i) {
+    std::string key = "scan" + std::to_string(i);
+    ASSERT_FALSE(lookup(key));
+    ASSERT_OK(cache->Insert(key, nullptr, 1, nullptr));
+  }
+  for (const std::string key : {"a", "b", "c", "d"}) {
+    ASSERT_TRUE(lookup(key));
+  }
+  ASSERT_EQ(4U, cache->GetUsage());
+
+  // A rejected entry inserted with a handle stays usable until released
+  Cache::Handle* handle = nullptr;
+  ASSERT_OK(cache->Insert("once", nullptr, 1, nullptr, &handle));
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(5U, cache->GetUsage());
+  ASSERT_EQ(1U, cache->GetPinnedUsage());
+  cache->Release(handle);
+  ASSERT_EQ(4U, cache->GetUsage());
+  ASSERT_FALSE(lookup("once"));
+
+  // A key that became popular is admitted, evicting the LRU entry
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_FALSE(lookup("e"));
+  }
+  ASSERT_OK(cache->Insert("e", nullptr, 1, nullptr));
+  ASSERT_TRUE(lookup("e"));
+  ASSERT_FALSE(lookup("a"));
+
+  // High-pri entries bypass admission
+  ASSERT_OK(cache->Insert("index", nullptr, 1, nullptr, nullptr,
+                          Cache::Priority::HIGH));
+  ASSERT_TRUE(lookup("index"));
+}
+
+TEST_F(LRUCacheTest, NumaAware) {
+  // Pretend to run on two nodes
+  int node = 0;
+  SyncPoint::GetInstance()->SetCallBack(
+      "ShardedCache::EnableNumaGroups:NumNodes",
+      [](void* arg) { *static_cast<int*>(arg) = 2; });
+  SyncPoint::GetInstance()->SetCallBack(
+      "ShardedCache::LocalNumaGroup:Node",
+      [&](void* arg) { *static_cast<int*>(arg) = node; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  LRUCacheOptions opts(1024, 2 /*num_shard_bits*/,
+                       false /*strict_capacity_limit*/,
+                       0.0 /*high_pri_pool_ratio*/);
+  opts.numa_aware = true;
+  opts.metadata_charge_policy = kDontChargeCacheMetadata;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  static int values[2];
+
+  auto lookup = [&](const std::string& key) -> void* {
+    Cache::Handle* handle = cache->Lookup(key);
+    if (handle == nullptr) {
+      return nullptr;
+    }
+    void* value = cache->Value(handle);
+    cache->Release(handle);
+    return value;
+  };
+
+  // Found from either node
+  ASSERT_OK(cache->Insert("a", &values[0], 1, nullptr));
+  ASSERT_EQ(&values[0], lookup("a"));
+  node = 1;
+  ASSERT_EQ(&values[0], lookup("a"));
+
+  // Moves to the group of the node inserting it last
+  ASSERT_OK(cache->Insert("a", &values[1], 1, nullptr));
+  ASSERT_EQ(1U, cache->GetUsage());
+  node = 0;
+  ASSERT_EQ(&values[1], lookup("a"));
+
+  // Lookups with a helper only search the other group on a local miss
+  int other_group_lookups = 0;
+  SyncPoint::GetInstance()->SetCallBack(
+      "ShardedCache::LookupInOtherGroups",
+      [&](void* /*arg*/) { other_group_lookups++; });
+  Cache::CacheItemHelper helper;
+  Cache::CreateCallback create_cb = [](const void* /*buf*/, size_t /*size*/,
+                                       void** /*out_obj*/,
+                                       size_t* /*charge*/) -> Status {
+    return Status::NotSupported();
+  };
+  node = 1;
+  Cache::Handle* handle =
+      cache->Lookup("a", &helper, create_cb, Cache::Priority::LOW, true);
+  ASSERT_NE(nullptr, handle);
+  cache->Release(handle);
+  ASSERT_EQ(0, other_group_lookups);
+  node = 0;
+  handle = cache->Lookup("a", &helper, create_cb, Cache::Priority::LOW, true);
+  ASSERT_NE(nullptr, handle);
+  cache->Release(handle);
+  ASSERT_EQ(1, other_group_lookups);
+  ASSERT_EQ(nullptr, cache->Lookup("c", &helper, create_cb,
+                                   Cache::Priority::LOW, true));
+  ASSERT_EQ(2, other_group_lookups);
+
+  // Batches fall back to the other group
+  ASSERT_OK(cache->Insert("b", &values[0], 1, nullptr));
+  const Slice keys[3] = {"a", "b", "c"};
+  Cache::Handle* handles[3];
+  cache->MultiLookup(3, keys, handles);
+  ASSERT_NE(nullptr, handles[0]);
+  ASSERT_EQ(&values[1], cache->Value(handles[0]));
+  ASSERT_NE(nullptr, handles[1]);
+  ASSERT_EQ(&values[0], cache->Value(handles[1]));
+  ASSERT_EQ(nullptr, handles[2]);
+  cache->Release(handles[0]);
+  cache->Release(handles[1]);
+
+  // Erased from any node
+  cache->Erase("a");
+  ASSERT_EQ(nullptr, lookup("a"));
+  node = 1;
+  ASSERT_EQ(nullptr, lookup("a"));
+  ASSERT_EQ(1U, cache->GetUsage());
+
+  cache.reset();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
+namespace {
+// Values are the keys, as strings deleted by DeleteString()
+std::vector<std::string> deleted_keys;
+
+void DeleteString(const Slice& /*key*/, void* value) {
+  std::string* str = static_cast<std::string*>(value);
+  deleted_keys.push_back(*str);
+  delete str;
+}
+
+class RecordingEvictionListener : public CacheEvictionListener {
+ public:
+  void OnEvict(const CacheEvictionInfo* entries, size_t count) override {
+    batches.emplace_back();
+    for (size_t i = 0; i < count; ++i) {
+      const CacheEvictionInfo& info = entries[i];
+      // Not freed yet
+      EXPECT_EQ(info.key.ToString(), *static_cast<std::string*>(info.value));
+      EXPECT_EQ(&DeleteString, info.deleter);
+      batches.back().push_back(info);
+      batches.back().back().key = Slice();
+      keys.push_back(info.key.ToString());
+    }
+  }
+
+  std::vector<std::vector<CacheEvictionInfo>> batches;
+  std::vector<std::string> keys;
+};
+}  // namespace
+
+TEST_F(LRUCacheTest, EvictionListener) {
+  deleted_keys.clear();
+  LRUCacheOptions opts(3, 0 /*num_shard_bits*/, false /*strict_capacity_limit*/,
+                       0.0 /*high_pri_pool_ratio*/, nullptr,
+                       kDefaultToAdaptiveMutex, kDontChargeCacheMetadata);
+  auto listener = std::make_shared<RecordingEvictionListener>();
+  opts.eviction_listener = listener;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  auto insert = [&](const std::string& key, size_t charge) {
+    ASSERT_OK(cache->Insert(key, new std::string(key), charge, &DeleteString));
+  };
+
+  insert("a", 1);
+  insert("b", 1);
+  insert("c", 1);
+  for (int i = 0; i < 2; ++i) {
+    Cache::Handle* handle = cache->Lookup("a");
+    ASSERT_NE(nullptr, handle);
+    cache->Release(handle);
+  }
+  ASSERT_TRUE(listener->batches.empty());
+
+  // Both evicted by the same insertion
+  insert("d", 2);
+  ASSERT_EQ(1U, listener->batches.size());
+  ASSERT_EQ(std::vector<std::string>({"b", "c"}), listener->keys);
+  ASSERT_EQ(2U, listener->batches[0][0].residency);
+  ASSERT_EQ(1U, listener->batches[0][1].residency);
+  ASSERT_EQ(0U, listener->batches[0][0].hit_count);
+  ASSERT_EQ(1U, listener->batches[0][0].charge);
+
+  insert("e", 1);
+  ASSERT_EQ(2U, listener->batches.size());
+  ASSERT_EQ("a", listener->keys.back());
+  ASSERT_EQ(2U, listener->batches[1][0].hit_count);
+  ASSERT_EQ(4U, listener->batches[1][0].residency);
+
+  // Erased and replaced entries are not evictions
+  cache->Erase("d");
+  insert("e", 1);
+  ASSERT_EQ(2U, listener->batches.size());
+  ASSERT_EQ(std::vector<std::string>({"b", "c", "a", "d", "e"}),
+            deleted_keys);
+
+  cache->SetCapacity(0);
+  ASSERT_EQ(3U, listener->batches.size());
+  ASSERT_EQ("e", listener->keys.back());
+}
+
 class TestSecondaryCache : public SecondaryCache {
  public:
   // Specifies what action to take on a lookup for a particular key
@@ -502,6 +772,47 @@ TEST_F(LRUSecondaryCacheTest, BasicTest) {
   secondary_cache.reset();
 }
 
+TEST_F(LRUSecondaryCacheTest, MultiLookup) {
+  LRUCacheOptions opts(1024, 0, false, 0.5, nullptr, kDefaultToAdaptiveMutex,
+                       kDontChargeCacheMetadata);
+  std::shared_ptr<TestSecondaryCache> secondary_cache =
+      std::make_shared<TestSecondaryCache>(2048);
+  opts.secondary_cache = secondary_cache;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  std::shared_ptr<Statistics> stats = CreateDBStatistics();
+
+  Random rnd(301);
+  std::string str1 = rnd.RandomString(1020);
+  TestItem* item1 = new TestItem(str1.data(), str1.length());
+  ASSERT_OK(cache->Insert("k1", item1, &LRUSecondaryCacheTest::helper_,
+                          str1.length()));
+  std::string str2 = rnd.RandomString(1020);
+  TestItem* item2 = new TestItem(str2.data(), str2.length());
+  // k1 should be demoted to NVM
+  ASSERT_OK(cache->Insert("k2", item2, &LRUSecondaryCacheTest::helper_,
+                          str2.length()));
+
+  // Only the keys missing from the LRU cache are looked up in the secondary
+  // cache, once each
+  const Slice keys[3] = {"k2", "k1", "k3"};
+  Cache::Handle* handles[3];
+  cache->MultiLookup(3, keys, &LRUSecondaryCacheTest::helper_,
+                     test_item_creator, Cache::Priority::LOW, true, handles,
+                     stats.get());
+  ASSERT_NE(handles[0], nullptr);
+  ASSERT_EQ(str2, static_cast<TestItem*>(cache->Value(handles[0]))->ToString());
+  ASSERT_NE(handles[1], nullptr);
+  ASSERT_EQ(str1, static_cast<TestItem*>(cache->Value(handles[1]))->ToString());
+  ASSERT_EQ(handles[2], nullptr);
+  cache->Release(handles[0]);
+  cache->Release(handles[1]);
+  ASSERT_EQ(secondary_cache->num_lookups(), 2u);
+  ASSERT_EQ(stats->getTickerCount(SECONDARY_CACHE_HITS), 1u);
+
+  cache.reset();
+  secondary_cache.reset();
+}
+
 TEST_F(LRUSecondaryCacheTest, BasicFailTest) {
   LRUCacheOptions opts(1024, 0, false, 0.5, nullptr, kDefaultToAdaptiveMutex,
                        kDontChargeCacheMetadata);
@@ -655,6 +966,62 @@ TEST_F(LRUSecondaryCacheTest, FullCapacityTest) {
   secondary_cache.reset();
 }
 
+TEST_F(LRUSecondaryCacheTest, CompressedTier) {
+  if (!LZ4_Supported()) {
+    ROCKSDB_GTEST_SKIP("LZ4 compression not supported");
+    return;
+  }
+  LRUCacheOptions opts(4096, 0, false, 0.0, nullptr, kDefaultToAdaptiveMutex,
+                       kDontChargeCacheMetadata);
+  opts.compressed_tier_compression = kLZ4Compression;
+  std::shared_ptr<Cache> cache = NewLRUCache(opts);
+  std::shared_ptr<Statistics> stats = CreateDBStatistics();
+
+  auto insert = [&](const std::string& key, const std::string& str) {
+    TestItem* item = new TestItem(str.data(), str.length());
+    ASSERT_OK(cache->Insert(key, item, &helper_, str.length()));
+  };
+  auto lookup = [&](const std::string& key) {
+    return cache->Lookup(key, &helper_, test_item_creator,
+                         Cache::Priority::LOW, true, stats.get());
+  };
+
+  // The first entry is compressed when evicted by the fifth
+  std::string str1(1000, 'a');
+  for (int i = 1; i <= 5; i++) {
+    insert("k" + std::to_string(i), str1);
+  }
+  ASSERT_GT(cache->GetUsage(), 4000U);
+  ASSERT_LT(cache->GetUsage(), 4096U);
+
+  // Only found by lookups that can recreate the item
+  ASSERT_EQ(nullptr, cache->Lookup("k1"));
+  Cache::Handle* handle = lookup("k1");
+  ASSERT_NE(nullptr, handle);
+  ASSERT_EQ(str1, static_cast<TestItem*>(cache->Value(handle))->ToString());
+  ASSERT_EQ(1000U, cache->GetCharge(handle));
+  cache->Release(handle);
+  ASSERT_EQ(1U, stats->getTickerCount(COMPRESSED_TIER_HITS));
+  // Now the uncompressed entry
+  handle = lookup("k1");
+  ASSERT_NE(nullptr, handle);
+  cache->Release(handle);
+  ASSERT_EQ(1U, stats->getTickerCount(COMPRESSED_TIER_HITS));
+
+  // Compressed entries are dropped when evicted
+  cache->SetCapacity(0);
+  ASSERT_EQ(0U, cache->GetUsage());
+  cache->SetCapacity(2048);
+
+  // Entries that do not compress are dropped
+  Random rnd(301);
+  insert("r1", rnd.RandomString(1000));
+  insert("r2", rnd.RandomString(1000));
+  insert("r3", rnd.RandomString(1000));
+  ASSERT_EQ(nullptr, lookup("r1"));
+  ASSERT_EQ(2000U, cache->GetUsage());
+}
+
 // In this test, the block cache size is set to 4096, after insert 6 KV-pairs
 // and flush, there are 5 blocks in this SST file, 2 data blocks and 3 meta
 // blocks. block_1 size is 4096 and block_2 size is 2056. The total size
@@ -1116,6 +1483,7 @@ TEST_F(DBSecondaryCacheTest, TestSecondaryCacheMultiGet) {
   options.create_if_missing = true;
   options.table_factory.reset(NewBlockBasedTableFactory(table_options));
   options.paranoid_file_checks = true;
+  options.statistics = CreateDBStatistics();
   DestroyAndReopen(options);
   Random rnd(301);
   const int N = 8;
@@ -1169,10 +1537,16 @@ TEST_F(DBSecondaryCacheTest, TestSecondaryCacheMultiGet) {
     key_slices.emplace_back(key);
   }
   uint32_t num_lookups = secondary_cache->num_lookups();
+  uint64_t data_hits = TestGetTickerCount(options, BLOCK_CACHE_DATA_HIT);
+  uint64_t data_misses = TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS);
   dbfull()->MultiGet(ReadOptions(), dbfull()->DefaultColumnFamily(),
                      key_slices.size(), key_slices.data(), values.data(),
                      s.data(), false);
   ASSERT_EQ(secondary_cache->num_lookups(), num_lookups + 5);
+  // The deferred lookup that fails is a miss, not a hit
+  ASSERT_EQ(TestGetTickerCount(options, BLOCK_CACHE_DATA_HIT), data_hits + 6);
+  ASSERT_EQ(TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS),
+            data_misses + 2);
   for (int i = 0; i < N; ++i) {
     ASSERT_OK(s[i]);
     ASSERT_EQ(values[i].ToString(), keys[i]);
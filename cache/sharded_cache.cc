@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <memory>
 
+#include "test_util/sync_point.h"
 #include "util/hash.h"
 #include "util/math.h"
 #include "util/mutexlock.h"
@@ -25,13 +26,61 @@ inline uint32_t HashSlice(const Slice& s) {
   return Lower32of64(GetSliceNPHash64(s));
 }
 
+// Keys in a batch kept on the stack by MultiLookup() and MultiInsert()
+constexpr size_t kMultiOpStackKeys = 32;
+
 }  // namespace
 
+void CacheShard::MultiLookup(const Slice* keys, const uint32_t* hashes,
+                             const size_t* indices, size_t count,
+                             const Cache::CacheItemHelper* helper,
+                             const Cache::CreateCallback& create_cb,
+                             Cache::Priority priority, bool wait,
+                             Statistics* stats, Cache::Handle** handles) {
+  for (size_t i = 0; i < count; ++i) {
+    size_t idx = indices[i];
+    handles[idx] = helper == nullptr
+                       ? Lookup(keys[idx], hashes[idx])
+                       : Lookup(keys[idx], hashes[idx], helper, create_cb,
+                                priority, wait, stats);
+  }
+}
+
+Cache::Handle* CacheShard::LookupWithFallback(
+    const Slice& key, uint32_t hash, const Cache::CacheItemHelper* helper,
+    const Cache::CreateCallback& create_cb, Cache::Priority priority,
+    bool wait, Statistics* stats,
+    const std::function<Cache::Handle*()>& fallback) {
+  Cache::Handle* handle = Lookup(key, hash);
+  if (handle == nullptr) {
+    handle = fallback();
+  }
+  if (handle == nullptr) {
+    handle = Lookup(key, hash, helper, create_cb, priority, wait, stats);
+  }
+  return handle;
+}
+
+void CacheShard::MultiInsert(const Slice* keys, const uint32_t* hashes,
+                             const size_t* indices, size_t count,
+                             void* const* values, const size_t* charges,
+                             DeleterFn deleter, Cache::Handle** handles,
+                             Cache::Priority priority, Status* statuses) {
+  for (size_t i = 0; i < count; ++i) {
+    size_t idx = indices[i];
+    statuses[idx] =
+        Insert(keys[idx], hashes[idx], values[idx], charges[idx], deleter,
+               handles ? &handles[idx] : nullptr, priority);
+  }
+}
+
 ShardedCache::ShardedCache(size_t capacity, int num_shard_bits,
                            bool strict_capacity_limit,
                            std::shared_ptr<MemoryAllocator> allocator)
     : Cache(std::move(allocator)),
       shard_mask_((uint32_t{1} << num_shard_bits) - 1),
+      numa_group_shift_(0),
+      numa_group_mask_(0),
       capacity_(capacity),
       strict_capacity_limit_(strict_capacity_limit),
       last_id_(1) {}
@@ -59,6 +108,10 @@ Status ShardedCache::Insert(const Slice& key, void* value, size_t charge,
                             DeleterFn deleter, Handle** handle,
                             Priority priority) {
   uint32_t hash = HashSlice(key);
+  if (numa_group_mask_ != 0) {
+    hash = HashInGroup(hash, LocalNumaGroup());
+    EraseInOtherGroups(key, hash);
+  }
   return GetShard(Shard(hash))
       ->Insert(key, hash, value, charge, deleter, handle, priority);
 }
@@ -70,13 +123,178 @@ Status ShardedCache::Insert(const Slice& key, void* value,
   if (!helper) {
     return Status::InvalidArgument();
   }
+  if (numa_group_mask_ != 0) {
+    hash = HashInGroup(hash, LocalNumaGroup());
+    EraseInOtherGroups(key, hash);
+  }
   return GetShard(Shard(hash))
       ->Insert(key, hash, value, helper, charge, handle, priority);
 }
 
 Cache::Handle* ShardedCache::Lookup(const Slice& key, Statistics* /*stats*/) {
   uint32_t hash = HashSlice(key);
-  return GetShard(Shard(hash))->Lookup(key, hash);
+  if (numa_group_mask_ == 0) {
+    return GetShard(Shard(hash))->Lookup(key, hash);
+  }
+  hash = HashInGroup(hash, LocalNumaGroup());
+  Handle* handle = GetShard(Shard(hash))->Lookup(key, hash);
+  if (handle == nullptr) {
+    handle = LookupInOtherGroups(key, hash);
+  }
+  return handle;
+}
+
+uint32_t ShardedCache::EnableNumaGroups() {
+  int num_nodes = port::NumaNodeCount();
+  TEST_SYNC_POINT_CALLBACK("ShardedCache::EnableNumaGroups:NumNodes",
+                           &num_nodes);
+  int num_shard_bits = GetNumShardBits();
+  if (num_nodes <= 1 || num_shard_bits == 0) {
+    return 1;
+  }
+  // With a node count that is not a power of two, some groups serve two
+  // nodes
+  int group_bits = std::min(FloorLog2(num_nodes), num_shard_bits);
+  numa_group_shift_ = static_cast<uint32_t>(num_shard_bits - group_bits);
+  numa_group_mask_ = (uint32_t{1} << group_bits) - 1;
+  return uint32_t{1} << group_bits;
+}
+
+uint32_t ShardedCache::LocalNumaGroup() const {
+  int node = port::NumaNodeID();
+  TEST_SYNC_POINT_CALLBACK("ShardedCache::LocalNumaGroup:Node", &node);
+  return static_cast<uint32_t>(node) & numa_group_mask_;
+}
+
+Cache::Handle* ShardedCache::LookupInOtherGroups(const Slice& key,
+                                                 uint32_t hash) {
+  TEST_SYNC_POINT("ShardedCache::LookupInOtherGroups");
+  uint32_t own_group = NumaGroupOfShard(Shard(hash));
+  for (uint32_t group = 0; group <= numa_group_mask_; ++group) {
+    if (group == own_group) {
+      continue;
+    }
+    uint32_t group_hash = HashInGroup(hash, group);
+    Handle* handle = GetShard(Shard(group_hash))->Lookup(key, group_hash);
+    if (handle != nullptr) {
+      return handle;
+    }
+  }
+  return nullptr;
+}
+
+void ShardedCache::EraseInOtherGroups(const Slice& key, uint32_t hash) {
+  uint32_t own_group = NumaGroupOfShard(Shard(hash));
+  for (uint32_t group = 0; group <= numa_group_mask_; ++group) {
+    if (group != own_group) {
+      uint32_t group_hash = HashInGroup(hash, group);
+      GetShard(Shard(group_hash))->Erase(key, group_hash);
+    }
+  }
+}
+
+template <typename ShardFn>
+void ShardedCache::ForEachShardBatch(size_t num_keys, const Slice* keys,
+                                     const ShardFn& fn) {
+  uint32_t stack_hashes[kMultiOpStackKeys];
+  size_t stack_indices[kMultiOpStackKeys];
+  std::unique_ptr<uint32_t[]> heap_hashes;
+  std::unique_ptr<size_t[]> heap_indices;
+  uint32_t* hashes = stack_hashes;
+  size_t* indices = stack_indices;
+  if (num_keys > kMultiOpStackKeys) {
+    heap_hashes.reset(new uint32_t[num_keys]);
+    heap_indices.reset(new size_t[num_keys]);
+    hashes = heap_hashes.get();
+    indices = heap_indices.get();
+  }
+  uint32_t local_group = numa_group_mask_ != 0 ? LocalNumaGroup() : 0;
+  for (size_t i = 0; i < num_keys; ++i) {
+    hashes[i] = HashSlice(keys[i]);
+    if (numa_group_mask_ != 0) {
+      hashes[i] = HashInGroup(hashes[i], local_group);
+    }
+    indices[i] = i;
+  }
+  // Keys of a shard keep their relative order, so that a batch with
+  // duplicate keys behaves like the same calls made one at a time
+  std::sort(indices, indices + num_keys, [&](size_t a, size_t b) {
+    uint32_t shard_a = Shard(hashes[a]);
+    uint32_t shard_b = Shard(hashes[b]);
+    return shard_a < shard_b || (shard_a == shard_b && a < b);
+  });
+  size_t begin = 0;
+  while (begin < num_keys) {
+    uint32_t shard = Shard(hashes[indices[begin]]);
+    size_t end = begin + 1;
+    while (end < num_keys && Shard(hashes[indices[end]]) == shard) {
+      ++end;
+    }
+    fn(GetShard(shard), hashes, indices + begin, end - begin);
+    begin = end;
+  }
+}
+
+void ShardedCache::MultiLookup(size_t num_keys, const Slice* keys,
+                               Handle** handles, Statistics* stats) {
+  ForEachShardBatch(num_keys, keys,
+                    [&](CacheShard* shard, const uint32_t* hashes,
+                        const size_t* indices, size_t count) {
+                      shard->MultiLookup(keys, hashes, indices, count,
+                                         /*helper=*/nullptr,
+                                         /*create_cb=*/nullptr,
+                                         Priority::LOW, /*wait=*/true, stats,
+                                         handles);
+                      if (numa_group_mask_ == 0) {
+                        return;
+                      }
+                      for (size_t i = 0; i < count; ++i) {
+                        size_t idx = indices[i];
+                        if (handles[idx] == nullptr) {
+                          handles[idx] =
+                              LookupInOtherGroups(keys[idx], hashes[idx]);
+                        }
+                      }
+                    });
+}
+
+void ShardedCache::MultiLookup(size_t num_keys, const Slice* keys,
+                               const CacheItemHelper* helper,
+                               const CreateCallback& create_cb,
+                               Priority priority, bool wait, Handle** handles,
+                               Statistics* stats) {
+  if (numa_group_mask_ != 0) {
+    // The other groups come before the secondary cache, see Lookup()
+    Cache::MultiLookup(num_keys, keys, helper, create_cb, priority, wait,
+                       handles, stats);
+    return;
+  }
+  ForEachShardBatch(num_keys, keys,
+                    [&](CacheShard* shard, const uint32_t* hashes,
+                        const size_t* indices, size_t count) {
+                      shard->MultiLookup(keys, hashes, indices, count, helper,
+                                         create_cb, priority, wait, stats,
+                                         handles);
+                    });
+}
+
+void ShardedCache::MultiInsert(size_t num_keys, const Slice* keys,
+                               void* const* values, const size_t* charges,
+                               DeleterFn deleter, Handle** handles,
+                               Priority priority, Status* statuses) {
+  ForEachShardBatch(num_keys, keys,
+                    [&](CacheShard* shard, const uint32_t* hashes,
+                        const size_t* indices, size_t count) {
+                      if (numa_group_mask_ != 0) {
+                        for (size_t i = 0; i < count; ++i) {
+                          EraseInOtherGroups(keys[indices[i]],
+                                             hashes[indices[i]]);
+                        }
+                      }
+                      shard->MultiInsert(keys, hashes, indices, count, values,
+                                         charges, deleter, handles, priority,
+                                         statuses);
+                    });
 }
 
 Cache::Handle* ShardedCache::Lookup(const Slice& key,
@@ -85,6 +303,14 @@ Cache::Handle* ShardedCache::Lookup(const Slice& key,
                                     Priority priority, bool wait,
                                     Statistics* stats) {
   uint32_t hash = HashSlice(key);
+  if (numa_group_mask_ != 0) {
+    // The primary cache of the local group comes first, then the one of the
+    // other groups, and the secondary cache last
+    hash = HashInGroup(hash, LocalNumaGroup());
+    return GetShard(Shard(hash))->LookupWithFallback(
+        key, hash, helper, create_cb, priority, wait, stats,
+        [&]() { return LookupInOtherGroups(key, hash); });
+  }
   return GetShard(Shard(hash))
       ->Lookup(key, hash, helper, create_cb, priority, wait, stats);
 }
@@ -117,6 +343,9 @@ bool ShardedCache::Release(Handle* handle, bool useful, bool force_erase) {
 void ShardedCache::Erase(const Slice& key) {
   uint32_t hash = HashSlice(key);
   GetShard(Shard(hash))->Erase(key, hash);
+  if (numa_group_mask_ != 0) {
+    EraseInOtherGroups(key, hash);
+  }
 }
 
 uint64_t ShardedCache::NewId() {
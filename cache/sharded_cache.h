@@ -10,6 +10,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <string>
 
 #include "port/port.h"
@@ -36,8 +37,31 @@ class CacheShard {
                                 const Cache::CreateCallback& create_cb,
                                 Cache::Priority priority, bool wait,
                                 Statistics* stats) = 0;
+  // Lookup() with fallback() called after a miss in the primary cache, and
+  // the secondary cache only looked up if that returns nullptr as well. The
+  // default looks the key up in the primary cache twice.
+  virtual Cache::Handle* LookupWithFallback(
+      const Slice& key, uint32_t hash, const Cache::CacheItemHelper* helper,
+      const Cache::CreateCallback& create_cb, Cache::Priority priority,
+      bool wait, Statistics* stats,
+      const std::function<Cache::Handle*()>& fallback);
   virtual bool Release(Cache::Handle* handle, bool useful,
                        bool force_erase) = 0;
+  // Batched Lookup() and Insert() of the count keys keys[indices[i]] of this
+  // shard, with hashes hashes[indices[i]]. The results go to
+  // handles[indices[i]] and statuses[indices[i]]. The defaults look up and
+  // insert one key at a time. A null helper looks up as Lookup(key, hash).
+  virtual void MultiLookup(const Slice* keys, const uint32_t* hashes,
+                           const size_t* indices, size_t count,
+                           const Cache::CacheItemHelper* helper,
+                           const Cache::CreateCallback& create_cb,
+                           Cache::Priority priority, bool wait,
+                           Statistics* stats, Cache::Handle** handles);
+  virtual void MultiInsert(const Slice* keys, const uint32_t* hashes,
+                           const size_t* indices, size_t count,
+                           void* const* values, const size_t* charges,
+                           DeleterFn deleter, Cache::Handle** handles,
+                           Cache::Priority priority, Status* statuses);
   virtual bool IsReady(Cache::Handle* handle) = 0;
   virtual void Wait(Cache::Handle* handle) = 0;
   virtual bool Ref(Cache::Handle* handle) = 0;
@@ -93,6 +117,18 @@ class ShardedCache : public Cache {
   virtual Handle* Lookup(const Slice& key, const CacheItemHelper* helper,
                          const CreateCallback& create_cb, Priority priority,
                          bool wait, Statistics* stats = nullptr) override;
+  virtual void MultiLookup(size_t num_keys, const Slice* keys,
+                           Handle** handles,
+                           Statistics* stats = nullptr) override;
+  virtual void MultiLookup(size_t num_keys, const Slice* keys,
+                           const CacheItemHelper* helper,
+                           const CreateCallback& create_cb, Priority priority,
+                           bool wait, Handle** handles,
+                           Statistics* stats = nullptr) override;
+  virtual void MultiInsert(size_t num_keys, const Slice* keys,
+                           void* const* values, const size_t* charges,
+                           DeleterFn deleter, Handle** handles,
+                           Priority priority, Status* statuses) override;
   virtual bool Release(Handle* handle, bool useful,
                        bool force_erase = false) override;
   virtual bool IsReady(Handle* handle) override;
@@ -119,8 +155,42 @@ class ShardedCache : public Cache {
  protected:
   inline uint32_t Shard(uint32_t hash) { return hash & shard_mask_; }
 
+  // NUMA mode, see LRUCacheOptions::numa_aware. Splits the shards into a
+  // group per NUMA node, numbered by the top bits of the shard number. A key
+  // goes to the group of the node of the thread inserting it, and is erased
+  // from the other groups. Lookups search the group of the calling thread's
+  // node first. Returns the number of groups, 1 (and no NUMA mode) on a
+  // host with a single node. To be called from the constructor of the
+  // subclass.
+  uint32_t EnableNumaGroups();
+
+  // The group of the given shard in NUMA mode
+  uint32_t NumaGroupOfShard(uint32_t shard) const {
+    return (shard >> numa_group_shift_) & numa_group_mask_;
+  }
+
  private:
+  // hash, with the shard number moved into group
+  uint32_t HashInGroup(uint32_t hash, uint32_t group) const {
+    return (hash & ~(numa_group_mask_ << numa_group_shift_)) |
+           (group << numa_group_shift_);
+  }
+  // The group of the node the calling thread runs on
+  uint32_t LocalNumaGroup() const;
+  // Look up and erase key in the groups other than the one of hash
+  Handle* LookupInOtherGroups(const Slice& key, uint32_t hash);
+  void EraseInOtherGroups(const Slice& key, uint32_t hash);
+
+  // Hashes the num_keys keys and groups their indices by shard, then calls
+  // fn(shard, hashes, indices, count) once for each shard with keys.
+  template <typename ShardFn>
+  void ForEachShardBatch(size_t num_keys, const Slice* keys,
+                         const ShardFn& fn);
+
   const uint32_t shard_mask_;
+  // NUMA mode, if numa_group_mask_ is not 0
+  uint32_t numa_group_shift_;
+  uint32_t numa_group_mask_;
   mutable port::Mutex capacity_mutex_;
   size_t capacity_;
   bool strict_capacity_limit_;
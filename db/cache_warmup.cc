@@ -0,0 +1,408 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+
+#include "db/cache_warmup.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cache/cache_entry_roles.h"
+#include "cache/cache_key.h"
+#include "db/column_family.h"
+#include "db/table_cache.h"
+#include "db/version_set.h"
+#include "file/random_access_file_reader.h"
+#include "logging/logging.h"
+#include "monitoring/statistics.h"
+#include "port/port.h"
+#include "table/block_based/block_based_table_reader.h"
+#include "util/coding.h"
+#include "utilities/cache_dump_load_impl.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+const char* kWarmupFilePrefix = "CACHE_WARMUP-";
+// Each loading thread reads its files sequentially in chunks of this size
+const size_t kWarmupReadaheadSize = 4 << 20;
+
+std::string WarmupFileName(const std::string& dir, size_t n) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "/%s%06" ROCKSDB_PRIszt, kWarmupFilePrefix, n);
+  return dir + buf;
+}
+
+// Block based table options of the column family, nullptr if its tables
+// are not block based or do not use a block cache
+const BlockBasedTableOptions* GetBlockCacheOptions(ColumnFamilyData* cfd) {
+  const BlockBasedTableOptions* toptions =
+      cfd->ioptions()->table_factory->GetOptions<BlockBasedTableOptions>();
+  if (toptions == nullptr || toptions->no_block_cache ||
+      toptions->block_cache == nullptr) {
+    return nullptr;
+  }
+  return toptions;
+}
+
+// Spreads dump units round-robin over the warm-up files
+class WarmupWriter {
+ public:
+  IOStatus Open(const ImmutableDBOptions& db_options) {
+    int num_files = std::max(db_options.cache_warmup_threads, 1);
+    SystemClock* clock = db_options.clock;
+    for (int i = 0; i < num_files; i++) {
+      std::unique_ptr<CacheDumpWriter> writer;
+      IOStatus io_s = NewToFileCacheDumpWriter(
+          db_options.fs, FileOptions(),
+          WarmupFileName(db_options.cache_warmup_dir, i), &writer);
+      if (!io_s.ok()) {
+        return io_s;
+      }
+      writers_.push_back(std::move(writer));
+      sequence_nums_.push_back(0);
+    }
+    std::string header = "cache warmup";
+    for (size_t i = 0; i < writers_.size(); i++) {
+      IOStatus io_s = WriteUnit(i, CacheDumpUnitType::kHeader, "header",
+                                header, clock->NowMicros());
+      if (!io_s.ok()) {
+        return io_s;
+      }
+    }
+    clock_ = clock;
+    return IOStatus::OK();
+  }
+
+  IOStatus Add(CacheDumpUnitType type, const Slice& key, const Slice& value) {
+    IOStatus io_s = WriteUnit(next_, type, key, value, clock_->NowMicros());
+    next_ = (next_ + 1) % writers_.size();
+    return io_s;
+  }
+
+  IOStatus Finish() {
+    std::string footer = "cache dump completed";
+    for (size_t i = 0; i < writers_.size(); i++) {
+      IOStatus io_s = WriteUnit(i, CacheDumpUnitType::kFooter, "footer",
+                                footer, clock_->NowMicros());
+      if (io_s.ok()) {
+        io_s = writers_[i]->Close();
+      }
+      if (!io_s.ok()) {
+        return io_s;
+      }
+    }
+    return IOStatus::OK();
+  }
+
+ private:
+  IOStatus WriteUnit(size_t i, CacheDumpUnitType type, const Slice& key,
+                     const Slice& value, uint64_t timestamp) {
+    DumpUnit dump_unit;
+    dump_unit.timestamp = timestamp;
+    dump_unit.type = type;
+    dump_unit.key = key;
+    dump_unit.value_len = value.size();
+    dump_unit.value = const_cast<char*>(value.data());
+    dump_unit.value_checksum = crc32c::Value(value.data(), value.size());
+    return CacheDumperHelper::WriteDumpUnit(writers_[i].get(), dump_unit,
+                                            &sequence_nums_[i]);
+  }
+
+  std::vector<std::unique_ptr<CacheDumpWriter>> writers_;
+  std::vector<uint32_t> sequence_nums_;
+  size_t next_ = 0;
+  SystemClock* clock_ = nullptr;
+};
+
+// Writes the blocks of the given table files found in cache, index and
+// filter blocks first, up to max_bytes of charge
+IOStatus DumpBlockCache(
+    Cache* cache, const std::unordered_map<std::string, uint64_t>& prefixes,
+    uint64_t max_bytes, WarmupWriter* writer) {
+  const auto role_map = CopyCacheDeleterRoleMap();
+  uint64_t dumped_bytes = 0;
+  IOStatus io_s;
+  for (bool data_blocks : {false, true}) {
+    cache->ApplyToAllEntries(
+        [&](const Slice& key, void* value, size_t charge,
+            Cache::DeleterFn deleter) {
+          if (!io_s.ok() || dumped_bytes + charge > max_bytes ||
+              key.size() < OffsetableCacheKey::kCommonPrefixSize) {
+            return;
+          }
+          auto role = role_map.find(deleter);
+          if (role == role_map.end() ||
+              (role->second == CacheEntryRole::kDataBlock) != data_blocks) {
+            return;
+          }
+          auto file = prefixes.find(
+              std::string(key.data(), OffsetableCacheKey::kCommonPrefixSize));
+          CacheDumpUnitType type;
+          Slice block;
+          if (file == prefixes.end() ||
+              !CacheDumperHelper::GetDumpableBlock(role->second, value, &type,
+                                                   &block)) {
+            return;
+          }
+          std::string unit_key;
+          PutVarint64(&unit_key, file->second);
+          unit_key.append(key.data(), key.size());
+          io_s = writer->Add(type, unit_key, block);
+          dumped_bytes += charge;
+        },
+        {});
+  }
+  return io_s;
+}
+
+// Writes the rows of the given table files and TableCaches found in
+// row_cache, up to max_bytes of charge
+IOStatus DumpRowCache(Cache* row_cache,
+                      const std::unordered_set<uint64_t>& row_cache_ids,
+                      const std::unordered_set<uint64_t>& file_numbers,
+                      uint64_t max_bytes, WarmupWriter* writer) {
+  uint64_t dumped_bytes = 0;
+  IOStatus io_s;
+  TableCache::ApplyToFileRowCacheEntries(
+      row_cache, [&](uint64_t row_cache_id, uint64_t file_number,
+                     const Slice& user_key, const Slice& replay_log,
+                     size_t charge) {
+        if (!io_s.ok() || dumped_bytes + charge > max_bytes ||
+            row_cache_ids.count(row_cache_id) == 0 ||
+            file_numbers.count(file_number) == 0) {
+          return;
+        }
+        std::string unit_key;
+        PutVarint64(&unit_key, file_number);
+        unit_key.append(user_key.data(), user_key.size());
+        io_s = writer->Add(CacheDumpUnitType::kRow, unit_key, replay_log);
+        dumped_bytes += charge;
+      });
+  return io_s;
+}
+
+// Whether the cache has no room left for entries to load
+bool IsFull(Cache* cache) {
+  return cache->GetUsage() >= cache->GetCapacity();
+}
+
+// Loads the entries of one warm-up file into the caches of the column
+// families owning their table files
+IOStatus LoadWarmupFile(
+    const ImmutableDBOptions& db_options, const std::string& fname,
+    const std::unordered_map<uint64_t, ColumnFamilyData*>& live_files) {
+  std::unique_ptr<RandomAccessFileReader> file_reader;
+  IOStatus io_s = RandomAccessFileReader::Create(db_options.fs, fname,
+                                                 FileOptions(), &file_reader,
+                                                 nullptr);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  FromFileCacheDumpReader reader(std::move(file_reader),
+                                 kWarmupReadaheadSize);
+  Statistics* stats = db_options.stats;
+  Cache* row_cache = db_options.row_cache.get();
+  std::string data;
+  DumpUnit dump_unit;
+  io_s = CacheDumperHelper::ReadDumpUnit(&reader, &data, &dump_unit);
+  if (io_s.ok() && dump_unit.type != CacheDumpUnitType::kHeader) {
+    io_s = IOStatus::Corruption("Cache warm-up file without header");
+  }
+  while (io_s.ok()) {
+    dump_unit.reset();
+    io_s = CacheDumperHelper::ReadDumpUnit(&reader, &data, &dump_unit);
+    if (!io_s.ok() || dump_unit.type == CacheDumpUnitType::kFooter) {
+      break;
+    }
+    Slice key = dump_unit.key;
+    uint64_t file_number = 0;
+    if (!GetVarint64(&key, &file_number)) {
+      io_s = IOStatus::Corruption("Bad cache warm-up entry key");
+      break;
+    }
+    auto file = live_files.find(file_number);
+    size_t charge = 0;
+    if (file == live_files.end()) {
+      // The table file was deleted
+    } else if (dump_unit.type == CacheDumpUnitType::kRow) {
+      if (row_cache != nullptr && !IsFull(row_cache)) {
+        charge = file->second->table_cache()->RestoreRowCacheEntry(
+            file_number, key,
+            Slice(static_cast<char*>(dump_unit.value), dump_unit.value_len));
+      }
+    } else if (const BlockBasedTableOptions* toptions =
+                   GetBlockCacheOptions(file->second)) {
+      Cache* cache = toptions->block_cache.get();
+      void* value = nullptr;
+      const Cache::CacheItemHelper* helper = nullptr;
+      if (!IsFull(cache) &&
+          CacheDumperHelper::CreateCacheValue(dump_unit, *toptions, &value,
+                                              &helper, &charge)
+              .ok()) {
+        Cache::Priority priority =
+            toptions->cache_index_and_filter_blocks_with_high_priority &&
+                    dump_unit.type != CacheDumpUnitType::kData
+                ? Cache::Priority::HIGH
+                : Cache::Priority::LOW;
+        // The cache frees the value if it cannot take it
+        if (!cache->Insert(key, value, helper, charge, nullptr, priority)
+                 .ok()) {
+          charge = 0;
+        }
+      }
+    }
+    if (charge > 0) {
+      RecordTick(stats, CACHE_WARMUP_ENTRIES_LOADED);
+      RecordTick(stats, CACHE_WARMUP_BYTES_LOADED, charge);
+    } else {
+      RecordTick(stats, CACHE_WARMUP_ENTRIES_SKIPPED);
+    }
+  }
+  return io_s;
+}
+
+}  // namespace
+
+Status DumpCachesForWarmup(const ImmutableDBOptions& db_options,
+                           const std::vector<Version*>& versions) {
+  const std::string& dir = db_options.cache_warmup_dir;
+  IOStatus io_s = db_options.fs->CreateDirIfMissing(dir, IOOptions(), nullptr);
+  std::vector<std::string> children;
+  if (io_s.ok()) {
+    io_s = db_options.fs->GetChildren(dir, IOOptions(), &children, nullptr);
+  }
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  // The previous dump may have used more files
+  for (const std::string& child : children) {
+    if (Slice(child).starts_with(kWarmupFilePrefix)) {
+      db_options.fs->DeleteFile(dir + "/" + child, IOOptions(), nullptr)
+          .PermitUncheckedError();
+    }
+  }
+
+  // Maps the common block cache key prefix of each table file to its file
+  // number. Only files with stable cache keys can be warmed up.
+  std::unordered_map<std::string, uint64_t> prefixes;
+  std::unordered_set<uint64_t> file_numbers;
+  std::unordered_set<uint64_t> row_cache_ids;
+  std::unordered_set<Cache*> block_caches;
+  for (Version* version : versions) {
+    ColumnFamilyData* cfd = version->cfd();
+    row_cache_ids.insert(cfd->table_cache()->row_cache_id());
+    const BlockBasedTableOptions* toptions = GetBlockCacheOptions(cfd);
+    if (toptions != nullptr) {
+      block_caches.insert(toptions->block_cache.get());
+    }
+    const VersionStorageInfo* vstorage = version->storage_info();
+    for (int level = 0; level < vstorage->num_levels(); level++) {
+      for (FileMetaData* file : vstorage->LevelFiles(level)) {
+        uint64_t file_number = file->fd.GetNumber();
+        file_numbers.insert(file_number);
+        std::shared_ptr<const TableProperties> props;
+        if (toptions == nullptr ||
+            !version->GetTableProperties(&props, file).ok()) {
+          continue;
+        }
+        OffsetableCacheKey base;
+        bool is_stable = false;
+        BlockBasedTable::SetupBaseCacheKey(
+            props.get(), /*cur_db_session_id*/ "", /*cur_file_num*/ 0,
+            /*file_size*/ 42, &base, &is_stable);
+        if (is_stable) {
+          prefixes[base.CommonPrefixSlice().ToString()] = file_number;
+        }
+      }
+    }
+  }
+
+  WarmupWriter writer;
+  io_s = writer.Open(db_options);
+  uint64_t max_bytes = db_options.cache_warmup_max_bytes > 0
+                           ? db_options.cache_warmup_max_bytes
+                           : port::kMaxUint64;
+  for (Cache* cache : block_caches) {
+    if (io_s.ok()) {
+      io_s = DumpBlockCache(cache, prefixes, max_bytes, &writer);
+    }
+  }
+  if (io_s.ok() && db_options.row_cache != nullptr) {
+    io_s = DumpRowCache(db_options.row_cache.get(), row_cache_ids,
+                        file_numbers, max_bytes, &writer);
+  }
+  if (io_s.ok()) {
+    io_s = writer.Finish();
+  }
+  return io_s;
+}
+
+Status LoadCachesFromWarmup(const ImmutableDBOptions& db_options,
+                            const std::vector<Version*>& versions) {
+  const std::string& dir = db_options.cache_warmup_dir;
+  std::vector<std::string> children;
+  IOStatus io_s =
+      db_options.fs->GetChildren(dir, IOOptions(), &children, nullptr);
+  if (io_s.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  std::vector<std::string> fnames;
+  for (const std::string& child : children) {
+    if (Slice(child).starts_with(kWarmupFilePrefix)) {
+      fnames.push_back(dir + "/" + child);
+    }
+  }
+  if (fnames.empty()) {
+    return Status::OK();
+  }
+
+  std::unordered_map<uint64_t, ColumnFamilyData*> live_files;
+  for (Version* version : versions) {
+    const VersionStorageInfo* vstorage = version->storage_info();
+    for (int level = 0; level < vstorage->num_levels(); level++) {
+      for (FileMetaData* file : vstorage->LevelFiles(level)) {
+        live_files[file->fd.GetNumber()] = version->cfd();
+      }
+    }
+  }
+
+  size_t num_threads = std::min(
+      fnames.size(),
+      static_cast<size_t>(std::max(db_options.cache_warmup_threads, 1)));
+  std::vector<IOStatus> statuses(num_threads);
+  std::vector<port::Thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = t; i < fnames.size(); i += num_threads) {
+        IOStatus s = LoadWarmupFile(db_options, fnames[i], live_files);
+        if (!s.ok() && statuses[t].ok()) {
+          statuses[t] = s;
+        }
+      }
+    });
+  }
+  for (port::Thread& thread : threads) {
+    thread.join();
+  }
+  for (IOStatus& s : statuses) {
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,43 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+
+#include <vector>
+
+#include "options/db_options.h"
+#include "rocksdb/status.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class Version;
+
+// Warms up the block caches and the row cache of a DB across restarts, see
+// DBOptions::cache_warmup_dir.
+//
+// The entries are spread round-robin over DBOptions::cache_warmup_threads
+// files, written in the dump unit format of utilities/cache_dump_load_impl.h.
+// The key of each dump unit starts with the number of the table file the
+// entry belongs to, so that the entries of files deleted in between can be
+// skipped. Blocks keep their block cache key, which is stable across
+// restarts, while rows are keyed by user key, since the row cache keys of a
+// column family change with every open.
+
+// Writes the cache entries of the table files of versions to
+// db_options.cache_warmup_dir, replacing the files there.
+// REQUIRES: versions are referenced, DB mutex not held
+Status DumpCachesForWarmup(const ImmutableDBOptions& db_options,
+                           const std::vector<Version*>& versions);
+
+// Inserts the entries in db_options.cache_warmup_dir whose table file is in
+// versions into the caches, reading the files in parallel, until each cache
+// is full. OK if there is nothing to load.
+// REQUIRES: versions are referenced, DB mutex not held
+Status LoadCachesFromWarmup(const ImmutableDBOptions& db_options,
+                            const std::vector<Version*>& versions);
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
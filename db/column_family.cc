@@ -570,6 +570,10 @@ ColumnFamilyData::ColumnFamilyData(
     table_cache_.reset(new TableCache(ioptions_, file_options, _table_cache,
                                       block_cache_tracer, io_tracer,
                                       db_session_id));
+    table_cache_->SetRowCacheAdmissionOptions(
+        mutable_cf_options_.row_cache_hybrid_admission,
+        mutable_cf_options_.row_cache_invalidation_threshold);
+    table_cache_->SetTraceColumnFamily(id_, name_);
     blob_file_cache_.reset(
         new BlobFileCache(_table_cache, ioptions(), soptions(), id_,
                           internal_stats_->GetBlobFileReadHist(), io_tracer));
@@ -1375,6 +1379,14 @@ Status ColumnFamilyData::ValidateOptions(
         "FIFO compaction only supported with max_open_files = -1.");
   }
 
+  // The timestamps are part of the hashed user keys
+  if (cf_options.comparator->timestamp_size() > 0 &&
+      cf_options.memtable_factory != nullptr &&
+      cf_options.memtable_factory->IsInstanceOf("ConcurrentHashRepFactory")) {
+    return Status::NotSupported(
+        "concurrent_hash memtable does not support user-defined timestamps");
+  }
+
   return s;
 }
 
@@ -1394,6 +1406,11 @@ Status ColumnFamilyData::SetOptions(
   if (s.ok()) {
     mutable_cf_options_ = MutableCFOptions(cf_opts);
     mutable_cf_options_.RefreshDerivedOptions(ioptions_);
+    if (table_cache_) {
+      table_cache_->SetRowCacheAdmissionOptions(
+          mutable_cf_options_.row_cache_hybrid_admission,
+          mutable_cf_options_.row_cache_invalidation_threshold);
+    }
   }
   return s;
 }
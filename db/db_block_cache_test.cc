@@ -814,6 +814,7 @@ class MockCache : public LRUCache {
  public:
   static uint32_t high_pri_insert_count;
   static uint32_t low_pri_insert_count;
+  static uint32_t bottom_pri_insert_count;
 
   MockCache()
       : LRUCache((size_t)1 << 25 /*capacity*/, 0 /*num_shard_bits*/,
@@ -828,6 +829,8 @@ class MockCache : public LRUCache {
     DeleterFn delete_cb = helper_cb->del_cb;
     if (priority == Priority::LOW) {
       low_pri_insert_count++;
+    } else if (priority == Priority::BOTTOM) {
+      bottom_pri_insert_count++;
     } else {
       high_pri_insert_count++;
     }
@@ -837,6 +840,7 @@ class MockCache : public LRUCache {
 
 uint32_t MockCache::high_pri_insert_count = 0;
 uint32_t MockCache::low_pri_insert_count = 0;
+uint32_t MockCache::bottom_pri_insert_count = 0;
 
 }  // anonymous namespace
 
@@ -897,6 +901,61 @@ TEST_F(DBBlockCacheTest, IndexAndFilterBlocksCachePriority) {
   }
 }
 
+TEST_F(DBBlockCacheTest, ScanResistantFill) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  BlockBasedTableOptions table_options;
+  table_options.block_cache.reset(new MockCache());
+  table_options.block_size = 1024;
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  DestroyAndReopen(options);
+
+  Random rnd(301);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), rnd.RandomString(1000)));
+  }
+  ASSERT_OK(Flush());
+
+  MockCache::high_pri_insert_count = 0;
+  MockCache::low_pri_insert_count = 0;
+  MockCache::bottom_pri_insert_count = 0;
+  ReadOptions read_options;
+  read_options.scan_resistant_fill_after_blocks = 10;
+  uint64_t data_misses = TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS);
+  {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    int keys = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      keys++;
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(100, keys);
+  }
+  data_misses =
+      TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS) - data_misses;
+  ASSERT_GT(data_misses, 10u);
+  // The first blocks of the scan are inserted as usual
+  ASSERT_EQ(10u, MockCache::low_pri_insert_count);
+  ASSERT_EQ(data_misses - 10, MockCache::bottom_pri_insert_count);
+  ASSERT_EQ(0u, MockCache::high_pri_insert_count);
+
+  // A seek starts over
+  table_options.block_cache->EraseUnRefEntries();
+  MockCache::low_pri_insert_count = 0;
+  MockCache::bottom_pri_insert_count = 0;
+  {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    iter->Seek(Key(50));
+    for (int i = 0; i < 5 && iter->Valid(); i++) {
+      iter->Next();
+    }
+    ASSERT_OK(iter->status());
+  }
+  ASSERT_GT(MockCache::low_pri_insert_count, 0u);
+  ASSERT_EQ(0u, MockCache::bottom_pri_insert_count);
+}
+
 namespace {
 
 // An LRUCache wrapper that can falsely report "not found" on Lookup.
@@ -1511,6 +1570,63 @@ TEST_F(DBBlockCacheTest, CacheEntryRoleStats) {
   }
 }
 
+TEST_F(DBBlockCacheTest, CacheWarmup) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.cache_warmup_dir = dbname_ + "/cache_warmup";
+  options.cache_warmup_threads = 2;
+  BlockBasedTableOptions table_options;
+  table_options.block_size = 1024;
+  table_options.cache_index_and_filter_blocks = true;
+  table_options.filter_policy.reset(NewBloomFilterPolicy(10));
+  table_options.block_cache = NewLRUCache(1 << 25, 0, false);
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  options.row_cache = NewLRUCache(1 << 20);
+  DestroyAndReopen(options);
+
+  const int kNumKeys = 100;
+  std::string value(100, 'v');
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_OK(Put(Key(i), value));
+  }
+  ASSERT_OK(Flush());
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_EQ(value, Get(Key(i)));
+  }
+  Close();
+
+  // Open with empty caches, as after a restart
+  auto reopen_with_new_caches = [&]() {
+    options.statistics = CreateDBStatistics();
+    table_options.block_cache = NewLRUCache(1 << 25, 0, false);
+    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    options.row_cache = NewLRUCache(1 << 20);
+    Reopen(options);
+  };
+  reopen_with_new_caches();
+  ASSERT_GT(TestGetTickerCount(options, CACHE_WARMUP_ENTRIES_LOADED), 0);
+  ASSERT_EQ(0, TestGetTickerCount(options, CACHE_WARMUP_ENTRIES_SKIPPED));
+  ASSERT_GT(TestGetTickerCount(options, CACHE_WARMUP_BYTES_LOADED), 0);
+  ASSERT_GT(options.row_cache->GetUsage(), 0);
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_EQ(value, Get(Key(i)));
+  }
+  ASSERT_EQ(0, TestGetTickerCount(options, BLOCK_CACHE_DATA_MISS));
+  ASSERT_EQ(0, TestGetTickerCount(options, ROW_CACHE_MISS));
+
+  // The entries of table files deleted since the dump are skipped
+  options.cache_warmup_dir = "";
+  Reopen(options);
+  CompactRangeOptions cro;
+  cro.bottommost_level_compaction = BottommostLevelCompaction::kForce;
+  ASSERT_OK(db_->CompactRange(cro, nullptr, nullptr));
+  Close();
+  options.cache_warmup_dir = dbname_ + "/cache_warmup";
+  reopen_with_new_caches();
+  ASSERT_EQ(0, TestGetTickerCount(options, CACHE_WARMUP_ENTRIES_LOADED));
+  ASSERT_GT(TestGetTickerCount(options, CACHE_WARMUP_ENTRIES_SKIPPED), 0);
+}
+
 #endif  // ROCKSDB_LITE
 
 class DBBlockCacheKeyTest
@@ -57,6 +57,11 @@ class CompactedDBImpl : public DBImpl {
                        WriteBatch* /*updates*/) override {
     return Status::NotSupported("Not supported in compacted db mode.");
   }
+  virtual void WriteAsync(
+      const WriteOptions& /*options*/, WriteBatch* /*updates*/,
+      std::function<void(const Status&)> callback) override {
+    callback(Status::NotSupported("Not supported in compacted db mode."));
+  }
   using DBImpl::CompactRange;
   virtual Status CompactRange(const CompactRangeOptions& /*options*/,
                               ColumnFamilyHandle* /*column_family*/,
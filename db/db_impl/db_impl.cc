@@ -28,6 +28,7 @@
 
 #include "db/arena_wrapped_db_iter.h"
 #include "db/builder.h"
+#include "db/cache_warmup.h"
 #include "db/compaction/compaction_job.h"
 #include "db/db_info_dumper.h"
 #include "db/db_iter.h"
@@ -181,10 +182,14 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
       log_empty_(true),
       persist_stats_cf_handle_(nullptr),
       log_sync_cv_(&mutex_),
+      next_wal_shard_(0),
       total_log_size_(0),
       is_snapshot_supported_(true),
       write_buffer_manager_(immutable_db_options_.write_buffer_manager.get()),
       write_thread_(immutable_db_options_),
+      async_write_cv_(&async_write_mutex_),
+      num_async_writes_(0),
+      async_writes_stopped_(false),
       nonmem_write_thread_(immutable_db_options_),
       write_controller_(mutable_db_options_.delayed_write_rate),
       last_batch_group_size_(0),
@@ -254,6 +259,20 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
   co.num_shard_bits = immutable_db_options_.table_cache_numshardbits;
   co.metadata_charge_policy = kDontChargeCacheMetadata;
   table_cache_ = NewLRUCache(co);
+  write_thread_.SetAsyncWriterHandler(
+      [this](WriteThread::Writer* w) { HandOverAsyncWrite(w); });
+  if (immutable_db_options_.row_cache) {
+    row_cache_invalidator_.reset(new RowCacheInvalidator(
+        env_, stats_, &DBImpl::BGWorkRowCacheInvalidation, this));
+    // Migrated rows are checked for newer writes on the write thread, which
+    // relies on earlier write groups being in the memtable by then
+    if (!read_only && !seq_per_batch && !two_write_queues_ &&
+        !immutable_db_options_.enable_pipelined_write &&
+        !immutable_db_options_.unordered_write) {
+      row_cache_migrator_.reset(new RowCacheMigrator(
+          env_, &DBImpl::BGWorkRowCacheMigration, this));
+    }
+  }
   SetDbSessionId();
   assert(!db_session_id_.empty());
 
@@ -519,6 +538,9 @@ void DBImpl::CancelAllBackgroundWork(bool wait) {
 }
 
 Status DBImpl::CloseHelper() {
+  // The pending async writes may need flushes to get through write stalls
+  StopAsyncWrites();
+
   // Guarantee that there is no background error recovery in progress before
   // continuing with the shutdown
   mutex_.Lock();
@@ -534,11 +556,20 @@ Status DBImpl::CloseHelper() {
   // reached.
   error_handler_.GetRecoveryError().PermitUncheckedError();
 
+  // Stop writing migrated rows before memtables are flushed on shutdown
+  if (row_cache_migrator_) {
+    row_cache_migrator_->Shutdown();
+  }
+
   // CancelAllBackgroundWork called with false means we just set the shutdown
   // marker. After this we do a variant of the waiting and unschedule work
   // (to consider: moving all the waiting into CancelAllBackgroundWork(true))
   CancelAllBackgroundWork(false);
 
+  if (row_cache_invalidator_) {
+    row_cache_invalidator_->Shutdown();
+  }
+
   // Cancel manual compaction if there's any
   if (HasPendingManualCompaction()) {
     DisableManualCompaction();
@@ -567,6 +598,20 @@ Status DBImpl::CloseHelper() {
   flush_scheduler_.Clear();
   trim_history_scheduler_.Clear();
 
+#ifndef ROCKSDB_LITE
+  if (opened_successfully_ &&
+      !immutable_db_options_.cache_warmup_dir.empty()) {
+    mutex_.Unlock();
+    Status warmup_s = DumpCachesForWarmup();
+    if (!warmup_s.ok()) {
+      ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                     "Unable to dump caches for warm-up: %s",
+                     warmup_s.ToString().c_str());
+    }
+    mutex_.Lock();
+  }
+#endif  // ROCKSDB_LITE
+
   // For now, simply trigger a manual flush at close time
   // on all the column families.
   // TODO(bjlemaire): Check if this is needed. Also, in the
@@ -667,6 +712,7 @@ Status DBImpl::CloseHelper() {
     }
   }
   logs_.clear();
+  wal_shards_.clear();
 
   // Table cache may have table handles holding blocks from the block cache.
   // We need to release them before the block cache is destroyed. The block
@@ -730,6 +776,48 @@ Status DBImpl::CloseHelper() {
   return ret;
 }
 
+#ifndef ROCKSDB_LITE
+Status DBImpl::DumpCachesForWarmup() {
+  std::vector<Version*> versions;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (ColumnFamilyData* cfd : *versions_->GetColumnFamilySet()) {
+      if (!cfd->IsDropped() && cfd->initialized()) {
+        versions.push_back(cfd->current());
+        versions.back()->Ref();
+      }
+    }
+  }
+  Status s = ROCKSDB_NAMESPACE::DumpCachesForWarmup(immutable_db_options_,
+                                                    versions);
+  InstrumentedMutexLock l(&mutex_);
+  for (Version* version : versions) {
+    version->Unref();
+  }
+  return s;
+}
+
+Status DBImpl::LoadCachesFromWarmup() {
+  std::vector<Version*> versions;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (ColumnFamilyData* cfd : *versions_->GetColumnFamilySet()) {
+      if (!cfd->IsDropped() && cfd->initialized()) {
+        versions.push_back(cfd->current());
+        versions.back()->Ref();
+      }
+    }
+  }
+  Status s = ROCKSDB_NAMESPACE::LoadCachesFromWarmup(immutable_db_options_,
+                                                     versions);
+  InstrumentedMutexLock l(&mutex_);
+  for (Version* version : versions) {
+    version->Unref();
+  }
+  return s;
+}
+#endif  // ROCKSDB_LITE
+
 Status DBImpl::CloseImpl() { return CloseHelper(); }
 
 DBImpl::~DBImpl() {
@@ -1347,6 +1435,31 @@ Status DBImpl::FlushWAL(bool sync) {
 }
 
 Status DBImpl::SyncWAL() {
+  if (immutable_db_options_.wal_shards > 1) {
+    // The WAL shards are only accessed from the write thread, and the
+    // previous shard sets were synced when replaced
+    WriteThread::Writer w;
+    autovector<log::Writer*> shards_to_sync;
+    bool need_log_dir_sync;
+    {
+      InstrumentedMutexLock l(&mutex_);
+      write_thread_.EnterUnbatched(&w, &mutex_);
+      for (WalShard& shard : wal_shards_) {
+        shards_to_sync.push_back(shard.writer);
+        shard.unsynced = false;
+      }
+      need_log_dir_sync = !log_dir_synced_;
+    }
+    IOStatus io_s = SyncWalShards(shards_to_sync, need_log_dir_sync);
+    if (!io_s.ok()) {
+      ROCKS_LOG_ERROR(immutable_db_options_.info_log, "WAL Sync error %s",
+                      io_s.ToString().c_str());
+      IOStatusCheck(io_s);
+    }
+    write_thread_.ExitUnbatched(&w);
+    return std::move(io_s);
+  }
+
   autovector<log::Writer*, 1> logs_to_sync;
   bool need_log_dir_sync;
   uint64_t current_log_number;
@@ -1607,6 +1720,181 @@ void DBImpl::BackgroundCallPurge() {
   mutex_.Unlock();
 }
 
+void DBImpl::BackgroundCallRowCacheInvalidation() {
+  RowCacheInvalidator::PendingWork work;
+  // IMPORTANT: once TakePendingWork() returns false, the DB may be destroyed
+  while (row_cache_invalidator_->TakePendingWork(&work)) {
+    size_t erased = 0;
+
+    if (!work.deleted_files.empty()) {
+      // The file numbers are unique to the DB, so each column family only
+      // finds its own files
+      autovector<ColumnFamilyData*> cfds;
+      {
+        InstrumentedMutexLock l(&mutex_);
+        for (auto cfd : *versions_->GetColumnFamilySet()) {
+          cfd->Ref();
+          cfds.push_back(cfd);
+        }
+      }
+      for (ColumnFamilyData* cfd : cfds) {
+        erased +=
+            cfd->table_cache()->EraseRowCacheEntriesOfFiles(work.deleted_files);
+      }
+      InstrumentedMutexLock l(&mutex_);
+      for (ColumnFamilyData* cfd : cfds) {
+        cfd->UnrefAndTryDelete();
+      }
+    }
+
+    // Keys are queued in write order, so those of a column family are mostly
+    // adjacent
+    size_t i = 0;
+    while (i < work.keys.size()) {
+      uint32_t cf_id = work.keys[i].cf_id;
+      size_t end = i + 1;
+      while (end < work.keys.size() && work.keys[end].cf_id == cf_id) {
+        ++end;
+      }
+      std::unique_ptr<ColumnFamilyHandle> cfh =
+          GetColumnFamilyHandleUnlocked(cf_id);
+      ColumnFamilyData* cfd =
+          cfh ? static_cast_with_check<ColumnFamilyHandleImpl>(cfh.get())->cfd()
+              : nullptr;
+      if (cfd != nullptr && !cfd->IsDropped()) {
+        SuperVersion* sv = GetAndRefSuperVersion(cfd);
+        for (; i < end; ++i) {
+          erased += cfd->table_cache()->EraseStaleRowCacheEntries(
+              work.keys[i].user_key, work.keys[i].seq,
+              *sv->current->storage_info(),
+              sv->current->GetRowCacheEpoch());
+        }
+        ReturnAndCleanupSuperVersion(cfd, sv);
+      }
+      i = end;
+    }
+    RecordTick(stats_, ROW_CACHE_STALE_ERASE, erased);
+  }
+}
+
+class DBImpl::RowCacheMigrationCallback : public WriteCallback {
+ public:
+  RowCacheMigrationCallback(DBImpl* db, ColumnFamilyData* cfd,
+                            const RowCacheMigrator::PendingRow& row)
+      : db_(db), cfd_(cfd), row_(row) {}
+
+  Status Callback(DB* /*db*/) override {
+    SuperVersion* sv = db_->GetAndRefSuperVersion(cfd_);
+    bool may_have_changed = RowMayHaveChanged(sv);
+    db_->ReturnAndCleanupSuperVersion(cfd_, sv);
+    return may_have_changed ? Status::Busy("Row written since it was read")
+                            : Status::OK();
+  }
+
+  bool AllowWriteBatching() override { return false; }
+
+ private:
+  // Runs on the write thread, so every write acknowledged so far is in the
+  // memtables of sv, or in its table files. Writes that reach table files
+  // without a memtable, i.e. ingested files, advance the row cache epoch.
+  bool RowMayHaveChanged(SuperVersion* sv) {
+    if (sv->current->GetRowCacheEpoch() != row_.row_cache_epoch) {
+      return true;
+    }
+    if (row_.read_seq <
+        db_->GetEarliestMemTableSequenceNumber(sv, /*include_history=*/false)) {
+      // Writes after the read may have been flushed already
+      return true;
+    }
+    LookupKey lkey(row_.user_key, db_->versions_->LastSequence());
+    ReadOptions read_options;
+    MergeContext merge_context;
+    SequenceNumber max_covering_tombstone_seq = 0;
+    SequenceNumber seq = kMaxSequenceNumber;
+    Status s;
+    // Entries of the active memtable are newer than those of the immutable
+    // ones, so the latter are only needed if it has none for the key
+    sv->mem->Get(lkey, /*value=*/nullptr, /*timestamp=*/nullptr, &s,
+                 &merge_context, &max_covering_tombstone_seq, &seq,
+                 read_options);
+    if (seq == kMaxSequenceNumber) {
+      s = Status::OK();
+      sv->imm->Get(lkey, /*value=*/nullptr, /*timestamp=*/nullptr, &s,
+                   &merge_context, &max_covering_tombstone_seq, &seq,
+                   read_options);
+    }
+    return (seq != kMaxSequenceNumber && seq > row_.read_seq) ||
+           max_covering_tombstone_seq > row_.read_seq;
+  }
+
+  DBImpl* const db_;
+  ColumnFamilyData* const cfd_;
+  const RowCacheMigrator::PendingRow& row_;
+};
+
+void DBImpl::BackgroundCallRowCacheMigration() {
+  std::vector<RowCacheMigrator::PendingRow> rows;
+  // IMPORTANT: once TakePendingRows() returns false, the DB may be destroyed
+  while (row_cache_migrator_->TakePendingRows(&rows)) {
+    uint64_t migrated = 0;
+    for (const auto& row : rows) {
+      if (MigrateRow(row)) {
+        ++migrated;
+      }
+    }
+    RecordTick(stats_, ROW_CACHE_MIGRATED, migrated);
+    RecordTick(stats_, ROW_CACHE_MIGRATION_DROPPED, rows.size() - migrated);
+  }
+}
+
+void DBImpl::DisableRowCacheMigration() {
+  if (row_cache_migrator_) {
+    row_cache_migrator_->Shutdown();
+    row_cache_migrator_.reset();
+  }
+}
+
+bool DBImpl::MigrateRow(const RowCacheMigrator::PendingRow& row) {
+  if (write_buffer_manager_->ShouldFlush() ||
+      write_buffer_manager_->ShouldStall() || write_controller_.IsStopped() ||
+      write_controller_.NeedsDelay()) {
+    // Never add to memory pressure
+    return false;
+  }
+  std::unique_ptr<ColumnFamilyHandle> cfh =
+      GetColumnFamilyHandleUnlocked(row.cf_id);
+  ColumnFamilyData* cfd =
+      cfh ? static_cast_with_check<ColumnFamilyHandleImpl>(cfh.get())->cfd()
+          : nullptr;
+  if (cfd == nullptr || cfd->IsDropped()) {
+    return false;
+  }
+  SuperVersion* sv = GetAndRefSuperVersion(cfd);
+  uint64_t budget = sv->mutable_cf_options.row_cache_migration_budget;
+  uint64_t memtable_id = sv->mem->GetID();
+  ReturnAndCleanupSuperVersion(cfd, sv);
+  if (!row_cache_migrator_->ConsumeBudget(
+          row.cf_id, memtable_id, row.user_key.size() + row.value.size(),
+          budget)) {
+    return false;
+  }
+
+  WriteBatch batch;
+  Status s = batch.Put(cfh.get(), row.user_key, row.value);
+  if (s.ok()) {
+    // Not a write to the row: keep it out of row cache invalidation
+    WriteBatchInternal::SetAsRowCacheMigration(&batch);
+    // The row is already durable in table files
+    WriteOptions write_options;
+    write_options.disableWAL = true;
+    write_options.no_slowdown = true;
+    RowCacheMigrationCallback callback(this, cfd, row);
+    TEST_SYNC_POINT("DBImpl::MigrateRow:BeforeWrite");
+    s = WriteWithCallback(write_options, &batch, &callback);
+  }
+  return s.ok();
+}
+
 namespace {
 struct IterState {
   IterState(DBImpl* _db, InstrumentedMutex* _mu, SuperVersion* _super_version,
@@ -1878,14 +2166,6 @@ Status DBImpl::GetImpl(const ReadOptions& read_options, const Slice& key,
         get_impl_options.value->PinSelf();
         s.SetLastLevel(-1);
         RecordTick(stats_, MEMTABLE_HIT);
-        // [logging 추가]
-        ////
-        if (const char* p = std::getenv("MEMTABLE_CHECK_LOGGING"); p && p[0] == '1'){
-          std::string key_hex = key.ToString(true);
-          std::fprintf(stderr, "[Mutable MemTable hit] key=%s\n", key_hex.c_str());
-          std::fflush(stderr);
-        }
-        ////
       // [point lookup flow 조사] - 5-2. Immutable MemTable hit인 경우
       } else if ((s.ok() || s.IsMergeInProgress()) &&
                  sv->imm->Get(lkey, get_impl_options.value->GetSelf(),
@@ -1897,14 +2177,6 @@ Status DBImpl::GetImpl(const ReadOptions& read_options, const Slice& key,
         get_impl_options.value->PinSelf();
         s.SetLastLevel(-1);
         RecordTick(stats_, MEMTABLE_HIT);
-        // [logging 추가]
-        ////
-        if (const char* p = std::getenv("MEMTABLE_CHECK_LOGGING"); p && p[0] == '1'){
-          std::string key_hex = key.ToString(true);
-          std::fprintf(stderr, "[Immutable MemTable hit] key=%s\n", key_hex.c_str());
-          std::fflush(stderr);
-        }
-        ////
       }
     } else {
       // Get Merge Operands associated with key, Merge Operands should not be
@@ -1933,17 +2205,24 @@ Status DBImpl::GetImpl(const ReadOptions& read_options, const Slice& key,
   // [point lookup flow 조사] - 6. MemTable miss인 경우
   if (!done) {
     PERF_TIMER_GUARD(get_from_output_files_time);
-    // [logging 추가]
-    ////
-    if (const char* p = std::getenv("MEMTABLE_CHECK_LOGGING"); p && p[0] == '1'){
-        std::string key_hex = key.ToString(true);
-        std::fprintf(stderr, "[MemTable miss] key=%s\n", key_hex.c_str());
-        std::fflush(stderr);
-    }
-    ////
+    // Rows rejected from the row cache for migration are reported through
+    // out_row_cache_skipped_on_io, so provide one if the caller did not
+    bool may_migrate = row_cache_migrator_ != nullptr &&
+                       sv->mutable_cf_options.row_cache_migration_budget > 0 &&
+                       get_impl_options.get_value &&
+                       get_impl_options.callback == nullptr &&
+                       read_options.snapshot == nullptr;
+    bool skipped_on_io = false;
+    ReadOptions migration_read_options;
+    const ReadOptions* version_read_options = &read_options;
+    if (may_migrate && read_options.out_row_cache_skipped_on_io == nullptr) {
+      migration_read_options = read_options;
+      migration_read_options.out_row_cache_skipped_on_io = &skipped_on_io;
+      version_read_options = &migration_read_options;
+    }
     // [point lookup flow 조사] - 7. db/version_set.cc 내 정의된 Version::Get() 호출
     sv->current->Get(
-        read_options, lkey, get_impl_options.value, timestamp, &s,
+        *version_read_options, lkey, get_impl_options.value, timestamp, &s,
         &merge_context, &max_covering_tombstone_seq, &pinned_iters_mgr,
         get_impl_options.get_value ? get_impl_options.value_found : nullptr,
         nullptr, nullptr,
@@ -1951,6 +2230,16 @@ Status DBImpl::GetImpl(const ReadOptions& read_options, const Slice& key,
         get_impl_options.get_value ? get_impl_options.is_blob_index : nullptr,
         get_impl_options.get_value);
     RecordTick(stats_, MEMTABLE_MISS);
+    if (may_migrate && s.ok() &&
+        *version_read_options->out_row_cache_skipped_on_io &&
+        (get_impl_options.is_blob_index == nullptr ||
+         !*get_impl_options.is_blob_index)) {
+      if (!row_cache_migrator_->Enqueue(cfd->GetID(), key,
+                                        *get_impl_options.value, snapshot,
+                                        sv->current->GetRowCacheEpoch())) {
+        RecordTick(stats_, ROW_CACHE_MIGRATION_DROPPED);
+      }
+    }
   }
 
   {
@@ -2101,6 +2390,23 @@ std::vector<Status> DBImpl::MultiGet(
     read_callback = &timestamp_read_callback;
   }
 
+  // Row cache migration skips are reported per key, so the table lookups
+  // report them through a local flag
+  std::vector<bool>* skipped_on_io =
+      read_options.out_multiget_row_cache_skipped_on_io;
+  bool key_skipped_on_io = false;
+  const ReadOptions* key_read_options = &read_options;
+  ReadOptions row_cache_read_options;
+  if (skipped_on_io != nullptr ||
+      read_options.out_row_cache_skipped_on_io != nullptr) {
+    row_cache_read_options = read_options;
+    row_cache_read_options.out_row_cache_skipped_on_io = &key_skipped_on_io;
+    key_read_options = &row_cache_read_options;
+  }
+  if (skipped_on_io != nullptr) {
+    skipped_on_io->assign(num_keys, false);
+  }
+
   for (keys_read = 0; keys_read < num_keys; ++keys_read) {
     merge_context.Clear();
     Status& s = stat_list[keys_read];
@@ -2137,14 +2443,18 @@ std::vector<Status> DBImpl::MultiGet(
       PinnableSlice pinnable_val;
       PERF_TIMER_GUARD(get_from_output_files_time);
       PinnedIteratorsManager pinned_iters_mgr;
-      super_version->current->Get(read_options, lkey, &pinnable_val, timestamp,
-                                  &s, &merge_context,
+      key_skipped_on_io = false;
+      super_version->current->Get(*key_read_options, lkey, &pinnable_val,
+                                  timestamp, &s, &merge_context,
                                   &max_covering_tombstone_seq,
                                   &pinned_iters_mgr, /*value_found=*/nullptr,
                                   /*key_exists=*/nullptr,
                                   /*seq=*/nullptr, read_callback);
       value->assign(pinnable_val.data(), pinnable_val.size());
       RecordTick(stats_, MEMTABLE_MISS);
+      if (skipped_on_io != nullptr && key_skipped_on_io) {
+        (*skipped_on_io)[keys_read] = true;
+      }
     }
 
     if (s.ok()) {
@@ -2457,6 +2767,7 @@ void DBImpl::MultiGet(const ReadOptions& read_options, const size_t num_keys,
       iter.cfd->GetSuperVersion()->Unref();
     }
   }
+  ReportRowCacheSkippedOnIO(read_options, key_context);
 }
 
 namespace {
@@ -2488,6 +2799,21 @@ struct CompareKeyContext {
 
 }  // anonymous namespace
 
+void DBImpl::ReportRowCacheSkippedOnIO(
+    const ReadOptions& read_options,
+    const autovector<KeyContext, MultiGetContext::MAX_BATCH_SIZE>&
+        key_context) {
+  std::vector<bool>* skipped_on_io =
+      read_options.out_multiget_row_cache_skipped_on_io;
+  if (skipped_on_io == nullptr) {
+    return;
+  }
+  skipped_on_io->resize(key_context.size());
+  for (size_t i = 0; i < key_context.size(); ++i) {
+    (*skipped_on_io)[i] = key_context[i].row_cache_skipped_on_io;
+  }
+}
+
 void DBImpl::PrepareMultiGetKeys(
     size_t num_keys, bool sorted_input,
     autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE>* sorted_keys) {
@@ -2538,6 +2864,7 @@ void DBImpl::MultiGet(const ReadOptions& read_options,
   }
   PrepareMultiGetKeys(num_keys, sorted_input, &sorted_keys);
   MultiGetWithCallback(read_options, column_family, nullptr, &sorted_keys);
+  ReportRowCacheSkippedOnIO(read_options, key_context);
 }
 
 void DBImpl::MultiGetWithCallback(
@@ -3731,6 +4058,10 @@ Status DBImpl::GetUpdatesSince(
     SequenceNumber seq, std::unique_ptr<TransactionLogIterator>* iter,
     const TransactionLogIterator::ReadOptions& read_options) {
   RecordTick(stats_, GET_UPDATES_SINCE_CALLS);
+  if (immutable_db_options_.wal_shards > 1) {
+    return Status::NotSupported(
+        "GetUpdatesSince() is not supported with wal_shards > 1");
+  }
   if (seq > versions_->LastSequence()) {
     return Status::NotFound("Requested sequence not yet written in the db");
   }
@@ -3816,6 +4147,7 @@ Status DBImpl::DeleteFile(std::string name) {
     }
     edit.SetColumnFamily(cfd->GetID());
     edit.DeleteFile(level, number);
+    edit.MarkInvalidatesRowCache();
     status = versions_->LogAndApply(cfd, *cfd->GetLatestMutableCFOptions(),
                                     &edit, &mutex_, directories_.GetDbDir());
     if (status.ok()) {
@@ -3902,6 +4234,7 @@ Status DBImpl::DeleteFilesInRanges(ColumnFamilyHandle* column_family,
       job_context.Clean();
       return status;
     }
+    edit.MarkInvalidatesRowCache();
     input_version->Ref();
     status = versions_->LogAndApply(cfd, *cfd->GetLatestMutableCFOptions(),
                                     &edit, &mutex_, directories_.GetDbDir());
@@ -4871,6 +5204,15 @@ Status DBImpl::IngestExternalFiles(
       }
       if (consumed_seqno_count > 0) {
         const SequenceNumber last_seqno = versions_->LastSequence();
+        if (row_cache_invalidator_) {
+          // Before the ingested keys become visible to readers
+          for (size_t i = 0; i != num_cfs; ++i) {
+            row_cache_invalidator_->OnAllKeysWritten(
+                static_cast<ColumnFamilyHandleImpl*>(args[i].column_family)
+                    ->cfd(),
+                last_seqno + consumed_seqno_count);
+          }
+        }
         versions_->SetLastAllocatedSequence(last_seqno + consumed_seqno_count);
         versions_->SetLastPublishedSequence(last_seqno + consumed_seqno_count);
         versions_->SetLastSequence(last_seqno + consumed_seqno_count);
@@ -4888,6 +5230,7 @@ Status DBImpl::IngestExternalFiles(
         cfds_to_commit.push_back(cfd);
         mutable_cf_options_list.push_back(cfd->GetLatestMutableCFOptions());
         autovector<VersionEdit*> edit_list;
+        ingestion_jobs[i].edit()->MarkInvalidatesRowCache();
         edit_list.push_back(ingestion_jobs[i].edit());
         edit_lists.push_back(edit_list);
         ++num_entries;
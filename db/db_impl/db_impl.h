@@ -35,6 +35,8 @@
 #include "db/pre_release_callback.h"
 #include "db/range_del_aggregator.h"
 #include "db/read_callback.h"
+#include "db/row_cache_invalidator.h"
+#include "db/row_cache_migrator.h"
 #include "db/snapshot_checker.h"
 #include "db/snapshot_impl.h"
 #include "db/trim_history_scheduler.h"
@@ -179,6 +181,9 @@ class DBImpl : public DB {
   using DB::Write;
   virtual Status Write(const WriteOptions& options,
                        WriteBatch* updates) override;
+  virtual void WriteAsync(
+      const WriteOptions& options, WriteBatch* updates,
+      std::function<void(const Status&)> callback) override;
 
   using DB::Get;
   virtual Status Get(const ReadOptions& options,
@@ -730,6 +735,18 @@ class DBImpl : public DB {
   // Schedule a background job to actually delete obsolete files.
   void SchedulePurge();
 
+  // Erases stale row cache entries in the background, nullptr without a row
+  // cache.
+  RowCacheInvalidator* row_cache_invalidator() const {
+    return row_cache_invalidator_.get();
+  }
+
+  // Stops copying rows into memtables for the row cache (ColumnFamilyOptions::
+  // row_cache_migration_budget). Used by transaction DBs, whose locks and
+  // conflict checks such writes would bypass. Must be called before the DB is
+  // shared with readers.
+  void DisableRowCacheMigration();
+
   const SnapshotList& snapshots() const { return snapshots_; }
 
   // load list of snapshots to `snap_vector` that is no newer than `max_seq`
@@ -1014,6 +1031,12 @@ class DBImpl : public DB {
   // Wait for any background purge
   Status TEST_WaitForPurge();
 
+  // Wait until queued row cache invalidations are processed
+  void TEST_WaitForRowCacheInvalidation();
+
+  // Wait until queued row cache migrations are processed
+  void TEST_WaitForRowCacheMigration();
+
   // Get the background error status
   Status TEST_GetBGError();
 
@@ -1057,6 +1080,9 @@ class DBImpl : public DB {
 
   uint64_t TEST_total_log_size() const { return total_log_size_; }
 
+  // Returns the size counted for each alive WAL, by log number
+  std::map<uint64_t, uint64_t> TEST_AliveLogFileSizes();
+
   // Returns column family name to ImmutableCFOptions map.
   Status TEST_GetAllImmutableCFOptions(
       std::unordered_map<std::string, const ImmutableCFOptions*>* iopts_map);
@@ -1199,6 +1225,15 @@ class DBImpl : public DB {
   // table_cache_ provides its own synchronization
   std::shared_ptr<Cache> table_cache_;
 
+  // Provides its own synchronization
+  std::unique_ptr<RowCacheInvalidator> row_cache_invalidator_;
+
+  // Copies rows rejected from the row cache for migration into memtables.
+  // nullptr without a row cache or if the write path cannot check that a
+  // row was not written since it was read (see RowCacheMigrationCallback).
+  // Provides its own synchronization.
+  std::unique_ptr<RowCacheMigrator> row_cache_migrator_;
+
   ErrorHandler error_handler_;
 
   // Unified interface for logging events
@@ -1311,6 +1346,12 @@ class DBImpl : public DB {
                    size_t batch_cnt = 0,
                    PreReleaseCallback* pre_release_callback = nullptr);
 
+  // The part of WriteImpl() done by the leader w of a write group, on the
+  // default write path. options are the WriteOptions of w.
+  Status WriteAsBatchGroupLeader(const WriteOptions& options,
+                                 WriteThread::Writer* w, uint64_t* log_used,
+                                 uint64_t* seq_used);
+
   Status PipelinedWriteImpl(const WriteOptions& options, WriteBatch* updates,
                             WriteCallback* callback = nullptr,
                             uint64_t* log_used = nullptr, uint64_t log_ref = 0,
@@ -1473,6 +1514,24 @@ class DBImpl : public DB {
     bool getting_synced = false;
   };
 
+  // One of the WALs written in parallel when wal_shards > 1
+  struct WalShard {
+    WalShard(uint64_t _number, log::Writer* _writer, bool owned)
+        : number(_number),
+          writer(_writer),
+          owned_writer(owned ? _writer : nullptr) {}
+
+    uint64_t number;
+    log::Writer* writer;
+    // nullptr for the primary WAL of the set, owned by logs_
+    std::unique_ptr<log::Writer> owned_writer;
+    // Appended to since synced
+    bool unsynced = false;
+    // The entry of the shard in alive_log_files_, credited with the bytes
+    // appended to it
+    LogFileNumberSize* alive_log = nullptr;
+  };
+
   // PurgeFileInfo is a structure to hold information of files to be deleted in
   // purge_files_
   struct PurgeFileInfo {
@@ -1789,12 +1848,31 @@ class DBImpl : public DB {
   IOStatus WriteToWAL(const WriteBatch& merged_batch, log::Writer* log_writer,
                       uint64_t* log_used, uint64_t* log_size,
                       Env::IOPriority rate_limiter_priority,
-                      bool with_db_mutex = false, bool with_log_mutex = false);
+                      bool with_db_mutex = false, bool with_log_mutex = false,
+                      LogFileNumberSize* alive_log = nullptr);
 
   IOStatus WriteToWAL(const WriteThread::WriteGroup& write_group,
                       log::Writer* log_writer, uint64_t* log_used,
                       bool need_log_sync, bool need_log_dir_sync,
-                      SequenceNumber sequence);
+                      SequenceNumber sequence,
+                      LogFileNumberSize* alive_log = nullptr);
+
+  // Appends the write group to the WAL shard, to be synced along with the
+  // other shards appended to since synced if need_log_sync. These are added
+  // to shards_to_sync, unless synced here, along with the WAL directory if
+  // need_log_dir_sync, or because their files do not allow syncing
+  // concurrently with appends.
+  IOStatus WriteToWalShard(const WriteThread::WriteGroup& write_group,
+                           WalShard* shard, uint64_t* log_used,
+                           bool need_log_sync, bool need_log_dir_sync,
+                           autovector<log::Writer*>* shards_to_sync,
+                           SequenceNumber sequence);
+
+  // Syncs the given WAL shards, concurrently with appends to them if their
+  // files allow so. Also syncs the WAL directory if need_log_dir_sync, which
+  // takes mutex_ and so is only done from the write thread.
+  IOStatus SyncWalShards(const autovector<log::Writer*>& shards,
+                         bool need_log_dir_sync);
 
   IOStatus ConcurrentWriteToWAL(const WriteThread::WriteGroup& write_group,
                                 uint64_t* log_used,
@@ -1860,12 +1938,25 @@ class DBImpl : public DB {
   static void BGWorkBottomCompaction(void* arg);
   static void BGWorkFlush(void* arg);
   static void BGWorkPurge(void* arg);
+  static void BGWorkRowCacheInvalidation(void* arg);
+  static void BGWorkRowCacheMigration(void* arg);
   static void UnscheduleCompactionCallback(void* arg);
   static void UnscheduleFlushCallback(void* arg);
   void BackgroundCallCompaction(PrepickedCompaction* prepicked_compaction,
                                 Env::Priority thread_pri);
   void BackgroundCallFlush(Env::Priority thread_pri);
   void BackgroundCallPurge();
+  void BackgroundCallRowCacheInvalidation();
+  void BackgroundCallRowCacheMigration();
+
+  // Copies a row queued by row_cache_migrator_ into the active memtable of
+  // its column family, unless the migration budget, write stalls or a newer
+  // write to the row prevent it. Returns whether the row was copied.
+  bool MigrateRow(const RowCacheMigrator::PendingRow& row);
+
+  // Aborts the write of a migrated row if the row may have been written
+  // since it was read.
+  class RowCacheMigrationCallback;
   Status BackgroundCompaction(bool* madeProgress, JobContext* job_context,
                               LogBuffer* log_buffer,
                               PrepickedCompaction* prepicked_compaction,
@@ -1925,6 +2016,14 @@ class DBImpl : public DB {
 
   Status CloseHelper();
 
+#ifndef ROCKSDB_LITE
+  // Writes the cache entries of the live table files to
+  // DBOptions::cache_warmup_dir, or loads them back into the caches.
+  // REQUIRES: mutex_ not held
+  Status DumpCachesForWarmup();
+  Status LoadCachesFromWarmup();
+#endif  // ROCKSDB_LITE
+
   void WaitForBackgroundWork();
 
   // Background threads call this function, which is just a wrapper around
@@ -1974,6 +2073,13 @@ class DBImpl : public DB {
   IOStatus CreateWAL(uint64_t log_file_num, uint64_t recycle_log_number,
                      size_t preallocate_block_size, log::Writer** new_log);
 
+  // Creates the WALs of the shard set led by the primary WAL new_log,
+  // numbered log_numbers after it, and starts each with the WalShardRecord
+  IOStatus CreateWalShards(log::Writer* new_log,
+                           const std::vector<uint64_t>& log_numbers,
+                           size_t preallocate_block_size,
+                           std::vector<WalShard>* shards);
+
   // Validate self-consistency of DB options
   static Status ValidateOptions(const DBOptions& db_options);
   // Validate self-consistency of DB options and its consistency with cf options
@@ -1987,6 +2093,13 @@ class DBImpl : public DB {
       const size_t num_keys, bool sorted,
       autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE>* key_ptrs);
 
+  // Fills ReadOptions::out_multiget_row_cache_skipped_on_io, if set, from the
+  // MultiGet keys in input order
+  static void ReportRowCacheSkippedOnIO(
+      const ReadOptions& read_options,
+      const autovector<KeyContext, MultiGetContext::MAX_BATCH_SIZE>&
+          key_context);
+
   // A structure to hold the information required to process MultiGet of keys
   // belonging to one column family. For a multi column family MultiGet, there
   // will be a container of these objects.
@@ -2140,6 +2253,11 @@ class DBImpl : public DB {
   std::deque<LogWriterNumber> logs_;
   // Signaled when getting_synced becomes false for some of the logs_.
   InstrumentedCondVar log_sync_cv_;
+  // The WAL shard set written to when wal_shards > 1, led by logs_.back(),
+  // and the shard to append the next write group to. Only accessed from
+  // write_thread_, and replaced with both mutex_ and log_write_mutex_ held.
+  std::vector<WalShard> wal_shards_;
+  size_t next_wal_shard_;
   // This is the app-level state that is written to the WAL but will be used
   // only during recovery. Using this feature enables not writing the state to
   // memtable on normal writes and hence improving the throughput. Each new
@@ -2169,6 +2287,40 @@ class DBImpl : public DB {
 
   WriteThread write_thread_;
   WriteBatch tmp_batch_;
+
+  // A write of WriteAsync(). The write thread hands it over to
+  // async_write_thread_ when it is to lead a write group, or is completed.
+  struct AsyncWrite : public WriteThread::Writer {
+    AsyncWrite(const WriteOptions& _options, WriteBatch* _batch,
+               std::function<void(const Status&)>&& _callback)
+        : Writer(_options, _batch, nullptr /* callback */, 0 /* log_ref */,
+                 false /* disable_memtable */),
+          options(_options),
+          user_callback(std::move(_callback)) {
+      async = true;
+    }
+
+    WriteOptions options;
+    std::function<void(const Status&)> user_callback;
+  };
+
+  // Handler of the async writers of write_thread_
+  void HandOverAsyncWrite(WriteThread::Writer* w);
+  // Body of async_write_thread_: leads the write groups of async writers and
+  // calls back the completed ones.
+  void AsyncWriteLoop();
+  // Waits for the pending async writes and stops async_write_thread_
+  void StopAsyncWrites();
+
+  port::Mutex async_write_mutex_;
+  port::CondVar async_write_cv_;
+  std::deque<AsyncWrite*> ready_async_writes_;
+  // Async writes submitted and not called back yet
+  uint64_t num_async_writes_;
+  bool async_writes_stopped_;
+  // Started by the first WriteAsync(). Leaders may wait for flushes and
+  // compactions in write stalls, so this is not a thread pool job.
+  std::unique_ptr<port::Thread> async_write_thread_;
   // The write thread when the writers have no memtable write. This will be used
   // in 2PC to batch the prepares separately from the serial commit.
   WriteThread nonmem_write_thread_;
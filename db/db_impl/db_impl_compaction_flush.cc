@@ -2667,6 +2667,16 @@ void DBImpl::BGWorkPurge(void* db) {
   TEST_SYNC_POINT("DBImpl::BGWorkPurge:end");
 }
 
+void DBImpl::BGWorkRowCacheInvalidation(void* db) {
+  IOSTATS_SET_THREAD_POOL_ID(Env::Priority::HIGH);
+  reinterpret_cast<DBImpl*>(db)->BackgroundCallRowCacheInvalidation();
+}
+
+void DBImpl::BGWorkRowCacheMigration(void* db) {
+  IOSTATS_SET_THREAD_POOL_ID(Env::Priority::HIGH);
+  reinterpret_cast<DBImpl*>(db)->BackgroundCallRowCacheMigration();
+}
+
 void DBImpl::UnscheduleCompactionCallback(void* arg) {
   CompactionArg* ca_ptr = reinterpret_cast<CompactionArg*>(arg);
   Env::Priority compaction_pri = ca_ptr->compaction_pri_;
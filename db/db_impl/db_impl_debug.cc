@@ -200,6 +200,18 @@ Status DBImpl::TEST_WaitForPurge() {
   return error_handler_.GetBGError();
 }
 
+void DBImpl::TEST_WaitForRowCacheInvalidation() {
+  if (row_cache_invalidator_) {
+    row_cache_invalidator_->TEST_WaitForIdle();
+  }
+}
+
+void DBImpl::TEST_WaitForRowCacheMigration() {
+  if (row_cache_migrator_) {
+    row_cache_migrator_->TEST_WaitForIdle();
+  }
+}
+
 Status DBImpl::TEST_GetBGError() {
   InstrumentedMutexLock l(&mutex_);
   return error_handler_.GetBGError();
@@ -231,6 +243,15 @@ uint64_t DBImpl::TEST_LogfileNumber() {
   return logfile_number_;
 }
 
+std::map<uint64_t, uint64_t> DBImpl::TEST_AliveLogFileSizes() {
+  InstrumentedMutexLock l(&mutex_);
+  std::map<uint64_t, uint64_t> sizes;
+  for (const LogFileNumberSize& log : alive_log_files_) {
+    sizes[log.number] = log.size;
+  }
+  return sizes;
+}
+
 Status DBImpl::TEST_GetAllImmutableCFOptions(
     std::unordered_map<std::string, const ImmutableCFOptions*>* iopts_map) {
   std::vector<std::string> cf_names;
@@ -440,6 +440,7 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
   }
 
   std::vector<std::string> old_info_log_files;
+  std::vector<uint64_t> deleted_table_files;
   InfoLogPrefix info_log_prefix(!immutable_db_options_.db_log_dir.empty(),
                                 dbname_);
 
@@ -552,6 +553,7 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
     if (type == kTableFile) {
       // evict from cache
       TableCache::Evict(table_cache_.get(), number);
+      deleted_table_files.push_back(number);
       fname = MakeTableFileName(candidate_file.file_path, number);
       dir_to_sync = candidate_file.file_path;
     } else if (type == kBlobFile) {
@@ -589,6 +591,10 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
     }
   }
 
+  if (row_cache_invalidator_) {
+    row_cache_invalidator_->OnTableFilesDeleted(deleted_table_files);
+  }
+
   {
     // After purging obsolete files, remove them from files_grabbed_for_purge_.
     InstrumentedMutexLock guard_lock(&mutex_);
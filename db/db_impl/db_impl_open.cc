@@ -7,6 +7,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #include <cinttypes>
+#include <unordered_set>
 
 #include "db/builder.h"
 #include "db/db_impl/db_impl.h"
@@ -282,6 +283,26 @@ Status DBImpl::ValidateOptions(const DBOptions& db_options) {
         "atomic_flush is currently incompatible with best-efforts recovery");
   }
 
+  if (db_options.wal_shards == 0 || db_options.wal_shards > 64) {
+    return Status::InvalidArgument("wal_shards must be from 1 to 64");
+  }
+
+  if (db_options.wal_shards > 1) {
+    if (!db_options.enable_pipelined_write) {
+      return Status::InvalidArgument(
+          "wal_shards > 1 requires enable_pipelined_write");
+    }
+    if (db_options.two_write_queues || db_options.allow_2pc ||
+        db_options.manual_wal_flush || db_options.recycle_log_file_num > 0 ||
+        db_options.allow_mmap_writes ||
+        db_options.track_and_verify_wals_in_manifest) {
+      return Status::NotSupported(
+          "wal_shards > 1 is incompatible with two_write_queues, allow_2pc, "
+          "manual_wal_flush, recycle_log_file_num, allow_mmap_writes and "
+          "track_and_verify_wals_in_manifest");
+    }
+  }
+
   if (db_options.use_direct_io_for_flush_and_compaction &&
       0 == db_options.writable_file_max_buffer_size) {
     return Status::InvalidArgument(
@@ -866,6 +887,8 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
   bool flushed = false;
   uint64_t corrupted_wal_number = kMaxSequenceNumber;
   uint64_t min_wal_number = MinLogNumberToKeep();
+  // WALs replayed along with the primary WAL of their shard set
+  std::unordered_set<uint64_t> replayed_wal_shards;
   for (auto wal_number : wal_numbers) {
     if (wal_number < min_wal_number) {
       ROCKS_LOG_INFO(immutable_db_options_.info_log,
@@ -878,6 +901,9 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
     // records after allocating this log number.  So we manually
     // update the file number allocation counter in VersionSet.
     versions_->MarkFileNumberUsed(wal_number);
+    if (replayed_wal_shards.count(wal_number) > 0) {
+      continue;
+    }
     // Open the log file
     std::string fname =
         LogFileName(immutable_db_options_.GetWalDir(), wal_number);
@@ -938,21 +964,103 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
     log::Reader reader(immutable_db_options_.info_log, std::move(file_reader),
                        &reporter, true /*checksum*/, wal_number);
 
+    // If the log is the primary WAL of a shard set, the other shards of the
+    // set follow it, and the records are read from each in turn, in the
+    // order they were written. nullptr for a shard whose file is missing.
+    struct WalShardReader {
+      std::string fname;
+      LogReporter reporter;
+      std::unique_ptr<log::Reader> reader;
+    };
+    std::vector<std::unique_ptr<WalShardReader>> shard_readers;
+    bool first_read = true;
+    size_t shard_turn = 0;
+    bool shard_ended = false;
+    LogReporter* record_reporter = &reporter;
+
     // Determine if we should tolerate incomplete records at the tail end of the
     // Read all the records and add to a memtable
     std::string scratch;
     Slice record;
     WriteBatch batch;
 
+    auto read_record = [&]() {
+      if (!first_read && shard_readers.empty()) {
+        return reader.ReadRecord(&record, &scratch,
+                                 immutable_db_options_.wal_recovery_mode);
+      }
+      if (first_read) {
+        first_read = false;
+        bool found = reader.ReadRecord(&record, &scratch,
+                                       immutable_db_options_.wal_recovery_mode);
+        const log::WalShardRecord* shard_record = reader.GetWalShardRecord();
+        if (shard_record == nullptr || !status.ok()) {
+          return found;
+        }
+        if (shard_record->GetShard() != 0) {
+          ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                         "Skipping log #%" PRIu64
+                         " since the primary WAL of its shard set is gone",
+                         wal_number);
+          return false;
+        }
+        for (uint64_t shard_number : shard_record->GetLogNumbers()) {
+          if (shard_number == wal_number) {
+            continue;
+          }
+          replayed_wal_shards.insert(shard_number);
+          shard_readers.emplace_back(new WalShardReader());
+          WalShardReader* shard = shard_readers.back().get();
+          shard->fname =
+              LogFileName(immutable_db_options_.GetWalDir(), shard_number);
+          shard->reporter = reporter;
+          shard->reporter.fname = shard->fname.c_str();
+          std::unique_ptr<FSSequentialFile> file;
+          status = fs_->NewSequentialFile(
+              shard->fname, fs_->OptimizeForLogRead(file_options_), &file,
+              nullptr);
+          if (!status.ok()) {
+            // Records are synced only along with the creation of every
+            // shard, so a shard that is gone has none to replay
+            if (status.IsNotFound()) {
+              status = Status::OK();
+            } else {
+              MaybeIgnoreError(&status);
+            }
+            continue;
+          }
+          versions_->MarkFileNumberUsed(shard_number);
+          shard->reader.reset(new log::Reader(
+              immutable_db_options_.info_log,
+              std::unique_ptr<SequentialFileReader>(new SequentialFileReader(
+                  std::move(file), shard->fname,
+                  immutable_db_options_.log_readahead_size, io_tracer_)),
+              &shard->reporter, true /*checksum*/, shard_number));
+        }
+        shard_ended = !found;
+        return found && status.ok();
+      }
+      // Ends at the first shard to run out of records
+      shard_turn = (shard_turn + 1) % (shard_readers.size() + 1);
+      log::Reader* shard_reader = &reader;
+      record_reporter = &reporter;
+      if (shard_turn > 0) {
+        shard_reader = shard_readers[shard_turn - 1]->reader.get();
+        record_reporter = &shard_readers[shard_turn - 1]->reporter;
+      }
+      shard_ended = shard_reader == nullptr ||
+                    !shard_reader->ReadRecord(
+                        &record, &scratch,
+                        immutable_db_options_.wal_recovery_mode);
+      return !shard_ended;
+    };
+
     TEST_SYNC_POINT_CALLBACK("DBImpl::RecoverLogFiles:BeforeReadWal",
                              /*arg=*/nullptr);
-    while (!stop_replay_by_wal_filter &&
-           reader.ReadRecord(&record, &scratch,
-                             immutable_db_options_.wal_recovery_mode) &&
-           status.ok()) {
+    while (!stop_replay_by_wal_filter && read_record() && status.ok()) {
       if (record.size() < WriteBatchInternal::kHeader) {
-        reporter.Corruption(record.size(),
-                            Status::Corruption("log record too small"));
+        record_reporter->Corruption(record.size(),
+                                    Status::Corruption("log record too small"));
         continue;
       }
 
@@ -1003,7 +1111,7 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
                                    immutable_db_options_.wal_filter->Name());
             MaybeIgnoreError(&status);
             if (!status.ok()) {
-              reporter.Corruption(record.size(), status);
+              record_reporter->Corruption(record.size(), status);
               continue;
             }
             break;
@@ -1070,7 +1178,7 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
       if (!status.ok()) {
         // We are treating this as a failure while reading since we read valid
         // blocks that do not form coherent data
-        reporter.Corruption(record.size(), status);
+        record_reporter->Corruption(record.size(), status);
         continue;
       }
 
@@ -1101,6 +1209,35 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& wal_numbers,
       }
     }
 
+    if (shard_ended && status.ok()) {
+      // A shard that lost its tail ends the set, and the records of the other
+      // shards past that point would leave a hole. Those records were not
+      // synced, since a sync write syncs every shard appended to before it,
+      // so like the torn tail of a single WAL they are only lost writes
+      for (size_t i = 0; i <= shard_readers.size(); i++) {
+        log::Reader* shard_reader =
+            i == 0 ? &reader : shard_readers[i - 1]->reader.get();
+        LogReporter* shard_reporter =
+            i == 0 ? &reporter : &shard_readers[i - 1]->reporter;
+        if (i == shard_turn || shard_reader == nullptr ||
+            !shard_reader->ReadRecord(
+                &record, &scratch, immutable_db_options_.wal_recovery_mode)) {
+          continue;
+        }
+        if (immutable_db_options_.wal_recovery_mode ==
+            WALRecoveryMode::kAbsoluteConsistency) {
+          shard_reporter->Corruption(
+              record.size(),
+              Status::Corruption("WAL shard record past the end of its set"));
+        } else {
+          ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                         "%s: dropping records past the end of its WAL shard "
+                         "set",
+                         shard_reporter->fname);
+        }
+      }
+    }
+
     if (!status.ok()) {
       if (status.IsNotSupported()) {
         // We should not treat NotSupported as corruption. It is rather a clear
@@ -1659,6 +1796,30 @@ IOStatus DBImpl::CreateWAL(uint64_t log_file_num, uint64_t recycle_log_number,
   return io_s;
 }
 
+IOStatus DBImpl::CreateWalShards(log::Writer* new_log,
+                                 const std::vector<uint64_t>& log_numbers,
+                                 size_t preallocate_block_size,
+                                 std::vector<WalShard>* shards) {
+  assert(log_numbers.size() > 1);
+  assert(log_numbers[0] == new_log->get_log_number());
+  shards->clear();
+  shards->emplace_back(log_numbers[0], new_log, false /* owned */);
+  IOStatus io_s;
+  for (size_t i = 1; io_s.ok() && i < log_numbers.size(); i++) {
+    log::Writer* shard_log = nullptr;
+    io_s = CreateWAL(log_numbers[i], 0 /*recycle_log_number*/,
+                     preallocate_block_size, &shard_log);
+    if (shard_log != nullptr) {
+      shards->emplace_back(log_numbers[i], shard_log, true /* owned */);
+    }
+  }
+  for (size_t i = 0; io_s.ok() && i < shards->size(); i++) {
+    io_s = (*shards)[i].writer->AddWalShardRecord(
+        log::WalShardRecord(static_cast<uint32_t>(i), log_numbers));
+  }
+  return io_s;
+}
+
 Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
                     const std::vector<ColumnFamilyDescriptor>& column_families,
                     std::vector<ColumnFamilyHandle*>* handles, DB** dbptr,
@@ -1721,6 +1882,7 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
   // Handles create_if_missing, error_if_exists
   uint64_t recovered_seq(kMaxSequenceNumber);
   s = impl->Recover(column_families, false, false, false, &recovered_seq);
+  std::vector<DBImpl::WalShard> wal_shards;
   if (s.ok()) {
     uint64_t new_log_number = impl->versions_->NewFileNumber();
     log::Writer* new_log = nullptr;
@@ -1728,12 +1890,24 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
         impl->GetWalPreallocateBlockSize(max_write_buffer_size);
     s = impl->CreateWAL(new_log_number, 0 /*recycle_log_number*/,
                         preallocate_block_size, &new_log);
+    if (s.ok() && impl->immutable_db_options_.wal_shards > 1) {
+      std::vector<uint64_t> log_numbers(1, new_log_number);
+      while (log_numbers.size() < impl->immutable_db_options_.wal_shards) {
+        log_numbers.push_back(impl->versions_->NewFileNumber());
+      }
+      s = impl->CreateWalShards(new_log, log_numbers, preallocate_block_size,
+                                &wal_shards);
+      if (!s.ok()) {
+        delete new_log;
+      }
+    }
     if (s.ok()) {
       InstrumentedMutexLock wl(&impl->log_write_mutex_);
       impl->logfile_number_ = new_log_number;
       assert(new_log != nullptr);
       assert(impl->logs_.empty());
       impl->logs_.emplace_back(new_log_number, new_log);
+      impl->wal_shards_ = std::move(wal_shards);
     }
 
     if (s.ok()) {
@@ -1776,6 +1950,13 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
       }
       impl->alive_log_files_.push_back(
           DBImpl::LogFileNumberSize(impl->logfile_number_));
+      for (size_t i = 0; i < impl->wal_shards_.size(); i++) {
+        if (i > 0) {
+          impl->alive_log_files_.push_back(
+              DBImpl::LogFileNumberSize(impl->wal_shards_[i].number));
+        }
+        impl->wal_shards_[i].alive_log = &impl->alive_log_files_.back();
+      }
       impl->alive_log_files_tail_ = impl->alive_log_files_.rbegin();
       if (impl->two_write_queues_) {
         impl->log_write_mutex_.Unlock();
@@ -1797,14 +1978,20 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
         WriteOptions write_options;
         uint64_t log_used, log_size;
         log::Writer* log_writer = impl->logs_.back().writer;
-        s = impl->WriteToWAL(empty_batch, log_writer, &log_used, &log_size,
-                             Env::IO_TOTAL, /*with_db_mutex==*/true);
+        s = impl->WriteToWAL(
+            empty_batch, log_writer, &log_used, &log_size, Env::IO_TOTAL,
+            /*with_db_mutex==*/true, /*with_log_mutex=*/false,
+            impl->wal_shards_.empty() ? nullptr
+                                      : impl->wal_shards_[0].alive_log);
         if (s.ok()) {
           // Need to fsync, otherwise it might get lost after a power reset.
           s = impl->FlushWAL(false);
           if (s.ok()) {
             s = log_writer->file()->Sync(impl->immutable_db_options_.use_fsync);
           }
+          if (s.ok() && !impl->wal_shards_.empty()) {
+            impl->next_wal_shard_ = 1;
+          }
         }
       }
     }
@@ -1960,6 +2147,16 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
   if (s.ok()) {
     s = impl->StartPeriodicWorkScheduler();
   }
+#ifndef ROCKSDB_LITE
+  if (s.ok() && !impl->immutable_db_options_.cache_warmup_dir.empty()) {
+    Status warmup_s = impl->LoadCachesFromWarmup();
+    if (!warmup_s.ok()) {
+      ROCKS_LOG_WARN(impl->immutable_db_options_.info_log,
+                     "Unable to warm up caches: %s",
+                     warmup_s.ToString().c_str());
+    }
+  }
+#endif  // ROCKSDB_LITE
   if (!s.ok()) {
     for (auto* h : *handles) {
       delete h;
@@ -67,6 +67,12 @@ class DBImplReadOnly : public DBImpl {
                        WriteBatch* /*updates*/) override {
     return Status::NotSupported("Not supported operation in read only mode.");
   }
+  virtual void WriteAsync(
+      const WriteOptions& /*options*/, WriteBatch* /*updates*/,
+      std::function<void(const Status&)> callback) override {
+    callback(
+        Status::NotSupported("Not supported operation in read only mode."));
+  }
   using DBImpl::CompactRange;
   virtual Status CompactRange(const CompactRangeOptions& /*options*/,
                               ColumnFamilyHandle* /*column_family*/,
@@ -653,6 +653,9 @@ Status DB::OpenAsSecondary(
   }
 
   DBOptions tmp_opts(db_options);
+  // Files flushed by the primary change keys without the secondary seeing
+  // all the writes
+  tmp_opts.row_cache_key_by_user_key = false;
   Status s;
   if (nullptr == tmp_opts.info_log) {
     s = CreateLoggerFromOptions(secondary_path, tmp_opts, &tmp_opts.info_log);
@@ -139,6 +139,12 @@ class DBImplSecondary : public DBImpl {
                WriteBatch* /*updates*/) override {
     return Status::NotSupported("Not supported operation in secondary mode.");
   }
+  void WriteAsync(
+      const WriteOptions& /*options*/, WriteBatch* /*updates*/,
+      std::function<void(const Status&)> callback) override {
+    callback(
+        Status::NotSupported("Not supported operation in secondary mode."));
+  }
 
   using DBImpl::CompactRange;
   Status CompactRange(const CompactRangeOptions& /*options*/,
@@ -16,6 +16,7 @@
 #include "options/options_helper.h"
 #include "test_util/sync_point.h"
 #include "util/cast_util.h"
+#include "util/mutexlock.h"
 
 namespace ROCKSDB_NAMESPACE {
 // Convenience methods
@@ -118,6 +119,109 @@ Status DBImpl::WriteWithCallback(const WriteOptions& write_options,
 }
 #endif  // ROCKSDB_LITE
 
+void DBImpl::WriteAsync(const WriteOptions& write_options,
+                        WriteBatch* my_batch,
+                        std::function<void(const Status&)> callback) {
+  // Only the writers of the default write path, whose group leader does all
+  // the work, can be left without a thread. Writes that WriteImpl() rejects,
+  // throttles or traces before joining the write thread are done here too.
+  if (my_batch == nullptr || immutable_db_options_.enable_pipelined_write ||
+      immutable_db_options_.unordered_write || two_write_queues_ ||
+      seq_per_batch_ || tracer_ || write_options.low_pri ||
+      (write_options.sync && write_options.disableWAL) ||
+      write_options.rate_limiter_priority != Env::IO_TOTAL ||
+      WriteBatchInternal::TimestampsUpdateNeeded(*my_batch)) {
+    callback(Write(write_options, my_batch));
+    return;
+  }
+
+  AsyncWrite* w = new AsyncWrite(write_options, my_batch, std::move(callback));
+  {
+    MutexLock l(&async_write_mutex_);
+    assert(!async_writes_stopped_);
+    if (async_write_thread_ == nullptr) {
+      async_write_thread_.reset(
+          new port::Thread(&DBImpl::AsyncWriteLoop, this));
+    }
+    num_async_writes_++;
+  }
+  write_thread_.JoinBatchGroup(w);
+}
+
+void DBImpl::HandOverAsyncWrite(WriteThread::Writer* w) {
+  MutexLock l(&async_write_mutex_);
+  ready_async_writes_.push_back(static_cast<AsyncWrite*>(w));
+  async_write_cv_.SignalAll();
+}
+
+void DBImpl::AsyncWriteLoop() {
+  std::deque<AsyncWrite*> ready;
+  while (true) {
+    {
+      MutexLock l(&async_write_mutex_);
+      while (ready_async_writes_.empty() && !async_writes_stopped_) {
+        async_write_cv_.Wait();
+      }
+      if (ready_async_writes_.empty()) {
+        return;
+      }
+      ready.swap(ready_async_writes_);
+    }
+
+    // Calls back the completed writes first, rather than after the write of
+    // the next group
+    AsyncWrite* leader = nullptr;
+    uint64_t num_done = 0;
+    for (AsyncWrite* w : ready) {
+      if (w->state.load(std::memory_order_acquire) ==
+          WriteThread::STATE_GROUP_LEADER) {
+        // There is one leader at a time
+        assert(leader == nullptr);
+        leader = w;
+        continue;
+      }
+      assert(w->state.load(std::memory_order_relaxed) ==
+             WriteThread::STATE_COMPLETED);
+      w->user_callback(w->FinalStatus());
+      delete w;
+      num_done++;
+    }
+    ready.clear();
+    if (leader != nullptr) {
+      // Leads the group like a writer of WriteImpl() from now on
+      leader->async = false;
+      Status s = WriteAsBatchGroupLeader(leader->options, leader,
+                                         nullptr /* log_used */,
+                                         nullptr /* seq_used */);
+      leader->user_callback(s);
+      delete leader;
+      num_done++;
+    }
+
+    MutexLock l(&async_write_mutex_);
+    assert(num_async_writes_ >= num_done);
+    num_async_writes_ -= num_done;
+    if (num_async_writes_ == 0) {
+      async_write_cv_.SignalAll();
+    }
+  }
+}
+
+void DBImpl::StopAsyncWrites() {
+  {
+    MutexLock l(&async_write_mutex_);
+    while (num_async_writes_ > 0) {
+      async_write_cv_.Wait();
+    }
+    async_writes_stopped_ = true;
+    async_write_cv_.SignalAll();
+  }
+  if (async_write_thread_ != nullptr) {
+    async_write_thread_->join();
+    async_write_thread_.reset();
+  }
+}
+
 // The main write queue. This is the only write queue that updates LastSequence.
 // When using one write queue, the same sequence also indicates the last
 // published sequence.
@@ -287,6 +391,17 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   }
   // else we are the leader of the write batch group
   assert(w.state == WriteThread::STATE_GROUP_LEADER);
+  PERF_TIMER_STOP(write_pre_and_post_process_time);
+  return WriteAsBatchGroupLeader(write_options, &w, log_used, seq_used);
+}
+
+Status DBImpl::WriteAsBatchGroupLeader(const WriteOptions& write_options,
+                                       WriteThread::Writer* leader,
+                                       uint64_t* log_used,
+                                       uint64_t* seq_used) {
+  PERF_TIMER_GUARD(write_pre_and_post_process_time);
+  WriteThread::Writer& w = *leader;
+  const bool disable_memtable = w.disable_memtable;
   Status status;
   // Once reaches this point, the current writer "w" will try to do its write
   // job.  It may also pick up some of the remaining writers in the "writers_"
@@ -371,6 +486,8 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
           total_count += WriteBatchInternal::Count(writer->batch);
           parallel = parallel && !writer->batch->HasMerge();
         }
+        // Nobody waits on async writers to write their own batches
+        parallel = parallel && !writer->async;
         total_byte_size = WriteBatchInternal::AppendedByteSize(
             total_byte_size, WriteBatchInternal::ByteSize(writer->batch));
         if (writer->pre_release_callback) {
@@ -586,6 +703,13 @@ Status DBImpl::PipelinedWriteImpl(const WriteOptions& write_options,
     w.status = PreprocessWrite(write_options, &need_log_sync, &write_context);
     PERF_TIMER_START(write_pre_and_post_process_time);
     log::Writer* log_writer = logs_.back().writer;
+    WalShard* wal_shard = nullptr;
+    if (!wal_shards_.empty()) {
+      wal_shard = &wal_shards_[next_wal_shard_];
+      log_writer = wal_shard->writer;
+      // A memtable switch creates new files
+      need_log_dir_sync = need_log_sync && !log_dir_synced_;
+    }
     mutex_.Unlock();
 
     // This can set non-OK status if callback fail.
@@ -639,6 +763,7 @@ Status DBImpl::PipelinedWriteImpl(const WriteOptions& write_options,
 
     IOStatus io_s;
     io_s.PermitUncheckedError();  // Allow io_s to be uninitialized
+    autovector<log::Writer*> wal_shards_to_sync;
 
     if (w.status.ok() && !write_options.disableWAL) {
       PERF_TIMER_GUARD(write_wal_time);
@@ -649,8 +774,14 @@ Status DBImpl::PipelinedWriteImpl(const WriteOptions& write_options,
                           wal_write_group.size - 1);
         RecordTick(stats_, WRITE_DONE_BY_OTHER, wal_write_group.size - 1);
       }
-      io_s = WriteToWAL(wal_write_group, log_writer, log_used, need_log_sync,
-                        need_log_dir_sync, current_sequence);
+      if (wal_shard == nullptr) {
+        io_s = WriteToWAL(wal_write_group, log_writer, log_used, need_log_sync,
+                          need_log_dir_sync, current_sequence);
+      } else {
+        io_s = WriteToWalShard(wal_write_group, wal_shard, log_used,
+                               need_log_sync, need_log_dir_sync,
+                               &wal_shards_to_sync, current_sequence);
+      }
       w.status = io_s;
     }
 
@@ -662,17 +793,38 @@ Status DBImpl::PipelinedWriteImpl(const WriteOptions& write_options,
       }
     }
 
-    if (need_log_sync) {
-      mutex_.Lock();
-      if (w.status.ok()) {
-        w.status = MarkLogsSynced(logfile_number_, need_log_dir_sync);
-      } else {
-        MarkLogsNotSynced(logfile_number_);
+    if (wal_shard != nullptr) {
+      // Syncs after letting the next leader in, to append to the next shard
+      // meanwhile. The groups still reach the memtable writer queue in
+      // the order of their WAL writes.
+      uint64_t ticket =
+          write_thread_.ExitAsBatchGroupLeaderBeforeSync(wal_write_group);
+      IOStatus sync_io_s;
+      if (w.status.ok() && !wal_shards_to_sync.empty()) {
+        PERF_TIMER_GUARD(write_wal_time);
+        sync_io_s = SyncWalShards(wal_shards_to_sync,
+                                  false /* need_log_dir_sync */);
+        w.status = sync_io_s;
+      }
+      write_thread_.ExitAsSyncedBatchGroupLeader(
+          wal_write_group, ticket, !io_s.ok() || !sync_io_s.ok(), w.status);
+      if (!sync_io_s.ok()) {
+        // Only once passed on, as the db mutex may be held waiting for it
+        IOStatusCheck(sync_io_s);
+      }
+    } else {
+      if (need_log_sync) {
+        mutex_.Lock();
+        if (w.status.ok()) {
+          w.status = MarkLogsSynced(logfile_number_, need_log_dir_sync);
+        } else {
+          MarkLogsNotSynced(logfile_number_);
+        }
+        mutex_.Unlock();
       }
-      mutex_.Unlock();
-    }
 
-    write_thread_.ExitAsBatchGroupLeader(wal_write_group, w.status);
+      write_thread_.ExitAsBatchGroupLeader(wal_write_group, w.status);
+    }
   }
 
   // NOTE: the memtable_write_group is declared before the following
@@ -1097,7 +1249,9 @@ Status DBImpl::PreprocessWrite(const WriteOptions& write_options,
     }
   }
 
-  if (status.ok() && *need_log_sync) {
+  if (status.ok() && *need_log_sync && !wal_shards_.empty()) {
+    // The WAL shards are synced apart from logs_, see WriteToWalShard()
+  } else if (status.ok() && *need_log_sync) {
     // Wait until the parallel syncs are finished. Any sync process has to sync
     // the front log too so it is enough to check the status of front()
     // We do a while loop since log_sync_cv_ is signalled when any sync is
@@ -1145,9 +1299,9 @@ WriteBatch* DBImpl::MergeBatch(const WriteThread::WriteGroup& write_group,
     }
     *write_with_wal = 1;
   } else {
-    // WAL needs all of the batches flattened into a single batch.
-    // We could avoid copying here with an iov-like AddRecord
-    // interface
+    // WAL needs all of the batches flattened into a single batch. The
+    // values referenced by the batches are not copied but gathered when
+    // written.
     merged_batch = tmp_batch;
     for (auto writer : write_group) {
       if (!writer->CallbackFailed()) {
@@ -1172,7 +1326,8 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
                             log::Writer* log_writer, uint64_t* log_used,
                             uint64_t* log_size,
                             Env::IOPriority rate_limiter_priority,
-                            bool with_db_mutex, bool with_log_mutex) {
+                            bool with_db_mutex, bool with_log_mutex,
+                            LogFileNumberSize* alive_log) {
   assert(log_size != nullptr);
 
   // Assert mutex explicitly.
@@ -1183,8 +1338,21 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
     assert(with_log_mutex);
   }
 
-  Slice log_entry = WriteBatchInternal::Contents(&merged_batch);
-  *log_size = log_entry.size();
+  // The values referenced by the batch are gathered from the buffers of the
+  // writers rather than copied into the batch first
+  Slice log_entry;
+  SliceParts log_entry_parts(&log_entry, 1);
+  std::vector<Slice> gathered_parts;
+  std::string gathered_lengths;
+  if (LIKELY(!WriteBatchInternal::HasValueRefs(&merged_batch))) {
+    log_entry = WriteBatchInternal::Contents(&merged_batch);
+  } else {
+    WriteBatchInternal::GetContentsParts(&merged_batch, &gathered_parts,
+                                         &gathered_lengths);
+    log_entry_parts = SliceParts(gathered_parts.data(),
+                                 static_cast<int>(gathered_parts.size()));
+  }
+  *log_size = WriteBatchInternal::ByteSize(&merged_batch);
   // When two_write_queues_ WriteToWAL has to be protected from concurretn calls
   // from the two queues anyway and log_write_mutex_ is already held. Otherwise
   // if manual_wal_flush_ is enabled we need to protect log_writer->AddRecord
@@ -1196,7 +1364,7 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
   if (UNLIKELY(needs_locking)) {
     log_write_mutex_.Lock();
   }
-  IOStatus io_s = log_writer->AddRecord(log_entry, rate_limiter_priority);
+  IOStatus io_s = log_writer->AddRecord(log_entry_parts, rate_limiter_priority);
 
   if (UNLIKELY(needs_locking)) {
     log_write_mutex_.Unlock();
@@ -1204,12 +1372,13 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
   if (log_used != nullptr) {
     *log_used = logfile_number_;
   }
-  total_log_size_ += log_entry.size();
+  total_log_size_ += *log_size;
   if (with_db_mutex || with_log_mutex) {
     assert(alive_log_files_tail_ == alive_log_files_.rbegin());
     assert(alive_log_files_tail_ != alive_log_files_.rend());
   }
-  LogFileNumberSize& last_alive_log = *alive_log_files_tail_;
+  LogFileNumberSize& last_alive_log =
+      alive_log != nullptr ? *alive_log : *alive_log_files_tail_;
   last_alive_log.AddSize(*log_size);
   log_empty_ = false;
   return io_s;
@@ -1218,7 +1387,8 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
 IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
                             log::Writer* log_writer, uint64_t* log_used,
                             bool need_log_sync, bool need_log_dir_sync,
-                            SequenceNumber sequence) {
+                            SequenceNumber sequence,
+                            LogFileNumberSize* alive_log) {
   IOStatus io_s;
   assert(!two_write_queues_);
   assert(!write_group.leader->disable_wal);
@@ -1239,7 +1409,9 @@ IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
 
   uint64_t log_size;
   io_s = WriteToWAL(*merged_batch, log_writer, log_used, &log_size,
-                    write_group.leader->rate_limiter_priority);
+                    write_group.leader->rate_limiter_priority,
+                    false /* with_db_mutex */, false /* with_log_mutex */,
+                    alive_log);
   if (to_be_cached_state) {
     cached_recoverable_state_ = *to_be_cached_state;
     cached_recoverable_state_empty_ = false;
@@ -1304,6 +1476,75 @@ IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
   return io_s;
 }
 
+IOStatus DBImpl::WriteToWalShard(const WriteThread::WriteGroup& write_group,
+                                 WalShard* shard, uint64_t* log_used,
+                                 bool need_log_sync, bool need_log_dir_sync,
+                                 autovector<log::Writer*>* shards_to_sync,
+                                 SequenceNumber sequence) {
+  IOStatus io_s = WriteToWAL(write_group, shard->writer, log_used,
+                             false /* need_log_sync */,
+                             false /* need_log_dir_sync */, sequence,
+                             shard->alive_log);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  next_wal_shard_ = (next_wal_shard_ + 1) % wal_shards_.size();
+  shard->unsynced = true;
+  if (need_log_sync) {
+    // Recovery only reaches the write group if the records written before it
+    // to the other shards are there too
+    bool sync_in_write_thread = need_log_dir_sync;
+    for (WalShard& wal_shard : wal_shards_) {
+      if (wal_shard.unsynced) {
+        shards_to_sync->push_back(wal_shard.writer);
+        wal_shard.unsynced = false;
+        if (!wal_shard.writer->file()->writable_file()->IsSyncThreadSafe()) {
+          sync_in_write_thread = true;
+        }
+      }
+    }
+    if (sync_in_write_thread) {
+      io_s = SyncWalShards(*shards_to_sync, need_log_dir_sync);
+      shards_to_sync->clear();
+    }
+  }
+  return io_s;
+}
+
+IOStatus DBImpl::SyncWalShards(const autovector<log::Writer*>& shards,
+                               bool need_log_dir_sync) {
+  IOStatus io_s;
+  {
+    StopWatch sw(immutable_db_options_.clock, stats_, WAL_FILE_SYNC_MICROS);
+    for (log::Writer* shard : shards) {
+      WritableFileWriter* file = shard->file();
+      if (file->writable_file()->IsSyncThreadSafe()) {
+        io_s = file->SyncWithoutFlush(immutable_db_options_.use_fsync);
+      } else {
+        io_s = file->Sync(immutable_db_options_.use_fsync);
+      }
+      if (!io_s.ok()) {
+        break;
+      }
+    }
+    if (io_s.ok() && need_log_dir_sync) {
+      io_s = directories_.GetWalDir()->FsyncWithDirOptions(
+          IOOptions(), nullptr,
+          DirFsyncOptions(DirFsyncOptions::FsyncReason::kNewFileSynced));
+    }
+  }
+  if (io_s.ok()) {
+    if (need_log_dir_sync) {
+      InstrumentedMutexLock l(&mutex_);
+      log_dir_synced_ = true;
+    }
+    auto stats = default_cf_internal_stats_;
+    stats->AddDBStats(InternalStats::kIntStatsWalFileSynced, 1);
+    RecordTick(stats_, WAL_FILE_SYNCED);
+  }
+  return io_s;
+}
+
 IOStatus DBImpl::ConcurrentWriteToWAL(
     const WriteThread::WriteGroup& write_group, uint64_t* log_used,
     SequenceNumber* last_sequence, size_t seq_inc) {
@@ -1922,6 +2163,13 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
   }
   uint64_t new_log_number =
       creating_new_log ? versions_->NewFileNumber() : logfile_number_;
+  std::vector<uint64_t> wal_shard_numbers;
+  if (creating_new_log && !wal_shards_.empty()) {
+    wal_shard_numbers.push_back(new_log_number);
+    while (wal_shard_numbers.size() < wal_shards_.size()) {
+      wal_shard_numbers.push_back(versions_->NewFileNumber());
+    }
+  }
   const MutableCFOptions mutable_cf_options = *cfd->GetLatestMutableCFOptions();
 
   // Set memtable_info for memtable sealed callback
@@ -1939,11 +2187,29 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
   const auto preallocate_block_size =
       GetWalPreallocateBlockSize(mutable_cf_options.write_buffer_size);
   mutex_.Unlock();
+  std::vector<WalShard> new_wal_shards;
   if (creating_new_log) {
     // TODO: Write buffer size passed in should be max of all CF's instead
     // of mutable_cf_options.write_buffer_size.
     io_s = CreateWAL(new_log_number, recycle_log_number, preallocate_block_size,
                      &new_log);
+    if (io_s.ok() && !wal_shard_numbers.empty()) {
+      io_s = CreateWalShards(new_log, wal_shard_numbers, preallocate_block_size,
+                             &new_wal_shards);
+    }
+    if (io_s.ok() && !wal_shard_numbers.empty()) {
+      // Sync writes only sync the current shard set, and recovery does not
+      // get past a shard set missing records
+      autovector<log::Writer*> shards_to_sync;
+      for (WalShard& shard : wal_shards_) {
+        if (shard.unsynced) {
+          shards_to_sync.push_back(shard.writer);
+        }
+      }
+      if (!shards_to_sync.empty()) {
+        io_s = SyncWalShards(shards_to_sync, false /* need_log_dir_sync */);
+      }
+    }
     if (s.ok()) {
       s = io_s;
     }
@@ -1990,7 +2256,23 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
       log_dir_synced_ = false;
       logs_.emplace_back(logfile_number_, new_log);
       alive_log_files_.push_back(LogFileNumberSize(logfile_number_));
+      for (size_t i = 0; i < new_wal_shards.size(); i++) {
+        if (i > 0) {
+          alive_log_files_.push_back(
+              LogFileNumberSize(new_wal_shards[i].number));
+        }
+        new_wal_shards[i].alive_log = &alive_log_files_.back();
+      }
       alive_log_files_tail_ = alive_log_files_.rbegin();
+      if (!new_wal_shards.empty()) {
+        for (WalShard& shard : wal_shards_) {
+          if (shard.owned_writer != nullptr) {
+            logs_to_free_.push_back(shard.owned_writer.release());
+          }
+        }
+        wal_shards_ = std::move(new_wal_shards);
+        next_wal_shard_ = 0;
+      }
     }
     log_write_mutex_.Unlock();
   }
@@ -334,6 +334,243 @@ TEST_F(DBMemTableTest, ColumnFamilyId) {
   }
 }
 
+#ifndef ROCKSDB_LITE
+TEST_F(DBMemTableTest, ConcurrentHashRep) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  // Few buckets, so that many keys share one
+  options.memtable_factory.reset(NewConcurrentHashRepFactory(16));
+  options.allow_concurrent_memtable_write = true;
+  DestroyAndReopen(options);
+
+  const int kNumThreads = 4;
+  const int kNumKeys = 400;
+  auto Key = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key%05d", i);
+    return std::string(buf);
+  };
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      // Batches of several keys for parallel memtable writes
+      for (int i = t; i < kNumKeys; i += kNumThreads * 2) {
+        WriteBatch batch;
+        ASSERT_OK(batch.Put(Key(i), "old"));
+        ASSERT_OK(batch.Put(Key(i), "v" + Key(i)));
+        if (i + kNumThreads < kNumKeys) {
+          ASSERT_OK(batch.Put(Key(i + kNumThreads), "v" + Key(i)));
+          ASSERT_OK(batch.Delete(Key(i + kNumThreads)));
+        }
+        ASSERT_OK(db_->Write(WriteOptions(), &batch));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto Verify = [&]() {
+    for (int i = 0; i < kNumKeys; ++i) {
+      if (i % (kNumThreads * 2) < kNumThreads) {
+        ASSERT_EQ("v" + Key(i), Get(Key(i)));
+      } else {
+        ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+      }
+    }
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+      if (i % (kNumThreads * 2) == kNumThreads) {
+        i += kNumThreads;
+      }
+      ASSERT_EQ(Key(i), iter->key());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(kNumKeys - kNumThreads, i);
+    iter->Seek(Key(kNumThreads));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(Key(kNumThreads * 2), iter->key());
+    iter->SeekForPrev(Key(kNumKeys));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(Key(kNumKeys - kNumThreads - 1), iter->key());
+    iter->Prev();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(Key(kNumKeys - kNumThreads - 2), iter->key());
+  };
+  Verify();
+  // Iterating the immutable memtable, and its flush, sort it once
+  ASSERT_OK(dbfull()->PauseBackgroundWork());
+  FlushOptions flush_options;
+  flush_options.wait = false;
+  ASSERT_OK(db_->Flush(flush_options));
+  Verify();
+  ASSERT_OK(dbfull()->ContinueBackgroundWork());
+  ASSERT_OK(dbfull()->TEST_WaitForFlushMemTable());
+  ASSERT_EQ(1, NumTableFilesAtLevel(0));
+  Verify();
+
+  // Iterators of a mutable memtable see the entries inserted before they
+  // were created, merged into the sorted entries of the earlier iterators
+  auto Scan = [&](Iterator* iter, const std::string& start) {
+    std::string keys;
+    for (iter->Seek(start); iter->Valid(); iter->Next()) {
+      keys += iter->key().ToString() + ",";
+    }
+    return keys;
+  };
+  ASSERT_OK(Put("zz1", "v"));
+  ASSERT_OK(Put("zz3", "v"));
+  std::unique_ptr<Iterator> iter1(db_->NewIterator(ReadOptions()));
+  ASSERT_EQ("zz1,zz3,", Scan(iter1.get(), "zz"));
+  ASSERT_OK(Put("zz2", "v"));
+  std::unique_ptr<Iterator> iter2(db_->NewIterator(ReadOptions()));
+  ASSERT_EQ("zz1,zz2,zz3,", Scan(iter2.get(), "zz"));
+  ASSERT_EQ("zz1,zz3,", Scan(iter1.get(), "zz"));
+  iter1.reset();
+  iter2.reset();
+
+  // The timestamps would be hashed with the user keys
+  options.comparator = test::BytewiseComparatorWithU64TsWrapper();
+  ASSERT_TRUE(TryReopen(options).IsNotSupported());
+}
+
+TEST_F(DBMemTableTest, BTreeRep) {
+  // Enough keys for a few levels of inner nodes
+  const int kNumThreads = 4;
+  const int kNumKeys = 100000;
+  Options options;
+  options.memtable_factory.reset(NewBTreeRepFactory());
+  options.allow_concurrent_memtable_write = true;
+  InternalKeyComparator cmp(BytewiseComparator());
+  ImmutableOptions ioptions(options);
+  WriteBufferManager wb(options.db_write_buffer_size);
+  MemTable* mem = new MemTable(cmp, ioptions, MutableCFOptions(options), &wb,
+                               kMaxSequenceNumber, 0 /* column_family_id */);
+
+  auto Key = [](int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key%08d", i);
+    return std::string(buf);
+  };
+  auto SeekKey = [](const std::string& user_key) {
+    return InternalKey(user_key, kMaxSequenceNumber, kValueTypeForSeek);
+  };
+
+  // Concurrent inserts in a scrambled order, half of them with hints, while
+  // another thread scans
+  std::atomic<bool> done(false);
+  ROCKSDB_NAMESPACE::port::Thread scan_thread([&]() {
+    Random rnd(301);
+    while (!done.load()) {
+      Arena arena;
+      ScopedArenaIterator iter(mem->NewIterator(ReadOptions(), &arena));
+      iter->Seek(SeekKey(Key(rnd.Uniform(kNumKeys))).Encode());
+      std::string last;
+      for (int n = 0; n < 100 && iter->Valid(); ++n, iter->Next()) {
+        ASSERT_LT(last, ExtractUserKey(iter->key()).ToString());
+        last = ExtractUserKey(iter->key()).ToString();
+      }
+    }
+  });
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      MemTablePostProcessInfo post_process_info;
+      void* hint = nullptr;
+      for (int i = t; i < kNumKeys; i += kNumThreads) {
+        int k = static_cast<int>((static_cast<int64_t>(i) * 7919) % kNumKeys);
+        ASSERT_OK(mem->Add(k + 1, kTypeValue, Key(k), Key(k),
+                           nullptr /* kv_prot_info */, true, &post_process_info,
+                           t % 2 == 0 ? &hint : nullptr));
+      }
+      delete[] reinterpret_cast<char*>(hint);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done.store(true);
+  scan_thread.join();
+
+  MemTablePostProcessInfo post_process_info;
+  ASSERT_TRUE(mem->Add(1, kTypeValue, Key(0), Key(0),
+                       nullptr /* kv_prot_info */, true, &post_process_info)
+                  .IsTryAgain());
+
+  {
+    Arena arena;
+    ScopedArenaIterator iter(mem->NewIterator(ReadOptions(), &arena));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+      ASSERT_EQ(Key(i), ExtractUserKey(iter->key()).ToString());
+    }
+    ASSERT_EQ(kNumKeys, i);
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      ASSERT_EQ(Key(--i), ExtractUserKey(iter->key()).ToString());
+    }
+    ASSERT_EQ(0, i);
+
+    Random rnd(301);
+    for (int n = 0; n < 1000; ++n) {
+      int k = rnd.Uniform(kNumKeys);
+      iter->Seek(SeekKey(Key(k)).Encode());
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(Key(k), ExtractUserKey(iter->key()).ToString());
+      iter->SeekForPrev(InternalKey(Key(k) + "x", 0, kTypeValue).Encode());
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(Key(k), ExtractUserKey(iter->key()).ToString());
+      iter->Prev();
+      ASSERT_EQ(k > 0, iter->Valid());
+      if (k > 0) {
+        ASSERT_EQ(Key(k - 1), ExtractUserKey(iter->key()).ToString());
+      }
+    }
+    iter->Seek(SeekKey(Key(kNumKeys)).Encode());
+    ASSERT_FALSE(iter->Valid());
+  }
+
+  for (int k = 0; k <= kNumKeys; ++k) {
+    std::string value;
+    Status status;
+    MergeContext merge_context;
+    SequenceNumber max_covering_tombstone_seq = 0;
+    LookupKey lkey(Key(k), kMaxSequenceNumber);
+    bool res = mem->Get(lkey, &value, /*timestamp=*/nullptr, &status,
+                        &merge_context, &max_covering_tombstone_seq,
+                        ReadOptions());
+    ASSERT_EQ(k < kNumKeys, res);
+    if (res) {
+      ASSERT_OK(status);
+      ASSERT_EQ(Key(k), value);
+    }
+  }
+  delete mem;
+
+  // Sequential inserts with hints
+  options.memtable_insert_with_hint_prefix_extractor.reset(
+      new TestPrefixExtractor());
+  ioptions = ImmutableOptions(options);
+  mem = new MemTable(cmp, ioptions, MutableCFOptions(options), &wb,
+                     kMaxSequenceNumber, 0 /* column_family_id */);
+  for (int k = 0; k < kNumKeys; ++k) {
+    ASSERT_OK(mem->Add(k + 1, kTypeValue, "foo_" + Key(k), Key(k),
+                       nullptr /* kv_prot_info */));
+  }
+  {
+    Arena arena;
+    ScopedArenaIterator iter(mem->NewIterator(ReadOptions(), &arena));
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+      ASSERT_EQ("foo_" + Key(i), ExtractUserKey(iter->key()).ToString());
+      ASSERT_EQ(Key(i), iter->value().ToString());
+    }
+    ASSERT_EQ(kNumKeys, i);
+  }
+  delete mem;
+}
+#endif  // ROCKSDB_LITE
+
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -32,6 +32,7 @@
 #include "db/db_test_util.h"
 #include "db/dbformat.h"
 #include "db/job_context.h"
+#include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
 #include "env/mock_env.h"
@@ -48,6 +49,7 @@
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/options.h"
 #include "rocksdb/perf_context.h"
+#include "rocksdb/row_cache_admission_policy.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/snapshot.h"
@@ -6718,6 +6720,435 @@ TEST_F(DBTest, RowCache) {
   ASSERT_EQ(TestGetTickerCount(options, ROW_CACHE_MISS), 1);
 }
 
+TEST_F(DBTest, RowCacheHybridAdmissionPerColumnFamily) {
+  Options options = CurrentOptions();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_hybrid_admission = true;
+  options.row_cache_invalidation_threshold = 3;
+  DestroyAndReopen(options);
+  options.row_cache_hybrid_admission = false;
+  CreateColumnFamilies({"pikachu"}, options);
+
+  auto state_of = [](ColumnFamilyHandle* handle) {
+    auto* cfh = static_cast_with_check<ColumnFamilyHandleImpl>(handle);
+    return cfh->cfd()->table_cache()->kvcp_state();
+  };
+  KVCPState* default_state = state_of(db_->DefaultColumnFamily());
+  KVCPState* pikachu_state = state_of(handles_[0]);
+  ASSERT_NE(default_state, pikachu_state);
+
+  ASSERT_TRUE(default_state->hybrid_admission());
+  ASSERT_EQ(3U, default_state->invalidation_threshold());
+  ASSERT_NE(nullptr, default_state->table());
+  ASSERT_FALSE(pikachu_state->hybrid_admission());
+  ASSERT_EQ(nullptr, pikachu_state->table());
+
+  ASSERT_OK(dbfull()->SetOptions(
+      handles_[0], {{"row_cache_hybrid_admission", "true"},
+                    {"row_cache_invalidation_threshold", "5"}}));
+  ASSERT_TRUE(pikachu_state->hybrid_admission());
+  ASSERT_EQ(5U, pikachu_state->invalidation_threshold());
+  ASSERT_NE(nullptr, pikachu_state->table());
+  ASSERT_EQ(3U, default_state->invalidation_threshold());
+
+  ASSERT_OK(Put(0, "foo", "bar"));
+  ASSERT_OK(Flush(0));
+  ASSERT_EQ("bar", Get(0, "foo"));
+  ASSERT_EQ("bar", Get(0, "foo"));
+}
+
+TEST_F(DBTest, RowCacheBackgroundInvalidation) {
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_hybrid_admission = true;
+  options.row_cache_invalidation_threshold = 3;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+  // Charged for the invalidation table
+  const size_t reserved = options.row_cache->GetUsage();
+
+  // Writes to keys not in the row cache are not invalidations
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ(0, TestGetTickerCount(options, ROW_CACHE_INVALIDATION));
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_GT(options.row_cache->GetUsage(), reserved);
+
+  // Overwriting a cached key erases its now stale entry in the background
+  ASSERT_OK(Put("foo", "v2"));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_INVALIDATION));
+  dbfull()->TEST_WaitForRowCacheInvalidation();
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_STALE_ERASE));
+  ASSERT_EQ(reserved, options.row_cache->GetUsage());
+
+  // Entries of table files deleted by compaction are erased too
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_GT(options.row_cache->GetUsage(), reserved);
+  // Rewrites the files, which a trivial move to L1 would not
+  CompactRangeOptions cro;
+  cro.bottommost_level_compaction = BottommostLevelCompaction::kForce;
+  ASSERT_OK(db_->CompactRange(cro, nullptr, nullptr));
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  dbfull()->TEST_WaitForRowCacheInvalidation();
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_STALE_ERASE));
+  ASSERT_EQ(reserved, options.row_cache->GetUsage());
+  ASSERT_EQ("v2", Get("foo"));
+}
+
+TEST_F(DBTest, RowCacheBackgroundInvalidationWithoutHybridAdmission) {
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("bar", "v1"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v1", Get("bar"));
+  const size_t usage = options.row_cache->GetUsage();
+  ASSERT_GT(usage, 0U);
+
+  // Overwriting a cached key erases its now stale entry, without counting
+  // it as an invalidation
+  ASSERT_OK(Put("foo", "v2"));
+  dbfull()->TEST_WaitForRowCacheInvalidation();
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_STALE_ERASE));
+  ASSERT_EQ(0, TestGetTickerCount(options, ROW_CACHE_INVALIDATION));
+  ASSERT_LT(options.row_cache->GetUsage(), usage);
+
+  // As are the entries of table files deleted by compaction
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2", Get("foo"));
+  CompactRangeOptions cro;
+  cro.bottommost_level_compaction = BottommostLevelCompaction::kForce;
+  ASSERT_OK(db_->CompactRange(cro, nullptr, nullptr));
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  dbfull()->TEST_WaitForRowCacheInvalidation();
+  // bar in the first file and foo in the second
+  ASSERT_EQ(3, TestGetTickerCount(options, ROW_CACHE_STALE_ERASE));
+  ASSERT_EQ(0U, options.row_cache->GetUsage());
+  ASSERT_EQ("v1", Get("bar"));
+}
+
+TEST_F(DBTest, RowCacheKeyByUserKey) {
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_key_by_user_key = true;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_MISS));
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_HIT));
+
+  // Still cached after the key moved to another file
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_HIT));
+
+  // Not used once the key is overwritten
+  ASSERT_OK(Put("foo", "v2"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_HIT));
+  ASSERT_EQ("v2", Get("foo"));
+  ASSERT_EQ(3, TestGetTickerCount(options, ROW_CACHE_HIT));
+
+  // Snapshots older than the cached row are not served from it
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("foo", "v3"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2", Get("foo", snapshot));
+  ASSERT_EQ("v3", Get("foo"));
+  ASSERT_EQ("v3", Get("foo"));
+  ASSERT_EQ("v2", Get("foo", snapshot));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Nor after a range deletion
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(), "a",
+                             "z"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+}
+
+TEST_F(DBTest, RowCacheKeyByUserKeyProbedOncePerGet) {
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_key_by_user_key = true;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  // Lookups of foo and goo read both files
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("goo", "v2"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("z", "vz"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("2", FilesPerLevel());
+
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_MISS));
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_HIT));
+
+  std::vector<std::string> values = MultiGet({"foo", "goo"});
+  ASSERT_EQ("v1", values[0]);
+  ASSERT_EQ("v2", values[1]);
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_MISS));
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_HIT));
+  ASSERT_EQ("v2", Get("goo"));
+  ASSERT_EQ(3, TestGetTickerCount(options, ROW_CACHE_HIT));
+}
+
+TEST_F(DBTest, RowCacheTracking) {
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_tracking_sample_rate = 1;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "bar"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("bar", Get("foo"));
+  ASSERT_EQ("bar", Get("foo"));
+  ASSERT_EQ("bar", Get("foo"));
+  options.row_cache->EraseUnRefEntries();
+
+  HistogramData hits;
+  options.statistics->histogramData(ROW_CACHE_ENTRY_HITS, &hits);
+  ASSERT_EQ(1, hits.count);
+  ASSERT_EQ(2, hits.max);
+  HistogramData residency;
+  options.statistics->histogramData(ROW_CACHE_ENTRY_RESIDENCY_MICROS,
+                                    &residency);
+  ASSERT_EQ(1, residency.count);
+}
+
+TEST_F(DBTest, RowCacheAdmissionPolicy) {
+  class CountingPolicy : public RowCacheAdmissionPolicy {
+   public:
+    const char* Name() const override { return "Counting"; }
+    void OnHit(const RowCacheAdmissionContext& /*context*/) override {
+      ++hits;
+    }
+    RowCacheAdmissionDecision Admit(
+        const RowCacheAdmissionContext& context) override {
+      ++admit_calls;
+      return context.user_key == "foo" ? RowCacheAdmissionDecision::kAdmit
+                                       : RowCacheAdmissionDecision::kReject;
+    }
+    std::atomic<int> hits{0};
+    std::atomic<int> admit_calls{0};
+  };
+  auto policy = std::make_shared<CountingPolicy>();
+
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(8192);
+  options.row_cache_admission_policy = policy;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("bar", "v2"));
+  ASSERT_OK(Flush());
+
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v2", Get("bar"));
+  ASSERT_EQ(2, policy->admit_calls.load());
+  ASSERT_EQ(0, policy->hits.load());
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_ADMISSION_REJECT));
+
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ("v2", Get("bar"));
+  ASSERT_EQ(3, policy->admit_calls.load());
+  ASSERT_EQ(1, policy->hits.load());
+
+  std::vector<std::string> values = MultiGet({"foo", "bar"});
+  ASSERT_EQ("v1", values[0]);
+  ASSERT_EQ("v2", values[1]);
+  ASSERT_EQ(4, policy->admit_calls.load());
+  ASSERT_EQ(2, policy->hits.load());
+  ASSERT_EQ(3, TestGetTickerCount(options, ROW_CACHE_ADMISSION_REJECT));
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_HIT));
+}
+
+TEST_F(DBTest, RowCacheMultiGetSkippedOnIO) {
+  class MigratingPolicy : public RowCacheAdmissionPolicy {
+   public:
+    const char* Name() const override { return "Migrating"; }
+    RowCacheAdmissionDecision Admit(
+        const RowCacheAdmissionContext& context) override {
+      if (context.hybrid_admission) {
+        ++hybrid_admit_calls;
+      }
+      return context.user_key == "bar"
+                 ? RowCacheAdmissionDecision::kRejectForMigration
+                 : RowCacheAdmissionDecision::kAdmit;
+    }
+    std::atomic<int> hybrid_admit_calls{0};
+  };
+  auto policy = std::make_shared<MigratingPolicy>();
+
+  Options options = CurrentOptions();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_admission_policy = policy;
+  options.row_cache_hybrid_admission = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("bar", "v2"));
+  ASSERT_OK(Put("baz", "v3"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(Put("qux", "v4"));
+
+  std::vector<bool> skipped_on_io;
+  ReadOptions read_options;
+  read_options.out_multiget_row_cache_skipped_on_io = &skipped_on_io;
+
+  // Batched MultiGet, keys not in sorted order
+  std::vector<Slice> keys = {"qux", "foo", "bar", "baz"};
+  std::vector<PinnableSlice> values(keys.size());
+  std::vector<Status> statuses(keys.size());
+  db_->MultiGet(read_options, db_->DefaultColumnFamily(), keys.size(),
+                keys.data(), values.data(), statuses.data());
+  for (const Status& s : statuses) {
+    ASSERT_OK(s);
+  }
+  ASSERT_EQ("v2", values[2]);
+  ASSERT_EQ(std::vector<bool>({false, false, true, false}), skipped_on_io);
+  ASSERT_EQ(3, policy->hybrid_admit_calls.load());
+
+  // foo and baz are now row cache hits, bar still migrates
+  for (PinnableSlice& value : values) {
+    value.Reset();
+  }
+  db_->MultiGet(read_options, db_->DefaultColumnFamily(), keys.size(),
+                keys.data(), values.data(), statuses.data());
+  ASSERT_EQ(std::vector<bool>({false, false, true, false}), skipped_on_io);
+  ASSERT_EQ(4, policy->hybrid_admit_calls.load());
+
+  // The non-batched API reports the same
+  std::vector<std::string> string_values;
+  std::vector<ColumnFamilyHandle*> cfs(keys.size(),
+                                       db_->DefaultColumnFamily());
+  for (const Status& s : db_->MultiGet(read_options, cfs, keys,
+                                       &string_values)) {
+    ASSERT_OK(s);
+  }
+  ASSERT_EQ(std::vector<bool>({false, false, true, false}), skipped_on_io);
+}
+
+TEST_F(DBTest, RowCacheMigration) {
+  class MigratingPolicy : public RowCacheAdmissionPolicy {
+   public:
+    const char* Name() const override { return "Migrating"; }
+    RowCacheAdmissionDecision Admit(
+        const RowCacheAdmissionContext& /*context*/) override {
+      return RowCacheAdmissionDecision::kRejectForMigration;
+    }
+  };
+
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_admission_policy = std::make_shared<MigratingPolicy>();
+  // Room for one of the rows below
+  options.row_cache_migration_budget = 8;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("bar", "v2"));
+  ASSERT_OK(Flush());
+
+  ASSERT_EQ("v1", Get("foo"));
+  dbfull()->TEST_WaitForRowCacheMigration();
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_MIGRATED));
+  ASSERT_EQ("v2", Get("bar"));
+  dbfull()->TEST_WaitForRowCacheMigration();
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_MIGRATION_DROPPED));
+
+  // The migrated row is read from the memtable
+  uint64_t memtable_hits = TestGetTickerCount(options, MEMTABLE_HIT);
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_EQ(memtable_hits + 1, TestGetTickerCount(options, MEMTABLE_HIT));
+
+  // The budget applies per memtable
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2", Get("bar"));
+  dbfull()->TEST_WaitForRowCacheMigration();
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_MIGRATED));
+
+  // Rows written after they were read are not migrated
+  ASSERT_OK(Flush());
+  SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::MigrateRow:BeforeWrite",
+      [&](void* /*arg*/) { ASSERT_OK(Put("foo", "v3")); });
+  SyncPoint::GetInstance()->EnableProcessing();
+  ASSERT_EQ("v1", Get("foo"));
+  dbfull()->TEST_WaitForRowCacheMigration();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_MIGRATED));
+  ASSERT_EQ(2, TestGetTickerCount(options, ROW_CACHE_MIGRATION_DROPPED));
+  ASSERT_EQ("v3", Get("foo"));
+
+  // Nor after a reopen
+  Reopen(options);
+  ASSERT_EQ("v3", Get("foo"));
+  ASSERT_EQ("v2", Get("bar"));
+}
+
+TEST_F(DBTest, RowCacheMigrationIsNotAWrite) {
+  class MigratingPolicy : public RowCacheAdmissionPolicy {
+   public:
+    const char* Name() const override { return "Migrating"; }
+    RowCacheAdmissionDecision Admit(
+        const RowCacheAdmissionContext& /*context*/) override {
+      return RowCacheAdmissionDecision::kRejectForMigration;
+    }
+  };
+
+  Options options = CurrentOptions();
+  options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
+  options.row_cache = NewLRUCache(1 << 20);
+  options.row_cache_key_by_user_key = true;
+  options.row_cache_admission_policy = std::make_shared<MigratingPolicy>();
+  options.row_cache_migration_budget = 1 << 20;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Flush());
+
+  LastWriteSeqnoFilter* filter =
+      static_cast_with_check<ColumnFamilyHandleImpl>(db_->DefaultColumnFamily())
+          ->cfd()
+          ->table_cache()
+          ->last_write_filter();
+  ASSERT_NE(nullptr, filter);
+  const SequenceNumber last_write = filter->LastWrite("foo");
+
+  ASSERT_EQ("v1", Get("foo"));
+  dbfull()->TEST_WaitForRowCacheMigration();
+  ASSERT_EQ(1, TestGetTickerCount(options, ROW_CACHE_MIGRATED));
+  ASSERT_EQ(last_write, filter->LastWrite("foo"));
+  ASSERT_EQ(0, TestGetTickerCount(options, ROW_CACHE_INVALIDATION));
+  ASSERT_EQ("v1", Get("foo"));
+}
+
 TEST_F(DBTest, PinnableSliceAndRowCache) {
   Options options = CurrentOptions();
   options.statistics = ROCKSDB_NAMESPACE::CreateDBStatistics();
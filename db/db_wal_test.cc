@@ -1231,6 +1231,235 @@ TEST_F(DBWALTest, PartOfWritesWithWALDisabled) {
   Destroy(options);
 }
 
+TEST_F(DBWALTest, ShardedWal) {
+  Options options = CurrentOptions();
+  // Sharded WALs are not tracked in the MANIFEST
+  options.track_and_verify_wals_in_manifest = false;
+  options.wal_shards = 4;
+  ASSERT_TRUE(TryReopen(options).IsInvalidArgument());
+  options.enable_pipelined_write = true;
+  options.manual_wal_flush = true;
+  ASSERT_TRUE(TryReopen(options).IsNotSupported());
+  options.manual_wal_flush = false;
+  DestroyAndReopen(options);
+
+  WriteOptions wal_off;
+  wal_off.disableWAL = true;
+  for (int i = 0; i < 40; i++) {
+    ASSERT_OK(Put(Key(i), "v" + std::to_string(i)));
+    // Leaves a gap in the sequence numbers of the WAL
+    ASSERT_OK(Put("wal_off", "v", wal_off));
+  }
+  VectorLogPtr log_files;
+  ASSERT_OK(dbfull()->GetSortedWalFiles(log_files));
+  ASSERT_EQ(4U, log_files.size());
+  std::unique_ptr<TransactionLogIterator> iter;
+  ASSERT_TRUE(dbfull()->GetUpdatesSince(0, &iter).IsNotSupported());
+  // Switches to a new shard set
+  ASSERT_OK(Flush());
+  for (int i = 40; i < 80; i++) {
+    ASSERT_OK(Put(Key(i), "v" + std::to_string(i)));
+  }
+  ASSERT_OK(Delete(Key(0)));
+
+  Reopen(options);
+  ASSERT_EQ("NOT_FOUND", Get(Key(0)));
+  for (int i = 1; i < 80; i++) {
+    ASSERT_EQ("v" + std::to_string(i), Get(Key(i)));
+  }
+
+  // The shard sets are recovered whatever the option
+  ASSERT_OK(Put(Key(0), "v0"));
+  options.wal_shards = 1;
+  Reopen(options);
+  for (int i = 0; i < 80; i++) {
+    ASSERT_EQ("v" + std::to_string(i), Get(Key(i)));
+  }
+}
+
+TEST_F(DBWALTest, ShardedWalSizes) {
+  Options options = CurrentOptions();
+  options.enable_pipelined_write = true;
+  options.track_and_verify_wals_in_manifest = false;
+  options.wal_shards = 4;
+  DestroyAndReopen(options);
+  for (int i = 0; i < 8; i++) {
+    ASSERT_OK(Put(Key(i), "v"));
+  }
+
+  // Each shard is counted the bytes appended to it
+  VectorLogPtr log_files;
+  ASSERT_OK(dbfull()->GetSortedWalFiles(log_files));
+  ASSERT_EQ(4U, log_files.size());
+  std::map<uint64_t, uint64_t> sizes = dbfull()->TEST_AliveLogFileSizes();
+  uint64_t total_size = 0;
+  for (auto& log_file : log_files) {
+    ASSERT_GT(sizes[log_file->LogNumber()], 0U);
+    total_size += sizes[log_file->LogNumber()];
+  }
+  ASSERT_EQ(dbfull()->TEST_total_log_size(), total_size);
+}
+
+TEST_F(DBWALTest, ShardedWalSyncWrites) {
+  std::unique_ptr<FaultInjectionTestEnv> fault_env(
+      new FaultInjectionTestEnv(env_));
+  Options options = CurrentOptions();
+  options.env = fault_env.get();
+  options.enable_pipelined_write = true;
+  options.track_and_verify_wals_in_manifest = false;
+  options.wal_shards = 4;
+  DestroyAndReopen(options);
+
+  // Sync writes make the writes before them durable, whatever their shard
+  const int kNumThreads = 4;
+  const int kNumKeys = 200;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      WriteOptions wo;
+      wo.sync = (t % 2 == 0);
+      for (int i = 0; i < kNumKeys; i++) {
+        ASSERT_OK(Put(Key(t * kNumKeys + i), "v", wo));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_OK(Put("unsynced", "v"));
+
+  // Simulate a crash.
+  fault_env->SetFilesystemActive(false);
+  Close();
+  ASSERT_OK(fault_env->DropUnsyncedFileData());
+  fault_env->ResetState();
+  Reopen(options);
+  for (int t = 0; t < kNumThreads; t += 2) {
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_EQ("v", Get(Key(t * kNumKeys + i)));
+    }
+  }
+  ASSERT_EQ("NOT_FOUND", Get("unsynced"));
+  // Destroy DB before destruct fault_env.
+  Destroy(options);
+}
+
+TEST_F(DBWALTest, ShardedWalMissingRecord) {
+  for (auto mode : {WALRecoveryMode::kPointInTimeRecovery,
+                    WALRecoveryMode::kAbsoluteConsistency}) {
+    Options options = CurrentOptions();
+    options.enable_pipelined_write = true;
+    options.track_and_verify_wals_in_manifest = false;
+    options.wal_shards = 4;
+    options.wal_recovery_mode = mode;
+    DestroyAndReopen(options);
+    for (int i = 0; i < 10; i++) {
+      ASSERT_OK(Put(Key(i), "v"));
+    }
+
+    VectorLogPtr log_files;
+    ASSERT_OK(dbfull()->GetSortedWalFiles(log_files));
+    ASSERT_EQ(4U, log_files.size());
+    auto get_sizes = [&](std::vector<uint64_t>* sizes) {
+      sizes->clear();
+      for (auto& log_file : log_files) {
+        uint64_t size = 0;
+        ASSERT_OK(env_->GetFileSize(LogFileName(dbname_, log_file->LogNumber()),
+                                    &size));
+        sizes->push_back(size);
+      }
+    };
+    std::vector<uint64_t> sizes_before;
+    get_sizes(&sizes_before);
+    ASSERT_OK(Put(Key(10), "v"));
+    std::vector<uint64_t> sizes_after;
+    get_sizes(&sizes_after);
+    ASSERT_OK(Put(Key(11), "v"));
+    Close();
+
+    // Loses the record of Key(10), leaving the one of Key(11) in the next
+    // shard past the end of the set
+    size_t shard = 0;
+    while (shard < sizes_before.size() &&
+           sizes_before[shard] == sizes_after[shard]) {
+      shard++;
+    }
+    ASSERT_LT(shard, sizes_before.size());
+    ASSERT_OK(test::TruncateFile(
+        env_, LogFileName(dbname_, log_files[shard]->LogNumber()),
+        sizes_before[shard]));
+
+    if (mode == WALRecoveryMode::kAbsoluteConsistency) {
+      ASSERT_TRUE(TryReopen(options).IsCorruption());
+      continue;
+    }
+    Reopen(options);
+    for (int i = 0; i < 10; i++) {
+      ASSERT_EQ("v", Get(Key(i)));
+    }
+    ASSERT_EQ("NOT_FOUND", Get(Key(10)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(11)));
+  }
+}
+
+TEST_F(DBWALTest, ShardedWalTornShardTail) {
+  Options options = CurrentOptions();
+  options.enable_pipelined_write = true;
+  options.track_and_verify_wals_in_manifest = false;
+  options.wal_shards = 4;
+  options.wal_recovery_mode = WALRecoveryMode::kPointInTimeRecovery;
+  DestroyAndReopen(options);
+  CreateAndReopenWithCF({"pikachu"}, options);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(Put(0, Key(i), "v"));
+  }
+  ASSERT_OK(Put(1, "pikachu", "v"));
+
+  VectorLogPtr log_files;
+  ASSERT_OK(dbfull()->GetSortedWalFiles(log_files));
+  ASSERT_EQ(4U, log_files.size());
+  auto get_sizes = [&](std::vector<uint64_t>* sizes) {
+    sizes->clear();
+    for (auto& log_file : log_files) {
+      uint64_t size = 0;
+      ASSERT_OK(env_->GetFileSize(LogFileName(dbname_, log_file->LogNumber()),
+                                  &size));
+      sizes->push_back(size);
+    }
+  };
+  std::vector<uint64_t> sizes_before;
+  get_sizes(&sizes_before);
+  ASSERT_OK(Put(0, Key(10), "v"));
+  std::vector<uint64_t> sizes_after;
+  get_sizes(&sizes_after);
+  ASSERT_OK(Put(0, Key(11), "v"));
+  // Keeps the shard set alive for the default column family, behind the
+  // newer shard set of "pikachu"
+  ASSERT_OK(Flush(1));
+  Close();
+
+  // Loses the unsynced record of Key(10), which ends the set the way the
+  // end of a single WAL does, rather than as a corruption that the newer
+  // WALs of "pikachu" are ahead of
+  size_t shard = 0;
+  while (shard < sizes_before.size() &&
+         sizes_before[shard] == sizes_after[shard]) {
+    shard++;
+  }
+  ASSERT_LT(shard, sizes_before.size());
+  ASSERT_OK(test::TruncateFile(
+      env_, LogFileName(dbname_, log_files[shard]->LogNumber()),
+      sizes_before[shard]));
+
+  ReopenWithColumnFamilies({"default", "pikachu"}, options);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ("v", Get(0, Key(i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Get(0, Key(10)));
+  ASSERT_EQ("NOT_FOUND", Get(0, Key(11)));
+  ASSERT_EQ("v", Get(1, "pikachu"));
+}
+
 //
 // Test WAL recovery for the various modes available
 //
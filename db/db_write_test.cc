@@ -4,6 +4,7 @@
 //  (found in the LICENSE.Apache file in the root directory).
 
 #include <atomic>
+#include <deque>
 #include <fstream>
 #include <memory>
 #include <thread>
@@ -451,6 +452,161 @@ TEST_P(DBWriteTest, ConcurrentlyDisabledWAL) {
     ASSERT_LE(bytes_num, 1024 * 100);
 }
 
+TEST_P(DBWriteTest, WriteAsync) {
+  Options options = GetOptions();
+  Reopen(options);
+
+  // Async writes from a few threads, mixed with sync writes and with more
+  // async writes submitted by the callbacks
+  const int kNumThreads = 4;
+  const int kNumWrites = 500;
+  port::Mutex mutex;
+  port::CondVar cv(&mutex);
+  int num_done = 0;
+  int num_failed = 0;
+  std::deque<WriteBatch> batches;
+  std::function<void(const Status&)> done = [&](const Status& s) {
+    MutexLock l(&mutex);
+    num_done++;
+    if (!s.ok()) {
+      num_failed++;
+    }
+    cv.SignalAll();
+  };
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumWrites; i++) {
+        std::string key = Key(t * kNumWrites + i);
+        WriteBatch* batch;
+        {
+          MutexLock l(&mutex);
+          batches.emplace_back();
+          batch = &batches.back();
+        }
+        ASSERT_OK(batch->Put(key, "v"));
+        WriteOptions wo;
+        wo.sync = (i % 10 == 0);
+        if (t == 0) {
+          ASSERT_OK(db_->Write(wo, batch));
+          done(Status::OK());
+        } else if (t == 1) {
+          db_->WriteAsync(wo, batch, [&, key](const Status& s) {
+            WriteBatch* again;
+            {
+              MutexLock l(&mutex);
+              batches.emplace_back();
+              again = &batches.back();
+            }
+            ASSERT_OK(again->Put(key + "_again", "v"));
+            db_->WriteAsync(WriteOptions(), again, done);
+            done(s);
+          });
+        } else {
+          db_->WriteAsync(wo, batch, done);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  {
+    MutexLock l(&mutex);
+    while (num_done < (kNumThreads + 1) * kNumWrites) {
+      cv.Wait();
+    }
+    ASSERT_EQ(0, num_failed);
+  }
+  for (int i = 0; i < kNumThreads * kNumWrites; i++) {
+    ASSERT_EQ("v", Get(Key(i)));
+  }
+  for (int i = kNumWrites; i < 2 * kNumWrites; i++) {
+    ASSERT_EQ("v", Get(Key(i) + "_again"));
+  }
+
+  Reopen(options);
+  for (int i = 0; i < kNumThreads * kNumWrites; i++) {
+    ASSERT_EQ("v", Get(Key(i)));
+  }
+}
+
+TEST_P(DBWriteTest, WriteAsyncBeforeClose) {
+  Options options = GetOptions();
+  Reopen(options);
+
+  // Close() returns after all callbacks
+  const int kNumWrites = 1000;
+  std::atomic<int> num_done(0);
+  std::vector<WriteBatch> batches(kNumWrites);
+  for (int i = 0; i < kNumWrites; i++) {
+    ASSERT_OK(batches[i].Put(Key(i), "v"));
+    WriteOptions wo;
+    wo.sync = (i % 100 == 0);
+    db_->WriteAsync(wo, &batches[i], [&](const Status& s) {
+      ASSERT_OK(s);
+      num_done.fetch_add(1);
+    });
+  }
+  Close();
+  ASSERT_EQ(kNumWrites, num_done.load());
+
+  Reopen(options);
+  for (int i = 0; i < kNumWrites; i++) {
+    ASSERT_EQ("v", Get(Key(i)));
+  }
+}
+
+TEST_P(DBWriteTest, PutReference) {
+  Options options = GetOptions();
+  options.avoid_flush_during_shutdown = true;
+  Reopen(options);
+
+  // Batches of referenced values from a few threads, to be written to the
+  // WAL in groups, with values spanning the blocks of the log
+  const int kNumThreads = 4;
+  const int kNumWrites = 100;
+  Random rnd(301);
+  const std::string large = rnd.RandomString(100000);
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumWrites; i++) {
+        std::string key = Key(t * kNumWrites + i);
+        std::string head = "head" + key;
+        Slice parts[3] = {head, Slice(large.data(), (i * 997) % large.size()),
+                          key};
+        WriteBatch batch;
+        ASSERT_OK(batch.Put(key + "_copied", "v"));
+        ASSERT_OK(batch.PutReference(key, SliceParts(parts, 3)));
+        Slice small(key);
+        ASSERT_OK(batch.PutReference(key + "_small", SliceParts(&small, 1)));
+        WriteOptions wo;
+        wo.sync = (i % 10 == 0);
+        ASSERT_OK(db_->Write(wo, &batch));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int reopen = 0; reopen < 2; reopen++) {
+    for (int t = 0; t < kNumThreads; t++) {
+      for (int i = 0; i < kNumWrites; i++) {
+        std::string key = Key(t * kNumWrites + i);
+        ASSERT_EQ("head" + key + large.substr(0, (i * 997) % large.size()) +
+                      key,
+                  Get(key));
+        ASSERT_EQ(key, Get(key + "_small"));
+        ASSERT_EQ("v", Get(key + "_copied"));
+      }
+    }
+    // Recovered from the WAL
+    Reopen(options);
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(DBWriteTestInstance, DBWriteTest,
                         testing::Values(DBTestBase::kDefault,
                                         DBTestBase::kConcurrentWALWrites,
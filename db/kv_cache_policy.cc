@@ -1,256 +1,48 @@
-#include "rocksdb/kv_cache_policy.h"
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
 
-#include <mutex>
-#include <unordered_map>
-#include <vector>
-#include <atomic>
-#include "util/hash.h"
+#include "db/kv_cache_policy.h"
 
-namespace ROCKSDB_NAMESPACE {
-
-namespace {
-    struct Entry {
-        uint32_t cached_key_count = 0;
-        uint32_t invalidation_count = 0;
-    };
-
-    struct HKey {
-        const void* db_ptr;
-        uint32_t    cf_id;
-        std::string user_key;
-        bool operator==(const HKey& o) const {
-            return db_ptr == o.db_ptr && cf_id == o.cf_id && user_key == o.user_key;
-        }
-    };
-
-    struct HKeyHash {
-        size_t operator()(const HKey& k) const {
-            uint64_t h = 1469598103934665603ull;
-            auto mix = [&](uint64_t x){ h ^= x; h *= 1099511628211ull; };
-            mix(reinterpret_cast<uint64_t>(k.db_ptr));
-            mix(static_cast<uint64_t>(k.cf_id));
-            h ^= Hash64(k.user_key.data(), k.user_key.size(), 0x9ae16a3b2f90404fULL);
-            h *= 1099511628211ull;
-            return static_cast<size_t>(h);
-        }
-    };
-
-    struct Shard {
-        std::mutex mu;
-        std::unordered_map<HKey, Entry, HKeyHash> map;
-    };
-
-    class KVCPTable {
-        public:
-            static KVCPTable& Inst() {
-                static KVCPTable g;
-                return g;
-            } 
-
-            bool OnInvalidation(const KVCPKeyCtx& k) {
-                auto& sh = ShardRef(k);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                auto it = sh.map.find(MakeKey(k));
-                // Row cache check ~ Row cache insertion 사이에 evict로 인해 hash table서 제거 상태
-                if (it == sh.map.end()){
-                    return false;
-                // 아직 invalidated key가 row cache에 존재하는 상태
-                } else {
-                    ++it->second.invalidation_count;
-                    return true;
-                }
-            }
-
-            bool ShouldSkipInsert(const KVCPKeyCtx& k, uint32_t threshold) {
-                auto& sh = ShardRef(k);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                auto it = sh.map.find(MakeKey(k));
-                if (it == sh.map.end()) return false;
-                return it->second.invalidation_count >= threshold;
-            }
-
-            void OnInsert(const KVCPKeyCtx& k) {
-                auto& sh = ShardRef(k);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                auto& e = sh.map[MakeKey(k)];
-                ++e.cached_key_count;
-            }
-
-            void OnEvict(const KVCPKeyCtx& k) {
-                auto& sh = ShardRef(k);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                auto it = sh.map.find(MakeKey(k));
-                if (it == sh.map.end()) return;
-                auto& e = it->second;
-                if (e.cached_key_count > 1) {
-                --e.cached_key_count;
-                } else {
-                sh.map.erase(it);
-                }
-            }
-
-            uint32_t GetInvalidation(const KVCPKeyCtx& k) {
-                auto& sh = ShardRef(k);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                auto it = sh.map.find(MakeKey(k));
-                if (it == sh.map.end()) return 0;
-                return it->second.invalidation_count;
-            }
-
-            uint32_t GetCachedCount(const KVCPKeyCtx& k) {
-                auto& sh = ShardRef(k);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                auto it = sh.map.find(MakeKey(k));
-                if (it == sh.map.end()) return 0;
-                return it->second.cached_key_count;
-            }
-
-            void ClearAll() {
-                for (auto& sh : shards_) {
-                std::lock_guard<std::mutex> lk(sh.mu);
-                sh.map.clear();
-                }
-            }
-
-        private:
-            static constexpr size_t kShards = 64;
-
-            KVCPTable() : shards_(kShards) {}
-
-            static HKey MakeKey(const KVCPKeyCtx& k) {
-                HKey hk;
-                hk.db_ptr = k.db_ptr;
-                hk.cf_id  = k.cf_id;
-                hk.user_key.assign(k.user_key.data(), k.user_key.size());
-                return hk;
-            }
-
-            size_t ShardIdx(const KVCPKeyCtx& k) const {
-                uint64_t h = 1469598103934665603ull;
-                auto mix = [&](uint64_t x){ h ^= x; h *= 1099511628211ull; };
-                mix(reinterpret_cast<uint64_t>(k.db_ptr));
-                mix(static_cast<uint64_t>(k.cf_id));
-                h ^= Hash64(k.user_key.data(), k.user_key.size(), 0x9ae16a3b2f90404fULL);
-                h *= 1099511628211ull;
-                return static_cast<size_t>(h & (kShards - 1));
-            }
-
-            Shard& ShardRef(const KVCPKeyCtx& k) {
-                return shards_[ShardIdx(k)];
-            }
-
-            std::vector<Shard> shards_;
-    };
-}
-
-bool KVCP_OnRowCacheInvalidation(const KVCPKeyCtx& k) { 
-    return KVCPTable::Inst().OnInvalidation(k); 
-}
-bool KVCP_ShouldSkipRowCacheInsert(const KVCPKeyCtx& k, uint32_t threshold) {
-  return KVCPTable::Inst().ShouldSkipInsert(k, threshold);
-}
-void KVCP_OnRowCacheInsert(const KVCPKeyCtx& k) { KVCPTable::Inst().OnInsert(k); }
-void KVCP_OnRowCacheEvict(const KVCPKeyCtx& k) { KVCPTable::Inst().OnEvict(k); }
-uint32_t KVCP_GetInvalidationCount(const KVCPKeyCtx& k) {
-  return KVCPTable::Inst().GetInvalidation(k);
-}
-uint32_t KVCP_GetCachedKeyCount(const KVCPKeyCtx& k) {
-  return KVCPTable::Inst().GetCachedCount(k);
-}
-void KVCP_ClearAll() { KVCPTable::Inst().ClearAll(); }
-
-static std::atomic<bool> g_kvcp_hybrid_enabled{false};
-
-void KVCP_SetHybridEnabled(bool on) {
-  g_kvcp_hybrid_enabled.store(on, std::memory_order_relaxed);
-}
-
-bool KVCP_IsHybridEnabled() {
-  return g_kvcp_hybrid_enabled.load(std::memory_order_relaxed);
-}
-
-namespace {
-
-    constexpr uint32_t kKVCPDefaultThreshold = 1;
-
-    struct KVCP_TKey {
-        const void* db_ptr;
-        uint32_t cf_id;
-        bool operator==(const KVCP_TKey& o) const {
-            return db_ptr == o.db_ptr && cf_id == o.cf_id;
-        }
-    };
-
-    struct KVCP_TKeyHash {
-        size_t operator()(const KVCP_TKey& k) const {
-            uint64_t h = 1469598103934665603ull;
-            auto mix = [&](uint64_t x){ h ^= x; h *= 1099511628211ull; };
-            mix(reinterpret_cast<uint64_t>(k.db_ptr));
-            mix(static_cast<uint64_t>(k.cf_id));
-            return static_cast<size_t>(h);
-        }
-    };
-
-    struct KVCP_TShard {
-        std::mutex mu;
-        std::unordered_map<KVCP_TKey, std::atomic<uint32_t>, KVCP_TKeyHash> map;
-    };
-
-    class KVCP_ThresholdTable {
-        public:
-            static KVCP_ThresholdTable& Inst() {
-                static KVCP_ThresholdTable g;
-                return g;
-            }
+#include "cache/cache_entry_roles.h"
+#include "cache/cache_reservation_manager.h"
 
-            void Set(const void* db_ptr, uint32_t cf_id, uint32_t v) {
-                auto& sh = ShardRef(db_ptr, cf_id);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                KVCP_TKey k{db_ptr, cf_id};
-                auto it = sh.map.find(k);
-                if (it == sh.map.end()) {
-                auto& atom = sh.map[k];
-                atom.store(v, std::memory_order_relaxed);
-                } else {
-                it->second.store(v, std::memory_order_relaxed);
-                }
-            }
-
-            uint32_t Get(const void* db_ptr, uint32_t cf_id) {
-                auto& sh = ShardRef(db_ptr, cf_id);
-                std::lock_guard<std::mutex> lk(sh.mu);
-                KVCP_TKey k{db_ptr, cf_id};
-                auto it = sh.map.find(k);
-                if (it == sh.map.end()) return kKVCPDefaultThreshold;
-                return it->second.load(std::memory_order_relaxed);
-            }
-
-        private:
-            static constexpr size_t kShards = 64;
-            KVCP_ThresholdTable() : shards_(kShards) {}
-
-            size_t ShardIdx(const void* db_ptr, uint32_t cf_id) const {
-                uint64_t h = 1469598103934665603ull;
-                auto mix = [&](uint64_t x){ h ^= x; h *= 1099511628211ull; };
-                mix(reinterpret_cast<uint64_t>(db_ptr));
-                mix(static_cast<uint64_t>(cf_id));
-                return static_cast<size_t>(h & (kShards - 1));
-            }
-
-            KVCP_TShard& ShardRef(const void* db_ptr, uint32_t cf_id) {
-                return shards_[ShardIdx(db_ptr, cf_id)];
-            }
-
-            std::vector<KVCP_TShard> shards_;
-    };
-
-}
-
-void KVCP_SetThreshold(const void* db_ptr, uint32_t cf_id, uint32_t value) {
-  KVCP_ThresholdTable::Inst().Set(db_ptr, cf_id, value);
-}
-uint32_t KVCP_GetThreshold(const void* db_ptr, uint32_t cf_id) {
-  return KVCP_ThresholdTable::Inst().Get(db_ptr, cf_id);
-}
+namespace ROCKSDB_NAMESPACE {
 
-}
+KVCPState::KVCPState(const std::shared_ptr<Cache>& row_cache)
+    : row_cache_capacity_(row_cache->GetCapacity()),
+      table_(nullptr),
+      hybrid_admission_(false),
+      invalidation_threshold_(1),
+      cache_res_mgr_(std::make_shared<CacheReservationManager>(row_cache)) {}
+
+KVCPState::~KVCPState() {}
+
+void KVCPState::SetOptions(bool hybrid_admission,
+                           uint32_t invalidation_threshold) {
+  invalidation_threshold_.store(invalidation_threshold,
+                                std::memory_order_relaxed);
+  if (hybrid_admission && table_owner_ == nullptr) {
+    table_owner_.reset(new KVCPInvalidationTable(
+        KVCPInvalidationTable::SlotsForCapacity(row_cache_capacity_)));
+    table_.store(table_owner_.get(), std::memory_order_release);
+    if (cache_res_mgr_) {
+      // A full row cache with strict_capacity_limit only loses the charge
+      cache_res_mgr_
+          ->UpdateCacheReservation<CacheEntryRole::kRowCacheAdmission>(
+              table_owner_->ApproximateMemoryUsage())
+          .PermitUncheckedError();
+    }
+  }
+  hybrid_admission_.store(hybrid_admission, std::memory_order_release);
+}
+
+void KVCPState::ReleaseCacheReservation() { cache_res_mgr_.reset(); }
+
+size_t KVCPState::ApproximateMemoryUsage() const {
+  KVCPInvalidationTable* t = table();
+  return t == nullptr ? 0 : t->ApproximateMemoryUsage();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
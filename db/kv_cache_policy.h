@@ -0,0 +1,71 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "db/kv_cache_policy_table.h"
+#include "rocksdb/cache.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class CacheReservationManager;
+
+// Hybrid row cache admission state of one column family: the invalidation
+// table and the options controlling it (row_cache_hybrid_admission and
+// row_cache_invalidation_threshold).
+//
+// Owned through shared_ptr by the column family's TableCache and by every row
+// cache entry inserted while hybrid admission was on, because such entries
+// still update the table when evicted, possibly after the column family is
+// gone.
+class KVCPState {
+ public:
+  explicit KVCPState(const std::shared_ptr<Cache>& row_cache);
+  ~KVCPState();
+
+  KVCPState(const KVCPState&) = delete;
+  KVCPState& operator=(const KVCPState&) = delete;
+
+  // Applies new option values. The invalidation table is allocated and its
+  // memory charged to the row cache the first time hybrid admission is
+  // turned on; it is kept when turned off so that entries already inserted
+  // can still be accounted on eviction.
+  // REQUIRES: external synchronization between calls (e.g. DB mutex)
+  void SetOptions(bool hybrid_admission, uint32_t invalidation_threshold);
+
+  // Stops charging the table to the row cache. Called when the owning column
+  // family goes away, since the row cache itself may hold the last references
+  // to this object.
+  void ReleaseCacheReservation();
+
+  bool hybrid_admission() const {
+    return hybrid_admission_.load(std::memory_order_acquire);
+  }
+
+  uint32_t invalidation_threshold() const {
+    return invalidation_threshold_.load(std::memory_order_relaxed);
+  }
+
+  // Non-null whenever hybrid_admission() has returned true
+  KVCPInvalidationTable* table() const {
+    return table_.load(std::memory_order_acquire);
+  }
+
+  size_t ApproximateMemoryUsage() const;
+
+ private:
+  const size_t row_cache_capacity_;
+  std::unique_ptr<KVCPInvalidationTable> table_owner_;
+  std::atomic<KVCPInvalidationTable*> table_;
+  std::atomic<bool> hybrid_admission_;
+  std::atomic<uint32_t> invalidation_threshold_;
+  std::shared_ptr<CacheReservationManager> cache_res_mgr_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,296 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/kv_cache_policy_table.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "port/port.h"
+#include "util/hash.h"
+#include "util/math.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// Reserved fingerprint values
+constexpr uint64_t kEmpty = 0;
+constexpr uint64_t kTombstone = 1;
+
+// Counter word layout: bits 0..31 invalidation_count, bits 32..62
+// cached_key_count, bit 63 set while the slot is not (yet or any more) owned
+// by a key. A slot is only claimed or released by CAS on this bit, which
+// keeps counter updates from racing with slot reuse.
+constexpr uint64_t kDeadBit = uint64_t{1} << 63;
+constexpr uint64_t kCachedOne = uint64_t{1} << 32;
+constexpr uint64_t kInvMask = kCachedOne - 1;
+constexpr uint32_t kCachedMax = static_cast<uint32_t>((kDeadBit >> 32) - 1);
+
+// Bounded retries while another thread is claiming or releasing the slot we
+// want; giving up only costs tracking accuracy.
+constexpr int kMaxInsertAttempts = 4;
+
+inline uint32_t InvalidationCount(uint64_t c) {
+  return static_cast<uint32_t>(c & kInvMask);
+}
+
+inline uint32_t CachedKeyCount(uint64_t c) {
+  return static_cast<uint32_t>((c & ~kDeadBit) >> 32);
+}
+
+inline size_t RoundUpToPowerOfTwo(size_t n) {
+  assert(n > 1);
+  return size_t{1} << (FloorLog2(n - 1) + 1);
+}
+}  // namespace
+
+KVCPInvalidationTable::KVCPInvalidationTable(size_t num_slots)
+    : mask_(RoundUpToPowerOfTwo(
+                std::min(kMaxSlots, std::max(kMinSlots, num_slots))) -
+            1),
+      slots_(new Slot[mask_ + 1]) {
+  Clear();
+}
+
+size_t KVCPInvalidationTable::SlotsForCapacity(size_t cache_capacity,
+                                               size_t avg_entry_charge) {
+  size_t entries = cache_capacity / std::max(avg_entry_charge, size_t{1});
+  return std::min(kMaxSlots, std::max(kMinSlots, entries * 2));
+}
+
+uint64_t KVCPInvalidationTable::Fingerprint(const KVCPKeyCtx& k) {
+  uint64_t h = 1469598103934665603ull;
+  auto mix = [&](uint64_t x) {
+    h ^= x;
+    h *= 1099511628211ull;
+  };
+  mix(reinterpret_cast<uint64_t>(k.db_ptr));
+  mix(static_cast<uint64_t>(k.cf_id));
+  h ^= Hash64(k.user_key.data(), k.user_key.size(), 0x9ae16a3b2f90404fULL);
+  h *= 1099511628211ull;
+  return h <= kTombstone ? h + 2 : h;
+}
+
+KVCPInvalidationTable::Slot* KVCPInvalidationTable::Find(
+    uint64_t fp, size_t* probes) const {
+  size_t i = 0;
+  Slot* found = nullptr;
+  while (i < kMaxProbes) {
+    Slot& s = slots_[(fp + i) & mask_];
+    ++i;
+    uint64_t f = s.fingerprint.load(std::memory_order_acquire);
+    if (f == fp) {
+      if ((s.counters.load(std::memory_order_acquire) & kDeadBit) == 0) {
+        found = &s;
+        break;
+      }
+    } else if (f == kEmpty) {
+      // Probe chains never extend past an empty slot
+      break;
+    }
+  }
+  if (probes != nullptr) {
+    *probes = i;
+  }
+  return found;
+}
+
+size_t KVCPInvalidationTable::TEST_ProbeLength(uint64_t fp) const {
+  size_t probes = 0;
+  Find(fp, &probes);
+  return probes;
+}
+
+void KVCPInvalidationTable::Free(Slot* s) {
+  size_t index = static_cast<size_t>(s - slots_.get());
+  if (slots_[(index + 1) & mask_].fingerprint.load(
+          std::memory_order_acquire) != kEmpty) {
+    // Keys further on may have probed past this slot
+    s->fingerprint.store(kTombstone, std::memory_order_release);
+    return;
+  }
+  // The end of a probe chain. A key racing to claim the next slot after
+  // passing over this one while it was live is left untracked.
+  s->fingerprint.store(kEmpty, std::memory_order_release);
+  for (size_t i = 1; i <= mask_; ++i) {
+    uint64_t expected = kTombstone;
+    if (!slots_[(index - i) & mask_].fingerprint.compare_exchange_strong(
+            expected, kEmpty, std::memory_order_acq_rel)) {
+      break;
+    }
+  }
+}
+
+bool KVCPInvalidationTable::OnInvalidation(uint64_t fp) {
+  Slot* s = Find(fp);
+  if (s == nullptr) {
+    return false;
+  }
+  uint64_t c = s->counters.load(std::memory_order_relaxed);
+  for (;;) {
+    if (c & kDeadBit) {
+      // Evicted concurrently
+      return false;
+    }
+    if (InvalidationCount(c) == UINT32_MAX) {
+      return true;
+    }
+    if (s->counters.compare_exchange_weak(c, c + 1,
+                                          std::memory_order_acq_rel)) {
+      return true;
+    }
+  }
+}
+
+bool KVCPInvalidationTable::ShouldSkipInsert(uint64_t fp,
+                                             uint32_t threshold) const {
+  Slot* s = Find(fp);
+  if (s == nullptr) {
+    return false;
+  }
+  uint64_t c = s->counters.load(std::memory_order_acquire);
+  return (c & kDeadBit) == 0 && InvalidationCount(c) >= threshold;
+}
+
+void KVCPInvalidationTable::OnInsert(uint64_t fp) {
+  for (int attempt = 0; attempt < kMaxInsertAttempts; ++attempt) {
+    Slot* free_slot = nullptr;
+    Slot* history_slot = nullptr;
+    bool in_transition = false;
+    for (size_t i = 0; i < kMaxProbes; ++i) {
+      Slot& s = slots_[(fp + i) & mask_];
+      uint64_t f = s.fingerprint.load(std::memory_order_acquire);
+      if (f == fp) {
+        uint64_t c = s.counters.load(std::memory_order_acquire);
+        while ((c & kDeadBit) == 0) {
+          uint64_t next = CachedKeyCount(c) < kCachedMax ? c + kCachedOne : c;
+          if (s.counters.compare_exchange_weak(c, next,
+                                               std::memory_order_acq_rel)) {
+            return;
+          }
+        }
+        // Being claimed or released by another thread
+        in_transition = true;
+        break;
+      } else if (f == kTombstone) {
+        if (free_slot == nullptr) {
+          free_slot = &s;
+        }
+      } else if (f == kEmpty) {
+        if (free_slot == nullptr) {
+          free_slot = &s;
+        }
+        break;
+      } else if (history_slot == nullptr &&
+                 CachedKeyCount(s.counters.load(std::memory_order_relaxed)) ==
+                     0) {
+        history_slot = &s;
+      }
+    }
+    if (in_transition) {
+      continue;
+    }
+    if (free_slot == nullptr) {
+      if (history_slot != nullptr) {
+        // Reclaim a slot only kept for its invalidation count, then rescan
+        ReleaseIfUncached(history_slot);
+        continue;
+      }
+      // Probe window full; leave the key untracked
+      return;
+    }
+    uint64_t expected = free_slot->fingerprint.load(std::memory_order_relaxed);
+    if ((expected == kEmpty || expected == kTombstone) &&
+        free_slot->fingerprint.compare_exchange_strong(
+            expected, fp, std::memory_order_acq_rel)) {
+      // Counters of a free slot always hold kDeadBit, so this publishes the
+      // slot to other threads.
+      free_slot->counters.store(kCachedOne, std::memory_order_release);
+      return;
+    }
+    // Lost the race for the free slot; rescan, possibly finding fp there
+  }
+}
+
+void KVCPInvalidationTable::OnEvict(uint64_t fp) {
+  Slot* s = Find(fp);
+  if (s == nullptr) {
+    return;
+  }
+  uint64_t c = s->counters.load(std::memory_order_relaxed);
+  for (;;) {
+    if (c & kDeadBit) {
+      return;
+    }
+    if (CachedKeyCount(c) > 1) {
+      if (s->counters.compare_exchange_weak(c, c - kCachedOne,
+                                            std::memory_order_acq_rel)) {
+        return;
+      }
+    } else if (s->counters.compare_exchange_weak(c, kDeadBit,
+                                                 std::memory_order_acq_rel)) {
+      Free(s);
+      return;
+    }
+  }
+}
+
+void KVCPInvalidationTable::OnStaleErase(uint64_t fp) {
+  Slot* s = Find(fp);
+  if (s == nullptr) {
+    return;
+  }
+  uint64_t c = s->counters.load(std::memory_order_relaxed);
+  while ((c & kDeadBit) == 0 && CachedKeyCount(c) > 0) {
+    if (s->counters.compare_exchange_weak(c, c - kCachedOne,
+                                          std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+}
+
+void KVCPInvalidationTable::ReleaseIfUncached(Slot* s) {
+  uint64_t c = s->counters.load(std::memory_order_relaxed);
+  while ((c & kDeadBit) == 0 && CachedKeyCount(c) == 0) {
+    if (s->counters.compare_exchange_weak(c, kDeadBit,
+                                          std::memory_order_acq_rel)) {
+      Free(s);
+      return;
+    }
+  }
+}
+
+KVCPLookupState KVCPInvalidationTable::GetLookupState(uint64_t fp) const {
+  KVCPLookupState state;
+  Slot* s = Find(fp);
+  if (s != nullptr) {
+    uint64_t c = s->counters.load(std::memory_order_acquire);
+    if ((c & kDeadBit) == 0) {
+      state.invalidation_count = InvalidationCount(c);
+      state.cached_key_count = CachedKeyCount(c);
+    }
+  }
+  return state;
+}
+
+void KVCPInvalidationTable::GetLookupStates(const uint64_t* fps, size_t n,
+                                            KVCPLookupState* states) const {
+  for (size_t i = 0; i < n; ++i) {
+    PREFETCH(&slots_[fps[i] & mask_], 0 /* rw */, 1 /* locality */);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    states[i] = GetLookupState(fps[i]);
+  }
+}
+
+void KVCPInvalidationTable::Clear() {
+  for (size_t i = 0; i <= mask_; ++i) {
+    slots_[i].counters.store(kDeadBit, std::memory_order_relaxed);
+    slots_[i].fingerprint.store(kEmpty, std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,109 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rocksdb/kv_cache_policy.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Fixed-size table tracking, per hashed user key, how many row cache entries
+// currently hold the key (cached_key_count) and how many times a cached copy
+// of it was found invalidated (invalidation_count).
+//
+// Each slot is a 64-bit fingerprint of (db_ptr, cf_id, user_key) plus both
+// counters packed into a single 64-bit word. Keys are placed by linear
+// probing over at most kMaxProbes slots and every update is a CAS on the
+// counter word, so no operation takes a lock or allocates after
+// construction.
+//
+// A key whose cached entries were all erased as stale (OnStaleErase) keeps
+// its slot and invalidation count until the slot is needed by another key.
+//
+// A freed slot becomes a tombstone, which probes for other keys step over,
+// unless the next slot is empty: then no probe sequence continues past it,
+// and the slot and the tombstones right before it become empty again. This
+// keeps lookups short however many keys come and go.
+//
+// The table only feeds an admission heuristic, so it trades exactness for
+// speed: keys with equal fingerprints share counters, a key that finds no
+// free slot within its probe window is not tracked, and rare races between
+// concurrent first inserts of the same key may split its counters.
+class KVCPInvalidationTable {
+ public:
+  static constexpr size_t kMaxProbes = 16;
+  static constexpr size_t kMinSlots = size_t{1} << 10;
+  static constexpr size_t kMaxSlots = size_t{1} << 30;
+  // Assumed average row cache charge per entry when sizing from capacity.
+  static constexpr size_t kDefaultAvgEntryCharge = 256;
+
+  // num_slots is rounded up to a power of two within [kMinSlots, kMaxSlots].
+  explicit KVCPInvalidationTable(size_t num_slots);
+
+  KVCPInvalidationTable(const KVCPInvalidationTable&) = delete;
+  KVCPInvalidationTable& operator=(const KVCPInvalidationTable&) = delete;
+
+  // Number of slots for a row cache of cache_capacity bytes, leaving about
+  // half of the slots free at full cache occupancy.
+  static size_t SlotsForCapacity(
+      size_t cache_capacity, size_t avg_entry_charge = kDefaultAvgEntryCharge);
+
+  // Never returns one of the reserved empty/tombstone values.
+  static uint64_t Fingerprint(const KVCPKeyCtx& k);
+
+  // Bumps invalidation_count if the key is tracked; returns whether it was.
+  bool OnInvalidation(uint64_t fp);
+  // True iff the key is tracked and invalidation_count >= threshold.
+  bool ShouldSkipInsert(uint64_t fp, uint32_t threshold) const;
+  // Starts tracking the key if needed and bumps cached_key_count.
+  void OnInsert(uint64_t fp);
+  // Drops cached_key_count by one, forgetting the key when it reaches zero.
+  void OnEvict(uint64_t fp);
+  // Like OnEvict, for an entry erased because its key was overwritten. The
+  // key stays tracked with cached_key_count zero so that its invalidation
+  // count survives the erase; such slots are reclaimed when OnInsert finds
+  // no free slot for another key.
+  void OnStaleErase(uint64_t fp);
+  // Both counters from a single probe; zeros if the key is not tracked.
+  KVCPLookupState GetLookupState(uint64_t fp) const;
+  // GetLookupState for n keys at once, e.g. those of a MultiGet batch. The
+  // home slots of all keys are prefetched before any is probed, so that their
+  // cache misses overlap.
+  void GetLookupStates(const uint64_t* fps, size_t n,
+                       KVCPLookupState* states) const;
+
+  // Not atomic with respect to concurrent updates.
+  void Clear();
+
+  size_t NumSlots() const { return mask_ + 1; }
+  size_t ApproximateMemoryUsage() const { return NumSlots() * sizeof(Slot); }
+
+  // Number of slots a lookup of fp examines.
+  size_t TEST_ProbeLength(uint64_t fp) const;
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> fingerprint;
+    std::atomic<uint64_t> counters;
+  };
+
+  // Returns the live slot holding fp, or nullptr. Sets *probes to the number
+  // of slots examined, if not nullptr.
+  Slot* Find(uint64_t fp, size_t* probes = nullptr) const;
+  // Frees the slot if it is live with cached_key_count zero.
+  void ReleaseIfUncached(Slot* s);
+  // Clears the fingerprint of s, whose counters the caller just marked dead.
+  void Free(Slot* s);
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,251 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/kv_cache_policy_table.h"
+
+#include <string>
+#include <vector>
+
+#include "port/port.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class KVCPInvalidationTableTest : public testing::Test {
+ public:
+  static uint64_t FP(const std::string& key, uint32_t cf_id = 0) {
+    return KVCPInvalidationTable::Fingerprint(
+        KVCPKeyCtx{/*db_ptr=*/nullptr, cf_id, key});
+  }
+};
+
+TEST_F(KVCPInvalidationTableTest, Sizing) {
+  KVCPInvalidationTable small(1);
+  ASSERT_EQ(KVCPInvalidationTable::kMinSlots, small.NumSlots());
+
+  KVCPInvalidationTable odd(3000);
+  ASSERT_EQ(size_t{4096}, odd.NumSlots());
+
+  ASSERT_EQ(KVCPInvalidationTable::kMinSlots,
+            KVCPInvalidationTable::SlotsForCapacity(0));
+  ASSERT_EQ(size_t{8} << 20,
+            KVCPInvalidationTable::SlotsForCapacity(size_t{1} << 30, 256));
+}
+
+TEST_F(KVCPInvalidationTableTest, Counters) {
+  KVCPInvalidationTable table(1024);
+  uint64_t a = FP("a");
+
+  // Untracked keys
+  ASSERT_FALSE(table.OnInvalidation(a));
+  ASSERT_FALSE(table.ShouldSkipInsert(a, 0));
+  KVCPLookupState state = table.GetLookupState(a);
+  ASSERT_EQ(0U, state.invalidation_count);
+  ASSERT_EQ(0U, state.cached_key_count);
+
+  table.OnInsert(a);
+  table.OnInsert(a);
+  ASSERT_TRUE(table.OnInvalidation(a));
+  ASSERT_TRUE(table.OnInvalidation(a));
+  state = table.GetLookupState(a);
+  ASSERT_EQ(2U, state.invalidation_count);
+  ASSERT_EQ(2U, state.cached_key_count);
+  ASSERT_TRUE(table.ShouldSkipInsert(a, 2));
+  ASSERT_FALSE(table.ShouldSkipInsert(a, 3));
+
+  // Other keys and column families are independent
+  ASSERT_EQ(0U, table.GetLookupState(FP("b")).cached_key_count);
+  ASSERT_EQ(0U, table.GetLookupState(FP("a", 1)).cached_key_count);
+
+  table.OnEvict(a);
+  state = table.GetLookupState(a);
+  ASSERT_EQ(2U, state.invalidation_count);
+  ASSERT_EQ(1U, state.cached_key_count);
+
+  // Last reference forgets the key, including its invalidation count
+  table.OnEvict(a);
+  state = table.GetLookupState(a);
+  ASSERT_EQ(0U, state.invalidation_count);
+  ASSERT_EQ(0U, state.cached_key_count);
+  table.OnEvict(a);
+
+  table.OnInsert(a);
+  ASSERT_EQ(0U, table.GetLookupState(a).invalidation_count);
+  ASSERT_EQ(1U, table.GetLookupState(a).cached_key_count);
+
+  table.Clear();
+  ASSERT_EQ(0U, table.GetLookupState(a).cached_key_count);
+}
+
+TEST_F(KVCPInvalidationTableTest, SlotReuse) {
+  KVCPInvalidationTable table(1024);
+  // Far more distinct keys than slots, never live at the same time
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t fp = FP("key" + std::to_string(i));
+    table.OnInsert(fp);
+    ASSERT_EQ(1U, table.GetLookupState(fp).cached_key_count);
+    table.OnEvict(fp);
+    ASSERT_EQ(0U, table.GetLookupState(fp).cached_key_count);
+  }
+  uint64_t fp = FP("last");
+  table.OnInsert(fp);
+  ASSERT_EQ(1U, table.GetLookupState(fp).cached_key_count);
+}
+
+TEST_F(KVCPInvalidationTableTest, ChurnKeepsProbesShort) {
+  KVCPInvalidationTable table(1024);
+  // A quarter of the slots live at any time, turning over many times
+  const int kLive = 256;
+  for (int i = 0; i < 100000; ++i) {
+    table.OnInsert(FP("key" + std::to_string(i)));
+    if (i >= kLive) {
+      table.OnEvict(FP("key" + std::to_string(i - kLive)));
+    }
+  }
+  // Misses stop at an empty slot instead of walking tombstones up to
+  // kMaxProbes
+  size_t total_probes = 0;
+  const int kMisses = 1000;
+  for (int i = 0; i < kMisses; ++i) {
+    uint64_t fp = FP("absent" + std::to_string(i));
+    ASSERT_EQ(0U, table.GetLookupState(fp).cached_key_count);
+    total_probes += table.TEST_ProbeLength(fp);
+  }
+  ASSERT_LT(total_probes, 3U * kMisses);
+
+  // With every key gone, every slot is empty again
+  for (int i = 100000 - kLive; i < 100000; ++i) {
+    table.OnEvict(FP("key" + std::to_string(i)));
+  }
+  for (int i = 0; i < kMisses; ++i) {
+    ASSERT_EQ(1U, table.TEST_ProbeLength(FP("absent" + std::to_string(i))));
+  }
+}
+
+TEST_F(KVCPInvalidationTableTest, StaleErase) {
+  KVCPInvalidationTable table(1024);
+  uint64_t a = FP("a");
+  table.OnStaleErase(a);
+  ASSERT_EQ(0U, table.GetLookupState(a).invalidation_count);
+
+  table.OnInsert(a);
+  ASSERT_TRUE(table.OnInvalidation(a));
+  table.OnStaleErase(a);
+  // Invalidation count kept without cached entries
+  KVCPLookupState state = table.GetLookupState(a);
+  ASSERT_EQ(1U, state.invalidation_count);
+  ASSERT_EQ(0U, state.cached_key_count);
+  table.OnStaleErase(a);
+  ASSERT_EQ(0U, table.GetLookupState(a).cached_key_count);
+
+  table.OnInsert(a);
+  ASSERT_TRUE(table.OnInvalidation(a));
+  state = table.GetLookupState(a);
+  ASSERT_EQ(2U, state.invalidation_count);
+  ASSERT_EQ(1U, state.cached_key_count);
+  table.OnEvict(a);
+  ASSERT_EQ(0U, table.GetLookupState(a).invalidation_count);
+}
+
+TEST_F(KVCPInvalidationTableTest, StaleEraseSlotReuse) {
+  KVCPInvalidationTable table(1024);
+  // Fill the table with keys only kept for their invalidation counts
+  for (int i = 0; i < 4096; ++i) {
+    uint64_t fp = FP("old" + std::to_string(i));
+    table.OnInsert(fp);
+    table.OnInvalidation(fp);
+    table.OnStaleErase(fp);
+  }
+  // They give way to keys with cached entries
+  size_t tracked = 0;
+  for (int i = 0; i < 512; ++i) {
+    uint64_t fp = FP("new" + std::to_string(i));
+    table.OnInsert(fp);
+    if (table.GetLookupState(fp).cached_key_count == 1) {
+      ++tracked;
+    }
+  }
+  ASSERT_EQ(512U, tracked);
+}
+
+TEST_F(KVCPInvalidationTableTest, Overfull) {
+  KVCPInvalidationTable table(1024);
+  size_t tracked = 0;
+  for (int i = 0; i < 4096; ++i) {
+    uint64_t fp = FP("key" + std::to_string(i));
+    table.OnInsert(fp);
+    if (table.GetLookupState(fp).cached_key_count == 1) {
+      ++tracked;
+    }
+  }
+  // Untracked keys are dropped rather than growing the table
+  ASSERT_LE(tracked, table.NumSlots());
+  ASSERT_GT(tracked, table.NumSlots() / 2);
+}
+
+TEST_F(KVCPInvalidationTableTest, BatchedLookup) {
+  KVCPInvalidationTable table(1024);
+  std::vector<uint64_t> fps;
+  for (int i = 0; i < 32; ++i) {
+    fps.push_back(FP("key" + std::to_string(i)));
+    // Key i is cached i % 3 times and invalidated once if cached
+    for (int j = 0; j < i % 3; ++j) {
+      table.OnInsert(fps.back());
+    }
+    table.OnInvalidation(fps.back());
+  }
+
+  std::vector<KVCPLookupState> states(fps.size());
+  table.GetLookupStates(fps.data(), fps.size(), states.data());
+  for (size_t i = 0; i < fps.size(); ++i) {
+    KVCPLookupState expected = table.GetLookupState(fps[i]);
+    ASSERT_EQ(i % 3, states[i].cached_key_count);
+    ASSERT_EQ(expected.cached_key_count, states[i].cached_key_count);
+    ASSERT_EQ(expected.invalidation_count, states[i].invalidation_count);
+  }
+  table.GetLookupStates(fps.data(), 0, nullptr);
+}
+
+TEST_F(KVCPInvalidationTableTest, ConcurrentUpdates) {
+  KVCPInvalidationTable table(1 << 16);
+  constexpr int kThreads = 8;
+  constexpr int kKeys = 1000;
+  constexpr int kRounds = 50;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (int r = 0; r < kRounds; ++r) {
+        for (int i = 0; i < kKeys; ++i) {
+          uint64_t fp = FP("key" + std::to_string(i));
+          table.OnInsert(fp);
+          table.OnInvalidation(fp);
+          table.OnEvict(fp);
+        }
+      }
+      // Leave one reference per thread behind
+      for (int i = 0; i < kKeys; ++i) {
+        table.OnInsert(FP("key" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  size_t total_cached = 0;
+  for (int i = 0; i < kKeys; ++i) {
+    total_cached +=
+        table.GetLookupState(FP("key" + std::to_string(i))).cached_key_count;
+  }
+  // Races on slot reuse may lose or misattribute a few references
+  ASSERT_LT(total_cached, size_t{kThreads * kKeys} * 11 / 10);
+  ASSERT_GT(total_cached, size_t{kThreads * kKeys} * 9 / 10);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
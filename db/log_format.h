@@ -12,7 +12,13 @@
 
 #pragma once
 
-#include "rocksdb/rocksdb_namespace.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+#include "util/coding.h"
 
 namespace ROCKSDB_NAMESPACE {
 namespace log {
@@ -35,8 +41,11 @@ enum RecordType {
 
   // Compression Type
   kSetCompressionType = 9,
+
+  // WAL shard set, see WalShardRecord
+  kWalShardType = 10,
 };
-static const int kMaxRecordType = kSetCompressionType;
+static const int kMaxRecordType = kWalShardType;
 
 static const unsigned int kBlockSize = 32768;
 
@@ -47,5 +56,55 @@ static const int kHeaderSize = 4 + 2 + 1;
 // log number (4 bytes).
 static const int kRecyclableHeaderSize = 4 + 2 + 1 + 4;
 
+// Leads each WAL of a set written in parallel when DBOptions::wal_shards > 1,
+// after the compression type record if any. Lists the log numbers of the
+// set, the first being the primary WAL, and which of them the file is.
+// Write groups are appended to the shards in turn, starting with the
+// primary, so that recovery replays them in that order.
+class WalShardRecord {
+ public:
+  WalShardRecord() = default;
+  WalShardRecord(uint32_t shard, std::vector<uint64_t> log_numbers)
+      : shard_(shard), log_numbers_(std::move(log_numbers)) {}
+
+  uint32_t GetShard() const { return shard_; }
+  const std::vector<uint64_t>& GetLogNumbers() const { return log_numbers_; }
+
+  void EncodeTo(std::string* dst) const {
+    PutVarint32(dst, shard_);
+    PutVarint32(dst, static_cast<uint32_t>(log_numbers_.size()));
+    for (uint64_t log_number : log_numbers_) {
+      PutVarint64(dst, log_number);
+    }
+  }
+
+  Status DecodeFrom(Slice* src) {
+    constexpr char class_name[] = "WalShardRecord";
+
+    uint32_t shard = 0;
+    uint32_t count = 0;
+    if (!GetVarint32(src, &shard) || !GetVarint32(src, &count)) {
+      return Status::Corruption(class_name, "Error decoding WAL shard set");
+    }
+    if (shard >= count) {
+      return Status::Corruption(class_name, "WAL shard out of range");
+    }
+    std::vector<uint64_t> log_numbers(count);
+    for (uint64_t& log_number : log_numbers) {
+      if (!GetVarint64(src, &log_number)) {
+        return Status::Corruption(class_name,
+                                  "Error decoding WAL shard log number");
+      }
+    }
+    shard_ = shard;
+    log_numbers_ = std::move(log_numbers);
+    return Status::OK();
+  }
+
+ private:
+  uint32_t shard_ = 0;
+  std::vector<uint64_t> log_numbers_;
+};
+
 }  // namespace log
 }  // namespace ROCKSDB_NAMESPACE
@@ -248,6 +248,13 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         break;
       }
 
+      case kWalShardType:
+        prospective_record_offset = physical_record_offset;
+        scratch->clear();
+        last_record_offset_ = prospective_record_offset;
+        InitWalShard(fragment);
+        break;
+
       default: {
         char buf[40];
         snprintf(buf, sizeof(buf), "unknown record type %u", record_type);
@@ -457,7 +464,8 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result, size_t* drop_size) {
 
     buffer_.remove_prefix(header_size + length);
 
-    if (!uncompress_ || type == kSetCompressionType) {
+    if (!uncompress_ || type == kSetCompressionType ||
+        type == kWalShardType) {
       *result = Slice(header + header_size, length);
       return type;
     } else {
@@ -496,6 +504,22 @@ void Reader::InitCompression(const CompressionTypeRecord& compression_record) {
   assert(uncompressed_buffer_);
 }
 
+void Reader::InitWalShard(Slice fragment) {
+  if (wal_shard_record_ != nullptr) {
+    ReportCorruption(fragment.size(), "read multiple WalShard records");
+  }
+  if (first_record_read_) {
+    ReportCorruption(fragment.size(), "WalShard not the first record");
+  }
+  std::unique_ptr<WalShardRecord> record(new WalShardRecord());
+  Status s = record->DecodeFrom(&fragment);
+  if (!s.ok()) {
+    ReportCorruption(fragment.size(), "could not decode WalShard record");
+  } else {
+    wal_shard_record_ = std::move(record);
+  }
+}
+
 bool FragmentBufferedReader::ReadRecord(Slice* record, std::string* scratch,
                                         WALRecoveryMode /*unused*/) {
   assert(record != nullptr);
@@ -611,6 +635,14 @@ bool FragmentBufferedReader::ReadRecord(Slice* record, std::string* scratch,
         break;
       }
 
+      case kWalShardType:
+        fragments_.clear();
+        prospective_record_offset = physical_record_offset;
+        last_record_offset_ = prospective_record_offset;
+        in_fragmented_record_ = false;
+        InitWalShard(fragment);
+        break;
+
       default: {
         char buf[40];
         snprintf(buf, sizeof(buf), "unknown record type %u",
@@ -744,7 +776,7 @@ bool FragmentBufferedReader::TryReadFragment(
 
   buffer_.remove_prefix(header_size + length);
 
-  if (!uncompress_ || type == kSetCompressionType) {
+  if (!uncompress_ || type == kSetCompressionType || type == kWalShardType) {
     *fragment = Slice(header + header_size, length);
     *fragment_type_or_err = type;
     return true;
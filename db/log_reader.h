@@ -99,6 +99,13 @@ class Reader {
 
   uint64_t GetLogNumber() const { return log_number_; }
 
+  // The shard set the file belongs to, if it is one of a set of WALs
+  // written in parallel, once the first record has been looked for.
+  // Otherwise nullptr.
+  const WalShardRecord* GetWalShardRecord() const {
+    return wal_shard_record_.get();
+  }
+
   size_t GetReadOffset() const {
     return static_cast<size_t>(end_of_buffer_offset_);
   }
@@ -141,6 +148,7 @@ class Reader {
   std::unique_ptr<char[]> uncompressed_buffer_;
   // Reusable uncompressed record
   std::string uncompressed_record_;
+  std::unique_ptr<WalShardRecord> wal_shard_record_;
 
   // Extend record types with the following special values
   enum {
@@ -174,6 +182,7 @@ class Reader {
   void ReportDrop(size_t bytes, const Status& reason);
 
   void InitCompression(const CompressionTypeRecord& compression_record);
+  void InitWalShard(Slice fragment);
 };
 
 class FragmentBufferedReader : public Reader {
@@ -969,6 +969,27 @@ TEST_P(CompressionLogTest, Fragmentation) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_P(CompressionLogTest, WalShardRecord) {
+  CompressionType compression_type = std::get<2>(GetParam());
+  if (!StreamingCompressionTypeSupported(compression_type)) {
+    ROCKSDB_GTEST_SKIP("Test requires support for compression type");
+    return;
+  }
+  ASSERT_OK(SetupTestEnv());
+  ASSERT_OK(writer_->AddWalShardRecord(WalShardRecord(1, {7, 123, 9})));
+  Write("foo");
+  Write("bar");
+  ASSERT_EQ(nullptr, reader_->GetWalShardRecord());
+  ASSERT_EQ("foo", Read());
+  const WalShardRecord* shard_record = reader_->GetWalShardRecord();
+  ASSERT_NE(nullptr, shard_record);
+  ASSERT_EQ(1U, shard_record->GetShard());
+  ASSERT_EQ((std::vector<uint64_t>{7, 123, 9}), shard_record->GetLogNumbers());
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
 INSTANTIATE_TEST_CASE_P(
     Compression, CompressionLogTest,
     ::testing::Combine(::testing::Values(0, 1), ::testing::Bool(),
@@ -11,9 +11,13 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "file/writable_file_writer.h"
 #include "rocksdb/env.h"
 #include "util/coding.h"
+#include "util/autovector.h"
 #include "util/crc32c.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -76,22 +80,9 @@ IOStatus Writer::AddRecord(const Slice& slice,
     compress_start = true;
   }
   do {
-    const int64_t leftover = kBlockSize - block_offset_;
-    assert(leftover >= 0);
-    if (leftover < header_size) {
-      // Switch to a new block
-      if (leftover > 0) {
-        // Fill the trailer (literal below relies on kHeaderSize and
-        // kRecyclableHeaderSize being <= 11)
-        assert(header_size <= 11);
-        s = dest_->Append(Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
-                                static_cast<size_t>(leftover)),
-                          0 /* crc32c_checksum */, rate_limiter_priority);
-        if (!s.ok()) {
-          break;
-        }
-      }
-      block_offset_ = 0;
+    s = MaybeSwitchBlock(header_size, rate_limiter_priority);
+    if (!s.ok()) {
+      break;
     }
 
     // Invariant: we never leave < header_size bytes in a block.
@@ -151,6 +142,84 @@ IOStatus Writer::AddRecord(const Slice& slice,
   return s;
 }
 
+IOStatus Writer::AddRecord(const SliceParts& parts,
+                           Env::IOPriority rate_limiter_priority) {
+  if (parts.num_parts == 1) {
+    return AddRecord(parts.parts[0], rate_limiter_priority);
+  }
+  if (compress_) {
+    // The streaming compression takes one buffer
+    std::string buf;
+    return AddRecord(Slice(parts, &buf), rate_limiter_priority);
+  }
+
+  size_t left = 0;
+  for (int i = 0; i < parts.num_parts; ++i) {
+    left += parts.parts[i].size();
+  }
+
+  const int header_size =
+      recycle_log_files_ ? kRecyclableHeaderSize : kHeaderSize;
+
+  // Fragment the record as AddRecord(const Slice&) does, each fragment
+  // taking the pieces of the parts it spans
+  IOStatus s;
+  bool begin = true;
+  int part = 0;
+  size_t part_offset = 0;
+  std::vector<Slice> pieces;
+  do {
+    s = MaybeSwitchBlock(header_size, rate_limiter_priority);
+    if (!s.ok()) {
+      break;
+    }
+
+    const size_t avail = kBlockSize - block_offset_ - header_size;
+    const size_t fragment_length = (left < avail) ? left : avail;
+
+    pieces.clear();
+    for (size_t needed = fragment_length; needed > 0;) {
+      assert(part < parts.num_parts);
+      const Slice& p = parts.parts[part];
+      const size_t n = std::min(needed, p.size() - part_offset);
+      if (n > 0) {
+        pieces.emplace_back(p.data() + part_offset, n);
+      }
+      needed -= n;
+      part_offset += n;
+      if (part_offset == p.size()) {
+        part++;
+        part_offset = 0;
+      }
+    }
+
+    RecordType type;
+    const bool end = (left == fragment_length);
+    if (begin && end) {
+      type = recycle_log_files_ ? kRecyclableFullType : kFullType;
+    } else if (begin) {
+      type = recycle_log_files_ ? kRecyclableFirstType : kFirstType;
+    } else if (end) {
+      type = recycle_log_files_ ? kRecyclableLastType : kLastType;
+    } else {
+      type = recycle_log_files_ ? kRecyclableMiddleType : kMiddleType;
+    }
+
+    s = EmitPhysicalRecord(type, pieces.data(), pieces.size(), fragment_length,
+                           rate_limiter_priority);
+    left -= fragment_length;
+    begin = false;
+  } while (s.ok() && left > 0);
+
+  if (s.ok()) {
+    if (!manual_flush_) {
+      s = dest_->Flush(rate_limiter_priority);
+    }
+  }
+
+  return s;
+}
+
 IOStatus Writer::AddCompressionTypeRecord() {
   // Should be the first record
   assert(block_offset_ == 0);
@@ -188,10 +257,52 @@ IOStatus Writer::AddCompressionTypeRecord() {
   return s;
 }
 
+IOStatus Writer::AddWalShardRecord(const WalShardRecord& record) {
+  std::string encode;
+  record.EncodeTo(&encode);
+  // Small enough for the first block
+  assert(block_offset_ + kHeaderSize + encode.size() <= kBlockSize);
+  IOStatus s = EmitPhysicalRecord(kWalShardType, encode.data(), encode.size());
+  if (s.ok() && !manual_flush_) {
+    s = dest_->Flush();
+  }
+  return s;
+}
+
 bool Writer::TEST_BufferIsEmpty() { return dest_->TEST_BufferIsEmpty(); }
 
+IOStatus Writer::MaybeSwitchBlock(int header_size,
+                                  Env::IOPriority rate_limiter_priority) {
+  const int64_t leftover = kBlockSize - block_offset_;
+  assert(leftover >= 0);
+  if (leftover < header_size) {
+    // Switch to a new block
+    if (leftover > 0) {
+      // Fill the trailer (literal below relies on kHeaderSize and
+      // kRecyclableHeaderSize being <= 11)
+      assert(header_size <= 11);
+      IOStatus s = dest_->Append(
+          Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+                static_cast<size_t>(leftover)),
+          0 /* crc32c_checksum */, rate_limiter_priority);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    block_offset_ = 0;
+  }
+  return IOStatus::OK();
+}
+
 IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n,
                                     Env::IOPriority rate_limiter_priority) {
+  Slice piece(ptr, n);
+  return EmitPhysicalRecord(t, &piece, 1, n, rate_limiter_priority);
+}
+
+IOStatus Writer::EmitPhysicalRecord(RecordType t, const Slice* pieces,
+                                    size_t num_pieces, size_t n,
+                                    Env::IOPriority rate_limiter_priority) {
   assert(n <= 0xffff);  // Must fit in two bytes
 
   size_t header_size;
@@ -203,7 +314,8 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n,
   buf[6] = static_cast<char>(t);
 
   uint32_t crc = type_crc_[t];
-  if (t < kRecyclableFullType || t == kSetCompressionType) {
+  if (t < kRecyclableFullType || t == kSetCompressionType ||
+      t == kWalShardType) {
     // Legacy record format
     assert(block_offset_ + kHeaderSize + n <= kBlockSize);
     header_size = kHeaderSize;
@@ -222,8 +334,11 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n,
   }
 
   // Compute the crc of the record type and the payload.
-  uint32_t payload_crc = crc32c::Value(ptr, n);
-  crc = crc32c::Crc32cCombine(crc, payload_crc, n);
+  autovector<uint32_t> piece_crcs;
+  for (size_t i = 0; i < num_pieces; ++i) {
+    piece_crcs.push_back(crc32c::Value(pieces[i].data(), pieces[i].size()));
+    crc = crc32c::Crc32cCombine(crc, piece_crcs[i], pieces[i].size());
+  }
   crc = crc32c::Mask(crc);  // Adjust for storage
   TEST_SYNC_POINT_CALLBACK("LogWriter::EmitPhysicalRecord:BeforeEncodeChecksum",
                            &crc);
@@ -232,8 +347,8 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n,
   // Write the header and the payload
   IOStatus s = dest_->Append(Slice(buf, header_size), 0 /* crc32c_checksum */,
                              rate_limiter_priority);
-  if (s.ok()) {
-    s = dest_->Append(Slice(ptr, n), payload_crc, rate_limiter_priority);
+  for (size_t i = 0; s.ok() && i < num_pieces; ++i) {
+    s = dest_->Append(pieces[i], piece_crcs[i], rate_limiter_priority);
   }
   block_offset_ += header_size + n;
   return s;
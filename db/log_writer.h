@@ -85,7 +85,13 @@ class Writer {
 
   IOStatus AddRecord(const Slice& slice,
                      Env::IOPriority rate_limiter_priority = Env::IO_TOTAL);
+  // Adds the concatenation of `parts` as one record, without copying them
+  // into one buffer first unless the log is compressed
+  IOStatus AddRecord(const SliceParts& parts,
+                     Env::IOPriority rate_limiter_priority = Env::IO_TOTAL);
   IOStatus AddCompressionTypeRecord();
+  // Should follow the compression type record, if any
+  IOStatus AddWalShardRecord(const WalShardRecord& record);
 
   WritableFileWriter* file() { return dest_.get(); }
   const WritableFileWriter* file() const { return dest_.get(); }
@@ -112,6 +118,15 @@ class Writer {
   IOStatus EmitPhysicalRecord(
       RecordType type, const char* ptr, size_t length,
       Env::IOPriority rate_limiter_priority = Env::IO_TOTAL);
+  // Emits a record of the `length` bytes of `num_pieces` pieces
+  IOStatus EmitPhysicalRecord(
+      RecordType type, const Slice* pieces, size_t num_pieces, size_t length,
+      Env::IOPriority rate_limiter_priority = Env::IO_TOTAL);
+
+  // Pads the rest of the block and starts a new one if the rest cannot hold
+  // a header
+  IOStatus MaybeSwitchBlock(int header_size,
+                            Env::IOPriority rate_limiter_priority);
 
   // If true, it does not flush after each write. Instead it relies on the upper
   // layer to manually does the flush by calling ::WriteBuffer()
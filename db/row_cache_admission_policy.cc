@@ -0,0 +1,91 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "rocksdb/row_cache_admission_policy.h"
+
+#include "util/frequency_sketch.h"
+#include "util/hash.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+class AlwaysAdmitPolicy : public RowCacheAdmissionPolicy {
+ public:
+  const char* Name() const override { return "AlwaysAdmit"; }
+
+  RowCacheAdmissionDecision Admit(
+      const RowCacheAdmissionContext& /*context*/) override {
+    return RowCacheAdmissionDecision::kAdmit;
+  }
+};
+
+bool ExceedsInvalidationThreshold(const RowCacheAdmissionContext& context) {
+  // Tracked keys have cached entries or kept their invalidation count after
+  // their stale entries were erased
+  bool tracked = context.kvcp.cached_key_count > 0 ||
+                 context.kvcp.invalidation_count > 0;
+  return context.hybrid_admission && context.read_from_storage && tracked &&
+         context.kvcp.invalidation_count >= context.invalidation_threshold;
+}
+
+class InvalidationThresholdPolicy : public RowCacheAdmissionPolicy {
+ public:
+  const char* Name() const override { return "InvalidationThreshold"; }
+
+  RowCacheAdmissionDecision Admit(
+      const RowCacheAdmissionContext& context) override {
+    return ExceedsInvalidationThreshold(context)
+               ? RowCacheAdmissionDecision::kRejectForMigration
+               : RowCacheAdmissionDecision::kAdmit;
+  }
+};
+
+class TinyLFUPolicy : public RowCacheAdmissionPolicy {
+ public:
+  TinyLFUPolicy(size_t expected_keys, uint32_t min_frequency)
+      : sketch_(expected_keys), min_frequency_(min_frequency) {}
+
+  const char* Name() const override { return "TinyLFU"; }
+
+  void OnHit(const RowCacheAdmissionContext& context) override {
+    sketch_.Increment(GetSliceHash64(context.user_key));
+  }
+
+  RowCacheAdmissionDecision Admit(
+      const RowCacheAdmissionContext& context) override {
+    if (ExceedsInvalidationThreshold(context)) {
+      return RowCacheAdmissionDecision::kRejectForMigration;
+    }
+    uint64_t hash = GetSliceHash64(context.user_key);
+    sketch_.Increment(hash);
+    return sketch_.Estimate(hash) >= min_frequency_
+               ? RowCacheAdmissionDecision::kAdmit
+               : RowCacheAdmissionDecision::kReject;
+  }
+
+ private:
+  FrequencySketch sketch_;
+  const uint32_t min_frequency_;
+};
+
+}  // namespace
+
+std::shared_ptr<RowCacheAdmissionPolicy>
+NewAlwaysAdmitRowCacheAdmissionPolicy() {
+  return std::make_shared<AlwaysAdmitPolicy>();
+}
+
+std::shared_ptr<RowCacheAdmissionPolicy>
+NewInvalidationThresholdRowCacheAdmissionPolicy() {
+  return std::make_shared<InvalidationThresholdPolicy>();
+}
+
+std::shared_ptr<RowCacheAdmissionPolicy> NewTinyLFURowCacheAdmissionPolicy(
+    size_t expected_keys, uint32_t min_frequency) {
+  return std::make_shared<TinyLFUPolicy>(expected_keys, min_frequency);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,96 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "rocksdb/row_cache_admission_policy.h"
+
+#include <string>
+
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class RowCacheAdmissionPolicyTest : public testing::Test {
+ public:
+  static RowCacheAdmissionContext HybridContext(const Slice& user_key,
+                                                uint32_t invalidation_count,
+                                                uint32_t cached_key_count,
+                                                uint32_t threshold,
+                                                bool read_from_storage) {
+    RowCacheAdmissionContext context;
+    context.user_key = user_key;
+    context.read_from_storage = read_from_storage;
+    context.hybrid_admission = true;
+    context.kvcp.invalidation_count = invalidation_count;
+    context.kvcp.cached_key_count = cached_key_count;
+    context.invalidation_threshold = threshold;
+    return context;
+  }
+};
+
+TEST_F(RowCacheAdmissionPolicyTest, AlwaysAdmit) {
+  auto policy = NewAlwaysAdmitRowCacheAdmissionPolicy();
+  ASSERT_STREQ("AlwaysAdmit", policy->Name());
+  ASSERT_EQ(RowCacheAdmissionDecision::kAdmit,
+            policy->Admit(HybridContext("k", 10, 1, 1, true)));
+}
+
+TEST_F(RowCacheAdmissionPolicyTest, InvalidationThreshold) {
+  auto policy = NewInvalidationThresholdRowCacheAdmissionPolicy();
+  ASSERT_STREQ("InvalidationThreshold", policy->Name());
+
+  RowCacheAdmissionContext plain;
+  plain.user_key = "k";
+  plain.read_from_storage = true;
+  ASSERT_EQ(RowCacheAdmissionDecision::kAdmit, policy->Admit(plain));
+
+  ASSERT_EQ(RowCacheAdmissionDecision::kRejectForMigration,
+            policy->Admit(HybridContext("k", 2, 1, 2, true)));
+  // Below threshold
+  ASSERT_EQ(RowCacheAdmissionDecision::kAdmit,
+            policy->Admit(HybridContext("k", 1, 1, 2, true)));
+  // Served from the block cache
+  ASSERT_EQ(RowCacheAdmissionDecision::kAdmit,
+            policy->Admit(HybridContext("k", 2, 1, 2, false)));
+  // Stale entries erased, invalidation count kept
+  ASSERT_EQ(RowCacheAdmissionDecision::kRejectForMigration,
+            policy->Admit(HybridContext("k", 2, 0, 2, true)));
+  // Key not tracked
+  ASSERT_EQ(RowCacheAdmissionDecision::kAdmit,
+            policy->Admit(HybridContext("k", 0, 0, 0, true)));
+}
+
+TEST_F(RowCacheAdmissionPolicyTest, TinyLFU) {
+  auto policy = NewTinyLFURowCacheAdmissionPolicy(/*expected_keys=*/1024,
+                                                  /*min_frequency=*/3);
+  ASSERT_STREQ("TinyLFU", policy->Name());
+
+  RowCacheAdmissionContext context;
+  context.user_key = "hot";
+  ASSERT_EQ(RowCacheAdmissionDecision::kReject, policy->Admit(context));
+  policy->OnHit(context);
+  ASSERT_EQ(RowCacheAdmissionDecision::kAdmit, policy->Admit(context));
+
+  // One-off keys stay out
+  int admitted = 0;
+  for (int i = 0; i < 1000; ++i) {
+    std::string key = "scan" + std::to_string(i);
+    context.user_key = key;
+    if (policy->Admit(context) == RowCacheAdmissionDecision::kAdmit) {
+      ++admitted;
+    }
+  }
+  ASSERT_LT(admitted, 50);
+
+  // Invalidation threshold still applies
+  ASSERT_EQ(RowCacheAdmissionDecision::kRejectForMigration,
+            policy->Admit(HybridContext("hot", 1, 1, 1, true)));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,259 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/row_cache_invalidator.h"
+
+#include <algorithm>
+
+#include "db/column_family.h"
+#include "db/kv_cache_policy.h"
+#include "db/table_cache.h"
+#include "monitoring/statistics.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+inline void UpdateMax(std::atomic<SequenceNumber>* target,
+                      SequenceNumber seq) {
+  SequenceNumber cur = target->load(std::memory_order_relaxed);
+  while (cur < seq && !target->compare_exchange_weak(
+                          cur, seq, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+LastWriteSeqnoFilter::LastWriteSeqnoFilter()
+    : buckets_(new std::atomic<SequenceNumber>[kNumBuckets]), floor_(0) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void LastWriteSeqnoFilter::RecordWrite(const Slice& user_key,
+                                       SequenceNumber seq) {
+  UpdateMax(&buckets_[GetSliceNPHash64(user_key) & (kNumBuckets - 1)], seq);
+}
+
+void LastWriteSeqnoFilter::RecordWriteToAllKeys(SequenceNumber seq) {
+  UpdateMax(&floor_, seq);
+}
+
+SequenceNumber LastWriteSeqnoFilter::LastWrite(const Slice& user_key) const {
+  return std::max(
+      buckets_[GetSliceNPHash64(user_key) & (kNumBuckets - 1)].load(
+          std::memory_order_relaxed),
+      floor_.load(std::memory_order_relaxed));
+}
+
+namespace {
+// Counted buckets per row the row cache can hold, taken as one per
+// kDefaultAvgEntryCharge bytes
+constexpr size_t kBucketsPerRow = 4;
+constexpr size_t kMinBuckets = 1 << 12;
+constexpr size_t kMaxBuckets = 1 << 26;
+
+size_t BucketsForCapacity(size_t row_cache_capacity) {
+  size_t rows =
+      row_cache_capacity / KVCPInvalidationTable::kDefaultAvgEntryCharge;
+  size_t buckets = kMinBuckets;
+  while (buckets < kMaxBuckets && buckets < rows * kBucketsPerRow) {
+    buckets *= 2;
+  }
+  return buckets;
+}
+}  // namespace
+
+CachedRowIndex::CachedRowIndex(size_t row_cache_capacity)
+    : bucket_mask_(BucketsForCapacity(row_cache_capacity) - 1),
+      buckets_(new std::atomic<uint16_t>[bucket_mask_ + 1]) {
+  for (size_t i = 0; i <= bucket_mask_; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+std::atomic<uint16_t>* CachedRowIndex::Bucket(const Slice& user_key) const {
+  return &buckets_[GetSliceNPHash64(user_key) & bucket_mask_];
+}
+
+void CachedRowIndex::OnInsert(const Slice& row_cache_key, uint64_t file_number,
+                              const Slice& user_key) {
+  std::atomic<uint16_t>* bucket = Bucket(user_key);
+  uint16_t count = bucket->load(std::memory_order_relaxed);
+  while (count != UINT16_MAX &&
+         !bucket->compare_exchange_weak(count, count + 1,
+                                        std::memory_order_relaxed)) {
+  }
+  if (file_number != 0) {
+    FileStripe& stripe = stripes_[file_number % kNumStripes];
+    MutexLock l(&stripe.mutex);
+    ++stripe.files[file_number][row_cache_key.ToString()];
+  }
+}
+
+void CachedRowIndex::OnErase(const Slice& row_cache_key, uint64_t file_number,
+                             const Slice& user_key) {
+  std::atomic<uint16_t>* bucket = Bucket(user_key);
+  uint16_t count = bucket->load(std::memory_order_relaxed);
+  while (count != UINT16_MAX && count != 0 &&
+         !bucket->compare_exchange_weak(count, count - 1,
+                                        std::memory_order_relaxed)) {
+  }
+  if (file_number != 0) {
+    FileStripe& stripe = stripes_[file_number % kNumStripes];
+    MutexLock l(&stripe.mutex);
+    auto file = stripe.files.find(file_number);
+    if (file == stripe.files.end()) {
+      // Taken by TakeFileKeys()
+      return;
+    }
+    auto key = file->second.find(row_cache_key.ToString());
+    if (key != file->second.end() && --key->second == 0) {
+      file->second.erase(key);
+      if (file->second.empty()) {
+        stripe.files.erase(file);
+      }
+    }
+  }
+}
+
+bool CachedRowIndex::MayBeCached(const Slice& user_key) const {
+  return Bucket(user_key)->load(std::memory_order_relaxed) != 0;
+}
+
+void CachedRowIndex::TakeFileKeys(uint64_t file_number,
+                                  std::vector<std::string>* keys) {
+  std::unordered_map<std::string, uint32_t> file_keys;
+  {
+    FileStripe& stripe = stripes_[file_number % kNumStripes];
+    MutexLock l(&stripe.mutex);
+    auto file = stripe.files.find(file_number);
+    if (file == stripe.files.end()) {
+      return;
+    }
+    file_keys.swap(file->second);
+    stripe.files.erase(file);
+  }
+  for (auto& key : file_keys) {
+    keys->push_back(std::move(key.first));
+  }
+}
+
+RowCacheInvalidator::RowCacheInvalidator(Env* env, Statistics* stats,
+                                         void (*bg_function)(void* arg),
+                                         void* bg_arg)
+    : env_(env),
+      stats_(stats),
+      bg_function_(bg_function),
+      bg_arg_(bg_arg),
+      cv_(&mu_),
+      scheduled_(false),
+      shutting_down_(false) {}
+
+RowCacheInvalidator::~RowCacheInvalidator() { assert(!scheduled_); }
+
+void RowCacheInvalidator::OnKeyWritten(ColumnFamilyData* cfd,
+                                       const Slice& user_key,
+                                       SequenceNumber seq) {
+  TableCache* table_cache = cfd->table_cache();
+  if (table_cache == nullptr) {
+    return;
+  }
+  table_cache->TraceRowCacheWrite(user_key);
+  LastWriteSeqnoFilter* last_write_filter = table_cache->last_write_filter();
+  if (last_write_filter != nullptr) {
+    last_write_filter->RecordWrite(user_key, seq);
+  }
+  CachedRowIndex* cached_rows = table_cache->cached_row_index();
+  if (cached_rows == nullptr || !cached_rows->MayBeCached(user_key)) {
+    return;
+  }
+  KVCPState* kvcp_state = table_cache->kvcp_state();
+  if (kvcp_state->hybrid_admission()) {
+    KVCPInvalidationTable* kvcp_table = kvcp_state->table();
+    uint64_t fp = KVCPInvalidationTable::Fingerprint(
+        KVCPKeyCtx{/*db_ptr=*/nullptr, /*cf_id=*/0, user_key});
+    if (kvcp_table->GetLookupState(fp).cached_key_count > 0 &&
+        kvcp_table->OnInvalidation(fp)) {
+      RecordTick(stats_, ROW_CACHE_INVALIDATION);
+    }
+  }
+
+  MutexLock l(&mu_);
+  if (shutting_down_ || pending_.keys.size() >= kMaxPendingKeys) {
+    return;
+  }
+  pending_.keys.push_back({cfd->GetID(), user_key.ToString(), seq});
+  MaybeScheduleLocked();
+}
+
+void RowCacheInvalidator::OnAllKeysWritten(ColumnFamilyData* cfd,
+                                           SequenceNumber seq) {
+  TableCache* table_cache = cfd->table_cache();
+  LastWriteSeqnoFilter* last_write_filter =
+      table_cache != nullptr ? table_cache->last_write_filter() : nullptr;
+  if (last_write_filter != nullptr) {
+    last_write_filter->RecordWriteToAllKeys(seq);
+  }
+}
+
+void RowCacheInvalidator::OnTableFilesDeleted(
+    const std::vector<uint64_t>& file_numbers) {
+  if (file_numbers.empty()) {
+    return;
+  }
+  MutexLock l(&mu_);
+  if (shutting_down_) {
+    return;
+  }
+  pending_.deleted_files.insert(pending_.deleted_files.end(),
+                                file_numbers.begin(), file_numbers.end());
+  MaybeScheduleLocked();
+}
+
+void RowCacheInvalidator::MaybeScheduleLocked() {
+  mu_.AssertHeld();
+  if (!scheduled_) {
+    scheduled_ = true;
+    env_->Schedule(bg_function_, bg_arg_, Env::Priority::HIGH, nullptr);
+  }
+}
+
+bool RowCacheInvalidator::TakePendingWork(PendingWork* work) {
+  work->keys.clear();
+  work->deleted_files.clear();
+  MutexLock l(&mu_);
+  assert(scheduled_);
+  if (shutting_down_ ||
+      (pending_.keys.empty() && pending_.deleted_files.empty())) {
+    scheduled_ = false;
+    cv_.SignalAll();
+    return false;
+  }
+  std::swap(*work, pending_);
+  return true;
+}
+
+void RowCacheInvalidator::Shutdown() {
+  MutexLock l(&mu_);
+  shutting_down_ = true;
+  pending_.keys.clear();
+  pending_.deleted_files.clear();
+  while (scheduled_) {
+    cv_.Wait();
+  }
+}
+
+void RowCacheInvalidator::TEST_WaitForIdle() {
+  MutexLock l(&mu_);
+  while (scheduled_) {
+    cv_.Wait();
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
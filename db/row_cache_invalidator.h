@@ -0,0 +1,191 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/statistics.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class ColumnFamilyData;
+
+// Remembers, for row cache entries keyed by user key, the last sequence
+// number at which each key of a column family may have been written.
+//
+// Keys are hashed into a fixed number of buckets holding the largest
+// sequence number written to any of their keys, so the answer may be larger
+// than the key's last write but never smaller. Operations that may change
+// any key, such as range deletions, raise a floor applying to all keys.
+//
+// A write must be recorded before it becomes visible to readers. All
+// functions may be called concurrently.
+class LastWriteSeqnoFilter {
+ public:
+  static constexpr size_t kNumBuckets = 1 << 16;
+
+  LastWriteSeqnoFilter();
+
+  LastWriteSeqnoFilter(const LastWriteSeqnoFilter&) = delete;
+  LastWriteSeqnoFilter& operator=(const LastWriteSeqnoFilter&) = delete;
+
+  void RecordWrite(const Slice& user_key, SequenceNumber seq);
+  void RecordWriteToAllKeys(SequenceNumber seq);
+
+  // Upper bound on the sequence number of the last write to user_key, 0 if
+  // none was recorded.
+  SequenceNumber LastWrite(const Slice& user_key) const;
+
+ private:
+  std::unique_ptr<std::atomic<SequenceNumber>[]> buckets_;
+  std::atomic<SequenceNumber> floor_;
+};
+
+// Tracks the row cache entries of a column family, so that the entries made
+// stale by a write or by the deletion of their table file can be found
+// without a scan of the row cache.
+//
+// Cached user keys are counted in hash buckets, about four per row the row
+// cache can hold, so a key may be reported as cached when it is not but never
+// the reverse. The row cache keys of the entries cached by table file are
+// kept per file until the entries leave the row cache or the file is
+// deleted.
+//
+// Updated on every row cache insertion and by the deleter of every entry,
+// which may run after the column family is gone, so it is shared with the
+// entries. All functions may be called concurrently.
+class CachedRowIndex {
+ public:
+  explicit CachedRowIndex(size_t row_cache_capacity);
+
+  CachedRowIndex(const CachedRowIndex&) = delete;
+  CachedRowIndex& operator=(const CachedRowIndex&) = delete;
+
+  // For an entry of user_key under row_cache_key, of table file file_number
+  // or 0 if cached by user key
+  void OnInsert(const Slice& row_cache_key, uint64_t file_number,
+                const Slice& user_key);
+  void OnErase(const Slice& row_cache_key, uint64_t file_number,
+               const Slice& user_key);
+
+  bool MayBeCached(const Slice& user_key) const;
+
+  // Appends the row cache keys of the entries of file_number to *keys, and
+  // stops tracking them.
+  void TakeFileKeys(uint64_t file_number, std::vector<std::string>* keys);
+
+  size_t NumBuckets() const { return bucket_mask_ + 1; }
+
+ private:
+  static constexpr size_t kNumStripes = 16;
+
+  // Row cache keys by file, with the number of entries under each, as an
+  // insertion may replace an entry of the same key
+  struct ALIGN_AS(CACHE_LINE_SIZE) FileStripe {
+    port::Mutex mutex;
+    std::unordered_map<uint64_t, std::unordered_map<std::string, uint32_t>>
+        files;
+  };
+
+  std::atomic<uint16_t>* Bucket(const Slice& user_key) const;
+
+  const size_t bucket_mask_;
+  // Saturating counts of cached entries, stuck once saturated
+  std::unique_ptr<std::atomic<uint16_t>[]> buckets_;
+  FileStripe stripes_[kNumStripes];
+};
+
+// Collects the row cache entries of a DB made stale by writes and by deleted
+// table files, so that they can be erased in the background instead of
+// occupying the row cache until LRU eviction.
+//
+// Keys written to a memtable are recorded in the column family's
+// LastWriteSeqnoFilter, if it caches rows by user key, and counted as
+// invalidations by its hybrid admission state (KVCPState), if enabled. Keys
+// that its CachedRowIndex reports as cached are queued, so the write path
+// pays a single bucket read per key otherwise. Deleted table files are
+// queued as a whole, and their entries found in the CachedRowIndex.
+//
+// Queued work is handed over in batches to a background job, bg_function
+// scheduled in the HIGH priority thread pool when the first work arrives.
+class RowCacheInvalidator {
+ public:
+  // Bound on queued keys. Keys beyond it are still counted as invalidated
+  // but their entries are left to LRU eviction.
+  static constexpr size_t kMaxPendingKeys = 64 << 10;
+
+  struct PendingKey {
+    uint32_t cf_id;
+    std::string user_key;
+    // Sequence number of the write; entries of files whose largest sequence
+    // number is smaller are stale.
+    SequenceNumber seq;
+  };
+
+  struct PendingWork {
+    std::vector<PendingKey> keys;
+    std::vector<uint64_t> deleted_files;
+  };
+
+  RowCacheInvalidator(Env* env, Statistics* stats,
+                      void (*bg_function)(void* arg), void* bg_arg);
+  ~RowCacheInvalidator();
+
+  RowCacheInvalidator(const RowCacheInvalidator&) = delete;
+  RowCacheInvalidator& operator=(const RowCacheInvalidator&) = delete;
+
+  // Called for every key written to a memtable of cfd at sequence seq.
+  // Thread-safe.
+  void OnKeyWritten(ColumnFamilyData* cfd, const Slice& user_key,
+                    SequenceNumber seq);
+
+  // Called for writes at sequence seq that may change any key of cfd, e.g.
+  // range deletions. Thread-safe.
+  void OnAllKeysWritten(ColumnFamilyData* cfd, SequenceNumber seq);
+
+  // Called with the numbers of table files about to be deleted.
+  // Thread-safe.
+  void OnTableFilesDeleted(const std::vector<uint64_t>& file_numbers);
+
+  // Called by the background job: moves all queued work into *work and
+  // returns true, or marks the job as finished and returns false when there
+  // is none or Shutdown() was called. The job must not touch this object
+  // after false is returned.
+  bool TakePendingWork(PendingWork* work);
+
+  // Drops queued work, stops accepting more and waits for a running
+  // background job to finish.
+  void Shutdown();
+
+  // Waits until no work is queued or being processed.
+  void TEST_WaitForIdle();
+
+ private:
+  // REQUIRES: mu_ held
+  void MaybeScheduleLocked();
+
+  Env* const env_;
+  Statistics* const stats_;
+  void (*const bg_function_)(void*);
+  void* const bg_arg_;
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  PendingWork pending_;
+  // Whether a background job is scheduled or running
+  bool scheduled_;
+  bool shutting_down_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
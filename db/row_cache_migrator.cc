@@ -0,0 +1,103 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/row_cache_migrator.h"
+
+#include "util/coding.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+std::string PendingKey(uint32_t cf_id, const Slice& user_key) {
+  std::string key;
+  key.reserve(sizeof(cf_id) + user_key.size());
+  PutFixed32(&key, cf_id);
+  key.append(user_key.data(), user_key.size());
+  return key;
+}
+
+}  // namespace
+
+RowCacheMigrator::RowCacheMigrator(Env* env, void (*bg_function)(void* arg),
+                                   void* bg_arg)
+    : env_(env),
+      bg_function_(bg_function),
+      bg_arg_(bg_arg),
+      cv_(&mu_),
+      scheduled_(false),
+      shutting_down_(false) {}
+
+RowCacheMigrator::~RowCacheMigrator() { assert(!scheduled_); }
+
+bool RowCacheMigrator::Enqueue(uint32_t cf_id, const Slice& user_key,
+                               const Slice& value, SequenceNumber read_seq,
+                               uint64_t row_cache_epoch) {
+  std::string pending_key = PendingKey(cf_id, user_key);
+  MutexLock l(&mu_);
+  if (shutting_down_ || pending_.size() >= kMaxPendingRows) {
+    return false;
+  }
+  if (!pending_keys_.insert(std::move(pending_key)).second) {
+    // Already queued; the copy made for it is as good
+    return true;
+  }
+  pending_.push_back({cf_id, user_key.ToString(), value.ToString(), read_seq,
+                      row_cache_epoch});
+  if (!scheduled_) {
+    scheduled_ = true;
+    env_->Schedule(bg_function_, bg_arg_, Env::Priority::HIGH, nullptr);
+  }
+  return true;
+}
+
+bool RowCacheMigrator::TakePendingRows(std::vector<PendingRow>* rows) {
+  rows->clear();
+  MutexLock l(&mu_);
+  assert(scheduled_);
+  if (shutting_down_ || pending_.empty()) {
+    scheduled_ = false;
+    cv_.SignalAll();
+    return false;
+  }
+  std::swap(*rows, pending_);
+  pending_keys_.clear();
+  return true;
+}
+
+bool RowCacheMigrator::ConsumeBudget(uint32_t cf_id, uint64_t memtable_id,
+                                     uint64_t bytes, uint64_t budget) {
+  MemTableBudget& b = budgets_[cf_id];
+  if (b.memtable_id != memtable_id) {
+    // Switched to a new memtable
+    b.memtable_id = memtable_id;
+    b.used = 0;
+  }
+  if (bytes > budget || b.used > budget - bytes) {
+    return false;
+  }
+  b.used += bytes;
+  return true;
+}
+
+void RowCacheMigrator::Shutdown() {
+  MutexLock l(&mu_);
+  shutting_down_ = true;
+  pending_.clear();
+  pending_keys_.clear();
+  while (scheduled_) {
+    cv_.Wait();
+  }
+}
+
+void RowCacheMigrator::TEST_WaitForIdle() {
+  MutexLock l(&mu_);
+  while (scheduled_) {
+    cv_.Wait();
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,101 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "port/port.h"
+#include "rocksdb/env.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Queues rows that the row cache admission policy rejected for migration
+// (RowCacheAdmissionDecision::kRejectForMigration) after a Get read them
+// from a table file, so that a background job copies them into the active
+// memtable of their column family (ColumnFamilyOptions::
+// row_cache_migration_budget).
+//
+// Queued work is handed over in batches to the background job, bg_function
+// scheduled in the HIGH priority thread pool when the first row arrives. A
+// row already queued is not queued again, so hot rows read by many threads
+// at once are copied once.
+//
+// The job also keeps the number of bytes copied into the active memtable of
+// each column family, through ConsumeBudget().
+class RowCacheMigrator {
+ public:
+  // Bound on queued rows. Rows beyond it are dropped.
+  static constexpr size_t kMaxPendingRows = 4096;
+
+  struct PendingRow {
+    uint32_t cf_id;
+    std::string user_key;
+    std::string value;
+    // The row was read as of this sequence number and in this row cache
+    // epoch (Version::GetRowCacheEpoch()); it must not be copied if either
+    // changed for the key since.
+    SequenceNumber read_seq;
+    uint64_t row_cache_epoch;
+  };
+
+  RowCacheMigrator(Env* env, void (*bg_function)(void* arg), void* bg_arg);
+  ~RowCacheMigrator();
+
+  RowCacheMigrator(const RowCacheMigrator&) = delete;
+  RowCacheMigrator& operator=(const RowCacheMigrator&) = delete;
+
+  // Queues a row; returns false if it was dropped. Thread-safe.
+  bool Enqueue(uint32_t cf_id, const Slice& user_key, const Slice& value,
+               SequenceNumber read_seq, uint64_t row_cache_epoch);
+
+  // Called by the background job: moves all queued rows into *rows and
+  // returns true, or marks the job as finished and returns false when there
+  // are none or Shutdown() was called. The job must not touch this object
+  // after false is returned.
+  bool TakePendingRows(std::vector<PendingRow>* rows);
+
+  // Charges bytes against the budget of the memtable memtable_id of column
+  // family cf_id; returns false, charging nothing, if they do not fit.
+  // Called only by the background job.
+  bool ConsumeBudget(uint32_t cf_id, uint64_t memtable_id, uint64_t bytes,
+                     uint64_t budget);
+
+  // Drops queued rows, stops accepting more and waits for a running
+  // background job to finish.
+  void Shutdown();
+
+  // Waits until no rows are queued or being copied.
+  void TEST_WaitForIdle();
+
+ private:
+  struct MemTableBudget {
+    uint64_t memtable_id = 0;
+    uint64_t used = 0;
+  };
+
+  Env* const env_;
+  void (*const bg_function_)(void*);
+  void* const bg_arg_;
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  std::vector<PendingRow> pending_;
+  // Column family id and user key of the rows in pending_
+  std::unordered_set<std::string> pending_keys_;
+  // Whether a background job is scheduled or running
+  bool scheduled_;
+  bool shutting_down_;
+
+  // Only used by the background job
+  std::unordered_map<uint32_t, MemTableBudget> budgets_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
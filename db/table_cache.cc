@@ -13,9 +13,11 @@
 #include "db/range_tombstone_fragmenter.h"
 #include "db/snapshot_impl.h"
 #include "db/version_edit.h"
+#include "db/version_set.h"
 #include "file/file_util.h"
 #include "file/filename.h"
 #include "file/random_access_file_reader.h"
+#include "memory/memory_allocator.h"
 #include "monitoring/perf_context_imp.h"
 #include <inttypes.h>
 #include "logging/logging.h"
@@ -24,6 +26,7 @@
 #include "rocksdb/advanced_options.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/kv_cache_policy.h"
+#include "rocksdb/row_cache_admission_policy.h"
 #include "table/block_based/block_based_table_reader.h"
 #include "table/get_context.h"
 #include "table/internal_iterator.h"
@@ -34,71 +37,102 @@
 #include "test_util/sync_point.h"
 #include "util/cast_util.h"
 #include "util/coding.h"
+#include "util/random.h"
 #include "util/stop_watch.h"
 
-#include <thread>
-#include <iomanip>
-#include <sstream>
-#include <cinttypes>
-#ifdef __linux__
-#include <sys/syscall.h>
-#include <unistd.h>
-#endif
-#include <cstdlib>
-#include <cstdio>
-
 namespace ROCKSDB_NAMESPACE {
 
 namespace {
 
-
-static inline void LogHybridChoice(const ImmutableOptions& iopts,
-                                   const char* tag,
-                                   const Slice& user_key,
-                                   uint32_t inv,
-                                   uint32_t th,
-                                   uint32_t cache_cnt) {
-  if (!iopts.info_log) return;
-  #ifdef __linux__
-    // Linux: 커널 TID (long 반환 → 64비트로 올림)
-    uint64_t tid = static_cast<uint64_t>(::syscall(SYS_gettid));
-  #else
-    // 기타 플랫폼: thread::id 해시를 64비트로
-    uint64_t tid = static_cast<uint64_t>(
-        std::hash<std::thread::id>{}(std::this_thread::get_id()));
-  #endif
-
-  std::string key_hex = user_key.ToString(true);
-
-  /*
-    ROCKS_LOG_INFO(iopts.info_log,
-                "[HYBRID] %s thread_id=%" PRIu64 " key=%s inv=%u th=%u",
-                tag,
-                tid,
-                key_hex.c_str(),
-                inv,
-                th);
-  */
-
-  std::fprintf(stderr,
-               "[HYBRID] %s thread_id=%" PRIu64 " key=%s inv=%u th=%u cnt=%u\n",
-               tag, tid, key_hex.c_str(), inv, th, cache_cnt);
-  std::fflush(stderr);
-}
-
 template <class T>
 static void DeleteEntry(const Slice& /*key*/, void* value) {
   T* typed_value = reinterpret_cast<T*>(value);
   delete typed_value;
 }
 
+// A row cache entry is a single buffer, allocated from the row cache's
+// MemoryAllocator, holding this header, the optional sections selected by
+// flags in this order, and the replay log.
 struct RowCacheEntry {
-  std::string value;
-  Logger* info_log = nullptr;
-  Env* env = nullptr;
-  uint64_t insert_time_micros = 0;
-  std::atomic<uint64_t> hit_count{0};
+  enum Flags : uint8_t {
+    // Followed by a KVCP section
+    kHasKVCP = 1 << 0,
+    // Followed by a tracking section
+    kHasTracking = 1 << 1,
+  };
+
+  // [Hybrid 기법 위한 수정] - hybrid 활성 상태에서 insert 된 경우만 존재
+  // Eviction 시 해당 column family의 hash table 갱신에 사용
+  struct KVCP {
+    std::shared_ptr<KVCPState> state;
+    uint64_t fp;
+  };
+
+  // Only in entries sampled by DBOptions::row_cache_tracking_sample_rate
+  struct Tracking {
+    Statistics* stats;
+    SystemClock* clock;
+    uint64_t insert_time_micros;
+    std::atomic<uint64_t> hit_count;
+  };
+
+  MemoryAllocator* allocator;
+  // Index of the entries of the column family, updated on erasure
+  std::shared_ptr<CachedRowIndex> cached_row_index;
+  // Sequence number the row was read at. Rows cached by user key are valid
+  // while the key was not written after it.
+  SequenceNumber read_seq;
+  uint32_t replay_log_size;
+  uint8_t flags;
+  // Set before erasing an entry whose key was overwritten, so that the key
+  // keeps its invalidation count
+  std::atomic<bool> stale;
+
+  static size_t SizeFor(uint8_t entry_flags, size_t replay_log_size) {
+    return sizeof(RowCacheEntry) +
+           ((entry_flags & kHasKVCP) ? sizeof(KVCP) : 0) +
+           ((entry_flags & kHasTracking) ? sizeof(Tracking) : 0) +
+           replay_log_size;
+  }
+
+  char* sections() { return reinterpret_cast<char*>(this + 1); }
+  KVCP* kvcp() {
+    return (flags & kHasKVCP) ? reinterpret_cast<KVCP*>(sections()) : nullptr;
+  }
+  Tracking* tracking() {
+    if (!(flags & kHasTracking)) {
+      return nullptr;
+    }
+    return reinterpret_cast<Tracking*>(
+        sections() + ((flags & kHasKVCP) ? sizeof(KVCP) : 0));
+  }
+  char* replay_log_data() {
+    return sections() + SizeFor(flags, 0) - sizeof(RowCacheEntry);
+  }
+  Slice replay_log() { return Slice(replay_log_data(), replay_log_size); }
 };
+static_assert(sizeof(RowCacheEntry) % alignof(RowCacheEntry::KVCP) == 0,
+              "sections must stay aligned");
+static_assert(sizeof(RowCacheEntry::KVCP) %
+                      alignof(RowCacheEntry::Tracking) ==
+                  0,
+              "sections must stay aligned");
+
+// Whether a replay log holds a blob index, which must not be cached by user
+// key since the blob file it points to may be garbage collected by
+// compaction
+bool ReplayLogHasBlobIndex(Slice replay_log) {
+  while (!replay_log.empty()) {
+    auto type = static_cast<ValueType>(replay_log[0]);
+    replay_log.remove_prefix(1);
+    Slice value;
+    if (type == kTypeBlobIndex ||
+        !GetLengthPrefixedSlice(&replay_log, &value)) {
+      return true;
+    }
+  }
+  return false;
+}
 
 static bool ParseRowCacheKey(const Slice& cache_key, uint64_t* cache_id,
                              uint64_t* file_number, uint64_t* seq_no,
@@ -126,62 +160,37 @@ static bool ParseRowCacheKey(const Slice& cache_key, uint64_t* cache_id,
 
 static void DeleteRowCacheEntry(const Slice& key, void* value) {
   auto* entry = reinterpret_cast<RowCacheEntry*>(value);
-  if (entry != nullptr && entry->info_log != nullptr) {
+  if (entry->cached_row_index) {
     uint64_t cache_id = 0;
     uint64_t file_number = 0;
     uint64_t seq_no = 0;
     Slice user_key;
-    uint64_t residency_micros = 0;
-    if (entry->insert_time_micros > 0) {
-      Env* env = entry->env != nullptr ? entry->env : Env::Default();
-      uint64_t now_micros = env != nullptr ? env->NowMicros() : 0;
-      if (now_micros >= entry->insert_time_micros) {
-        residency_micros = now_micros - entry->insert_time_micros;
-      }
-    }
     if (ParseRowCacheKey(key, &cache_id, &file_number, &seq_no, &user_key)) {
-      std::string user_key_hex = user_key.ToString(true);
-      KVCPKeyCtx kvcp_ctx{/*db_ptr=*/nullptr, /*cf_id=*/0, /*user_key=*/user_key};
-      /*
-      uint32_t cached_cnt = KVCP_GetCachedKeyCount(kvcp_ctx);
-      uint32_t inval_cnt  = KVCP_GetInvalidationCount(kvcp_ctx);
-      ROCKS_LOG_INFO(entry->info_log,
-                     "Row cache evicted (file=%" PRIu64
-                     ", user_key_hex=%s, residency_micros=%" PRIu64
-                     ", hit_count=%" PRIu64
-                     ", cached_key_count=%u"
-                     ", invalidation_count=%u)",
-                     file_number,
-                     user_key_hex.c_str(),
-                     residency_micros,
-                     entry->hit_count.load(std::memory_order_relaxed),
-                     cached_cnt,
-                     inval_cnt
-                    );
-      */
-      // [Hybrid 기법 위한 수정] - Row cache eviction 시 hash table 갱신
-      if (KVCP_IsHybridEnabled()) {
-        KVCP_OnRowCacheEvict(kvcp_ctx);
-        if (const char* p = std::getenv("EVICT_LOGGING"); p && p[0] == '1') {
-          uint32_t inv = KVCP_GetInvalidationCount(kvcp_ctx);
-          uint32_t cached_cnt = KVCP_GetCachedKeyCount(kvcp_ctx);
-          uint32_t th  = KVCP_GetThreshold(/*db_ptr*/nullptr, /*cf_id*/0);
-          std::string key_hex = user_key.ToString(true);
-          std::fprintf(stderr,
-               "[EVICT] file=%u key=%s inv=%u th=%u cnt=%u\n",
-                file_number, key_hex.c_str(), inv, th, cached_cnt);
-          std::fflush(stderr);
-        }
-      }
+      entry->cached_row_index->OnErase(key, file_number, user_key);
+    }
+  }
+  // [Hybrid 기법 위한 수정] - Row cache eviction 시 hash table 갱신
+  if (RowCacheEntry::KVCP* kvcp = entry->kvcp()) {
+    if (entry->stale.load(std::memory_order_relaxed)) {
+      kvcp->state->table()->OnStaleErase(kvcp->fp);
     } else {
-      std::string key_hex = key.ToString(true);
-      ROCKS_LOG_INFO(entry->info_log,
-                     "Row cache eviction key parse failure, raw key hex: %s, "
-                     "residency_micros=%" PRIu64 ", hit_count=%" PRIu64,
-                     key_hex.c_str(), residency_micros, entry->hit_count.load(std::memory_order_relaxed));
+      kvcp->state->table()->OnEvict(kvcp->fp);
     }
+    kvcp->~KVCP();
+  }
+  if (RowCacheEntry::Tracking* tracking = entry->tracking()) {
+    uint64_t now_micros = tracking->clock->NowMicros();
+    RecordInHistogram(tracking->stats, ROW_CACHE_ENTRY_RESIDENCY_MICROS,
+                      now_micros > tracking->insert_time_micros
+                          ? now_micros - tracking->insert_time_micros
+                          : 0);
+    RecordInHistogram(tracking->stats, ROW_CACHE_ENTRY_HITS,
+                      tracking->hit_count.load(std::memory_order_relaxed));
+    tracking->~Tracking();
   }
-  delete entry;
+  CustomDeleter deleter(entry->allocator);
+  entry->~RowCacheEntry();
+  deleter(reinterpret_cast<char*>(entry));
 }
 
 static void UnrefEntry(void* arg1, void* arg2) {
@@ -217,19 +226,45 @@ TableCache::TableCache(const ImmutableOptions& ioptions,
     : ioptions_(ioptions),
       file_options_(*file_options),
       cache_(cache),
+      row_cache_id_num_(0),
+      row_cache_epoch_(0),
       immortal_tables_(false),
       block_cache_tracer_(block_cache_tracer),
+      trace_cf_id_(0),
+      trace_cf_name_(BlockCacheTraceHelper::kUnknownColumnFamilyName),
       loader_mutex_(kLoadConcurency, kGetSliceNPHash64UnseededFnPtr),
       io_tracer_(io_tracer),
       db_session_id_(db_session_id) {
   if (ioptions_.row_cache) {
     // If the same cache is shared by multiple instances, we need to
     // disambiguate its entries.
-    PutVarint64(&row_cache_id_, ioptions_.row_cache->NewId());
+    row_cache_id_num_ = ioptions_.row_cache->NewId();
+    PutVarint64(&row_cache_id_, row_cache_id_num_);
+    // [Hybrid 기법 위한 수정] - Column family 단위 hash table / threshold
+    kvcp_state_ = std::make_shared<KVCPState>(ioptions_.row_cache);
+    cached_row_index_ =
+        std::make_shared<CachedRowIndex>(ioptions_.row_cache->GetCapacity());
+    row_cache_admission_policy_ =
+        ioptions_.row_cache_admission_policy
+            ? ioptions_.row_cache_admission_policy
+            : NewInvalidationThresholdRowCacheAdmissionPolicy();
+    // Compaction filters may change values without a write, and unordered
+    // writes may become visible before they are recorded
+    if (ioptions_.row_cache_key_by_user_key &&
+        ioptions_.compaction_filter == nullptr &&
+        ioptions_.compaction_filter_factory == nullptr &&
+        !ioptions_.unordered_write &&
+        ioptions_.user_comparator->timestamp_size() == 0) {
+      last_write_filter_.reset(new LastWriteSeqnoFilter());
+    }
   }
 }
 
 TableCache::~TableCache() {
+  if (kvcp_state_) {
+    // Row cache entry가 state를 계속 참조할 수 있으므로 reservation만 해제
+    kvcp_state_->ReleaseCacheReservation();
+  }
 }
 
 TableReader* TableCache::GetTableReaderFromHandle(Cache::Handle* handle) {
@@ -506,13 +541,111 @@ void TableCache::CreateRowCacheKeyPrefix(const ReadOptions& options,
   AppendVarint64(&row_cache_key, seq_no);
 }
 
-bool TableCache::GetFromRowCache(const Slice& user_key, IterKey& row_cache_key,
-                                 size_t prefix_size, GetContext* get_context) {
-  bool found = false;
+bool TableCache::UseUserKeyRowCacheKey(GetContext* get_context) const {
+  if (last_write_filter_ == nullptr || get_context->has_callback() ||
+      get_context->State() != GetContext::kNotFound) {
+    return false;
+  }
+  SequenceNumber* max_covering_tombstone_seq =
+      get_context->max_covering_tombstone_seq();
+  return max_covering_tombstone_seq == nullptr ||
+         *max_covering_tombstone_seq == 0;
+}
+
+void TableCache::CreateUserKeyRowCacheKeyPrefix(uint64_t row_cache_epoch,
+                                                IterKey& row_cache_key) const {
+  row_cache_key.TrimAppend(row_cache_key.Size(), row_cache_id_.data(),
+                           row_cache_id_.size());
+  AppendVarint64(&row_cache_key, /*fd_number=*/0);
+  AppendVarint64(&row_cache_key, row_cache_epoch);
+}
+
+void TableCache::TraceRowCacheAccess(BlockCacheTraceRecord* record,
+                                     const Slice& user_key) const {
+  record->access_timestamp = ioptions_.clock->NowMicros();
+  record->cf_id = trace_cf_id_;
+  block_cache_tracer_
+      ->WriteBlockAccess(*record, user_key, trace_cf_name_,
+                         /*referenced_key=*/Slice())
+      .PermitUncheckedError();
+}
 
+void TableCache::TraceRowCacheMiss(const Slice& user_key,
+                                   TableReaderCaller caller, int level,
+                                   const FileDescriptor& fd, size_t row_size,
+                                   bool read_from_storage,
+                                   RowCacheAdmissionDecision decision) const {
+  BlockCacheTraceRecord record;
+  record.block_type = TraceType::kBlockTraceRowCacheLookup;
+  record.block_size = row_size;
+  record.level = static_cast<uint32_t>(level);
+  record.sst_fd_number = fd.GetNumber();
+  record.caller = caller;
+  record.no_insert = decision != RowCacheAdmissionDecision::kAdmit
+                         ? Boolean::kTrue
+                         : Boolean::kFalse;
+  record.row_read_from_storage =
+      read_from_storage ? Boolean::kTrue : Boolean::kFalse;
+  record.row_rejected_for_migration =
+      decision == RowCacheAdmissionDecision::kRejectForMigration
+          ? Boolean::kTrue
+          : Boolean::kFalse;
+  TraceRowCacheAccess(&record, user_key);
+}
+
+void TableCache::TraceRowCacheWrite(const Slice& user_key) const {
+  if (!IsRowCacheTracingEnabled()) {
+    return;
+  }
+  BlockCacheTraceRecord record;
+  record.block_type = TraceType::kBlockTraceRowCacheWrite;
+  TraceRowCacheAccess(&record, user_key);
+}
+
+bool TableCache::GetFromRowCache(const Slice& user_key, IterKey& row_cache_key,
+                                 size_t prefix_size, GetContext* get_context,
+                                 int level, const FileDescriptor& fd,
+                                 TableReaderCaller caller,
+                                 SequenceNumber read_seq) {
   row_cache_key.TrimAppend(prefix_size, user_key.data(), user_key.size());
-  if (auto row_handle =
-          ioptions_.row_cache->Lookup(row_cache_key.GetUserKey())) {
+  Cache::Handle* row_handle =
+      ioptions_.row_cache->Lookup(row_cache_key.GetUserKey());
+  return GetFromRowCache(user_key, row_cache_key.GetUserKey(), row_handle,
+                         get_context, level, fd, caller, read_seq);
+}
+
+bool TableCache::GetFromRowCache(const Slice& user_key,
+                                 const Slice& row_cache_key,
+                                 Cache::Handle* row_handle,
+                                 GetContext* get_context, int level,
+                                 const FileDescriptor& fd,
+                                 TableReaderCaller caller,
+                                 SequenceNumber read_seq) {
+  bool found = false;
+  Cache* row_cache = ioptions_.row_cache.get();
+
+  if (row_handle != nullptr && read_seq != kMaxSequenceNumber) {
+    // Cached by user key: the row is the latest version both at read_seq
+    // and at the sequence number it was read at, unless the key was written
+    // after the older of the two.
+    auto* entry = static_cast<RowCacheEntry*>(row_cache->Value(row_handle));
+    SequenceNumber last_write = last_write_filter_->LastWrite(user_key);
+    if (last_write > std::min(read_seq, entry->read_seq)) {
+      if (last_write > entry->read_seq) {
+        // Overwritten, useless to any later read
+        entry->stale.store(true, std::memory_order_relaxed);
+        row_cache->Erase(row_cache_key);
+        if (IsRowCacheTracingEnabled()) {
+          BlockCacheTraceRecord record;
+          record.block_type = TraceType::kBlockTraceRowCacheErase;
+          TraceRowCacheAccess(&record, user_key);
+        }
+      }
+      row_cache->Release(row_handle);
+      row_handle = nullptr;
+    }
+  }
+  if (row_handle != nullptr) {
     // Cleanable routine to release the cache entry
     Cleanable value_pinner;
     auto release_cache_entry_func = [](void* cache_to_clean,
@@ -521,8 +654,10 @@ bool TableCache::GetFromRowCache(const Slice& user_key, IterKey& row_cache_key,
     };
     auto* found_row_cache_entry =
         static_cast<RowCacheEntry*>(ioptions_.row_cache->Value(row_handle));
-    found_row_cache_entry->hit_count.fetch_add(1, std::memory_order_relaxed);
-    const std::string& cached_replay_log = found_row_cache_entry->value;
+    if (RowCacheEntry::Tracking* tracking = found_row_cache_entry->tracking()) {
+      tracking->hit_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    Slice cached_replay_log = found_row_cache_entry->replay_log();
     // If it comes here value is located on the cache.
     // found_row_cache_entry points to the cached row entry,
     // and cached_replay_log references the stored value buffer.
@@ -536,14 +671,259 @@ bool TableCache::GetFromRowCache(const Slice& user_key, IterKey& row_cache_key,
     replayGetContextLog(cached_replay_log, user_key, get_context,
                         &value_pinner);
     RecordTick(ioptions_.stats, ROW_CACHE_HIT);
+    RowCacheAdmissionContext admission_context;
+    admission_context.user_key = user_key;
+    admission_context.level = level;
+    row_cache_admission_policy_->OnHit(admission_context);
+    if (IsRowCacheTracingEnabled()) {
+      BlockCacheTraceRecord record;
+      record.block_type = TraceType::kBlockTraceRowCacheLookup;
+      record.block_size = cached_replay_log.size();
+      record.level = static_cast<uint32_t>(level);
+      record.sst_fd_number = fd.GetNumber();
+      record.caller = caller;
+      record.is_cache_hit = Boolean::kTrue;
+      TraceRowCacheAccess(&record, user_key);
+    }
     found = true;
   } else {
     RecordTick(ioptions_.stats, ROW_CACHE_MISS);
   }
   return found;
 }
+
+RowCacheAdmissionDecision TableCache::MaybeInsertIntoRowCache(
+    const Slice& user_key, int level, bool read_from_storage,
+    const IterKey& row_cache_key, std::string* row_cache_entry,
+    SequenceNumber read_seq, const KVCPLookup* kvcp_lookup) {
+  RowCacheAdmissionContext admission_context;
+  admission_context.user_key = user_key;
+  admission_context.level = level;
+  admission_context.read_from_storage = read_from_storage;
+
+  // [Hybrid 기법 위한 수정] - column family 단위 hash table 사용
+  // (table 자체가 column family 별이므로 db_ptr / cf_id 구분 불필요)
+  KVCPInvalidationTable* kvcp_table = nullptr;
+  uint64_t kvcp_fp = 0;
+  if (kvcp_state_->hybrid_admission()) {
+    kvcp_table = kvcp_state_->table();
+    admission_context.hybrid_admission = true;
+    if (kvcp_lookup != nullptr) {
+      kvcp_fp = kvcp_lookup->fp;
+      admission_context.kvcp = kvcp_lookup->state;
+    } else {
+      kvcp_fp = KVCPInvalidationTable::Fingerprint(
+          KVCPKeyCtx{/*db_ptr=*/nullptr, /*cf_id=*/0, /*user_key=*/user_key});
+      admission_context.kvcp = kvcp_table->GetLookupState(kvcp_fp);
+    }
+    admission_context.invalidation_threshold =
+        kvcp_state_->invalidation_threshold();
+    // Invalidation count는 write path에서 갱신됨 (RowCacheInvalidator)
+  }
+
+  RowCacheAdmissionDecision decision =
+      row_cache_admission_policy_->Admit(admission_context);
+  if (decision != RowCacheAdmissionDecision::kAdmit) {
+    RecordTick(ioptions_.stats, ROW_CACHE_ADMISSION_REJECT);
+    return decision;
+  }
+
+  InsertRowCacheEntry(row_cache_key.GetUserKey(), *row_cache_entry, read_seq,
+                      kvcp_table, kvcp_fp);
+  return decision;
+}
+
+size_t TableCache::InsertRowCacheEntry(const Slice& key,
+                                       const Slice& replay_log,
+                                       SequenceNumber read_seq,
+                                       KVCPInvalidationTable* kvcp_table,
+                                       uint64_t kvcp_fp) {
+  uint8_t flags = 0;
+  if (kvcp_table != nullptr) {
+    flags |= RowCacheEntry::kHasKVCP;
+  }
+  uint32_t sample_rate = ioptions_.row_cache_tracking_sample_rate;
+  if (sample_rate > 0 && Random::GetTLSInstance()->OneIn(sample_rate)) {
+    flags |= RowCacheEntry::kHasTracking;
+  }
+  Cache* row_cache = ioptions_.row_cache.get();
+  MemoryAllocator* allocator = row_cache->memory_allocator();
+  size_t size = RowCacheEntry::SizeFor(flags, replay_log.size());
+  char* buf = AllocateBlock(size, allocator).release();
+  // The key is charged by the cache as part of its metadata
+  size_t charge =
+      allocator != nullptr ? allocator->UsableSize(buf, size) : size;
+
+  auto* row_ptr = new (buf) RowCacheEntry();
+  row_ptr->allocator = allocator;
+  // Before the insertion, which may call the deleter right away
+  uint64_t cache_id = 0;
+  uint64_t file_number = 0;
+  uint64_t seq_no = 0;
+  Slice user_key;
+  if (ParseRowCacheKey(key, &cache_id, &file_number, &seq_no, &user_key)) {
+    row_ptr->cached_row_index = cached_row_index_;
+    cached_row_index_->OnInsert(key, file_number, user_key);
+  }
+  row_ptr->read_seq = read_seq;
+  row_ptr->replay_log_size = static_cast<uint32_t>(replay_log.size());
+  row_ptr->flags = flags;
+  row_ptr->stale.store(false, std::memory_order_relaxed);
+  // [Hybrid 기법 위한 수정] - Row cache에 넣는 경우 hash table 갱신
+  // Insert 실패 / 즉시 evict 시 deleter의 OnEvict와 짝이 맞도록 insert 전에 수행
+  if (kvcp_table != nullptr) {
+    new (row_ptr->kvcp()) RowCacheEntry::KVCP{kvcp_state_, kvcp_fp};
+    kvcp_table->OnInsert(kvcp_fp);
+  }
+  if (RowCacheEntry::Tracking* tracking = row_ptr->tracking()) {
+    new (tracking) RowCacheEntry::Tracking();
+    tracking->stats = ioptions_.stats;
+    tracking->clock = ioptions_.clock;
+    tracking->insert_time_micros = ioptions_.clock->NowMicros();
+    tracking->hit_count.store(0, std::memory_order_relaxed);
+  }
+  memcpy(row_ptr->replay_log_data(), replay_log.data(), replay_log.size());
+  // If row cache is full, it's OK to continue.
+  row_cache->Insert(key, row_ptr, charge, &DeleteRowCacheEntry)
+      .PermitUncheckedError();
+  return charge;
+}
+
+size_t TableCache::RestoreRowCacheEntry(uint64_t file_number,
+                                        const Slice& user_key,
+                                        const Slice& replay_log) {
+  if (!ioptions_.row_cache) {
+    return 0;
+  }
+  IterKey row_cache_key;
+  row_cache_key.TrimAppend(0, row_cache_id_.data(), row_cache_id_.size());
+  AppendVarint64(&row_cache_key, file_number);
+  AppendVarint64(&row_cache_key, /*seq_no=*/0);
+  row_cache_key.TrimAppend(row_cache_key.Size(), user_key.data(),
+                           user_key.size());
+  // Tracked by the hybrid admission table like the rows it admits
+  KVCPInvalidationTable* kvcp_table = nullptr;
+  uint64_t kvcp_fp = 0;
+  if (kvcp_state_->hybrid_admission()) {
+    kvcp_table = kvcp_state_->table();
+    kvcp_fp = KVCPInvalidationTable::Fingerprint(
+        KVCPKeyCtx{/*db_ptr=*/nullptr, /*cf_id=*/0, /*user_key=*/user_key});
+  }
+  // Rows cached by file do not check the sequence number they were read at
+  return InsertRowCacheEntry(row_cache_key.GetUserKey(), replay_log,
+                             /*read_seq=*/0, kvcp_table, kvcp_fp);
+}
 #endif  // ROCKSDB_LITE
 
+size_t TableCache::EraseStaleRowCacheEntries(
+    const Slice& user_key, SequenceNumber seq,
+    const VersionStorageInfo& vstorage, uint64_t row_cache_epoch) {
+  if (!ioptions_.row_cache) {
+    return 0;
+  }
+  Cache* row_cache = ioptions_.row_cache.get();
+  InternalKey ikey(user_key, kMaxSequenceNumber, kValueTypeForSeek);
+  IterKey row_cache_key;
+  size_t erased = 0;
+  if (last_write_filter_ != nullptr) {
+    CreateUserKeyRowCacheKeyPrefix(row_cache_epoch, row_cache_key);
+    row_cache_key.TrimAppend(row_cache_key.Size(), user_key.data(),
+                             user_key.size());
+    Cache::Handle* handle = row_cache->Lookup(row_cache_key.GetUserKey());
+    if (handle != nullptr) {
+      auto* entry = static_cast<RowCacheEntry*>(row_cache->Value(handle));
+      if (entry->read_seq < seq) {
+        entry->stale.store(true, std::memory_order_relaxed);
+        row_cache->Erase(row_cache_key.GetUserKey());
+        ++erased;
+        if (IsRowCacheTracingEnabled()) {
+          BlockCacheTraceRecord record;
+          record.block_type = TraceType::kBlockTraceRowCacheErase;
+          TraceRowCacheAccess(&record, user_key);
+        }
+      }
+      row_cache->Release(handle);
+    }
+  }
+  std::vector<FileMetaData*> files;
+  for (int level = 0; level < vstorage.num_non_empty_levels(); ++level) {
+    files.clear();
+    vstorage.GetOverlappingInputs(level, &ikey, &ikey, &files,
+                                  /*hint_index=*/-1, /*file_index=*/nullptr,
+                                  /*expand_range=*/false);
+    for (FileMetaData* file : files) {
+      if (file->fd.largest_seqno >= seq) {
+        // May already hold the write
+        continue;
+      }
+      row_cache_key.Clear();
+      row_cache_key.TrimAppend(0, row_cache_id_.data(), row_cache_id_.size());
+      AppendVarint64(&row_cache_key, file->fd.GetNumber());
+      AppendVarint64(&row_cache_key, /*seq_no=*/0);
+      row_cache_key.TrimAppend(row_cache_key.Size(), user_key.data(),
+                               user_key.size());
+      Cache::Handle* handle = row_cache->Lookup(row_cache_key.GetUserKey());
+      if (handle != nullptr) {
+        static_cast<RowCacheEntry*>(row_cache->Value(handle))
+            ->stale.store(true, std::memory_order_relaxed);
+        row_cache->Erase(row_cache_key.GetUserKey());
+        row_cache->Release(handle);
+        ++erased;
+        if (IsRowCacheTracingEnabled()) {
+          BlockCacheTraceRecord record;
+          record.block_type = TraceType::kBlockTraceRowCacheErase;
+          record.level = static_cast<uint32_t>(level);
+          record.sst_fd_number = file->fd.GetNumber();
+          TraceRowCacheAccess(&record, user_key);
+        }
+      }
+    }
+  }
+  return erased;
+}
+
+size_t TableCache::EraseRowCacheEntriesOfFiles(
+    const std::vector<uint64_t>& file_numbers) {
+  if (!ioptions_.row_cache) {
+    return 0;
+  }
+  std::vector<std::string> keys;
+  for (uint64_t file_number : file_numbers) {
+    cached_row_index_->TakeFileKeys(file_number, &keys);
+  }
+  for (const std::string& key : keys) {
+    ioptions_.row_cache->Erase(key);
+  }
+  return keys.size();
+}
+
+void TableCache::ApplyToFileRowCacheEntries(
+    Cache* row_cache,
+    const std::function<void(uint64_t row_cache_id, uint64_t file_number,
+                             const Slice& user_key, const Slice& replay_log,
+                             size_t charge)>& callback) {
+  row_cache->ApplyToAllEntries(
+      [&](const Slice& key, void* value, size_t charge,
+          Cache::DeleterFn deleter) {
+        uint64_t cache_id = 0;
+        uint64_t file_number = 0;
+        uint64_t seq_no = 0;
+        Slice user_key;
+        if (deleter != &DeleteRowCacheEntry ||
+            !ParseRowCacheKey(key, &cache_id, &file_number, &seq_no,
+                              &user_key) ||
+            file_number == 0 || seq_no != 0) {
+          return;
+        }
+        auto* entry = static_cast<RowCacheEntry*>(value);
+        if (!entry->stale.load(std::memory_order_relaxed)) {
+          callback(cache_id, file_number, user_key, entry->replay_log(),
+                   charge);
+        }
+      },
+      {});
+}
+
 // [point lookup flow 조사] - Row cache -> Block cache -> I/O 순으로 key 조회
 Status TableCache::Get(
     const ReadOptions& options,
@@ -551,7 +931,7 @@ Status TableCache::Get(
     const FileMetaData& file_meta, const Slice& k, GetContext* get_context,
     const std::shared_ptr<const SliceTransform>& prefix_extractor,
     HistogramImpl* file_read_hist, bool skip_filters, int level,
-    size_t max_file_size_for_l0_meta_pin) {
+    size_t max_file_size_for_l0_meta_pin, uint64_t row_cache_epoch) {
   auto& fd = file_meta.fd;
   std::string* row_cache_entry = nullptr;
   bool done = false;
@@ -561,59 +941,40 @@ Status TableCache::Get(
     *(options.out_row_cache_skipped_on_io) = false;
   }
 
-  auto user_key = ExtractUserKey(k);
-  KVCPKeyCtx kvcp_ctx{/*db_ptr=*/nullptr, /*cf_id=*/0, /*user_key=*/user_key};
-  uint32_t inv = 0;
-  uint32_t cnt = 0;
-  uint32_t th  = 0;
-  std::string key_hex = user_key.ToString(true);
-  uint32_t cache_invalidation_threshold = 0;
-
-  if (KVCP_IsHybridEnabled()) {
-    inv = KVCP_GetInvalidationCount(kvcp_ctx);
-    cnt = KVCP_GetCachedKeyCount(kvcp_ctx);
-    th  = KVCP_GetThreshold(/*db_ptr*/nullptr, /*cf_id*/0);
-    key_hex = user_key.ToString(true);
-  }
-
-  bool exist_in_row_cache = false;
-
 #ifndef ROCKSDB_LITE
+  auto user_key = ExtractUserKey(k);
   IterKey row_cache_key;
   std::string row_cache_entry_buffer;
+  bool by_user_key = false;
+  SequenceNumber read_seq = GetInternalKeySeqno(k);
 
   // Check row cache if enabled. Since row cache does not currently store
   // sequence numbers, we cannot use it if we need to fetch the sequence.
   // [point lookup flow 조사] - 11. Row cache hit 조회 (Row cache 활성화 시만 진행)
   // row_cache_key는 CreateRowCacheKeyPrefix()에서 row cache id, sst id, seq no를 붙인
-  // prefix임
+  // prefix임 (user key 기준 caching 시 row cache id, 0, epoch)
   if (ioptions_.row_cache && !get_context->NeedToReadSequence()) {
-    auto user_key = ExtractUserKey(k);
-    CreateRowCacheKeyPrefix(options, fd, k, get_context, row_cache_key);
-    // Row cache hit 여부 조회
-    done = GetFromRowCache(user_key, row_cache_key, row_cache_key.Size(),
-                           get_context);
-    
-    // Row cache hit 상황
-    if (done && KVCP_IsHybridEnabled()) {
-      if (const char* p = std::getenv("ROW_HIT_LOGGING"); p && p[0] == '1') {
-        //LogHybridChoice(ioptions_, "ROW_HIT", user_key, inv, th, cnt);
-        std::fprintf(stderr,
-          "[ROW_HIT] lvl=%d file=%" PRIu64
-          " key=%s inv=%u th=%u cnt=%u \n",
-          level, file_meta.fd.GetNumber(),
-          key_hex.c_str(), inv, th, cnt);
-        std::fflush(stderr);
+    by_user_key = UseUserKeyRowCacheKey(get_context);
+    if (by_user_key) {
+      CreateUserKeyRowCacheKeyPrefix(row_cache_epoch, row_cache_key);
+    } else {
+      CreateRowCacheKeyPrefix(options, fd, k, get_context, row_cache_key);
+    }
+    if (by_user_key && get_context->user_key_row_cache_missed()) {
+      // A file read earlier in this lookup missed the same row cache key
+      row_cache_key.TrimAppend(row_cache_key.Size(), user_key.data(),
+                               user_key.size());
+    } else {
+      done = GetFromRowCache(user_key, row_cache_key, row_cache_key.Size(),
+                             get_context, level, fd,
+                             TableReaderCaller::kUserGet,
+                             by_user_key ? read_seq : kMaxSequenceNumber);
+      if (by_user_key && !done) {
+        get_context->set_user_key_row_cache_missed();
       }
     }
-
-    // 만약 hash table에 key가 있으면 cached key가 invalidated 됐음을 의미
-    // Hash table 내부 invalidation_count를 1만큼 increment 수행하기
     if (!done) {
       row_cache_entry = &row_cache_entry_buffer;
-      //// 본 iteration에서 block cache hit or I/O로 target key 찾은 경우
-      //// invalidation 여부 확인용으로 활용함
-      exist_in_row_cache = (cnt > 0) ? true : false;
     }
   }
 #endif  // ROCKSDB_LITE
@@ -621,6 +982,7 @@ Status TableCache::Get(
   TableReader* t = fd.table_reader;
   Cache::Handle* handle = nullptr;
 
+  // Whether data blocks had to be read from storage (block cache miss)
   bool did_io = false;
 
   if (!done) {
@@ -648,63 +1010,13 @@ Status TableCache::Get(
             range_del_iter->MaxCoveringTombstoneSeqnum(ExtractUserKey(k)));
       }
     }
-
     if (s.ok()) {
-      // block cache hit counter (block cache 조회 전)
-      auto cs_before = get_context->get_context_stats_;
-
+      uint64_t data_read_before = get_context->get_context_stats_.num_data_read;
       get_context->SetReplayLog(row_cache_entry);  // nullptr if no cache.
-      /*
-        //// Block cache hit 조회 -> miss 시 I/O로 읽어오는 과정까지 포함
-      */
       s = t->Get(options, k, get_context, prefix_extractor.get(), skip_filters);
       get_context->SetReplayLog(nullptr);
-
-      // block cache hit counter (block cache 조회 후)
-      auto cs_after = get_context->get_context_stats_;
-
-      // I/O로 읽은 data block 수
-      uint64_t d_data_read = 0;
-      // Block cache hit 된 data block 수
-      uint64_t d_data_hit  = 0;
-      if (cs_after.num_data_read >= cs_before.num_data_read)
-        d_data_read = cs_after.num_data_read - cs_before.num_data_read;
-      if (cs_after.num_cache_data_hit >= cs_before.num_cache_data_hit)
-        d_data_hit = cs_after.num_cache_data_hit - cs_before.num_cache_data_hit;
-      
-      bool found = (get_context->State() == GetContext::GetState::kFound);
-      // 총 읽은 data block 수
-      uint64_t blocks_accessed = d_data_read + d_data_hit;
-
-      const char* verdict = nullptr;
-      if (d_data_read > 0) {
-        verdict = found ? "BC_MISS_TARGET_KEY_FOUND" : "BC_MISS_TARGET_KEY_NOT_FOUND";
-      } else if (d_data_hit > 0) {
-        verdict = found ? "BC_HIT_TARGET_KEY_FOUND" : "BC_HIT_TARGET_KEY_NOT_FOUND";
-      } else {
-        verdict = found ? "NO_BC_CHECK_TARGET_KEY_FOUND" : "NO_BC_CHECK_TARGET_KEY_NOT_FOUND";
-      }
-
-      // Data block 2개 이상 조회 시 verdict 접미사 추가
-      char verdict_buf[64];
-      if (blocks_accessed >= 2) {
-        std::snprintf(verdict_buf, sizeof(verdict_buf), "%s_MULTIBLOCK", verdict);
-        verdict = verdict_buf;
-      }
-
-      did_io = (d_data_read > 0);
-
-      if (const char* p = std::getenv("AFTER_BlOCK_CACHE_CHECK_LOGGING"); p && p[0] == '1'){
-        std::fprintf(stderr,
-          "[AFTER Block Cache Check] lvl=%d file=%" PRIu64
-          " key=%s inv=%u th=%u cnt=%u s.ok=%d d_data_read=%" PRIu64
-          " d_data_hit=%" PRIu64 " blocks=%" PRIu64 " verdict=%s\n",
-          level, file_meta.fd.GetNumber(),
-          key_hex.c_str(), inv, th, cnt,
-          s.ok() ? 1 : 0,
-          d_data_read, d_data_hit, blocks_accessed, verdict);
-        std::fflush(stderr);
-      }
+      did_io =
+          get_context->get_context_stats_.num_data_read > data_read_before;
     }
   }
 
@@ -713,104 +1025,27 @@ Status TableCache::Get(
   // [point lookup flow 조사] - 위의 t->Get()에서 Block cache 조회 및 I/O 수행한 다음
   // Row cache 활성화한 경우 row cache에도 caching 수행
   // [Hybrid 기법 위한 수정]
-  // Row cache caching -> Threshold에 따라 MemTable / Row cache 중
-  // 어디에 caching 할 지 결정
-  /*
-    1. key를 hash table에서 조회
-    2-1. hash table에 없으면
-      -> 기존 로직대로 Row cache에 caching
-    2-2. hash table에 있으면
-      -> threshold와 비교하여 MemTable / Row cache 중 어디에 caching 할 지 결정
-        -> Row cache 결정 시 기존 로직대로 Row cache에 caching
-        -> MemTable 결정 시 Row cache caching 스킵
-    3. Row cache에 caching 한 경우, caching 직후 hash table 갱신
-      -> hash table에 key가 없었던 경우는 삽입
-      -> hash table에 key가 있었던 경우는 갱신
-  */
-
-  if (KVCP_IsHybridEnabled()){
-    cache_invalidation_threshold = KVCP_GetThreshold(/*db_ptr*/nullptr, /*cf_id*/0);
+  // Row cache caching 여부는 row cache admission policy가 결정
+  // (기본 policy: invalidation count가 threshold 이상인 key는 I/O 수행 시
+  // Row cache caching 스킵 => 이후 adapter 측에서 MemTable로 migration 수행)
+  // Rows cached by user key must hold the whole lookup, finished in this file
+  if (by_user_key && !done && s.ok() && row_cache_entry &&
+      ((get_context->State() != GetContext::kFound &&
+        get_context->State() != GetContext::kDeleted) ||
+       ReplayLogHasBlobIndex(*row_cache_entry))) {
+    row_cache_entry = nullptr;
   }
-
   if (!done && s.ok() && row_cache_entry && !row_cache_entry->empty()) {
-    // Row cache miss 상황서 hash table에 해당 key 존재 하는 경우
-    if (exist_in_row_cache) {
-      // 해당 key의 hash table에서의 invalidation count 1만큼 increment
-      // 단, hash table 내 유일 & 직전 해당 key evict 시 처리하지 않음
-      bool invalidation_counting_status = KVCP_OnRowCacheInvalidation(kvcp_ctx);
-      uint32_t new_inv = KVCP_GetInvalidationCount(kvcp_ctx);
-      const char* p = std::getenv("INVALIDATION_COUNT_LOGGING");
-
-      if (invalidation_counting_status && p && p[0] == '1'){
-        if (invalidation_counting_status) {
-          std::fprintf(stderr,
-            "[INVALIDATION_COUNT_APPLIED] lvl=%d file=%" PRIu64
-            " key=%s inv=%u->%u th=%u cnt=%u\n",
-            level, file_meta.fd.GetNumber(),
-            key_hex.c_str(), inv, new_inv, th, cnt);
-          std::fflush(stderr);
-        } else {
-          std::fprintf(stderr,
-            "[INVALIDATION_COUNT_NOT_APPLIED (Removed just before)] lvl=%d file=%" PRIu64
-            " key=%s inv=%u->%u th=%u cnt=%u\n",
-            level, file_meta.fd.GetNumber(),
-            key_hex.c_str(), inv, new_inv, th, cnt);
-          std::fflush(stderr);
-        }
-      }
+    RowCacheAdmissionDecision decision =
+        MaybeInsertIntoRowCache(user_key, level, did_io, row_cache_key,
+                                row_cache_entry, read_seq);
+    if (decision == RowCacheAdmissionDecision::kRejectForMigration &&
+        options.out_row_cache_skipped_on_io) {
+      *(options.out_row_cache_skipped_on_io) = true;
     }
-
-    if (did_io && KVCP_IsHybridEnabled() && KVCP_ShouldSkipRowCacheInsert(kvcp_ctx, cache_invalidation_threshold)) {
-      // SKIP: Row cache에 넣지 않음 => 이후 adapter 측에서 migration 수행
-      if (options.out_row_cache_skipped_on_io) {
-        *(options.out_row_cache_skipped_on_io) = true;
-      }
-
-      if (const char* p = std::getenv("ROW_INSERT_SKIP_LOGGING"); p && p[0] == '1') {
-        // LogHybridChoice(ioptions_, "ROW_INSERT_SKIP -> MIGRATE", user_key, inv, th, cnt);
-        std::fprintf(stderr,
-          "[ROW_INSERT_SKIP_FOR_MIGRATION] lvl=%d file=%" PRIu64
-          " key=%s inv=%u th=%u cnt=%u\n",
-          level, file_meta.fd.GetNumber(),
-          key_hex.c_str(), inv, th, cnt);
-        std::fflush(stderr);
-      }
-    } else {
-      // (Migration X) 기존 Row cache Insert 로직
-      size_t charge = row_cache_key.Size() + row_cache_entry->size() +
-                      sizeof(RowCacheEntry);
-      auto* row_ptr = new RowCacheEntry();
-      row_ptr->value = std::move(*row_cache_entry);
-      row_ptr->info_log = ioptions_.info_log.get();
-      Env* env = ioptions_.env;
-      if (env == nullptr) {
-        env = Env::Default();
-      }
-
-      row_ptr->env = env;
-      row_ptr->insert_time_micros = env != nullptr ? env->NowMicros() : 0;
-      row_ptr->hit_count = 0;
-      // If row cache is full, it's OK to continue.
-      ioptions_.row_cache
-          ->Insert(row_cache_key.GetUserKey(), row_ptr, charge,
-                  &DeleteRowCacheEntry)
-          .PermitUncheckedError();
-
-      // [Hybrid 기법 위한 수정] - Row cache에 넣은 경우 hash table 갱신
-      if (KVCP_IsHybridEnabled()){
-        KVCP_OnRowCacheInsert(kvcp_ctx);
-        if (const char* p = std::getenv("ROW_INSERT_LOGGING"); p && p[0] == '1') {
-          uint32_t new_cnt = KVCP_GetCachedKeyCount(kvcp_ctx);
-          std::string key_hex = user_key.ToString(true);
-          // LogHybridChoice(ioptions_, "ROW_INSERT", user_key, inv, th, cnt);
-          std::fprintf(stderr,
-            "[ROW_INSERT] lvl=%d file=%" PRIu64
-            " key=%s inv=%u th=%u cnt=%u->%u\n",
-            level, file_meta.fd.GetNumber(),
-            key_hex.c_str(), inv, th, cnt, new_cnt);
-          std::fflush(stderr);
-        }
-      }
+    if (IsRowCacheTracingEnabled()) {
+      TraceRowCacheMiss(user_key, TableReaderCaller::kUserGet, level, fd,
+                        row_cache_entry->size(), did_io, decision);
     }
   }
 #endif  // ROCKSDB_LITE
@@ -827,7 +1062,8 @@ Status TableCache::MultiGet(
     const InternalKeyComparator& internal_comparator,
     const FileMetaData& file_meta, const MultiGetContext::Range* mget_range,
     const std::shared_ptr<const SliceTransform>& prefix_extractor,
-    HistogramImpl* file_read_hist, bool skip_filters, int level) {
+    HistogramImpl* file_read_hist, bool skip_filters, int level,
+    uint64_t row_cache_epoch) {
   auto& fd = file_meta.fd;
   Status s;
   TableReader* t = fd.table_reader;
@@ -836,8 +1072,15 @@ Status TableCache::MultiGet(
                             mget_range->end());
 #ifndef ROCKSDB_LITE
   autovector<std::string, MultiGetContext::MAX_BATCH_SIZE> row_cache_entries;
+  // Data blocks read by each row cache miss before the table lookup, to tell
+  // which keys needed I/O
+  autovector<uint64_t, MultiGetContext::MAX_BATCH_SIZE> data_read_before;
+  // Bit i set if row cache miss i is cached by user key
+  uint64_t by_user_key_mask = 0;
   IterKey row_cache_key;
   size_t row_cache_key_prefix_size = 0;
+  IterKey user_key_row_cache_key;
+  size_t user_key_row_cache_key_prefix_size = 0;
   KeyContext& first_key = *table_range.begin();
   bool lookup_row_cache =
       ioptions_.row_cache && !first_key.get_context->NeedToReadSequence();
@@ -849,18 +1092,98 @@ Status TableCache::MultiGet(
     CreateRowCacheKeyPrefix(options, fd, first_key.ikey, first_context,
                             row_cache_key);
     row_cache_key_prefix_size = row_cache_key.Size();
+    if (last_write_filter_ != nullptr) {
+      CreateUserKeyRowCacheKeyPrefix(row_cache_epoch, user_key_row_cache_key);
+      user_key_row_cache_key_prefix_size = user_key_row_cache_key.Size();
+    }
 
+    // Probe the row cache for the whole batch at once, so that each cache
+    // shard is hashed into and locked once per batch rather than per key
+    // Bit i set if key i of the range is cached by user key
+    uint64_t probe_by_user_key_mask = 0;
+    // Bit i set if key i already missed by user key in an earlier file
+    uint64_t probe_skip_mask = 0;
+    size_t num_probes = 0;
+    size_t probe_keys_size = 0;
     for (auto miter = table_range.begin(); miter != table_range.end();
-         ++miter) {
+         ++miter, ++num_probes) {
+      if (UseUserKeyRowCacheKey(miter->get_context)) {
+        probe_by_user_key_mask |= uint64_t{1} << num_probes;
+        if (miter->get_context->user_key_row_cache_missed()) {
+          probe_skip_mask |= uint64_t{1} << num_probes;
+        }
+        probe_keys_size += user_key_row_cache_key_prefix_size;
+      } else {
+        probe_keys_size += row_cache_key_prefix_size;
+      }
+      probe_keys_size += miter->ukey_with_ts.size();
+    }
+    // All row cache keys of the batch, back to back
+    std::string probe_keys;
+    probe_keys.reserve(probe_keys_size);
+    std::array<Slice, MultiGetContext::MAX_BATCH_SIZE> probe_slices;
+    std::array<Cache::Handle*, MultiGetContext::MAX_BATCH_SIZE> probe_handles;
+    // The probes actually looked up, and their index among all probes
+    std::array<Slice, MultiGetContext::MAX_BATCH_SIZE> lookup_slices;
+    std::array<size_t, MultiGetContext::MAX_BATCH_SIZE> lookup_idxs;
+    std::array<Cache::Handle*, MultiGetContext::MAX_BATCH_SIZE> lookup_handles;
+    size_t num_lookups = 0;
+    size_t probe_idx = 0;
+    for (auto miter = table_range.begin(); miter != table_range.end();
+         ++miter, ++probe_idx) {
+      const Slice& user_key = miter->ukey_with_ts;
+      size_t offset = probe_keys.size();
+      if ((probe_by_user_key_mask >> probe_idx) & 1) {
+        probe_keys.append(user_key_row_cache_key.GetUserKey().data(),
+                          user_key_row_cache_key_prefix_size);
+      } else {
+        probe_keys.append(row_cache_key.GetUserKey().data(),
+                          row_cache_key_prefix_size);
+      }
+      probe_keys.append(user_key.data(), user_key.size());
+      probe_slices[probe_idx] =
+          Slice(probe_keys.data() + offset, probe_keys.size() - offset);
+      probe_handles[probe_idx] = nullptr;
+      if (((probe_skip_mask >> probe_idx) & 1) == 0) {
+        lookup_slices[num_lookups] = probe_slices[probe_idx];
+        lookup_idxs[num_lookups] = probe_idx;
+        ++num_lookups;
+      }
+    }
+    ioptions_.row_cache->MultiLookup(num_lookups, lookup_slices.data(),
+                                     lookup_handles.data());
+    for (size_t i = 0; i < num_lookups; ++i) {
+      probe_handles[lookup_idxs[i]] = lookup_handles[i];
+    }
+
+    probe_idx = 0;
+    for (auto miter = table_range.begin(); miter != table_range.end();
+         ++miter, ++probe_idx) {
       const Slice& user_key = miter->ukey_with_ts;
 
       GetContext* get_context = miter->get_context;
 
-      if (GetFromRowCache(user_key, row_cache_key, row_cache_key_prefix_size,
-                          get_context)) {
+      bool key_by_user_key = (probe_by_user_key_mask >> probe_idx) & 1;
+      bool hit = false;
+      if (((probe_skip_mask >> probe_idx) & 1) == 0) {
+        hit = GetFromRowCache(
+            user_key, probe_slices[probe_idx], probe_handles[probe_idx],
+            get_context, level, fd, TableReaderCaller::kUserMultiGet,
+            key_by_user_key ? GetInternalKeySeqno(miter->ikey)
+                            : kMaxSequenceNumber);
+        if (key_by_user_key && !hit) {
+          get_context->set_user_key_row_cache_missed();
+        }
+      }
+      if (hit) {
         table_range.SkipKey(miter);
       } else {
         row_cache_entries.emplace_back();
+        data_read_before.push_back(
+            get_context->get_context_stats_.num_data_read);
+        if (key_by_user_key) {
+          by_user_key_mask |= uint64_t{1} << (row_cache_entries.size() - 1);
+        }
         get_context->SetReplayLog(&(row_cache_entries.back()));
       }
     }
@@ -912,41 +1235,89 @@ Status TableCache::MultiGet(
   }
 
 #ifndef ROCKSDB_LITE
-  if (lookup_row_cache) {
+  if (lookup_row_cache && s.ok()) {
+    // Bit i set if row cache miss i found something to insert
+    uint64_t insert_mask = 0;
     size_t row_idx = 0;
+    for (auto miter = table_range.begin(); miter != table_range.end();
+         ++miter, ++row_idx) {
+      const std::string& row_cache_entry = row_cache_entries[row_idx];
+      GetContext* get_context = miter->get_context;
+      get_context->SetReplayLog(nullptr);
+      if (row_cache_entry.empty()) {
+        // Put the replay log in row cache only if something was found.
+        continue;
+      }
+      if (((by_user_key_mask >> row_idx) & 1) &&
+          ((get_context->State() != GetContext::kFound &&
+            get_context->State() != GetContext::kDeleted) ||
+           ReplayLogHasBlobIndex(row_cache_entry))) {
+        // Lookup not finished in this file
+        continue;
+      }
+      insert_mask |= uint64_t{1} << row_idx;
+    }
+
+    // Probe the invalidation table for all rows to insert in one pass, so
+    // that the cache misses on their slots overlap
+    std::array<TableCache::KVCPLookup, MultiGetContext::MAX_BATCH_SIZE>
+        kvcp_lookups;
+    bool batched_kvcp = insert_mask != 0 && kvcp_state_->hybrid_admission();
+    if (batched_kvcp) {
+      std::array<uint64_t, MultiGetContext::MAX_BATCH_SIZE> fps;
+      std::array<KVCPLookupState, MultiGetContext::MAX_BATCH_SIZE> states;
+      size_t num_lookups = 0;
+      row_idx = 0;
+      for (auto miter = table_range.begin(); miter != table_range.end();
+           ++miter, ++row_idx) {
+        if ((insert_mask >> row_idx) & 1) {
+          fps[num_lookups++] = KVCPInvalidationTable::Fingerprint(
+              KVCPKeyCtx{/*db_ptr=*/nullptr, /*cf_id=*/0,
+                         /*user_key=*/miter->ukey_with_ts});
+        }
+      }
+      kvcp_state_->table()->GetLookupStates(fps.data(), num_lookups,
+                                            states.data());
+      for (size_t i = 0; i < num_lookups; ++i) {
+        kvcp_lookups[i] = {fps[i], states[i]};
+      }
+    }
 
+    size_t lookup_idx = 0;
+    row_idx = 0;
     for (auto miter = table_range.begin(); miter != table_range.end();
-         ++miter) {
-      std::string& row_cache_entry = row_cache_entries[row_idx++];
+         ++miter, ++row_idx) {
+      if (((insert_mask >> row_idx) & 1) == 0) {
+        continue;
+      }
+      bool key_by_user_key = (by_user_key_mask >> row_idx) & 1;
       const Slice& user_key = miter->ukey_with_ts;
-      ;
       GetContext* get_context = miter->get_context;
-
-      get_context->SetReplayLog(nullptr);
       // Compute row cache key.
-      row_cache_key.TrimAppend(row_cache_key_prefix_size, user_key.data(),
-                               user_key.size());
-      // Put the replay log in row cache only if something was found.
-      if (s.ok() && !row_cache_entry.empty()) {
-        size_t charge = row_cache_key.Size() + row_cache_entry.size() +
-                        sizeof(RowCacheEntry);
-        auto* row_ptr = new RowCacheEntry();
-        row_ptr->value = std::move(row_cache_entry);
-        row_ptr->info_log = ioptions_.info_log.get();
-        Env* env = ioptions_.env;
-        if (env == nullptr) {
-          env = Env::Default();
-        }
-        row_ptr->env = env;
-        row_ptr->insert_time_micros = env != nullptr ? env->NowMicros() : 0;
-        row_ptr->hit_count = 0;
-        // If row cache is full, it's OK.
-        ioptions_.row_cache
-            ->Insert(row_cache_key.GetUserKey(), row_ptr, charge,
-                     &DeleteRowCacheEntry)
-            .PermitUncheckedError();
+      IterKey& key = key_by_user_key ? user_key_row_cache_key : row_cache_key;
+      key.TrimAppend(key_by_user_key ? user_key_row_cache_key_prefix_size
+                                     : row_cache_key_prefix_size,
+                     user_key.data(), user_key.size());
+      bool did_io = get_context->get_context_stats_.num_data_read >
+                    data_read_before[row_idx];
+      RowCacheAdmissionDecision decision = MaybeInsertIntoRowCache(
+          user_key, level, did_io, key, &row_cache_entries[row_idx],
+          GetInternalKeySeqno(miter->ikey),
+          batched_kvcp ? &kvcp_lookups[lookup_idx] : nullptr);
+      ++lookup_idx;
+      if (decision == RowCacheAdmissionDecision::kRejectForMigration) {
+        miter->row_cache_skipped_on_io = true;
+      }
+      if (IsRowCacheTracingEnabled()) {
+        TraceRowCacheMiss(user_key, TableReaderCaller::kUserMultiGet, level, fd,
+                          row_cache_entries[row_idx].size(), did_io, decision);
       }
     }
+  } else if (lookup_row_cache) {
+    for (auto miter = table_range.begin(); miter != table_range.end();
+         ++miter) {
+      miter->get_context->SetReplayLog(nullptr);
+    }
   }
 #endif  // ROCKSDB_LITE
 
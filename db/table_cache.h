@@ -11,16 +11,20 @@
 
 #pragma once
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "db/dbformat.h"
+#include "db/kv_cache_policy.h"
 #include "db/range_del_aggregator.h"
+#include "db/row_cache_invalidator.h"
 #include "options/cf_options.h"
 #include "port/port.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/env.h"
 #include "rocksdb/options.h"
+#include "rocksdb/row_cache_admission_policy.h"
 #include "rocksdb/table.h"
 #include "table/table_reader.h"
 #include "trace_replay/block_cache_tracer.h"
@@ -32,6 +36,7 @@ class Arena;
 struct FileDescriptor;
 class GetContext;
 class HistogramImpl;
+class VersionStorageInfo;
 
 // Manages caching for TableReader objects for a column family. The actual
 // cache is allocated separately and passed to the constructor. TableCache
@@ -90,13 +95,16 @@ class TableCache {
   //                       recorded
   // @param skip_filters Disables loading/accessing the filter block
   // @param level The level this table is at, -1 for "not set / don't know"
+  // @param row_cache_epoch Version::GetRowCacheEpoch() of the version the
+  //                        file is read from
   Status Get(
       const ReadOptions& options,
       const InternalKeyComparator& internal_comparator,
       const FileMetaData& file_meta, const Slice& k, GetContext* get_context,
       const std::shared_ptr<const SliceTransform>& prefix_extractor = nullptr,
       HistogramImpl* file_read_hist = nullptr, bool skip_filters = false,
-      int level = -1, size_t max_file_size_for_l0_meta_pin = 0);
+      int level = -1, size_t max_file_size_for_l0_meta_pin = 0,
+      uint64_t row_cache_epoch = 0);
 
   // Return the range delete tombstone iterator of the file specified by
   // `file_meta`.
@@ -121,7 +129,7 @@ class TableCache {
       const FileMetaData& file_meta, const MultiGetContext::Range* mget_range,
       const std::shared_ptr<const SliceTransform>& prefix_extractor = nullptr,
       HistogramImpl* file_read_hist = nullptr, bool skip_filters = false,
-      int level = -1);
+      int level = -1, uint64_t row_cache_epoch = 0);
 
   // Evict any entry for the specified file number
   static void Evict(Cache* cache, uint64_t file_number);
@@ -191,6 +199,79 @@ class TableCache {
 
   Cache* get_cache() const { return cache_; }
 
+  // Applies the row cache hybrid admission options of the column family.
+  // No-op without a row cache.
+  // REQUIRES: DB mutex held (or single-threaded construction)
+  void SetRowCacheAdmissionOptions(bool hybrid_admission,
+                                   uint32_t invalidation_threshold) {
+    if (kvcp_state_) {
+      kvcp_state_->SetOptions(hybrid_admission, invalidation_threshold);
+    }
+  }
+
+  // Row cache hybrid admission state, nullptr without a row cache
+  KVCPState* kvcp_state() const { return kvcp_state_.get(); }
+
+  // Column family reported in block cache traces of row cache accesses.
+  void SetTraceColumnFamily(uint32_t cf_id, const std::string& cf_name) {
+    trace_cf_id_ = cf_id;
+    trace_cf_name_ = cf_name;
+  }
+
+  // Traces a write of user_key, which makes its row cache entries stale, if
+  // block cache tracing is enabled.
+  void TraceRowCacheWrite(const Slice& user_key) const;
+
+  // Row cache entries of the column family, nullptr without a row cache
+  CachedRowIndex* cached_row_index() const { return cached_row_index_.get(); }
+
+  // Erases the row cache entries of the given table files, as found in
+  // cached_row_index(). Returns the number of entries erased.
+  size_t EraseRowCacheEntriesOfFiles(const std::vector<uint64_t>& file_numbers);
+
+  // Last writes of the keys of the column family, nullptr unless rows are
+  // cached by user key (DBOptions::row_cache_key_by_user_key)
+  LastWriteSeqnoFilter* last_write_filter() const {
+    return last_write_filter_.get();
+  }
+
+  // Rows cached by user key are only valid for versions created in the
+  // epoch they were read in. The epoch is advanced by VersionSet when it
+  // applies a VersionEdit marked with MarkInvalidatesRowCache().
+  // REQUIRES: DB mutex held
+  uint64_t row_cache_epoch() const { return row_cache_epoch_; }
+  void AdvanceRowCacheEpoch() { ++row_cache_epoch_; }
+
+  // Erases the row cache entries of user_key that a write at sequence seq
+  // made stale, i.e. those of the files in vstorage that may contain the key
+  // and only hold older sequence numbers, and the entry cached by user key
+  // in row_cache_epoch if read before seq. Entries cached for snapshot reads
+  // are left to LRU eviction. Returns the number of entries erased.
+  size_t EraseStaleRowCacheEntries(const Slice& user_key, SequenceNumber seq,
+                                   const VersionStorageInfo& vstorage,
+                                   uint64_t row_cache_epoch);
+
+  // Identifies the entries of this TableCache in the row cache, 0 without a
+  // row cache.
+  uint64_t row_cache_id() const { return row_cache_id_num_; }
+
+  // Calls callback with each row cache entry cached by table file for reads
+  // without a snapshot, which stays valid as long as the file does. Entries
+  // cached by user key or for snapshot reads are skipped. Scans the whole row
+  // cache, calling back under its shard locks.
+  static void ApplyToFileRowCacheEntries(
+      Cache* row_cache,
+      const std::function<void(uint64_t row_cache_id, uint64_t file_number,
+                               const Slice& user_key, const Slice& replay_log,
+                               size_t charge)>& callback);
+
+  // Puts back the row cache entry of user_key in table file file_number,
+  // as returned by ApplyToFileRowCacheEntries() before a restart, bypassing
+  // the admission policy. Returns the charge of the entry, 0 without a row
+  // cache.
+  size_t RestoreRowCacheEntry(uint64_t file_number, const Slice& user_key,
+                              const Slice& replay_log);
+
   // Capacity of the backing Cache that indicates infinite TableCache capacity.
   // For example when max_open_files is -1 we set the backing Cache to this.
   static const int kInfiniteCapacity = 0x400000;
@@ -224,17 +305,87 @@ class TableCache {
                                const Slice& internal_key,
                                GetContext* get_context, IterKey& row_cache_key);
 
+  // Whether the row read through get_context can be cached by user key:
+  // nothing has been found for it in newer data, not even merge operands or
+  // range tombstones.
+  bool UseUserKeyRowCacheKey(GetContext* get_context) const;
+
+  // Create a key prefix for rows cached by user key, of the format
+  // row_cache_id + 0 + row_cache_epoch. The zero file number tells them
+  // apart from rows cached by file.
+  void CreateUserKeyRowCacheKeyPrefix(uint64_t row_cache_epoch,
+                                      IterKey& row_cache_key) const;
+
   // Helper function to lookup the row cache for a key. It appends the
-  // user key to row_cache_key at offset prefix_size
+  // user key to row_cache_key at offset prefix_size. For rows cached by user
+  // key, read_seq is the sequence number of the lookup; others pass
+  // kMaxSequenceNumber.
+  // fd and caller are only used for tracing.
   bool GetFromRowCache(const Slice& user_key, IterKey& row_cache_key,
-                       size_t prefix_size, GetContext* get_context);
+                       size_t prefix_size, GetContext* get_context, int level,
+                       const FileDescriptor& fd, TableReaderCaller caller,
+                       SequenceNumber read_seq = kMaxSequenceNumber);
+  // Like above, for row_cache_key already looked up by the caller.
+  // row_handle is the result of the lookup, released by the callee.
+  bool GetFromRowCache(const Slice& user_key, const Slice& row_cache_key,
+                       Cache::Handle* row_handle, GetContext* get_context,
+                       int level, const FileDescriptor& fd,
+                       TableReaderCaller caller, SequenceNumber read_seq);
+
+  // Helper function to insert a row read from a table file after a row cache
+  // miss, if the row cache admission policy admits it. row_cache_key must be
+  // the full key of the row and row_cache_entry its replay log, copied into
+  // the cache entry if admitted. read_seq is the sequence number the row was
+  // read at. With hybrid admission, kvcp_lookup may give the fingerprint of
+  // user_key and its tracking state, probed in advance by the caller.
+  struct KVCPLookup {
+    uint64_t fp;
+    KVCPLookupState state;
+  };
+  RowCacheAdmissionDecision MaybeInsertIntoRowCache(
+      const Slice& user_key, int level, bool read_from_storage,
+      const IterKey& row_cache_key, std::string* row_cache_entry,
+      SequenceNumber read_seq, const KVCPLookup* kvcp_lookup = nullptr);
+
+  // Builds a row cache entry holding replay_log and inserts it under key.
+  // kvcp_table is the hybrid admission table to track it in, or nullptr.
+  // Returns the charge of the entry.
+  size_t InsertRowCacheEntry(const Slice& key, const Slice& replay_log,
+                             SequenceNumber read_seq,
+                             KVCPInvalidationTable* kvcp_table,
+                             uint64_t kvcp_fp);
+
+  bool IsRowCacheTracingEnabled() const {
+    return block_cache_tracer_ != nullptr &&
+           block_cache_tracer_->is_tracing_enabled();
+  }
+
+  // Writes a row cache access record of user_key, whose fields specific to
+  // the access are already set, to the block cache trace.
+  void TraceRowCacheAccess(BlockCacheTraceRecord* record,
+                           const Slice& user_key) const;
+
+  // Traces a row cache lookup that missed and found a row of row_size bytes
+  // in the table file fd, with the admission decision taken for it.
+  void TraceRowCacheMiss(const Slice& user_key, TableReaderCaller caller,
+                         int level, const FileDescriptor& fd, size_t row_size,
+                         bool read_from_storage,
+                         RowCacheAdmissionDecision decision) const;
 
   const ImmutableOptions& ioptions_;
   const FileOptions& file_options_;
   Cache* const cache_;
   std::string row_cache_id_;
+  uint64_t row_cache_id_num_;
+  std::shared_ptr<KVCPState> kvcp_state_;
+  std::shared_ptr<RowCacheAdmissionPolicy> row_cache_admission_policy_;
+  std::unique_ptr<LastWriteSeqnoFilter> last_write_filter_;
+  std::shared_ptr<CachedRowIndex> cached_row_index_;
+  uint64_t row_cache_epoch_;
   bool immortal_tables_;
   BlockCacheTracer* const block_cache_tracer_;
+  uint32_t trace_cf_id_;
+  std::string trace_cf_name_;
   Striped<port::Mutex, Slice> loader_mutex_;
   std::shared_ptr<IOTracer> io_tracer_;
   std::string db_session_id_;
@@ -555,6 +555,12 @@ class VersionEdit {
   bool IsInAtomicGroup() const { return is_in_atomic_group_; }
   uint32_t GetRemainingEntries() const { return remaining_entries_; }
 
+  // Marks an edit that may change the values of keys without a write
+  // through the memtable, e.g. file ingestion or deletion, so that rows cached
+  // by user key are not used with the versions it creates. Not persisted.
+  void MarkInvalidatesRowCache() { invalidates_row_cache_ = true; }
+  bool InvalidatesRowCache() const { return invalidates_row_cache_; }
+
   bool HasFullHistoryTsLow() const { return !full_history_ts_low_.empty(); }
   const std::string& GetFullHistoryTsLow() const {
     assert(HasFullHistoryTsLow());
@@ -628,6 +634,8 @@ class VersionEdit {
   bool is_in_atomic_group_ = false;
   uint32_t remaining_entries_ = 0;
 
+  bool invalidates_row_cache_ = false;
+
   std::string full_history_ts_low_;
 };
 
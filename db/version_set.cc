@@ -1793,6 +1793,7 @@ Version::Version(ColumnFamilyData* column_family_data, VersionSet* vset,
       max_file_size_for_l0_meta_pin_(
           MaxFileSizeForL0MetaPin(mutable_cf_options_)),
       version_number_(version_number),
+      row_cache_epoch_(table_cache_ ? table_cache_->row_cache_epoch() : 0),
       io_tracer_(io_tracer) {}
 
 Status Version::GetBlob(const ReadOptions& read_options, const Slice& user_key,
@@ -2041,7 +2042,8 @@ void Version::Get(const ReadOptions& read_options, const LookupKey& k,
         cfd_->internal_stats()->GetFileReadHist(fp.GetHitFileLevel()),
         IsFilterSkipped(static_cast<int>(fp.GetHitFileLevel()),
                         fp.IsHitFileLastInLevel()),
-        fp.GetHitFileLevel(), max_file_size_for_l0_meta_pin_);
+        fp.GetHitFileLevel(), max_file_size_for_l0_meta_pin_,
+        row_cache_epoch_);
     //status->SetLastLevel(fp.GetEffectiveCurrentLevel());
     status->SetLastLevel(file_read_cnt++);
     // TODO: examine the behavior for corrupted key
@@ -2232,7 +2234,7 @@ void Version::MultiGet(const ReadOptions& read_options, MultiGetRange* range,
         cfd_->internal_stats()->GetFileReadHist(fp.GetHitFileLevel()),
         IsFilterSkipped(static_cast<int>(fp.GetHitFileLevel()),
                         fp.IsHitFileLastInLevel()),
-        fp.GetHitFileLevel());
+        fp.GetHitFileLevel(), row_cache_epoch_);
     // TODO: examine the behavior for corrupted key
     if (timer_enabled) {
       PERF_COUNTER_BY_LEVEL_ADD(get_from_table_nanos, timer.ElapsedNanos(),
@@ -4320,6 +4322,12 @@ Status VersionSet::ProcessManifestWrites(
           }
           return s;
         }
+        if (e->InvalidatesRowCache() && version != nullptr) {
+          // Versions created from now on include the edit
+          TableCache* table_cache = last_writer->cfd->table_cache();
+          table_cache->AdvanceRowCacheEpoch();
+          version->row_cache_epoch_ = table_cache->row_cache_epoch();
+        }
         batch_edits.push_back(e);
       }
     }
@@ -792,6 +792,11 @@ class Version {
   // Returns the version number of this version
   uint64_t GetVersionNumber() const { return version_number_; }
 
+  // The TableCache::row_cache_epoch() this version was created in; rows
+  // cached by user key while reading it are only valid for versions of the
+  // same epoch
+  uint64_t GetRowCacheEpoch() const { return row_cache_epoch_; }
+
   // REQUIRES: lock is held
   // On success, "tp" will contains the table properties of the file
   // specified in "file_meta".  If the file name of "file_meta" is
@@ -900,6 +905,7 @@ class Version {
   // A version number that uniquely represents this version. This is
   // used for debugging and logging purposes only.
   uint64_t version_number_;
+  uint64_t row_cache_epoch_;
   std::shared_ptr<IOTracer> io_tracer_;
 
   Version(ColumnFamilyData* cfd, VersionSet* vset, const FileOptions& file_opt,
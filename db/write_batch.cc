@@ -35,6 +35,7 @@
 
 #include "rocksdb/write_batch.h"
 
+#include <algorithm>
 #include <map>
 #include <stack>
 #include <stdexcept>
@@ -151,6 +152,65 @@ struct SavePoints {
   std::stack<SavePoint, autovector<SavePoint>> stack;
 };
 
+struct ValueRefs {
+  struct Value {
+    // Offset in rep_ of the length of the empty value standing for it
+    size_t offset;
+    uint32_t size;
+    // Range in `parts`
+    size_t first_part;
+    size_t num_parts;
+  };
+
+  // Bytes the value adds to the batch, over its empty value
+  static size_t ExtraBytes(const Value& v) {
+    return VarintLength(v.size) - 1 + v.size;
+  }
+
+  void Add(size_t offset, const SliceParts& value) {
+    Value v;
+    v.offset = offset;
+    v.size = 0;
+    v.first_part = parts.size();
+    v.num_parts = static_cast<size_t>(value.num_parts);
+    for (int i = 0; i < value.num_parts; ++i) {
+      v.size += static_cast<uint32_t>(value.parts[i].size());
+      parts.push_back(value.parts[i]);
+    }
+    assert(values.empty() || values.back().offset < offset);
+    values.push_back(v);
+    extra_bytes += ExtraBytes(v);
+  }
+
+  // Returns the value whose empty value is `value` of rep_, or nullptr
+  const Value* Find(const std::string& rep, const Slice& value) const {
+    if (!value.empty()) {
+      return nullptr;
+    }
+    size_t offset = static_cast<size_t>(value.data() - rep.data()) - 1;
+    auto it = std::lower_bound(
+        values.begin(), values.end(), offset,
+        [](const Value& v, size_t off) { return v.offset < off; });
+    return (it != values.end() && it->offset == offset) ? &*it : nullptr;
+  }
+
+  // Returns the size rep_ of `rep_size` bytes has with the values copied in
+  size_t SizeWithValues(size_t rep_size) const {
+    size_t size = rep_size;
+    for (const Value& v : values) {
+      if (v.offset >= rep_size) {
+        break;
+      }
+      size += ExtraBytes(v);
+    }
+    return size;
+  }
+
+  std::vector<Value> values;  // in order of offset
+  std::vector<Slice> parts;
+  size_t extra_bytes = 0;
+};
+
 WriteBatch::WriteBatch(size_t reserved_bytes, size_t max_bytes)
     : content_flags_(0), max_bytes_(max_bytes), rep_() {
   rep_.reserve((reserved_bytes > WriteBatchInternal::kHeader)
@@ -191,6 +251,9 @@ WriteBatch::WriteBatch(const WriteBatch& src)
       max_bytes_(src.max_bytes_),
       default_cf_ts_sz_(src.default_cf_ts_sz_),
       rep_(src.rep_) {
+  if (src.value_refs_ != nullptr) {
+    value_refs_.reset(new ValueRefs(*src.value_refs_));
+  }
   if (src.save_points_ != nullptr) {
     save_points_.reset(new SavePoints());
     save_points_->stack = src.save_points_->stack;
@@ -207,6 +270,7 @@ WriteBatch::WriteBatch(WriteBatch&& src) noexcept
       content_flags_(src.content_flags_.load(std::memory_order_relaxed)),
       max_bytes_(src.max_bytes_),
       prot_info_(std::move(src.prot_info_)),
+      value_refs_(std::move(src.value_refs_)),
       default_cf_ts_sz_(src.default_cf_ts_sz_),
       rep_(std::move(src.rep_)) {}
 
@@ -242,6 +306,7 @@ bool WriteBatch::Handler::Continue() {
 void WriteBatch::Clear() {
   rep_.clear();
   rep_.resize(WriteBatchInternal::kHeader);
+  value_refs_.reset();
 
   content_flags_.store(0, std::memory_order_relaxed);
 
@@ -258,6 +323,19 @@ void WriteBatch::Clear() {
   default_cf_ts_sz_ = 0;
 }
 
+const std::string& WriteBatch::Data() const {
+  if (value_refs_ != nullptr) {
+    // Like content_flags_, this does not change the abstract state of the
+    // batch
+    WriteBatchInternal::CopyInValueRefs(const_cast<WriteBatch*>(this));
+  }
+  return rep_;
+}
+
+size_t WriteBatch::GetDataSize() const {
+  return rep_.size() + (value_refs_ != nullptr ? value_refs_->extra_bytes : 0);
+}
+
 uint32_t WriteBatch::Count() const { return WriteBatchInternal::Count(this); }
 
 uint32_t WriteBatch::ComputeContentFlags() const {
@@ -278,7 +356,7 @@ uint32_t WriteBatch::ComputeContentFlags() const {
 }
 
 void WriteBatch::MarkWalTerminationPoint() {
-  wal_term_point_.size = GetDataSize();
+  wal_term_point_.size = rep_.size();
   wal_term_point_.count = Count();
   wal_term_point_.content_flags = content_flags_;
 }
@@ -480,6 +558,8 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
   uint32_t column_family = 0;  // default
   bool last_was_try_again = false;
   bool handler_continue = true;
+  // For the referenced values in more than one part
+  std::string value_buf;
   while (((s.ok() && !input.empty()) || UNLIKELY(s.IsTryAgain()))) {
     handler_continue = handler->Continue();
     if (!handler_continue) {
@@ -496,6 +576,22 @@ Status WriteBatchInternal::Iterate(const WriteBatch* wb,
       if (!s.ok()) {
         return s;
       }
+      if (UNLIKELY(wb->value_refs_ != nullptr) &&
+          (tag == kTypeValue || tag == kTypeColumnFamilyValue)) {
+        const ValueRefs::Value* ref = wb->value_refs_->Find(wb->rep_, value);
+        if (ref != nullptr) {
+          const Slice* parts = wb->value_refs_->parts.data() + ref->first_part;
+          if (ref->num_parts == 1) {
+            value = parts[0];
+          } else {
+            value_buf.clear();
+            for (size_t i = 0; i < ref->num_parts; ++i) {
+              value_buf.append(parts[i].data(), parts[i].size());
+            }
+            value = value_buf;
+          }
+        }
+      }
     } else {
       assert(s.IsTryAgain());
       assert(!last_was_try_again);  // to detect infinite loop bugs
@@ -686,6 +782,14 @@ void WriteBatchInternal::SetAsLatestPersistentState(WriteBatch* b) {
   b->is_latest_persistent_state_ = true;
 }
 
+bool WriteBatchInternal::IsRowCacheMigration(const WriteBatch* b) {
+  return b->is_row_cache_migration_;
+}
+
+void WriteBatchInternal::SetAsRowCacheMigration(WriteBatch* b) {
+  b->is_row_cache_migration_ = true;
+}
+
 uint32_t WriteBatchInternal::Count(const WriteBatch* b) {
   return DecodeFixed32(b->rep_.data() + 8);
 }
@@ -893,6 +997,146 @@ Status WriteBatch::Put(ColumnFamilyHandle* column_family, const SliceParts& key,
       "Cannot call this method on column family enabling timestamp");
 }
 
+Status WriteBatchInternal::PutReference(WriteBatch* b,
+                                        uint32_t column_family_id,
+                                        const Slice& key,
+                                        const SliceParts& value) {
+  SliceParts key_parts(&key, 1);
+  Status s = CheckSlicePartsLength(key_parts, value);
+  if (!s.ok()) {
+    return s;
+  }
+
+  LocalSavePoint save(b);
+  WriteBatchInternal::SetCount(b, WriteBatchInternal::Count(b) + 1);
+  if (column_family_id == 0) {
+    b->rep_.push_back(static_cast<char>(kTypeValue));
+  } else {
+    b->rep_.push_back(static_cast<char>(kTypeColumnFamilyValue));
+    PutVarint32(&b->rep_, column_family_id);
+  }
+  PutLengthPrefixedSlice(&b->rep_, key);
+  // An empty value stands for the referenced one
+  if (b->value_refs_ == nullptr) {
+    b->value_refs_.reset(new ValueRefs());
+  }
+  b->value_refs_->Add(b->rep_.size(), value);
+  PutVarint32(&b->rep_, 0);
+  b->content_flags_.store(
+      b->content_flags_.load(std::memory_order_relaxed) | ContentFlags::HAS_PUT,
+      std::memory_order_relaxed);
+  if (b->prot_info_ != nullptr) {
+    // See comment in first `WriteBatchInternal::Put()` overload concerning the
+    // `ValueType` argument passed to `ProtectKVO()`.
+    b->prot_info_->entries_.emplace_back(
+        ProtectionInfo64()
+            .ProtectKVO(key_parts, value, kTypeValue)
+            .ProtectC(column_family_id));
+  }
+  return save.commit();
+}
+
+Status WriteBatch::PutReference(ColumnFamilyHandle* column_family,
+                                const Slice& key, const SliceParts& value) {
+  size_t ts_sz = 0;
+  uint32_t cf_id = 0;
+  Status s;
+
+  std::tie(s, cf_id, ts_sz) =
+      WriteBatchInternal::GetColumnFamilyIdAndTimestampSize(this,
+                                                            column_family);
+
+  if (!s.ok()) {
+    return s;
+  }
+
+  if (ts_sz == 0) {
+    return WriteBatchInternal::PutReference(this, cf_id, key, value);
+  }
+
+  return Status::InvalidArgument(
+      "Cannot call this method on column family enabling timestamp");
+}
+
+void WriteBatchInternal::GetContentsParts(const WriteBatch* b,
+                                          std::vector<Slice>* parts,
+                                          std::string* scratch) {
+  parts->clear();
+  scratch->clear();
+  if (b->value_refs_ == nullptr) {
+    parts->emplace_back(b->rep_);
+    return;
+  }
+  const ValueRefs& refs = *b->value_refs_;
+  // Not to move the lengths already in `parts`; a varint32 takes up to five
+  // bytes
+  scratch->reserve(refs.values.size() * 5);
+  size_t pos = 0;
+  for (const ValueRefs::Value& v : refs.values) {
+    parts->emplace_back(b->rep_.data() + pos, v.offset - pos);
+    size_t length_pos = scratch->size();
+    PutVarint32(scratch, v.size);
+    parts->emplace_back(scratch->data() + length_pos,
+                        scratch->size() - length_pos);
+    parts->insert(parts->end(), refs.parts.begin() + v.first_part,
+                  refs.parts.begin() + v.first_part + v.num_parts);
+    // Past the empty value
+    pos = v.offset + 1;
+  }
+  parts->emplace_back(b->rep_.data() + pos, b->rep_.size() - pos);
+}
+
+void WriteBatchInternal::CopyInValueRefs(WriteBatch* b) {
+  if (b->value_refs_ == nullptr) {
+    return;
+  }
+  std::unique_ptr<ValueRefs> refs = std::move(b->value_refs_);
+  std::string rep;
+  rep.reserve(b->rep_.size() + refs->extra_bytes);
+  size_t pos = 0;
+  for (const ValueRefs::Value& v : refs->values) {
+    rep.append(b->rep_, pos, v.offset - pos);
+    PutVarint32(&rep, v.size);
+    for (size_t i = v.first_part; i < v.first_part + v.num_parts; ++i) {
+      rep.append(refs->parts[i].data(), refs->parts[i].size());
+    }
+    pos = v.offset + 1;
+  }
+  rep.append(b->rep_, pos, std::string::npos);
+
+  // The save points move with the records
+  if (b->save_points_ != nullptr && !b->save_points_->stack.empty()) {
+    autovector<SavePoint> save_points;
+    while (!b->save_points_->stack.empty()) {
+      save_points.push_back(b->save_points_->stack.top());
+      b->save_points_->stack.pop();
+    }
+    for (auto it = save_points.rbegin(); it != save_points.rend(); ++it) {
+      it->size = refs->SizeWithValues(it->size);
+      b->save_points_->stack.push(*it);
+    }
+  }
+  if (!b->wal_term_point_.is_cleared()) {
+    b->wal_term_point_.size = refs->SizeWithValues(b->wal_term_point_.size);
+  }
+  b->rep_.swap(rep);
+}
+
+void WriteBatchInternal::TruncateValueRefs(WriteBatch* b, size_t rep_size) {
+  ValueRefs* refs = b->value_refs_.get();
+  if (refs == nullptr) {
+    return;
+  }
+  while (!refs->values.empty() && refs->values.back().offset >= rep_size) {
+    refs->extra_bytes -= ValueRefs::ExtraBytes(refs->values.back());
+    refs->parts.resize(refs->values.back().first_part);
+    refs->values.pop_back();
+  }
+  if (refs->values.empty()) {
+    b->value_refs_.reset();
+  }
+}
+
 Status WriteBatchInternal::InsertNoop(WriteBatch* b) {
   b->rep_.push_back(static_cast<char>(kTypeNoop));
   return Status::OK();
@@ -1439,7 +1683,7 @@ void WriteBatch::SetSavePoint() {
   }
   // Record length and count of current batch of writes.
   save_points_->stack.push(SavePoint(
-      GetDataSize(), Count(), content_flags_.load(std::memory_order_relaxed)));
+      rep_.size(), Count(), content_flags_.load(std::memory_order_relaxed)));
 }
 
 Status WriteBatch::RollbackToSavePoint() {
@@ -1461,6 +1705,7 @@ Status WriteBatch::RollbackToSavePoint() {
     Clear();
   } else {
     rep_.resize(savepoint.size);
+    WriteBatchInternal::TruncateValueRefs(this, savepoint.size);
     if (prot_info_ != nullptr) {
       prot_info_->entries_.resize(savepoint.count);
     }
@@ -1504,6 +1749,10 @@ class MemTableInserter : public WriteBatch::Handler {
   // log number that all Memtables inserted into should reference
   uint64_t log_number_ref_;
   DBImpl* db_;
+  RowCacheInvalidator* const row_cache_invalidator_;
+  // The batch being inserted only copies rows already in the DB, so its keys
+  // are not reported to row_cache_invalidator_.
+  bool row_cache_migration_ = false;
   const bool concurrent_memtable_writes_;
   bool       post_info_created_;
   const WriteBatch::ProtectionInfo* prot_info_;
@@ -1603,6 +1852,8 @@ class MemTableInserter : public WriteBatch::Handler {
         recovering_log_number_(recovering_log_number),
         log_number_ref_(0),
         db_(static_cast_with_check<DBImpl>(db)),
+        row_cache_invalidator_(db_ != nullptr ? db_->row_cache_invalidator()
+                                              : nullptr),
         concurrent_memtable_writes_(concurrent_memtable_writes),
         post_info_created_(false),
         prot_info_(prot_info),
@@ -1669,6 +1920,10 @@ class MemTableInserter : public WriteBatch::Handler {
     prot_info_idx_ = 0;
   }
 
+  void set_row_cache_migration(bool row_cache_migration) {
+    row_cache_migration_ = row_cache_migration;
+  }
+
   SequenceNumber sequence() const { return sequence_; }
 
   void PostProcess() {
@@ -1850,6 +2105,7 @@ class MemTableInserter : public WriteBatch::Handler {
       const bool kBatchBoundary = true;
       MaybeAdvanceSeq(kBatchBoundary);
     } else if (ret_status.ok()) {
+      MaybeInvalidateRowCache(key, value_type);
       MaybeAdvanceSeq();
       CheckMemtableFull();
     }
@@ -1895,6 +2151,7 @@ class MemTableInserter : public WriteBatch::Handler {
       const bool kBatchBoundary = true;
       MaybeAdvanceSeq(kBatchBoundary);
     } else if (ret_status.ok()) {
+      MaybeInvalidateRowCache(key, delete_type);
       MaybeAdvanceSeq();
       CheckMemtableFull();
     }
@@ -2227,6 +2484,7 @@ class MemTableInserter : public WriteBatch::Handler {
       const bool kBatchBoundary = true;
       MaybeAdvanceSeq(kBatchBoundary);
     } else if (ret_status.ok()) {
+      MaybeInvalidateRowCache(key, kTypeMerge);
       MaybeAdvanceSeq();
       CheckMemtableFull();
     }
@@ -2260,6 +2518,23 @@ class MemTableInserter : public WriteBatch::Handler {
     }
   }
 
+  // Lets the row cache invalidator know of a write to key, or to all keys
+  // for a range deletion. Must be called before sequence_ is advanced past
+  // the write.
+  void MaybeInvalidateRowCache(const Slice& key, ValueType type) {
+    if (row_cache_invalidator_ != nullptr && !row_cache_migration_) {
+      ColumnFamilyData* cfd = cf_mems_->current();
+      if (cfd == nullptr) {
+        return;
+      }
+      if (type == kTypeRangeDeletion) {
+        row_cache_invalidator_->OnAllKeysWritten(cfd, sequence_);
+      } else {
+        row_cache_invalidator_->OnKeyWritten(cfd, key, sequence_);
+      }
+    }
+  }
+
   void CheckMemtableFull() {
     if (flush_scheduler_ != nullptr) {
       auto* cfd = cf_mems_->current();
@@ -2551,6 +2826,7 @@ Status WriteBatchInternal::InsertInto(
     SetSequence(w->batch, inserter.sequence());
     inserter.set_log_number_ref(w->log_ref);
     inserter.set_prot_info(w->batch->prot_info_.get());
+    inserter.set_row_cache_migration(w->batch->is_row_cache_migration_);
     w->status = w->batch->Iterate(&inserter);
     if (!w->status.ok()) {
       return w->status;
@@ -2581,6 +2857,7 @@ Status WriteBatchInternal::InsertInto(
   SetSequence(writer->batch, sequence);
   inserter.set_log_number_ref(writer->log_ref);
   inserter.set_prot_info(writer->batch->prot_info_.get());
+  inserter.set_row_cache_migration(writer->batch->is_row_cache_migration_);
   Status s = writer->batch->Iterate(&inserter);
   assert(!seq_per_batch || batch_cnt != 0);
   assert(!seq_per_batch || inserter.sequence() - sequence == batch_cnt);
@@ -2602,6 +2879,7 @@ Status WriteBatchInternal::InsertInto(
                             ignore_missing_column_families, log_number, db,
                             concurrent_memtable_writes, batch->prot_info_.get(),
                             has_valid_writes, seq_per_batch, batch_per_txn);
+  inserter.set_row_cache_migration(batch->is_row_cache_migration_);
   Status s = batch->Iterate(&inserter);
   if (next_seq != nullptr) {
     *next_seq = inserter.sequence();
@@ -2616,6 +2894,7 @@ Status WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= WriteBatchInternal::kHeader);
   assert(b->prot_info_ == nullptr);
   b->rep_.assign(contents.data(), contents.size());
+  b->value_refs_.reset();
   b->content_flags_.store(ContentFlags::DEFERRED, std::memory_order_relaxed);
   return Status::OK();
 }
@@ -2649,7 +2928,23 @@ Status WriteBatchInternal::Append(WriteBatch* dst, const WriteBatch* src,
   }
   SetCount(dst, Count(dst) + src_count);
   assert(src->rep_.size() >= WriteBatchInternal::kHeader);
+  const size_t dst_len = dst->rep_.size();
   dst->rep_.append(src->rep_.data() + WriteBatchInternal::kHeader, src_len);
+  if (src->value_refs_ != nullptr) {
+    // The references are appended too, for the values to be copied once
+    for (const ValueRefs::Value& v : src->value_refs_->values) {
+      if (v.offset >= WriteBatchInternal::kHeader + src_len) {
+        break;
+      }
+      if (dst->value_refs_ == nullptr) {
+        dst->value_refs_.reset(new ValueRefs());
+      }
+      dst->value_refs_->Add(
+          dst_len + v.offset - WriteBatchInternal::kHeader,
+          SliceParts(src->value_refs_->parts.data() + v.first_part,
+                     static_cast<int>(v.num_parts)));
+    }
+  }
   dst->content_flags_.store(
       dst->content_flags_.load(std::memory_order_relaxed) | src_flags,
       std::memory_order_relaxed);
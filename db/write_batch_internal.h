@@ -147,13 +147,37 @@ class WriteBatchInternal {
   static size_t GetFirstOffset(WriteBatch* batch);
 
   static Slice Contents(const WriteBatch* batch) {
+    assert(!HasValueRefs(batch));
     return Slice(batch->rep_);
   }
 
   static size_t ByteSize(const WriteBatch* batch) {
-    return batch->rep_.size();
+    return batch->GetDataSize();
   }
 
+  static Status PutReference(WriteBatch* batch, uint32_t column_family_id,
+                             const Slice& key, const SliceParts& value);
+
+  // Whether the batch references values of PutReference() rather than
+  // holding all of its contents
+  static bool HasValueRefs(const WriteBatch* batch) {
+    return batch->value_refs_ != nullptr;
+  }
+
+  // Returns the contents of a batch with value references as the pieces of
+  // rep_ around the referenced values, the values and the lengths of the
+  // values, which are encoded in `scratch`. The pieces are valid as long as
+  // the batch and `scratch` are unchanged.
+  static void GetContentsParts(const WriteBatch* batch,
+                               std::vector<Slice>* parts,
+                               std::string* scratch);
+
+  // Copies the referenced values into the batch
+  static void CopyInValueRefs(WriteBatch* batch);
+
+  // Drops the references to the values past `rep_size` bytes of rep_
+  static void TruncateValueRefs(WriteBatch* batch, size_t rep_size);
+
   static Status SetContents(WriteBatch* batch, const Slice& contents);
 
   static Status CheckSlicePartsLength(const SliceParts& key,
@@ -222,6 +246,12 @@ class WriteBatchInternal {
   static void SetAsLatestPersistentState(WriteBatch* b);
   static bool IsLatestPersistentState(const WriteBatch* b);
 
+  // This write batch copies rows that are already in the DB into the
+  // memtable, which is not a write to them as far as the row cache is
+  // concerned.
+  static void SetAsRowCacheMigration(WriteBatch* b);
+  static bool IsRowCacheMigration(const WriteBatch* b);
+
   static std::tuple<Status, uint32_t, size_t> GetColumnFamilyIdAndTimestampSize(
       WriteBatch* b, ColumnFamilyHandle* column_family);
 
@@ -239,7 +269,7 @@ class LocalSavePoint {
  public:
   explicit LocalSavePoint(WriteBatch* batch)
       : batch_(batch),
-        savepoint_(batch->GetDataSize(), batch->Count(),
+        savepoint_(batch->rep_.size(), batch->Count(),
                    batch->content_flags_.load(std::memory_order_relaxed))
 #ifndef NDEBUG
         ,
@@ -255,8 +285,9 @@ class LocalSavePoint {
 #ifndef NDEBUG
     committed_ = true;
 #endif
-    if (batch_->max_bytes_ && batch_->rep_.size() > batch_->max_bytes_) {
+    if (batch_->max_bytes_ && batch_->GetDataSize() > batch_->max_bytes_) {
       batch_->rep_.resize(savepoint_.size);
+      WriteBatchInternal::TruncateValueRefs(batch_, savepoint_.size);
       WriteBatchInternal::SetCount(batch_, savepoint_.count);
       if (batch_->prot_info_ != nullptr) {
         batch_->prot_info_->entries_.resize(savepoint_.count);
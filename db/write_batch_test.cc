@@ -629,6 +629,103 @@ TEST_F(WriteBatchTest, PutGatherSlices) {
   ASSERT_EQ(3u, batch.Count());
 }
 
+TEST_F(WriteBatchTest, PutReference) {
+  std::string header("header");
+  std::string payload("payload");
+  std::string value("value");
+  WriteBatch batch;
+  WriteBatch copied_batch;
+  ASSERT_OK(batch.Put(Slice("foo"), Slice("bar")));
+  ASSERT_OK(copied_batch.Put(Slice("foo"), Slice("bar")));
+  {
+    // Only the buffers need to outlive the batch
+    Slice value_slices[2] = {header, payload};
+    ASSERT_OK(batch.PutReference(Slice("baz"), SliceParts(value_slices, 2)));
+    ASSERT_OK(copied_batch.Put(Slice("baz"), Slice("headerpayload")));
+    Slice value_slice(value);
+    ASSERT_OK(batch.PutReference(Slice("qux"), SliceParts(&value_slice, 1)));
+    ASSERT_OK(copied_batch.Put(Slice("qux"), Slice("value")));
+  }
+  // Not mistaken for a referenced value
+  ASSERT_OK(batch.Put(Slice("empty"), Slice()));
+  ASSERT_OK(copied_batch.Put(Slice("empty"), Slice()));
+  ASSERT_TRUE(WriteBatchInternal::HasValueRefs(&batch));
+  ASSERT_EQ(copied_batch.GetDataSize(), batch.GetDataSize());
+  ASSERT_EQ(4u, batch.Count());
+  ASSERT_TRUE(batch.HasPut());
+
+  WriteBatchInternal::SetSequence(&batch, 100);
+  WriteBatchInternal::SetSequence(&copied_batch, 100);
+  ASSERT_EQ("Put(baz, headerpayload)@101"
+            "Put(empty, )@103"
+            "Put(foo, bar)@100"
+            "Put(qux, value)@102",
+            PrintContents(&batch));
+
+  // The contents gathered for the WAL are those of the copied values
+  std::vector<Slice> parts;
+  std::string scratch;
+  std::string gathered;
+  WriteBatchInternal::GetContentsParts(&batch, &parts, &scratch);
+  ASSERT_EQ(copied_batch.Data(),
+            Slice(SliceParts(parts.data(), static_cast<int>(parts.size())),
+                  &gathered)
+                .ToString());
+
+  // The references are appended, up to the WAL termination point
+  WriteBatch appended;
+  WriteBatch copied_appended;
+  ASSERT_OK(appended.Put(Slice("a"), Slice("b")));
+  ASSERT_OK(copied_appended.Put(Slice("a"), Slice("b")));
+  ASSERT_OK(WriteBatchInternal::Append(&appended, &batch));
+  ASSERT_OK(WriteBatchInternal::Append(&copied_appended, &copied_batch));
+  ASSERT_TRUE(WriteBatchInternal::HasValueRefs(&appended));
+  ASSERT_EQ(copied_appended.GetDataSize(), appended.GetDataSize());
+
+  WriteBatch wal_only;
+  batch.MarkWalTerminationPoint();
+  Slice value_slice(value);
+  ASSERT_OK(batch.PutReference(Slice("quux"), SliceParts(&value_slice, 1)));
+  ASSERT_OK(WriteBatchInternal::Append(&wal_only, &batch, true));
+  ASSERT_EQ(copied_batch.GetDataSize(), wal_only.GetDataSize());
+  ASSERT_EQ(copied_batch.Data().substr(WriteBatchInternal::kHeader),
+            wal_only.Data().substr(WriteBatchInternal::kHeader));
+  ASSERT_EQ(copied_appended.Data(), appended.Data());
+  ASSERT_FALSE(WriteBatchInternal::HasValueRefs(&appended));
+
+  // Rolling back drops the references
+  batch.SetSavePoint();
+  ASSERT_OK(batch.PutReference(Slice("corge"), SliceParts(&value_slice, 1)));
+  ASSERT_OK(batch.RollbackToSavePoint());
+  ASSERT_OK(copied_batch.Put(Slice("quux"), Slice("value")));
+  ASSERT_EQ(copied_batch.GetDataSize(), batch.GetDataSize());
+
+  // Data() copies the values in, keeping the save points in place
+  batch.SetSavePoint();
+  copied_batch.SetSavePoint();
+  ASSERT_OK(batch.PutReference(Slice("corge"), SliceParts(&value_slice, 1)));
+  ASSERT_OK(copied_batch.Put(Slice("corge"), Slice("value")));
+  ASSERT_EQ(copied_batch.Data(), batch.Data());
+  ASSERT_FALSE(WriteBatchInternal::HasValueRefs(&batch));
+  value.assign("VALUE");
+  header.clear();
+  ASSERT_OK(batch.RollbackToSavePoint());
+  ASSERT_OK(copied_batch.RollbackToSavePoint());
+  ASSERT_EQ(copied_batch.Data(), batch.Data());
+  ASSERT_EQ("Put(baz, headerpayload)@101"
+            "Put(empty, )@103"
+            "Put(foo, bar)@100"
+            "Put(quux, value)@104"
+            "Put(qux, value)@102",
+            PrintContents(&batch));
+
+  // Cleared along with the batch
+  ASSERT_OK(batch.PutReference(Slice("corge"), SliceParts(&value_slice, 1)));
+  batch.Clear();
+  ASSERT_FALSE(WriteBatchInternal::HasValueRefs(&batch));
+  ASSERT_EQ(WriteBatchInternal::kHeader, batch.GetDataSize());
+}
+
 namespace {
 class ColumnFamilyHandleImplDummy : public ColumnFamilyHandleImpl {
  public:
@@ -29,7 +29,12 @@ WriteThread::WriteThread(const ImmutableDBOptions& db_options)
       last_sequence_(0),
       write_stall_dummy_(),
       stall_mu_(),
-      stall_cv_(&stall_mu_) {}
+      stall_cv_(&stall_mu_),
+      wal_ticket_mu_(),
+      wal_ticket_cv_(&wal_ticket_mu_),
+      wal_tickets_issued_(0),
+      wal_tickets_linked_(0),
+      wal_failure_before_(0) {}
 
 uint8_t WriteThread::BlockingAwaitState(Writer* w, uint8_t goal_mask) {
   // We're going to block.  Lazily create the mutex.  We guarantee
@@ -209,6 +214,14 @@ uint8_t WriteThread::AwaitState(Writer* w, uint8_t goal_mask,
 
 void WriteThread::SetState(Writer* w, uint8_t new_state) {
   assert(w);
+  if (w->async) {
+    // Async writers are only woken up to lead or because they are done
+    assert(new_state == STATE_GROUP_LEADER || new_state == STATE_COMPLETED);
+    assert(async_writer_handler_);
+    w->state.store(new_state, std::memory_order_release);
+    async_writer_handler_(w);
+    return;
+  }
   auto state = w->state.load(std::memory_order_acquire);
   if (state == STATE_LOCKED_WAITING ||
       !w->state.compare_exchange_strong(state, new_state)) {
@@ -382,11 +395,16 @@ void WriteThread::JoinBatchGroup(Writer* w) {
   TEST_SYNC_POINT_CALLBACK("WriteThread::JoinBatchGroup:Start", w);
   assert(w->batch != nullptr);
 
+  // Once linked, an async writer can be completed and freed by others
+  const bool async = w->async;
   bool linked_as_leader = LinkOne(w, &newest_writer_);
 
   if (linked_as_leader) {
     SetState(w, STATE_GROUP_LEADER);
   }
+  if (async) {
+    return;
+  }
 
   TEST_SYNC_POINT_CALLBACK("WriteThread::JoinBatchGroup:Wait", w);
 
@@ -791,9 +809,101 @@ void WriteThread::ExitUnbatched(Writer* w) {
   }
 }
 
+uint64_t WriteThread::ExitAsBatchGroupLeaderBeforeSync(
+    WriteGroup& write_group) {
+  assert(enable_pipelined_write_);
+  Writer* last_writer = write_group.last_writer;
+  assert(write_group.leader->link_older == nullptr);
+
+  uint64_t ticket;
+  {
+    MutexLock lock(&wal_ticket_mu_);
+    ticket = wal_tickets_issued_++;
+  }
+
+  // The group keeps its writers out of both queues until it links them to
+  // the memtable writer queue, so the next leader only needs to be cut off
+  // from them
+  Writer* expected = last_writer;
+  if (!newest_writer_.compare_exchange_strong(expected, nullptr)) {
+    Writer* next_leader = FindNextLeader(expected, last_writer);
+    assert(next_leader != nullptr && next_leader != last_writer);
+    next_leader->link_older = nullptr;
+    SetState(next_leader, STATE_GROUP_LEADER);
+  }
+  return ticket;
+}
+
+static WriteThread::AdaptationContext easbgl_ctx(
+    "ExitAsSyncedBatchGroupLeader");
+void WriteThread::ExitAsSyncedBatchGroupLeader(WriteGroup& write_group,
+                                               uint64_t ticket,
+                                               bool wal_failed,
+                                               Status& status) {
+  Writer* leader = write_group.leader;
+  Writer* last_writer = write_group.last_writer;
+
+  {
+    MutexLock lock(&wal_ticket_mu_);
+    while (wal_tickets_linked_ != ticket) {
+      wal_ticket_cv_.Wait();
+    }
+    if (status.ok() && ticket < wal_failure_before_) {
+      status = wal_failure_;
+    }
+  }
+
+  if (!status.ok()) {
+    write_group.status.PermitUncheckedError();
+  }
+  if (status.ok() && !write_group.status.ok()) {
+    status = write_group.status;
+  }
+
+  // Notify writers don't write to memtable to exit.
+  for (Writer* w = last_writer; w != leader;) {
+    Writer* next = w->link_older;
+    w->status = status;
+    if (!w->ShouldWriteToMemtable()) {
+      CompleteFollower(w, write_group);
+    }
+    w = next;
+  }
+  if (!leader->ShouldWriteToMemtable()) {
+    CompleteLeader(write_group);
+  }
+  if (write_group.size > 0) {
+    if (LinkGroup(write_group, &newest_memtable_writer_)) {
+      // The leader can now be different from current writer.
+      SetState(write_group.leader, STATE_MEMTABLE_WRITER_LEADER);
+    }
+  }
+
+  {
+    MutexLock lock(&wal_ticket_mu_);
+    if (wal_failed) {
+      // The groups already past the WAL may have written after the lost
+      // records, so that recovery would not reach theirs
+      wal_failure_before_ = wal_tickets_issued_;
+      wal_failure_ = status;
+    }
+    wal_tickets_linked_++;
+    wal_ticket_cv_.SignalAll();
+  }
+  AwaitState(leader, STATE_MEMTABLE_WRITER_LEADER |
+                         STATE_PARALLEL_MEMTABLE_WRITER | STATE_COMPLETED,
+             &easbgl_ctx);
+}
+
 static WriteThread::AdaptationContext wfmw_ctx("WaitForMemTableWriters");
 void WriteThread::WaitForMemTableWriters() {
   assert(enable_pipelined_write_);
+  {
+    MutexLock lock(&wal_ticket_mu_);
+    while (wal_tickets_linked_ != wal_tickets_issued_) {
+      wal_ticket_cv_.Wait();
+    }
+  }
   if (newest_memtable_writer_.load() == nullptr) {
     return;
   }
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <type_traits>
 #include <vector>
@@ -125,6 +126,8 @@ class WriteThread {
     uint64_t log_used;  // log number that this batch was inserted into
     uint64_t log_ref;   // log number that memtable insert should reference
     WriteCallback* callback;
+    // Nobody waits on the writer, see SetAsyncWriterHandler()
+    bool async;
     bool made_waitable;          // records lazy construction of mutex and cv
     std::atomic<uint8_t> state;  // write under StateMutex() or pre-link
     WriteGroup* write_group;
@@ -150,6 +153,7 @@ class WriteThread {
           log_used(0),
           log_ref(0),
           callback(nullptr),
+          async(false),
           made_waitable(false),
           state(STATE_INIT),
           write_group(nullptr),
@@ -173,6 +177,7 @@ class WriteThread {
           log_used(0),
           log_ref(_log_ref),
           callback(_callback),
+          async(false),
           made_waitable(false),
           state(STATE_INIT),
           write_group(nullptr),
@@ -282,8 +287,20 @@ class WriteThread {
   // it will block.
   //
   // Writer* w:        Writer to be executed as part of a batch group
+  //
+  // An async writer is only linked; the call returns at once and the writer
+  // is taken over by the handler of SetAsyncWriterHandler().
   void JoinBatchGroup(Writer* w);
 
+  // Sets the handler of async writers. Where a waiting writer would be woken
+  // up as the group leader or as completed, an async writer gets the state
+  // and is passed to the handler instead, on the thread that set the state,
+  // possibly with the db mutex held. The handler must not block, and owns
+  // the writer from then on. A leader must clear async before leading.
+  void SetAsyncWriterHandler(std::function<void(Writer*)> handler) {
+    async_writer_handler_ = std::move(handler);
+  }
+
   // Constructs a write batch group led by leader, which should be a
   // Writer passed to JoinBatchGroup on the current thread.
   //
@@ -302,6 +319,19 @@ class WriteThread {
   // Exit batch group on behalf of batch group leader.
   void ExitAsBatchGroupFollower(Writer* w);
 
+  // Split form of ExitAsBatchGroupLeader for pipelined writes, letting the
+  // next leader in while the write group syncs what it wrote to the WAL.
+  // Wakes up the next leader (if any), and returns the ticket to pass to
+  // ExitAsSyncedBatchGroupLeader.
+  uint64_t ExitAsBatchGroupLeaderBeforeSync(WriteGroup& write_group);
+
+  // Wakes up the non-leaders, and passes the group on to the memtable writer
+  // queue once the groups with earlier tickets are, so that memtable writes
+  // keep the WAL order. Fails the group if an earlier one failed to write or
+  // sync the WAL, and records so for the later ones if wal_failed.
+  void ExitAsSyncedBatchGroupLeader(WriteGroup& write_group, uint64_t ticket,
+                                    bool wal_failed, Status& status);
+
   // Constructs a write batch group led by leader from newest_memtable_writers_
   // list. The leader should either write memtable for the whole group and
   // call ExitAsMemTableWriter, or launch parallel memtable write through
@@ -340,7 +370,7 @@ class WriteThread {
   void ExitUnbatched(Writer* w);
 
   // Wait for all parallel memtable writers to finish, in case pipelined
-  // write is enabled.
+  // write is enabled, including the write groups still syncing the WAL.
   void WaitForMemTableWriters();
 
   SequenceNumber UpdateLastSequence(SequenceNumber sequence) {
@@ -396,6 +426,19 @@ class WriteThread {
   port::Mutex stall_mu_;
   port::CondVar stall_cv_;
 
+  std::function<void(Writer*)> async_writer_handler_;
+
+  // Tickets of the write groups exiting through
+  // ExitAsBatchGroupLeaderBeforeSync, and the number of them passed on to
+  // the memtable writer queue, in ticket order. Groups with tickets before
+  // wal_failure_before_ fail with wal_failure_.
+  port::Mutex wal_ticket_mu_;
+  port::CondVar wal_ticket_cv_;
+  uint64_t wal_tickets_issued_;
+  uint64_t wal_tickets_linked_;
+  uint64_t wal_failure_before_;
+  Status wal_failure_;
+
   // Waits for w->state & goal_mask using w->StateMutex().  Returns
   // the state that satisfies goal_mask.
   uint8_t BlockingAwaitState(Writer* w, uint8_t goal_mask);
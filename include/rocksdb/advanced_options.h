@@ -398,7 +398,7 @@ struct AdvancedColumnFamilyOptions {
   //      sysctl -w vm.nr_hugepages=20
   // See linux doc Documentation/vm/hugetlbpage.txt
   // If there isn't enough free huge page available, it will fall back to
-  // malloc.
+  // regular pages marked for transparent huge pages, and then to malloc.
   //
   // Dynamically changeable through SetOptions() API
   size_t memtable_huge_page_size = 0;
@@ -919,6 +919,49 @@ struct AdvancedColumnFamilyOptions {
   // Dynamically changeable through the SetOptions() API
   uint64_t blob_compaction_readahead_size = 0;
 
+  // If true, the row cache (DBOptions::row_cache) tracks for each cached key
+  // of this column family how often its cached copy was invalidated by a
+  // newer version. Keys invalidated at least
+  // row_cache_invalidation_threshold times are no longer inserted into the
+  // row cache after being read from disk, and ReadOptions::
+  // out_row_cache_skipped_on_io reports such skips. The tracking state
+  // belongs to the column family and its memory is charged to the row
+  // cache. Has no effect without a row cache.
+  //
+  // Default: false
+  //
+  // Dynamically changeable through the SetOptions() API
+  bool row_cache_hybrid_admission = false;
+
+  // See row_cache_hybrid_admission.
+  //
+  // Default: 1
+  //
+  // Dynamically changeable through the SetOptions() API
+  uint32_t row_cache_invalidation_threshold = 1;
+
+  // If non-zero, rows that the row cache admission policy rejects for
+  // migration (see row_cache_hybrid_admission) are copied into the active
+  // memtable of the column family by a background job, so that later reads
+  // find them there without a second write from the application. At most
+  // this many bytes of such copies are written to each memtable. Copies are
+  // skipped while the write buffer manager or write controller asks for
+  // flushes or stalls, and whenever the row may have been written since it
+  // was read. Copies are not written to the WAL.
+  //
+  // Copies are not writes as far as the row cache is concerned: they do not
+  // invalidate row cache entries of the row.
+  //
+  // Has no effect without a row cache, with enable_pipelined_write,
+  // unordered_write or two_write_queues, or in a TransactionDB or
+  // OptimisticTransactionDB, where copies would bypass locks and conflict
+  // checks.
+  //
+  // Default: 0 (disabled)
+  //
+  // Dynamically changeable through the SetOptions() API
+  uint64_t row_cache_migration_budget = 0;
+
   // Create ColumnFamilyOptions with default values for all fields
   AdvancedColumnFamilyOptions();
   // Create ColumnFamilyOptions from Options
@@ -48,6 +48,41 @@ enum CacheMetadataChargePolicy {
 const CacheMetadataChargePolicy kDefaultCacheMetadataChargePolicy =
     kFullChargeCacheMetadata;
 
+// EXPERIMENTAL
+// An entry evicted from a cache, as passed to a CacheEvictionListener.
+struct CacheEvictionInfo {
+  Slice key;
+  // Valid until OnEvict() returns; the entry is freed afterwards.
+  void* value = nullptr;
+  size_t charge = 0;
+  // The deleter of the entry, or the del_cb of its CacheItemHelper. Tells
+  // the kind of entry, e.g. a block of a given CacheEntryRole.
+  void (*deleter)(const Slice& key, void* value) = nullptr;
+  // Number of lookups that found the entry, saturating at UINT32_MAX
+  uint32_t hit_count = 0;
+  // Number of entries inserted into the same cache shard after this one,
+  // measuring how long it stayed in the cache without reading a clock
+  uint32_t residency = 0;
+  bool high_priority = false;
+};
+
+// EXPERIMENTAL
+// Learns about the entries a cache evicts, to drive policies outside of the
+// cache (e.g. invalidation tables) more cheaply than from every deleter.
+class CacheEvictionListener {
+ public:
+  virtual ~CacheEvictionListener() {}
+
+  // Called with the entries evicted together by the replacement policy,
+  // to make room for an insertion or after the capacity was lowered. It is
+  // called on the thread that triggered the eviction, without holding any
+  // lock of the cache, and before the entries are freed. Entries erased,
+  // replaced by an insertion of the same key, or dropped on release because
+  // the cache is over capacity are not reported. The cache may be used from
+  // within the call.
+  virtual void OnEvict(const CacheEvictionInfo* entries, size_t count) = 0;
+};
+
 struct LRUCacheOptions {
   // Capacity of the cache.
   size_t capacity = 0;
@@ -94,6 +129,47 @@ struct LRUCacheOptions {
   // A SecondaryCache instance to use a the non-volatile tier
   std::shared_ptr<SecondaryCache> secondary_cache;
 
+  // If greater than zero, enables TinyLFU admission: lookups are recorded in
+  // a fixed-size frequency sketch sized for about this many distinct keys,
+  // and a low-priority insert that would have to evict is dropped unless its
+  // key was looked up more often recently than the least recently used
+  // entry. This keeps one-off accesses such as scans from flushing a hot
+  // working set. A good value is a few times the expected number of entries
+  // in the cache; the sketch takes about 5 bytes per entry.
+  size_t tiny_lfu_sketch_entries = 0;
+
+  // If true and the host has more than one NUMA node, the shards are split
+  // into a group per node, with the shards of each group placed in the
+  // memory of its node. An entry is inserted into the group of the node of
+  // the inserting thread, and lookups search the group of the caller's node
+  // before the others, so entries are mostly served from local memory. An
+  // entry is cached once, moving to the group of the last node to insert it;
+  // hot entries are not replicated across nodes. Unless memory_allocator is
+  // set, the cached values are allocated with NewNumaMemoryAllocator().
+  // Ignored if RocksDB is not built with NUMA support.
+  bool numa_aware = false;
+
+  // EXPERIMENTAL
+  // If not kNoCompression, entries inserted with a CacheItemHelper (data
+  // blocks, index and filter blocks) are not dropped when they fall off the
+  // cold end of the LRU list. They are compressed with this method, LZ4
+  // being the intended one, and inserted again as low priority entries
+  // charged the compressed size. A Lookup() with a helper and create callback
+  // that finds such an entry decompresses it and replaces it with the object
+  // recreated from it; other lookups treat it as a miss. Compressed entries
+  // are dropped when evicted in turn.
+  //
+  // Entries that do not compress to at most 7/8 of their size are dropped.
+  // Compression stops while few compressed entries are looked up again,
+  // checking every 16th entry for when that changes.
+  //
+  // Ignored if secondary_cache is set, which gets the evicted entries instead.
+  CompressionType compressed_tier_compression = kNoCompression;
+
+  // EXPERIMENTAL
+  // If set, notified of the entries evicted from the cache, in batches.
+  std::shared_ptr<CacheEvictionListener> eviction_listener;
+
   LRUCacheOptions() {}
   LRUCacheOptions(size_t _capacity, int _num_shard_bits,
                   bool _strict_capacity_limit, double _high_pri_pool_ratio,
@@ -175,25 +251,75 @@ extern std::shared_ptr<SecondaryCache> NewLRUSecondaryCache(
 extern std::shared_ptr<SecondaryCache> NewLRUSecondaryCache(
     const LRUSecondaryCacheOptions& opts);
 
+struct ClockCacheOptions {
+  // Capacity of the cache.
+  size_t capacity = 0;
+
+  // Cache is sharded into 2^num_shard_bits shards, by hash of key. Refer to
+  // NewLRUCache for further information.
+  int num_shard_bits = -1;
+
+  // If strict_capacity_limit is set,
+  // insert to the cache will fail when cache is full.
+  bool strict_capacity_limit = false;
+
+  CacheMetadataChargePolicy metadata_charge_policy =
+      kDefaultCacheMetadataChargePolicy;
+
+  // The expected average charge of an entry. Each shard keeps its entries in
+  // a fixed-size table allocated up front with room for about
+  // capacity / estimated_entry_charge entries, so the table can neither
+  // grow with SetCapacity() nor hold more entries than that. A value much
+  // smaller than the real average wastes memory on empty slots, and one much
+  // larger evicts entries before the cache is full. Use about the block size
+  // for a block cache, and the average row size for a row cache.
+  size_t estimated_entry_charge = 1024;
+
+  // A SecondaryCache instance to use as the non-volatile tier. Lookups that
+  // miss wait for the secondary cache.
+  std::shared_ptr<SecondaryCache> secondary_cache;
+
+  // EXPERIMENTAL
+  // If set, notified of the entries evicted from the cache, in batches.
+  std::shared_ptr<CacheEvictionListener> eviction_listener;
+
+  ClockCacheOptions() {}
+  ClockCacheOptions(size_t _capacity, int _num_shard_bits,
+                    bool _strict_capacity_limit = false,
+                    CacheMetadataChargePolicy _metadata_charge_policy =
+                        kDefaultCacheMetadataChargePolicy)
+      : capacity(_capacity),
+        num_shard_bits(_num_shard_bits),
+        strict_capacity_limit(_strict_capacity_limit),
+        metadata_charge_policy(_metadata_charge_policy) {}
+};
+
 // Similar to NewLRUCache, but create a cache based on CLOCK algorithm with
-// better concurrent performance in some cases. See util/clock_cache.cc for
-// more detail.
-//
-// Return nullptr if it is not supported.
+// better concurrent performance. Lookup, Insert, Release and Erase take no
+// locks: each shard is an open-addressed table of handles with atomic
+// reference counts, and eviction sweeps a clock hand over the table. High
+// priority entries survive more sweeps than low priority ones. See
+// cache/clock_cache.cc for more detail.
 //
-// BROKEN: ClockCache is known to have bugs that could lead to crash or
-// corruption, so should not be used until fixed. Use NewLRUCache instead.
+// Return nullptr if num_shard_bits is too large.
 extern std::shared_ptr<Cache> NewClockCache(
     size_t capacity, int num_shard_bits = -1,
     bool strict_capacity_limit = false,
     CacheMetadataChargePolicy metadata_charge_policy =
         kDefaultCacheMetadataChargePolicy);
 
+extern std::shared_ptr<Cache> NewClockCache(
+    const ClockCacheOptions& cache_opts);
+
 class Cache {
  public:
   // Depending on implementation, cache entries with high priority could be less
-  // likely to get evicted than low priority entries.
-  enum class Priority { HIGH, LOW };
+  // likely to get evicted than low priority entries. Bottom priority is for
+  // entries unlikely to be used again, such as the blocks of long scans: the
+  // LRU cache inserts them at the cold end of its LRU list, to be evicted
+  // first unless they are looked up again. Other implementations treat it as
+  // low priority.
+  enum class Priority { HIGH, LOW, BOTTOM };
 
   // A set of callbacks to allow objects in the primary block cache to be
   // be persisted in a secondary cache. The purpose of the secondary cache
@@ -538,6 +664,47 @@ class Cache {
   // to each of the handles.
   virtual void WaitAll(std::vector<Handle*>& /*handles*/) {}
 
+  // Looks up num_keys keys in the volatile cache, as if by Lookup(keys[i],
+  // stats) for each of them, and stores the handles (or nullptr for a miss)
+  // in handles[i]. Implementations may amortize hashing and locking over the
+  // batch, e.g. by taking each shard lock once. The caller must Release()
+  // every non-null handle.
+  virtual void MultiLookup(size_t num_keys, const Slice* keys,
+                           Handle** handles, Statistics* stats = nullptr) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      handles[i] = Lookup(keys[i], stats);
+    }
+  }
+
+  // Like MultiLookup() above, as if by Lookup(keys[i], helper, create_cb,
+  // priority, wait, stats) for each key, so that keys missing from the
+  // volatile cache are also looked up in the secondary cache. A nullptr
+  // handle is a miss in all tiers.
+  virtual void MultiLookup(size_t num_keys, const Slice* keys,
+                           const CacheItemHelper* helper,
+                           const CreateCallback& create_cb, Priority priority,
+                           bool wait, Handle** handles,
+                           Statistics* stats = nullptr) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      handles[i] = Lookup(keys[i], helper, create_cb, priority, wait, stats);
+    }
+  }
+
+  // Inserts num_keys entries into the volatile cache, as if by
+  // Insert(keys[i], values[i], charges[i], deleter, &handles[i], priority)
+  // for each of them, and stores the results in statuses[i]. If handles is
+  // nullptr, no handles are returned, as for Insert() with a nullptr handle.
+  // Like MultiLookup(), implementations may batch the work by shard.
+  virtual void MultiInsert(size_t num_keys, const Slice* keys,
+                           void* const* values, const size_t* charges,
+                           DeleterFn deleter, Handle** handles,
+                           Priority priority, Status* statuses) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      statuses[i] = Insert(keys[i], values[i], charges[i], deleter,
+                           handles ? &handles[i] : nullptr, priority);
+    }
+  }
+
  private:
   std::shared_ptr<MemoryAllocator> memory_allocator_;
 };
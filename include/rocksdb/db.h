@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -485,6 +486,26 @@ class DB {
   // Note: consider setting options.sync = true.
   virtual Status Write(const WriteOptions& options, WriteBatch* updates) = 0;
 
+  // Like Write(), but does not wait for the write to complete. callback is
+  // called once with the status Write() would return, after the updates are
+  // in the WAL (synced if options.sync) and in the memtables, possibly on
+  // another thread, and possibly before WriteAsync() returns. updates must
+  // stay alive until then. Writes submitted by a thread are applied in
+  // order, and all callbacks have been called when Close() returns.
+  //
+  // callback delays other writes while it runs, and must not wait for a
+  // write to this DB, e.g. through Write() or Flush(), although it can call
+  // WriteAsync(). Like Write(), WriteAsync() blocks while writes are
+  // stopped, unless options.no_slowdown is set.
+  //
+  // The default implementation calls Write(). So does the DB itself with
+  // enable_pipelined_write, unordered_write or two_write_queues, and for
+  // low_pri writes.
+  virtual void WriteAsync(const WriteOptions& options, WriteBatch* updates,
+                          std::function<void(const Status&)> callback) {
+    callback(Write(options, updates));
+  }
+
   // If the database contains an entry for "key" store the
   // corresponding value in *value and return OK.
   //
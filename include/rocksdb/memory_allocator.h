@@ -77,5 +77,54 @@ struct JemallocAllocatorOptions {
 extern Status NewJemallocNodumpAllocator(
     JemallocAllocatorOptions& options,
     std::shared_ptr<MemoryAllocator>* memory_allocator);
+struct HugePageAllocatorOptions {
+  static const char* kName() { return "HugePageAllocatorOptions"; }
+  // Size of the huge pages, a power of two. Must match a huge page size of
+  // the system, 2MB on most x86_64 hosts.
+  size_t huge_page_size = 2 << 20;
+
+  // Whether to take the huge pages reserved through hugetlbfs
+  // (sysctl -w vm.nr_hugepages=N) first. Once they run out, or if false,
+  // memory is mapped with regular pages and marked for transparent huge
+  // pages (madvise(MADV_HUGEPAGE)), which the kernel backs with huge pages
+  // when it can.
+  bool use_hugetlb = true;
+};
+
+// Generate memory allocator which allocates from huge pages, for a block
+// cache or row cache of tens of GBs or more, where walking blocks spread over
+// regular 4KB pages misses the TLB most of the time.
+//
+// Allocations of up to an eighth of a huge page come from slabs of one huge
+// page each, in size classes of eight per power of two, so that data blocks
+// of any size take at most an eighth more than requested, and block sizes
+// that are powers of two take no more. Memory freed to a size class is kept
+// for reuse by the class, except that a slab whose blocks are all freed is
+// unmapped, keeping at most one such slab per size class. Larger
+// allocations are mapped on their own and unmapped when freed.
+//
+// Returns NotSupported on platforms without mmap.
+extern Status NewHugePageMemoryAllocator(
+    const HugePageAllocatorOptions& options,
+    std::shared_ptr<MemoryAllocator>* memory_allocator);
+
+// Generate memory allocator which allocates on the NUMA node of the calling
+// thread. Used with a block cache in NUMA mode (LRUCacheOptions::numa_aware),
+// the blocks a thread reads are cached on its node together with the cache
+// shard they go to.
+//
+// Each node has a pool of memory bound to it, handing out allocations of up
+// to 256KB in size classes at most a fifth larger than requested, from 2MB
+// chunks of a single class. Memory freed to a pool is kept for reuse by the
+// same node and size class, except that a chunk whose blocks are all freed
+// is unmapped. Each node and size class keeps at most one such free chunk,
+// so a pool retains up to 2MB per size class in use beyond live
+// allocations, plus the freed blocks of partly used chunks. Larger
+// allocations are mapped on the node directly and unmapped when freed.
+//
+// Returns NotSupported if not compiled with NUMA support or the host does
+// not support NUMA.
+extern Status NewNumaMemoryAllocator(
+    std::shared_ptr<MemoryAllocator>* memory_allocator);
 
 }  // namespace ROCKSDB_NAMESPACE
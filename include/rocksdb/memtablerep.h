@@ -416,5 +416,21 @@ extern MemTableRepFactory* NewHashLinkListRepFactory(
     bool if_log_bucket_dist_when_flash = true,
     uint32_t threshold_use_skiplist = 256);
 
+// This factory creates memtables based on a hash table of the user keys,
+// which takes concurrent inserts without locks and finds the entries of a
+// key in O(1). There is no total order of the entries, so an iterator sorts
+// all of them when first positioned; the sorted entries are kept once the
+// memtable is immutable, for its flush. This suits workloads of point
+// lookups with few scans. Not supported with user-defined timestamps.
+// @bucket_count: number of fixed array buckets
+extern MemTableRepFactory* NewConcurrentHashRepFactory(
+    size_t bucket_count = 1000000);
+
+// This factory creates memtables based on a B+tree, which takes concurrent
+// inserts and supports insert hints. Its wide nodes take fewer cache misses
+// than the levels of a skip list to insert or find a key. Readers take no
+// lock and writers lock only the nodes they change.
+extern MemTableRepFactory* NewBTreeRepFactory();
+
 #endif  // ROCKSDB_LITE
 }  // namespace ROCKSDB_NAMESPACE
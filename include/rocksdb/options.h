@@ -52,6 +52,7 @@ class MergeOperator;
 class Snapshot;
 class MemTableRepFactory;
 class RateLimiter;
+class RowCacheAdmissionPolicy;
 class Slice;
 class Statistics;
 class InternalKeyComparator;
@@ -1038,6 +1039,24 @@ struct DBOptions {
   // Default: false
   bool enable_pipelined_write = false;
 
+  // If greater than 1, the WAL is written as a set of this many files,
+  // with each WAL write group appended to the next file in turn, and
+  // synced outside of the WAL writer queue. The next group can then append
+  // to another file while the previous ones sync. Appends are still made
+  // by one write group at a time. Since the groups form while others sync,
+  // they are smaller and each pays its own sync, so this only raises the
+  // throughput of sync writes on devices that complete concurrent syncs
+  // faster than serial ones, and lowers it otherwise. Recovery replays the
+  // files of a set in the order they were written.
+  //
+  // Requires enable_pipelined_write, and is incompatible with
+  // two_write_queues, unordered_write, allow_2pc, manual_wal_flush,
+  // recycle_log_file_num, allow_mmap_writes and
+  // track_and_verify_wals_in_manifest. GetUpdatesSince() is not supported.
+  //
+  // Default: 1
+  size_t wal_shards = 1;
+
   // Setting unordered_write to true trades higher write throughput with
   // relaxing the immutability guarantee of snapshots. This violates the
   // repeatability one expects from ::Get from a snapshot, as well as
@@ -1139,6 +1158,54 @@ struct DBOptions {
   // Not supported in ROCKSDB_LITE mode!
   std::shared_ptr<Cache> row_cache = nullptr;
 
+  // Decides which rows read from table files are inserted into row_cache.
+  // See rocksdb/row_cache_admission_policy.h for the built-in policies.
+  // Default: nullptr (NewInvalidationThresholdRowCacheAdmissionPolicy())
+  // Not supported in ROCKSDB_LITE mode!
+  std::shared_ptr<RowCacheAdmissionPolicy> row_cache_admission_policy =
+      nullptr;
+
+  // If true, rows are cached in row_cache by (column family, user key)
+  // rather than by (table file, user key), so that cached rows stay valid
+  // when compaction moves keys into new files. Each entry remembers the
+  // sequence number it was read at, and is only used while no write to the
+  // key (or a range deletion, ingestion or file deletion in its column
+  // family) has happened since. Reads that find merge operands or range
+  // tombstones in newer data, and column families with a compaction filter,
+  // use the per-file cache keys.
+  // Default: false
+  // Not supported in ROCKSDB_LITE mode!
+  bool row_cache_key_by_user_key = false;
+
+  // If > 0, one in this many row cache entries records its insertion time
+  // and number of hits, reported when it leaves the row cache in the
+  // ROW_CACHE_ENTRY_RESIDENCY_MICROS and ROW_CACHE_ENTRY_HITS histograms.
+  // Other entries carry no tracking state.
+  // Default: 0 (disabled)
+  // Not supported in ROCKSDB_LITE mode!
+  uint32_t row_cache_tracking_sample_rate = 0;
+
+  // If non-empty, Close() writes the index, filter and data blocks of this
+  // DB found in the block caches of its column families, and its row cache
+  // entries, to files in this directory. The next DB::Open() reads them
+  // back into the caches before returning, with cache_warmup_threads
+  // threads, skipping the entries of table files deleted since. Progress is
+  // reported in the CACHE_WARMUP_* tickers.
+  // Default: "" (disabled)
+  // Not supported in ROCKSDB_LITE mode!
+  std::string cache_warmup_dir = "";
+
+  // Bound on the bytes of block cache entries, and separately on the bytes
+  // of row cache entries, written to cache_warmup_dir. Index and filter
+  // blocks are written before data blocks. 0 means no bound.
+  // Default: 0
+  uint64_t cache_warmup_max_bytes = 0;
+
+  // Number of files in cache_warmup_dir the entries are spread over, which
+  // is also the number of threads loading them.
+  // Default: 4
+  int cache_warmup_threads = 4;
+
 #ifndef ROCKSDB_LITE
   // A filter object supplied to be invoked while processing write-ahead-logs
   // (WALs) during recovery. The filter provides a way to inspect log
@@ -1625,6 +1692,20 @@ struct ReadOptions {
   // Default: false
   bool async_io;
 
+  // If non-zero, an iterator inserts the data blocks it reads from a table
+  // file into the block cache with Cache::Priority::BOTTOM once it has
+  // loaded this many data blocks of the file since its last seek. An LRU
+  // cache keeps such blocks at the cold end of its LRU list, and promotes
+  // them only if they are looked up again before being evicted. So a long
+  // scan mostly recycles the cache space of its own blocks rather than
+  // evicting the working set of point lookups, while still caching, unlike
+  // fill_cache = false. The first blocks after a seek, a few readahead
+  // windows worth, are inserted as usual so that short range queries are
+  // not affected. Has no effect with fill_cache = false.
+  //
+  // Default: 0 (disabled)
+  uint64_t scan_resistant_fill_after_blocks = 0;
+
   MemTableReadCallback on_memtable_hit = nullptr;
 
   // [Hybrid 기법 위한 수정] - out_row_cache_skipped_on_io 추가
@@ -1632,6 +1713,12 @@ struct ReadOptions {
     // false => Cache hit로 I/O 수행 X || I/O 수행 && Row cache caching O
   bool* out_row_cache_skipped_on_io = nullptr;
 
+  // Like out_row_cache_skipped_on_io, for MultiGet: if non-null, it is
+  // resized to the number of keys and element i tells whether key i was
+  // rejected from the row cache for migration. MultiGet does not report
+  // through out_row_cache_skipped_on_io.
+  std::vector<bool>* out_multiget_row_cache_skipped_on_io = nullptr;
+
   // 조회 당 최대 1번의 invalidation count increment가 가능하도록 하기 위해 도입
   bool* row_cache_miss_accounted = nullptr;
 
@@ -0,0 +1,95 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rocksdb/kv_cache_policy.h"
+#include "rocksdb/rocksdb_namespace.h"
+#include "rocksdb/slice.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Describes a row cache lookup to a RowCacheAdmissionPolicy.
+struct RowCacheAdmissionContext {
+  // User key of the row, including the timestamp if any.
+  Slice user_key;
+  // Level of the table file the row belongs to, -1 if unknown.
+  int level = -1;
+  // Whether reading the row required reading data blocks from storage, i.e.
+  // it was not served from the block cache. Always false on row cache hits.
+  bool read_from_storage = false;
+  // Whether hybrid admission is enabled for the column family (see
+  // ColumnFamilyOptions::row_cache_hybrid_admission). The two fields below
+  // are only meaningful if it is.
+  bool hybrid_admission = false;
+  // Tracking state of the key. invalidation_count counts writes to the key
+  // while it had entries in the row cache; it is kept after those stale
+  // entries are erased, so cached_key_count may be zero.
+  KVCPLookupState kvcp;
+  // ColumnFamilyOptions::row_cache_invalidation_threshold
+  uint32_t invalidation_threshold = 0;
+};
+
+enum class RowCacheAdmissionDecision : unsigned char {
+  // Insert the row into the row cache.
+  kAdmit,
+  // Do not insert the row.
+  kReject,
+  // Do not insert the row and report it through
+  // ReadOptions::out_row_cache_skipped_on_io, so that the caller can keep the
+  // row somewhere cheaper to update (e.g. the memtable).
+  kRejectForMigration,
+};
+
+// Decides which rows read from table files are inserted into the row cache
+// (DBOptions::row_cache). It is consulted on every row cache miss that finds
+// the key in a table file, and notified of every row cache hit.
+//
+// Both functions are called on the read path, concurrently from many
+// threads, so implementations must be thread-safe and cheap.
+class RowCacheAdmissionPolicy {
+ public:
+  virtual ~RowCacheAdmissionPolicy() {}
+
+  virtual const char* Name() const = 0;
+
+  // Called when a lookup is served from the row cache.
+  virtual void OnHit(const RowCacheAdmissionContext& /*context*/) {}
+
+  // Called when a lookup missed the row cache and the row was read from a
+  // table file.
+  virtual RowCacheAdmissionDecision Admit(
+      const RowCacheAdmissionContext& context) = 0;
+};
+
+// Inserts every row read from a table file, like the row cache without an
+// admission policy.
+extern std::shared_ptr<RowCacheAdmissionPolicy>
+NewAlwaysAdmitRowCacheAdmissionPolicy();
+
+// Rejects a row for migration when it had to be read from storage and its
+// key was overwritten while in the row cache at least
+// row_cache_invalidation_threshold times. Admits everything in column
+// families without row_cache_hybrid_admission. This is the policy used when
+// DBOptions::row_cache_admission_policy is not set.
+extern std::shared_ptr<RowCacheAdmissionPolicy>
+NewInvalidationThresholdRowCacheAdmissionPolicy();
+
+// Admits a row only once its key has been looked up at least min_frequency
+// times recently, keeping one-off keys such as those of scans out of the row
+// cache. Frequencies are estimated with a fixed size count-min sketch sized
+// for about expected_keys distinct keys, whose counts are halved
+// periodically so that keys which stopped being popular can be forgotten.
+// Rejections for migration decided by the invalidation threshold policy
+// take precedence.
+extern std::shared_ptr<RowCacheAdmissionPolicy>
+NewTinyLFURowCacheAdmissionPolicy(size_t expected_keys = 1 << 20,
+                                  uint32_t min_frequency = 2);
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -8,6 +8,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "rocksdb/cache.h"
 #include "rocksdb/customizable.h"
@@ -82,4 +83,41 @@ class SecondaryCache : public Customizable {
   virtual std::string GetPrintableOptions() const override = 0;
 };
 
+class FileSystem;
+
+struct FileSecondaryCacheOptions {
+  // Directory holding the cache files. Files found there on open, left by a
+  // previous instance with the same path, are reloaded.
+  std::string path;
+
+  // Total size of the cache files. When exceeded, the oldest region file is
+  // dropped as a whole.
+  size_t capacity = 0;
+
+  // Entries are appended to the newest region file, and a new one is started
+  // once it reaches region_size. Larger regions mean fewer files but a
+  // coarser eviction.
+  size_t region_size = 16 << 20;
+
+  // The number of recent accesses (insertions and lookups) a key must have
+  // had for an insertion to be written to the file, so that blocks evicted
+  // from the primary cache only once do not wear out the device. 1 admits
+  // everything.
+  uint32_t admission_threshold = 2;
+
+  // Threads reading the entries of Lookup(wait=false) in the background.
+  // WaitAll() reads the entries not yet picked up itself, in one MultiRead()
+  // per file.
+  int num_io_threads = 2;
+
+  // Defaults to FileSystem::Default().
+  std::shared_ptr<FileSystem> file_system;
+};
+
+// EXPERIMENTAL
+// Create a Secondary Cache keeping its entries in files on a local device,
+// e.g. an SSD much larger than the block cache.
+extern Status NewFileSecondaryCache(const FileSecondaryCacheOptions& opts,
+                                    std::shared_ptr<SecondaryCache>* cache);
+
 }  // namespace ROCKSDB_NAMESPACE
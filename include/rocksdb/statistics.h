@@ -431,6 +431,34 @@ enum Tickers : uint32_t {
   NON_LAST_LEVEL_READ_BYTES,
   NON_LAST_LEVEL_READ_COUNT,
 
+  // # of rows read from table files that the row cache admission policy
+  // kept out of the row cache.
+  ROW_CACHE_ADMISSION_REJECT,
+  // # of writes to keys with entries in the row cache, with hybrid admission
+  // enabled.
+  ROW_CACHE_INVALIDATION,
+  // # of stale row cache entries erased in the background, of overwritten
+  // keys or of deleted table files.
+  ROW_CACHE_STALE_ERASE,
+
+  // # of rows rejected from the row cache for migration that were copied
+  // into the memtable, and # of such rows dropped instead, e.g. because the
+  // migration budget of the memtable was used up or the row was written
+  // since it was read.
+  ROW_CACHE_MIGRATED,
+  ROW_CACHE_MIGRATION_DROPPED,
+
+  // # of block cache and row cache entries loaded from
+  // DBOptions::cache_warmup_dir at DB::Open(), and their charge; # of entries
+  // not loaded, because their table file is gone or their cache is full.
+  CACHE_WARMUP_ENTRIES_LOADED,
+  CACHE_WARMUP_BYTES_LOADED,
+  CACHE_WARMUP_ENTRIES_SKIPPED,
+
+  // # of LRU cache lookups served by decompressing an entry of the
+  // compressed tier, see LRUCacheOptions::compressed_tier_compression.
+  COMPRESSED_TIER_HITS,
+
   TICKER_ENUM_MAX
 };
 
@@ -536,6 +564,12 @@ enum Histograms : uint32_t {
 
   ASYNC_READ_BYTES,
 
+  // Residency time and number of hits of the row cache entries sampled by
+  // DBOptions::row_cache_tracking_sample_rate, recorded when they leave the
+  // row cache
+  ROW_CACHE_ENTRY_RESIDENCY_MICROS,
+  ROW_CACHE_ENTRY_HITS,
+
   HISTOGRAM_ENUM_MAX,
 };
 
@@ -38,6 +38,10 @@ enum TraceType : char {
   kIOTracer = 12,
   // Query level tracing related trace type.
   kTraceMultiGet = 13,
+  // Row cache tracing related trace types, written by the block cache tracer.
+  kBlockTraceRowCacheLookup = 14,
+  kBlockTraceRowCacheWrite = 15,
+  kBlockTraceRowCacheErase = 16,
   // All trace types should be added before kTraceMax
   kTraceMax,
 };
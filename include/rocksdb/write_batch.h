@@ -41,6 +41,7 @@ class Slice;
 class ColumnFamilyHandle;
 struct SavePoints;
 struct SliceParts;
+struct ValueRefs;
 
 struct SavePoint {
   size_t size;  // size of rep_
@@ -98,6 +99,22 @@ class WriteBatch : public WriteBatchBase {
     return Put(nullptr, key, value);
   }
 
+  // Variant of Put() that references the value instead of copying it. Only
+  // the key is copied into the batch; the parts of `value` are gathered from
+  // the buffers of the caller when the batch is written to the WAL, and
+  // copied once, into the memtable. The buffers (but not the SliceParts
+  // itself) must stay unchanged until the write of the batch is done, i.e.
+  // DB::Write() returns or the callback of DB::WriteAsync() is called, or
+  // the batch is cleared. Data() copies the values into the batch, after
+  // which the buffers are no longer needed.
+  // Not supported on column families enabling user-defined timestamp, nor on
+  // the batch of a WriteBatchWithIndex.
+  Status PutReference(ColumnFamilyHandle* column_family, const Slice& key,
+                      const SliceParts& value);
+  Status PutReference(const Slice& key, const SliceParts& value) {
+    return PutReference(nullptr, key, value);
+  }
+
   using WriteBatchBase::Delete;
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   // The following Delete(..., const Slice& key) can be used when user-defined
@@ -324,10 +341,10 @@ class WriteBatch : public WriteBatchBase {
   Status Iterate(Handler* handler) const;
 
   // Retrieve the serialized version of this batch.
-  const std::string& Data() const { return rep_; }
+  const std::string& Data() const;
 
   // Retrieve data size of the batch.
-  size_t GetDataSize() const { return rep_.size(); }
+  size_t GetDataSize() const;
 
   // Returns the number of updates in the batch
   uint32_t Count() const;
@@ -431,8 +448,15 @@ class WriteBatch : public WriteBatchBase {
   // more details.
   bool is_latest_persistent_state_ = false;
 
+  // Is the batch a copy of rows already in the DB, made for the row cache?
+  // Refer to ColumnFamilyOptions::row_cache_migration_budget.
+  bool is_row_cache_migration_ = false;
+
   std::unique_ptr<ProtectionInfo> prot_info_;
 
+  // The values of PutReference(), which rep_ holds as empty values
+  std::unique_ptr<ValueRefs> value_refs_;
+
   size_t default_cf_ts_sz_ = 0;
 
   // False if all keys are from column families that disable user-defined
@@ -5055,6 +5055,24 @@ class TickerTypeJni {
         return -0x2C;
       case ROCKSDB_NAMESPACE::Tickers::NON_LAST_LEVEL_READ_COUNT:
         return -0x2D;
+      case ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_ADMISSION_REJECT:
+        return -0x2E;
+      case ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_INVALIDATION:
+        return -0x2F;
+      case ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_STALE_ERASE:
+        return -0x30;
+      case ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_MIGRATED:
+        return -0x31;
+      case ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_MIGRATION_DROPPED:
+        return -0x32;
+      case ROCKSDB_NAMESPACE::Tickers::CACHE_WARMUP_ENTRIES_LOADED:
+        return -0x33;
+      case ROCKSDB_NAMESPACE::Tickers::CACHE_WARMUP_BYTES_LOADED:
+        return -0x34;
+      case ROCKSDB_NAMESPACE::Tickers::CACHE_WARMUP_ENTRIES_SKIPPED:
+        return -0x35;
+      case ROCKSDB_NAMESPACE::Tickers::COMPRESSED_TIER_HITS:
+        return -0x36;
       case ROCKSDB_NAMESPACE::Tickers::TICKER_ENUM_MAX:
         // 0x5F was the max value in the initial copy of tickers to Java.
         // Since these values are exposed directly to Java clients, we keep
@@ -5424,6 +5442,24 @@ class TickerTypeJni {
         return ROCKSDB_NAMESPACE::Tickers::NON_LAST_LEVEL_READ_BYTES;
       case -0x2D:
         return ROCKSDB_NAMESPACE::Tickers::NON_LAST_LEVEL_READ_COUNT;
+      case -0x2E:
+        return ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_ADMISSION_REJECT;
+      case -0x2F:
+        return ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_INVALIDATION;
+      case -0x30:
+        return ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_STALE_ERASE;
+      case -0x31:
+        return ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_MIGRATED;
+      case -0x32:
+        return ROCKSDB_NAMESPACE::Tickers::ROW_CACHE_MIGRATION_DROPPED;
+      case -0x33:
+        return ROCKSDB_NAMESPACE::Tickers::CACHE_WARMUP_ENTRIES_LOADED;
+      case -0x34:
+        return ROCKSDB_NAMESPACE::Tickers::CACHE_WARMUP_BYTES_LOADED;
+      case -0x35:
+        return ROCKSDB_NAMESPACE::Tickers::CACHE_WARMUP_ENTRIES_SKIPPED;
+      case -0x36:
+        return ROCKSDB_NAMESPACE::Tickers::COMPRESSED_TIER_HITS;
       case 0x5F:
         // 0x5F was the max value in the initial copy of tickers to Java.
         // Since these values are exposed directly to Java clients, we keep
@@ -5554,6 +5590,10 @@ class HistogramTypeJni {
         return 0x32;
       case ROCKSDB_NAMESPACE::Histograms::ASYNC_READ_BYTES:
         return 0x33;
+      case ROCKSDB_NAMESPACE::Histograms::ROW_CACHE_ENTRY_RESIDENCY_MICROS:
+        return 0x34;
+      case ROCKSDB_NAMESPACE::Histograms::ROW_CACHE_ENTRY_HITS:
+        return 0x35;
       case ROCKSDB_NAMESPACE::Histograms::HISTOGRAM_ENUM_MAX:
         // 0x1F for backwards compatibility on current minor version.
         return 0x1F;
@@ -5673,6 +5713,10 @@ class HistogramTypeJni {
             ERROR_HANDLER_AUTORESUME_RETRY_COUNT;
       case 0x33:
         return ROCKSDB_NAMESPACE::Histograms::ASYNC_READ_BYTES;
+      case 0x34:
+        return ROCKSDB_NAMESPACE::Histograms::ROW_CACHE_ENTRY_RESIDENCY_MICROS;
+      case 0x35:
+        return ROCKSDB_NAMESPACE::Histograms::ROW_CACHE_ENTRY_HITS;
       case 0x1F:
         // 0x1F for backwards compatibility on current minor version.
         return ROCKSDB_NAMESPACE::Histograms::HISTOGRAM_ENUM_MAX;
@@ -182,6 +182,16 @@ public enum HistogramType {
 
   ASYNC_READ_BYTES((byte) 0x33),
 
+  /**
+   * Residency time of sampled row cache entries.
+   */
+  ROW_CACHE_ENTRY_RESIDENCY_MICROS((byte) 0x34),
+
+  /**
+   * Number of hits of sampled row cache entries.
+   */
+  ROW_CACHE_ENTRY_HITS((byte) 0x35),
+
   // 0x1F for backwards compatibility on current minor version.
   HISTOGRAM_ENUM_MAX((byte) 0x1F);
 
@@ -804,6 +804,58 @@ public enum TickerType {
     NON_LAST_LEVEL_READ_BYTES((byte) -0x2C),
     NON_LAST_LEVEL_READ_COUNT((byte) -0x2D),
 
+    /**
+     * # of rows read from table files that the row cache admission policy
+     * kept out of the row cache.
+     */
+    ROW_CACHE_ADMISSION_REJECT((byte) -0x2E),
+
+    /**
+     * # of writes to keys with entries in the row cache, with hybrid
+     * admission enabled.
+     */
+    ROW_CACHE_INVALIDATION((byte) -0x2F),
+
+    /**
+     * # of stale row cache entries erased in the background, of overwritten
+     * keys or of deleted table files.
+     */
+    ROW_CACHE_STALE_ERASE((byte) -0x30),
+
+    /**
+     * # of rows rejected from the row cache for migration that were copied
+     * into the memtable.
+     */
+    ROW_CACHE_MIGRATED((byte) -0x31),
+
+    /**
+     * # of rows rejected from the row cache for migration that were not
+     * copied into the memtable.
+     */
+    ROW_CACHE_MIGRATION_DROPPED((byte) -0x32),
+
+    /**
+     * # of block cache and row cache entries loaded at DB open from the
+     * cache warm-up directory.
+     */
+    CACHE_WARMUP_ENTRIES_LOADED((byte) -0x33),
+
+    /**
+     * Charge of the entries loaded at DB open from the cache warm-up
+     * directory.
+     */
+    CACHE_WARMUP_BYTES_LOADED((byte) -0x34),
+
+    /**
+     * # of entries of the cache warm-up directory not loaded at DB open.
+     */
+    CACHE_WARMUP_ENTRIES_SKIPPED((byte) -0x35),
+
+    /**
+     * # of LRU cache lookups served from the compressed tier.
+     */
+    COMPRESSED_TIER_HITS((byte) -0x36),
+
     TICKER_ENUM_MAX((byte) 0x5F);
 
     private final byte value;
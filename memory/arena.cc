@@ -14,6 +14,7 @@
 #include <algorithm>
 
 #include "logging/logging.h"
+#include "memory/huge_page_allocator.h"
 #include "port/malloc.h"
 #include "port/port.h"
 #include "rocksdb/env.h"
@@ -55,6 +56,7 @@ Arena::Arena(size_t block_size, AllocTracker* tracker, size_t huge_page_size)
   unaligned_alloc_ptr_ = inline_block_ + alloc_bytes_remaining_;
 #ifdef MAP_HUGETLB
   hugetlb_size_ = huge_page_size;
+  huge_page_size_ = huge_page_size;
   if (hugetlb_size_ && kBlockSize > hugetlb_size_) {
     hugetlb_size_ = ((kBlockSize - 1U) / hugetlb_size_ + 1U) * hugetlb_size_;
   }
@@ -137,10 +139,22 @@ char* Arena::AllocateFromHugePage(size_t bytes) {
   //   via RAII.
   huge_blocks_.emplace_back(nullptr /* addr */, 0 /* length */);
 
-  void* addr = mmap(nullptr, bytes, (PROT_READ | PROT_WRITE),
-                    (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), -1, 0);
+  void* addr;
+  if ((huge_page_size_ & (huge_page_size_ - 1)) == 0 &&
+      bytes % huge_page_size_ == 0) {
+    // Falls back to transparent huge pages once the pages reserved for
+    // hugetlbfs run out
+    addr = HugePageMemoryAllocator::MapHugePages(bytes, huge_page_size_,
+                                                 true /* use_hugetlb */);
+  } else {
+    addr = mmap(nullptr, bytes, (PROT_READ | PROT_WRITE),
+                (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), -1, 0);
+    if (addr == MAP_FAILED) {
+      addr = nullptr;
+    }
+  }
 
-  if (addr == MAP_FAILED) {
+  if (addr == nullptr) {
     return nullptr;
   }
   huge_blocks_.back() = MmapInfo(addr, bytes);
@@ -37,7 +37,8 @@ class Arena : public Allocator {
 
   // huge_page_size: if 0, don't use huge page TLB. If > 0 (should set to the
   // supported hugepage size of the system), block allocation will try huge
-  // page TLB first. If allocation fails, will fall back to normal case.
+  // page TLB first, then transparent huge pages, see AllocateAligned(). If
+  // allocation fails, will fall back to normal case.
   explicit Arena(size_t block_size = kMinBlockSize,
                  AllocTracker* tracker = nullptr, size_t huge_page_size = 0);
   ~Arena();
@@ -52,6 +53,9 @@ class Arena : public Allocator {
   // need to reserve huge pages for it to be allocated, like:
   //     sysctl -w vm.nr_hugepages=20
   // See linux doc Documentation/vm/hugetlbpage.txt for details.
+  // When no page reserved that way is left, the memory is mapped with regular
+  // pages marked for transparent huge pages instead, see
+  // HugePageMemoryAllocator::MapHugePages().
   // huge page allocation can fail. In this case it will fail back to
   // normal cases. The messages will be logged to logger. So when calling with
   // huge_page_tlb_size > 0, we highly recommend a logger is passed in.
@@ -110,6 +114,8 @@ class Arena : public Allocator {
 
 #ifdef MAP_HUGETLB
   size_t hugetlb_size_ = 0;
+  // As passed to the constructor
+  size_t huge_page_size_ = 0;
 #endif  // MAP_HUGETLB
   char* AllocateFromHugePage(size_t bytes);
   char* AllocateFallback(size_t bytes, bool aligned);
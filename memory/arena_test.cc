@@ -196,6 +196,19 @@ TEST_F(ArenaTest, Simple) {
   SimpleTest(0);
   SimpleTest(kHugePageSize);
 }
+
+#ifdef MAP_HUGETLB
+TEST_F(ArenaTest, TransparentHugePageFallback) {
+  // Without pages reserved for hugetlbfs, blocks still take whole huge pages
+  Arena arena(Arena::kMinBlockSize, nullptr, kHugePageSize);
+  arena.AllocateAligned(Arena::kInlineSize);
+  char* p = arena.AllocateAligned(1024);
+  ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(p) % kHugePageSize);
+  ASSERT_PRED2(CheckMemoryAllocated, arena.MemoryAllocatedBytes(),
+               kHugePageSize + Arena::kInlineSize);
+  memset(p, 1, kHugePageSize);
+}
+#endif  // MAP_HUGETLB
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -0,0 +1,475 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "memory/huge_page_allocator.h"
+
+#ifndef OS_WIN
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // OS_WIN
+
+#include <algorithm>
+#include <new>
+
+#include "rocksdb/convenience.h"
+#include "rocksdb/utilities/options_type.h"
+#include "util/math.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+static std::unordered_map<std::string, OptionTypeInfo> huge_page_type_info = {
+#ifndef ROCKSDB_LITE
+    {"huge_page_size",
+     {offsetof(struct HugePageAllocatorOptions, huge_page_size),
+      OptionType::kSizeT, OptionVerificationType::kNormal,
+      OptionTypeFlags::kNone}},
+    {"use_hugetlb",
+     {offsetof(struct HugePageAllocatorOptions, use_hugetlb),
+      OptionType::kBoolean, OptionVerificationType::kNormal,
+      OptionTypeFlags::kNone}},
+#endif  // ROCKSDB_LITE
+};
+
+namespace {
+constexpr size_t kMinPooledSize = 128;
+constexpr int kMinPooledSizeLog2 = 7;
+constexpr uint32_t kUnpooled = port::kMaxUint32;
+// Slabs of larger huge pages would take too much memory per size class
+constexpr size_t kMaxHugePageSize = 32 << 20;
+constexpr size_t kMinHugePageSize = 64 << 10;
+
+// Blocks a thread caches per size class: up to 64, and up to about 64KB.
+// They are taken from and given back to the size class half of that at a
+// time.
+constexpr size_t kThreadCacheBytes = 64 << 10;
+constexpr size_t kMaxThreadCacheBlocks = 64;
+
+void*& NextBlock(void* block) { return *static_cast<void**>(block); }
+}  // namespace
+
+// Precedes the allocations of a slab, and a large allocation
+struct HugePageMemoryAllocator::SlabHeader {
+  uint32_t size_class;
+  // Whether the slab is in the list of its class of slabs with room
+  uint32_t has_room;
+  // Bytes mapped, for a large allocation
+  uint64_t mapped_size;
+  // Position in slabs_
+  size_t index;
+  // Blocks handed out and not freed
+  size_t live;
+  // Bytes handed out at least once, header included; the rest is untouched
+  size_t carved;
+  // Freed blocks, linked through their first word
+  void* free_list;
+  // Links in the list of slabs of the size class with room
+  SlabHeader* prev;
+  SlabHeader* next;
+};
+
+struct ALIGN_AS(CACHE_LINE_SIZE) HugePageMemoryAllocator::SizeClass {
+  port::Mutex mutex;
+  // The slabs with a free or untouched block
+  SlabHeader* with_room = nullptr;
+};
+
+// The blocks freed by a thread, for its next allocations
+struct HugePageMemoryAllocator::ThreadCache {
+  ThreadCache(HugePageMemoryAllocator* _allocator, uint32_t num_size_classes)
+      : allocator(_allocator),
+        blocks(new void*[num_size_classes]()),
+        num_blocks(new uint32_t[num_size_classes]()) {}
+
+  HugePageMemoryAllocator* const allocator;
+  std::unique_ptr<void*[]> blocks;
+  std::unique_ptr<uint32_t[]> num_blocks;
+};
+
+bool HugePageMemoryAllocator::IsSupported(std::string* msg) {
+#ifdef OS_WIN
+  *msg = "Huge page allocator not supported on Windows";
+  return false;
+#else
+  (void)msg;
+  return true;
+#endif  // OS_WIN
+}
+
+HugePageMemoryAllocator::HugePageMemoryAllocator(
+    const HugePageAllocatorOptions& options)
+    : options_(options) {
+  static_assert(sizeof(SlabHeader) <= kSlabHeaderSize, "");
+  RegisterOptions(&options_, &huge_page_type_info);
+#ifndef OS_WIN
+  thread_caches_.reset(new ThreadLocalPtr(&ReleaseThreadCache));
+#endif  // OS_WIN
+}
+
+HugePageMemoryAllocator::~HugePageMemoryAllocator() {
+#ifndef OS_WIN
+  // Runs ReleaseThreadCache() for the threads still alive, before the slabs
+  // are gone
+  thread_caches_.reset();
+  for (void* slab : slabs_) {
+    munmap(slab, options_.huge_page_size);
+  }
+#endif  // OS_WIN
+}
+
+Status HugePageMemoryAllocator::PrepareOptions(const ConfigOptions& options) {
+  std::string message;
+  if (!IsSupported(&message)) {
+    return Status::NotSupported(message);
+  }
+  size_t huge_page_size = options_.huge_page_size;
+  if (huge_page_size < kMinHugePageSize || huge_page_size > kMaxHugePageSize ||
+      (huge_page_size & (huge_page_size - 1)) != 0) {
+    return Status::InvalidArgument(
+        "huge_page_size must be a power of two from 64KB to 32MB");
+  }
+  if (size_classes_ == nullptr) {
+    max_pooled_size_log2_ = FloorLog2(huge_page_size) - 3;
+    max_pooled_size_ = size_t{1} << max_pooled_size_log2_;
+    num_size_classes_ =
+        static_cast<uint32_t>(1 + 8 * (max_pooled_size_log2_ -
+                                       kMinPooledSizeLog2));
+    size_classes_.reset(new SizeClass[num_size_classes_]);
+  }
+  return MemoryAllocator::PrepareOptions(options);
+}
+
+uint32_t HugePageMemoryAllocator::SizeClassOf(size_t size) const {
+  assert(size <= max_pooled_size_);
+  if (size <= kMinPooledSize) {
+    return 0;
+  }
+  // 2^log2 < size <= 2^(log2 + 1)
+  int log2 = FloorLog2(size - 1);
+  size_t step = size_t{1} << (log2 - 3);
+  size_t steps = (size - (size_t{1} << log2) + step - 1) / step;
+  return static_cast<uint32_t>(1 + 8 * (log2 - kMinPooledSizeLog2) + steps -
+                               1);
+}
+
+size_t HugePageMemoryAllocator::SizeOfClass(uint32_t size_class) const {
+  if (size_class == 0) {
+    return kMinPooledSize;
+  }
+  int log2 = kMinPooledSizeLog2 + static_cast<int>((size_class - 1) / 8);
+  size_t steps = (size_class - 1) % 8 + 1;
+  return (size_t{1} << log2) + steps * (size_t{1} << (log2 - 3));
+}
+
+size_t HugePageMemoryAllocator::GetNumMappings() const {
+  MutexLock l(&slabs_mutex_);
+  return num_mappings_;
+}
+
+size_t HugePageMemoryAllocator::GetNumHugetlbMappings() const {
+  MutexLock l(&slabs_mutex_);
+  return num_hugetlb_mappings_;
+}
+
+uint32_t HugePageMemoryAllocator::ThreadCacheLimit(uint32_t size_class) const {
+  size_t blocks = kThreadCacheBytes / SizeOfClass(size_class);
+  return static_cast<uint32_t>(
+      std::max<size_t>(2, std::min(kMaxThreadCacheBlocks, blocks)));
+}
+
+#ifndef OS_WIN
+void* HugePageMemoryAllocator::MapHugePages(size_t bytes,
+                                            size_t huge_page_size,
+                                            bool use_hugetlb, bool* hugetlb) {
+  assert((huge_page_size & (huge_page_size - 1)) == 0);
+  if (hugetlb != nullptr) {
+    *hugetlb = false;
+  }
+#ifdef MAP_HUGETLB
+  if (use_hugetlb && bytes % huge_page_size == 0) {
+    void* addr = mmap(nullptr, bytes, (PROT_READ | PROT_WRITE),
+                      (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), -1, 0);
+    if (addr != MAP_FAILED) {
+      if ((reinterpret_cast<uintptr_t>(addr) & (huge_page_size - 1)) == 0) {
+        if (hugetlb != nullptr) {
+          *hugetlb = true;
+        }
+        return addr;
+      }
+      // The default huge page size of the system is smaller
+      munmap(addr, bytes);
+    }
+  }
+#else
+  (void)use_hugetlb;
+#endif  // MAP_HUGETLB
+  // Map one more huge page than needed, and trim the ends to an aligned
+  // range
+  size_t mapped = bytes + huge_page_size;
+  void* addr = mmap(nullptr, mapped, (PROT_READ | PROT_WRITE),
+                    (MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+  uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  uintptr_t aligned = (begin + huge_page_size - 1) & ~(huge_page_size - 1);
+  if (aligned > begin) {
+    munmap(addr, aligned - begin);
+  }
+  uintptr_t end = begin + mapped;
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t aligned_end = aligned + ((bytes + page_size - 1) & ~(page_size - 1));
+  if (end > aligned_end) {
+    munmap(reinterpret_cast<void*>(aligned_end), end - aligned_end);
+  }
+#ifdef MADV_HUGEPAGE
+  // Best effort, fails where transparent huge pages are disabled
+  madvise(reinterpret_cast<void*>(aligned), bytes, MADV_HUGEPAGE);
+#endif  // MADV_HUGEPAGE
+  return reinterpret_cast<void*>(aligned);
+}
+
+char* HugePageMemoryAllocator::MapSlab(size_t bytes, bool pooled) {
+  bool hugetlb = false;
+  void* addr = MapHugePages(bytes, options_.huge_page_size,
+                            options_.use_hugetlb, &hugetlb);
+  if (addr == nullptr) {
+    throw std::bad_alloc();
+  }
+  MutexLock l(&slabs_mutex_);
+  if (pooled) {
+    reinterpret_cast<SlabHeader*>(addr)->index = slabs_.size();
+    slabs_.push_back(addr);
+  }
+  num_mappings_++;
+  if (hugetlb) {
+    num_hugetlb_mappings_++;
+  }
+  return static_cast<char*>(addr);
+}
+
+void HugePageMemoryAllocator::UnmapSlab(char* slab) {
+  {
+    MutexLock l(&slabs_mutex_);
+    size_t index = reinterpret_cast<SlabHeader*>(slab)->index;
+    reinterpret_cast<SlabHeader*>(slabs_.back())->index = index;
+    slabs_[index] = slabs_.back();
+    slabs_.pop_back();
+  }
+  munmap(slab, options_.huge_page_size);
+}
+
+uint32_t HugePageMemoryAllocator::AllocateBatch(uint32_t size_class,
+                                                uint32_t count, void** list) {
+  SizeClass& sc = size_classes_[size_class];
+  size_t class_size = SizeOfClass(size_class);
+  MutexLock l(&sc.mutex);
+  SlabHeader* slab = sc.with_room;
+  if (slab == nullptr) {
+    slab = reinterpret_cast<SlabHeader*>(
+        MapSlab(options_.huge_page_size, true /* pooled */));
+    slab->size_class = size_class;
+    slab->mapped_size = options_.huge_page_size;
+    slab->live = 0;
+    slab->carved = kSlabHeaderSize;
+    slab->free_list = nullptr;
+    LinkWithRoom(&sc, slab);
+  }
+  // From the one slab, so that a slab left with few blocks in use gets a
+  // chance to be freed
+  uint32_t taken = 0;
+  while (taken < count) {
+    char* p;
+    if (slab->free_list != nullptr) {
+      p = static_cast<char*>(slab->free_list);
+      slab->free_list = NextBlock(p);
+    } else if (slab->carved + class_size <= options_.huge_page_size) {
+      p = reinterpret_cast<char*>(slab) + slab->carved;
+      slab->carved += class_size;
+    } else {
+      break;
+    }
+    NextBlock(p) = *list;
+    *list = p;
+    slab->live++;
+    taken++;
+  }
+  if (slab->free_list == nullptr &&
+      slab->carved + class_size > options_.huge_page_size) {
+    UnlinkWithRoom(&sc, slab);
+  }
+  return taken;
+}
+
+void HugePageMemoryAllocator::DeallocateBatch(uint32_t size_class,
+                                              void* list, uint32_t count) {
+  SizeClass& sc = size_classes_[size_class];
+  MutexLock l(&sc.mutex);
+  for (uint32_t i = 0; i < count; i++) {
+    void* p = list;
+    list = NextBlock(p);
+    SlabHeader* slab = reinterpret_cast<SlabHeader*>(
+        reinterpret_cast<uintptr_t>(p) & ~(options_.huge_page_size - 1));
+    NextBlock(p) = slab->free_list;
+    slab->free_list = p;
+    slab->live--;
+    if (!slab->has_room) {
+      LinkWithRoom(&sc, slab);
+    }
+    if (slab->live == 0 && (slab->prev != nullptr || slab->next != nullptr)) {
+      // Unused, and not the last slab of its class with room, which is kept
+      // so that a class going back and forth between zero and one block does
+      // not map and unmap a slab each time
+      UnlinkWithRoom(&sc, slab);
+      UnmapSlab(reinterpret_cast<char*>(slab));
+    }
+  }
+}
+
+void HugePageMemoryAllocator::LinkWithRoom(SizeClass* sc, SlabHeader* slab) {
+  slab->prev = nullptr;
+  slab->next = sc->with_room;
+  if (slab->next != nullptr) {
+    slab->next->prev = slab;
+  }
+  sc->with_room = slab;
+  slab->has_room = 1;
+}
+
+void HugePageMemoryAllocator::UnlinkWithRoom(SizeClass* sc, SlabHeader* slab) {
+  if (slab->prev != nullptr) {
+    slab->prev->next = slab->next;
+  } else {
+    sc->with_room = slab->next;
+  }
+  if (slab->next != nullptr) {
+    slab->next->prev = slab->prev;
+  }
+  slab->prev = slab->next = nullptr;
+  slab->has_room = 0;
+}
+
+HugePageMemoryAllocator::ThreadCache*
+HugePageMemoryAllocator::GetThreadCache() {
+  ThreadCache* cache = static_cast<ThreadCache*>(thread_caches_->Get());
+  if (cache == nullptr) {
+    cache = new ThreadCache(this, num_size_classes_);
+    thread_caches_->Reset(cache);
+  }
+  return cache;
+}
+
+void HugePageMemoryAllocator::DrainThreadCache(ThreadCache* cache) {
+  for (uint32_t size_class = 0; size_class < num_size_classes_;
+       size_class++) {
+    if (cache->num_blocks[size_class] > 0) {
+      DeallocateBatch(size_class, cache->blocks[size_class],
+                      cache->num_blocks[size_class]);
+      cache->blocks[size_class] = nullptr;
+      cache->num_blocks[size_class] = 0;
+    }
+  }
+}
+
+void HugePageMemoryAllocator::ReleaseThreadCache(void* ptr) {
+  ThreadCache* cache = static_cast<ThreadCache*>(ptr);
+  cache->allocator->DrainThreadCache(cache);
+  delete cache;
+}
+
+size_t HugePageMemoryAllocator::TEST_NumSlabs() {
+  DrainThreadCache(GetThreadCache());
+  MutexLock l(&slabs_mutex_);
+  return slabs_.size();
+}
+
+void* HugePageMemoryAllocator::Allocate(size_t size) {
+  assert(size_classes_ != nullptr);
+  if (size > max_pooled_size_) {
+    // Rounded up to a whole number of huge pages if that wastes little, so
+    // that hugetlbfs can be used
+    size_t bytes = size + kSlabHeaderSize;
+    size_t huge_bytes = (bytes + options_.huge_page_size - 1) &
+                        ~(options_.huge_page_size - 1);
+    if (huge_bytes - bytes <= bytes / 8) {
+      bytes = huge_bytes;
+    }
+    char* base = MapSlab(bytes, false /* pooled */);
+    SlabHeader* header = reinterpret_cast<SlabHeader*>(base);
+    header->size_class = kUnpooled;
+    header->mapped_size = bytes;
+    return base + kSlabHeaderSize;
+  }
+
+  uint32_t size_class = SizeClassOf(size);
+  ThreadCache* cache = GetThreadCache();
+  if (cache->num_blocks[size_class] == 0) {
+    cache->num_blocks[size_class] = AllocateBatch(
+        size_class, ThreadCacheLimit(size_class) / 2,
+        &cache->blocks[size_class]);
+  }
+  void* p = cache->blocks[size_class];
+  cache->blocks[size_class] = NextBlock(p);
+  cache->num_blocks[size_class]--;
+  return p;
+}
+
+void HugePageMemoryAllocator::Deallocate(void* p) {
+  if (p == nullptr) {
+    return;
+  }
+  char* slab = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(p) &
+                                       ~(options_.huge_page_size - 1));
+  const SlabHeader* header = reinterpret_cast<const SlabHeader*>(slab);
+  if (header->size_class == kUnpooled) {
+    munmap(slab, static_cast<size_t>(header->mapped_size));
+    return;
+  }
+  uint32_t size_class = header->size_class;
+  ThreadCache* cache = GetThreadCache();
+  NextBlock(p) = cache->blocks[size_class];
+  cache->blocks[size_class] = p;
+  if (++cache->num_blocks[size_class] > ThreadCacheLimit(size_class)) {
+    // Keeps the half freed last, the most likely to still be in the CPU
+    // caches, and gives the rest back to the size class
+    uint32_t keep = cache->num_blocks[size_class] / 2;
+    void* last_kept = cache->blocks[size_class];
+    for (uint32_t i = 1; i < keep; i++) {
+      last_kept = NextBlock(last_kept);
+    }
+    void* list = NextBlock(last_kept);
+    NextBlock(last_kept) = nullptr;
+    DeallocateBatch(size_class, list, cache->num_blocks[size_class] - keep);
+    cache->num_blocks[size_class] = keep;
+  }
+}
+
+size_t HugePageMemoryAllocator::UsableSize(void* p,
+                                           size_t /*allocation_size*/) const {
+  const SlabHeader* header = reinterpret_cast<const SlabHeader*>(
+      reinterpret_cast<uintptr_t>(p) & ~(options_.huge_page_size - 1));
+  if (header->size_class == kUnpooled) {
+    return static_cast<size_t>(header->mapped_size) - kSlabHeaderSize;
+  }
+  return SizeOfClass(header->size_class);
+}
+#endif  // OS_WIN
+
+Status NewHugePageMemoryAllocator(
+    const HugePageAllocatorOptions& options,
+    std::shared_ptr<MemoryAllocator>* memory_allocator) {
+  if (memory_allocator == nullptr) {
+    return Status::InvalidArgument("memory_allocator must be non-null.");
+  }
+  std::unique_ptr<MemoryAllocator> allocator(
+      new HugePageMemoryAllocator(options));
+  Status s = allocator->PrepareOptions(ConfigOptions());
+  if (s.ok()) {
+    memory_allocator->reset(allocator.release());
+  }
+  return s;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
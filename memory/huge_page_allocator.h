@@ -0,0 +1,121 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/memory_allocator.h"
+#include "util/thread_local.h"
+#include "utilities/memory_allocators.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Allocates from slabs of huge pages, see NewHugePageMemoryAllocator().
+//
+// Each slab is one huge page, aligned to its size, and serves a single size
+// class. Its first kSlabHeaderSize bytes record the class, so that the class
+// of an allocation is found from its address, without a per allocation
+// header, and a 4KB block takes exactly 4KB. Allocations larger than an
+// eighth of a huge page are mapped on their own, also behind a header at an
+// aligned address.
+//
+// The header also keeps the free blocks of the slab and how many of its
+// blocks are in use, and a slab is unmapped once none is, unless it is the
+// last slab of its class with room. Each thread keeps up to 64 freed blocks
+// per size class, up to about 64KB, and takes them from and gives them back
+// to the size class in batches, so that threads seldom take the lock of a
+// size class.
+class HugePageMemoryAllocator : public BaseMemoryAllocator {
+ public:
+  static const char* kClassName() { return "HugePageMemoryAllocator"; }
+  const char* Name() const override { return kClassName(); }
+  static bool IsSupported() {
+    std::string unused;
+    return IsSupported(&unused);
+  }
+  static bool IsSupported(std::string* msg);
+
+  explicit HugePageMemoryAllocator(const HugePageAllocatorOptions& options);
+  ~HugePageMemoryAllocator() override;
+
+  Status PrepareOptions(const ConfigOptions& options) override;
+
+#ifndef OS_WIN
+  void* Allocate(size_t size) override;
+  void Deallocate(void* p) override;
+  size_t UsableSize(void* p, size_t allocation_size) const override;
+
+  // Maps bytes at an address aligned to huge_page_size, a power of two.
+  // Tries the huge pages reserved through hugetlbfs first if use_hugetlb,
+  // then regular pages marked for transparent huge pages. Returns nullptr if
+  // both fail, and sets *hugetlb to whether the first worked. Unmap with
+  // munmap(result, bytes).
+  static void* MapHugePages(size_t bytes, size_t huge_page_size,
+                            bool use_hugetlb, bool* hugetlb = nullptr);
+#endif  // OS_WIN
+
+  // Number of slabs and large allocations mapped so far, and how many of
+  // them are from hugetlbfs
+  size_t GetNumMappings() const;
+  size_t GetNumHugetlbMappings() const;
+
+#ifndef OS_WIN
+  // Number of slabs mapped now, after the blocks cached by the calling thread
+  // are given back
+  size_t TEST_NumSlabs();
+#endif  // OS_WIN
+
+ private:
+  struct SlabHeader;
+  struct SizeClass;
+  struct ThreadCache;
+
+  static constexpr size_t kSlabHeaderSize = 64;
+
+  uint32_t SizeClassOf(size_t size) const;
+  size_t SizeOfClass(uint32_t size_class) const;
+  // Blocks of the class a thread caches at most
+  uint32_t ThreadCacheLimit(uint32_t size_class) const;
+
+#ifndef OS_WIN
+  // Maps bytes with MapHugePages(), recorded in slabs_ if pooled
+  char* MapSlab(size_t bytes, bool pooled);
+  // Unmaps a slab of a size class, and removes it from slabs_
+  void UnmapSlab(char* slab);
+  // Pushes up to count blocks of the class onto *list, all from one slab.
+  // Returns how many.
+  uint32_t AllocateBatch(uint32_t size_class, uint32_t count, void** list);
+  // Frees count blocks of the class, linked through their first word
+  void DeallocateBatch(uint32_t size_class, void* list, uint32_t count);
+  // Requires the mutex of sc
+  void LinkWithRoom(SizeClass* sc, SlabHeader* slab);
+  void UnlinkWithRoom(SizeClass* sc, SlabHeader* slab);
+
+  ThreadCache* GetThreadCache();
+  // Gives the blocks in the cache back to their size classes
+  void DrainThreadCache(ThreadCache* cache);
+  static void ReleaseThreadCache(void* ptr);
+#endif  // OS_WIN
+
+  HugePageAllocatorOptions options_;
+  // Set by PrepareOptions()
+  int max_pooled_size_log2_ = 0;
+  size_t max_pooled_size_ = 0;
+  uint32_t num_size_classes_ = 0;
+  std::unique_ptr<SizeClass[]> size_classes_;
+
+  mutable port::Mutex slabs_mutex_;
+  // The slabs of the size classes, unmapped on destruction
+  std::vector<void*> slabs_;
+  // Per thread ThreadCache, after slabs_ so that it is released first
+  std::unique_ptr<ThreadLocalPtr> thread_caches_;
+  size_t num_mappings_ = 0;
+  size_t num_hugetlb_mappings_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -6,8 +6,11 @@
 
 #include <cstdio>
 
+#include "memory/huge_page_allocator.h"
 #include "memory/jemalloc_nodump_allocator.h"
 #include "memory/memkind_kmem_allocator.h"
+#include "memory/numa_memory_allocator.h"
+#include "port/port.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/convenience.h"
 #include "rocksdb/db.h"
@@ -212,6 +215,172 @@ TEST_F(CreateMemoryAllocatorTest, NewJemallocNodumpAllocator) {
   ASSERT_EQ(opts->limit_tcache_size, jopts.limit_tcache_size);
 }
 
+TEST_F(CreateMemoryAllocatorTest, NewNumaMemoryAllocator) {
+  std::shared_ptr<MemoryAllocator> allocator;
+  ASSERT_NOK(NewNumaMemoryAllocator(nullptr));
+  Status s = NewNumaMemoryAllocator(&allocator);
+  if (!NumaMemoryAllocator::IsSupported()) {
+    ASSERT_TRUE(s.IsNotSupported());
+    ROCKSDB_GTEST_BYPASS("NUMA not supported");
+    return;
+  }
+  ASSERT_OK(s);
+  ASSERT_NE(allocator, nullptr);
+
+  // Pooled sizes of every class, and sizes mapped directly
+  std::vector<std::pair<char*, size_t>> blocks;
+  for (size_t size = 1; size <= (1 << 20); size = size * 5 / 4 + 1) {
+    char* p = static_cast<char*>(allocator->Allocate(size));
+    ASSERT_NE(p, nullptr);
+    ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(p) % 16);
+    size_t usable = allocator->UsableSize(p, size);
+    ASSERT_GE(usable, size);
+    ASSERT_LE(usable, size * 5 / 4 + 64);
+    memset(p, static_cast<int>(blocks.size()), usable);
+    blocks.emplace_back(p, size);
+  }
+  for (size_t i = 0; i < blocks.size(); i++) {
+    ASSERT_EQ(static_cast<char>(i), blocks[i].first[blocks[i].second - 1]);
+    allocator->Deallocate(blocks[i].first);
+  }
+  // A freed block is reused for the same size class
+  void* p = allocator->Allocate(3000);
+  allocator->Deallocate(p);
+  ASSERT_EQ(p, allocator->Allocate(2900));
+  allocator->Deallocate(p);
+
+#ifdef NUMA
+  // Chunks whose blocks are all freed are unmapped, except for one per size
+  // class
+  auto* numa_allocator = static_cast<NumaMemoryAllocator*>(allocator.get());
+  size_t num_chunks = numa_allocator->TEST_NumChunks();
+  std::vector<void*> pooled;
+  // Three chunks' worth of 1KB blocks
+  for (int i = 0; i < 3 * 2048; i++) {
+    pooled.push_back(allocator->Allocate(1000));
+  }
+  ASSERT_GE(numa_allocator->TEST_NumChunks(), num_chunks + 2);
+  for (void* block : pooled) {
+    allocator->Deallocate(block);
+  }
+  ASSERT_LE(numa_allocator->TEST_NumChunks(), num_chunks + 1);
+
+  // Blocks cached by a thread are given back when it exits, whichever
+  // thread freed them
+  pooled.clear();
+  port::Thread allocating_thread([&]() {
+    for (int i = 0; i < 3 * 2048; i++) {
+      pooled.push_back(allocator->Allocate(1000));
+    }
+    for (size_t i = 0; i < pooled.size(); i += 2) {
+      allocator->Deallocate(pooled[i]);
+    }
+  });
+  allocating_thread.join();
+  for (size_t i = 1; i < pooled.size(); i += 2) {
+    allocator->Deallocate(pooled[i]);
+  }
+  ASSERT_LE(numa_allocator->TEST_NumChunks(), num_chunks + 1);
+#endif  // NUMA
+}
+
+TEST_F(CreateMemoryAllocatorTest, NewHugePageMemoryAllocator) {
+  HugePageAllocatorOptions hopts;
+  std::shared_ptr<MemoryAllocator> allocator;
+  ASSERT_NOK(NewHugePageMemoryAllocator(hopts, nullptr));
+  if (!HugePageMemoryAllocator::IsSupported()) {
+    ASSERT_TRUE(NewHugePageMemoryAllocator(hopts, &allocator).IsNotSupported());
+    ROCKSDB_GTEST_BYPASS("Huge page allocator not supported");
+    return;
+  }
+  hopts.huge_page_size = 3 << 20;
+  ASSERT_NOK(NewHugePageMemoryAllocator(hopts, &allocator));
+
+  // Hosts running the test have no pages reserved for hugetlbfs, except by
+  // chance
+  hopts.huge_page_size = 2 << 20;
+  hopts.use_hugetlb = false;
+  ASSERT_OK(NewHugePageMemoryAllocator(hopts, &allocator));
+  ASSERT_NE(allocator, nullptr);
+  auto opts = allocator->GetOptions<HugePageAllocatorOptions>();
+  ASSERT_NE(opts, nullptr);
+  ASSERT_EQ(opts->huge_page_size, hopts.huge_page_size);
+  auto huge_page_allocator =
+      static_cast<HugePageMemoryAllocator*>(allocator.get());
+
+  // Powers of two take no more than asked for
+  for (size_t size = 128; size <= (256 << 10); size *= 2) {
+    void* p = allocator->Allocate(size);
+    ASSERT_EQ(size, allocator->UsableSize(p, size));
+    allocator->Deallocate(p);
+  }
+
+  // Pooled sizes of every class, and sizes mapped directly
+  std::vector<std::pair<char*, size_t>> blocks;
+  for (size_t size = 1; size <= (8 << 20); size = size * 9 / 8 + 1) {
+    char* p = static_cast<char*>(allocator->Allocate(size));
+    ASSERT_NE(p, nullptr);
+    ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(p) % 16);
+    size_t usable = allocator->UsableSize(p, size);
+    ASSERT_GE(usable, size);
+    if (size > 128) {
+      ASSERT_LE(usable, size * 9 / 8 + 16);
+    }
+    memset(p, static_cast<int>(blocks.size()), usable);
+    blocks.emplace_back(p, size);
+  }
+  size_t num_mappings = huge_page_allocator->GetNumMappings();
+  ASSERT_GT(num_mappings, 0U);
+  ASSERT_EQ(0U, huge_page_allocator->GetNumHugetlbMappings());
+  for (size_t i = 0; i < blocks.size(); i++) {
+    ASSERT_EQ(static_cast<char>(i), blocks[i].first[blocks[i].second - 1]);
+    allocator->Deallocate(blocks[i].first);
+  }
+
+  // A freed block is reused for the same size class, from the same slab
+  void* p = allocator->Allocate(4000);
+  allocator->Deallocate(p);
+  ASSERT_EQ(p, allocator->Allocate(3900));
+  void* q = allocator->Allocate(3900);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(p) >> 21,
+            reinterpret_cast<uintptr_t>(q) >> 21);
+  allocator->Deallocate(q);
+  allocator->Deallocate(p);
+
+#ifndef OS_WIN
+  // Slabs whose blocks are all freed are unmapped, except for one per size
+  // class
+  size_t num_slabs = huge_page_allocator->TEST_NumSlabs();
+  std::vector<void*> pooled;
+  // Three slabs' worth of 4KB blocks
+  for (int i = 0; i < 3 * 512; i++) {
+    pooled.push_back(allocator->Allocate(4096));
+  }
+  ASSERT_GE(huge_page_allocator->TEST_NumSlabs(), num_slabs + 2);
+  for (void* block : pooled) {
+    allocator->Deallocate(block);
+  }
+  ASSERT_LE(huge_page_allocator->TEST_NumSlabs(), num_slabs + 1);
+
+  // Blocks cached by a thread are given back when it exits, whichever
+  // thread freed them
+  pooled.clear();
+  port::Thread allocating_thread([&]() {
+    for (int i = 0; i < 3 * 512; i++) {
+      pooled.push_back(allocator->Allocate(4096));
+    }
+    for (size_t i = 0; i < pooled.size(); i += 2) {
+      allocator->Deallocate(pooled[i]);
+    }
+  });
+  allocating_thread.join();
+  for (size_t i = 1; i < pooled.size(); i += 2) {
+    allocator->Deallocate(pooled[i]);
+  }
+  ASSERT_LE(huge_page_allocator->TEST_NumSlabs(), num_slabs + 1);
+#endif  // OS_WIN
+}
+
 INSTANTIATE_TEST_CASE_P(DefaultMemoryAllocator, MemoryAllocatorTest,
                         ::testing::Values(std::make_tuple(
                             DefaultMemoryAllocator::kClassName(), true)));
@@ -222,6 +391,18 @@ INSTANTIATE_TEST_CASE_P(
                                       MemkindKmemAllocator::IsSupported())));
 #endif  // MEMKIND
 
+INSTANTIATE_TEST_CASE_P(
+    HugePageMemoryAllocator, MemoryAllocatorTest,
+    ::testing::Values(std::make_tuple(HugePageMemoryAllocator::kClassName(),
+                                      HugePageMemoryAllocator::IsSupported())));
+
+#ifdef NUMA
+INSTANTIATE_TEST_CASE_P(
+    NumaMemoryAllocator, MemoryAllocatorTest,
+    ::testing::Values(std::make_tuple(NumaMemoryAllocator::kClassName(),
+                                      NumaMemoryAllocator::IsSupported())));
+#endif  // NUMA
+
 #ifdef ROCKSDB_JEMALLOC
 INSTANTIATE_TEST_CASE_P(
     JemallocNodumpAllocator, MemoryAllocatorTest,
@@ -0,0 +1,416 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "memory/numa_memory_allocator.h"
+
+#ifdef NUMA
+#include <numa.h>
+#endif  // NUMA
+
+#include <algorithm>
+#include <array>
+#include <new>
+
+#include "port/port.h"
+#include "rocksdb/convenience.h"
+#include "util/math.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+#ifdef NUMA
+namespace {
+struct Chunk;
+
+// Precedes every allocation. Keeps the user pointer 16-byte aligned.
+struct AllocationHeader {
+  uint32_t node;
+  uint32_t size_class;
+  union {
+    // Bytes mapped, for an allocation not from a pool
+    uint64_t mapped_size;
+    // The chunk of a pooled allocation
+    Chunk* chunk;
+  };
+};
+static_assert(sizeof(AllocationHeader) == 16, "unexpected header size");
+
+constexpr size_t kHeaderSize = sizeof(AllocationHeader);
+constexpr size_t kMinPooledSize = 64;
+constexpr int kMinPooledSizeLog2 = 6;
+// Sizes up to this (header included) are pooled, in four classes per power
+// of two, which wastes at most a fifth of each allocation
+constexpr size_t kMaxPooledSize = 256 << 10;
+constexpr int kMaxPooledSizeLog2 = 18;
+constexpr uint32_t kNumSizeClasses =
+    1 + 4 * (kMaxPooledSizeLog2 - kMinPooledSizeLog2);
+constexpr uint32_t kUnpooled = kNumSizeClasses;
+// Pools grow by chunks of this size, each serving a single size class
+constexpr size_t kChunkSize = 2 << 20;
+
+struct Chunk {
+  char* base;
+  uint32_t size_class;
+  // Position in NodePool::chunks
+  size_t index;
+  // Blocks handed out and not freed
+  size_t live = 0;
+  // Bytes handed out at least once; the rest is untouched
+  size_t carved = 0;
+  // Freed blocks, linked through their first word
+  void* free_list = nullptr;
+  // Links in the list of chunks of the size class with a free block
+  Chunk* prev = nullptr;
+  Chunk* next = nullptr;
+  bool has_room = false;
+};
+
+uint32_t SizeClassOf(size_t size) {
+  assert(size <= kMaxPooledSize);
+  if (size <= kMinPooledSize) {
+    return 0;
+  }
+  // 2^log2 < size <= 2^(log2 + 1)
+  int log2 = FloorLog2(size - 1);
+  size_t step = size_t{1} << (log2 - 2);
+  size_t steps = (size - (size_t{1} << log2) + step - 1) / step;
+  return static_cast<uint32_t>(1 + 4 * (log2 - kMinPooledSizeLog2) + steps -
+                               1);
+}
+
+size_t SizeOfClass(uint32_t size_class) {
+  if (size_class == 0) {
+    return kMinPooledSize;
+  }
+  int log2 = kMinPooledSizeLog2 + static_cast<int>((size_class - 1) / 4);
+  size_t steps = (size_class - 1) % 4 + 1;
+  return (size_t{1} << log2) + steps * (size_t{1} << (log2 - 2));
+}
+
+// Blocks a thread caches per size class: up to 64, and up to about 64KB.
+// The pool is refilled and drained by half of that at a time.
+constexpr size_t kThreadCacheBytes = 64 << 10;
+constexpr uint32_t kMaxThreadCacheBlocks = 64;
+
+uint32_t ThreadCacheLimit(uint32_t size_class) {
+  size_t blocks = kThreadCacheBytes / SizeOfClass(size_class);
+  return static_cast<uint32_t>(
+      std::max<size_t>(2, std::min<size_t>(kMaxThreadCacheBlocks, blocks)));
+}
+
+// Free blocks are linked through the first word of their header, which
+// leaves AllocationHeader::chunk in place
+void*& NextBlock(void* block) { return *static_cast<void**>(block); }
+}  // namespace
+
+// The free blocks of a thread, all on one node, for its next allocations
+struct NumaMemoryAllocator::ThreadCache {
+  explicit ThreadCache(NumaMemoryAllocator* _allocator)
+      : allocator(_allocator) {
+    blocks.fill(nullptr);
+    num_blocks.fill(0);
+  }
+
+  NumaMemoryAllocator* const allocator;
+  // The node of the cached blocks, -1 if none was set yet
+  int node = -1;
+  std::array<void*, kNumSizeClasses> blocks;
+  std::array<uint32_t, kNumSizeClasses> num_blocks;
+};
+
+struct NumaMemoryAllocator::NodePool {
+  explicit NodePool(int _node) : node(_node) { with_room.fill(nullptr); }
+
+  ~NodePool() {
+    for (Chunk* chunk : chunks) {
+      numa_free(chunk->base, kChunkSize);
+      delete chunk;
+    }
+  }
+
+  // Takes up to count blocks of size_class and links them into *list.
+  // Returns how many were taken, at least one.
+  uint32_t AllocateBatch(uint32_t size_class, uint32_t count, void** list) {
+    size_t size = SizeOfClass(size_class);
+    MutexLock l(&mutex);
+    Chunk* chunk = with_room[size_class];
+    if (chunk == nullptr) {
+      chunk = new Chunk;
+      chunk->base = static_cast<char*>(numa_alloc_onnode(kChunkSize, node));
+      if (chunk->base == nullptr) {
+        delete chunk;
+        throw std::bad_alloc();
+      }
+      chunk->size_class = size_class;
+      chunk->index = chunks.size();
+      chunks.push_back(chunk);
+      LinkWithRoom(chunk);
+    }
+    // From the one chunk, so that a chunk left with few blocks in use gets
+    // a chance to be freed
+    uint32_t taken = 0;
+    while (taken < count) {
+      char* result;
+      if (chunk->free_list != nullptr) {
+        result = static_cast<char*>(chunk->free_list);
+        chunk->free_list = NextBlock(result);
+      } else if (chunk->carved + size <= kChunkSize) {
+        result = chunk->base + chunk->carved;
+        chunk->carved += size;
+      } else {
+        break;
+      }
+      reinterpret_cast<AllocationHeader*>(result)->chunk = chunk;
+      NextBlock(result) = *list;
+      *list = result;
+      chunk->live++;
+      taken++;
+    }
+    if (chunk->free_list == nullptr && chunk->carved + size > kChunkSize) {
+      UnlinkWithRoom(chunk);
+    }
+    return taken;
+  }
+
+  // Returns the count blocks linked from list
+  void DeallocateBatch(void* list, uint32_t count) {
+    MutexLock l(&mutex);
+    for (uint32_t i = 0; i < count; i++) {
+      char* p = static_cast<char*>(list);
+      list = NextBlock(p);
+      Deallocate(p, reinterpret_cast<AllocationHeader*>(p)->chunk);
+    }
+  }
+
+  // REQUIRES: mutex held
+  void Deallocate(char* p, Chunk* chunk) {
+    NextBlock(p) = chunk->free_list;
+    chunk->free_list = p;
+    chunk->live--;
+    if (!chunk->has_room) {
+      LinkWithRoom(chunk);
+    }
+    if (chunk->live == 0 &&
+        (chunk->prev != nullptr || chunk->next != nullptr)) {
+      // Unused, and not the last chunk of its class with room, which is kept
+      // so that a class going back and forth between zero and one block does
+      // not map and unmap a chunk each time
+      UnlinkWithRoom(chunk);
+      chunks.back()->index = chunk->index;
+      chunks[chunk->index] = chunks.back();
+      chunks.pop_back();
+      numa_free(chunk->base, kChunkSize);
+      delete chunk;
+    }
+  }
+
+  size_t NumChunks() {
+    MutexLock l(&mutex);
+    return chunks.size();
+  }
+
+  // REQUIRES: mutex held
+  void LinkWithRoom(Chunk* chunk) {
+    chunk->prev = nullptr;
+    chunk->next = with_room[chunk->size_class];
+    if (chunk->next != nullptr) {
+      chunk->next->prev = chunk;
+    }
+    with_room[chunk->size_class] = chunk;
+    chunk->has_room = true;
+  }
+
+  // REQUIRES: mutex held
+  void UnlinkWithRoom(Chunk* chunk) {
+    if (chunk->prev != nullptr) {
+      chunk->prev->next = chunk->next;
+    } else {
+      with_room[chunk->size_class] = chunk->next;
+    }
+    if (chunk->next != nullptr) {
+      chunk->next->prev = chunk->prev;
+    }
+    chunk->prev = chunk->next = nullptr;
+    chunk->has_room = false;
+  }
+
+  const int node;
+  port::Mutex mutex;
+  // Per size class, the chunks with a free or untouched block
+  std::array<Chunk*, kNumSizeClasses> with_room;
+  std::vector<Chunk*> chunks;
+};
+#endif  // NUMA
+
+bool NumaMemoryAllocator::IsSupported(std::string* msg) {
+#ifdef NUMA
+  if (numa_available() == -1) {
+    *msg = "NUMA is not supported by the system";
+    return false;
+  }
+  return true;
+#else
+  *msg = "Not compiled with NUMA";
+  return false;
+#endif  // NUMA
+}
+
+NumaMemoryAllocator::NumaMemoryAllocator() {
+#ifdef NUMA
+  if (IsSupported()) {
+    for (int node = 0; node < port::NumaNodeCount(); node++) {
+      pools_.emplace_back(new NodePool(node));
+    }
+    thread_caches_.reset(new ThreadLocalPtr(&ReleaseThreadCache));
+  }
+#endif  // NUMA
+}
+
+NumaMemoryAllocator::~NumaMemoryAllocator() {}
+
+Status NumaMemoryAllocator::PrepareOptions(const ConfigOptions& options) {
+  std::string message;
+  if (!IsSupported(&message)) {
+    return Status::NotSupported(message);
+  } else {
+    return MemoryAllocator::PrepareOptions(options);
+  }
+}
+
+#ifdef NUMA
+void* NumaMemoryAllocator::Allocate(size_t size) {
+  assert(!pools_.empty());
+  size_t total_size = size + kHeaderSize;
+  int node = port::NumaNodeID();
+  char* base;
+  uint32_t size_class;
+  if (total_size > kMaxPooledSize) {
+    base = static_cast<char*>(numa_alloc_onnode(total_size, node));
+    if (base == nullptr) {
+      throw std::bad_alloc();
+    }
+    size_class = kUnpooled;
+  } else {
+    size_class = SizeClassOf(total_size);
+    ThreadCache* cache = GetThreadCache();
+    if (cache->node != node) {
+      // The thread moved to another node
+      DrainThreadCache(cache);
+      cache->node = node;
+    }
+    if (cache->num_blocks[size_class] == 0) {
+      cache->num_blocks[size_class] = pools_[node]->AllocateBatch(
+          size_class, ThreadCacheLimit(size_class) / 2,
+          &cache->blocks[size_class]);
+    }
+    base = static_cast<char*>(cache->blocks[size_class]);
+    cache->blocks[size_class] = NextBlock(base);
+    cache->num_blocks[size_class]--;
+  }
+  AllocationHeader* header = reinterpret_cast<AllocationHeader*>(base);
+  header->node = static_cast<uint32_t>(node);
+  header->size_class = size_class;
+  if (size_class == kUnpooled) {
+    header->mapped_size = total_size;
+  }
+  return base + kHeaderSize;
+}
+
+void NumaMemoryAllocator::Deallocate(void* p) {
+  if (p == nullptr) {
+    return;
+  }
+  char* base = static_cast<char*>(p) - kHeaderSize;
+  const AllocationHeader* header =
+      reinterpret_cast<const AllocationHeader*>(base);
+  if (header->size_class == kUnpooled) {
+    numa_free(base, static_cast<size_t>(header->mapped_size));
+    return;
+  }
+  int node = static_cast<int>(header->node);
+  uint32_t size_class = header->size_class;
+  ThreadCache* cache = GetThreadCache();
+  if (cache->node != node) {
+    NextBlock(base) = nullptr;
+    pools_[node]->DeallocateBatch(base, 1);
+    return;
+  }
+  NextBlock(base) = cache->blocks[size_class];
+  cache->blocks[size_class] = base;
+  if (++cache->num_blocks[size_class] > ThreadCacheLimit(size_class)) {
+    // Keeps the half freed last, the most likely to still be in the CPU
+    // caches, and gives the rest back to the pool
+    uint32_t keep = cache->num_blocks[size_class] / 2;
+    void* last_kept = cache->blocks[size_class];
+    for (uint32_t i = 1; i < keep; i++) {
+      last_kept = NextBlock(last_kept);
+    }
+    void* list = NextBlock(last_kept);
+    NextBlock(last_kept) = nullptr;
+    pools_[node]->DeallocateBatch(list, cache->num_blocks[size_class] - keep);
+    cache->num_blocks[size_class] = keep;
+  }
+}
+
+NumaMemoryAllocator::ThreadCache* NumaMemoryAllocator::GetThreadCache() {
+  ThreadCache* cache = static_cast<ThreadCache*>(thread_caches_->Get());
+  if (cache == nullptr) {
+    cache = new ThreadCache(this);
+    thread_caches_->Reset(cache);
+  }
+  return cache;
+}
+
+void NumaMemoryAllocator::DrainThreadCache(ThreadCache* cache) {
+  for (uint32_t size_class = 0; size_class < kNumSizeClasses; size_class++) {
+    if (cache->num_blocks[size_class] > 0) {
+      pools_[cache->node]->DeallocateBatch(cache->blocks[size_class],
+                                           cache->num_blocks[size_class]);
+      cache->blocks[size_class] = nullptr;
+      cache->num_blocks[size_class] = 0;
+    }
+  }
+}
+
+void NumaMemoryAllocator::ReleaseThreadCache(void* ptr) {
+  ThreadCache* cache = static_cast<ThreadCache*>(ptr);
+  cache->allocator->DrainThreadCache(cache);
+  delete cache;
+}
+
+size_t NumaMemoryAllocator::UsableSize(void* p,
+                                       size_t /*allocation_size*/) const {
+  const AllocationHeader* header = reinterpret_cast<const AllocationHeader*>(
+      static_cast<char*>(p) - kHeaderSize);
+  if (header->size_class == kUnpooled) {
+    return static_cast<size_t>(header->mapped_size) - kHeaderSize;
+  }
+  return SizeOfClass(header->size_class) - kHeaderSize;
+}
+
+size_t NumaMemoryAllocator::TEST_NumChunks() {
+  DrainThreadCache(GetThreadCache());
+  size_t num_chunks = 0;
+  for (const auto& pool : pools_) {
+    num_chunks += pool->NumChunks();
+  }
+  return num_chunks;
+}
+#endif  // NUMA
+
+Status NewNumaMemoryAllocator(
+    std::shared_ptr<MemoryAllocator>* memory_allocator) {
+  if (memory_allocator == nullptr) {
+    return Status::InvalidArgument("memory_allocator must be non-null.");
+  }
+  std::unique_ptr<MemoryAllocator> allocator(new NumaMemoryAllocator());
+  Status s = allocator->PrepareOptions(ConfigOptions());
+  if (s.ok()) {
+    memory_allocator->reset(allocator.release());
+  }
+  return s;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,71 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "rocksdb/memory_allocator.h"
+#include "util/thread_local.h"
+#include "utilities/memory_allocators.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Allocates on the NUMA node of the calling thread, see
+// NewNumaMemoryAllocator().
+//
+// Each node has its own pool, backed by chunks of memory bound to the node.
+// Allocations up to kMaxPooledSize are rounded up to one of a few size
+// classes per power of two, each served by its own chunks. Freed blocks are
+// kept on a free list of their chunk for reuse, and a chunk is returned to
+// the system once all its blocks are freed, unless it is the last chunk of
+// its class with room. Larger allocations are mapped on the node directly.
+//
+// Each thread keeps a few of the blocks it freed per size class, to serve
+// its next allocations without locking. It takes blocks from and gives
+// them back to the pool of its node in batches, so that the pool mutex is
+// taken once per batch rather than once per block.
+class NumaMemoryAllocator : public BaseMemoryAllocator {
+ public:
+  static const char* kClassName() { return "NumaMemoryAllocator"; }
+  const char* Name() const override { return kClassName(); }
+  static bool IsSupported() {
+    std::string unused;
+    return IsSupported(&unused);
+  }
+  static bool IsSupported(std::string* msg);
+
+  NumaMemoryAllocator();
+  ~NumaMemoryAllocator() override;
+
+  Status PrepareOptions(const ConfigOptions& options) override;
+
+#ifdef NUMA
+  void* Allocate(size_t size) override;
+  void Deallocate(void* p) override;
+  size_t UsableSize(void* p, size_t allocation_size) const override;
+
+  // Chunks currently mapped by the pools of all nodes, after giving back
+  // the blocks cached by the calling thread
+  size_t TEST_NumChunks();
+
+ private:
+  struct NodePool;
+  struct ThreadCache;
+
+  ThreadCache* GetThreadCache();
+  // Gives all the blocks of cache back to the pool of its node
+  void DrainThreadCache(ThreadCache* cache);
+  // Unref handler of thread_caches_
+  static void ReleaseThreadCache(void* ptr);
+
+  std::vector<std::unique_ptr<NodePool>> pools_;
+  // Destroyed first, giving back the blocks cached by every thread
+  std::unique_ptr<ThreadLocalPtr> thread_caches_;
+#endif  // NUMA
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,682 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include <algorithm>
+#include <atomic>
+
+#include "db/memtable.h"
+#include "memory/allocator.h"
+#include "memory/arena.h"
+#include "port/port.h"
+#include "rocksdb/memtablerep.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+// A B+tree of the memtable entries with optimistic lock coupling, see
+// "The ART of Practical Synchronization" (Leis et al., DaMoN 2016).
+//
+// Each node has a version, whose lowest bit is a write lock. Readers do not
+// lock: they remember the version of a node before reading it and restart
+// from the root if it changed afterwards. Writers lock only the nodes they
+// change, the leaf of the new entry, and the parent on a split. Full inner
+// nodes are split on the way down, so that a split never propagates up.
+//
+// Nodes are allocated from the memtable arena and never freed or merged, so
+// a reader can safely follow a stale pointer before it detects the change,
+// and the entries only ever move to the right.
+class BTreeRep : public MemTableRep {
+ public:
+  BTreeRep(const MemTableRep::KeyComparator& compare, Allocator* allocator);
+
+  void Insert(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKey(KeyHandle handle) override {
+    return Insert(static_cast<const char*>(handle), nullptr);
+  }
+
+  void InsertWithHint(KeyHandle handle, void** hint) override {
+    InsertKeyWithHint(handle, hint);
+  }
+
+  // The hint is the leaf of the last insert
+  bool InsertKeyWithHint(KeyHandle handle, void** hint) override {
+    Leaf* leaf = static_cast<Leaf*>(*hint);
+    bool res = Insert(static_cast<const char*>(handle), &leaf);
+    *hint = leaf;
+    return res;
+  }
+
+  void InsertWithHintConcurrently(KeyHandle handle, void** hint) override {
+    InsertKeyWithHintConcurrently(handle, hint);
+  }
+
+  // The caller frees the hint with delete[], see MemTableInserter
+  bool InsertKeyWithHintConcurrently(KeyHandle handle, void** hint) override {
+    if (*hint == nullptr) {
+      *hint = new char[sizeof(Leaf*)]();
+    }
+    return Insert(static_cast<const char*>(handle),
+                  reinterpret_cast<Leaf**>(*hint));
+  }
+
+  void InsertConcurrently(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKeyConcurrently(KeyHandle handle) override {
+    return InsertKey(handle);
+  }
+
+  bool Contains(const char* key) const override;
+
+  size_t ApproximateMemoryUsage() override {
+    // All memory is allocated from the allocator
+    return 0;
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  ~BTreeRep() override {}
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override;
+
+ private:
+  static constexpr uint16_t kLeafCapacity = 32;
+  static constexpr uint16_t kInnerCapacity = 32;
+
+  struct Node {
+    explicit Node(bool _leaf) : version(0), count(0), leaf(_leaf) {}
+
+    // Odd while locked
+    std::atomic<uint64_t> version;
+    // Number of keys
+    std::atomic<uint16_t> count;
+    const bool leaf;
+  };
+
+  struct Leaf : public Node {
+    Leaf() : Node(true), next(nullptr) {
+      for (auto& key : keys) {
+        key.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    std::atomic<const char*> keys[kLeafCapacity];
+    // The leaf to the right. The first key of a leaf other than the leftmost
+    // one never changes.
+    std::atomic<Leaf*> next;
+  };
+
+  // children[i] has the keys >= keys[i - 1] and < keys[i]
+  struct Inner : public Node {
+    Inner() : Node(false) {
+      for (auto& key : keys) {
+        key.store(nullptr, std::memory_order_relaxed);
+      }
+      for (auto& child : children) {
+        child.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    std::atomic<const char*> keys[kInnerCapacity];
+    std::atomic<Node*> children[kInnerCapacity + 1];
+  };
+
+  // A consistent copy of the keys of a leaf, and its next leaf
+  struct LeafCopy {
+    const char* keys[kLeafCapacity];
+    uint16_t count = 0;
+    Leaf* next = nullptr;
+  };
+
+  // How to pick the child of an inner node on the way down
+  enum Descent {
+    // The leaf where a key >= target starts, or where target goes
+    kSeek,
+    // The leaf of the last key < target
+    kLessThan,
+    kFirst,
+    kLast,
+  };
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const BTreeRep* rep) : rep_(rep), pos_(0) {}
+
+    ~Iterator() override {}
+
+    bool Valid() const override { return pos_ < leaf_.count; }
+
+    const char* key() const override {
+      assert(Valid());
+      return leaf_.keys[pos_];
+    }
+
+    void Next() override {
+      assert(Valid());
+      if (++pos_ == leaf_.count) {
+        NextLeaf();
+      }
+    }
+
+    void Prev() override {
+      assert(Valid());
+      if (pos_ > 0) {
+        --pos_;
+      } else {
+        SeekLessThan(leaf_.keys[0]);
+      }
+    }
+
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      const char* target = (memtable_key != nullptr)
+                               ? memtable_key
+                               : EncodeKey(&tmp_, internal_key);
+      rep_->FindLeaf(target, kSeek, &leaf_);
+      pos_ = rep_->LowerBound(leaf_.keys, leaf_.count, target);
+      if (pos_ == leaf_.count) {
+        NextLeaf();
+      }
+    }
+
+    void SeekForPrev(const Slice& internal_key,
+                     const char* memtable_key) override {
+      const char* target = (memtable_key != nullptr)
+                               ? memtable_key
+                               : EncodeKey(&tmp_, internal_key);
+      Seek(Slice(), target);
+      if (!Valid()) {
+        SeekToLast();
+      }
+      while (Valid() && rep_->compare_(key(), target) > 0) {
+        Prev();
+      }
+    }
+
+    void SeekToFirst() override {
+      rep_->FindLeaf(nullptr, kFirst, &leaf_);
+      pos_ = 0;
+      if (pos_ == leaf_.count) {
+        NextLeaf();
+      }
+    }
+
+    void SeekToLast() override {
+      rep_->FindLeaf(nullptr, kLast, &leaf_);
+      // Only an empty tree has an empty rightmost leaf
+      pos_ = leaf_.count > 0 ? static_cast<uint16_t>(leaf_.count - 1) : 0;
+    }
+
+   private:
+    // Moves to the first key of the next non-empty leaf, if any
+    void NextLeaf() {
+      do {
+        if (leaf_.next == nullptr) {
+          leaf_.count = 0;
+          break;
+        }
+        rep_->CopyLeaf(leaf_.next, &leaf_);
+      } while (leaf_.count == 0);
+      pos_ = 0;
+    }
+
+    void SeekLessThan(const char* target) {
+      rep_->FindLeaf(target, kLessThan, &leaf_);
+      uint16_t pos = rep_->LowerBound(leaf_.keys, leaf_.count, target);
+      // On the way down, a child other than the first one has a key < target
+      // in its leftmost leaf, the key of its separator. So if there is none
+      // here, there is none at all.
+      if (pos == 0) {
+        leaf_.count = 0;
+        pos_ = 0;
+      } else {
+        pos_ = static_cast<uint16_t>(pos - 1);
+      }
+    }
+
+    const BTreeRep* rep_;
+    LeafCopy leaf_;
+    uint16_t pos_;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+
+  Leaf* NewLeaf() {
+    return new (allocator_->AllocateAligned(sizeof(Leaf))) Leaf();
+  }
+
+  Inner* NewInner() {
+    return new (allocator_->AllocateAligned(sizeof(Inner))) Inner();
+  }
+
+  // Returns the version of node to validate the reads with, or sets
+  // *restart if it is locked
+  static uint64_t ReadLock(const Node* node, bool* restart) {
+    uint64_t version = node->version.load(std::memory_order_acquire);
+    if (version & 1) {
+      port::AsmVolatilePause();
+      *restart = true;
+    }
+    return version;
+  }
+
+  // Whether node did not change since ReadLock() returned version
+  static bool Validate(const Node* node, uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return node->version.load(std::memory_order_relaxed) == version;
+  }
+
+  // Locks node for writing if it did not change since ReadLock() returned
+  // version
+  static bool UpgradeToWriteLock(Node* node, uint64_t version) {
+    if (!node->version.compare_exchange_strong(version, version + 1,
+                                               std::memory_order_acquire)) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+
+  static void WriteUnlock(Node* node) {
+    node->version.fetch_add(1, std::memory_order_release);
+  }
+
+  // Number of keys < key, or <= key if upper, of a node. The keys may be
+  // inconsistent under concurrent writes, which the caller detects by the
+  // version of the node.
+  template <typename Keys>
+  uint16_t LowerBound(const Keys& keys, uint16_t count, const char* key,
+                      bool upper = false) const {
+    uint16_t lo = 0;
+    uint16_t hi = count;
+    while (lo < hi) {
+      uint16_t mid = static_cast<uint16_t>((lo + hi) / 2);
+      const char* mid_key = Load(keys[mid]);
+      if (mid_key == nullptr) {
+        // Seen before the write of the key, the version will have changed
+        return lo;
+      }
+      int cmp = compare_(mid_key, key);
+      if (cmp < 0 || (upper && cmp == 0)) {
+        lo = static_cast<uint16_t>(mid + 1);
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  static const char* Load(const char* key) { return key; }
+  static const char* Load(const std::atomic<const char*>& key) {
+    return key.load(std::memory_order_acquire);
+  }
+
+  static uint16_t Count(const Node* node, uint16_t capacity) {
+    return std::min(node->count.load(std::memory_order_acquire), capacity);
+  }
+
+  // Copies the leaf to *copy, consistently
+  void CopyLeaf(Leaf* leaf, LeafCopy* copy) const;
+
+  // Finds and copies the leaf to start from for the descent
+  void FindLeaf(const char* target, Descent descent, LeafCopy* copy) const;
+
+  // Inserts key unless it exists. If hint is not null, *hint is tried
+  // first, and set to the leaf of key.
+  bool Insert(const char* key, Leaf** hint);
+
+  // Inserts key to the hinted leaf, if key belongs to it and it has room.
+  // Sets *done and returns the result of the insert if it did.
+  bool InsertToLeafHint(const char* key, Leaf* leaf, bool* done);
+
+  // Inserts key to a locked leaf with room. Returns false if it exists.
+  bool InsertToLeaf(Leaf* leaf, const char* key);
+
+  // Moves the upper half of a locked full leaf to a new leaf, and returns
+  // it and its first key, the separator for the parent
+  Leaf* SplitLeaf(Leaf* leaf, const char** separator);
+  Inner* SplitInner(Inner* inner, const char** separator);
+
+  // Adds the new right half of a split child to its locked parent, or to a
+  // new root if there is no parent
+  void AddChild(Inner* parent, Node* left, const char* separator,
+                Node* right);
+
+  const MemTableRep::KeyComparator& compare_;
+  std::atomic<Node*> root_;
+};
+
+BTreeRep::BTreeRep(const MemTableRep::KeyComparator& compare,
+                   Allocator* allocator)
+    : MemTableRep(allocator), compare_(compare), root_(nullptr) {
+  root_.store(NewLeaf(), std::memory_order_release);
+}
+
+void BTreeRep::CopyLeaf(Leaf* leaf, LeafCopy* copy) const {
+  while (true) {
+    bool restart = false;
+    uint64_t version = ReadLock(leaf, &restart);
+    if (restart) {
+      continue;
+    }
+    uint16_t count = Count(leaf, kLeafCapacity);
+    for (uint16_t i = 0; i < count; ++i) {
+      copy->keys[i] = leaf->keys[i].load(std::memory_order_acquire);
+    }
+    copy->count = count;
+    copy->next = leaf->next.load(std::memory_order_acquire);
+    if (Validate(leaf, version)) {
+      return;
+    }
+  }
+}
+
+void BTreeRep::FindLeaf(const char* target, Descent descent,
+                        LeafCopy* copy) const {
+retry:
+  bool restart = false;
+  Node* node = root_.load(std::memory_order_acquire);
+  uint64_t version = ReadLock(node, &restart);
+  if (restart || node != root_.load(std::memory_order_acquire)) {
+    goto retry;
+  }
+  while (!node->leaf) {
+    Inner* inner = static_cast<Inner*>(node);
+    uint16_t count = Count(inner, kInnerCapacity);
+    uint16_t pos;
+    switch (descent) {
+      case kSeek:
+        pos = LowerBound(inner->keys, count, target, true /* upper */);
+        break;
+      case kLessThan:
+        pos = LowerBound(inner->keys, count, target);
+        break;
+      case kFirst:
+        pos = 0;
+        break;
+      default:
+        assert(descent == kLast);
+        pos = count;
+        break;
+    }
+    Node* child = inner->children[pos].load(std::memory_order_acquire);
+    if (child == nullptr) {
+      goto retry;
+    }
+    uint64_t child_version = ReadLock(child, &restart);
+    // The parent is checked after the child, as a split of the child
+    // changes both
+    if (restart || !Validate(inner, version)) {
+      goto retry;
+    }
+    node = child;
+    version = child_version;
+  }
+  Leaf* leaf = static_cast<Leaf*>(node);
+  uint16_t count = Count(leaf, kLeafCapacity);
+  for (uint16_t i = 0; i < count; ++i) {
+    copy->keys[i] = leaf->keys[i].load(std::memory_order_acquire);
+  }
+  copy->count = count;
+  copy->next = leaf->next.load(std::memory_order_acquire);
+  if (!Validate(leaf, version)) {
+    goto retry;
+  }
+}
+
+bool BTreeRep::InsertToLeafHint(const char* key, Leaf* leaf, bool* done) {
+  bool restart = false;
+  uint64_t version = ReadLock(leaf, &restart);
+  if (restart) {
+    return false;
+  }
+  uint16_t count = Count(leaf, kLeafCapacity);
+  if (count == 0 || count == kLeafCapacity) {
+    return false;
+  }
+  const char* first = leaf->keys[0].load(std::memory_order_acquire);
+  Leaf* next = leaf->next.load(std::memory_order_acquire);
+  const char* next_first =
+      next != nullptr ? next->keys[0].load(std::memory_order_acquire) : nullptr;
+  if (first == nullptr || (next != nullptr && next_first == nullptr) ||
+      !Validate(leaf, version)) {
+    return false;
+  }
+  // The leaf has the keys from its first one, which only changes for the
+  // leftmost leaf, which has all keys < its first one as well, to the first
+  // one of the next leaf, which does not change
+  if (compare_(key, first) < 0 ||
+      (next_first != nullptr && compare_(key, next_first) >= 0)) {
+    return false;
+  }
+  if (!UpgradeToWriteLock(leaf, version)) {
+    return false;
+  }
+  *done = true;
+  bool res = InsertToLeaf(leaf, key);
+  WriteUnlock(leaf);
+  return res;
+}
+
+bool BTreeRep::InsertToLeaf(Leaf* leaf, const char* key) {
+  uint16_t count = leaf->count.load(std::memory_order_relaxed);
+  assert(count < kLeafCapacity);
+  uint16_t pos = LowerBound(leaf->keys, count, key);
+  if (pos < count &&
+      compare_(leaf->keys[pos].load(std::memory_order_relaxed), key) == 0) {
+    return false;
+  }
+  for (uint16_t i = count; i > pos; --i) {
+    leaf->keys[i].store(leaf->keys[i - 1].load(std::memory_order_relaxed),
+                        std::memory_order_release);
+  }
+  leaf->keys[pos].store(key, std::memory_order_release);
+  leaf->count.store(static_cast<uint16_t>(count + 1),
+                    std::memory_order_release);
+  return true;
+}
+
+BTreeRep::Leaf* BTreeRep::SplitLeaf(Leaf* leaf, const char** separator) {
+  Leaf* right = NewLeaf();
+  uint16_t count = leaf->count.load(std::memory_order_relaxed);
+  uint16_t mid = count / 2;
+  for (uint16_t i = mid; i < count; ++i) {
+    right->keys[i - mid].store(leaf->keys[i].load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+  }
+  right->count.store(static_cast<uint16_t>(count - mid),
+                     std::memory_order_relaxed);
+  right->next.store(leaf->next.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  leaf->next.store(right, std::memory_order_release);
+  leaf->count.store(mid, std::memory_order_release);
+  *separator = right->keys[0].load(std::memory_order_relaxed);
+  return right;
+}
+
+BTreeRep::Inner* BTreeRep::SplitInner(Inner* inner, const char** separator) {
+  Inner* right = NewInner();
+  uint16_t count = inner->count.load(std::memory_order_relaxed);
+  uint16_t mid = count / 2;
+  // keys[mid] moves up
+  for (uint16_t i = mid + 1; i < count; ++i) {
+    right->keys[i - mid - 1].store(
+        inner->keys[i].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  for (uint16_t i = mid + 1; i <= count; ++i) {
+    right->children[i - mid - 1].store(
+        inner->children[i].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  right->count.store(static_cast<uint16_t>(count - mid - 1),
+                     std::memory_order_relaxed);
+  inner->count.store(mid, std::memory_order_release);
+  *separator = inner->keys[mid].load(std::memory_order_relaxed);
+  return right;
+}
+
+void BTreeRep::AddChild(Inner* parent, Node* left, const char* separator,
+                        Node* right) {
+  if (parent == nullptr) {
+    Inner* root = NewInner();
+    root->keys[0].store(separator, std::memory_order_relaxed);
+    root->children[0].store(left, std::memory_order_relaxed);
+    root->children[1].store(right, std::memory_order_relaxed);
+    root->count.store(1, std::memory_order_relaxed);
+    root_.store(root, std::memory_order_release);
+    return;
+  }
+  uint16_t count = parent->count.load(std::memory_order_relaxed);
+  assert(count < kInnerCapacity);
+  uint16_t pos = LowerBound(parent->keys, count, separator);
+  for (uint16_t i = count; i > pos; --i) {
+    parent->keys[i].store(parent->keys[i - 1].load(std::memory_order_relaxed),
+                          std::memory_order_release);
+    parent->children[i + 1].store(
+        parent->children[i].load(std::memory_order_relaxed),
+        std::memory_order_release);
+  }
+  parent->keys[pos].store(separator, std::memory_order_release);
+  parent->children[pos + 1].store(right, std::memory_order_release);
+  parent->count.store(static_cast<uint16_t>(count + 1),
+                      std::memory_order_release);
+}
+
+bool BTreeRep::Insert(const char* key, Leaf** hint) {
+  if (hint != nullptr && *hint != nullptr) {
+    bool done = false;
+    bool res = InsertToLeafHint(key, *hint, &done);
+    if (done) {
+      return res;
+    }
+  }
+retry:
+  bool restart = false;
+  Node* node = root_.load(std::memory_order_acquire);
+  uint64_t version = ReadLock(node, &restart);
+  if (restart || node != root_.load(std::memory_order_acquire)) {
+    goto retry;
+  }
+  Inner* parent = nullptr;
+  uint64_t parent_version = 0;
+  while (true) {
+    uint16_t capacity = node->leaf ? kLeafCapacity : kInnerCapacity;
+    if (node->count.load(std::memory_order_acquire) == capacity) {
+      // Split a full node, so that its parent, which is not full, has room
+      // for the new child
+      if (parent != nullptr && !UpgradeToWriteLock(parent, parent_version)) {
+        goto retry;
+      }
+      if (!UpgradeToWriteLock(node, version)) {
+        if (parent != nullptr) {
+          WriteUnlock(parent);
+        }
+        goto retry;
+      }
+      if (parent == nullptr && node != root_.load(std::memory_order_acquire)) {
+        // Another thread has just added a root above
+        WriteUnlock(node);
+        goto retry;
+      }
+      const char* separator;
+      Node* right;
+      if (node->leaf) {
+        right = SplitLeaf(static_cast<Leaf*>(node), &separator);
+      } else {
+        right = SplitInner(static_cast<Inner*>(node), &separator);
+      }
+      AddChild(parent, node, separator, right);
+      WriteUnlock(node);
+      if (parent != nullptr) {
+        WriteUnlock(parent);
+      }
+      goto retry;
+    }
+    if (node->leaf) {
+      break;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    uint16_t count = Count(inner, kInnerCapacity);
+    uint16_t pos = LowerBound(inner->keys, count, key, true /* upper */);
+    Node* child = inner->children[pos].load(std::memory_order_acquire);
+    if (child == nullptr) {
+      goto retry;
+    }
+    uint64_t child_version = ReadLock(child, &restart);
+    if (restart || !Validate(inner, version)) {
+      goto retry;
+    }
+    parent = inner;
+    parent_version = version;
+    node = child;
+    version = child_version;
+  }
+
+  Leaf* leaf = static_cast<Leaf*>(node);
+  if (!UpgradeToWriteLock(leaf, version)) {
+    goto retry;
+  }
+  bool res = InsertToLeaf(leaf, key);
+  WriteUnlock(leaf);
+  if (hint != nullptr) {
+    *hint = leaf;
+  }
+  return res;
+}
+
+bool BTreeRep::Contains(const char* key) const {
+  Iterator iter(this);
+  iter.Seek(Slice(), key);
+  return iter.Valid() && compare_(iter.key(), key) == 0;
+}
+
+void BTreeRep::Get(const LookupKey& k, void* callback_args,
+                   bool (*callback_func)(void* arg, const char* entry)) {
+  Iterator iter(this);
+  for (iter.Seek(Slice(), k.memtable_key().data());
+       iter.Valid() && callback_func(callback_args, iter.key()); iter.Next()) {
+  }
+}
+
+MemTableRep::Iterator* BTreeRep::GetIterator(Arena* arena) {
+  if (arena == nullptr) {
+    return new Iterator(this);
+  } else {
+    auto mem = arena->AllocateAligned(sizeof(Iterator));
+    return new (mem) Iterator(this);
+  }
+}
+
+class BTreeRepFactory : public MemTableRepFactory {
+ public:
+  BTreeRepFactory() {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& compare,
+                                 Allocator* allocator,
+                                 const SliceTransform* /*transform*/,
+                                 Logger* /*logger*/) override {
+    return new BTreeRep(compare, allocator);
+  }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
+
+  bool CanHandleDuplicatedKey() const override { return true; }
+
+  static const char* kClassName() { return "BTreeRepFactory"; }
+  static const char* kNickName() { return "btree"; }
+
+  const char* Name() const override { return kClassName(); }
+  const char* NickName() const override { return kNickName(); }
+};
+
+}  // namespace
+
+MemTableRepFactory* NewBTreeRepFactory() { return new BTreeRepFactory(); }
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
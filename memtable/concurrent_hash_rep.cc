@@ -0,0 +1,353 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "db/memtable.h"
+#include "memory/allocator.h"
+#include "memory/arena.h"
+#include "memtable/stl_wrappers.h"
+#include "port/port.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/utilities/options_type.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+// Hashes the user keys to a fixed array of buckets. Each bucket is a linked
+// list of the entries of its keys, sorted by the memtable key comparator, to
+// which entries are added with a compare-and-swap. Entries are never
+// removed, so concurrent inserts and lookups need no lock.
+//
+// There is no total order. The entries of all buckets are sorted into a
+// snapshot shared by the iterators, and a new iterator only sorts the
+// entries inserted since the last snapshot and merges them into a new one.
+// The current snapshot is charged in ApproximateMemoryUsage().
+class ConcurrentHashRep : public MemTableRep {
+ public:
+  ConcurrentHashRep(const MemTableRep::KeyComparator& compare,
+                    Allocator* allocator, size_t bucket_count);
+
+  KeyHandle Allocate(const size_t len, char** buf) override;
+
+  void Insert(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKey(KeyHandle handle) override;
+
+  void InsertConcurrently(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKeyConcurrently(KeyHandle handle) override {
+    return InsertKey(handle);
+  }
+
+  bool Contains(const char* key) const override;
+
+  size_t ApproximateMemoryUsage() override {
+    // The rest is allocated from the allocator
+    return sorted_keys_bytes_.load(std::memory_order_relaxed);
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  ~ConcurrentHashRep() override {}
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override;
+
+ private:
+  struct Node {
+    // The memtable key is stored right after the node
+    const char* Key() const { return reinterpret_cast<const char*>(this + 1); }
+
+    Node* Next() const { return next.load(std::memory_order_acquire); }
+
+    std::atomic<Node*> next;
+    // Whether the entry is in sorted_keys_. Guarded by sorted_mutex_.
+    bool sorted;
+  };
+
+  using SortedKeys = std::vector<const char*>;
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    Iterator(std::shared_ptr<const SortedKeys> keys,
+             const MemTableRep::KeyComparator& compare)
+        : keys_(std::move(keys)), pos_(keys_->end()), compare_(compare) {}
+
+    ~Iterator() override {}
+
+    bool Valid() const override { return pos_ != keys_->end(); }
+
+    const char* key() const override {
+      assert(Valid());
+      return *pos_;
+    }
+
+    void Next() override {
+      assert(Valid());
+      ++pos_;
+    }
+
+    void Prev() override {
+      assert(Valid());
+      if (pos_ == keys_->begin()) {
+        pos_ = keys_->end();
+      } else {
+        --pos_;
+      }
+    }
+
+    void Seek(const Slice& internal_key, const char* memtable_key) override {
+      const char* encoded_key = (memtable_key != nullptr)
+                                    ? memtable_key
+                                    : EncodeKey(&tmp_, internal_key);
+      pos_ = std::lower_bound(keys_->begin(), keys_->end(), encoded_key,
+                              stl_wrappers::Compare(compare_));
+    }
+
+    void SeekForPrev(const Slice& internal_key,
+                     const char* memtable_key) override {
+      const char* encoded_key = (memtable_key != nullptr)
+                                    ? memtable_key
+                                    : EncodeKey(&tmp_, internal_key);
+      // The first entry > target, then one back
+      pos_ = std::upper_bound(keys_->begin(), keys_->end(), encoded_key,
+                              stl_wrappers::Compare(compare_));
+      if (pos_ == keys_->begin()) {
+        pos_ = keys_->end();
+      } else {
+        --pos_;
+      }
+    }
+
+    void SeekToFirst() override {
+      pos_ = keys_->begin();
+    }
+
+    void SeekToLast() override {
+      pos_ = keys_->end();
+      if (!keys_->empty()) {
+        --pos_;
+      }
+    }
+
+   private:
+    std::shared_ptr<const SortedKeys> keys_;
+    SortedKeys::const_iterator pos_;
+    const MemTableRep::KeyComparator& compare_;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+
+  size_t GetBucket(const Slice& user_key) const {
+    return FastRange64(GetSliceNPHash64(user_key), bucket_count_);
+  }
+
+  // Sorts the entries not in sorted_keys_ yet and merges them into a new
+  // sorted_keys_, which holds all entries inserted before num_entries_ was
+  // num_entries.
+  // REQUIRES: sorted_mutex_ held
+  void UpdateSortedKeys(size_t num_entries);
+
+  const size_t bucket_count_;
+  std::atomic<Node*>* buckets_;
+  const MemTableRep::KeyComparator& compare_;
+  // Number of entries, counted once linked
+  std::atomic<size_t> num_entries_;
+
+  port::Mutex sorted_mutex_;
+  std::shared_ptr<const SortedKeys> sorted_keys_;
+  // num_entries_ when sorted_keys_ was made
+  size_t sorted_num_entries_;
+  std::atomic<size_t> sorted_keys_bytes_;
+};
+
+ConcurrentHashRep::ConcurrentHashRep(const MemTableRep::KeyComparator& compare,
+                                     Allocator* allocator, size_t bucket_count)
+    : MemTableRep(allocator),
+      bucket_count_(bucket_count),
+      compare_(compare),
+      num_entries_(0),
+      sorted_num_entries_(0),
+      sorted_keys_bytes_(0) {
+  char* mem =
+      allocator->AllocateAligned(sizeof(std::atomic<Node*>) * bucket_count_);
+  buckets_ = new (mem) std::atomic<Node*>[bucket_count_];
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    buckets_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+KeyHandle ConcurrentHashRep::Allocate(const size_t len, char** buf) {
+  char* mem = allocator_->AllocateAligned(sizeof(Node) + len);
+  Node* node = new (mem) Node;
+  node->next.store(nullptr, std::memory_order_relaxed);
+  node->sorted = false;
+  *buf = mem + sizeof(Node);
+  return static_cast<KeyHandle>(node);
+}
+
+bool ConcurrentHashRep::InsertKey(KeyHandle handle) {
+  Node* node = static_cast<Node*>(handle);
+  const char* key = node->Key();
+  std::atomic<Node*>* link = &buckets_[GetBucket(UserKey(key))];
+  Node* next = link->load(std::memory_order_acquire);
+  while (true) {
+    if (next != nullptr) {
+      int cmp = compare_(next->Key(), key);
+      if (cmp < 0) {
+        link = &next->next;
+        next = link->load(std::memory_order_acquire);
+        continue;
+      }
+      if (cmp == 0) {
+        // Same key and sequence number
+        return false;
+      }
+    }
+    node->next.store(next, std::memory_order_relaxed);
+    // On failure next is reloaded, and nodes are never unlinked, so the
+    // search goes on from the same link
+    if (link->compare_exchange_weak(next, node, std::memory_order_release,
+                                    std::memory_order_acquire)) {
+      // Release, so that an iterator reading the count finds the entry
+      num_entries_.fetch_add(1, std::memory_order_release);
+      return true;
+    }
+  }
+}
+
+bool ConcurrentHashRep::Contains(const char* key) const {
+  Node* x = buckets_[GetBucket(UserKey(key))].load(std::memory_order_acquire);
+  while (x != nullptr) {
+    int cmp = compare_(x->Key(), key);
+    if (cmp >= 0) {
+      return cmp == 0;
+    }
+    x = x->Next();
+  }
+  return false;
+}
+
+void ConcurrentHashRep::Get(const LookupKey& k, void* callback_args,
+                            bool (*callback_func)(void* arg,
+                                                  const char* entry)) {
+  const char* target = k.memtable_key().data();
+  Node* x = buckets_[GetBucket(k.user_key())].load(std::memory_order_acquire);
+  while (x != nullptr && compare_(x->Key(), target) < 0) {
+    x = x->Next();
+  }
+  // The entries of a user key are adjacent in the bucket; the callback
+  // stops at the first entry of another key
+  for (; x != nullptr && callback_func(callback_args, x->Key());
+       x = x->Next()) {
+  }
+}
+
+void ConcurrentHashRep::UpdateSortedKeys(size_t num_entries) {
+  sorted_mutex_.AssertHeld();
+  SortedKeys new_keys;
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    for (Node* x = buckets_[i].load(std::memory_order_acquire); x != nullptr;
+         x = x->Next()) {
+      if (!x->sorted) {
+        new_keys.push_back(x->Key());
+        x->sorted = true;
+      }
+    }
+  }
+  std::sort(new_keys.begin(), new_keys.end(), stl_wrappers::Compare(compare_));
+  std::shared_ptr<SortedKeys> keys(new SortedKeys());
+  if (sorted_keys_ == nullptr) {
+    keys->swap(new_keys);
+  } else {
+    keys->reserve(sorted_keys_->size() + new_keys.size());
+    std::merge(sorted_keys_->begin(), sorted_keys_->end(), new_keys.begin(),
+               new_keys.end(), std::back_inserter(*keys),
+               stl_wrappers::Compare(compare_));
+  }
+  sorted_keys_bytes_.store(keys->capacity() * sizeof(const char*),
+                           std::memory_order_relaxed);
+  sorted_keys_ = std::move(keys);
+  sorted_num_entries_ = num_entries;
+}
+
+MemTableRep::Iterator* ConcurrentHashRep::GetIterator(Arena* arena) {
+  std::shared_ptr<const SortedKeys> keys;
+  {
+    MutexLock l(&sorted_mutex_);
+    // Read before the buckets, so that an entry counted later may be missed
+    // by this snapshot but not by the next one
+    size_t num_entries = num_entries_.load(std::memory_order_acquire);
+    if (sorted_keys_ == nullptr || num_entries != sorted_num_entries_) {
+      UpdateSortedKeys(num_entries);
+    }
+    keys = sorted_keys_;
+  }
+  if (arena == nullptr) {
+    return new Iterator(std::move(keys), compare_);
+  } else {
+    auto mem = arena->AllocateAligned(sizeof(Iterator));
+    return new (mem) Iterator(std::move(keys), compare_);
+  }
+}
+
+struct ConcurrentHashRepOptions {
+  static const char* kName() { return "ConcurrentHashRepFactoryOptions"; }
+  size_t bucket_count;
+};
+
+static std::unordered_map<std::string, OptionTypeInfo> concurrent_hash_info = {
+    {"bucket_count",
+     {offsetof(struct ConcurrentHashRepOptions, bucket_count),
+      OptionType::kSizeT, OptionVerificationType::kNormal,
+      OptionTypeFlags::kNone}},
+};
+
+class ConcurrentHashRepFactory : public MemTableRepFactory {
+ public:
+  explicit ConcurrentHashRepFactory(size_t bucket_count) {
+    options_.bucket_count = bucket_count;
+    RegisterOptions(&options_, &concurrent_hash_info);
+  }
+
+  using MemTableRepFactory::CreateMemTableRep;
+  MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator& compare,
+                                 Allocator* allocator,
+                                 const SliceTransform* /*transform*/,
+                                 Logger* /*logger*/) override {
+    return new ConcurrentHashRep(compare, allocator,
+                                 std::max<size_t>(options_.bucket_count, 1));
+  }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
+
+  bool CanHandleDuplicatedKey() const override { return true; }
+
+  static const char* kClassName() { return "ConcurrentHashRepFactory"; }
+  static const char* kNickName() { return "concurrent_hash"; }
+
+  const char* Name() const override { return kClassName(); }
+  const char* NickName() const override { return kNickName(); }
+
+ private:
+  ConcurrentHashRepOptions options_;
+};
+
+}  // namespace
+
+MemTableRepFactory* NewConcurrentHashRepFactory(size_t bucket_count) {
+  return new ConcurrentHashRepFactory(bucket_count);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
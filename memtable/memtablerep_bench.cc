@@ -25,6 +25,7 @@ int main() {
 #include "db/dbformat.h"
 #include "db/memtable.h"
 #include "memory/arena.h"
+#include "memory/concurrent_arena.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
 #include "rocksdb/comparator.h"
@@ -47,7 +48,11 @@ DEFINE_string(benchmarks, "fillrandom",
               "Comma-separated list of benchmarks to run. Options:\n"
               "\tfillrandom             -- write N random values\n"
               "\tfillseq                -- write N values in sequential order\n"
+              "\tfillrandomconcurrent   -- N threads concurrently write random "
+              "values\n"
+              "\t                          with InsertConcurrently()\n"
               "\treadrandom             -- read N values in random order\n"
+              "\tseekrandom             -- seek to N keys in random order\n"
               "\treadseq                -- scan the DB\n"
               "\treadwrite              -- 1 thread writes while N - 1 threads "
               "do random\n"
@@ -63,11 +68,13 @@ DEFINE_string(memtablerep, "skiplist",
               "\tvector              -- backed by an std::vector\n"
               "\thashskiplist        -- backed by a hash skip list\n"
               "\thashlinklist        -- backed by a hash linked list\n"
+              "\tconcurrent_hash     -- backed by a lock-free hash table\n"
+              "\tbtree               -- backed by a concurrent B+tree\n"
               "\tcuckoo              -- backed by a cuckoo hash table");
 
 DEFINE_int64(bucket_count, 1000000,
-             "bucket_count parameter to pass into NewHashSkiplistRepFactory or "
-             "NewHashLinkListRepFactory");
+             "bucket_count parameter to pass into NewHashSkiplistRepFactory, "
+             "NewHashLinkListRepFactory or NewConcurrentHashRepFactory");
 
 DEFINE_int32(
     hashskiplist_height, 4,
@@ -234,7 +241,9 @@ class FillBenchmarkThread : public BenchmarkThread {
       : BenchmarkThread(table, key_gen, bytes_written, bytes_read, sequence,
                         num_ops, read_hits) {}
 
-  void FillOne() {
+  void FillOne() { FillOne(key_gen_->Next(), ++(*sequence_), false); }
+
+  void FillOne(uint64_t key, uint64_t sequence, bool concurrently) {
     char* buf = nullptr;
     auto internal_key_size = 16;
     auto encoded_len =
@@ -242,16 +251,19 @@ class FillBenchmarkThread : public BenchmarkThread {
     KeyHandle handle = table_->Allocate(encoded_len, &buf);
     assert(buf != nullptr);
     char* p = EncodeVarint32(buf, internal_key_size);
-    auto key = key_gen_->Next();
     EncodeFixed64(p, key);
     p += 8;
-    EncodeFixed64(p, ++(*sequence_));
+    EncodeFixed64(p, sequence);
     p += 8;
     Slice bytes = generator_.Generate(FLAGS_item_size);
     memcpy(p, bytes.data(), FLAGS_item_size);
     p += FLAGS_item_size;
     assert(p == buf + encoded_len);
-    table_->Insert(handle);
+    if (concurrently) {
+      table_->InsertConcurrently(handle);
+    } else {
+      table_->Insert(handle);
+    }
     *bytes_written_ += encoded_len;
   }
 
@@ -286,6 +298,29 @@ class ConcurrentFillBenchmarkThread : public FillBenchmarkThread {
   std::atomic_int* threads_done_;
 };
 
+// Inserts the given keys, concurrently with the other fill threads
+class ConcurrentRandomFillBenchmarkThread : public FillBenchmarkThread {
+ public:
+  ConcurrentRandomFillBenchmarkThread(MemTableRep* table,
+                                      uint64_t* bytes_written,
+                                      const uint64_t* keys, uint64_t num_ops,
+                                      std::atomic<uint64_t>* last_sequence)
+      : FillBenchmarkThread(table, nullptr, bytes_written, nullptr, nullptr,
+                            num_ops, nullptr),
+        keys_(keys),
+        last_sequence_(last_sequence) {}
+
+  void operator()() override {
+    for (unsigned int i = 0; i < num_ops_; ++i) {
+      FillOne(keys_[i], last_sequence_->fetch_add(1) + 1, true);
+    }
+  }
+
+ private:
+  const uint64_t* keys_;
+  std::atomic<uint64_t>* last_sequence_;
+};
+
 class ReadBenchmarkThread : public BenchmarkThread {
  public:
   ReadBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
@@ -332,6 +367,34 @@ class ReadBenchmarkThread : public BenchmarkThread {
   }
 };
 
+class SeekBenchmarkThread : public ReadBenchmarkThread {
+ public:
+  SeekBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
+                      uint64_t* bytes_written, uint64_t* bytes_read,
+                      uint64_t* sequence, uint64_t num_ops, uint64_t* read_hits)
+      : ReadBenchmarkThread(table, key_gen, bytes_written, bytes_read, sequence,
+                            num_ops, read_hits) {}
+
+  void SeekOne(MemTableRep::Iterator* iter) {
+    std::string user_key;
+    auto key = key_gen_->Next();
+    PutFixed64(&user_key, key);
+    LookupKey lookup_key(user_key, *sequence_);
+    iter->Seek(lookup_key.internal_key(), lookup_key.memtable_key().data());
+    if (iter->Valid()) {
+      *bytes_read_ += VarintLength(16) + 16 + FLAGS_item_size;
+      ++*read_hits_;
+    }
+  }
+
+  void operator()() override {
+    std::unique_ptr<MemTableRep::Iterator> iter(table_->GetIterator());
+    for (unsigned int i = 0; i < num_ops_; ++i) {
+      SeekOne(iter.get());
+    }
+  }
+};
+
 class SeqReadBenchmarkThread : public BenchmarkThread {
  public:
   SeqReadBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
@@ -475,6 +538,44 @@ class FillBenchmark : public Benchmark {
   }
 };
 
+class ConcurrentFillBenchmark : public Benchmark {
+ public:
+  explicit ConcurrentFillBenchmark(MemTableRep* table, KeyGenerator* key_gen,
+                                   uint64_t* sequence)
+      : Benchmark(table, key_gen, sequence, FLAGS_num_threads) {
+    num_write_ops_per_thread_ = FLAGS_num_operations / FLAGS_num_threads;
+    // Drawn up front, as the key generator is not thread-safe
+    keys_.resize(num_write_ops_per_thread_ * FLAGS_num_threads);
+    for (auto& key : keys_) {
+      key = key_gen_->Next();
+    }
+  }
+
+  void RunThreads(std::vector<port::Thread>* threads, uint64_t* bytes_written,
+                  uint64_t* /*bytes_read*/, bool /*write*/,
+                  uint64_t* /*read_hits*/) override {
+    std::atomic<uint64_t> last_sequence(*sequence_);
+    std::vector<uint64_t> thread_bytes_written(FLAGS_num_threads, 0);
+    for (int i = 0; i < FLAGS_num_threads; ++i) {
+      threads->emplace_back(ConcurrentRandomFillBenchmarkThread(
+          table_, &thread_bytes_written[i],
+          keys_.data() + i * num_write_ops_per_thread_,
+          num_write_ops_per_thread_, &last_sequence));
+    }
+    for (auto& thread : *threads) {
+      thread.join();
+    }
+    *sequence_ = last_sequence.load();
+    for (auto bytes : thread_bytes_written) {
+      *bytes_written += bytes;
+    }
+  }
+
+ private:
+  std::vector<uint64_t> keys_;
+};
+
+template <class ReadThreadType>
 class ReadBenchmark : public Benchmark {
  public:
   explicit ReadBenchmark(MemTableRep* table, KeyGenerator* key_gen,
@@ -488,8 +589,8 @@ class ReadBenchmark : public Benchmark {
                   uint64_t* read_hits) override {
     for (int i = 0; i < FLAGS_num_threads; ++i) {
       threads->emplace_back(
-          ReadBenchmarkThread(table_, key_gen_, bytes_written, bytes_read,
-                              sequence_, num_read_ops_per_thread_, read_hits));
+          ReadThreadType(table_, key_gen_, bytes_written, bytes_read,
+                         sequence_, num_read_ops_per_thread_, read_hits));
     }
     for (auto& thread : *threads) {
       thread.join();
@@ -597,6 +698,11 @@ int main(int argc, char** argv) {
         FLAGS_if_log_bucket_dist_when_flash, FLAGS_threshold_use_skiplist));
     options.prefix_extractor.reset(
         ROCKSDB_NAMESPACE::NewFixedPrefixTransform(FLAGS_prefix_length));
+  } else if (FLAGS_memtablerep == "concurrent_hash") {
+    factory.reset(
+        ROCKSDB_NAMESPACE::NewConcurrentHashRepFactory(FLAGS_bucket_count));
+  } else if (FLAGS_memtablerep == "btree") {
+    factory.reset(ROCKSDB_NAMESPACE::NewBTreeRepFactory());
 #endif  // ROCKSDB_LITE
   } else {
     ROCKSDB_NAMESPACE::ConfigOptions config_options;
@@ -614,7 +720,9 @@ int main(int argc, char** argv) {
   ROCKSDB_NAMESPACE::InternalKeyComparator internal_key_comp(
       ROCKSDB_NAMESPACE::BytewiseComparator());
   ROCKSDB_NAMESPACE::MemTable::KeyComparator key_comp(internal_key_comp);
-  ROCKSDB_NAMESPACE::Arena arena;
+  // Like the memtables, so that fillrandomconcurrent can allocate from any
+  // thread
+  ROCKSDB_NAMESPACE::ConcurrentArena arena;
   ROCKSDB_NAMESPACE::WriteBufferManager wb(FLAGS_write_buffer_size);
   uint64_t sequence;
   auto createMemtableRep = [&] {
@@ -650,10 +758,29 @@ int main(int argc, char** argv) {
           &rng, ROCKSDB_NAMESPACE::UNIQUE_RANDOM, FLAGS_num_operations));
       benchmark.reset(new ROCKSDB_NAMESPACE::FillBenchmark(
           memtablerep.get(), key_gen.get(), &sequence));
+    } else if (name == ROCKSDB_NAMESPACE::Slice("fillrandomconcurrent")) {
+      if (!factory->IsInsertConcurrentlySupported()) {
+        std::cout << "WARNING: skipping fillrandomconcurrent, "
+                  << factory->Name()
+                  << " does not support concurrent inserts" << std::endl;
+        continue;
+      }
+      memtablerep.reset(createMemtableRep());
+      key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
+          &rng, ROCKSDB_NAMESPACE::UNIQUE_RANDOM, FLAGS_num_operations));
+      benchmark.reset(new ROCKSDB_NAMESPACE::ConcurrentFillBenchmark(
+          memtablerep.get(), key_gen.get(), &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("readrandom")) {
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
           &rng, ROCKSDB_NAMESPACE::RANDOM, FLAGS_num_operations));
-      benchmark.reset(new ROCKSDB_NAMESPACE::ReadBenchmark(
+      benchmark.reset(new ROCKSDB_NAMESPACE::ReadBenchmark<
+                      ROCKSDB_NAMESPACE::ReadBenchmarkThread>(
+          memtablerep.get(), key_gen.get(), &sequence));
+    } else if (name == ROCKSDB_NAMESPACE::Slice("seekrandom")) {
+      key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
+          &rng, ROCKSDB_NAMESPACE::RANDOM, FLAGS_num_operations));
+      benchmark.reset(new ROCKSDB_NAMESPACE::ReadBenchmark<
+                      ROCKSDB_NAMESPACE::SeekBenchmarkThread>(
           memtablerep.get(), key_gen.get(), &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("readseq")) {
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
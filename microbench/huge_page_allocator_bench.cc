@@ -0,0 +1,179 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+// Compares the huge page memory allocator with the default one for the access
+// pattern of a large block cache: a read of a few cache lines at a random
+// place of a random 4KB block. With regular pages nearly every read misses
+// the TLB once the blocks span more than the TLB covers.
+//
+// Reports the dTLB load misses per read where the hardware counter is
+// available (Linux perf events), and how much of the blocks the kernel backs
+// with transparent huge pages.
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // __linux__
+
+#include "benchmark/benchmark.h"
+#include "memory/huge_page_allocator.h"
+#include "rocksdb/memory_allocator.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// Counts the dTLB load misses of the calling thread, if the hardware counter
+// is available
+class DTLBMissCounter {
+ public:
+  DTLBMissCounter() {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif  // __linux__
+  }
+
+  ~DTLBMissCounter() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#endif  // __linux__
+  }
+
+  bool Available() const { return fd_ >= 0; }
+
+  void Start() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif  // __linux__
+  }
+
+  uint64_t Stop() {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif  // __linux__
+    return count;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+// AnonHugePages of the process, in MB, or -1 if unknown
+double AnonHugePagesMB() {
+  std::ifstream smaps("/proc/self/smaps_rollup");
+  std::string line;
+  while (std::getline(smaps, line)) {
+    if (line.compare(0, 15, "AnonHugePages: ") == 0) {
+      return std::stod(line.substr(15)) / 1024;
+    }
+  }
+  return -1;
+}
+}  // namespace
+
+static void BlockRandomRead(benchmark::State& state) {
+  bool huge_pages = state.range(0) != 0;
+  size_t working_set = static_cast<size_t>(state.range(1)) << 20;
+  constexpr size_t kBlockSize = 4096;
+  constexpr size_t kReadsPerBlock = 4;
+
+  std::shared_ptr<MemoryAllocator> allocator;
+  if (huge_pages) {
+    if (!HugePageMemoryAllocator::IsSupported()) {
+      state.SkipWithError("Huge page allocator not supported");
+      return;
+    }
+    HugePageAllocatorOptions options;
+    Status s = NewHugePageMemoryAllocator(options, &allocator);
+    if (!s.ok()) {
+      state.SkipWithError(s.ToString().c_str());
+      return;
+    }
+  }
+
+  double huge_mb_before = AnonHugePagesMB();
+  std::vector<char*> blocks(working_set / kBlockSize);
+  for (char*& block : blocks) {
+    block = static_cast<char*>(allocator ? allocator->Allocate(kBlockSize)
+                                         : malloc(kBlockSize));
+    memset(block, 1, kBlockSize);
+  }
+  double huge_mb = AnonHugePagesMB() - huge_mb_before;
+
+  Random rnd(301);
+  DTLBMissCounter tlb_misses;
+  uint64_t reads = 0;
+  uint64_t sum = 0;
+  tlb_misses.Start();
+  for (auto _ : state) {
+    const char* block = blocks[rnd.Uniform(static_cast<int>(blocks.size()))];
+    size_t offset = rnd.Uniform(kBlockSize / 64 - kReadsPerBlock) * 64;
+    for (size_t i = 0; i < kReadsPerBlock; i++) {
+      sum += static_cast<unsigned char>(block[offset + i * 64]);
+    }
+    reads++;
+  }
+  uint64_t misses = tlb_misses.Stop();
+  benchmark::DoNotOptimize(sum);
+
+  if (tlb_misses.Available() && reads > 0) {
+    state.counters["dtlb_misses_per_read"] =
+        static_cast<double>(misses) / static_cast<double>(reads);
+  }
+  if (huge_mb_before >= 0) {
+    state.counters["huge_page_mb"] = huge_mb;
+  }
+  for (char* block : blocks) {
+    if (allocator) {
+      allocator->Deallocate(block);
+    } else {
+      free(block);
+    }
+  }
+}
+
+static void BlockRandomReadArguments(benchmark::internal::Benchmark* b) {
+  for (int huge_pages : {0, 1}) {
+    for (int working_set_mb : {64, 1024}) {
+      b->Args({huge_pages, working_set_mb});
+    }
+  }
+  b->ArgNames({"huge_pages", "working_set_mb"});
+}
+
+BENCHMARK(BlockRandomRead)->Apply(BlockRandomReadArguments);
+
+}  // namespace ROCKSDB_NAMESPACE
+
+BENCHMARK_MAIN();
@@ -226,6 +226,15 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
     {LAST_LEVEL_READ_COUNT, "rocksdb.last.level.read.count"},
     {NON_LAST_LEVEL_READ_BYTES, "rocksdb.non.last.level.read.bytes"},
     {NON_LAST_LEVEL_READ_COUNT, "rocksdb.non.last.level.read.count"},
+    {ROW_CACHE_ADMISSION_REJECT, "rocksdb.row.cache.admission.reject"},
+    {ROW_CACHE_INVALIDATION, "rocksdb.row.cache.invalidation"},
+    {ROW_CACHE_STALE_ERASE, "rocksdb.row.cache.stale.erase"},
+    {ROW_CACHE_MIGRATED, "rocksdb.row.cache.migrated"},
+    {ROW_CACHE_MIGRATION_DROPPED, "rocksdb.row.cache.migration.dropped"},
+    {CACHE_WARMUP_ENTRIES_LOADED, "rocksdb.cache.warmup.entries.loaded"},
+    {CACHE_WARMUP_BYTES_LOADED, "rocksdb.cache.warmup.bytes.loaded"},
+    {CACHE_WARMUP_ENTRIES_SKIPPED, "rocksdb.cache.warmup.entries.skipped"},
+    {COMPRESSED_TIER_HITS, "rocksdb.compressed.tier.hits"},
 };
 
 const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
@@ -284,6 +293,9 @@ const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
     {ERROR_HANDLER_AUTORESUME_RETRY_COUNT,
      "rocksdb.error.handler.autoresume.retry.count"},
     {ASYNC_READ_BYTES, "rocksdb.async.read.bytes"},
+    {ROW_CACHE_ENTRY_RESIDENCY_MICROS,
+     "rocksdb.row.cache.entry.residency.micros"},
+    {ROW_CACHE_ENTRY_HITS, "rocksdb.row.cache.entry.hits"},
 };
 
 std::shared_ptr<Statistics> CreateDBStatistics() {
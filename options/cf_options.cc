@@ -433,6 +433,18 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct MutableCFOptions, blob_compaction_readahead_size),
           OptionType::kUInt64T, OptionVerificationType::kNormal,
           OptionTypeFlags::kMutable}},
+        {"row_cache_hybrid_admission",
+         {offsetof(struct MutableCFOptions, row_cache_hybrid_admission),
+          OptionType::kBoolean, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
+        {"row_cache_invalidation_threshold",
+         {offsetof(struct MutableCFOptions, row_cache_invalidation_threshold),
+          OptionType::kUInt32T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
+        {"row_cache_migration_budget",
+         {offsetof(struct MutableCFOptions, row_cache_migration_budget),
+          OptionType::kUInt64T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
         {"sample_for_compression",
          {offsetof(struct MutableCFOptions, sample_for_compression),
           OptionType::kUInt64T, OptionVerificationType::kNormal,
@@ -1059,6 +1071,14 @@ void MutableCFOptions::Dump(Logger* log) const {
   ROCKS_LOG_INFO(log, "           blob_compaction_readahead_size: %" PRIu64,
                  blob_compaction_readahead_size);
 
+  // Row cache related options
+  ROCKS_LOG_INFO(log, "               row_cache_hybrid_admission: %s",
+                 row_cache_hybrid_admission ? "true" : "false");
+  ROCKS_LOG_INFO(log, "         row_cache_invalidation_threshold: %u",
+                 row_cache_invalidation_threshold);
+  ROCKS_LOG_INFO(log, "               row_cache_migration_budget: %" PRIu64,
+                 row_cache_migration_budget);
+
   ROCKS_LOG_INFO(log, "                   bottommost_temperature: %d",
                  static_cast<int>(bottommost_temperature));
 }
@@ -140,6 +140,10 @@ struct MutableCFOptions {
         blob_garbage_collection_force_threshold(
             options.blob_garbage_collection_force_threshold),
         blob_compaction_readahead_size(options.blob_compaction_readahead_size),
+        row_cache_hybrid_admission(options.row_cache_hybrid_admission),
+        row_cache_invalidation_threshold(
+            options.row_cache_invalidation_threshold),
+        row_cache_migration_budget(options.row_cache_migration_budget),
         max_sequential_skip_in_iterations(
             options.max_sequential_skip_in_iterations),
         check_flush_compaction_key_order(
@@ -189,6 +193,9 @@ struct MutableCFOptions {
         blob_garbage_collection_age_cutoff(0.0),
         blob_garbage_collection_force_threshold(0.0),
         blob_compaction_readahead_size(0),
+        row_cache_hybrid_admission(false),
+        row_cache_invalidation_threshold(1),
+        row_cache_migration_budget(0),
         max_sequential_skip_in_iterations(0),
         check_flush_compaction_key_order(true),
         paranoid_file_checks(false),
@@ -256,6 +263,11 @@ struct MutableCFOptions {
   double blob_garbage_collection_force_threshold;
   uint64_t blob_compaction_readahead_size;
 
+  // Row cache related options
+  bool row_cache_hybrid_admission;
+  uint32_t row_cache_invalidation_threshold;
+  uint64_t row_cache_migration_budget;
+
   // Misc options
   uint64_t max_sequential_skip_in_iterations;
   bool check_flush_compaction_key_order;
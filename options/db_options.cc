@@ -17,6 +17,7 @@
 #include "rocksdb/file_system.h"
 #include "rocksdb/listener.h"
 #include "rocksdb/rate_limiter.h"
+#include "rocksdb/row_cache_admission_policy.h"
 #include "rocksdb/sst_file_manager.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/system_clock.h"
@@ -136,6 +137,7 @@ static std::unordered_map<std::string, OptionTypeInfo>
         /*
          // not yet supported
           std::shared_ptr<Cache> row_cache;
+          std::shared_ptr<RowCacheAdmissionPolicy> row_cache_admission_policy;
           std::shared_ptr<DeleteScheduler> delete_scheduler;
           std::shared_ptr<Logger> info_log;
           std::shared_ptr<RateLimiter> rate_limiter;
@@ -316,6 +318,9 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct ImmutableDBOptions, enable_pipelined_write),
           OptionType::kBoolean, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone}},
+        {"wal_shards",
+         {offsetof(struct ImmutableDBOptions, wal_shards), OptionType::kSizeT,
+          OptionVerificationType::kNormal, OptionTypeFlags::kNone}},
         {"unordered_write",
          {offsetof(struct ImmutableDBOptions, unordered_write),
           OptionType::kBoolean, OptionVerificationType::kNormal,
@@ -395,6 +400,26 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct ImmutableDBOptions, avoid_unnecessary_blocking_io),
           OptionType::kBoolean, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone}},
+        {"row_cache_key_by_user_key",
+         {offsetof(struct ImmutableDBOptions, row_cache_key_by_user_key),
+          OptionType::kBoolean, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
+        {"row_cache_tracking_sample_rate",
+         {offsetof(struct ImmutableDBOptions, row_cache_tracking_sample_rate),
+          OptionType::kUInt32T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
+        {"cache_warmup_dir",
+         {offsetof(struct ImmutableDBOptions, cache_warmup_dir),
+          OptionType::kString, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
+        {"cache_warmup_max_bytes",
+         {offsetof(struct ImmutableDBOptions, cache_warmup_max_bytes),
+          OptionType::kUInt64T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
+        {"cache_warmup_threads",
+         {offsetof(struct ImmutableDBOptions, cache_warmup_threads),
+          OptionType::kInt, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone}},
         {"write_dbid_to_manifest",
          {offsetof(struct ImmutableDBOptions, write_dbid_to_manifest),
           OptionType::kBoolean, OptionVerificationType::kNormal,
@@ -701,6 +726,7 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       listeners(options.listeners),
       enable_thread_tracking(options.enable_thread_tracking),
       enable_pipelined_write(options.enable_pipelined_write),
+      wal_shards(options.wal_shards),
       unordered_write(options.unordered_write),
       allow_concurrent_memtable_write(options.allow_concurrent_memtable_write),
       enable_write_thread_adaptive_yield(
@@ -713,6 +739,12 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       wal_recovery_mode(options.wal_recovery_mode),
       allow_2pc(options.allow_2pc),
       row_cache(options.row_cache),
+      row_cache_admission_policy(options.row_cache_admission_policy),
+      row_cache_key_by_user_key(options.row_cache_key_by_user_key),
+      row_cache_tracking_sample_rate(options.row_cache_tracking_sample_rate),
+      cache_warmup_dir(options.cache_warmup_dir),
+      cache_warmup_max_bytes(options.cache_warmup_max_bytes),
+      cache_warmup_threads(options.cache_warmup_threads),
 #ifndef ROCKSDB_LITE
       wal_filter(options.wal_filter),
 #endif  // ROCKSDB_LITE
@@ -854,6 +886,9 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                    enable_thread_tracking);
   ROCKS_LOG_HEADER(log, "                 Options.enable_pipelined_write: %d",
                    enable_pipelined_write);
+  ROCKS_LOG_HEADER(
+      log, "                             Options.wal_shards: %" ROCKSDB_PRIszt,
+      wal_shards);
   ROCKS_LOG_HEADER(log, "                 Options.unordered_write: %d",
                    unordered_write);
   ROCKS_LOG_HEADER(log, "        Options.allow_concurrent_memtable_write: %d",
@@ -875,6 +910,22 @@ void ImmutableDBOptions::Dump(Logger* log) const {
     ROCKS_LOG_HEADER(log,
                      "                              Options.row_cache: None");
   }
+  ROCKS_LOG_HEADER(log, "             Options.row_cache_admission_policy: %s",
+                   row_cache_admission_policy
+                       ? row_cache_admission_policy->Name()
+                       : "None");
+  ROCKS_LOG_HEADER(log, "              Options.row_cache_key_by_user_key: %d",
+                   row_cache_key_by_user_key);
+  ROCKS_LOG_HEADER(log,
+                   "         Options.row_cache_tracking_sample_rate: %" PRIu32,
+                   row_cache_tracking_sample_rate);
+  ROCKS_LOG_HEADER(log, "                       Options.cache_warmup_dir: %s",
+                   cache_warmup_dir.c_str());
+  ROCKS_LOG_HEADER(log,
+                   "                 Options.cache_warmup_max_bytes: %" PRIu64,
+                   cache_warmup_max_bytes);
+  ROCKS_LOG_HEADER(log, "                   Options.cache_warmup_threads: %d",
+                   cache_warmup_threads);
 #ifndef ROCKSDB_LITE
   ROCKS_LOG_HEADER(log, "                             Options.wal_filter: %s",
                    wal_filter ? wal_filter->Name() : "None");
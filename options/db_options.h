@@ -66,6 +66,7 @@ struct ImmutableDBOptions {
   std::vector<std::shared_ptr<EventListener>> listeners;
   bool enable_thread_tracking;
   bool enable_pipelined_write;
+  size_t wal_shards;
   bool unordered_write;
   bool allow_concurrent_memtable_write;
   bool enable_write_thread_adaptive_yield;
@@ -76,6 +77,12 @@ struct ImmutableDBOptions {
   WALRecoveryMode wal_recovery_mode;
   bool allow_2pc;
   std::shared_ptr<Cache> row_cache;
+  std::shared_ptr<RowCacheAdmissionPolicy> row_cache_admission_policy;
+  bool row_cache_key_by_user_key;
+  uint32_t row_cache_tracking_sample_rate;
+  std::string cache_warmup_dir;
+  uint64_t cache_warmup_max_bytes;
+  int cache_warmup_threads;
 #ifndef ROCKSDB_LITE
   WalFilter* wal_filter;
 #endif  // ROCKSDB_LITE
@@ -100,7 +100,11 @@ AdvancedColumnFamilyOptions::AdvancedColumnFamilyOptions(const Options& options)
           options.blob_garbage_collection_age_cutoff),
       blob_garbage_collection_force_threshold(
           options.blob_garbage_collection_force_threshold),
-      blob_compaction_readahead_size(options.blob_compaction_readahead_size) {
+      blob_compaction_readahead_size(options.blob_compaction_readahead_size),
+      row_cache_hybrid_admission(options.row_cache_hybrid_admission),
+      row_cache_invalidation_threshold(
+          options.row_cache_invalidation_threshold),
+      row_cache_migration_budget(options.row_cache_migration_budget) {
   assert(memtable_factory.get() != nullptr);
   if (max_bytes_for_level_multiplier_additional.size() <
       static_cast<unsigned int>(num_levels)) {
@@ -407,6 +411,13 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
     ROCKS_LOG_HEADER(
         log, "         Options.blob_compaction_readahead_size: %" PRIu64,
         blob_compaction_readahead_size);
+    ROCKS_LOG_HEADER(log, "             Options.row_cache_hybrid_admission: %s",
+                     row_cache_hybrid_admission ? "true" : "false");
+    ROCKS_LOG_HEADER(log, "       Options.row_cache_invalidation_threshold: %u",
+                     row_cache_invalidation_threshold);
+    ROCKS_LOG_HEADER(
+        log, "             Options.row_cache_migration_budget: %" PRIu64,
+        row_cache_migration_budget);
 }  // ColumnFamilyOptions::Dump
 
 void Options::Dump(Logger* log) const {
@@ -134,6 +134,7 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.enable_thread_tracking = immutable_db_options.enable_thread_tracking;
   options.delayed_write_rate = mutable_db_options.delayed_write_rate;
   options.enable_pipelined_write = immutable_db_options.enable_pipelined_write;
+  options.wal_shards = immutable_db_options.wal_shards;
   options.unordered_write = immutable_db_options.unordered_write;
   options.allow_concurrent_memtable_write =
       immutable_db_options.allow_concurrent_memtable_write;
@@ -152,6 +153,15 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.wal_recovery_mode = immutable_db_options.wal_recovery_mode;
   options.allow_2pc = immutable_db_options.allow_2pc;
   options.row_cache = immutable_db_options.row_cache;
+  options.row_cache_admission_policy =
+      immutable_db_options.row_cache_admission_policy;
+  options.row_cache_key_by_user_key =
+      immutable_db_options.row_cache_key_by_user_key;
+  options.row_cache_tracking_sample_rate =
+      immutable_db_options.row_cache_tracking_sample_rate;
+  options.cache_warmup_dir = immutable_db_options.cache_warmup_dir;
+  options.cache_warmup_max_bytes = immutable_db_options.cache_warmup_max_bytes;
+  options.cache_warmup_threads = immutable_db_options.cache_warmup_threads;
 #ifndef ROCKSDB_LITE
   options.wal_filter = immutable_db_options.wal_filter;
 #endif  // ROCKSDB_LITE
@@ -251,6 +261,12 @@ void UpdateColumnFamilyOptions(const MutableCFOptions& moptions,
   cf_opts->blob_compaction_readahead_size =
       moptions.blob_compaction_readahead_size;
 
+  // Row cache related options
+  cf_opts->row_cache_hybrid_admission = moptions.row_cache_hybrid_admission;
+  cf_opts->row_cache_invalidation_threshold =
+      moptions.row_cache_invalidation_threshold;
+  cf_opts->row_cache_migration_budget = moptions.row_cache_migration_budget;
+
   // Misc options
   cf_opts->max_sequential_skip_in_iterations =
       moptions.max_sequential_skip_in_iterations;
@@ -222,6 +222,13 @@ TEST_F(OptionsSettableTest, BlockBasedTableOptionsAllFieldsSettable) {
 // kDBOptionsExcluded, and maybe add customized verification for it.
 TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
   const OffsetGap kDBOptionsExcluded = {
+      {offsetof(struct DBOptions, memtable_switch), sizeof(MemtableSwitch)},
+      {offsetof(struct DBOptions, memtable_flush_start),
+       sizeof(MemtableFlushStart)},
+      {offsetof(struct DBOptions, memtable_flush_on_each_key_value),
+       sizeof(MemtableFlushOnEachKeyValue)},
+      {offsetof(struct DBOptions, memtable_flush_end),
+       sizeof(MemtableFlushEnd)},
       {offsetof(struct DBOptions, env), sizeof(Env*)},
       {offsetof(struct DBOptions, rate_limiter),
        sizeof(std::shared_ptr<RateLimiter>)},
@@ -238,6 +245,9 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
       {offsetof(struct DBOptions, listeners),
        sizeof(std::vector<std::shared_ptr<EventListener>>)},
       {offsetof(struct DBOptions, row_cache), sizeof(std::shared_ptr<Cache>)},
+      {offsetof(struct DBOptions, row_cache_admission_policy),
+       sizeof(std::shared_ptr<RowCacheAdmissionPolicy>)},
+      {offsetof(struct DBOptions, cache_warmup_dir), sizeof(std::string)},
       {offsetof(struct DBOptions, wal_filter), sizeof(const WalFilter*)},
       {offsetof(struct DBOptions, file_checksum_gen_factory),
        sizeof(std::shared_ptr<FileChecksumGenFactory>)},
@@ -326,6 +336,7 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "advise_random_on_open=true;"
                              "fail_if_options_file_error=false;"
                              "enable_pipelined_write=false;"
+                             "wal_shards=1;"
                              "unordered_write=false;"
                              "allow_concurrent_memtable_write=true;"
                              "wal_recovery_mode=kPointInTimeRecovery;"
@@ -346,6 +357,11 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "seq_per_batch=false;"
                              "atomic_flush=false;"
                              "avoid_unnecessary_blocking_io=false;"
+                             "row_cache_key_by_user_key=false;"
+                             "row_cache_tracking_sample_rate=0;"
+                             "cache_warmup_dir=path/to/cache_warmup_dir;"
+                             "cache_warmup_max_bytes=4295012345;"
+                             "cache_warmup_threads=3;"
                              "log_readahead_size=0;"
                              "write_dbid_to_manifest=false;"
                              "best_efforts_recovery=false;"
@@ -514,6 +530,9 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
       "blob_garbage_collection_age_cutoff=0.5;"
       "blob_garbage_collection_force_threshold=0.75;"
       "blob_compaction_readahead_size=262144;"
+      "row_cache_hybrid_admission=true;"
+      "row_cache_invalidation_threshold=3;"
+      "row_cache_migration_budget=65536;"
       "bottommost_temperature=kWarm;"
       "compaction_options_fifo={max_table_files_size=3;allow_"
       "compaction=false;age_for_warm=1;};",
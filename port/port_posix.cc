@@ -16,6 +16,9 @@
 #include <cpuid.h>
 #endif
 #include <errno.h>
+#ifdef NUMA
+#include <numa.h>
+#endif  // NUMA
 #include <sched.h>
 #include <signal.h>
 #include <stdio.h>
@@ -27,6 +30,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "util/string_util.h"
 
@@ -191,6 +195,50 @@ int PhysicalCoreID() {
 #endif
 }
 
+#ifdef NUMA
+namespace {
+struct NumaTopology {
+  int num_nodes = 1;
+  std::vector<int> cpu_to_node;
+
+  NumaTopology() {
+    if (numa_available() == -1) {
+      return;
+    }
+    num_nodes = numa_max_node() + 1;
+    cpu_to_node.resize(numa_num_configured_cpus());
+    for (size_t cpu = 0; cpu < cpu_to_node.size(); cpu++) {
+      int node = numa_node_of_cpu(static_cast<int>(cpu));
+      cpu_to_node[cpu] = node < 0 ? 0 : node;
+    }
+  }
+};
+
+const NumaTopology& GetNumaTopology() {
+  static NumaTopology topology;
+  return topology;
+}
+}  // namespace
+
+int NumaNodeCount() { return GetNumaTopology().num_nodes; }
+
+int NumaNodeID() {
+  const NumaTopology& topology = GetNumaTopology();
+  if (topology.num_nodes == 1) {
+    return 0;
+  }
+  int cpu = sched_getcpu();
+  if (cpu < 0 || static_cast<size_t>(cpu) >= topology.cpu_to_node.size()) {
+    return 0;
+  }
+  return topology.cpu_to_node[cpu];
+}
+#else
+int NumaNodeCount() { return 1; }
+
+int NumaNodeID() { return 0; }
+#endif  // NUMA
+
 void InitOnce(OnceType* once, void (*initializer)()) {
   PthreadCall("once", pthread_once(once, initializer));
 }
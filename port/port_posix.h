@@ -185,6 +185,14 @@ static inline void AsmVolatilePause() {
 // Returns -1 if not available on this platform
 extern int PhysicalCoreID();
 
+// Number of NUMA nodes. 1 if not built with NUMA support or the host does
+// not support it.
+extern int NumaNodeCount();
+
+// The NUMA node of the CPU the calling thread runs on, in
+// [0, NumaNodeCount()). 0 if unknown.
+extern int NumaNodeID();
+
 using OnceType = pthread_once_t;
 #define LEVELDB_ONCE_INIT PTHREAD_ONCE_INIT
 extern void InitOnce(OnceType* once, void (*initializer)());
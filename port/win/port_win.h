@@ -300,6 +300,10 @@ static inline void AsmVolatilePause() {
 
 extern int PhysicalCoreID();
 
+inline int NumaNodeCount() { return 1; }
+
+inline int NumaNodeID() { return 0; }
+
 // For Thread Local Storage abstraction
 using pthread_key_t = DWORD;
 
@@ -7,6 +7,7 @@ LIB_SOURCES =                                                   \
   cache/clock_cache.cc                                          \
   cache/lru_cache.cc                                            \
   cache/lru_secondary_cache.cc                                  \
+  cache/file_secondary_cache.cc                                 \
   cache/sharded_cache.cc                                        \
   db/arena_wrapped_db_iter.cc                                   \
   db/blob/blob_fetcher.cc                                       \
@@ -22,6 +23,7 @@ LIB_SOURCES =                                                   \
   db/blob/blob_log_writer.cc                                    \
   db/blob/prefetch_buffer_collection.cc                         \
   db/builder.cc                                                 \
+  db/cache_warmup.cc                                            \
   db/c.cc                                                       \
   db/column_family.cc                                           \
   db/compaction/compaction.cc                                   \
@@ -57,6 +59,8 @@ LIB_SOURCES =                                                   \
   db/forward_iterator.cc                                        \
   db/import_column_family_job.cc                                \
   db/internal_stats.cc                                          \
+  db/kv_cache_policy.cc                                         \
+  db/kv_cache_policy_table.cc                                   \
   db/logs_with_prep_tracker.cc                                  \
   db/log_reader.cc                                              \
   db/log_writer.cc                                              \
@@ -70,6 +74,9 @@ LIB_SOURCES =                                                   \
   db/range_del_aggregator.cc                                    \
   db/range_tombstone_fragmenter.cc                              \
   db/repair.cc                                                  \
+  db/row_cache_admission_policy.cc                              \
+  db/row_cache_invalidator.cc                                   \
+  db/row_cache_migrator.cc                                      \
   db/snapshot_impl.cc                                           \
   db/table_cache.cc                                             \
   db/table_properties_collector.cc                              \
@@ -115,8 +122,12 @@ LIB_SOURCES =                                                   \
   memory/concurrent_arena.cc                                    \
   memory/jemalloc_nodump_allocator.cc                           \
   memory/memkind_kmem_allocator.cc                              \
+  memory/numa_memory_allocator.cc                               \
+  memory/huge_page_allocator.cc                                 \
   memory/memory_allocator.cc                                    \
   memtable/alloc_tracker.cc                                     \
+  memtable/btree_rep.cc                                         \
+  memtable/concurrent_hash_rep.cc                               \
   memtable/hash_linklist_rep.cc                                 \
   memtable/hash_skiplist_rep.cc                                 \
   memtable/skiplistrep.cc                                       \
@@ -227,6 +238,7 @@ LIB_SOURCES =                                                   \
   util/ribbon_config.cc                                         \
   util/slice.cc                                                 \
   util/file_checksum_helper.cc                                  \
+  util/frequency_sketch.cc                                      \
   util/status.cc                                                \
   util/string_util.cc                                           \
   util/thread_local.cc                                          \
@@ -273,6 +285,7 @@ LIB_SOURCES =                                                   \
   utilities/persistent_cache/persistent_cache_tier.cc           \
   utilities/persistent_cache/volatile_tier_impl.cc              \
   utilities/simulator_cache/cache_simulator.cc                  \
+  utilities/simulator_cache/row_cache_simulator.cc              \
   utilities/simulator_cache/sim_cache.cc                        \
   utilities/table_properties_collectors/compact_on_deletion_collector.cc \
   utilities/trace/file_trace_reader_writer.cc                   \
@@ -402,7 +415,9 @@ TEST_MAIN_SOURCES =                                                     \
   cache/cache_test.cc                                                   \
   cache/cache_reservation_manager_test.cc                               \
   cache/lru_cache_test.cc                                               \
+  cache/clock_cache_test.cc                                             \
   cache/lru_secondary_cache_test.cc                                     \
+  cache/file_secondary_cache_test.cc                                    \
   db/blob/blob_counting_iterator_test.cc                                \
   db/blob/blob_file_addition_test.cc                                    \
   db/blob/blob_file_builder_test.cc                                     \
@@ -471,6 +486,7 @@ TEST_MAIN_SOURCES =                                                     \
   db/file_indexer_test.cc                                               \
   db/filename_test.cc                                                   \
   db/flush_job_test.cc                                                  \
+  db/kv_cache_policy_table_test.cc                                      \
   db/listener_test.cc                                                   \
   db/log_test.cc                                                        \
   db/manual_compaction_test.cc                                          \
@@ -484,6 +500,7 @@ TEST_MAIN_SOURCES =                                                     \
   db/plain_table_db_test.cc                                             \
   db/prefix_test.cc                                                     \
   db/repair_test.cc                                                     \
+  db/row_cache_admission_policy_test.cc                                 \
   db/range_del_aggregator_test.cc                                       \
   db/range_tombstone_fragmenter_test.cc                                 \
   db/table_properties_collector_test.cc                                 \
@@ -547,6 +564,7 @@ TEST_MAIN_SOURCES =                                                     \
   util/dynamic_bloom_test.cc                                            \
   util/filelock_test.cc                                                 \
   util/file_reader_writer_test.cc                                       \
+  util/frequency_sketch_test.cc                                         \
   util/hash_test.cc                                                     \
   util/heap_test.cc                                                     \
   util/random_test.cc                                                   \
@@ -576,6 +594,7 @@ TEST_MAIN_SOURCES =                                                     \
   utilities/persistent_cache/hash_table_test.cc                         \
   utilities/persistent_cache/persistent_cache_test.cc                   \
   utilities/simulator_cache/cache_simulator_test.cc                     \
+  utilities/simulator_cache/row_cache_simulator_test.cc                 \
   utilities/simulator_cache/sim_cache_test.cc                           \
   utilities/table_properties_collectors/compact_on_deletion_collector_test.cc  \
   utilities/transactions/optimistic_transaction_test.cc                 \
@@ -595,6 +614,7 @@ TEST_MAIN_SOURCES_C = \
 MICROBENCH_SOURCES =                                          \
   microbench/ribbon_bench.cc                                  \
   microbench/db_basic_bench.cc                                  \
+  microbench/huge_page_allocator_bench.cc                       \
 
 JNI_NATIVE_SOURCES =                                          \
   java/rocksjni/backupenginejni.cc                            \
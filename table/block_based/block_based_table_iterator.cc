@@ -16,6 +16,7 @@ void BlockBasedTableIterator::SeekToFirst() { SeekImpl(nullptr); }
 void BlockBasedTableIterator::SeekImpl(const Slice* target) {
   is_out_of_bound_ = false;
   is_at_first_key_from_index_ = false;
+  data_blocks_since_seek_ = 0;
   if (target && !CheckPrefixMayMatch(*target, IterDirection::kForward)) {
     ResetDataIter();
     return;
@@ -102,6 +103,7 @@ void BlockBasedTableIterator::SeekImpl(const Slice* target) {
 void BlockBasedTableIterator::SeekForPrev(const Slice& target) {
   is_out_of_bound_ = false;
   is_at_first_key_from_index_ = false;
+  data_blocks_since_seek_ = 0;
   // For now totally disable prefix seek in auto prefix mode because we don't
   // have logic
   if (!CheckPrefixMayMatch(target, IterDirection::kBackward)) {
@@ -162,6 +164,7 @@ void BlockBasedTableIterator::SeekForPrev(const Slice& target) {
 void BlockBasedTableIterator::SeekToLast() {
   is_out_of_bound_ = false;
   is_at_first_key_from_index_ = false;
+  data_blocks_since_seek_ = 0;
   SavePrevIndexValue();
   index_iter_->SeekToLast();
   if (!index_iter_->Valid()) {
@@ -235,6 +238,13 @@ void BlockBasedTableIterator::InitDataBlock() {
     block_prefetcher_.PrefetchIfNeeded(
         rep, data_block_handle, read_options_.readahead_size, is_for_compaction,
         read_options_.async_io);
+    // Blocks of a long scan are inserted into the block cache with bottom
+    // priority
+    lookup_context_.fill_with_bottom_priority =
+        read_options_.scan_resistant_fill_after_blocks > 0 &&
+        data_blocks_since_seek_ >=
+            read_options_.scan_resistant_fill_after_blocks;
+    ++data_blocks_since_seek_;
     Status s;
     table_->NewDataBlockIterator<DataBlockIter>(
         read_options_, data_block_handle, &block_iter_, BlockType::kData,
@@ -215,6 +215,9 @@ class BlockBasedTableIterator : public InternalIteratorBase<Slice> {
   const SliceTransform* prefix_extractor_;
   uint64_t prev_block_offset_ = std::numeric_limits<uint64_t>::max();
   BlockCacheLookupContext lookup_context_;
+  // Data blocks loaded since the last seek, see
+  // ReadOptions::scan_resistant_fill_after_blocks
+  uint64_t data_blocks_since_seek_ = 0;
 
   BlockPrefetcher block_prefetcher_;
 
@@ -1162,7 +1162,7 @@ Status BlockBasedTable::GetDataBlockFromCache(
     const Slice& cache_key, Cache* block_cache, Cache* block_cache_compressed,
     const ReadOptions& read_options, CachableEntry<TBlocklike>* block,
     const UncompressionDict& uncompression_dict, BlockType block_type,
-    const bool wait, GetContext* get_context) const {
+    const bool wait, GetContext* get_context, bool block_cache_missed) const {
   const size_t read_amp_bytes_per_bit =
       block_type == BlockType::kData
           ? rep_->table_options.read_amp_bytes_per_bit
@@ -1187,7 +1187,9 @@ Status BlockBasedTable::GetDataBlockFromCache(
       read_amp_bytes_per_bit, statistics, using_zstd, filter_policy);
 
   // Lookup uncompressed cache first
-  if (block_cache != nullptr) {
+  if (block_cache != nullptr && block_cache_missed) {
+    UpdateCacheMissMetrics(block_type, get_context);
+  } else if (block_cache != nullptr) {
     assert(!cache_key.empty());
     Cache::Handle* cache_handle = nullptr;
     cache_handle = GetEntryFromCache(
@@ -1293,20 +1295,23 @@ Status BlockBasedTable::PutDataBlockToCache(
     CompressionType raw_block_comp_type,
     const UncompressionDict& uncompression_dict,
     MemoryAllocator* memory_allocator, BlockType block_type,
-    GetContext* get_context) const {
+    GetContext* get_context, bool bottom_priority) const {
   const ImmutableOptions& ioptions = rep_->ioptions;
   const uint32_t format_version = rep_->table_options.format_version;
   const size_t read_amp_bytes_per_bit =
       block_type == BlockType::kData
           ? rep_->table_options.read_amp_bytes_per_bit
           : 0;
-  const Cache::Priority priority =
+  Cache::Priority priority =
       rep_->table_options.cache_index_and_filter_blocks_with_high_priority &&
               (block_type == BlockType::kFilter ||
                block_type == BlockType::kCompressionDictionary ||
                block_type == BlockType::kIndex)
           ? Cache::Priority::HIGH
           : Cache::Priority::LOW;
+  if (bottom_priority) {
+    priority = Cache::Priority::BOTTOM;
+  }
   assert(cached_block);
   assert(cached_block->IsEmpty());
 
@@ -1474,7 +1479,8 @@ Status BlockBasedTable::MaybeReadBlockAndLoadToCache(
     const BlockHandle& handle, const UncompressionDict& uncompression_dict,
     const bool wait, CachableEntry<TBlocklike>* block_entry,
     BlockType block_type, GetContext* get_context,
-    BlockCacheLookupContext* lookup_context, BlockContents* contents) const {
+    BlockCacheLookupContext* lookup_context, BlockContents* contents,
+    bool block_cache_missed) const {
   assert(block_entry != nullptr);
   const bool no_io = (ro.read_tier == kBlockCacheTier);
   Cache* block_cache = rep_->table_options.block_cache.get();
@@ -1497,7 +1503,7 @@ Status BlockBasedTable::MaybeReadBlockAndLoadToCache(
       // [point lookup flow 조사] - Block cache hit 여부 조사
       s = GetDataBlockFromCache(key, block_cache, block_cache_compressed, ro,
                                 block_entry, uncompression_dict, block_type,
-                                wait, get_context);
+                                wait, get_context, block_cache_missed);
       // Value could still be null at this point, so check the cache handle
       // and update the read pattern for prefetching
       if (block_entry->GetValue() || block_entry->GetCacheHandle()) {
@@ -1567,7 +1573,10 @@ Status BlockBasedTable::MaybeReadBlockAndLoadToCache(
         s = PutDataBlockToCache(
             key, block_cache, block_cache_compressed, block_entry, contents,
             raw_block_comp_type, uncompression_dict,
-            GetMemoryAllocator(rep_->table_options), block_type, get_context);
+            GetMemoryAllocator(rep_->table_options), block_type, get_context,
+            /*bottom_priority=*/block_type == BlockType::kData &&
+                lookup_context != nullptr &&
+                lookup_context->fill_with_bottom_priority);
       }
     }
   }
@@ -2354,18 +2363,6 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
   // [point lookup flow 조사] - bloom filter 체크
   const bool may_match = FullFilterKeyMayMatch(
       filter, key, no_io, prefix_extractor, get_context, &lookup_context);
-  // [logging 추가] - Bloom filter 결과 (true / false)
-  if (const char* p = std::getenv("LOGGING_BF"); p && p[0] == '1') {
-    Slice uk = ExtractUserKey(key);
-    std::string uk_hex = uk.ToString(true);
-    std::fprintf(stderr,
-        "[BF] sst=%" PRIu64 " lvl=%d may_match=%d key=%s\n",
-        rep_->sst_number_for_tracing(),              
-        rep_->level_for_tracing(),                  
-        may_match ? 1 : 0,                          
-        uk_hex.c_str());
-    std::fflush(stderr);
-  }
   TEST_SYNC_POINT("BlockBasedTable::Get:AfterFilterMatch");
   // [point lookup flow 조사] - BF가 false, 즉 key가 무조건 없다고 확인된 경우
   if (!may_match) {
@@ -2434,24 +2431,6 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
           read_options, v.handle, &biter, BlockType::kData, get_context,
           &lookup_data_block_context,
           /*s=*/Status(), /*prefetch_buffer*/ nullptr);
-      
-      // [logging 추가] - Target data block cache hit 여부
-      if (const char* p = std::getenv("LOGGING_BLOCK_CACHE_HIT_CHECK"); p && p[0] == '1') {
-        // NewDataBlockIterator가 내부적으로 캐시 조회를 수행하며
-        // lookup_data_block_context.is_cache_hit 에 반영
-        const bool cache_hit = lookup_data_block_context.is_cache_hit;
-        const bool did_io = !cache_hit;
-
-        std::fprintf(stderr,
-            "[Block Cache] sst=%" PRIu64 " lvl=%d block_off=%" PRIu64 " cache=%s io=%d status=%s\n",
-            rep_->sst_number_for_tracing(),
-            rep_->level_for_tracing(),
-            v.handle.offset(),
-            cache_hit ? "HIT" : "MISS",
-            did_io ? 1 : 0,
-            biter.status().ToString().c_str());
-        std::fflush(stderr);
-      }
 
       if (no_io && biter.status().IsIncomplete()) {
         // couldn't get block from block_cache
@@ -2497,16 +2476,6 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
           }
         }
         s = biter.status();
-        // [logging 추가] - 읽어온 data block 내 target key 존재 여부
-        if (const char* p = std::getenv("LOGGING_TARGET_KEY_SEARCH"); p && p[0] == '1') {
-          std::fprintf(stderr,
-              "[Target key in Data block search] sst=%" PRIu64 " lvl=%d block_off=%" PRIu64 " found=%d\n",
-              rep_->sst_number_for_tracing(),
-              rep_->level_for_tracing(),
-              v.handle.offset(),
-              does_referenced_key_exist ? 1 : 0);
-          std::fflush(stderr);
-        }
       }
       // Write the block cache access record.
       if (block_cache_tracer_ && block_cache_tracer_->is_tracing_enabled()) {
@@ -2613,6 +2582,10 @@ void BlockBasedTable::MultiGet(const ReadOptions& read_options,
                                      sst_file_range.end());
       std::vector<Cache::Handle*> cache_handles;
       bool wait_for_cache_results = false;
+      // Position in block_handles of each data block to look up in the
+      // cache, and the context of the first key in it
+      autovector<size_t, MultiGetContext::MAX_BATCH_SIZE> lookup_idxs;
+      autovector<GetContext*, MultiGetContext::MAX_BATCH_SIZE> lookup_contexts;
 
       CachableEntry<UncompressionDict> uncompression_dict;
       Status uncompression_dict_status;
@@ -2672,52 +2645,129 @@ void BlockBasedTable::MultiGet(const ReadOptions& read_options,
           block_handles.emplace_back(BlockHandle::NullBlockHandle());
           continue;
         }
-        // Lookup the cache for the given data block referenced by an index
-        // iterator value (i.e BlockHandle). If it exists in the cache,
-        // initialize block to the contents of the data block.
+        // The cache is looked up for the data block referenced by the index
+        // iterator value (i.e BlockHandle) below, for all keys at once.
         offset = v.handle.offset();
-        BlockHandle handle = v.handle;
-        BlockCacheLookupContext lookup_data_block_context(
-            TableReaderCaller::kUserMultiGet);
-        const UncompressionDict& dict = uncompression_dict.GetValue()
-                                            ? *uncompression_dict.GetValue()
+        block_handles.emplace_back(v.handle);
+        lookup_idxs.push_back(block_handles.size() - 1);
+        lookup_contexts.push_back(miter->get_context);
+      }
+
+      // Probe the block cache for all the data blocks in one batch, which
+      // hashes the keys up front and locks each cache shard once. As with
+      // Lookup(), the batch also searches the secondary cache, so that a
+      // block it misses is only looked for in the compressed block cache,
+      // without a second probe of block_cache.
+      Cache* block_cache = rep_->table_options.block_cache.get();
+      const bool batch_lookup =
+          block_cache != nullptr && lookup_idxs.size() > 1;
+      std::array<Cache::Handle*, MultiGetContext::MAX_BATCH_SIZE>
+          batch_cache_handles;
+      batch_cache_handles.fill(nullptr);
+      // Whether the batch found the block at a position in block_handles in
+      // the secondary cache, still being read when MultiLookup returned. Its
+      // hit is counted only once WaitAll() shows the value.
+      std::array<bool, MultiGetContext::MAX_BATCH_SIZE> batch_hit_pending;
+      batch_hit_pending.fill(false);
+      std::array<GetContext*, MultiGetContext::MAX_BATCH_SIZE>
+          batch_hit_contexts;
+      batch_hit_contexts.fill(nullptr);
+      if (batch_lookup) {
+        std::array<CacheKey, MultiGetContext::MAX_BATCH_SIZE> cache_keys;
+        std::array<Slice, MultiGetContext::MAX_BATCH_SIZE> cache_key_slices;
+        for (size_t i = 0; i < lookup_idxs.size(); ++i) {
+          cache_keys[i] =
+              GetCacheKey(rep_->base_cache_key, block_handles[lookup_idxs[i]]);
+          cache_key_slices[i] = cache_keys[i].AsSlice();
+        }
+        Statistics* statistics = rep_->ioptions.statistics.get();
+        if (rep_->ioptions.lowest_used_cache_tier ==
+            CacheTier::kNonVolatileBlockTier) {
+          block_cache->MultiLookup(
+              lookup_idxs.size(), cache_key_slices.data(),
+              BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kData),
+              GetCreateCallback<Block>(
+                  rep_->table_options.read_amp_bytes_per_bit, statistics,
+                  rep_->blocks_definitely_zstd_compressed,
+                  rep_->filter_policy),
+              Cache::Priority::LOW, /* wait */ false,
+              batch_cache_handles.data(), statistics);
+        } else {
+          block_cache->MultiLookup(lookup_idxs.size(),
+                                   cache_key_slices.data(),
+                                   batch_cache_handles.data(), statistics);
+        }
+      }
+
+      for (size_t i = 0; i < lookup_idxs.size(); ++i) {
+        size_t idx = lookup_idxs[i];
+        BlockHandle handle = block_handles[idx];
+        Status s;
+        if (batch_cache_handles[i] != nullptr) {
+          if (block_cache->IsReady(batch_cache_handles[i]) &&
+              block_cache->Value(batch_cache_handles[i]) != nullptr) {
+            UpdateCacheHitMetrics(
+                BlockType::kData, lookup_contexts[i],
+                block_cache->GetUsage(batch_cache_handles[i]));
+          } else {
+            batch_hit_pending[idx] = true;
+            batch_hit_contexts[idx] = lookup_contexts[i];
+          }
+          results[idx].SetCachedValue(
+              reinterpret_cast<Block*>(
+                  block_cache->Value(batch_cache_handles[i])),
+              block_cache, batch_cache_handles[i]);
+        } else {
+          // Lookup the cache for the given data block referenced by an index
+          // iterator value (i.e BlockHandle). If it exists in the cache,
+          // initialize block to the contents of the data block.
+          BlockCacheLookupContext lookup_data_block_context(
+              TableReaderCaller::kUserMultiGet);
+          const UncompressionDict& dict =
+              uncompression_dict.GetValue() ? *uncompression_dict.GetValue()
                                             : UncompressionDict::GetEmptyDict();
-        Status s = RetrieveBlock(
-            nullptr, ro, handle, dict, &(results.back()), BlockType::kData,
-            miter->get_context, &lookup_data_block_context,
-            /* for_compaction */ false, /* use_cache */ true,
-            /* wait_for_cache */ false);
+          if (batch_lookup) {
+            s = MaybeReadBlockAndLoadToCache(
+                nullptr, ro, handle, dict, /* wait */ false, &results[idx],
+                BlockType::kData, lookup_contexts[i],
+                &lookup_data_block_context, /* contents */ nullptr,
+                /* block_cache_missed */ true);
+          } else {
+            s = RetrieveBlock(
+                nullptr, ro, handle, dict, &results[idx], BlockType::kData,
+                lookup_contexts[i], &lookup_data_block_context,
+                /* for_compaction */ false, /* use_cache */ true,
+                /* wait_for_cache */ false);
+          }
+        }
         if (s.IsIncomplete()) {
           s = Status::OK();
         }
-        if (s.ok() && !results.back().IsEmpty()) {
+        if (s.ok() && !results[idx].IsEmpty()) {
           // Since we have a valid handle, check the value. If its nullptr,
           // it means the cache is waiting for the final result and we're
           // supposed to call WaitAll() to wait for the result.
-          if (results.back().GetValue() != nullptr) {
+          if (results[idx].GetValue() != nullptr) {
             // Found it in the cache. Add NULL handle to indicate there is
             // nothing to read from disk.
-            if (results.back().GetCacheHandle()) {
-              results.back().UpdateCachedValue();
+            if (results[idx].GetCacheHandle()) {
+              results[idx].UpdateCachedValue();
             }
-            block_handles.emplace_back(BlockHandle::NullBlockHandle());
+            block_handles[idx] = BlockHandle::NullBlockHandle();
           } else {
             // We have to wait for the cache lookup to finish in the
             // background, and then we may have to read the block from disk
             // anyway
-            assert(results.back().GetCacheHandle());
+            assert(results[idx].GetCacheHandle());
             wait_for_cache_results = true;
-            block_handles.emplace_back(handle);
-            cache_handles.emplace_back(results.back().GetCacheHandle());
+            cache_handles.emplace_back(results[idx].GetCacheHandle());
           }
         } else {
-          block_handles.emplace_back(handle);
           total_len += BlockSizeWithTrailer(handle);
         }
       }
 
       if (wait_for_cache_results) {
-        Cache* block_cache = rep_->table_options.block_cache.get();
         block_cache->WaitAll(cache_handles);
         for (size_t i = 0; i < block_handles.size(); ++i) {
           // If this block was a success or failure or not needed because
@@ -2732,9 +2782,17 @@ void BlockBasedTable::MultiGet(const ReadOptions& read_options,
             // The async cache lookup failed - could be due to an error
             // or a false positive. We need to read the data block from
             // the SST file
+            if (batch_hit_pending[i]) {
+              UpdateCacheMissMetrics(BlockType::kData, batch_hit_contexts[i]);
+            }
             results[i].Reset();
             total_len += BlockSizeWithTrailer(block_handles[i]);
           } else {
+            if (batch_hit_pending[i]) {
+              UpdateCacheHitMetrics(
+                  BlockType::kData, batch_hit_contexts[i],
+                  block_cache->GetUsage(results[i].GetCacheHandle()));
+            }
             block_handles[i] = BlockHandle::NullBlockHandle();
           }
         }
@@ -339,13 +339,16 @@ class BlockBasedTable : public TableReader {
   // @param block_entry value is set to the uncompressed block if found. If
   //    in uncompressed block cache, also sets cache_handle to reference that
   //    block.
+  // @param block_cache_missed the caller already looked the block up in the
+  //    uncompressed cache, and missed, so that step is skipped.
   template <typename TBlocklike>
   Status MaybeReadBlockAndLoadToCache(
       FilePrefetchBuffer* prefetch_buffer, const ReadOptions& ro,
       const BlockHandle& handle, const UncompressionDict& uncompression_dict,
       const bool wait, CachableEntry<TBlocklike>* block_entry,
       BlockType block_type, GetContext* get_context,
-      BlockCacheLookupContext* lookup_context, BlockContents* contents) const;
+      BlockCacheLookupContext* lookup_context, BlockContents* contents,
+      bool block_cache_missed = false) const;
 
   // Similar to the above, with one crucial difference: it will retrieve the
   // block from the file even if there are no caches configured (assuming the
@@ -399,7 +402,8 @@ class BlockBasedTable : public TableReader {
                                CachableEntry<TBlocklike>* block,
                                const UncompressionDict& uncompression_dict,
                                BlockType block_type, const bool wait,
-                               GetContext* get_context) const;
+                               GetContext* get_context,
+                               bool block_cache_missed = false) const;
 
   // Put a raw block (maybe compressed) to the corresponding block caches.
   // This method will perform decompression against raw_block if needed and then
@@ -411,6 +415,8 @@ class BlockBasedTable : public TableReader {
   // PutDataBlockToCache(). After the call, the object will be invalid.
   // @param uncompression_dict Data for presetting the compression library's
   //    dictionary.
+  // @param bottom_priority Insert into block_cache with
+  //    Cache::Priority::BOTTOM, as blocks of long scans are.
   template <typename TBlocklike>
   Status PutDataBlockToCache(const Slice& cache_key, Cache* block_cache,
                              Cache* block_cache_compressed,
@@ -419,8 +425,8 @@ class BlockBasedTable : public TableReader {
                              CompressionType raw_block_comp_type,
                              const UncompressionDict& uncompression_dict,
                              MemoryAllocator* memory_allocator,
-                             BlockType block_type,
-                             GetContext* get_context) const;
+                             BlockType block_type, GetContext* get_context,
+                             bool bottom_priority) const;
 
   // Calls (*handle_result)(arg, ...) repeatedly, starting with the entry found
   // after a call to Seek(key), until handle_result returns false.
@@ -168,6 +168,12 @@ class GetContext {
 
   bool has_callback() const { return callback_ != nullptr; }
 
+  // Whether the row cache was already looked up by user key for this key and
+  // missed. Rows cached by user key do not depend on the file being read, so
+  // the files read after that need not look again.
+  bool user_key_row_cache_missed() const { return user_key_row_cache_missed_; }
+  void set_user_key_row_cache_missed() { user_key_row_cache_missed_ = true; }
+
   uint64_t get_tracing_get_id() const { return tracing_get_id_; }
 
   void push_operand(const Slice& value, Cleanable* value_pinner);
@@ -207,6 +213,7 @@ class GetContext {
   // Get or a MultiGet.
   const uint64_t tracing_get_id_;
   BlobFetcher* blob_fetcher_;
+  bool user_key_row_cache_missed_ = false;
 };
 
 // Call this to replay a log and bring the get_context up to date. The replay
@@ -36,6 +36,9 @@ struct KeyContext {
   PinnableSlice* value;
   std::string* timestamp;
   GetContext* get_context;
+  // Set if a table file found the key but the row cache admission policy
+  // rejected it for migration (RowCacheAdmissionDecision::kRejectForMigration)
+  bool row_cache_skipped_on_io;
 
   KeyContext(ColumnFamilyHandle* col_family, const Slice& user_key,
              PinnableSlice* val, std::string* ts, Status* stat)
@@ -49,7 +52,8 @@ struct KeyContext {
         cb_arg(nullptr),
         value(val),
         timestamp(ts),
-        get_context(nullptr) {}
+        get_context(nullptr),
+        row_cache_skipped_on_io(false) {}
 
   KeyContext() = default;
 };
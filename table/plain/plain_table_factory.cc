@@ -221,6 +221,27 @@ static int RegisterBuiltinMemTableRepFactory(ObjectLibrary& library,
         }
         return guard->get();
       });
+  library.AddFactory<MemTableRepFactory>(
+      AsPattern("ConcurrentHashRepFactory", "concurrent_hash"),
+      [](const std::string& uri, std::unique_ptr<MemTableRepFactory>* guard,
+         std::string* /*errmsg*/) {
+        // Expecting format: concurrent_hash:<hash_bucket_count>
+        auto colon = uri.find(":");
+        if (colon != std::string::npos) {
+          size_t hash_bucket_count = ParseSizeT(uri.substr(colon + 1));
+          guard->reset(NewConcurrentHashRepFactory(hash_bucket_count));
+        } else {
+          guard->reset(NewConcurrentHashRepFactory());
+        }
+        return guard->get();
+      });
+  library.AddFactory<MemTableRepFactory>(
+      ObjectLibrary::PatternEntry("BTreeRepFactory", true).AnotherName("btree"),
+      [](const std::string& /*uri*/,
+         std::unique_ptr<MemTableRepFactory>* guard, std::string* /*errmsg*/) {
+        guard->reset(NewBTreeRepFactory());
+        return guard->get();
+      });
   library.AddFactory<MemTableRepFactory>(
       "cuckoo",
       [](const std::string& /*uri*/,
@@ -149,6 +149,16 @@ DEFINE_int32(analyze_correlation_coefficients_max_number_of_values, 1000000,
              "The maximum number of values for a feature. If the number of "
              "values for a feature is larger than this max, it randomly "
              "selects 'max' number of values.");
+DEFINE_string(row_cache_sim_capacities, "",
+              "Comma-separated row cache capacities in bytes. If non-empty, the "
+              "row cache accesses of the trace are replayed against simulated "
+              "row caches of these capacities.");
+DEFINE_string(row_cache_sim_policies, "lru,hybrid,tinylfu",
+              "Comma-separated admission policies of the simulated row "
+              "caches: lru, hybrid or tinylfu.");
+DEFINE_int32(row_cache_sim_max_invalidation_threshold, 4,
+             "The hybrid row cache is simulated with every invalidation "
+             "threshold from 1 to this value.");
 DEFINE_string(human_readable_trace_file_path, "",
               "The filt path that saves human readable access records.");
 
@@ -156,6 +166,7 @@ namespace ROCKSDB_NAMESPACE {
 namespace {
 
 const std::string kMissRatioCurveFileName = "mrc";
+const std::string kRowCacheSimulationFileName = "row_cache_sim";
 const std::string kGroupbyBlock = "block";
 const std::string kGroupbyTable = "table";
 const std::string kGroupbyColumnFamily = "cf";
@@ -372,6 +383,54 @@ void BlockCacheTraceAnalyzer::WriteMissRatioCurves() const {
   out.close();
 }
 
+void BlockCacheTraceAnalyzer::WriteRowCacheSimulationResults() const {
+  if (!row_cache_simulator_) {
+    return;
+  }
+  if (output_dir_.empty()) {
+    return;
+  }
+  const std::string output_path =
+      output_dir_ + "/" + kRowCacheSimulationFileName;
+  std::ofstream out(output_path);
+  if (!out.is_open()) {
+    return;
+  }
+  // Write header.
+  const std::string header =
+      "policy,capacity,lookups,hits,hit_ratio,bytes_saved,admitted,rejected,"
+      "migrated,migrated_bytes,invalidated";
+  out << header << std::endl;
+  for (auto const& config_cache : row_cache_simulator_->sim_caches()) {
+    const RowCacheSimConfiguration& config = config_cache.first;
+    const RowCacheSimStats& stats = config_cache.second->stats();
+    // Write the body.
+    out << config.ToString();
+    out << ",";
+    out << config.capacity;
+    out << ",";
+    out << stats.lookups;
+    out << ",";
+    out << stats.hits;
+    out << ",";
+    out << std::fixed << std::setprecision(4) << stats.hit_ratio();
+    out << ",";
+    out << stats.bytes_saved;
+    out << ",";
+    out << stats.admitted;
+    out << ",";
+    out << stats.rejected;
+    out << ",";
+    out << stats.migrated;
+    out << ",";
+    out << stats.migrated_bytes;
+    out << ",";
+    out << stats.invalidated;
+    out << std::endl;
+  }
+  out.close();
+}
+
 void BlockCacheTraceAnalyzer::UpdateFeatureVectors(
     const std::vector<uint64_t>& access_sequence_number_timeline,
     const std::vector<uint64_t>& access_timeline, const std::string& label,
@@ -1440,7 +1499,8 @@ BlockCacheTraceAnalyzer::BlockCacheTraceAnalyzer(
     const std::string& human_readable_trace_file_path,
     bool compute_reuse_distance, bool mrc_only,
     bool is_human_readable_trace_file,
-    std::unique_ptr<BlockCacheTraceSimulator>&& cache_simulator)
+    std::unique_ptr<BlockCacheTraceSimulator>&& cache_simulator,
+    std::unique_ptr<RowCacheTraceSimulator>&& row_cache_simulator)
     : env_(ROCKSDB_NAMESPACE::Env::Default()),
       trace_file_path_(trace_file_path),
       output_dir_(output_dir),
@@ -1448,7 +1508,8 @@ BlockCacheTraceAnalyzer::BlockCacheTraceAnalyzer(
       compute_reuse_distance_(compute_reuse_distance),
       mrc_only_(mrc_only),
       is_human_readable_trace_file_(is_human_readable_trace_file),
-      cache_simulator_(std::move(cache_simulator)) {}
+      cache_simulator_(std::move(cache_simulator)),
+      row_cache_simulator_(std::move(row_cache_simulator)) {}
 
 void BlockCacheTraceAnalyzer::ComputeReuseDistance(
     BlockAccessInfo* info) const {
@@ -1553,6 +1614,13 @@ Status BlockCacheTraceAnalyzer::Analyze() {
     if (!s.ok()) {
       break;
     }
+    if (BlockCacheTraceHelper::IsRowCacheAccess(access.block_type)) {
+      // Row cache accesses only feed the row cache simulators.
+      if (row_cache_simulator_) {
+        row_cache_simulator_->Access(access);
+      }
+      continue;
+    }
     if (!mrc_only_) {
       s = RecordAccess(access);
       if (!s.ok()) {
@@ -2107,6 +2175,48 @@ std::vector<uint64_t> parse_buckets(const std::string& bucket_str) {
   return buckets;
 }
 
+std::vector<RowCacheSimConfiguration> parse_row_cache_sim_configs(
+    const std::string& capacities_str, const std::string& policies_str,
+    uint32_t max_invalidation_threshold) {
+  std::vector<RowCacheSimConfiguration> configs;
+  if (capacities_str.empty()) {
+    return configs;
+  }
+  std::vector<std::string> policies;
+  std::stringstream policy_ss(policies_str);
+  while (policy_ss.good()) {
+    std::string policy;
+    getline(policy_ss, policy, ',');
+    policies.push_back(policy);
+  }
+  std::stringstream ss(capacities_str);
+  while (ss.good()) {
+    std::string capacity_str;
+    getline(ss, capacity_str, ',');
+    uint64_t capacity = ParseUint64(capacity_str);
+    if (capacity == 0) {
+      fprintf(stderr, "Invalid row cache capacity %s\n",
+              capacity_str.c_str());
+      exit(1);
+    }
+    for (const std::string& policy : policies) {
+      RowCacheSimConfiguration config;
+      config.policy_name = policy;
+      config.capacity = capacity;
+      if (policy != "hybrid") {
+        configs.push_back(config);
+        continue;
+      }
+      for (uint32_t threshold = 1; threshold <= max_invalidation_threshold;
+           threshold++) {
+        config.invalidation_threshold = threshold;
+        configs.push_back(config);
+      }
+    }
+  }
+  return configs;
+}
+
 int block_cache_trace_analyzer_tool(int argc, char** argv) {
   ParseCommandLineFlags(&argc, &argv, true);
   if (FLAGS_block_cache_trace_path.empty()) {
@@ -2131,11 +2241,29 @@ int block_cache_trace_analyzer_tool(int argc, char** argv) {
       exit(1);
     }
   }
+  std::vector<RowCacheSimConfiguration> row_cache_configs =
+      parse_row_cache_sim_configs(
+          FLAGS_row_cache_sim_capacities, FLAGS_row_cache_sim_policies,
+          FLAGS_row_cache_sim_max_invalidation_threshold > 0
+              ? FLAGS_row_cache_sim_max_invalidation_threshold
+              : 0);
+  std::unique_ptr<RowCacheTraceSimulator> row_cache_simulator;
+  if (!row_cache_configs.empty()) {
+    row_cache_simulator.reset(
+        new RowCacheTraceSimulator(warmup_seconds, row_cache_configs));
+    Status s = row_cache_simulator->InitializeCaches();
+    if (!s.ok()) {
+      fprintf(stderr, "Cannot initialize row cache simulators %s\n",
+              s.ToString().c_str());
+      exit(1);
+    }
+  }
   BlockCacheTraceAnalyzer analyzer(
       FLAGS_block_cache_trace_path, FLAGS_block_cache_analysis_result_dir,
       FLAGS_human_readable_trace_file_path,
       !FLAGS_reuse_distance_labels.empty(), FLAGS_mrc_only,
-      FLAGS_is_block_cache_human_readable_trace, std::move(cache_simulator));
+      FLAGS_is_block_cache_human_readable_trace, std::move(cache_simulator),
+      std::move(row_cache_simulator));
   Status s = analyzer.Analyze();
   if (!s.IsIncomplete() && !s.ok()) {
     // Read all traces.
@@ -2144,6 +2272,7 @@ int block_cache_trace_analyzer_tool(int argc, char** argv) {
   }
   fprintf(stdout, "Status: %s\n", s.ToString().c_str());
   analyzer.WriteMissRatioCurves();
+  analyzer.WriteRowCacheSimulationResults();
   analyzer.WriteMissRatioTimeline(1);
   analyzer.WriteMissRatioTimeline(kSecondInMinute);
   analyzer.WriteMissRatioTimeline(kSecondInHour);
@@ -15,6 +15,7 @@
 #include "rocksdb/utilities/sim_cache.h"
 #include "trace_replay/block_cache_tracer.h"
 #include "utilities/simulator_cache/cache_simulator.h"
+#include "utilities/simulator_cache/row_cache_simulator.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -149,7 +150,8 @@ class BlockCacheTraceAnalyzer {
       const std::string& human_readable_trace_file_path,
       bool compute_reuse_distance, bool mrc_only,
       bool is_human_readable_trace_file,
-      std::unique_ptr<BlockCacheTraceSimulator>&& cache_simulator);
+      std::unique_ptr<BlockCacheTraceSimulator>&& cache_simulator,
+      std::unique_ptr<RowCacheTraceSimulator>&& row_cache_simulator = nullptr);
   ~BlockCacheTraceAnalyzer() = default;
   // No copy and move.
   BlockCacheTraceAnalyzer(const BlockCacheTraceAnalyzer&) = delete;
@@ -234,6 +236,14 @@ class BlockCacheTraceAnalyzer {
   // "cache_name,num_shard_bits,capacity,miss_ratio,total_accesses".
   void WriteMissRatioCurves() const;
 
+  // Write the results of the simulated row cache configurations into a csv
+  // file named "row_cache_sim" saved in 'output_dir'.
+  //
+  // The file format is
+  // "policy,capacity,lookups,hits,hit_ratio,bytes_saved,admitted,rejected,
+  // migrated,migrated_bytes,invalidated".
+  void WriteRowCacheSimulationResults() const;
+
   // Write miss ratio timeline of simulated cache configurations into several
   // csv files, one per cache capacity saved in 'output_dir'.
   //
@@ -379,6 +389,7 @@ class BlockCacheTraceAnalyzer {
 
   BlockCacheTraceHeader header_;
   std::unique_ptr<BlockCacheTraceSimulator> cache_simulator_;
+  std::unique_ptr<RowCacheTraceSimulator> row_cache_simulator_;
   std::map<std::string, ColumnFamilyAccessInfoAggregate> cf_aggregates_map_;
   std::map<std::string, BlockAccessInfo*> block_info_map_;
   std::unordered_map<std::string, GetKeyInfo> get_key_info_map_;
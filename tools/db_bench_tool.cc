@@ -55,6 +55,7 @@
 #include "rocksdb/perf_context.h"
 #include "rocksdb/persistent_cache.h"
 #include "rocksdb/rate_limiter.h"
+#include "rocksdb/row_cache_admission_policy.h"
 #include "rocksdb/secondary_cache.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
@@ -556,6 +557,11 @@ DEFINE_double(cache_high_pri_pool_ratio, 0.0,
 DEFINE_bool(use_clock_cache, false,
             "Replace default LRU block cache with clock cache.");
 
+DEFINE_int64(cache_tiny_lfu_sketch_entries, 0,
+             "If > 0, enable TinyLFU admission in the LRU block cache with a "
+             "frequency sketch sized for this many keys. See "
+             "LRUCacheOptions::tiny_lfu_sketch_entries.");
+
 DEFINE_bool(use_lru_secondary_cache, false,
             "Use the LRUSecondaryCache as the secondary cache.");
 
@@ -598,6 +604,10 @@ DEFINE_bool(cache_index_and_filter_blocks, false,
 DEFINE_bool(use_cache_memkind_kmem_allocator, false,
             "Use memkind kmem allocator for block cache.");
 
+DEFINE_bool(use_cache_huge_page_allocator, false,
+            "Allocate the block cache from huge pages, with "
+            "NewHugePageMemoryAllocator().");
+
 DEFINE_bool(partition_index_and_filters, false,
             "Partition index and filter blocks.");
 
@@ -686,6 +696,38 @@ DEFINE_int64(row_cache_size, 0,
              "Number of bytes to use as a cache of individual rows"
              " (0 = disabled).");
 
+DEFINE_bool(row_cache_hybrid_admission,
+            ROCKSDB_NAMESPACE::Options().row_cache_hybrid_admission,
+            "Skip row cache inserts of keys whose cached copies were "
+            "invalidated at least row_cache_invalidation_threshold times");
+
+DEFINE_uint32(row_cache_invalidation_threshold,
+              ROCKSDB_NAMESPACE::Options().row_cache_invalidation_threshold,
+              "See row_cache_hybrid_admission");
+
+DEFINE_uint64(row_cache_migration_budget,
+              ROCKSDB_NAMESPACE::Options().row_cache_migration_budget,
+              "If > 0, copy rows rejected from the row cache for migration "
+              "into the memtable, up to this many bytes per memtable");
+
+DEFINE_int64(row_cache_tiny_lfu_sketch_entries, 0,
+             "If > 0, enable TinyLFU admission in the LRU row cache with a "
+             "frequency sketch sized for this many keys.");
+
+DEFINE_string(row_cache_admission_policy, "",
+              "Row cache admission policy: empty for the default "
+              "invalidation threshold policy, \"always\" or \"tinylfu\".");
+
+DEFINE_bool(row_cache_key_by_user_key,
+            ROCKSDB_NAMESPACE::Options().row_cache_key_by_user_key,
+            "Cache rows by user key rather than by table file, so that they "
+            "stay valid across compactions.");
+
+DEFINE_uint32(row_cache_tracking_sample_rate,
+              ROCKSDB_NAMESPACE::Options().row_cache_tracking_sample_rate,
+              "If > 0, one in this many row cache entries reports its "
+              "residency time and hits when leaving the row cache.");
+
 DEFINE_int32(open_files, ROCKSDB_NAMESPACE::Options().max_open_files,
              "Maximum number of files to keep open at the same time"
              " (use default if == 0)");
@@ -1166,6 +1208,11 @@ static enum ROCKSDB_NAMESPACE::CompressionType FLAGS_compression_type_e =
 
 DEFINE_int64(sample_for_compression, 0, "Sample every N block for compression");
 
+DEFINE_string(cache_compressed_tier_compression, "none",
+              "Algorithm to compress the blocks evicted from the LRU block "
+              "cache with, keeping them in the cache. See "
+              "LRUCacheOptions::compressed_tier_compression.");
+
 DEFINE_int32(compression_level, ROCKSDB_NAMESPACE::CompressionOptions().level,
              "Compression level. The meaning of this value is library-"
              "dependent. If unset, we try to use the default for the library "
@@ -1263,6 +1310,10 @@ DEFINE_uint64(delayed_write_rate, 8388608u,
 DEFINE_bool(enable_pipelined_write, true,
             "Allow WAL and memtable writes to be pipelined");
 
+DEFINE_uint64(wal_shards, 1,
+              "Number of WAL files written in turn and synced in parallel, "
+              "with pipelined writes");
+
 DEFINE_bool(
     unordered_write, false,
     "Enable the unordered write feature, which provides higher throughput but "
@@ -2794,8 +2845,10 @@ class Benchmark {
       return nullptr;
     }
     if (FLAGS_use_clock_cache) {
-      auto cache = NewClockCache(static_cast<size_t>(capacity),
-                                 FLAGS_cache_numshardbits);
+      ClockCacheOptions opts(static_cast<size_t>(capacity),
+                             FLAGS_cache_numshardbits);
+      opts.estimated_entry_charge = static_cast<size_t>(FLAGS_block_size);
+      auto cache = NewClockCache(opts);
       if (!cache) {
         fprintf(stderr, "Clock cache not supported.");
         exit(1);
@@ -2813,12 +2866,25 @@ class Benchmark {
           nullptr
 #endif
       );
+      opts.tiny_lfu_sketch_entries =
+          static_cast<size_t>(FLAGS_cache_tiny_lfu_sketch_entries);
+      opts.compressed_tier_compression = StringToCompressionType(
+          FLAGS_cache_compressed_tier_compression.c_str());
       if (FLAGS_use_cache_memkind_kmem_allocator) {
 #ifndef MEMKIND
         fprintf(stderr, "Memkind library is not linked with the binary.");
         exit(1);
 #endif
       }
+      if (FLAGS_use_cache_huge_page_allocator) {
+        Status s = NewHugePageMemoryAllocator(HugePageAllocatorOptions(),
+                                              &opts.memory_allocator);
+        if (!s.ok()) {
+          fprintf(stderr, "Cannot create huge page allocator: %s\n",
+                  s.ToString().c_str());
+          exit(1);
+        }
+      }
 #ifndef ROCKSDB_LITE
       if (!FLAGS_secondary_cache_uri.empty()) {
         Status s = SecondaryCache::CreateFromString(
@@ -4159,6 +4225,7 @@ class Benchmark {
     options.enable_write_thread_adaptive_yield =
         FLAGS_enable_write_thread_adaptive_yield;
     options.enable_pipelined_write = FLAGS_enable_pipelined_write;
+    options.wal_shards = static_cast<size_t>(FLAGS_wal_shards);
     options.unordered_write = FLAGS_unordered_write;
     options.write_thread_max_yield_usec = FLAGS_write_thread_max_yield_usec;
     options.write_thread_slow_yield_usec = FLAGS_write_thread_slow_yield_usec;
@@ -4312,12 +4379,31 @@ class Benchmark {
       }
     }
     if (FLAGS_row_cache_size) {
+      LRUCacheOptions row_cache_opts;
+      row_cache_opts.capacity = static_cast<size_t>(FLAGS_row_cache_size);
       if (FLAGS_cache_numshardbits >= 1) {
-        options.row_cache =
-            NewLRUCache(FLAGS_row_cache_size, FLAGS_cache_numshardbits);
-      } else {
-        options.row_cache = NewLRUCache(FLAGS_row_cache_size);
+        row_cache_opts.num_shard_bits = FLAGS_cache_numshardbits;
+      }
+      row_cache_opts.tiny_lfu_sketch_entries =
+          static_cast<size_t>(FLAGS_row_cache_tiny_lfu_sketch_entries);
+      options.row_cache = NewLRUCache(row_cache_opts);
+      options.row_cache_hybrid_admission = FLAGS_row_cache_hybrid_admission;
+      options.row_cache_invalidation_threshold =
+          FLAGS_row_cache_invalidation_threshold;
+      options.row_cache_migration_budget = FLAGS_row_cache_migration_budget;
+      if (FLAGS_row_cache_admission_policy == "always") {
+        options.row_cache_admission_policy =
+            NewAlwaysAdmitRowCacheAdmissionPolicy();
+      } else if (FLAGS_row_cache_admission_policy == "tinylfu") {
+        options.row_cache_admission_policy = NewTinyLFURowCacheAdmissionPolicy();
+      } else if (!FLAGS_row_cache_admission_policy.empty()) {
+        fprintf(stderr, "Unknown row_cache_admission_policy: %s\n",
+                FLAGS_row_cache_admission_policy.c_str());
+        exit(1);
       }
+      options.row_cache_key_by_user_key = FLAGS_row_cache_key_by_user_key;
+      options.row_cache_tracking_sample_rate =
+          FLAGS_row_cache_tracking_sample_rate;
     }
     if (FLAGS_enable_io_prio) {
       FLAGS_env->LowerThreadPoolIOPriority(Env::LOW);
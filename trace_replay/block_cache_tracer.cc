@@ -57,6 +57,12 @@ bool BlockCacheTraceHelper::IsUserAccess(TableReaderCaller caller) {
          caller == TableReaderCaller::kUserVerifyChecksum;
 }
 
+bool BlockCacheTraceHelper::IsRowCacheAccess(TraceType block_type) {
+  return block_type == TraceType::kBlockTraceRowCacheLookup ||
+         block_type == TraceType::kBlockTraceRowCacheWrite ||
+         block_type == TraceType::kBlockTraceRowCacheErase;
+}
+
 std::string BlockCacheTraceHelper::ComputeRowKey(
     const BlockCacheTraceRecord& access) {
   if (!IsGetOrMultiGet(access.caller)) {
@@ -136,6 +142,10 @@ Status BlockCacheTraceWriter::WriteBlockAccess(
     PutFixed64(&trace.payload, record.num_keys_in_block);
     trace.payload.push_back(record.referenced_key_exist_in_block);
   }
+  if (record.block_type == TraceType::kBlockTraceRowCacheLookup) {
+    trace.payload.push_back(record.row_read_from_storage);
+    trace.payload.push_back(record.row_rejected_for_migration);
+  }
   std::string encoded_trace;
   TracerHelper::EncodeTrace(trace, &encoded_trace);
   return trace_writer_->Write(encoded_trace);
@@ -301,6 +311,15 @@ Status BlockCacheTraceReader::ReadAccess(BlockCacheTraceRecord* record) {
     }
     record->referenced_key_exist_in_block = static_cast<Boolean>(enc_slice[0]);
   }
+  if (record->block_type == TraceType::kBlockTraceRowCacheLookup) {
+    if (enc_slice.size() < 2 * kCharSize) {
+      return Status::Incomplete(
+          "Incomplete access record: Failed to read the row cache admission "
+          "fields.");
+    }
+    record->row_read_from_storage = static_cast<Boolean>(enc_slice[0]);
+    record->row_rejected_for_migration = static_cast<Boolean>(enc_slice[1]);
+  }
   return Status::OK();
 }
 
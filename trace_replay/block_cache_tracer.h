@@ -30,6 +30,8 @@ class BlockCacheTraceHelper {
                                          TableReaderCaller caller);
   static bool IsGetOrMultiGet(TableReaderCaller caller);
   static bool IsUserAccess(TableReaderCaller caller);
+  // Whether the record traces a row cache access rather than a block access.
+  static bool IsRowCacheAccess(TraceType block_type);
   // Row key is a concatenation of the access's fd_number and the referenced
   // user key.
   static std::string ComputeRowKey(const BlockCacheTraceRecord& access);
@@ -88,6 +90,10 @@ struct BlockCacheLookupContext {
   uint64_t get_id = 0;
   std::string referenced_key;
   bool get_from_user_specified_snapshot = false;
+  // Set by iterators past ReadOptions::scan_resistant_fill_after_blocks
+  // blocks of a scan: data blocks read from the file are inserted into the
+  // block cache with Cache::Priority::BOTTOM.
+  bool fill_with_bottom_priority = false;
 
   void FillLookupContext(bool _is_cache_hit, bool _no_insert,
                          TraceType _block_type, uint64_t _block_size,
@@ -125,6 +131,12 @@ struct BlockCacheTraceRecord {
   uint64_t referenced_data_size = 0;
   uint64_t num_keys_in_block = 0;
   Boolean referenced_key_exist_in_block = Boolean::kFalse;
+  // Required fields for row cache lookups only. A row cache access record
+  // (BlockCacheTraceHelper::IsRowCacheAccess) holds the user key in
+  // block_key and, for lookups, the size of the row in block_size. A miss
+  // with no_insert set was not admitted into the row cache.
+  Boolean row_read_from_storage = Boolean::kFalse;
+  Boolean row_rejected_for_migration = Boolean::kFalse;
 
   BlockCacheTraceRecord() {}
 
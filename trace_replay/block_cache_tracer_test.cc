@@ -327,6 +327,62 @@ TEST_F(BlockCacheTracerTest, MixedBlocks) {
   }
 }
 
+TEST_F(BlockCacheTracerTest, RowCacheAccesses) {
+  {
+    TraceOptions trace_opt;
+    std::unique_ptr<TraceWriter> trace_writer;
+    ASSERT_OK(NewFileTraceWriter(env_, env_options_, trace_file_path_,
+                                 &trace_writer));
+    BlockCacheTraceWriter writer(clock_, trace_opt, std::move(trace_writer));
+    ASSERT_OK(writer.WriteHeader());
+    BlockCacheTraceRecord record;
+    record.access_timestamp = clock_->NowMicros();
+    record.block_type = TraceType::kBlockTraceRowCacheLookup;
+    record.block_size = 42;
+    record.cf_id = kCFId;
+    record.level = kLevel;
+    record.sst_fd_number = kSSTFDNumber;
+    record.caller = TableReaderCaller::kUserMultiGet;
+    record.no_insert = Boolean::kTrue;
+    record.row_read_from_storage = Boolean::kTrue;
+    record.row_rejected_for_migration = Boolean::kTrue;
+    ASSERT_OK(writer.WriteBlockAccess(record, "key1", "cf", Slice()));
+    record = BlockCacheTraceRecord();
+    record.access_timestamp = clock_->NowMicros();
+    record.block_type = TraceType::kBlockTraceRowCacheWrite;
+    ASSERT_OK(writer.WriteBlockAccess(record, "key1", "cf", Slice()));
+  }
+
+  {
+    std::unique_ptr<TraceReader> trace_reader;
+    ASSERT_OK(NewFileTraceReader(env_, env_options_, trace_file_path_,
+                                 &trace_reader));
+    BlockCacheTraceReader reader(std::move(trace_reader));
+    BlockCacheTraceHeader header;
+    ASSERT_OK(reader.ReadHeader(&header));
+    BlockCacheTraceRecord record;
+    ASSERT_OK(reader.ReadAccess(&record));
+    ASSERT_EQ(TraceType::kBlockTraceRowCacheLookup, record.block_type);
+    ASSERT_TRUE(BlockCacheTraceHelper::IsRowCacheAccess(record.block_type));
+    ASSERT_EQ("key1", record.block_key);
+    ASSERT_EQ(42U, record.block_size);
+    ASSERT_EQ("cf", record.cf_name);
+    ASSERT_EQ(kLevel, record.level);
+    ASSERT_EQ(kSSTFDNumber, record.sst_fd_number);
+    ASSERT_EQ(TableReaderCaller::kUserMultiGet, record.caller);
+    ASSERT_EQ(Boolean::kFalse, record.is_cache_hit);
+    ASSERT_EQ(Boolean::kTrue, record.no_insert);
+    ASSERT_EQ(Boolean::kTrue, record.row_read_from_storage);
+    ASSERT_EQ(Boolean::kTrue, record.row_rejected_for_migration);
+    record = BlockCacheTraceRecord();
+    ASSERT_OK(reader.ReadAccess(&record));
+    ASSERT_EQ(TraceType::kBlockTraceRowCacheWrite, record.block_type);
+    ASSERT_EQ("key1", record.block_key);
+    ASSERT_EQ(Boolean::kFalse, record.row_read_from_storage);
+    ASSERT_NOK(reader.ReadAccess(&record));
+  }
+}
+
 TEST_F(BlockCacheTracerTest, HumanReadableTrace) {
   BlockCacheTraceRecord record = GenerateAccessRecord();
   record.get_id = 1;
@@ -558,6 +558,9 @@ bool Tracer::ShouldSkipTrace(const TraceType& trace_type) {
     case kBlockTraceUncompressionDictBlock:
     case kBlockTraceRangeDeletionBlock:
     case kIOTracer:
+    case kBlockTraceRowCacheLookup:
+    case kBlockTraceRowCacheWrite:
+    case kBlockTraceRowCacheErase:
       filter_mask = kTraceFilterNone;
       break;
     case kTraceMultiGet:
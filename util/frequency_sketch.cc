@@ -0,0 +1,134 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/frequency_sketch.h"
+
+#include <algorithm>
+
+#include "util/math.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+constexpr size_t kMinWords = 64;
+constexpr size_t kMaxWords = size_t{1} << 30;
+constexpr uint64_t kMaxCounter = 15;
+constexpr uint64_t kLowBitsMask = 0x7777777777777777ULL;
+
+// Bit offset of the counter of the key in row r (0..3) of its word. Row r
+// uses the r-th quarter of the word; two more bits of the hash choose one of
+// its four counters.
+inline int CounterShift(uint64_t hash, int r) {
+  return (r * 4 + static_cast<int>((hash >> (32 + 2 * r)) & 3)) * 4;
+}
+
+// Doorkeeper word index and two bits within it, from hash bits not used to
+// locate counters
+inline size_t DoorkeeperWord(uint64_t hash, size_t mask) {
+  return static_cast<size_t>(hash >> 8) & mask;
+}
+
+inline uint64_t DoorkeeperBits(uint64_t hash) {
+  return (uint64_t{1} << ((hash >> 40) & 63)) |
+         (uint64_t{1} << ((hash >> 46) & 63));
+}
+
+size_t WordsFor(size_t expected_keys) {
+  size_t words = std::max(expected_keys / 2, kMinWords);
+  words = std::min(words, kMaxWords);
+  // Round up to a power of two
+  return size_t{1} << (FloorLog2(words - 1) + 1);
+}
+
+}  // namespace
+
+FrequencySketch::FrequencySketch(size_t expected_keys)
+    : mask_(WordsFor(expected_keys) - 1),
+      // About four doorkeeper bits per expected key, i.e. 8 per counter word
+      doorkeeper_mask_((mask_ + 1) / 8 - 1),
+      sample_size_(10 * static_cast<uint64_t>(mask_ + 1) * 2),
+      words_(new std::atomic<uint64_t>[mask_ + 1]),
+      doorkeeper_(new std::atomic<uint64_t>[doorkeeper_mask_ + 1]),
+      additions_(0) {
+  Clear();
+}
+
+bool FrequencySketch::TestAndSetDoorkeeper(uint64_t hash) {
+  std::atomic<uint64_t>& word = doorkeeper_[DoorkeeperWord(hash,
+                                                           doorkeeper_mask_)];
+  uint64_t bits = DoorkeeperBits(hash);
+  if ((word.load(std::memory_order_relaxed) & bits) == bits) {
+    return true;
+  }
+  return (word.fetch_or(bits, std::memory_order_relaxed) & bits) == bits;
+}
+
+bool FrequencySketch::DoorkeeperContains(uint64_t hash) const {
+  uint64_t bits = DoorkeeperBits(hash);
+  return (doorkeeper_[DoorkeeperWord(hash, doorkeeper_mask_)].load(
+              std::memory_order_relaxed) &
+          bits) == bits;
+}
+
+void FrequencySketch::Increment(uint64_t hash) {
+  if (TestAndSetDoorkeeper(hash)) {
+    std::atomic<uint64_t>& word = words_[hash & mask_];
+    uint64_t old_word = word.load(std::memory_order_relaxed);
+    uint64_t new_word;
+    do {
+      new_word = old_word;
+      for (int r = 0; r < 4; ++r) {
+        int shift = CounterShift(hash, r);
+        if (((old_word >> shift) & 0xf) < kMaxCounter) {
+          new_word += uint64_t{1} << shift;
+        }
+      }
+      if (new_word == old_word) {
+        // All counters saturated, still counted toward the sample
+        break;
+      }
+    } while (!word.compare_exchange_weak(old_word, new_word,
+                                         std::memory_order_relaxed));
+  }
+
+  if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 == sample_size_) {
+    Age();
+    additions_.fetch_sub(sample_size_ / 2, std::memory_order_relaxed);
+  }
+}
+
+uint32_t FrequencySketch::Estimate(uint64_t hash) const {
+  uint64_t w = words_[hash & mask_].load(std::memory_order_relaxed);
+  uint64_t freq = kMaxCounter;
+  for (int r = 0; r < 4; ++r) {
+    freq = std::min(freq, (w >> CounterShift(hash, r)) & 0xf);
+  }
+  return static_cast<uint32_t>(freq) + (DoorkeeperContains(hash) ? 1 : 0);
+}
+
+void FrequencySketch::Clear() {
+  for (size_t i = 0; i <= mask_; ++i) {
+    words_[i].store(0, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i <= doorkeeper_mask_; ++i) {
+    doorkeeper_[i].store(0, std::memory_order_relaxed);
+  }
+  additions_.store(0, std::memory_order_relaxed);
+}
+
+void FrequencySketch::Age() {
+  for (size_t i = 0; i <= mask_; ++i) {
+    uint64_t w = words_[i].load(std::memory_order_relaxed);
+    while (!words_[i].compare_exchange_weak(w, (w >> 1) & kLowBitsMask,
+                                            std::memory_order_relaxed)) {
+    }
+  }
+  for (size_t i = 0; i <= doorkeeper_mask_; ++i) {
+    doorkeeper_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
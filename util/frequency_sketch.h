@@ -0,0 +1,82 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rocksdb/rocksdb_namespace.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// A count-min sketch of 4-bit counters estimating how often each key (given
+// by a 64-bit hash) was seen recently, for TinyLFU style cache admission.
+//
+// All four counters of a key live in the same 64-bit word, one in each
+// quarter of it, so an update is a single CAS and an estimate a single load.
+// The first occurrence of a key only sets its bits in a small Bloom filter,
+// the "doorkeeper", so that the many keys seen only once do not pollute the
+// counters.
+//
+// The memory used is fixed at construction. After 10 increments per expected
+// key, all counters are halved and the doorkeeper is cleared ("aging"), so
+// that estimates reflect recent history and counters saturating at
+// kMaxFrequency still rank keys correctly.
+//
+// All functions may be called concurrently. Estimates are approximate, more
+// so while aging is in progress.
+class FrequencySketch {
+ public:
+  static constexpr uint32_t kMaxFrequency = 16;
+
+  // The number of counter words is a power of two close to expected_keys / 2,
+  // so the memory usage is about 4 to 8 bytes per expected key, plus about
+  // four bits per expected key for the doorkeeper.
+  explicit FrequencySketch(size_t expected_keys);
+
+  FrequencySketch(const FrequencySketch&) = delete;
+  FrequencySketch& operator=(const FrequencySketch&) = delete;
+
+  // Spreads a 32-bit hash, e.g. from a Cache shard whose low bits select the
+  // shard, over the 64 bits used by the sketch.
+  static uint64_t Spread(uint32_t hash) {
+    uint64_t x = uint64_t{hash} * 0x9E3779B97F4A7C15ULL;
+    return x ^ (x >> 29);
+  }
+
+  // Records one occurrence of the key.
+  void Increment(uint64_t hash);
+
+  // Number of recent occurrences of the key, in [0, kMaxFrequency]. Never
+  // underestimates, except through aging.
+  uint32_t Estimate(uint64_t hash) const;
+
+  // Clears all counters.
+  void Clear();
+
+  size_t NumWords() const { return mask_ + 1; }
+  size_t ApproximateMemoryUsage() const {
+    return (NumWords() + doorkeeper_mask_ + 1) * sizeof(std::atomic<uint64_t>);
+  }
+
+ private:
+  // Sets the doorkeeper bits of the key; returns whether all were set.
+  bool TestAndSetDoorkeeper(uint64_t hash);
+  bool DoorkeeperContains(uint64_t hash) const;
+  // Halves all counters and clears the doorkeeper.
+  void Age();
+
+  const size_t mask_;
+  const size_t doorkeeper_mask_;
+  const uint64_t sample_size_;
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+  std::unique_ptr<std::atomic<uint64_t>[]> doorkeeper_;
+  std::atomic<uint64_t> additions_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,102 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/frequency_sketch.h"
+
+#include <string>
+
+#include "port/stack_trace.h"
+#include "test_util/testharness.h"
+#include "util/hash.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class FrequencySketchTest : public testing::Test {
+ public:
+  static uint64_t Hash(const std::string& key) { return GetSliceHash64(key); }
+};
+
+TEST_F(FrequencySketchTest, Sizing) {
+  FrequencySketch small(1);
+  ASSERT_EQ(64U, small.NumWords());
+  FrequencySketch sketch(1000);
+  ASSERT_EQ(512U, sketch.NumWords());
+  ASSERT_EQ((512U + 64U) * 8U, sketch.ApproximateMemoryUsage());
+}
+
+TEST_F(FrequencySketchTest, Doorkeeper) {
+  FrequencySketch sketch(1024);
+  uint64_t h = Hash("key");
+  ASSERT_EQ(0U, sketch.Estimate(h));
+  // The first occurrence is only recorded in the doorkeeper
+  sketch.Increment(h);
+  ASSERT_EQ(1U, sketch.Estimate(h));
+  sketch.Increment(h);
+  ASSERT_EQ(2U, sketch.Estimate(h));
+  sketch.Clear();
+  ASSERT_EQ(0U, sketch.Estimate(h));
+}
+
+TEST_F(FrequencySketchTest, Saturation) {
+  FrequencySketch sketch(1024);
+  uint64_t h = Hash("key");
+  for (int i = 0; i < 100; ++i) {
+    sketch.Increment(h);
+  }
+  ASSERT_EQ(FrequencySketch::kMaxFrequency, sketch.Estimate(h));
+}
+
+TEST_F(FrequencySketchTest, HotKeysStandOut) {
+  FrequencySketch sketch(1024);
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 10; ++i) {
+      sketch.Increment(Hash("hot" + std::to_string(i)));
+    }
+  }
+  for (int i = 0; i < 1000; ++i) {
+    sketch.Increment(Hash("cold" + std::to_string(i)));
+  }
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_GE(sketch.Estimate(Hash("hot" + std::to_string(i))), 5U);
+  }
+  int overestimated = 0;
+  for (int i = 0; i < 1000; ++i) {
+    if (sketch.Estimate(Hash("cold" + std::to_string(i))) > 2) {
+      ++overestimated;
+    }
+  }
+  ASSERT_LT(overestimated, 20);
+}
+
+TEST_F(FrequencySketchTest, Aging) {
+  FrequencySketch sketch(128);
+  uint64_t h = Hash("key");
+  for (int i = 0; i < 9; ++i) {
+    sketch.Increment(h);
+  }
+  ASSERT_EQ(9U, sketch.Estimate(h));
+  // 10 increments per counter word trigger aging
+  for (size_t i = 0; i < 10 * 2 * sketch.NumWords(); ++i) {
+    sketch.Increment(Hash("other" + std::to_string(i % 16)));
+  }
+  ASSERT_LT(sketch.Estimate(h), 9U);
+}
+
+TEST_F(FrequencySketchTest, Spread) {
+  // Hashes of keys in the same cache shard differ only in the upper bits
+  FrequencySketch sketch(1024);
+  sketch.Increment(FrequencySketch::Spread(0x10000000));
+  sketch.Increment(FrequencySketch::Spread(0x10000000));
+  ASSERT_EQ(2U, sketch.Estimate(FrequencySketch::Spread(0x10000000)));
+  ASSERT_EQ(0U, sketch.Estimate(FrequencySketch::Spread(0x20000000)));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -131,50 +131,12 @@ CacheDumperImpl::DumpOneBlockCallBack() {
     }
 
     // Step 3: based on the block type, get the block raw pointer and length.
-    const char* block_start = nullptr;
-    size_t block_len = 0;
-    switch (role) {
-      case CacheEntryRole::kDataBlock:
-        type = CacheDumpUnitType::kData;
-        block_start = (static_cast<Block*>(value))->data();
-        block_len = (static_cast<Block*>(value))->size();
-        break;
-      case CacheEntryRole::kDeprecatedFilterBlock:
-        type = CacheDumpUnitType::kDeprecatedFilterBlock;
-        block_start = (static_cast<BlockContents*>(value))->data.data();
-        block_len = (static_cast<BlockContents*>(value))->data.size();
-        break;
-      case CacheEntryRole::kFilterBlock:
-        type = CacheDumpUnitType::kFilter;
-        block_start = (static_cast<ParsedFullFilterBlock*>(value))
-                          ->GetBlockContentsData()
-                          .data();
-        block_len = (static_cast<ParsedFullFilterBlock*>(value))
-                        ->GetBlockContentsData()
-                        .size();
-        break;
-      case CacheEntryRole::kFilterMetaBlock:
-        type = CacheDumpUnitType::kFilterMetaBlock;
-        block_start = (static_cast<Block*>(value))->data();
-        block_len = (static_cast<Block*>(value))->size();
-        break;
-      case CacheEntryRole::kIndexBlock:
-        type = CacheDumpUnitType::kIndex;
-        block_start = (static_cast<Block*>(value))->data();
-        block_len = (static_cast<Block*>(value))->size();
-        break;
-      case CacheEntryRole::kMisc:
-        filter_out = true;
-        break;
-      case CacheEntryRole::kOtherBlock:
-        filter_out = true;
-        break;
-      case CacheEntryRole::kWriteBuffer:
-        filter_out = true;
-        break;
-      default:
-        filter_out = true;
+    Slice block;
+    if (!CacheDumperHelper::GetDumpableBlock(role, value, &type, &block)) {
+      filter_out = true;
     }
+    const char* block_start = block.data();
+    size_t block_len = block.size();
 
     // Step 4: if the block should not be filter out, write the block to the
     // CacheDumpWriter
@@ -198,7 +160,6 @@ IOStatus CacheDumperImpl::WriteRawBlock(uint64_t timestamp,
                                         CacheDumpUnitType type,
                                         const Slice& key, void* value,
                                         size_t len, uint32_t checksum) {
-  // First, serilize the block information in a string
   DumpUnit dump_unit;
   dump_unit.timestamp = timestamp;
   dump_unit.key = key;
@@ -206,29 +167,9 @@ IOStatus CacheDumperImpl::WriteRawBlock(uint64_t timestamp,
   dump_unit.value_len = len;
   dump_unit.value = value;
   dump_unit.value_checksum = checksum;
-  std::string encoded_data;
-  CacheDumperHelper::EncodeDumpUnit(dump_unit, &encoded_data);
-
-  // Second, create the metadata, which contains a sequence number, the dump
-  // unit string checksum and the string size. The sequence number monotonically
-  // increases from 0.
-  DumpUnitMeta unit_meta;
-  unit_meta.sequence_num = sequence_num_;
-  sequence_num_++;
-  unit_meta.dump_unit_checksum =
-      crc32c::Value(encoded_data.c_str(), encoded_data.size());
-  unit_meta.dump_unit_size = static_cast<uint64_t>(encoded_data.size());
-  std::string encoded_meta;
-  CacheDumperHelper::EncodeDumpUnitMeta(unit_meta, &encoded_meta);
-
-  // We write the metadata first.
   assert(writer_ != nullptr);
-  IOStatus io_s = writer_->WriteMetadata(Slice(encoded_meta));
-  if (!io_s.ok()) {
-    return io_s;
-  }
-  // followed by the dump unit.
-  return writer_->WritePacket(Slice(encoded_data));
+  return CacheDumperHelper::WriteDumpUnit(writer_.get(), dump_unit,
+                                          &sequence_num_);
 }
 
 // Before we write any block, we write the header first to store the cache dump
@@ -313,84 +254,23 @@ IOStatus CacheDumpedLoaderImpl::RestoreCacheEntriesToSecondaryCache() {
     if (!io_s.ok()) {
       break;
     }
-    // create the raw_block_content based on the information in the dump_unit
-    BlockContents raw_block_contents(
-        Slice((char*)dump_unit.value, dump_unit.value_len));
-    Cache::CacheItemHelper* helper = nullptr;
-    Statistics* statistics = nullptr;
-    Status s = Status::OK();
-    // according to the block type, get the helper callback function and create
-    // the corresponding block
-    switch (dump_unit.type) {
-      case CacheDumpUnitType::kDeprecatedFilterBlock: {
-        helper = BlocklikeTraits<BlockContents>::GetCacheItemHelper(
-            BlockType::kFilter);
-        std::unique_ptr<BlockContents> block_holder;
-        block_holder.reset(BlocklikeTraits<BlockContents>::Create(
-            std::move(raw_block_contents), 0, statistics, false,
-            toptions_.filter_policy.get()));
-        // Insert the block to secondary cache.
-        // Note that, if we cannot get the correct helper callback, the block
-        // will not be inserted.
-        if (helper != nullptr) {
-          s = secondary_cache_->Insert(dump_unit.key,
-                                       (void*)(block_holder.get()), helper);
-        }
-        break;
-      }
-      case CacheDumpUnitType::kFilter: {
-        helper = BlocklikeTraits<ParsedFullFilterBlock>::GetCacheItemHelper(
-            BlockType::kFilter);
-        std::unique_ptr<ParsedFullFilterBlock> block_holder;
-        block_holder.reset(BlocklikeTraits<ParsedFullFilterBlock>::Create(
-            std::move(raw_block_contents), toptions_.read_amp_bytes_per_bit,
-            statistics, false, toptions_.filter_policy.get()));
-        if (helper != nullptr) {
-          s = secondary_cache_->Insert(dump_unit.key,
-                                       (void*)(block_holder.get()), helper);
-        }
-        break;
-      }
-      case CacheDumpUnitType::kData: {
-        helper = BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kData);
-        std::unique_ptr<Block> block_holder;
-        block_holder.reset(BlocklikeTraits<Block>::Create(
-            std::move(raw_block_contents), toptions_.read_amp_bytes_per_bit,
-            statistics, false, toptions_.filter_policy.get()));
-        if (helper != nullptr) {
-          s = secondary_cache_->Insert(dump_unit.key,
-                                       (void*)(block_holder.get()), helper);
-        }
-        break;
-      }
-      case CacheDumpUnitType::kIndex: {
-        helper = BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kIndex);
-        std::unique_ptr<Block> block_holder;
-        block_holder.reset(BlocklikeTraits<Block>::Create(
-            std::move(raw_block_contents), 0, statistics, false,
-            toptions_.filter_policy.get()));
-        if (helper != nullptr) {
-          s = secondary_cache_->Insert(dump_unit.key,
-                                       (void*)(block_holder.get()), helper);
-        }
-        break;
-      }
-      case CacheDumpUnitType::kFilterMetaBlock: {
-        helper = BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kFilter);
-        std::unique_ptr<Block> block_holder;
-        block_holder.reset(BlocklikeTraits<Block>::Create(
-            std::move(raw_block_contents), toptions_.read_amp_bytes_per_bit,
-            statistics, false, toptions_.filter_policy.get()));
-        if (helper != nullptr) {
-          s = secondary_cache_->Insert(dump_unit.key,
-                                       (void*)(block_holder.get()), helper);
-        }
-        break;
-      }
-      case CacheDumpUnitType::kFooter:
-        break;
-      default:
-        continue;
+    if (dump_unit.type == CacheDumpUnitType::kFooter) {
+      break;
+    }
+    // create the block based on the information in the dump_unit, and insert
+    // it to secondary cache. Note that, if we cannot get the correct helper
+    // callback, the block will not be inserted.
+    void* value = nullptr;
+    const Cache::CacheItemHelper* helper = nullptr;
+    size_t charge = 0;
+    Status s = CacheDumperHelper::CreateCacheValue(dump_unit, toptions_,
+                                                   &value, &helper, &charge);
+    if (s.IsNotSupported()) {
+      continue;
+    }
+    if (s.ok()) {
+      s = secondary_cache_->Insert(dump_unit.key, value, helper);
+      (*helper->del_cb)(dump_unit.key, value);
     }
     if (!s.ok()) {
       io_s = status_to_io_status(std::move(s));
@@ -403,57 +283,12 @@ IOStatus CacheDumpedLoaderImpl::RestoreCacheEntriesToSecondaryCache() {
   }
 }
 
-// Read and copy the dump unit metadata to std::string data, decode and create
-// the unit metadata based on the string
-IOStatus CacheDumpedLoaderImpl::ReadDumpUnitMeta(std::string* data,
-                                                 DumpUnitMeta* unit_meta) {
-  assert(reader_ != nullptr);
-  assert(data != nullptr);
-  assert(unit_meta != nullptr);
-  IOStatus io_s = reader_->ReadMetadata(data);
-  if (!io_s.ok()) {
-    return io_s;
-  }
-  return status_to_io_status(
-      CacheDumperHelper::DecodeDumpUnitMeta(*data, unit_meta));
-}
-
-// Read and copy the dump unit to std::string data, decode and create the unit
-// based on the string
-IOStatus CacheDumpedLoaderImpl::ReadDumpUnit(size_t len, std::string* data,
-                                             DumpUnit* unit) {
-  assert(reader_ != nullptr);
-  assert(data != nullptr);
-  assert(unit != nullptr);
-  IOStatus io_s = reader_->ReadPacket(data);
-  if (!io_s.ok()) {
-    return io_s;
-  }
-  if (data->size() != len) {
-    return IOStatus::Corruption(
-        "The data being read out does not match the size stored in metadata!");
-  }
-  Slice block;
-  return status_to_io_status(CacheDumperHelper::DecodeDumpUnit(*data, unit));
-}
-
 // Read the header
 IOStatus CacheDumpedLoaderImpl::ReadHeader(std::string* data,
                                            DumpUnit* dump_unit) {
-  DumpUnitMeta header_meta;
-  header_meta.reset();
-  std::string meta_string;
-  IOStatus io_s = ReadDumpUnitMeta(&meta_string, &header_meta);
-  if (!io_s.ok()) {
-    return io_s;
-  }
-
-  io_s = ReadDumpUnit(header_meta.dump_unit_size, data, dump_unit);
-  if (!io_s.ok()) {
-    return io_s;
-  }
-  uint32_t unit_checksum = crc32c::Value(data->c_str(), data->size());
-  if (unit_checksum != header_meta.dump_unit_checksum) {
+  IOStatus io_s =
+      CacheDumperHelper::ReadDumpUnit(reader_.get(), data, dump_unit);
+  if (io_s.IsCorruption()) {
     return IOStatus::Corruption("Read header unit corrupted!");
   }
   return io_s;
@@ -462,27 +297,103 @@ IOStatus CacheDumpedLoaderImpl::ReadHeader(std::string* data,
 // Read the blocks after header is read out
 IOStatus CacheDumpedLoaderImpl::ReadCacheBlock(std::string* data,
                                                DumpUnit* dump_unit) {
-  // According to the write process, we read the dump_unit_metadata first
-  DumpUnitMeta unit_meta;
-  unit_meta.reset();
-  std::string unit_string;
-  IOStatus io_s = ReadDumpUnitMeta(&unit_string, &unit_meta);
-  if (!io_s.ok()) {
-    return io_s;
-  }
+  return CacheDumperHelper::ReadDumpUnit(reader_.get(), data, dump_unit);
+}
 
-  // Based on the information in the dump_unit_metadata, we read the dump_unit
-  // and verify if its content is correct.
-  io_s = ReadDumpUnit(unit_meta.dump_unit_size, data, dump_unit);
-  if (!io_s.ok()) {
-    return io_s;
+bool CacheDumperHelper::GetDumpableBlock(CacheEntryRole role, void* value,
+                                         CacheDumpUnitType* type,
+                                         Slice* block) {
+  switch (role) {
+    case CacheEntryRole::kDataBlock:
+      *type = CacheDumpUnitType::kData;
+      *block = Slice((static_cast<Block*>(value))->data(),
+                     (static_cast<Block*>(value))->size());
+      return true;
+    case CacheEntryRole::kDeprecatedFilterBlock:
+      *type = CacheDumpUnitType::kDeprecatedFilterBlock;
+      *block = (static_cast<BlockContents*>(value))->data;
+      return true;
+    case CacheEntryRole::kFilterBlock:
+      *type = CacheDumpUnitType::kFilter;
+      *block =
+          (static_cast<ParsedFullFilterBlock*>(value))->GetBlockContentsData();
+      return true;
+    case CacheEntryRole::kFilterMetaBlock:
+      *type = CacheDumpUnitType::kFilterMetaBlock;
+      *block = Slice((static_cast<Block*>(value))->data(),
+                     (static_cast<Block*>(value))->size());
+      return true;
+    case CacheEntryRole::kIndexBlock:
+      *type = CacheDumpUnitType::kIndex;
+      *block = Slice((static_cast<Block*>(value))->data(),
+                     (static_cast<Block*>(value))->size());
+      return true;
+    default:
+      return false;
   }
-  uint32_t unit_checksum = crc32c::Value(data->c_str(), data->size());
-  if (unit_checksum != unit_meta.dump_unit_checksum) {
-    return IOStatus::Corruption(
-        "Checksum does not match! Read dumped unit corrupted!");
+}
+
+// According to the block type, get the helper callback function and create
+// the corresponding block from the raw block in the dump unit.
+Status CacheDumperHelper::CreateCacheValue(
+    const DumpUnit& dump_unit, const BlockBasedTableOptions& toptions,
+    void** value, const Cache::CacheItemHelper** helper, size_t* charge) {
+  BlockContents raw_block_contents(
+      Slice((char*)dump_unit.value, dump_unit.value_len));
+  Statistics* statistics = nullptr;
+  switch (dump_unit.type) {
+    case CacheDumpUnitType::kDeprecatedFilterBlock: {
+      *helper = BlocklikeTraits<BlockContents>::GetCacheItemHelper(
+          BlockType::kFilter);
+      BlockContents* block = BlocklikeTraits<BlockContents>::Create(
+          std::move(raw_block_contents), 0, statistics, false,
+          toptions.filter_policy.get());
+      *charge = block->ApproximateMemoryUsage();
+      *value = block;
+      break;
+    }
+    case CacheDumpUnitType::kFilter: {
+      *helper = BlocklikeTraits<ParsedFullFilterBlock>::GetCacheItemHelper(
+          BlockType::kFilter);
+      ParsedFullFilterBlock* block =
+          BlocklikeTraits<ParsedFullFilterBlock>::Create(
+              std::move(raw_block_contents), toptions.read_amp_bytes_per_bit,
+              statistics, false, toptions.filter_policy.get());
+      *charge = block->ApproximateMemoryUsage();
+      *value = block;
+      break;
+    }
+    case CacheDumpUnitType::kData: {
+      *helper = BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kData);
+      Block* block = BlocklikeTraits<Block>::Create(
+          std::move(raw_block_contents), toptions.read_amp_bytes_per_bit,
+          statistics, false, toptions.filter_policy.get());
+      *charge = block->ApproximateMemoryUsage();
+      *value = block;
+      break;
+    }
+    case CacheDumpUnitType::kIndex: {
+      *helper = BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kIndex);
+      Block* block = BlocklikeTraits<Block>::Create(
+          std::move(raw_block_contents), 0, statistics, false,
+          toptions.filter_policy.get());
+      *charge = block->ApproximateMemoryUsage();
+      *value = block;
+      break;
+    }
+    case CacheDumpUnitType::kFilterMetaBlock: {
+      *helper = BlocklikeTraits<Block>::GetCacheItemHelper(BlockType::kFilter);
+      Block* block = BlocklikeTraits<Block>::Create(
+          std::move(raw_block_contents), toptions.read_amp_bytes_per_bit,
+          statistics, false, toptions.filter_policy.get());
+      *charge = block->ApproximateMemoryUsage();
+      *value = block;
+      break;
+    }
+    default:
+      return Status::NotSupported("Not a dumped block");
   }
-  return io_s;
+  return Status::OK();
 }
 
 }  // namespace ROCKSDB_NAMESPACE
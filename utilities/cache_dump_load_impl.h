@@ -6,8 +6,10 @@
 #pragma once
 #ifndef ROCKSDB_LITE
 
+#include <algorithm>
 #include <unordered_map>
 
+#include "cache/cache_entry_roles.h"
 #include "file/random_access_file_reader.h"
 #include "file/writable_file_writer.h"
 #include "rocksdb/utilities/cache_dump_load.h"
@@ -17,6 +19,7 @@
 #include "table/block_based/cachable_entry.h"
 #include "table/block_based/parsed_full_filter_block.h"
 #include "table/block_based/reader_common.h"
+#include "util/crc32c.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -38,6 +41,8 @@ enum CacheDumpUnitType : unsigned char {
   kIndex = 11,
   kDeprecatedFilterBlock = 12,
   kFilterMetaBlock = 13,
+  // A row cache entry. Only in the dumps of DBOptions::cache_warmup_dir
+  kRow = 14,
   kBlockTypeMax,
 };
 
@@ -144,8 +149,6 @@ class CacheDumpedLoaderImpl : public CacheDumpedLoader {
   IOStatus RestoreCacheEntriesToSecondaryCache() override;
 
  private:
-  IOStatus ReadDumpUnitMeta(std::string* data, DumpUnitMeta* unit_meta);
-  IOStatus ReadDumpUnit(size_t len, std::string* data, DumpUnit* unit);
   IOStatus ReadHeader(std::string* data, DumpUnit* dump_unit);
   IOStatus ReadCacheBlock(std::string* data, DumpUnit* dump_unit);
 
@@ -204,14 +207,17 @@ class ToFileCacheDumpWriter : public CacheDumpWriter {
 
 // The default implementation of CacheDumpReader. It is implemented based on
 // RandomAccessFileReader. Note that, we keep an internal variable to remember
-// the current offset.
+// the current offset. The file is read sequentially in chunks of
+// readahead_size, which are then consumed by the metadata and packets.
 class FromFileCacheDumpReader : public CacheDumpReader {
  public:
   explicit FromFileCacheDumpReader(
-      std::unique_ptr<RandomAccessFileReader>&& reader)
+      std::unique_ptr<RandomAccessFileReader>&& reader,
+      size_t readahead_size = kDumpReaderBufferSize)
       : file_reader_(std::move(reader)),
         offset_(0),
-        buffer_(new char[kDumpReaderBufferSize]) {}
+        buffer_size_(readahead_size),
+        buffer_(new char[readahead_size]) {}
 
   ~FromFileCacheDumpReader() { delete[] buffer_; }
 
@@ -250,34 +256,31 @@ class FromFileCacheDumpReader : public CacheDumpReader {
   IOStatus Read(size_t len, std::string* data) {
     assert(file_reader_ != nullptr);
     IOStatus io_s;
-
-    unsigned int bytes_to_read = static_cast<unsigned int>(len);
-    unsigned int to_read = bytes_to_read > kDumpReaderBufferSize
-                               ? kDumpReaderBufferSize
-                               : bytes_to_read;
-
-    while (to_read > 0) {
-      io_s = file_reader_->Read(IOOptions(), offset_, to_read, &result_,
-                                buffer_, nullptr,
-                                Env::IO_TOTAL /* rate_limiter_priority */);
-      if (!io_s.ok()) {
-        return io_s;
-      }
-      if (result_.size() < to_read) {
-        return IOStatus::Corruption("Corrupted cache dump file.");
+    while (len > 0) {
+      if (result_.empty()) {
+        io_s = file_reader_->Read(IOOptions(), offset_, buffer_size_, &result_,
+                                  buffer_, nullptr,
+                                  Env::IO_TOTAL /* rate_limiter_priority */);
+        if (!io_s.ok()) {
+          return io_s;
+        }
+        if (result_.empty()) {
+          return IOStatus::Corruption("Corrupted cache dump file.");
+        }
+        offset_ += result_.size();
       }
-      data->append(result_.data(), result_.size());
-
-      offset_ += to_read;
-      bytes_to_read -= to_read;
-      to_read = bytes_to_read > kDumpReaderBufferSize ? kDumpReaderBufferSize
-                                                      : bytes_to_read;
+      size_t n = std::min(len, result_.size());
+      data->append(result_.data(), n);
+      result_.remove_prefix(n);
+      len -= n;
     }
     return io_s;
   }
   std::unique_ptr<RandomAccessFileReader> file_reader_;
+  // The part of the last chunk read not consumed yet
   Slice result_;
   size_t offset_;
+  size_t buffer_size_;
   char* buffer_;
 };
 
@@ -360,6 +363,76 @@ class CacheDumperHelper {
     assert(block.size() == dump_unit->value_len);
     return Status::OK();
   }
+
+  // Serilize a dump unit and write it with its metadata to the writer.
+  // sequence_num is incremented.
+  static IOStatus WriteDumpUnit(CacheDumpWriter* writer,
+                                const DumpUnit& dump_unit,
+                                uint32_t* sequence_num) {
+    assert(writer != nullptr);
+    std::string encoded_data;
+    EncodeDumpUnit(dump_unit, &encoded_data);
+    DumpUnitMeta unit_meta;
+    unit_meta.sequence_num = (*sequence_num)++;
+    unit_meta.dump_unit_checksum =
+        crc32c::Value(encoded_data.c_str(), encoded_data.size());
+    unit_meta.dump_unit_size = static_cast<uint64_t>(encoded_data.size());
+    std::string encoded_meta;
+    EncodeDumpUnitMeta(unit_meta, &encoded_meta);
+    IOStatus io_s = writer->WriteMetadata(Slice(encoded_meta));
+    if (!io_s.ok()) {
+      return io_s;
+    }
+    return writer->WritePacket(Slice(encoded_data));
+  }
+
+  // Read the next dump unit and its metadata from the reader, and verify it.
+  // The decoded dump_unit points into *data.
+  static IOStatus ReadDumpUnit(CacheDumpReader* reader, std::string* data,
+                               DumpUnit* dump_unit) {
+    assert(reader != nullptr);
+    std::string meta_string;
+    IOStatus io_s = reader->ReadMetadata(&meta_string);
+    if (!io_s.ok()) {
+      return io_s;
+    }
+    DumpUnitMeta unit_meta;
+    unit_meta.reset();
+    io_s = status_to_io_status(DecodeDumpUnitMeta(meta_string, &unit_meta));
+    if (!io_s.ok()) {
+      return io_s;
+    }
+    data->clear();
+    io_s = reader->ReadPacket(data);
+    if (!io_s.ok()) {
+      return io_s;
+    }
+    if (data->size() != unit_meta.dump_unit_size) {
+      return IOStatus::Corruption(
+          "The data being read out does not match the size stored in "
+          "metadata!");
+    }
+    if (crc32c::Value(data->c_str(), data->size()) !=
+        unit_meta.dump_unit_checksum) {
+      return IOStatus::Corruption(
+          "Checksum does not match! Read dumped unit corrupted!");
+    }
+    return status_to_io_status(DecodeDumpUnit(*data, dump_unit));
+  }
+
+  // Get the dump unit type and the raw block of a block cache entry. Returns
+  // false if entries of this role are not dumped.
+  static bool GetDumpableBlock(CacheEntryRole role, void* value,
+                               CacheDumpUnitType* type, Slice* block);
+
+  // Create the block cache value of a dumped block, as the block based table
+  // would have put in the block cache. On success, the caller owns *value
+  // and frees it with (*helper)->del_cb.
+  static Status CreateCacheValue(const DumpUnit& dump_unit,
+                                 const BlockBasedTableOptions& toptions,
+                                 void** value,
+                                 const Cache::CacheItemHelper** helper,
+                                 size_t* charge);
 };
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,200 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "utilities/simulator_cache/row_cache_simulator.h"
+
+#include "util/coding.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+struct SimRow {
+  // nullptr without hybrid admission
+  KVCPInvalidationTable* kvcp_table;
+  uint64_t fp;
+  // Erased because its key was written
+  bool stale;
+};
+
+void DeleteSimRow(const Slice& /*key*/, void* value) {
+  auto* row = static_cast<SimRow*>(value);
+  if (row->kvcp_table != nullptr) {
+    if (row->stale) {
+      row->kvcp_table->OnStaleErase(row->fp);
+    } else {
+      row->kvcp_table->OnEvict(row->fp);
+    }
+  }
+  delete row;
+}
+
+}  // namespace
+
+std::string RowCacheSimConfiguration::ToString() const {
+  if (policy_name == "hybrid") {
+    return policy_name + "_" + std::to_string(invalidation_threshold);
+  }
+  return policy_name;
+}
+
+Status RowCacheSimulator::Create(const RowCacheSimConfiguration& config,
+                                 std::unique_ptr<RowCacheSimulator>* simulator) {
+  std::shared_ptr<RowCacheAdmissionPolicy> policy;
+  std::unique_ptr<KVCPInvalidationTable> kvcp_table;
+  if (config.policy_name == "lru") {
+    policy = NewAlwaysAdmitRowCacheAdmissionPolicy();
+  } else if (config.policy_name == "hybrid") {
+    if (config.invalidation_threshold == 0) {
+      return Status::InvalidArgument(
+          "Hybrid row cache simulation needs an invalidation threshold.");
+    }
+    policy = NewInvalidationThresholdRowCacheAdmissionPolicy();
+    kvcp_table.reset(new KVCPInvalidationTable(
+        KVCPInvalidationTable::SlotsForCapacity(config.capacity)));
+  } else if (config.policy_name == "tinylfu") {
+    policy = NewTinyLFURowCacheAdmissionPolicy();
+  } else {
+    return Status::InvalidArgument("Unknown row cache simulation policy " +
+                                   config.policy_name);
+  }
+  std::shared_ptr<Cache> sim_cache =
+      NewLRUCache(config.capacity, /*num_shard_bits=*/0,
+                  /*strict_capacity_limit=*/false,
+                  /*high_pri_pool_ratio=*/0.0);
+  simulator->reset(new RowCacheSimulator(std::move(sim_cache),
+                                         std::move(policy),
+                                         std::move(kvcp_table),
+                                         config.invalidation_threshold));
+  return Status::OK();
+}
+
+RowCacheSimulator::RowCacheSimulator(
+    std::shared_ptr<Cache> sim_cache,
+    std::shared_ptr<RowCacheAdmissionPolicy> policy,
+    std::unique_ptr<KVCPInvalidationTable> kvcp_table,
+    uint32_t invalidation_threshold)
+    : kvcp_table_(std::move(kvcp_table)),
+      sim_cache_(std::move(sim_cache)),
+      policy_(std::move(policy)),
+      invalidation_threshold_(invalidation_threshold) {}
+
+void RowCacheSimulator::Access(const BlockCacheTraceRecord& access) {
+  key_.clear();
+  PutFixed32(&key_, static_cast<uint32_t>(access.cf_id));
+  key_.append(access.block_key);
+  switch (access.block_type) {
+    case TraceType::kBlockTraceRowCacheLookup:
+      Lookup(access);
+      break;
+    case TraceType::kBlockTraceRowCacheWrite:
+      Write();
+      break;
+    default:
+      break;
+  }
+}
+
+void RowCacheSimulator::Lookup(const BlockCacheTraceRecord& access) {
+  stats_.lookups++;
+  RowCacheAdmissionContext context;
+  context.user_key = access.block_key;
+  context.level = static_cast<int>(access.level);
+  Cache::Handle* handle = sim_cache_->Lookup(key_);
+  if (handle != nullptr) {
+    sim_cache_->Release(handle);
+    stats_.hits++;
+    stats_.bytes_saved += access.block_size;
+    policy_->OnHit(context);
+    return;
+  }
+  context.read_from_storage = access.is_cache_hit == Boolean::kTrue ||
+                              access.row_read_from_storage == Boolean::kTrue;
+  uint64_t fp = 0;
+  if (kvcp_table_) {
+    fp = KVCPInvalidationTable::Fingerprint(KVCPKeyCtx{
+        /*db_ptr=*/nullptr, static_cast<uint32_t>(access.cf_id),
+        access.block_key});
+    context.hybrid_admission = true;
+    context.kvcp = kvcp_table_->GetLookupState(fp);
+    context.invalidation_threshold = invalidation_threshold_;
+  }
+  switch (policy_->Admit(context)) {
+    case RowCacheAdmissionDecision::kAdmit: {
+      stats_.admitted++;
+      if (kvcp_table_) {
+        kvcp_table_->OnInsert(fp);
+      }
+      SimRow* row = new SimRow{kvcp_table_.get(), fp, /*stale=*/false};
+      sim_cache_
+          ->Insert(key_, row, static_cast<size_t>(access.block_size),
+                   &DeleteSimRow)
+          .PermitUncheckedError();
+      break;
+    }
+    case RowCacheAdmissionDecision::kReject:
+      stats_.rejected++;
+      break;
+    case RowCacheAdmissionDecision::kRejectForMigration:
+      stats_.migrated++;
+      stats_.migrated_bytes += access.block_size;
+      break;
+  }
+}
+
+void RowCacheSimulator::Write() {
+  Cache::Handle* handle = sim_cache_->Lookup(key_);
+  if (handle == nullptr) {
+    return;
+  }
+  stats_.invalidated++;
+  auto* row = static_cast<SimRow*>(sim_cache_->Value(handle));
+  if (row->kvcp_table != nullptr) {
+    row->kvcp_table->OnInvalidation(row->fp);
+  }
+  row->stale = true;
+  sim_cache_->Erase(key_);
+  sim_cache_->Release(handle);
+}
+
+RowCacheTraceSimulator::RowCacheTraceSimulator(
+    uint64_t warmup_seconds,
+    const std::vector<RowCacheSimConfiguration>& configurations)
+    : warmup_seconds_(warmup_seconds), configurations_(configurations) {}
+
+Status RowCacheTraceSimulator::InitializeCaches() {
+  for (auto const& config : configurations_) {
+    std::unique_ptr<RowCacheSimulator> sim_cache;
+    Status s = RowCacheSimulator::Create(config, &sim_cache);
+    if (!s.ok()) {
+      return s;
+    }
+    sim_caches_.emplace_back(config, std::move(sim_cache));
+  }
+  return Status::OK();
+}
+
+void RowCacheTraceSimulator::Access(const BlockCacheTraceRecord& access) {
+  if (!BlockCacheTraceHelper::IsRowCacheAccess(access.block_type)) {
+    return;
+  }
+  if (trace_start_time_ == 0) {
+    trace_start_time_ = access.access_timestamp;
+  }
+  // access.access_timestamp is in microseconds.
+  if (!warmup_complete_ &&
+      trace_start_time_ + warmup_seconds_ * kMicrosInSecond <=
+          access.access_timestamp) {
+    for (auto& config_cache : sim_caches_) {
+      config_cache.second->reset_counter();
+    }
+    warmup_complete_ = true;
+  }
+  for (auto& config_cache : sim_caches_) {
+    config_cache.second->Access(access);
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,147 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db/kv_cache_policy_table.h"
+#include "rocksdb/cache.h"
+#include "rocksdb/row_cache_admission_policy.h"
+#include "trace_replay/block_cache_tracer.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// A simulated row cache configuration.
+struct RowCacheSimConfiguration {
+  // Admission policy of the simulated row cache:
+  // "lru": admits every row (NewAlwaysAdmitRowCacheAdmissionPolicy).
+  // "hybrid": row cache hybrid admission with the invalidation threshold
+  //   below (NewInvalidationThresholdRowCacheAdmissionPolicy).
+  // "tinylfu": admits rows of frequently looked up keys
+  //   (NewTinyLFURowCacheAdmissionPolicy), without hybrid admission.
+  std::string policy_name;
+  // ColumnFamilyOptions::row_cache_invalidation_threshold, for "hybrid".
+  uint32_t invalidation_threshold = 0;
+  // Row cache capacity in bytes.
+  uint64_t capacity = 0;
+
+  // Name of the policy, suffixed with the threshold for "hybrid".
+  std::string ToString() const;
+};
+
+struct RowCacheSimStats {
+  uint64_t lookups = 0;
+  uint64_t hits = 0;
+  // Sizes of the rows served from the simulated row cache.
+  uint64_t bytes_saved = 0;
+  uint64_t admitted = 0;
+  uint64_t rejected = 0;
+  // Rows rejected for migration to the memtable, and their sizes.
+  uint64_t migrated = 0;
+  uint64_t migrated_bytes = 0;
+  // Writes to keys with a row in the simulated row cache.
+  uint64_t invalidated = 0;
+
+  double hit_ratio() const {
+    if (lookups == 0) {
+      return -1;
+    }
+    return static_cast<double>(hits * 100.0 / lookups);
+  }
+};
+
+// Replays the row cache accesses of a block cache trace
+// (BlockCacheTraceHelper::IsRowCacheAccess) against a simulated row cache
+// keyed by column family and user key.
+//
+// A lookup record that hits the simulated cache counts its row size as
+// saved; one that misses asks the admission policy whether to insert the
+// row. Rows served from the traced row cache are assumed to need a read from
+// storage when the simulated cache misses them. A write record erases the
+// row of its key and, with hybrid admission, counts an invalidation in the
+// same KVCPInvalidationTable the DB uses. Erase records are ignored, since
+// the simulated cache erases rows on writes by itself.
+//
+// Rows migrated to the memtable by the traced DB are not looked up in the
+// row cache, so they are missing from the trace.
+class RowCacheSimulator {
+ public:
+  static Status Create(const RowCacheSimConfiguration& config,
+                       std::unique_ptr<RowCacheSimulator>* simulator);
+
+  ~RowCacheSimulator() = default;
+  // No copy and move.
+  RowCacheSimulator(const RowCacheSimulator&) = delete;
+  RowCacheSimulator& operator=(const RowCacheSimulator&) = delete;
+  RowCacheSimulator(RowCacheSimulator&&) = delete;
+  RowCacheSimulator& operator=(RowCacheSimulator&&) = delete;
+
+  void Access(const BlockCacheTraceRecord& access);
+
+  const RowCacheSimStats& stats() const { return stats_; }
+  void reset_counter() { stats_ = RowCacheSimStats(); }
+
+ private:
+  RowCacheSimulator(std::shared_ptr<Cache> sim_cache,
+                    std::shared_ptr<RowCacheAdmissionPolicy> policy,
+                    std::unique_ptr<KVCPInvalidationTable> kvcp_table,
+                    uint32_t invalidation_threshold);
+
+  void Lookup(const BlockCacheTraceRecord& access);
+  void Write();
+
+  // Key of the current access
+  std::string key_;
+  // Outlives sim_cache_, since the deleter of its rows updates the table.
+  std::unique_ptr<KVCPInvalidationTable> kvcp_table_;
+  std::shared_ptr<Cache> sim_cache_;
+  std::shared_ptr<RowCacheAdmissionPolicy> policy_;
+  const uint32_t invalidation_threshold_;
+  RowCacheSimStats stats_;
+};
+
+// Replays a block cache trace against row cache simulators of several
+// configurations.
+class RowCacheTraceSimulator {
+ public:
+  // warmup_seconds: The number of seconds to warmup simulated caches. The
+  // counters are reset after the warmup completes.
+  RowCacheTraceSimulator(
+      uint64_t warmup_seconds,
+      const std::vector<RowCacheSimConfiguration>& configurations);
+  ~RowCacheTraceSimulator() = default;
+  // No copy and move.
+  RowCacheTraceSimulator(const RowCacheTraceSimulator&) = delete;
+  RowCacheTraceSimulator& operator=(const RowCacheTraceSimulator&) = delete;
+  RowCacheTraceSimulator(RowCacheTraceSimulator&&) = delete;
+  RowCacheTraceSimulator& operator=(RowCacheTraceSimulator&&) = delete;
+
+  Status InitializeCaches();
+
+  // Ignores accesses that are not row cache accesses.
+  void Access(const BlockCacheTraceRecord& access);
+
+  const std::vector<std::pair<RowCacheSimConfiguration,
+                              std::unique_ptr<RowCacheSimulator>>>&
+  sim_caches() const {
+    return sim_caches_;
+  }
+
+ private:
+  const uint64_t warmup_seconds_;
+  const std::vector<RowCacheSimConfiguration> configurations_;
+
+  bool warmup_complete_ = false;
+  std::vector<
+      std::pair<RowCacheSimConfiguration, std::unique_ptr<RowCacheSimulator>>>
+      sim_caches_;
+  uint64_t trace_start_time_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
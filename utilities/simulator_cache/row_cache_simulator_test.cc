@@ -0,0 +1,186 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "utilities/simulator_cache/row_cache_simulator.h"
+
+#include "rocksdb/env.h"
+#include "rocksdb/trace_record.h"
+#include "test_util/testharness.h"
+#include "test_util/testutil.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+const uint64_t kCacheSize = 1024 * 1024;
+const uint64_t kRowSize = 100;
+}  // namespace
+
+class RowCacheSimulatorTest : public testing::Test {
+ public:
+  RowCacheSimulatorTest() { env_ = ROCKSDB_NAMESPACE::Env::Default(); }
+
+  BlockCacheTraceRecord GenerateLookupRecord(const std::string& key,
+                                             bool read_from_storage = true) {
+    BlockCacheTraceRecord record;
+    record.block_type = TraceType::kBlockTraceRowCacheLookup;
+    record.block_key = key;
+    record.block_size = kRowSize;
+    record.access_timestamp = env_->NowMicros();
+    record.cf_id = 0;
+    record.caller = TableReaderCaller::kUserGet;
+    record.level = 1;
+    record.row_read_from_storage =
+        read_from_storage ? Boolean::kTrue : Boolean::kFalse;
+    return record;
+  }
+
+  BlockCacheTraceRecord GenerateWriteRecord(const std::string& key) {
+    BlockCacheTraceRecord record;
+    record.block_type = TraceType::kBlockTraceRowCacheWrite;
+    record.block_key = key;
+    record.access_timestamp = env_->NowMicros();
+    record.cf_id = 0;
+    return record;
+  }
+
+  std::unique_ptr<RowCacheSimulator> NewSimulator(
+      const std::string& policy_name, uint32_t invalidation_threshold = 0,
+      uint64_t capacity = kCacheSize) {
+    RowCacheSimConfiguration config;
+    config.policy_name = policy_name;
+    config.invalidation_threshold = invalidation_threshold;
+    config.capacity = capacity;
+    std::unique_ptr<RowCacheSimulator> simulator;
+    EXPECT_OK(RowCacheSimulator::Create(config, &simulator));
+    return simulator;
+  }
+
+  Env* env_;
+};
+
+TEST_F(RowCacheSimulatorTest, LRU) {
+  std::unique_ptr<RowCacheSimulator> simulator = NewSimulator("lru");
+  simulator->Access(GenerateLookupRecord("k1"));
+  simulator->Access(GenerateLookupRecord("k1"));
+  simulator->Access(GenerateLookupRecord("k2"));
+  ASSERT_EQ(3U, simulator->stats().lookups);
+  ASSERT_EQ(1U, simulator->stats().hits);
+  ASSERT_EQ(2U, simulator->stats().admitted);
+  ASSERT_EQ(kRowSize, simulator->stats().bytes_saved);
+
+  // A write makes the row stale
+  simulator->Access(GenerateWriteRecord("k1"));
+  ASSERT_EQ(1U, simulator->stats().invalidated);
+  simulator->Access(GenerateLookupRecord("k1"));
+  ASSERT_EQ(1U, simulator->stats().hits);
+  // Writes to keys without a row are not invalidations
+  simulator->Access(GenerateWriteRecord("k3"));
+  ASSERT_EQ(1U, simulator->stats().invalidated);
+  ASSERT_EQ(0U, simulator->stats().migrated);
+
+  simulator->reset_counter();
+  ASSERT_EQ(0U, simulator->stats().lookups);
+  ASSERT_EQ(-1, simulator->stats().hit_ratio());
+}
+
+TEST_F(RowCacheSimulatorTest, LRUEviction) {
+  // Room for a single row
+  std::unique_ptr<RowCacheSimulator> simulator =
+      NewSimulator("lru", /*invalidation_threshold=*/0, kRowSize * 3 / 2);
+  simulator->Access(GenerateLookupRecord("k1"));
+  simulator->Access(GenerateLookupRecord("k2"));
+  simulator->Access(GenerateLookupRecord("k1"));
+  ASSERT_EQ(0U, simulator->stats().hits);
+}
+
+TEST_F(RowCacheSimulatorTest, Hybrid) {
+  for (uint32_t threshold = 1; threshold <= 3; ++threshold) {
+    std::unique_ptr<RowCacheSimulator> simulator =
+        NewSimulator("hybrid", threshold);
+    for (uint32_t i = 0; i < threshold; ++i) {
+      simulator->Access(GenerateLookupRecord("k1"));
+      simulator->Access(GenerateWriteRecord("k1"));
+    }
+    ASSERT_EQ(uint64_t{threshold}, simulator->stats().admitted);
+    ASSERT_EQ(uint64_t{threshold}, simulator->stats().invalidated);
+    // Only rows read from storage are migrated
+    simulator->Access(GenerateLookupRecord("k1", /*read_from_storage=*/false));
+    ASSERT_EQ(uint64_t{threshold} + 1, simulator->stats().admitted);
+    simulator->Access(GenerateWriteRecord("k1"));
+    simulator->Access(GenerateLookupRecord("k1"));
+    ASSERT_EQ(1U, simulator->stats().migrated);
+    ASSERT_EQ(kRowSize, simulator->stats().migrated_bytes);
+    ASSERT_EQ(0U, simulator->stats().hits);
+    // Other keys are not affected
+    simulator->Access(GenerateLookupRecord("k2"));
+    ASSERT_EQ(uint64_t{threshold} + 2, simulator->stats().admitted);
+  }
+}
+
+TEST_F(RowCacheSimulatorTest, TinyLFU) {
+  std::unique_ptr<RowCacheSimulator> simulator = NewSimulator("tinylfu");
+  simulator->Access(GenerateLookupRecord("k1"));
+  ASSERT_EQ(1U, simulator->stats().rejected);
+  simulator->Access(GenerateLookupRecord("k1"));
+  ASSERT_EQ(1U, simulator->stats().admitted);
+  simulator->Access(GenerateLookupRecord("k1"));
+  ASSERT_EQ(1U, simulator->stats().hits);
+  // Without hybrid admission rows are never migrated
+  for (int i = 0; i < 3; ++i) {
+    simulator->Access(GenerateWriteRecord("k1"));
+    simulator->Access(GenerateLookupRecord("k1"));
+  }
+  ASSERT_EQ(0U, simulator->stats().migrated);
+  ASSERT_EQ(4U, simulator->stats().admitted);
+}
+
+TEST_F(RowCacheSimulatorTest, InvalidConfiguration) {
+  RowCacheSimConfiguration config;
+  config.capacity = kCacheSize;
+  std::unique_ptr<RowCacheSimulator> simulator;
+  config.policy_name = "unknown";
+  ASSERT_TRUE(RowCacheSimulator::Create(config, &simulator).IsInvalidArgument());
+  config.policy_name = "hybrid";
+  ASSERT_TRUE(RowCacheSimulator::Create(config, &simulator).IsInvalidArgument());
+  config.invalidation_threshold = 2;
+  ASSERT_OK(RowCacheSimulator::Create(config, &simulator));
+  ASSERT_EQ("hybrid_2", config.ToString());
+}
+
+TEST_F(RowCacheSimulatorTest, TraceSimulator) {
+  std::vector<RowCacheSimConfiguration> configs;
+  for (const char* policy : {"lru", "tinylfu"}) {
+    RowCacheSimConfiguration config;
+    config.policy_name = policy;
+    config.capacity = kCacheSize;
+    configs.push_back(config);
+  }
+  RowCacheTraceSimulator trace_simulator(/*warmup_seconds=*/0, configs);
+  ASSERT_OK(trace_simulator.InitializeCaches());
+  ASSERT_EQ(2U, trace_simulator.sim_caches().size());
+
+  // Block accesses are ignored
+  BlockCacheTraceRecord block_access = GenerateLookupRecord("k1");
+  block_access.block_type = TraceType::kBlockTraceDataBlock;
+  trace_simulator.Access(block_access);
+  for (int i = 0; i < 4; ++i) {
+    trace_simulator.Access(GenerateLookupRecord("k1"));
+  }
+  const RowCacheSimStats& lru_stats =
+      trace_simulator.sim_caches()[0].second->stats();
+  ASSERT_EQ(4U, lru_stats.lookups);
+  ASSERT_EQ(3U, lru_stats.hits);
+  ASSERT_EQ(75.0, lru_stats.hit_ratio());
+  const RowCacheSimStats& tinylfu_stats =
+      trace_simulator.sim_caches()[1].second->stats();
+  ASSERT_EQ(4U, tinylfu_stats.lookups);
+  ASSERT_EQ(2U, tinylfu_stats.hits);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
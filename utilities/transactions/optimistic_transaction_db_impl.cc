@@ -14,6 +14,7 @@
 #include "rocksdb/db.h"
 #include "rocksdb/options.h"
 #include "rocksdb/utilities/optimistic_transaction_db.h"
+#include "util/cast_util.h"
 #include "utilities/transactions/optimistic_transaction.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -92,6 +93,9 @@ Status OptimisticTransactionDB::Open(
   s = DB::Open(db_options, dbname, column_families_copy, handles, &db);
 
   if (s.ok()) {
+    // Rows copied for the row cache would not be seen by conflict checks
+    static_cast_with_check<DBImpl>(db->GetRootDB())
+        ->DisableRowCacheMigration();
     *dbptr = new OptimisticTransactionDBImpl(db, occ_options);
   }
 
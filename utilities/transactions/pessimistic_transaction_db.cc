@@ -36,6 +36,7 @@ PessimisticTransactionDB::PessimisticTransactionDB(
       lock_manager_(NewLockManager(this, txn_db_options)) {
   assert(db_impl_ != nullptr);
   info_log_ = db_impl_->GetDBOptions().info_log;
+  db_impl_->DisableRowCacheMigration();
 }
 
 // Support initiliazing PessimisticTransactionDB from a stackable db
@@ -61,6 +62,7 @@ PessimisticTransactionDB::PessimisticTransactionDB(
       txn_db_options_(txn_db_options),
       lock_manager_(NewLockManager(this, txn_db_options)) {
   assert(db_impl_ != nullptr);
+  db_impl_->DisableRowCacheMigration();
 }
 
 PessimisticTransactionDB::~PessimisticTransactionDB() {